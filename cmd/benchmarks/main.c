@@ -0,0 +1,208 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+/* Microbenchmarks of the interpreter: each benchmark runs a method with a long straight-line body many times and
+   reports the time per executed high-level instruction, which is dominated by dispatch overhead. Every benchmark
+   is run twice: interpreted, and compiled by the JIT right away. Run with no arguments to run all benchmarks, or
+   with a benchmark name to run only that benchmark. */
+
+#include <runtime/interpreter.h>
+#include <runtime/jit.h>
+#include <core/environment.h>
+
+#include <stdio.h>  /* for printf(..) */
+#include <stdlib.h> /* for exit(..) */
+#include <string.h> /* for strcmp(..) */
+
+#define BENCHMARK_RUN_COUNT    200000
+#define BENCHMARK_REPEAT_COUNT 100
+#define BENCHMARK_MAX_BODY_SIZE HM_UINT16_MAX
+#define BENCHMARK_METHOD_COUNT 2
+
+#define BENCHMARK_CHECK(err) \
+    if ((err) != HM_OK) { \
+        printf("error %d at %s:%d\n", (int)(err), __FILE__, __LINE__); \
+        exit(1); \
+    }
+
+typedef struct {
+    hm_uint8       opcodes[BENCHMARK_MAX_BODY_SIZE];
+    hm_method_size size;
+    hm_nint        instruction_count;
+} hmBenchmarkBody;
+
+typedef struct {
+    hmAllocator*  allocator;
+    hmMethod      methods[BENCHMARK_METHOD_COUNT]; /* Method IDs are indices in this table. */
+    hmSignature*  signatures[BENCHMARK_METHOD_COUNT];
+    hm_nint       method_count;
+    hmJit         jit;
+    hmInterpreter interpreter;
+} hmBenchmarkContext;
+
+typedef void (*hmBenchmarkFunc)(hmBenchmarkContext* context, hmBenchmarkBody* body);
+
+static hmValueType int64_param_types[] = { HM_VALUE_TYPE_INT64 };
+static hmValueType int32_param_types[] = { HM_VALUE_TYPE_INT32 };
+static hmSignature moves_signature = { int64_param_types, 1, HM_VALUE_TYPE_INT64 }; /* (J)J */
+static hmSignature leaf_signature = { int32_param_types, 1, HM_VALUE_TYPE_INT32 };  /* (I)I */
+static hmSignature void_signature = { HM_NULL, 0, HM_VALUE_TYPE_VOID };            /* ()V */
+
+static void emit(hmBenchmarkBody* body, hmHLOpcode opcode, hm_uint64 operand, hm_nint operand_size)
+{
+    body->opcodes[body->size++] = opcode;
+    for (hm_nint i = 0; i < operand_size; i++) {
+        body->opcodes[body->size++] = (hm_uint8)(operand >> (i * 8));
+    }
+    body->instruction_count++;
+}
+
+static hmError resolve_call_target(hm_metadata_id method_id, void* user_data, hmMethod** out_method, hmSignature** out_signature)
+{
+    hmBenchmarkContext* context = (hmBenchmarkContext*)user_data;
+    if (method_id >= context->method_count) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    *out_method = &context->methods[method_id];
+    *out_signature = context->signatures[method_id];
+    return HM_OK;
+}
+
+/* Returns the ID of the new method. */
+static hm_metadata_id add_method(hmBenchmarkContext* context, const char* name, hmSignature* signature, hmBenchmarkBody* body)
+{
+    hm_metadata_id method_id = (hm_metadata_id)context->method_count;
+    hmMethodMetadata metadata;
+    BENCHMARK_CHECK(hmCreateStringViewFromCString(name, &metadata.name));
+    BENCHMARK_CHECK(hmCreateStringViewFromCString("", &metadata.signature));
+    metadata.method_id = method_id;
+    metadata.class_id = 0;
+    metadata.module_id = 0;
+    BENCHMARK_CHECK(hmCreateMethod(context->allocator, context->allocator, HM_NULL, &metadata, &context->methods[method_id]));
+    context->signatures[method_id] = signature;
+    context->method_count++;
+    hmMethodBody hl_body = { body->opcodes, body->size };
+    hmLLMethodBody ll_body;
+    BENCHMARK_CHECK(hmCompileMethodBody(context->allocator, &hl_body, signature, &resolve_call_target, context, &ll_body));
+    BENCHMARK_CHECK(hmMethodSetLLBody(&context->methods[method_id], &ll_body));
+    return method_id;
+}
+
+/* Register-to-register moves (ldloc + stloc pairs are fused into superinstructions). */
+static void benchmark_moves(hmBenchmarkContext* context, hmBenchmarkBody* body)
+{
+    emit(body, HM_HLOPCODE_LDARG, 0, sizeof(hm_uint16));
+    emit(body, HM_HLOPCODE_STLOC, 0, sizeof(hm_uint16));
+    for (hm_nint i = 0; i < BENCHMARK_REPEAT_COUNT; i++) {
+        emit(body, HM_HLOPCODE_LDLOC, 0, sizeof(hm_uint16));
+        emit(body, HM_HLOPCODE_STLOC, 1, sizeof(hm_uint16));
+        emit(body, HM_HLOPCODE_LDLOC, 1, sizeof(hm_uint16));
+        emit(body, HM_HLOPCODE_STLOC, 0, sizeof(hm_uint16));
+    }
+    emit(body, HM_HLOPCODE_LDLOC, 0, sizeof(hm_uint16));
+    add_method(context, "moves", &moves_signature, body);
+}
+
+/* Loading constants (`pop` compiles to nothing). */
+static void benchmark_constants(hmBenchmarkContext* context, hmBenchmarkBody* body)
+{
+    for (hm_nint i = 0; i < BENCHMARK_REPEAT_COUNT; i++) {
+        emit(body, HM_HLOPCODE_LDC32, i, sizeof(hm_uint32));
+        emit(body, HM_HLOPCODE_POP, 0, 0);
+        emit(body, HM_HLOPCODE_LDC64, i, sizeof(hm_uint64));
+        emit(body, HM_HLOPCODE_POP, 0, 0);
+    }
+    add_method(context, "constants", &void_signature, body);
+}
+
+/* Calls of a trivial method (ldc.32 + call are fused into a superinstruction). The instructions of the callee count too. */
+static void benchmark_calls(hmBenchmarkContext* context, hmBenchmarkBody* body)
+{
+    hmBenchmarkBody* leaf_body = (hmBenchmarkBody*)hmAlloc(context->allocator, sizeof(hmBenchmarkBody));
+    BENCHMARK_CHECK(leaf_body ? HM_OK : HM_ERROR_OUT_OF_MEMORY);
+    leaf_body->size = 0;
+    leaf_body->instruction_count = 0;
+    emit(leaf_body, HM_HLOPCODE_LDARG, 0, sizeof(hm_uint16));
+    hm_metadata_id leaf_id = add_method(context, "leaf", &leaf_signature, leaf_body);
+    for (hm_nint i = 0; i < BENCHMARK_REPEAT_COUNT; i++) {
+        emit(body, HM_HLOPCODE_LDC32, i, sizeof(hm_uint32));
+        emit(body, HM_HLOPCODE_CALL, leaf_id, sizeof(hm_uint32));
+        emit(body, HM_HLOPCODE_POP, 0, 0);
+    }
+    body->instruction_count += BENCHMARK_REPEAT_COUNT * leaf_body->instruction_count;
+    hmFree(context->allocator, leaf_body);
+    add_method(context, "calls", &void_signature, body);
+}
+
+static void run_benchmark(const char* name, hmBenchmarkFunc benchmark_func, hm_bool use_jit)
+{
+    hmAllocator allocator;
+    BENCHMARK_CHECK(hmCreateSystemAllocator(&allocator));
+    hmBenchmarkContext* context = (hmBenchmarkContext*)hmAlloc(&allocator, sizeof(hmBenchmarkContext));
+    hmBenchmarkBody* body = (hmBenchmarkBody*)hmAlloc(&allocator, sizeof(hmBenchmarkBody));
+    BENCHMARK_CHECK(context && body ? HM_OK : HM_ERROR_OUT_OF_MEMORY);
+    context->allocator = &allocator;
+    context->method_count = 0;
+    BENCHMARK_CHECK(hmCreateJit(&allocator, HM_JIT_DEFAULT_CODE_HEAP_CAPACITY, 0, &context->jit));
+    BENCHMARK_CHECK(hmCreateInterpreter(
+        &allocator,
+        HM_INTERPRETER_DEFAULT_REGISTER_COUNT,
+        HM_INTERPRETER_DEFAULT_FRAME_COUNT,
+        use_jit ? &context->jit : HM_NULL,
+        HM_NULL, /* all the methods are compiled beforehand */
+        HM_NULL,
+        &context->interpreter
+    ));
+    body->size = 0;
+    body->instruction_count = 0;
+    benchmark_func(context, body);
+    hmMethod* method = &context->methods[context->method_count - 1]; /* The benchmark's method is added last. */
+    hm_uint64 args[] = { 1 };
+    hm_uint64 result;
+    hm_millis start_time = hmGetTickCount();
+    for (hm_nint i = 0; i < BENCHMARK_RUN_COUNT; i++) {
+        BENCHMARK_CHECK(hmInterpreterRun(&context->interpreter, method, args, &result));
+    }
+    hm_millis elapsed_time = hmGetTickCount() - start_time;
+    double instruction_count = (double)body->instruction_count * BENCHMARK_RUN_COUNT;
+    printf(
+        "%-12s %-6s %8d ms %8.3f ns/instruction\n",
+        name,
+        use_jit ? "jit" : "interp",
+        (int)elapsed_time,
+        (double)elapsed_time * 1000000.0 / instruction_count
+    );
+    BENCHMARK_CHECK(hmInterpreterDispose(&context->interpreter));
+    BENCHMARK_CHECK(hmJitDispose(&context->jit));
+    for (hm_nint i = 0; i < context->method_count; i++) {
+        BENCHMARK_CHECK(hmMethodDispose(&context->methods[i]));
+    }
+    hmFree(&allocator, body);
+    hmFree(&allocator, context);
+    BENCHMARK_CHECK(hmAllocatorDispose(&allocator));
+}
+
+#define RUN_BENCHMARK(name) \
+    if (argc < 2 || strcmp(argv[1], #name) == 0) \
+    { \
+        run_benchmark(#name, &benchmark_ ## name, HM_FALSE); \
+        run_benchmark(#name, &benchmark_ ## name, HM_TRUE); \
+    }
+
+int main(int argc, char** argv)
+{
+    RUN_BENCHMARK(moves)
+    RUN_BENCHMARK(constants)
+    RUN_BENCHMARK(calls)
+    return 0;
+}
@@ -320,6 +320,32 @@ HM_TEST_ON_FINALIZE
     }
 }
 
+static void test_can_remove_last_array_item()
+{
+    hmAllocator allocator;
+    hmArray array;
+    create_array_and_allocator(&array, &allocator, HM_NULL);
+    for (hm_nint i = 0; i < ARRAY_CAPACITY * 2 + 1; i++) {
+        testItem test_item;
+        test_item.x = i * 10;
+        test_item.y = i * 20;
+        hmError err = hmArrayAdd(&array, &test_item);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+    }
+    for (hm_nint i = ARRAY_CAPACITY * 2 + 1; i > 0; i--) {
+        testItem test_item;
+        hmError err = hmArrayRemoveLast(&array, &test_item);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(test_item.x == (i - 1) * 10 && test_item.y == (i - 1) * 20);
+        HM_TEST_ASSERT(hmArrayGetCount(&array) == i - 1);
+    }
+    testItem test_item;
+    hmError err = hmArrayRemoveLast(&array, &test_item);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+HM_TEST_ON_FINALIZE
+    dispose_array_and_allocator(&array, &allocator);
+}
+
 typedef struct {
     hm_nint count;
 } array_sort_context;
@@ -439,6 +465,7 @@ HM_TEST_SUITE_BEGIN(arrays)
     HM_TEST_RUN(test_can_add_range_to_array)
     HM_TEST_RUN(test_can_add_range_to_array_with_new_count_exceeding_capacity_greater_than_growth_factor)
     HM_TEST_RUN(test_can_clear_array)
+    HM_TEST_RUN(test_can_remove_last_array_item)
     HM_TEST_RUN_WITHOUT_OOM(test_can_sort_array) /* Sorting is in-place, so avoid testing memory allocations. */
     HM_TEST_RUN_WITHOUT_OOM(test_can_sort_arrays_with_0_and_1_items)
     HM_TEST_RUN_WITHOUT_OOM(test_can_sort_string_array)
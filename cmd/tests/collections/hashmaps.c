@@ -203,6 +203,35 @@ HM_TEST_ON_FINALIZE
     dispose_hash_map_and_allocator(&hash_map, &allocator);
 }
 
+static void test_hash_map_can_be_cleared()
+{
+    hmAllocator allocator;
+    hmHashMap hash_map;
+    create_string_hash_map_and_allocator_with_dispose_func(&hash_map, &allocator);
+    for (hm_nint round = 0; round < 2; round++) { /* The map is usable after clearing. */
+        for (hm_nint i = 0; i < SMALL_ITERATION_COUNT; i++) {
+            hmString str_key, str_value;
+            hmError err = hmInt32ToString(&allocator, (hm_int32)i, &str_key);
+            HM_TEST_ASSERT_OK_OR_OOM(err);
+            err = hmInt32ToString(&allocator, (hm_int32)(i * 2), &str_value);
+            HM_TEST_ASSERT_OK_OR_OOM(err);
+            err = hmHashMapPut(&hash_map, &str_key, &str_value);
+            HM_TEST_ASSERT_OK_OR_OOM(err);
+        }
+        HM_TEST_ASSERT(hmHashMapGetCount(&hash_map) == SMALL_ITERATION_COUNT);
+        /* Disposes of the keys and the values: otherwise, the allocator would report leaks. */
+        hmError err = hmHashMapClear(&hash_map);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(hmHashMapGetCount(&hash_map) == 0);
+        hmString str_key;
+        err = hmCreateStringViewFromCString("0", &str_key);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(!hmHashMapContains(&hash_map, &str_key));
+    }
+HM_TEST_ON_FINALIZE
+    dispose_hash_map_and_allocator(&hash_map, &allocator);
+}
+
 static void test_can_put_remove_and_get_strings_from_hash_map_with_dispose_func()
 {
     hmAllocator allocator;
@@ -337,6 +366,7 @@ HM_TEST_SUITE_BEGIN(hash_maps)
     HM_TEST_RUN(test_hash_map_returns_error_on_non_existing_key)
     HM_TEST_RUN(test_hash_map_reports_nothing_was_removed)
     HM_TEST_RUN(test_hash_map_reports_correct_count)
+    HM_TEST_RUN(test_hash_map_can_be_cleared)
     HM_TEST_RUN_WITHOUT_OOM(test_can_put_remove_and_get_strings_from_hash_map_with_dispose_func) /* without OOM: takes too much time */
     HM_TEST_RUN(test_can_put_remove_and_get_strings_from_hash_map_without_hash_equals_funcs)
     HM_TEST_RUN(test_hash_map_can_get_value_by_ref)
@@ -0,0 +1,237 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <collections/timerwheel.h>
+
+#define SMALL_TIMER_COUNT 10
+#define LARGE_TIMER_COUNT 10000
+#define FAR_EXPIRY_TICK   (20*1000*1000) /* Beyond the range of the top level (64^4 ticks). */
+
+typedef struct {
+    hmTimerWheel* timer_wheel;
+    hm_nint       expired_count;
+    hm_uint64     last_expiry_tick;
+} expireContext;
+
+static hm_nint item_dispose_count = 0;
+
+static hmError item_dispose_func(void* obj)
+{
+    item_dispose_count++;
+    return HM_OK;
+}
+
+/* Items are the expiry ticks of their timers. */
+static hmError expire_func(void* item, void* user_data)
+{
+    expireContext* context = (expireContext*)user_data;
+    hm_uint64 expiry_tick = *(hm_uint64*)item;
+    HM_TEST_ASSERT(expiry_tick == hmTimerWheelGetCurrentTick(context->timer_wheel));
+    HM_TEST_ASSERT(expiry_tick >= context->last_expiry_tick);
+    context->last_expiry_tick = expiry_tick;
+    context->expired_count++;
+    return HM_OK;
+}
+
+static void init_expire_context(hmTimerWheel* timer_wheel, expireContext* context)
+{
+    context->timer_wheel = timer_wheel;
+    context->expired_count = 0;
+    context->last_expiry_tick = 0;
+}
+
+static void test_timer_wheel_expires_timers_at_their_ticks()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmTimerWheel timer_wheel;
+    hmError err = hmCreateTimerWheel(&allocator, sizeof(hm_uint64), HM_NULL, &timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    expireContext context;
+    init_expire_context(&timer_wheel, &context);
+    /* Covers the first three levels. */
+    for (hm_nint i = 0; i < SMALL_TIMER_COUNT; i++) {
+        hm_uint64 expiry_tick = (hm_uint64)((i * 7919) % 300000 + 1);
+        err = hmTimerWheelAdd(&timer_wheel, expiry_tick, &expiry_tick, HM_NULL);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+    }
+    err = hmTimerWheelAdvance(&timer_wheel, 300000, &expire_func, &context);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(context.expired_count == SMALL_TIMER_COUNT);
+    HM_TEST_ASSERT(hmTimerWheelGetCount(&timer_wheel) == 0);
+    /* Timers in the past expire on the next tick. */
+    hm_uint64 next_tick = 300001;
+    err = hmTimerWheelAdd(&timer_wheel, 1, &next_tick, HM_NULL);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmTimerWheelAdvance(&timer_wheel, next_tick, &expire_func, &context);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(context.expired_count == SMALL_TIMER_COUNT + 1);
+HM_TEST_ON_FINALIZE
+    err = hmTimerWheelDispose(&timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_timer_wheel_handles_many_far_timers()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmTimerWheel timer_wheel;
+    hmError err = hmCreateTimerWheel(&allocator, sizeof(hm_uint64), HM_NULL, &timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    expireContext context;
+    init_expire_context(&timer_wheel, &context);
+    for (hm_nint i = 0; i < LARGE_TIMER_COUNT; i++) {
+        hm_uint64 expiry_tick = i % 2 ? (hm_uint64)(i * 104729) % FAR_EXPIRY_TICK + 1 : FAR_EXPIRY_TICK + i;
+        err = hmTimerWheelAdd(&timer_wheel, expiry_tick, &expiry_tick, HM_NULL);
+        HM_TEST_ASSERT_OK(err);
+    }
+    /* Advancing in uneven steps must be the same as advancing tick by tick. */
+    hm_uint64 tick = 0;
+    while (tick < FAR_EXPIRY_TICK + LARGE_TIMER_COUNT) {
+        tick += 999983;
+        err = hmTimerWheelAdvance(&timer_wheel, tick, &expire_func, &context);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(context.expired_count == LARGE_TIMER_COUNT);
+    HM_TEST_ASSERT(hmTimerWheelGetCount(&timer_wheel) == 0);
+    err = hmTimerWheelDispose(&timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_timer_wheel_can_cancel_timers()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmTimerWheel timer_wheel;
+    hmError err = hmCreateTimerWheel(&allocator, sizeof(hm_uint64), &item_dispose_func, &timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    item_dispose_count = 0;
+    expireContext context;
+    init_expire_context(&timer_wheel, &context);
+    hmTimer timers[SMALL_TIMER_COUNT];
+    for (hm_nint i = 0; i < SMALL_TIMER_COUNT; i++) {
+        hm_uint64 expiry_tick = (hm_uint64)(i * 100 + 1);
+        err = hmTimerWheelAdd(&timer_wheel, expiry_tick, &expiry_tick, &timers[i]);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+    }
+    for (hm_nint i = 0; i < SMALL_TIMER_COUNT; i += 2) {
+        err = hmTimerWheelCancel(&timer_wheel, &timers[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(item_dispose_count == SMALL_TIMER_COUNT / 2);
+    HM_TEST_ASSERT(hmTimerWheelGetCount(&timer_wheel) == SMALL_TIMER_COUNT / 2);
+    err = hmTimerWheelCancel(&timer_wheel, &timers[0]);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    /* The node of a cancelled timer is reused, but the old handle stays invalid. */
+    hm_uint64 expiry_tick = 1;
+    hmTimer reused_timer;
+    err = hmTimerWheelAdd(&timer_wheel, expiry_tick, &expiry_tick, &reused_timer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(reused_timer.node == timers[SMALL_TIMER_COUNT - 2].node);
+    err = hmTimerWheelCancel(&timer_wheel, &timers[SMALL_TIMER_COUNT - 2]);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    err = hmTimerWheelAdvance(&timer_wheel, SMALL_TIMER_COUNT * 100, &expire_func, &context);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(context.expired_count == SMALL_TIMER_COUNT / 2 + 1);
+    /* Expired timers can't be cancelled. */
+    err = hmTimerWheelCancel(&timer_wheel, &timers[1]);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    HM_TEST_ASSERT(item_dispose_count == SMALL_TIMER_COUNT / 2);
+HM_TEST_ON_FINALIZE
+    err = hmTimerWheelDispose(&timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_timer_wheel_returns_next_expiry()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmTimerWheel timer_wheel;
+    hmError err = hmCreateTimerWheel(&allocator, sizeof(hm_uint64), HM_NULL, &timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    expireContext context;
+    init_expire_context(&timer_wheel, &context);
+    hm_uint64 next_tick = 0;
+    err = hmTimerWheelGetNextExpiry(&timer_wheel, &next_tick);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    const hm_uint64 expiry_ticks[] = { 100, 300000, 5 };
+    for (hm_nint i = 0; i < sizeof(expiry_ticks) / sizeof(expiry_ticks[0]); i++) {
+        hm_uint64 expiry_tick = expiry_ticks[i];
+        err = hmTimerWheelAdd(&timer_wheel, expiry_tick, &expiry_tick, HM_NULL);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+    }
+    err = hmTimerWheelGetNextExpiry(&timer_wheel, &next_tick);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(next_tick == 5);
+    err = hmTimerWheelAdvance(&timer_wheel, 60, &expire_func, &context);
+    HM_TEST_ASSERT_OK(err);
+    /* Tick 110 goes to the lowest level, while tick 100 (which is earlier) hasn't been cascaded from the upper level yet:
+       the next tick is when its slot is cascaded. */
+    hm_uint64 expiry_tick = 110;
+    err = hmTimerWheelAdd(&timer_wheel, expiry_tick, &expiry_tick, HM_NULL);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmTimerWheelGetNextExpiry(&timer_wheel, &next_tick);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(next_tick == 64);
+    /* Sleeping from one next tick to another never skips a timer, and takes only a few wake-ups. */
+    const hm_uint64 pending_ticks[] = { 100, 110, 300000 };
+    hm_nint wake_up_count = 0;
+    while ((err = hmTimerWheelGetNextExpiry(&timer_wheel, &next_tick)) == HM_OK) {
+        HM_TEST_ASSERT(next_tick > hmTimerWheelGetCurrentTick(&timer_wheel));
+        HM_TEST_ASSERT(next_tick <= pending_ticks[context.expired_count - 1]);
+        err = hmTimerWheelAdvance(&timer_wheel, next_tick, &expire_func, &context);
+        HM_TEST_ASSERT_OK(err);
+        wake_up_count++;
+    }
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    HM_TEST_ASSERT(context.expired_count == 4);
+    HM_TEST_ASSERT(context.last_expiry_tick == 300000);
+    HM_TEST_ASSERT(wake_up_count < 4 * HM_TIMER_WHEEL_LEVEL_COUNT);
+HM_TEST_ON_FINALIZE
+    err = hmTimerWheelDispose(&timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_timer_wheel_disposes_pending_items()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmTimerWheel timer_wheel;
+    hmError err = hmCreateTimerWheel(&allocator, sizeof(hm_uint64), &item_dispose_func, &timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    item_dispose_count = 0;
+    for (hm_nint i = 0; i < SMALL_TIMER_COUNT; i++) {
+        hm_uint64 expiry_tick = (hm_uint64)(i * 5000);
+        err = hmTimerWheelAdd(&timer_wheel, expiry_tick, &expiry_tick, HM_NULL);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmTimerWheelDispose(&timer_wheel);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(item_dispose_count == SMALL_TIMER_COUNT);
+    err = hmCreateTimerWheel(&allocator, HM_TIMER_WHEEL_MAX_ITEM_SIZE + 1, HM_NULL, &timer_wheel);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(timer_wheels)
+    HM_TEST_RUN(test_timer_wheel_expires_timers_at_their_ticks)
+    HM_TEST_RUN_WITHOUT_OOM(test_timer_wheel_handles_many_far_timers)
+    HM_TEST_RUN(test_timer_wheel_can_cancel_timers)
+    HM_TEST_RUN(test_timer_wheel_returns_next_expiry)
+    HM_TEST_RUN_WITHOUT_OOM(test_timer_wheel_disposes_pending_items)
+HM_TEST_SUITE_END()
@@ -137,6 +137,39 @@ static void test_bump_pointer_allocator_works_with_large_objects()
     dispose_allocator(&system_allocator);
 }
 
+static void test_bump_pointer_allocator_can_be_reset()
+{
+    hmAllocator system_allocator, stats_allocator, bump_pointer_allocator;
+    create_system_allocator(&system_allocator);
+    hmError err = hmCreateStatsAllocator(&system_allocator, &stats_allocator);
+    HM_TEST_ASSERT_OK(err);
+    /* The limit is enough for one round of allocations, but not for two. */
+    err = hmCreateBumpPointerAllocator(&stats_allocator, HM_BUMP_POINTER_ALLOCATOR_SEGMENT_SIZE * 3, &bump_pointer_allocator);
+    HM_TEST_ASSERT_OK(err);
+    hm_nint first_round_alloc_count = 0;
+    for (hm_nint round = 0; round < 3; round++) {
+        hm_nint alloc_count_before_round = hmStatsAllocatorGetTotalCount(&stats_allocator);
+        for (hm_nint i = 0; i < 4; i++) { /* Spans several segments. */
+            void* mem = hmAlloc(&bump_pointer_allocator, HM_BUMP_POINTER_ALLOCATOR_SEGMENT_SIZE / 2 - 1);
+            HM_TEST_ASSERT(mem != HM_NULL);
+            touch_memory(mem, HM_BUMP_POINTER_ALLOCATOR_SEGMENT_SIZE / 2 - 1);
+        }
+        void* large_mem = hmAlloc(&bump_pointer_allocator, HM_BUMP_POINTER_ALLOCATOR_SEGMENT_SIZE);
+        HM_TEST_ASSERT(large_mem != HM_NULL);
+        touch_memory(large_mem, HM_BUMP_POINTER_ALLOCATOR_SEGMENT_SIZE);
+        hm_nint alloc_count = hmStatsAllocatorGetTotalCount(&stats_allocator) - alloc_count_before_round;
+        if (round == 0) {
+            first_round_alloc_count = alloc_count;
+        } else { /* The segment kept after the reset is reused. */
+            HM_TEST_ASSERT(alloc_count == first_round_alloc_count - 1);
+        }
+        hmBumpPointerAllocatorReset(&bump_pointer_allocator);
+    }
+    dispose_allocator(&bump_pointer_allocator);
+    dispose_allocator(&stats_allocator);
+    dispose_allocator(&system_allocator);
+}
+
 static void test_stats_allocator_keeps_track_of_alloc_count()
 {
     hmAllocator system_allocator;
@@ -328,6 +361,7 @@ HM_TEST_SUITE_BEGIN(allocators)
     HM_TEST_RUN_WITHOUT_OOM(test_realloc_accepts_smaller_size)
     HM_TEST_RUN_WITHOUT_OOM(test_bump_pointer_allocator_works_with_small_objects)
     HM_TEST_RUN_WITHOUT_OOM(test_bump_pointer_allocator_works_with_large_objects)
+    HM_TEST_RUN_WITHOUT_OOM(test_bump_pointer_allocator_can_be_reset)
     HM_TEST_RUN_WITHOUT_OOM(test_stats_allocator_keeps_track_of_alloc_count)
     HM_TEST_RUN_WITHOUT_OOM(test_oom_allocator_returns_out_of_memory)
     HM_TEST_RUN_WITHOUT_OOM(test_can_allocate_from_buffer_allocator)
@@ -82,10 +82,31 @@ HM_TEST_ON_FINALIZE
     HM_TEST_DEINIT_ALLOC(&allocator);
 }
 
+static void test_can_get_available_processors()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmArray processors;
+    hmError err = hmGetAvailableProcessors(&allocator, &processors);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmArrayGetCount(&processors) > 0);
+    hmProcessorInfo* processor_infos = hmArrayGetRaw(&processors, hmProcessorInfo);
+    for (hm_nint i = 1; i < hmArrayGetCount(&processors); i++) {
+        HM_TEST_ASSERT(processor_infos[i].index > processor_infos[i - 1].index);
+    }
+HM_TEST_ON_FINALIZE
+    if (err == HM_OK) {
+        err = hmArrayDispose(&processors);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
 HM_TEST_SUITE_BEGIN(environment)
     HM_TEST_RUN_WITHOUT_OOM(test_tick_count_grows_monotonically)
     HM_TEST_RUN_WITHOUT_OOM(test_can_get_processor_count)
     HM_TEST_RUN_WITHOUT_OOM(test_can_get_available_memory)
+    HM_TEST_RUN(test_can_get_available_processors)
     HM_TEST_RUN(test_can_get_executable_file_path)
     HM_TEST_RUN(test_can_get_os_version)
 HM_TEST_SUITE_END()
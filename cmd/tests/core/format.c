@@ -0,0 +1,124 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <core/format.h>
+
+#include <stdlib.h> /* for strtod(..) */
+#include <string.h> /* for strcmp(..), memcmp(..) */
+
+static hm_bool format_equals(hm_nint (*format_func)(hm_uint64, char*), hm_uint64 value, const char* expected)
+{
+    char buffer[HM_FORMAT_BUFFER_SIZE + 1];
+    hm_nint length = format_func(value, buffer);
+    buffer[length] = '\0';
+    return strcmp(buffer, expected) == 0;
+}
+
+static hm_bool int64_format_equals(hm_int64 value, const char* expected)
+{
+    char buffer[HM_FORMAT_BUFFER_SIZE + 1];
+    hm_nint length = hmFormatInt64(value, buffer);
+    buffer[length] = '\0';
+    return strcmp(buffer, expected) == 0;
+}
+
+static hm_bool float64_format_equals(hm_float64 value, const char* expected)
+{
+    char buffer[HM_FORMAT_BUFFER_SIZE + 1];
+    hm_nint length = hmFormatFloat64(value, buffer);
+    buffer[length] = '\0';
+    return strcmp(buffer, expected) == 0;
+}
+
+static void test_can_format_uint64()
+{
+    HM_TEST_ASSERT(format_equals(hmFormatUint64, 0, "0"));
+    HM_TEST_ASSERT(format_equals(hmFormatUint64, 7, "7"));
+    HM_TEST_ASSERT(format_equals(hmFormatUint64, 10, "10"));
+    HM_TEST_ASSERT(format_equals(hmFormatUint64, 999, "999"));
+    HM_TEST_ASSERT(format_equals(hmFormatUint64, 10000, "10000"));
+    HM_TEST_ASSERT(format_equals(hmFormatUint64, 1234567890, "1234567890"));
+    HM_TEST_ASSERT(format_equals(hmFormatUint64, HM_UINT64_MAX, "18446744073709551615"));
+}
+
+static void test_can_format_int64()
+{
+    HM_TEST_ASSERT(int64_format_equals(0, "0"));
+    HM_TEST_ASSERT(int64_format_equals(-1, "-1"));
+    HM_TEST_ASSERT(int64_format_equals(42, "42"));
+    HM_TEST_ASSERT(int64_format_equals(-12345, "-12345"));
+    HM_TEST_ASSERT(int64_format_equals(HM_INT64_MAX, "9223372036854775807"));
+    HM_TEST_ASSERT(int64_format_equals(HM_INT64_MIN, "-9223372036854775808"));
+}
+
+static void test_can_format_hex()
+{
+    HM_TEST_ASSERT(format_equals(hmFormatHex, 0, "0"));
+    HM_TEST_ASSERT(format_equals(hmFormatHex, 0xA, "a"));
+    HM_TEST_ASSERT(format_equals(hmFormatHex, 0x10, "10"));
+    HM_TEST_ASSERT(format_equals(hmFormatHex, 0xDEADBEEF, "deadbeef"));
+    HM_TEST_ASSERT(format_equals(hmFormatHex, HM_UINT64_MAX, "ffffffffffffffff"));
+}
+
+static void test_can_format_float64()
+{
+    HM_TEST_ASSERT(float64_format_equals(0.0, "0"));
+    HM_TEST_ASSERT(float64_format_equals(-0.0, "-0"));
+    HM_TEST_ASSERT(float64_format_equals(1.0, "1"));
+    HM_TEST_ASSERT(float64_format_equals(-2.5, "-2.5"));
+    HM_TEST_ASSERT(float64_format_equals(0.1, "0.1"));
+    HM_TEST_ASSERT(float64_format_equals(0.3, "0.3"));
+    HM_TEST_ASSERT(float64_format_equals(2.0 / 3.0, "0.6666666666666666"));
+    HM_TEST_ASSERT(float64_format_equals(123456.0, "123456"));
+    HM_TEST_ASSERT(float64_format_equals(1e20, "100000000000000000000"));
+    HM_TEST_ASSERT(float64_format_equals(1e21, "1e+21"));
+    HM_TEST_ASSERT(float64_format_equals(0.000001, "0.000001"));
+    HM_TEST_ASSERT(float64_format_equals(1.5e-7, "1.5e-7"));
+    HM_TEST_ASSERT(float64_format_equals(5e-324, "5e-324")); /* the smallest subnormal */
+    HM_TEST_ASSERT(float64_format_equals(1.7976931348623157e308, "1.7976931348623157e+308"));
+    hm_float64 zero = 0.0;
+    HM_TEST_ASSERT(float64_format_equals(1.0 / zero, "Infinity"));
+    HM_TEST_ASSERT(float64_format_equals(-1.0 / zero, "-Infinity"));
+    HM_TEST_ASSERT(float64_format_equals(zero / zero, "NaN"));
+}
+
+static void test_formatted_float64_parses_back_to_same_value()
+{
+    /* A simple xorshift generator to cover random bit patterns (including subnormals) deterministically. */
+    hm_uint64 state = 88172645463325252u;
+    char buffer[HM_FORMAT_BUFFER_SIZE + 1];
+    for (hm_nint i = 0; i < 100000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (((state >> 52) & 0x7FF) == 0x7FF) { /* NaNs and infinities are checked in another test */
+            continue;
+        }
+        hm_float64 value = 0;
+        memcpy(&value, &state, sizeof(hm_float64));
+        hm_nint length = hmFormatFloat64(value, buffer);
+        HM_TEST_ASSERT(length <= HM_FORMAT_BUFFER_SIZE);
+        buffer[length] = '\0';
+        hm_float64 parsed_value = strtod(buffer, HM_NULL);
+        HM_TEST_ASSERT(memcmp(&parsed_value, &value, sizeof(hm_float64)) == 0);
+    }
+}
+
+HM_TEST_SUITE_BEGIN(format)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_format_uint64)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_format_int64)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_format_hex)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_format_float64)
+    HM_TEST_RUN_WITHOUT_OOM(test_formatted_float64_parses_back_to_same_value)
+HM_TEST_SUITE_END()
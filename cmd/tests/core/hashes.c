@@ -20,17 +20,87 @@ static void test_can_hash_empty_array()
 {
     char bytes[1];
     hm_uint32 hash = hmHash(bytes, 0, HASH_SALT);
-    HM_TEST_ASSERT(hash == 13); /* precomputed */
+    HM_TEST_ASSERT(hash == 2830254296); /* precomputed */
 }
 
 static void test_can_hash_non_empty_array()
 {
     char bytes[8] = {'0', '1', '2', '3', '4', '5', '6', '7'};
     hm_uint32 hash = hmHash(bytes, sizeof(char) * 8, HASH_SALT);
-    HM_TEST_ASSERT(hash == 1793922114); /* precomputed */
+    HM_TEST_ASSERT(hash == 317272554); /* precomputed */
+}
+
+static void test_can_hash_non_empty_array_64()
+{
+    char bytes[8] = {'0', '1', '2', '3', '4', '5', '6', '7'};
+    hm_uint64 hash = hmHash64(bytes, sizeof(char) * 8, HASH_SALT);
+    HM_TEST_ASSERT(hash == 10311215568282319367ull); /* precomputed */
+}
+
+static void test_different_salts_produce_different_hashes()
+{
+    char bytes[64] = {0};
+    HM_TEST_ASSERT(hmHash64(bytes, 0, HASH_SALT) != hmHash64(bytes, 0, HASH_SALT + 1));
+    HM_TEST_ASSERT(hmHash64(bytes, 8, HASH_SALT) != hmHash64(bytes, 8, HASH_SALT + 1));
+    HM_TEST_ASSERT(hmHash64(bytes, 64, HASH_SALT) != hmHash64(bytes, 64, HASH_SALT + 1));
+}
+
+static void test_hasher_produces_same_hash_as_one_shot_hashing()
+{
+    hm_uint8 bytes[200];
+    for (hm_nint i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = (hm_uint8)(i * 7 + 3);
+    }
+    /* Covers empty input, inputs shorter than a block, exactly one block, and many blocks with uneven splits. */
+    for (hm_nint size = 0; size <= sizeof(bytes); size++) {
+        hm_uint64 expected_hash = hmHash64(bytes, size, HASH_SALT);
+        for (hm_nint piece_size = 1; piece_size <= 40; piece_size += 13) {
+            hmHasher hasher;
+            HM_TEST_ASSERT_OK(hmCreateHasher(HASH_SALT, &hasher));
+            for (hm_nint offset = 0; offset < size; offset += piece_size) {
+                hm_nint remaining_size = size - offset;
+                hmHasherUpdate(&hasher, bytes + offset, remaining_size < piece_size ? remaining_size : piece_size);
+            }
+            HM_TEST_ASSERT(hmHasherGetHash(&hasher) == expected_hash);
+            HM_TEST_ASSERT_OK(hmHasherDispose(&hasher));
+        }
+    }
+}
+
+static void test_hasher_can_be_queried_in_the_middle()
+{
+    char bytes[8] = {'0', '1', '2', '3', '4', '5', '6', '7'};
+    hmHasher hasher;
+    HM_TEST_ASSERT_OK(hmCreateHasher(HASH_SALT, &hasher));
+    hmHasherUpdate(&hasher, bytes, 4);
+    HM_TEST_ASSERT(hmHasherGetHash(&hasher) == hmHash64(bytes, 4, HASH_SALT));
+    hmHasherUpdate(&hasher, bytes + 4, 4);
+    HM_TEST_ASSERT(hmHasherGetHash(&hasher) == hmHash64(bytes, 8, HASH_SALT));
+    HM_TEST_ASSERT_OK(hmHasherDispose(&hasher));
+}
+
+static void test_can_hash_many_keys()
+{
+    hm_uint64 keys[16];
+    hm_uint64 hashes[16];
+    for (hm_nint i = 0; i < 16; i++) {
+        keys[i] = i * 1000;
+    }
+    hmHash64Many(keys, sizeof(hm_uint64), 16, HASH_SALT, hashes);
+    for (hm_nint i = 0; i < 16; i++) {
+        HM_TEST_ASSERT(hashes[i] == hmHash64(&keys[i], sizeof(hm_uint64), HASH_SALT));
+        if (i > 0) {
+            HM_TEST_ASSERT(hashes[i] != hashes[i - 1]);
+        }
+    }
 }
 
 HM_TEST_SUITE_BEGIN(hashes)
     HM_TEST_RUN_WITHOUT_OOM(test_can_hash_empty_array)
     HM_TEST_RUN_WITHOUT_OOM(test_can_hash_non_empty_array)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_hash_non_empty_array_64)
+    HM_TEST_RUN_WITHOUT_OOM(test_different_salts_produce_different_hashes)
+    HM_TEST_RUN_WITHOUT_OOM(test_hasher_produces_same_hash_as_one_shot_hashing)
+    HM_TEST_RUN_WITHOUT_OOM(test_hasher_can_be_queried_in_the_middle)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_hash_many_keys)
 HM_TEST_SUITE_END()
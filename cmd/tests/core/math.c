@@ -157,6 +157,17 @@ static void test_abs()
     HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
 }
 
+static void test_can_multiply_uint64_without_losing_high_bits()
+{
+    hm_uint64 high = 0;
+    hm_uint64 low = hmMulUint64Wide(3, 5, &high);
+    HM_TEST_ASSERT(low == 15 && high == 0);
+    low = hmMulUint64Wide(HM_UINT64_MAX, HM_UINT64_MAX, &high);
+    HM_TEST_ASSERT(low == 1 && high == HM_UINT64_MAX - 1);
+    low = hmMulUint64Wide(1ull << 63, 4, &high);
+    HM_TEST_ASSERT(low == 0 && high == 2);
+}
+
 HM_TEST_SUITE_BEGIN(math)
     HM_TEST_RUN_WITHOUT_OOM(test_detects_nint_overflow_when_adding)
     HM_TEST_RUN_WITHOUT_OOM(test_detects_nint_overflow_when_multiplying)
@@ -165,4 +176,5 @@ HM_TEST_SUITE_BEGIN(math)
     HM_TEST_RUN_WITHOUT_OOM(test_detects_millis_overflow_when_adding)
     HM_TEST_RUN_WITHOUT_OOM(test_detects_underflow_when_subtracting)
     HM_TEST_RUN_WITHOUT_OOM(test_abs)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_multiply_uint64_without_losing_high_bits)
 HM_TEST_SUITE_END()
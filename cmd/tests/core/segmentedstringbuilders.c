@@ -0,0 +1,178 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <core/segmentedstringbuilder.h>
+#include <core/string.h>
+
+#include <string.h> /* for memcmp(..) */
+
+#define SEGMENT_SIZE 4
+
+static void test_can_create_segmented_string_builder_append_and_convert_to_string()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmSegmentedStringBuilder string_builder;
+    hmError err = hmCreateSegmentedStringBuilder(&allocator, SEGMENT_SIZE, &string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "He");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "llo, ");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderAppendCStringWithLength(&string_builder, "World!!!", 6);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmSegmentedStringBuilderGetLengthInBytes(&string_builder) == 13);
+    hmString string;
+    err = hmSegmentedStringBuilderToString(&string_builder, HM_NULL, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "Hello, World!"));
+    HM_TEST_ASSERT(hmStringGetLengthInBytes(&string) == 13);
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmSegmentedStringBuilderGetLengthInBytes(&string_builder) == 13);
+HM_TEST_ON_FINALIZE
+    err = hmSegmentedStringBuilderDispose(&string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_segmented_string_builder_exposes_segments()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmSegmentedStringBuilder string_builder;
+    hmError err = hmCreateSegmentedStringBuilder(&allocator, SEGMENT_SIZE, &string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "abc");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "defg");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "0123456789");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    /* The first segment is filled up, the rest goes to new segments; large content goes to a single segment. */
+    HM_TEST_ASSERT(hmSegmentedStringBuilderGetSegmentCount(&string_builder) == 3);
+    const hmStringSegment* segments = hmSegmentedStringBuilderGetSegments(&string_builder);
+    HM_TEST_ASSERT(segments[0].length_in_bytes == 4 && memcmp(segments[0].chars, "abcd", 4) == 0);
+    HM_TEST_ASSERT(segments[1].length_in_bytes == 4 && memcmp(segments[1].chars, "efg0", 4) == 0);
+    HM_TEST_ASSERT(segments[2].length_in_bytes == 9 && memcmp(segments[2].chars, "123456789", 9) == 0);
+HM_TEST_ON_FINALIZE
+    err = hmSegmentedStringBuilderDispose(&string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_can_steal_string_from_segmented_string_builder_with_one_segment()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmSegmentedStringBuilder string_builder;
+    hmError err = hmCreateSegmentedStringBuilder(&allocator, HM_SEGMENTED_STRING_BUILDER_DEFAULT_SEGMENT_SIZE, &string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "Hello, World!");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    const char* segment_chars = hmSegmentedStringBuilderGetSegments(&string_builder)[0].chars;
+    hmString string;
+    err = hmSegmentedStringBuilderStealString(&string_builder, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringGetChars(&string) == segment_chars); /* no copying */
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "Hello, World!"));
+    HM_TEST_ASSERT(hmSegmentedStringBuilderGetLengthInBytes(&string_builder) == 0);
+    HM_TEST_ASSERT(hmSegmentedStringBuilderGetSegmentCount(&string_builder) == 0);
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+HM_TEST_ON_FINALIZE
+    err = hmSegmentedStringBuilderDispose(&string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_can_steal_string_from_segmented_string_builder_with_many_segments()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmSegmentedStringBuilder string_builder;
+    hmError err = hmCreateSegmentedStringBuilder(&allocator, SEGMENT_SIZE, &string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "Hello, ");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "World!");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    hmString string;
+    err = hmSegmentedStringBuilderStealString(&string_builder, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "Hello, World!"));
+    HM_TEST_ASSERT(hmSegmentedStringBuilderGetLengthInBytes(&string_builder) == 0);
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    /* The string builder is still usable. */
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "Hi");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderToString(&string_builder, HM_NULL, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "Hi"));
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+HM_TEST_ON_FINALIZE
+    err = hmSegmentedStringBuilderDispose(&string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_can_clear_segmented_string_builder()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmSegmentedStringBuilder string_builder;
+    hmError err = hmCreateSegmentedStringBuilder(&allocator, SEGMENT_SIZE, &string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "Hello, ");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderClear(&string_builder);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    hmString string;
+    err = hmSegmentedStringBuilderToString(&string_builder, HM_NULL, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringIsEmpty(&string));
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderAppendCString(&string_builder, "World!");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmSegmentedStringBuilderToString(&string_builder, HM_NULL, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "World!"));
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+HM_TEST_ON_FINALIZE
+    err = hmSegmentedStringBuilderDispose(&string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(segmented_string_builders)
+    HM_TEST_RUN(test_can_create_segmented_string_builder_append_and_convert_to_string)
+    HM_TEST_RUN(test_segmented_string_builder_exposes_segments)
+    HM_TEST_RUN(test_can_steal_string_from_segmented_string_builder_with_one_segment)
+    HM_TEST_RUN(test_can_steal_string_from_segmented_string_builder_with_many_segments)
+    HM_TEST_RUN(test_can_clear_segmented_string_builder)
+HM_TEST_SUITE_END()
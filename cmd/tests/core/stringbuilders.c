@@ -179,6 +179,67 @@ HM_TEST_ON_FINALIZE
     HM_TEST_DEINIT_ALLOC(&allocator);
 }
 
+static void test_can_steal_string_from_string_builder()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmStringBuilder string_builder;
+    hmError err = hmCreateStringBuilder(&allocator, &string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmStringBuilderAppendCString(&string_builder, "Hello, World!");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    const char* chars = hmStringBuilderGetChars(&string_builder);
+    hmString string;
+    err = hmStringBuilderStealString(&string_builder, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringGetChars(&string) == chars); /* no copying */
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "Hello, World!"));
+    HM_TEST_ASSERT(hmStringBuilderGetLengthInBytes(&string_builder) == 0);
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+HM_TEST_ON_FINALIZE
+    err = hmStringBuilderDispose(&string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_can_append_numbers_to_string_builder()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmStringBuilder string_builder;
+    hmError err = hmCreateStringBuilder(&allocator, &string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmStringBuilderAppendInt(&string_builder, -42);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmStringBuilderAppendCString(&string_builder, " ");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmStringBuilderAppendUint64(&string_builder, 18446744073709551615u);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmStringBuilderAppendCString(&string_builder, " ");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmStringBuilderAppendFloat(&string_builder, 3.14);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmStringBuilderAppendCString(&string_builder, " 0x");
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmStringBuilderAppendHex(&string_builder, 0xCAFE);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    hmString string;
+    err = hmStringBuilderToString(&string_builder, HM_NULL, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "-42 18446744073709551615 3.14 0xcafe"));
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+HM_TEST_ON_FINALIZE
+    err = hmStringBuilderDispose(&string_builder);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
 HM_TEST_SUITE_BEGIN(string_builders)
     HM_TEST_RUN(test_can_create_string_builder_append_and_convert_to_string)
     HM_TEST_RUN(test_can_create_string_builder_append_and_convert_to_c_string)
@@ -186,4 +247,6 @@ HM_TEST_SUITE_BEGIN(string_builders)
     HM_TEST_RUN(test_can_create_string_from_string_builder_with_start_index_and_length_in_bytes)
     HM_TEST_RUN(test_can_clear_string_builder)
     HM_TEST_RUN(test_can_append_multiple_c_strings_to_string_builder)
+    HM_TEST_RUN(test_can_steal_string_from_string_builder)
+    HM_TEST_RUN(test_can_append_numbers_to_string_builder)
 HM_TEST_SUITE_END()
@@ -92,8 +92,39 @@ HM_TEST_ON_FINALIZE
     HM_TEST_DEINIT_ALLOC(&allocator);
 }
 
+static void test_string_pool_can_be_reset()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmStringPool pool;
+    hmError err = hmCreateStringPool(&allocator, HASHMAP_DEFAULT_CAPACITY, HASH_SALT, &pool);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    for (hm_nint round = 0; round < 2; round++) { /* The pool is usable after a reset. */
+        for (hm_nint i = 0; i < ITERATION_COUNT; i++) {
+            hmString string_view;
+            err = hmCreateStringViewFromCString(test_strings[i], &string_view);
+            HM_TEST_ASSERT_OK_OR_OOM(err);
+            hmString* interned_string_ref = HM_NULL;
+            err = hmStringPoolGetRef(&pool, &string_view, &interned_string_ref);
+            HM_TEST_ASSERT_OK_OR_OOM(err);
+            HM_TEST_ASSERT(hmStringEquals(&string_view, interned_string_ref));
+        }
+        HM_TEST_ASSERT(hmStringPoolGetCount(&pool) == ITERATION_COUNT);
+        err = hmStringPoolReset(&pool);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(hmStringPoolGetCount(&pool) == 0);
+    }
+HM_TEST_ON_FINALIZE
+    err = hmStringPoolDispose(&pool);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
 HM_TEST_SUITE_BEGIN(string_pools)
     HM_TEST_RUN(test_can_create_string_pool)
     HM_TEST_RUN(test_string_pool_can_be_filled_with_many_strings)
     HM_TEST_RUN(test_string_pool_returns_same_string)
+    HM_TEST_RUN(test_string_pool_can_be_reset)
 HM_TEST_SUITE_END()
@@ -121,7 +121,7 @@ static void test_can_hash_string()
     hmError err = hmCreateStringViewFromCString(STRING_CONTENT, &string);
     HM_TEST_ASSERT_OK(err);
     hm_uint32 hash = hmStringHash(&string, HASH_SALT);
-    HM_TEST_ASSERT(hash == 1485836977); /* precomputed */
+    HM_TEST_ASSERT(hash == 3759764976); /* precomputed */
 }
 
 static void test_can_hash_empty_string()
@@ -130,7 +130,7 @@ static void test_can_hash_empty_string()
     hmError err = hmCreateStringViewFromCString("", &string);
     HM_TEST_ASSERT_OK(err);
     hm_uint32 hash = hmStringHash(&string, HASH_SALT);
-    HM_TEST_ASSERT(hash == 34545); /* precomputed */
+    HM_TEST_ASSERT(hash == 123079974); /* precomputed */
 }
 
 static void test_can_create_string_with_zero_length()
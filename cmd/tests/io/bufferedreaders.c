@@ -0,0 +1,213 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <core/utils.h>
+#include <io/bufferedreader.h>
+
+#include <stdlib.h> /* for mkstemp(..) */
+#include <unistd.h> /* for write(..), close(..), unlink(..) */
+
+#define BUFFER_SIZE 8
+#define MEMORY_BUFFER_STRING "Hello, World"
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
+
+static hmError create_buffered_reader_and_allocator(hmBufferedReader* buffered_reader, hmAllocator* allocator)
+{
+    HM_TEST_INIT_ALLOC(allocator);
+    HM_TEST_TRACK_OOM(allocator, HM_FALSE);
+    hmReader memory_reader;
+    hmError err = hmCreateMemoryReader(allocator, MEMORY_BUFFER_STRING, strlen(MEMORY_BUFFER_STRING), &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(allocator, HM_TRUE);
+    err = hmCreateBufferedReader(allocator, memory_reader, HM_TRUE, BUFFER_SIZE, buffered_reader);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmReaderClose(&memory_reader));
+    }
+    return err;
+}
+
+static void dispose_buffered_reader_and_allocator(hmBufferedReader* buffered_reader, hmAllocator* allocator, hm_bool is_initialized)
+{
+    if (is_initialized) {
+        hmError err = hmBufferedReaderDispose(buffered_reader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(allocator);
+}
+
+static void test_buffered_reader_can_peek_and_consume()
+{
+    hmAllocator allocator;
+    hmBufferedReader buffered_reader;
+    hm_bool is_initialized = HM_FALSE;
+    hmError err = create_buffered_reader_and_allocator(&buffered_reader, &allocator);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_initialized = HM_TRUE;
+    const char* chars = HM_NULL;
+    hm_nint size = 0;
+    err = hmBufferedReaderPeek(&buffered_reader, 5, &chars, &size);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(size == BUFFER_SIZE); /* reads as much as fits */
+    HM_TEST_ASSERT(hmCompareMemory(chars, "Hello, W", BUFFER_SIZE) == 0);
+    err = hmBufferedReaderConsume(&buffered_reader, 7);
+    HM_TEST_ASSERT_OK(err);
+    /* Only 1 byte is left at the end of the buffer: peeking more requires moving it to the beginning. */
+    err = hmBufferedReaderPeek(&buffered_reader, 5, &chars, &size);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(size == 5);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "World", 5) == 0);
+    err = hmBufferedReaderConsume(&buffered_reader, 5);
+    HM_TEST_ASSERT_OK(err);
+    err = hmBufferedReaderPeek(&buffered_reader, 1, &chars, &size);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(size == 0); /* no more data */
+HM_TEST_ON_FINALIZE
+    dispose_buffered_reader_and_allocator(&buffered_reader, &allocator, is_initialized);
+}
+
+static void test_buffered_reader_rejects_invalid_sizes()
+{
+    hmAllocator allocator;
+    hmBufferedReader buffered_reader;
+    hm_bool is_initialized = HM_FALSE;
+    hmError err = create_buffered_reader_and_allocator(&buffered_reader, &allocator);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_initialized = HM_TRUE;
+    const char* chars = HM_NULL;
+    hm_nint size = 0;
+    err = hmBufferedReaderPeek(&buffered_reader, BUFFER_SIZE + 1, &chars, &size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmBufferedReaderConsume(&buffered_reader, 1);
+    HM_TEST_ASSERT(err == HM_ERROR_OUT_OF_RANGE);
+    hm_nint bytes_read = 0;
+    err = hmBufferedReaderFill(&buffered_reader, BUFFER_SIZE, &bytes_read);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_read == BUFFER_SIZE);
+    err = hmBufferedReaderFill(&buffered_reader, BUFFER_SIZE, &bytes_read);
+    HM_TEST_ASSERT(err == HM_ERROR_LIMIT_EXCEEDED);
+HM_TEST_ON_FINALIZE
+    dispose_buffered_reader_and_allocator(&buffered_reader, &allocator, is_initialized);
+}
+
+static void test_buffered_reader_can_create_reader_for_remaining_data()
+{
+    hmAllocator allocator;
+    hmBufferedReader buffered_reader;
+    hm_bool is_initialized = HM_FALSE;
+    hmReader reader;
+    hm_bool is_reader_initialized = HM_FALSE;
+    hmError err = create_buffered_reader_and_allocator(&buffered_reader, &allocator);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_initialized = HM_TRUE;
+    const char* chars = HM_NULL;
+    hm_nint size = 0;
+    err = hmBufferedReaderPeek(&buffered_reader, 7, &chars, &size);
+    HM_TEST_ASSERT_OK(err);
+    err = hmBufferedReaderConsume(&buffered_reader, 7); /* "Hello, " */
+    HM_TEST_ASSERT_OK(err);
+    err = hmBufferedReaderCreateReader(&buffered_reader, HM_NULL, &reader);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_reader_initialized = HM_TRUE;
+    char buffer[BUFFER_SIZE] = {0};
+    hm_nint bytes_read = 0, total_bytes_read = 0;
+    do {
+        err = hmReaderRead(&reader, buffer + total_bytes_read, 2, &bytes_read);
+        HM_TEST_ASSERT_OK(err);
+        total_bytes_read += bytes_read;
+    } while (bytes_read > 0);
+    HM_TEST_ASSERT(total_bytes_read == 5);
+    HM_TEST_ASSERT(hmCompareMemory(buffer, "World", 5) == 0);
+HM_TEST_ON_FINALIZE
+    if (is_reader_initialized) {
+        err = hmReaderClose(&reader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    dispose_buffered_reader_and_allocator(&buffered_reader, &allocator, is_initialized);
+}
+
+static void test_buffered_reader_reads_large_requests_directly()
+{
+    hmAllocator allocator;
+    hmBufferedReader buffered_reader;
+    hm_bool is_initialized = HM_FALSE;
+    hmError err = create_buffered_reader_and_allocator(&buffered_reader, &allocator);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_initialized = HM_TRUE;
+    char buffer[BUFFER_SIZE * 2] = {0};
+    hm_nint bytes_read = 0;
+    err = hmBufferedReaderRead(&buffered_reader, buffer, sizeof(buffer), &bytes_read);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_read == strlen(MEMORY_BUFFER_STRING));
+    HM_TEST_ASSERT(hmCompareMemory(buffer, MEMORY_BUFFER_STRING, bytes_read) == 0);
+    const char* chars = HM_NULL;
+    hm_nint size = 0;
+    hmBufferedReaderGetBuffered(&buffered_reader, &chars, &size);
+    HM_TEST_ASSERT(size == 0); /* nothing went through the buffer */
+    err = hmBufferedReaderRead(&buffered_reader, buffer, sizeof(buffer), &bytes_read);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_read == 0);
+HM_TEST_ON_FINALIZE
+    dispose_buffered_reader_and_allocator(&buffered_reader, &allocator, is_initialized);
+}
+
+static void test_buffered_reader_reads_ahead_from_files()
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    hmCopyMemory(path_buffer, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    int file_desc = mkstemp(path_buffer);
+    HM_TEST_ASSERT(file_desc != -1);
+    hm_nint content_length = strlen(MEMORY_BUFFER_STRING);
+    HM_TEST_ASSERT(write(file_desc, MEMORY_BUFFER_STRING, content_length) == (ssize_t)content_length);
+    HM_TEST_ASSERT(close(file_desc) == 0);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateMemoryReader(&allocator, MEMORY_BUFFER_STRING, content_length, &reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmReaderReadahead(&reader, BUFFER_SIZE);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_IMPLEMENTED);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateFileReader(&allocator, &path, &reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmReaderReadahead(&reader, BUFFER_SIZE);
+    HM_TEST_ASSERT_OK(err);
+    hmBufferedReader buffered_reader;
+    err = hmCreateBufferedReader(&allocator, reader, HM_TRUE, BUFFER_SIZE, &buffered_reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(buffered_reader.is_readahead_supported);
+    const char* chars = HM_NULL;
+    hm_nint size = 0;
+    err = hmBufferedReaderPeek(&buffered_reader, BUFFER_SIZE, &chars, &size);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(size == BUFFER_SIZE);
+    HM_TEST_ASSERT(hmCompareMemory(chars, MEMORY_BUFFER_STRING, BUFFER_SIZE) == 0);
+    err = hmBufferedReaderDispose(&buffered_reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+HM_TEST_SUITE_BEGIN(buffered_readers)
+    HM_TEST_RUN(test_buffered_reader_can_peek_and_consume)
+    HM_TEST_RUN(test_buffered_reader_rejects_invalid_sizes)
+    HM_TEST_RUN(test_buffered_reader_can_create_reader_for_remaining_data)
+    HM_TEST_RUN(test_buffered_reader_reads_large_requests_directly)
+    HM_TEST_RUN_WITHOUT_OOM(test_buffered_reader_reads_ahead_from_files)
+HM_TEST_SUITE_END()
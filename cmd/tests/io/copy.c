@@ -0,0 +1,169 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <io/copy.h>
+#include <core/utils.h>
+
+#include <stdlib.h> /* for mkstemp(..) */
+#include <string.h> /* for strlen(..) */
+#include <unistd.h> /* for close(..), unlink(..) */
+
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
+#define LARGE_CONTENT_SIZE (200*1024)
+#define CONTENT "Hello, World!"
+
+static void test_copy_impl(hm_bool is_limited_reader)
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmReader reader;
+    hmError err = hmCreateMemoryReader(&allocator, CONTENT, strlen(CONTENT), &reader);
+    HM_TEST_ASSERT_OK(err);
+    if (is_limited_reader) { /* limited readers don't support borrowing => the buffer is used */
+        err = hmCreateLimitedReader(&allocator, reader, HM_TRUE, HM_NINT_MAX, &reader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    hmWriter writer;
+    err = hmCreateStringWriter(&allocator, &writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    char buffer[3];
+    hm_nint bytes_copied = 0;
+    err = hmCopy(&reader, &writer, buffer, sizeof(buffer), &bytes_copied);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(bytes_copied == strlen(CONTENT));
+    hmString string;
+    err = hmStringWriterGetString(&writer, HM_NULL, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, CONTENT));
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK(err);
+HM_TEST_ON_FINALIZE
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_copy_from_borrowing_reader()
+{
+    test_copy_impl(HM_FALSE);
+}
+
+static void test_copy_through_buffer()
+{
+    test_copy_impl(HM_TRUE);
+}
+
+static void create_temp_file_path(char* in_path)
+{
+    hmCopyMemory(in_path, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    int file_desc = mkstemp(in_path);
+    HM_TEST_ASSERT(file_desc != -1);
+    HM_TEST_ASSERT(close(file_desc) == 0);
+}
+
+static void test_copy_between_files()
+{
+    char source_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)], target_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_file_path(source_path_buffer);
+    create_temp_file_path(target_path_buffer);
+    hmString source_path, target_path;
+    hmError err = hmCreateStringViewFromCString(source_path_buffer, &source_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(target_path_buffer, &target_path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    char* content = hmAlloc(&allocator, LARGE_CONTENT_SIZE);
+    HM_TEST_ASSERT(content);
+    for (hm_nint i = 0; i < LARGE_CONTENT_SIZE; i++) {
+        content[i] = (char)('a' + i % 26);
+    }
+    hmWriter writer;
+    err = hmCreateFileWriter(&allocator, &source_path, HM_FALSE, &writer);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateMemoryReader(&allocator, content, LARGE_CONTENT_SIZE, &reader);
+    HM_TEST_ASSERT_OK(err);
+    char buffer[HM_COPY_DEFAULT_BUFFER_SIZE];
+    hm_nint bytes_copied = 0;
+    err = hmCopy(&reader, &writer, buffer, sizeof(buffer), &bytes_copied);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_copied == LARGE_CONTENT_SIZE);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    /* File to file: can be copied inside the kernel. */
+    err = hmCreateFileReader(&allocator, &source_path, &reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateFileWriter(&allocator, &target_path, HM_FALSE, &writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCopy(&reader, &writer, buffer, sizeof(buffer), &bytes_copied);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_copied == LARGE_CONTENT_SIZE);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    /* Reads back what was copied. */
+    err = hmCreateMappedFileReader(&allocator, &target_path, &reader);
+    HM_TEST_ASSERT_OK(err);
+    const char* chars = HM_NULL;
+    hm_nint bytes_borrowed = 0;
+    err = hmReaderBorrow(&reader, HM_NINT_MAX, &chars, &bytes_borrowed);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_borrowed == LARGE_CONTENT_SIZE);
+    HM_TEST_ASSERT(hmCompareMemory(chars, content, LARGE_CONTENT_SIZE) == 0);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(source_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(target_path_buffer) == 0);
+    hmFree(&allocator, content);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_copy_requires_buffer()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateMemoryReader(&allocator, CONTENT, strlen(CONTENT), &reader);
+    HM_TEST_ASSERT_OK(err);
+    hmWriter writer;
+    err = hmCreateStringWriter(&allocator, &writer);
+    HM_TEST_ASSERT_OK(err);
+    char buffer[1];
+    err = hmCopy(&reader, &writer, buffer, 0, HM_NULL);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+HM_TEST_SUITE_BEGIN(copy)
+    HM_TEST_RUN(test_copy_from_borrowing_reader)
+    HM_TEST_RUN(test_copy_through_buffer)
+    HM_TEST_RUN_WITHOUT_OOM(test_copy_between_files)
+    HM_TEST_RUN_WITHOUT_OOM(test_copy_requires_buffer)
+HM_TEST_SUITE_END()
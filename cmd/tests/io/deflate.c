@@ -0,0 +1,268 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <io/deflate.h>
+#include <core/utils.h>
+
+#include <string.h> /* for strlen(..) */
+
+#define TEST_DATA_SIZE (200*1024)
+#define READ_BUFFER_SIZE 1000 /* deliberately not a power of two */
+
+/* REFERENCE_TEXT compressed by the reference gzip tool (with a file name in the header, and a dynamic Huffman block). */
+#define REFERENCE_TEXT "class worker image module opcode worker loader fiber worker runtime worker hammer loader method image class " \
+                       "class loader image image loader signature fiber module class fiber module image signature hammer"
+static const hm_uint8 reference_stream[] = {
+    0x1f, 0x8b, 0x08, 0x08, 0x09, 0xea, 0xd4, 0x6a, 0x02, 0x03, 0x68, 0x2e, 0x74, 0x78, 0x74, 0x00,
+    0x55, 0x4e, 0x5b, 0x0e, 0x80, 0x20, 0x0c, 0xbb, 0x0a, 0x57, 0x9b, 0x30, 0x81, 0xc8, 0x98, 0x19,
+    0x10, 0xaf, 0x2f, 0x71, 0x53, 0xe2, 0x4f, 0x97, 0xf4, 0xb1, 0xd6, 0x17, 0x68, 0xcd, 0x5d, 0x2c,
+    0x07, 0x8a, 0xcb, 0x04, 0x11, 0x1d, 0x71, 0x18, 0x05, 0x1d, 0x9f, 0x9e, 0x03, 0xbe, 0x52, 0x61,
+    0x08, 0xf3, 0xec, 0x79, 0x9b, 0x68, 0x9c, 0x8c, 0xda, 0x33, 0x7d, 0x96, 0x04, 0x44, 0xcb, 0x49,
+    0xd8, 0x13, 0x07, 0x7b, 0xe9, 0x9f, 0x16, 0x45, 0xd3, 0x55, 0x50, 0x34, 0xaa, 0xe5, 0x58, 0xa1,
+    0x0f, 0x41, 0xab, 0xb1, 0x21, 0x1a, 0xfb, 0x51, 0x1a, 0x5b, 0x7e, 0xad, 0xbe, 0x01, 0xbe, 0x96,
+    0x9c, 0x10, 0xcc, 0x00, 0x00, 0x00
+};
+
+/* Half-text, half-noise data, so that both compressible and incompressible parts are tested. */
+static void fill_test_data(char* data, hm_nint size)
+{
+    const char* text = "The quick brown fox jumps over the lazy dog. ";
+    hm_nint text_length = strlen(text);
+    hm_uint32 state = 12345;
+    for (hm_nint i = 0; i < size; i++) {
+        if ((i / 4096) % 2 == 0) {
+            data[i] = text[i % text_length];
+        } else {
+            state = state * 1103515245U + 12345U;
+            data[i] = (char)(state >> 24);
+        }
+    }
+}
+
+static void compress_test_data(hmAllocator* allocator, hmDeflateFormat format, const char* data, hm_nint size, hmString* in_compressed)
+{
+    hmWriter string_writer, writer;
+    hmError err = hmCreateStringWriter(allocator, &string_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateDeflateWriter(allocator, string_writer, HM_FALSE, format, HM_DEFLATE_DEFAULT_LEVEL, &writer);
+    HM_TEST_ASSERT_OK(err);
+    hm_nint bytes_written = 0;
+    err = hmWriterWrite(&writer, data, size, &bytes_written);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_written == size);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmStringWriterGetString(&string_writer, HM_NULL, in_compressed);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&string_writer);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static hmError decompress_test_data(hmAllocator* allocator, hmDeflateFormat format, hmString* compressed, char* buffer, hm_nint buffer_size, hm_nint* out_size)
+{
+    hmReader memory_reader, reader;
+    hmError err = hmCreateMemoryReader(allocator, hmStringGetChars(compressed), hmStringGetLengthInBytes(compressed), &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateDeflateReader(allocator, memory_reader, HM_TRUE, format, &reader);
+    HM_TEST_ASSERT_OK(err);
+    hm_nint bytes_read = 0;
+    *out_size = 0;
+    do {
+        hm_nint size = buffer_size - *out_size < READ_BUFFER_SIZE ? buffer_size - *out_size : READ_BUFFER_SIZE;
+        err = hmReaderRead(&reader, buffer + *out_size, size, &bytes_read);
+        *out_size += bytes_read;
+    } while (err == HM_OK && bytes_read > 0);
+    return hmMergeErrors(err, hmReaderClose(&reader));
+}
+
+static void test_deflate_round_trip(hmDeflateFormat format)
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char* data = (char*)hmAlloc(&allocator, TEST_DATA_SIZE);
+    char* decompressed_data = (char*)hmAlloc(&allocator, TEST_DATA_SIZE);
+    HM_TEST_ASSERT(data && decompressed_data);
+    fill_test_data(data, TEST_DATA_SIZE);
+    hmString compressed;
+    compress_test_data(&allocator, format, data, TEST_DATA_SIZE, &compressed);
+    HM_TEST_ASSERT(hmStringGetLengthInBytes(&compressed) < TEST_DATA_SIZE * 3 / 4);
+    if (format == HM_DEFLATE_FORMAT_GZIP) {
+        HM_TEST_ASSERT(hmCompareMemory(hmStringGetChars(&compressed), "\x1f\x8b", 2) == 0);
+    }
+    hm_nint decompressed_size = 0;
+    hmError err = decompress_test_data(&allocator, format, &compressed, decompressed_data, TEST_DATA_SIZE, &decompressed_size);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(decompressed_size == TEST_DATA_SIZE);
+    HM_TEST_ASSERT(hmCompareMemory(data, decompressed_data, TEST_DATA_SIZE) == 0);
+    err = hmStringDispose(&compressed);
+    HM_TEST_ASSERT_OK(err);
+    hmFree(&allocator, data);
+    hmFree(&allocator, decompressed_data);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_deflate_round_trip_in_all_formats()
+{
+    test_deflate_round_trip(HM_DEFLATE_FORMAT_RAW);
+    test_deflate_round_trip(HM_DEFLATE_FORMAT_ZLIB);
+    test_deflate_round_trip(HM_DEFLATE_FORMAT_GZIP);
+}
+
+static void test_deflate_reader_reads_reference_streams()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmReader memory_reader, reader;
+    hmError err = hmCreateMemoryReader(&allocator, (const char*)reference_stream, sizeof(reference_stream), &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateDeflateReader(&allocator, memory_reader, HM_TRUE, HM_DEFLATE_FORMAT_GZIP, &reader);
+    HM_TEST_ASSERT_OK(err);
+    char buffer[READ_BUFFER_SIZE];
+    hm_nint size = 0, bytes_read = 0;
+    do {
+        err = hmReaderRead(&reader, buffer + size, sizeof(buffer) - size, &bytes_read);
+        HM_TEST_ASSERT_OK(err);
+        size += bytes_read;
+    } while (bytes_read > 0);
+    HM_TEST_ASSERT(size == strlen(REFERENCE_TEXT));
+    HM_TEST_ASSERT(hmCompareMemory(buffer, REFERENCE_TEXT, size) == 0);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_deflate_reader_rejects_corrupted_data()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char data[TEST_DATA_SIZE / 100];
+    char decompressed_data[TEST_DATA_SIZE / 100];
+    fill_test_data(data, sizeof(data));
+    hmString compressed;
+    compress_test_data(&allocator, HM_DEFLATE_FORMAT_GZIP, data, sizeof(data), &compressed);
+    /* A truncated stream. */
+    hmString truncated;
+    hmError err = hmCreateSubstring(&allocator, &compressed, 0, hmStringGetLengthInBytes(&compressed) / 2, &truncated);
+    HM_TEST_ASSERT_OK(err);
+    hm_nint decompressed_size = 0;
+    err = decompress_test_data(&allocator, HM_DEFLATE_FORMAT_GZIP, &truncated, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    err = hmStringDispose(&truncated);
+    HM_TEST_ASSERT_OK(err);
+    /* Not a gzip stream at all. */
+    err = decompress_test_data(&allocator, HM_DEFLATE_FORMAT_ZLIB, &compressed, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    err = hmStringDispose(&compressed);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_deflate_writer_can_flush()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmWriter string_writer, writer;
+    hmError err = hmCreateStringWriter(&allocator, &string_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateDeflateWriter(&allocator, string_writer, HM_TRUE, HM_DEFLATE_FORMAT_RAW, HM_DEFLATE_DEFAULT_LEVEL, &writer);
+    HM_TEST_ASSERT_OK(err);
+    const char* message = "Hello, World!";
+    hm_nint bytes_written = 0;
+    err = hmWriterWrite(&writer, message, strlen(message), &bytes_written);
+    HM_TEST_ASSERT_OK(err);
+    err = hmDeflateWriterFlush(&writer);
+    HM_TEST_ASSERT_OK(err);
+    /* The stream isn't finished yet, but everything written so far can already be decompressed. */
+    hmString compressed;
+    err = hmStringWriterGetString(&string_writer, HM_NULL, &compressed);
+    HM_TEST_ASSERT_OK(err);
+    hmReader memory_reader, reader;
+    err = hmCreateMemoryReader(&allocator, hmStringGetChars(&compressed), hmStringGetLengthInBytes(&compressed), &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateDeflateReader(&allocator, memory_reader, HM_TRUE, HM_DEFLATE_FORMAT_RAW, &reader);
+    HM_TEST_ASSERT_OK(err);
+    char buffer[READ_BUFFER_SIZE];
+    hm_nint bytes_read = 0;
+    err = hmReaderRead(&reader, buffer, sizeof(buffer), &bytes_read);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_read == strlen(message));
+    HM_TEST_ASSERT(hmCompareMemory(buffer, message, bytes_read) == 0);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmStringDispose(&compressed);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_deflate_reader_and_writer_can_be_created()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmReader memory_reader, reader;
+    hmError err = hmCreateMemoryReader(&allocator, "", 0, &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    hmWriter string_writer, writer;
+    err = hmCreateStringWriter(&allocator, &string_writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    hm_bool is_reader_initialized = HM_FALSE, is_writer_initialized = HM_FALSE;
+    err = hmCreateDeflateReader(&allocator, memory_reader, HM_FALSE, HM_DEFLATE_FORMAT_GZIP, &reader);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_reader_initialized = HM_TRUE;
+    err = hmCreateDeflateWriter(&allocator, string_writer, HM_FALSE, HM_DEFLATE_FORMAT_GZIP, HM_DEFLATE_MAX_LEVEL, &writer);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_writer_initialized = HM_TRUE;
+HM_TEST_ON_FINALIZE
+    if (is_reader_initialized) {
+        err = hmReaderClose(&reader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    if (is_writer_initialized) {
+        err = hmWriterClose(&writer); /* writes the gzip header and trailer, which can run out of memory, too */
+        HM_TEST_ASSERT(err == HM_OK || err == HM_ERROR_OUT_OF_MEMORY);
+    }
+    err = hmReaderClose(&memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&string_writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_deflate_rejects_invalid_arguments()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmWriter string_writer, writer;
+    hmError err = hmCreateStringWriter(&allocator, &string_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateDeflateWriter(&allocator, string_writer, HM_FALSE, HM_DEFLATE_FORMAT_GZIP, HM_DEFLATE_MAX_LEVEL + 1, &writer);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateDeflateWriter(&allocator, string_writer, HM_FALSE, (hmDeflateFormat)100, HM_DEFLATE_DEFAULT_LEVEL, &writer);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmWriterClose(&string_writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(deflate)
+    HM_TEST_RUN_WITHOUT_OOM(test_deflate_round_trip_in_all_formats)
+    HM_TEST_RUN_WITHOUT_OOM(test_deflate_reader_reads_reference_streams)
+    HM_TEST_RUN_WITHOUT_OOM(test_deflate_reader_rejects_corrupted_data)
+    HM_TEST_RUN_WITHOUT_OOM(test_deflate_writer_can_flush)
+    HM_TEST_RUN(test_deflate_reader_and_writer_can_be_created)
+    HM_TEST_RUN_WITHOUT_OOM(test_deflate_rejects_invalid_arguments)
+HM_TEST_SUITE_END()
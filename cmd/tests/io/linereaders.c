@@ -13,12 +13,18 @@
 
 #include "../common.h"
 #include <io/linereader.h>
+#include <core/random.h>
 #include <core/utils.h>
 
+#include <stdlib.h> /* for mkstemp(..) */
 #include <string.h> /* for strlen(..) */
+#include <unistd.h> /* for write(..), close(..), unlink(..) */
 
 #define LINE_READER_BUFFER_SIZE 128
 #define LINE_READER_MAX_LINE_COUNT 16
+#define PARALLEL_LINE_READER_CONTENT_SIZE (300*1024)
+#define PARALLEL_LINE_READER_MAX_THREAD_COUNT 8
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
 
 static char* line_reader_lines[] = {
     "Hello, World!",
@@ -92,7 +98,9 @@ static void create_line_reader_content(hmAllocator* allocator, hm_nint line_coun
     HM_TEST_ASSERT_OK(err);
 }
 
-static void test_line_reader_can_read_several_lines_impl(hm_nint buffer_size, hm_nint line_count)
+/* If `is_borrowing` is false, the memory reader is wrapped in a limited reader, which doesn't support borrowing, so
+   that both code paths are tested: reading into the scratch buffer and scanning borrowed spans. */
+static void test_line_reader_can_read_several_lines_impl(hm_nint buffer_size, hm_nint line_count, hm_bool is_borrowing)
 {
     for (hm_nint j = 0; j < 2; j++) {
         hm_bool has_crlf_newlines = j == 0;
@@ -107,6 +115,10 @@ static void test_line_reader_can_read_several_lines_impl(hm_nint buffer_size, hm
         hm_bool is_lines_initialized = HM_FALSE;
         hmError err = hmCreateMemoryReader(&allocator, c_content, strlen(c_content), &memory_reader);
         HM_TEST_ASSERT_OK(err);
+        if (!is_borrowing) {
+            err = hmCreateLimitedReader(&allocator, memory_reader, HM_TRUE, HM_NINT_MAX, &memory_reader);
+            HM_TEST_ASSERT_OK(err);
+        }
         HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
         hmArray lines;
         err = hmReadAllLines(
@@ -142,7 +154,8 @@ static void test_line_reader_can_read_several_lines()
     /* Tests with different buffer sizes and content lengths. */
     for (hm_nint i = 1; i < LINE_READER_BUFFER_SIZE; i++) {
         for (hm_nint j = 0; j < LINE_READER_MAX_LINE_COUNT; j++) {
-            test_line_reader_can_read_several_lines_impl(i, j);
+            test_line_reader_can_read_several_lines_impl(i, j, HM_TRUE);
+            test_line_reader_can_read_several_lines_impl(i, j, HM_FALSE);
         }
     }
 }
@@ -212,6 +225,8 @@ static hmError hmCreateFailingReader(hmReader* in_reader)
 {
     in_reader->read = &hmFailingReader_read;
     in_reader->close = &hmFailingReader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = HM_NULL;
     in_reader->data = HM_NULL;
     return HM_OK;
 }
@@ -348,7 +363,7 @@ static void test_line_reader_can_get_buffered()
     HM_TEST_ASSERT(hmStringEqualsToCString(&string, "1234"));
     err = hmStringDispose(&string);
     HM_TEST_ASSERT_OK_OR_OOM(err);
-    char* remaining_buffer = HM_NULL;
+    const char* remaining_buffer = HM_NULL;
     hm_nint remaining_buffer_size = 0;
     err = hmLineReaderGetBuffered(&line_reader, &remaining_buffer, &remaining_buffer_size);
     HM_TEST_ASSERT_OK_OR_OOM(err);
@@ -357,6 +372,180 @@ HM_TEST_ON_FINALIZE
     dispose_line_reader_and_allocator(&line_reader, &allocator);
 }
 
+static hm_bool is_inside_buffer(const char* chars, const char* buffer, hm_nint buffer_size)
+{
+    return chars >= buffer && chars < buffer + buffer_size;
+}
+
+static void test_line_reader_can_read_line_views()
+{
+    hmAllocator allocator;
+    hmLineReader line_reader;
+    char buffer[8] = {0};
+    const char* content = "123\n456789012\nab";
+    create_line_reader_and_allocator(&line_reader, &allocator, content, buffer, sizeof(buffer), HM_FALSE);
+    const char* chars = HM_NULL;
+    hm_nint length_in_bytes = 0;
+    hmError err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(length_in_bytes == 3);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "123", length_in_bytes) == 0);
+    HM_TEST_ASSERT(is_inside_buffer(chars, content, strlen(content))); /* fits in the borrowed span => no copying */
+    err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(length_in_bytes == 9);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "456789012", length_in_bytes) == 0);
+    HM_TEST_ASSERT(!is_inside_buffer(chars, buffer, sizeof(buffer))); /* spans several reads => accumulated */
+    err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(length_in_bytes == 2);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "ab", length_in_bytes) == 0);
+    err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+HM_TEST_ON_FINALIZE
+    dispose_line_reader_and_allocator(&line_reader, &allocator);
+}
+
+static void test_line_reader_can_read_line_views_from_mapped_file()
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    hmCopyMemory(path_buffer, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    const char* content = "first\nsecond line\nthird\n";
+    int file_desc = mkstemp(path_buffer);
+    HM_TEST_ASSERT(file_desc != -1);
+    HM_TEST_ASSERT(write(file_desc, content, strlen(content)) == (ssize_t)strlen(content));
+    HM_TEST_ASSERT(close(file_desc) == 0);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateMappedFileReader(&allocator, &path, &reader);
+    HM_TEST_ASSERT_OK(err);
+    char buffer[8] = {0};
+    hmLineReader line_reader;
+    err = hmCreateLineReader(&allocator, reader, HM_TRUE, buffer, sizeof(buffer), HM_FALSE, &line_reader);
+    HM_TEST_ASSERT_OK(err);
+    /* The file is borrowed in 8-byte spans: "first\nse", "cond lin", "e\nthird\n" */
+    const char* chars = HM_NULL;
+    hm_nint length_in_bytes = 0;
+    err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(length_in_bytes == 5);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "first", length_in_bytes) == 0);
+    HM_TEST_ASSERT(chars != hmStringBuilderGetChars(&line_reader.next_line_builder)); /* inside the span => no copying */
+    err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(length_in_bytes == 11);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "second line", length_in_bytes) == 0);
+    HM_TEST_ASSERT(chars == hmStringBuilderGetChars(&line_reader.next_line_builder)); /* crosses spans => accumulated */
+    err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(length_in_bytes == 5);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "third", length_in_bytes) == 0);
+    HM_TEST_ASSERT(chars != hmStringBuilderGetChars(&line_reader.next_line_builder));
+    err = hmLineReaderReadLineView(&line_reader, &chars, &length_in_bytes);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    for (hm_nint i = 0; i < sizeof(buffer); i++) {
+        HM_TEST_ASSERT(buffer[i] == 0); /* the scratch buffer is never used when borrowing */
+    }
+    err = hmLineReaderDispose(&line_reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void assert_lines_are_equal(hmArray* lines1, hmArray* lines2)
+{
+    HM_TEST_ASSERT(hmArrayGetCount(lines1) == hmArrayGetCount(lines2));
+    hmString* raw1 = hmArrayGetRaw(lines1, hmString);
+    hmString* raw2 = hmArrayGetRaw(lines2, hmString);
+    for (hm_nint i = 0; i < hmArrayGetCount(lines1); i++) {
+        HM_TEST_ASSERT(hmStringEquals(&raw1[i], &raw2[i]));
+    }
+}
+
+static void assert_parallel_lines_match_line_reader(
+    hmAllocator* allocator,
+    const char*  content,
+    hm_nint      content_size,
+    hm_bool      has_crlf_newlines,
+    hm_nint      thread_count
+)
+{
+    char buffer[LINE_READER_BUFFER_SIZE];
+    hmReader memory_reader;
+    hmError err = hmCreateMemoryReader(allocator, content, content_size, &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    hmArray expected_lines, lines;
+    err = hmReadAllLines(allocator, memory_reader, buffer, sizeof(buffer), has_crlf_newlines, &expected_lines);
+    HM_TEST_ASSERT_OK(err);
+    err = hmReadAllLinesInParallel(allocator, content, content_size, has_crlf_newlines, thread_count, &lines);
+    HM_TEST_ASSERT_OK(err);
+    assert_lines_are_equal(&expected_lines, &lines);
+    err = hmArrayDispose(&lines);
+    HM_TEST_ASSERT_OK(err);
+    err = hmArrayDispose(&expected_lines);
+    HM_TEST_ASSERT_OK(err);
+    err = hmReaderClose(&memory_reader);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_parallel_line_reader_matches_line_reader()
+{
+    /* Random content made of a few letters and lots of different kinds of newlines to cover the edge cases,
+       large enough to be split across several threads. */
+    static const char alphabet[] = {'a', 'b', '\r', '\n'};
+    static const char* edge_cases[] = {"", "\n", "\n\n", "a", "a\n", "a\r", "\r\n", "\r\n\r\n", "a\r\nb", "a\nb\r\n", "\ra\n"};
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    char* content = hmAlloc(&allocator, PARALLEL_LINE_READER_CONTENT_SIZE);
+    HM_TEST_ASSERT(content);
+    hmRandom random;
+    err = hmCreateRandom(17, &random);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < PARALLEL_LINE_READER_CONTENT_SIZE; i++) {
+        content[i] = alphabet[(hm_nint)hmRandomGetNextInt(&random) % sizeof(alphabet)];
+    }
+    for (hm_nint i = 0; i < 2; i++) {
+        hm_bool has_crlf_newlines = i == 0;
+        for (hm_nint thread_count = 1; thread_count <= PARALLEL_LINE_READER_MAX_THREAD_COUNT; thread_count++) {
+            assert_parallel_lines_match_line_reader(&allocator, content, PARALLEL_LINE_READER_CONTENT_SIZE, has_crlf_newlines, thread_count);
+        }
+        for (hm_nint j = 0; j < sizeof(edge_cases) / sizeof(char*); j++) {
+            assert_parallel_lines_match_line_reader(&allocator, edge_cases[j], strlen(edge_cases[j]), has_crlf_newlines, PARALLEL_LINE_READER_MAX_THREAD_COUNT);
+        }
+    }
+    err = hmRandomDispose(&random);
+    HM_TEST_ASSERT_OK(err);
+    hmFree(&allocator, content);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_parallel_line_reader_can_read_lines_on_current_thread()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    const char* content = "Hello, World!\nGoodbye, World!\nTrailing";
+    hmArray lines;
+    hmError err = hmReadAllLinesInParallel(&allocator, content, strlen(content), HM_FALSE, 1, &lines);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmArrayGetCount(&lines) == sizeof(line_reader_lines) / sizeof(char*));
+    hmString* raw = hmArrayGetRaw(&lines, hmString);
+    for (hm_nint i = 0; i < hmArrayGetCount(&lines); i++) {
+        HM_TEST_ASSERT(hmStringEqualsToCString(&raw[i], line_reader_lines[i]));
+    }
+    err = hmArrayDispose(&lines);
+    HM_TEST_ASSERT_OK(err);
+HM_TEST_ON_FINALIZE
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
 HM_TEST_SUITE_BEGIN(line_readers)
     HM_TEST_RUN(test_line_reader_supports_never_being_read)
     HM_TEST_RUN(test_line_reader_can_read_several_lines)
@@ -367,4 +556,8 @@ HM_TEST_SUITE_BEGIN(line_readers)
     HM_TEST_RUN(test_line_reader_with_lf_newlines_doesnt_treat_crlf_as_newlines)
     HM_TEST_RUN(test_line_readers_crlf_newline_can_straddle_two_buffer_reads)
     HM_TEST_RUN(test_line_reader_can_get_buffered)
+    HM_TEST_RUN(test_line_reader_can_read_line_views)
+    HM_TEST_RUN_WITHOUT_OOM(test_line_reader_can_read_line_views_from_mapped_file)
+    HM_TEST_RUN_WITHOUT_OOM(test_parallel_line_reader_matches_line_reader)
+    HM_TEST_RUN(test_parallel_line_reader_can_read_lines_on_current_thread)
 HM_TEST_SUITE_END()
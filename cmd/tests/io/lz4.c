@@ -0,0 +1,238 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <io/lz4.h>
+#include <core/utils.h>
+
+#include <string.h> /* for strlen(..) */
+
+#define TEST_DATA_SIZE (200*1024)
+#define READ_BUFFER_SIZE 1000 /* deliberately not a power of two */
+
+/* "Hello, Hello, Hello, Hello, Hello!" compressed by the reference LZ4 tool (with a content checksum). */
+static const hm_uint8 reference_frame[] = {
+    0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0x11, 0x00, 0x00, 0x00, 0x7f,
+    0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x2c, 0x20, 0x07, 0x00, 0x03, 0x50, 0x65,
+    0x6c, 0x6c, 0x6f, 0x21, 0x00, 0x00, 0x00, 0x00, 0x3d, 0xe2, 0xfd, 0xe4
+};
+
+/* Half-text, half-noise data, so that both compressible and incompressible blocks are tested. */
+static void fill_test_data(char* data, hm_nint size)
+{
+    const char* text = "The quick brown fox jumps over the lazy dog. ";
+    hm_nint text_length = strlen(text);
+    hm_uint32 state = 12345;
+    for (hm_nint i = 0; i < size; i++) {
+        if ((i / HM_LZ4_BLOCK_SIZE) % 2 == 0) {
+            data[i] = text[i % text_length];
+        } else {
+            state = state * 1103515245U + 12345U;
+            data[i] = (char)(state >> 24);
+        }
+    }
+}
+
+static hmError read_all(hmReader* reader, char* buffer, hm_nint buffer_size, hm_nint* out_size)
+{
+    hm_nint bytes_read = 0;
+    hmError err = HM_OK;
+    *out_size = 0;
+    do {
+        hm_nint size = buffer_size - *out_size < READ_BUFFER_SIZE ? buffer_size - *out_size : READ_BUFFER_SIZE;
+        err = hmReaderRead(reader, buffer + *out_size, size, &bytes_read);
+        *out_size += bytes_read;
+    } while (err == HM_OK && bytes_read > 0);
+    return err;
+}
+
+static void test_lz4_compresses_and_decompresses_blocks()
+{
+    char data[HM_LZ4_BLOCK_SIZE];
+    char compressed_data[HM_LZ4_BLOCK_SIZE];
+    char decompressed_data[HM_LZ4_BLOCK_SIZE];
+    fill_test_data(data, HM_LZ4_BLOCK_SIZE);
+    const hm_nint sizes[] = {0, 1, 12, 13, 100, 4096, HM_LZ4_BLOCK_SIZE};
+    for (hm_nint i = 0; i < sizeof(sizes) / sizeof(hm_nint); i++) {
+        hm_nint compressed_size = 0, decompressed_size = 0;
+        hmError err = hmLZ4CompressBlock(data, sizes[i], compressed_data, sizeof(compressed_data), &compressed_size);
+        HM_TEST_ASSERT_OK(err);
+        if (sizes[i] >= 4096) {
+            HM_TEST_ASSERT(compressed_size < sizes[i] / 4);
+        }
+        err = hmLZ4DecompressBlock(compressed_data, compressed_size, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(decompressed_size == sizes[i]);
+        HM_TEST_ASSERT(hmCompareMemory(data, decompressed_data, sizes[i]) == 0);
+    }
+}
+
+static void test_lz4_reports_incompressible_blocks()
+{
+    char data[HM_LZ4_BLOCK_SIZE * 2];
+    char compressed_data[HM_LZ4_BLOCK_SIZE];
+    fill_test_data(data, sizeof(data));
+    hm_nint compressed_size = 0;
+    hmError err = hmLZ4CompressBlock(data + HM_LZ4_BLOCK_SIZE, HM_LZ4_BLOCK_SIZE, compressed_data, HM_LZ4_BLOCK_SIZE - 1, &compressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_LIMIT_EXCEEDED); /* the second block is noise */
+    err = hmLZ4CompressBlock(data, sizeof(data), compressed_data, sizeof(compressed_data), &compressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_lz4_rejects_malformed_blocks()
+{
+    char decompressed_data[64];
+    hm_nint decompressed_size = 0;
+    /* A match with offset 0. */
+    hmError err = hmLZ4DecompressBlock("\x14" "a\x00\x00", 4, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    /* A match which refers to data before the beginning of the block. */
+    err = hmLZ4DecompressBlock("\x14" "a\x02\x00", 4, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    /* More literals than there's data. */
+    err = hmLZ4DecompressBlock("\x50" "abc", 4, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    /* A match which doesn't fit in the output. */
+    err = hmLZ4DecompressBlock("\x1f" "a\x01\x00\xff\x00", 6, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    /* A block which ends with a match: the last sequence must have literals only. */
+    err = hmLZ4DecompressBlock("\x1f" "a\x01\x00\x00\x00", 6, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    /* A valid overlapping match, for comparison: "a" repeated 20 times, followed by the last 5 literals. */
+    err = hmLZ4DecompressBlock("\x1f" "a\x01\x00\x00\x50" "bbbbb", 11, decompressed_data, sizeof(decompressed_data), &decompressed_size);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(decompressed_size == 25);
+    HM_TEST_ASSERT(hmCompareMemory(decompressed_data, "aaaaaaaaaaaaaaaaaaaabbbbb", 25) == 0);
+}
+
+static void test_lz4_writer_and_reader_round_trip()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char* data = (char*)hmAlloc(&allocator, TEST_DATA_SIZE);
+    char* decompressed_data = (char*)hmAlloc(&allocator, TEST_DATA_SIZE);
+    HM_TEST_ASSERT(data && decompressed_data);
+    fill_test_data(data, TEST_DATA_SIZE);
+    hmWriter string_writer, writer;
+    hmError err = hmCreateStringWriter(&allocator, &string_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateLZ4Writer(&allocator, string_writer, HM_FALSE, &writer);
+    HM_TEST_ASSERT_OK(err);
+    /* Both small writes (which are accumulated) and large writes (which are compressed in place) are tested. */
+    hm_nint bytes_written = 0;
+    err = hmWriterWrite(&writer, data, 100, &bytes_written);
+    HM_TEST_ASSERT_OK(err);
+    err = hmLZ4WriterFlush(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterWrite(&writer, data + 100, HM_LZ4_BLOCK_SIZE - 100, &bytes_written);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterWrite(&writer, data + HM_LZ4_BLOCK_SIZE, TEST_DATA_SIZE - HM_LZ4_BLOCK_SIZE, &bytes_written);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_written == TEST_DATA_SIZE - HM_LZ4_BLOCK_SIZE);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    hmString compressed;
+    err = hmStringWriterGetString(&string_writer, HM_NULL, &compressed);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&string_writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmStringGetLengthInBytes(&compressed) < TEST_DATA_SIZE * 3 / 4);
+    hmReader memory_reader, reader;
+    err = hmCreateMemoryReader(&allocator, hmStringGetChars(&compressed), hmStringGetLengthInBytes(&compressed), &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateLZ4Reader(&allocator, memory_reader, HM_TRUE, &reader);
+    HM_TEST_ASSERT_OK(err);
+    hm_nint decompressed_size = 0;
+    err = read_all(&reader, decompressed_data, TEST_DATA_SIZE, &decompressed_size);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(decompressed_size == TEST_DATA_SIZE);
+    HM_TEST_ASSERT(hmCompareMemory(data, decompressed_data, TEST_DATA_SIZE) == 0);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmStringDispose(&compressed);
+    HM_TEST_ASSERT_OK(err);
+    hmFree(&allocator, data);
+    hmFree(&allocator, decompressed_data);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_lz4_reader_reads_reference_frames()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmReader memory_reader, reader;
+    hmError err = hmCreateMemoryReader(&allocator, (const char*)reference_frame, sizeof(reference_frame), &memory_reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    err = hmCreateLZ4Reader(&allocator, memory_reader, HM_TRUE, &reader);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmReaderClose(&memory_reader));
+    }
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    char buffer[READ_BUFFER_SIZE];
+    hm_nint size = 0;
+    err = read_all(&reader, buffer, sizeof(buffer), &size);
+    if (err == HM_OK) {
+        HM_TEST_ASSERT(size == strlen("Hello, Hello, Hello, Hello, Hello!"));
+        HM_TEST_ASSERT(hmCompareMemory(buffer, "Hello, Hello, Hello, Hello, Hello!", size) == 0);
+    }
+    err = hmMergeErrors(err, hmReaderClose(&reader));
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+HM_TEST_ON_FINALIZE
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_lz4_reader_rejects_malformed_frames()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char frame[sizeof(reference_frame)];
+    const hm_nint corrupted_indices[] = {
+        0,                           /* magic */
+        4,                           /* FLG: linked blocks */
+        6,                           /* header checksum */
+        7,                           /* block size */
+        sizeof(reference_frame) - 8  /* a block which is not followed by the end mark */
+    };
+    for (hm_nint i = 0; i <= sizeof(corrupted_indices) / sizeof(hm_nint); i++) {
+        hm_nint frame_size = sizeof(frame);
+        hmCopyMemory(frame, reference_frame, sizeof(frame));
+        if (i < sizeof(corrupted_indices) / sizeof(hm_nint)) {
+            frame[corrupted_indices[i]] ^= i == 1 ? 0x20 : 0x7F;
+        } else {
+            frame_size -= 5; /* truncated */
+        }
+        hmReader memory_reader, reader;
+        hmError err = hmCreateMemoryReader(&allocator, frame, frame_size, &memory_reader);
+        HM_TEST_ASSERT_OK(err);
+        err = hmCreateLZ4Reader(&allocator, memory_reader, HM_TRUE, &reader);
+        HM_TEST_ASSERT_OK(err);
+        char buffer[READ_BUFFER_SIZE];
+        hm_nint size = 0;
+        err = read_all(&reader, buffer, sizeof(buffer), &size);
+        HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+        err = hmReaderClose(&reader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(lz4)
+    HM_TEST_RUN_WITHOUT_OOM(test_lz4_compresses_and_decompresses_blocks)
+    HM_TEST_RUN_WITHOUT_OOM(test_lz4_reports_incompressible_blocks)
+    HM_TEST_RUN_WITHOUT_OOM(test_lz4_rejects_malformed_blocks)
+    HM_TEST_RUN_WITHOUT_OOM(test_lz4_writer_and_reader_round_trip)
+    HM_TEST_RUN(test_lz4_reader_reads_reference_frames)
+    HM_TEST_RUN_WITHOUT_OOM(test_lz4_reader_rejects_malformed_frames)
+HM_TEST_SUITE_END()
@@ -15,9 +15,13 @@
 #include <core/utils.h>
 #include <io/reader.h>
 
+#include <stdlib.h> /* for mkstemp(..) */
+#include <unistd.h> /* for write(..), close(..), unlink(..) */
+
 #define SMALL_READ_BUFFER_SIZE 5
 #define LARGE_READ_BUFFER_SIZE 1024
 #define MEMORY_BUFFER_STRING "Hello, World"
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
 
 static void create_memory_reader_and_allocator(hmReader* reader, hmAllocator* allocator)
 {
@@ -231,6 +235,159 @@ HM_TEST_ON_FINALIZE
     HM_TEST_DEINIT_ALLOC(&allocator);
 }
 
+static void test_memory_reader_can_borrow()
+{
+    hmAllocator allocator;
+    hmReader reader;
+    create_memory_reader_and_allocator(&reader, &allocator);
+    HM_TEST_ASSERT(hmReaderSupportsBorrowing(&reader));
+    const char* chars = HM_NULL;
+    hm_nint bytes_borrowed = 0;
+    hmError err = hmReaderBorrow(&reader, SMALL_READ_BUFFER_SIZE, &chars, &bytes_borrowed);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_borrowed == SMALL_READ_BUFFER_SIZE);
+    HM_TEST_ASSERT(hmCompareMemory(chars, "Hello", bytes_borrowed) == 0);
+    err = hmReaderBorrow(&reader, LARGE_READ_BUFFER_SIZE, &chars, &bytes_borrowed);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_borrowed == strlen(MEMORY_BUFFER_STRING) - SMALL_READ_BUFFER_SIZE);
+    HM_TEST_ASSERT(hmCompareMemory(chars, ", World", bytes_borrowed) == 0);
+    err = hmReaderBorrow(&reader, LARGE_READ_BUFFER_SIZE, &chars, &bytes_borrowed);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_borrowed == 0);
+    dispose_memory_reader_and_allocator(&reader, &allocator);
+}
+
+/* Creates a temporary file with the given content; the file path is placed in `in_path` (should be at least
+   sizeof(TEMP_FILE_PATH_TEMPLATE) long). */
+static void create_temp_file(const char* content, char* in_path)
+{
+    hmCopyMemory(in_path, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    int file_desc = mkstemp(in_path);
+    HM_TEST_ASSERT(file_desc != -1);
+    hm_nint content_length = strlen(content);
+    HM_TEST_ASSERT(write(file_desc, content, content_length) == (ssize_t)content_length);
+    HM_TEST_ASSERT(close(file_desc) == 0);
+}
+
+static void test_file_reader_reads_entire_file_impl(hmError (*create_file_reader_func)(hmAllocator*, hmString*, hmReader*))
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_file(MEMORY_BUFFER_STRING, path_buffer);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmReader reader;
+    hm_bool is_reader_initialized = HM_FALSE;
+    err = create_file_reader_func(&allocator, &path, &reader);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_reader_initialized = HM_TRUE;
+    char buffer[LARGE_READ_BUFFER_SIZE] = {0};
+    hm_nint bytes_read = 0, total_bytes_read = 0;
+    do {
+        err = hmReaderRead(&reader, buffer + total_bytes_read, SMALL_READ_BUFFER_SIZE, &bytes_read);
+        HM_TEST_ASSERT_OK(err);
+        total_bytes_read += bytes_read;
+    } while (bytes_read > 0);
+    HM_TEST_ASSERT(total_bytes_read == strlen(MEMORY_BUFFER_STRING));
+    HM_TEST_ASSERT(hmCompareMemory(buffer, MEMORY_BUFFER_STRING, total_bytes_read) == 0);
+HM_TEST_ON_FINALIZE
+    if (is_reader_initialized) {
+        err = hmReaderClose(&reader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_file_reader_reads_entire_file()
+{
+    test_file_reader_reads_entire_file_impl(&hmCreateFileReader);
+}
+
+static void test_mapped_file_reader_reads_entire_file()
+{
+    test_file_reader_reads_entire_file_impl(&hmCreateMappedFileReader);
+}
+
+static void test_mapped_file_reader_can_borrow()
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_file(MEMORY_BUFFER_STRING, path_buffer);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateMappedFileReader(&allocator, &path, &reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmReaderSupportsBorrowing(&reader));
+    char read_buffer[SMALL_READ_BUFFER_SIZE];
+    hm_nint bytes_read = 0;
+    err = hmReaderRead(&reader, read_buffer, SMALL_READ_BUFFER_SIZE, &bytes_read);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmCompareMemory(read_buffer, "Hello", SMALL_READ_BUFFER_SIZE) == 0);
+    const char* chars = HM_NULL;
+    hm_nint bytes_borrowed = 0;
+    err = hmReaderBorrow(&reader, LARGE_READ_BUFFER_SIZE, &chars, &bytes_borrowed);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_borrowed == strlen(MEMORY_BUFFER_STRING) - SMALL_READ_BUFFER_SIZE);
+    HM_TEST_ASSERT(hmCompareMemory(chars, ", World", bytes_borrowed) == 0);
+    err = hmReaderBorrow(&reader, LARGE_READ_BUFFER_SIZE, &chars, &bytes_borrowed);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_borrowed == 0);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_mapped_file_reader_can_read_empty_file()
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_file("", path_buffer);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateMappedFileReader(&allocator, &path, &reader);
+    HM_TEST_ASSERT_OK(err);
+    char read_buffer[SMALL_READ_BUFFER_SIZE];
+    hm_nint bytes_read = 0;
+    err = hmReaderRead(&reader, read_buffer, SMALL_READ_BUFFER_SIZE, &bytes_read);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_read == 0);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_file_readers_return_not_found_for_nonexistent_files()
+{
+    hmString path;
+    hmError err = hmCreateStringViewFromCString("/nonexistent/hammer/file", &path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateFileReader(&allocator, &path, &reader);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    err = hmCreateMappedFileReader(&allocator, &path, &reader);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
 HM_TEST_SUITE_BEGIN(readers)
     HM_TEST_RUN(test_memory_reader_can_create_read_close)
     HM_TEST_RUN(test_memory_reader_truncates_buffer_if_read_past_buffer)
@@ -239,4 +396,10 @@ HM_TEST_SUITE_BEGIN(readers)
     HM_TEST_RUN_WITHOUT_OOM(test_can_create_memory_reader_from_empty_string)
     HM_TEST_RUN(test_limited_reader_limits_reads)
     HM_TEST_RUN(test_composite_reader_reads_from_all_source_readers)
+    HM_TEST_RUN_WITHOUT_OOM(test_memory_reader_can_borrow)
+    HM_TEST_RUN(test_file_reader_reads_entire_file)
+    HM_TEST_RUN(test_mapped_file_reader_reads_entire_file)
+    HM_TEST_RUN_WITHOUT_OOM(test_mapped_file_reader_can_borrow)
+    HM_TEST_RUN_WITHOUT_OOM(test_mapped_file_reader_can_read_empty_file)
+    HM_TEST_RUN_WITHOUT_OOM(test_file_readers_return_not_found_for_nonexistent_files)
 HM_TEST_SUITE_END()
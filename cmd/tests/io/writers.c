@@ -12,9 +12,16 @@
 * ******************************************************************************/
 
 #include "../common.h"
+#include <io/reader.h>
 #include <io/writer.h>
+#include <core/utils.h>
 
+#include <stdlib.h> /* for mkstemp(..) */
 #include <string.h> /* for strlen(..) */
+#include <unistd.h> /* for close(..), unlink(..) */
+
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
+#define BUFFERED_WRITER_STRESS_WRITE_COUNT 1000
 
 static void test_string_writer_writes_and_closes()
 {
@@ -47,6 +54,280 @@ HM_TEST_ON_FINALIZE
     HM_TEST_DEINIT_ALLOC(&allocator);
 }
 
+/* A writer which accumulates everything in a string writer, but accepts at most `max_bytes_per_write` bytes per call
+   (to simulate partial writes) and counts the calls. */
+typedef struct {
+    hmWriter string_writer;
+    hm_nint  max_bytes_per_write;
+    hm_nint  write_count;
+    hm_nint  write_vector_count;
+} recordingWriterData;
+
+static hmError recording_writer_write(hmWriter* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
+{
+    recordingWriterData* data = (recordingWriterData*)writer->data;
+    data->write_count++;
+    if (size > data->max_bytes_per_write) {
+        size = data->max_bytes_per_write;
+    }
+    return hmWriterWrite(&data->string_writer, buffer, size, out_bytes_written);
+}
+
+static hmError recording_writer_write_vector(hmWriter* writer, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint* out_bytes_written)
+{
+    recordingWriterData* data = (recordingWriterData*)writer->data;
+    data->write_vector_count++;
+    *out_bytes_written = 0;
+    for (hm_nint i = 0; i < buffer_count && *out_bytes_written < data->max_bytes_per_write; i++) {
+        hm_nint size = buffers[i].size;
+        if (size > data->max_bytes_per_write - *out_bytes_written) {
+            size = data->max_bytes_per_write - *out_bytes_written;
+        }
+        hm_nint bytes_written = 0;
+        HM_TRY(hmWriterWrite(&data->string_writer, buffers[i].chars, size, &bytes_written));
+        *out_bytes_written += bytes_written;
+    }
+    return HM_OK;
+}
+
+static hmError recording_writer_close(hmWriter* writer)
+{
+    return HM_OK; /* the string writer is closed separately, to be able to inspect it */
+}
+
+static void create_recording_writer(hmAllocator* allocator, hm_nint max_bytes_per_write, recordingWriterData* data, hmWriter* in_writer)
+{
+    hmError err = hmCreateStringWriter(allocator, &data->string_writer);
+    HM_TEST_ASSERT_OK(err);
+    data->max_bytes_per_write = max_bytes_per_write;
+    data->write_count = 0;
+    data->write_vector_count = 0;
+    in_writer->write = &recording_writer_write;
+    in_writer->close = &recording_writer_close;
+    in_writer->write_vector_opt = &recording_writer_write_vector;
+    in_writer->get_native_handle_opt = HM_NULL;
+    in_writer->data = data;
+}
+
+static void assert_recording_writer_content(recordingWriterData* data, const char* expected_content)
+{
+    hmString string;
+    hmError err = hmStringWriterGetString(&data->string_writer, HM_NULL, &string);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, expected_content));
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void write_c_string(hmWriter* writer, const char* c_string)
+{
+    hm_nint bytes_written = 0;
+    hmError err = hmWriterWrite(writer, c_string, strlen(c_string), &bytes_written);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_written == strlen(c_string));
+}
+
+static void test_buffered_writer_batches_small_writes()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    recordingWriterData recording_writer_data;
+    hmWriter recording_writer, writer;
+    create_recording_writer(&allocator, HM_NINT_MAX, &recording_writer_data, &recording_writer);
+    err = hmCreateBufferedWriter(&allocator, recording_writer, HM_TRUE, 16, 0, &writer);
+    HM_TEST_ASSERT_OK(err);
+    write_c_string(&writer, "Hello");
+    write_c_string(&writer, ", ");
+    write_c_string(&writer, "World!");
+    HM_TEST_ASSERT(recording_writer_data.write_count == 0);
+    HM_TEST_ASSERT(hmBufferedWriterGetBufferedSize(&writer) == strlen("Hello, World!"));
+    err = hmBufferedWriterFlush(&writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(recording_writer_data.write_count == 1);
+    HM_TEST_ASSERT(hmBufferedWriterGetBufferedSize(&writer) == 0);
+    assert_recording_writer_content(&recording_writer_data, "Hello, World!");
+    write_c_string(&writer, " Bye!");
+    err = hmWriterClose(&writer); /* flushes */
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(recording_writer_data.write_count == 2);
+    assert_recording_writer_content(&recording_writer_data, "Hello, World! Bye!");
+    err = hmWriterClose(&recording_writer_data.string_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_buffered_writer_bypasses_buffer_for_large_writes()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    recordingWriterData recording_writer_data;
+    hmWriter recording_writer, writer;
+    create_recording_writer(&allocator, HM_NINT_MAX, &recording_writer_data, &recording_writer);
+    err = hmCreateBufferedWriter(&allocator, recording_writer, HM_TRUE, 16, 0, &writer);
+    HM_TEST_ASSERT_OK(err);
+    write_c_string(&writer, "Header: ");
+    write_c_string(&writer, "a large payload which doesn't fit");
+    /* Buffered data and the payload are written together in one go. */
+    HM_TEST_ASSERT(recording_writer_data.write_vector_count == 1);
+    HM_TEST_ASSERT(recording_writer_data.write_count == 0);
+    HM_TEST_ASSERT(hmBufferedWriterGetBufferedSize(&writer) == 0);
+    assert_recording_writer_content(&recording_writer_data, "Header: a large payload which doesn't fit");
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&recording_writer_data.string_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_buffered_writer_supports_partial_writes()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmWriter expected_writer;
+    err = hmCreateStringWriter(&allocator, &expected_writer);
+    HM_TEST_ASSERT_OK(err);
+    recordingWriterData recording_writer_data;
+    hmWriter recording_writer, writer;
+    create_recording_writer(&allocator, 3, &recording_writer_data, &recording_writer);
+    err = hmCreateBufferedWriter(&allocator, recording_writer, HM_TRUE, 16, 5, &writer);
+    HM_TEST_ASSERT_OK(err);
+    char chunk[32];
+    for (hm_nint i = 0; i < BUFFERED_WRITER_STRESS_WRITE_COUNT; i++) {
+        hm_nint chunk_size = (i * 7) % sizeof(chunk); /* covers empty, small and bypassing writes */
+        for (hm_nint j = 0; j < chunk_size; j++) {
+            chunk[j] = (char)('a' + (i + j) % 26);
+        }
+        hm_nint bytes_written = 0;
+        err = hmWriterWrite(&writer, chunk, chunk_size, &bytes_written);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(bytes_written == chunk_size);
+        HM_TEST_ASSERT(hmBufferedWriterGetBufferedSize(&writer) <= 16);
+        err = hmWriterWrite(&expected_writer, chunk, chunk_size, &bytes_written);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmBufferedWriterFlush(&writer);
+    HM_TEST_ASSERT_OK(err);
+    hmString expected_string;
+    err = hmStringWriterGetString(&expected_writer, HM_NULL, &expected_string);
+    HM_TEST_ASSERT_OK(err);
+    assert_recording_writer_content(&recording_writer_data, hmStringGetCString(&expected_string));
+    err = hmStringDispose(&expected_string);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&recording_writer_data.string_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&expected_writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_buffered_writer_validates_watermarks()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmWriter string_writer, writer;
+    hmError err = hmCreateStringWriter(&allocator, &string_writer);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmCreateBufferedWriter(&allocator, string_writer, HM_FALSE, 0, 0, &writer);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateBufferedWriter(&allocator, string_writer, HM_FALSE, 16, 16, &writer);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateBufferedWriter(&allocator, string_writer, HM_TRUE, 16, 15, &writer);
+    if (err != HM_OK) {
+        HM_TEST_ASSERT(hmWriterClose(&string_writer) == HM_OK);
+    }
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+HM_TEST_ON_FINALIZE
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_file_writer_writes_and_appends()
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    hmCopyMemory(path_buffer, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    int file_desc = mkstemp(path_buffer);
+    HM_TEST_ASSERT(file_desc != -1);
+    HM_TEST_ASSERT(close(file_desc) == 0);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmAllocator allocator;
+    err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmWriter writer;
+    err = hmCreateFileWriter(&allocator, &path, HM_FALSE, &writer);
+    HM_TEST_ASSERT_OK(err);
+    write_c_string(&writer, "Hello");
+    hmWriterBuffer buffers[2] = {{", ", 2}, {"World", 5}};
+    hm_nint bytes_written = 0;
+    err = hmWriterWriteVector(&writer, buffers, 2, &bytes_written);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_written == 7);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateFileWriter(&allocator, &path, HM_TRUE, &writer); /* should_append = HM_TRUE */
+    HM_TEST_ASSERT_OK(err);
+    write_c_string(&writer, "!");
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmCreateFileReader(&allocator, &path, &reader);
+    HM_TEST_ASSERT_OK(err);
+    char buffer[32];
+    hm_nint bytes_read = 0;
+    err = hmReaderRead(&reader, buffer, sizeof(buffer), &bytes_read);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(bytes_read == strlen("Hello, World!"));
+    HM_TEST_ASSERT(hmCompareMemory(buffer, "Hello, World!", bytes_read) == 0);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_writer_write_vector_falls_back_to_write()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmWriter writer;
+    hmError err = hmCreateStringWriter(&allocator, &writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    HM_TEST_ASSERT(writer.write_vector_opt == HM_NULL);
+    hmWriterBuffer buffers[3] = {{"Hello", 5}, {"", 0}, {", World!", 8}};
+    hm_nint bytes_written = 0;
+    err = hmWriterWriteVector(&writer, buffers, 3, &bytes_written);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(bytes_written == 13);
+    hmString string;
+    err = hmStringWriterGetString(&writer, HM_NULL, &string);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&string, "Hello, World!"));
+    err = hmStringDispose(&string);
+    HM_TEST_ASSERT_OK(err);
+HM_TEST_ON_FINALIZE
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
 HM_TEST_SUITE_BEGIN(writers)
     HM_TEST_RUN(test_string_writer_writes_and_closes)
+    HM_TEST_RUN_WITHOUT_OOM(test_buffered_writer_batches_small_writes)
+    HM_TEST_RUN_WITHOUT_OOM(test_buffered_writer_bypasses_buffer_for_large_writes)
+    HM_TEST_RUN_WITHOUT_OOM(test_buffered_writer_supports_partial_writes)
+    HM_TEST_RUN(test_buffered_writer_validates_watermarks)
+    HM_TEST_RUN_WITHOUT_OOM(test_file_writer_writes_and_appends)
+    HM_TEST_RUN(test_writer_write_vector_falls_back_to_write)
 HM_TEST_SUITE_END()
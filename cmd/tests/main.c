@@ -30,26 +30,41 @@ static void run_tests(hmTestSelector* test_selector)
         HM_TEST_RUN_SUITE(readers);
         HM_TEST_RUN_SUITE(writers);
         HM_TEST_RUN_SUITE(line_readers);
+        HM_TEST_RUN_SUITE(copy);
+        HM_TEST_RUN_SUITE(buffered_readers);
+        HM_TEST_RUN_SUITE(deflate);
+        HM_TEST_RUN_SUITE(lz4);
         HM_TEST_RUN_SUITE(arrays);
         HM_TEST_RUN_SUITE(strings);
         HM_TEST_RUN_SUITE(string_pools);
         HM_TEST_RUN_SUITE(string_builders);
+        HM_TEST_RUN_SUITE(segmented_string_builders);
         HM_TEST_RUN_SUITE(utils);
         HM_TEST_RUN_SUITE(hash_maps);
         HM_TEST_RUN_SUITE(hashes);
         HM_TEST_RUN_SUITE(errors);
         HM_TEST_RUN_SUITE(queues);
+        HM_TEST_RUN_SUITE(timer_wheels);
         HM_TEST_RUN_SUITE(environment);
         HM_TEST_RUN_SUITE(random);
         HM_TEST_RUN_SUITE(math);
+        HM_TEST_RUN_SUITE(format);
         HM_TEST_RUN_SUITE(signatures);
         HM_TEST_RUN_SUITE(modules);
+        HM_TEST_RUN_SUITE(mapped_images);
+        HM_TEST_RUN_SUITE(verifiers);
+        HM_TEST_RUN_SUITE(interpreters);
+        HM_TEST_RUN_SUITE(aot_compilers);
+        HM_TEST_RUN_SUITE(execution_contexts);
         HM_TEST_RUN_SUITE(http_requests);
         HM_TEST_RUN_SUITE(sockets);
+        HM_TEST_RUN_SUITE(coroutines);
         /* Tests which rely on timing should come last for the faster tests to fail earlier. */
         HM_TEST_RUN_SUITE(mutexes);
         HM_TEST_RUN_SUITE(waitable_events);
         HM_TEST_RUN_SUITE(threads);
+        HM_TEST_RUN_SUITE(schedulers);
+        HM_TEST_RUN_SUITE(timer_services);
         HM_TEST_RUN_SUITE(processes);
         HM_TEST_RUN_SUITE(workers);
     }
@@ -263,6 +263,32 @@ HM_TEST_ON_FINALIZE
     HM_TEST_DEINIT_ALLOC(&allocator);
 }
 
+static void test_http_request_can_parse_last_line_without_crlf_func(hmHTTPRequest* request, void* user_data)
+{
+    HM_TEST_ASSERT(hmHTTPRequestGetMethod(request) == HM_HTTP_METHOD_GET);
+    hmString name;
+    hmError err = hmCreateStringViewFromCString("Host", &name);
+    HM_TEST_ASSERT_OK(err);
+    hmString* value_ref;
+    err = hmHTTPRequestGetHeaderRef(request, &name, 0, &value_ref);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(value_ref, "abcdefghijklmnopqrstuvwxyz0123456789AB"));
+}
+
+/* The last line is only complete when the source reader is exhausted; by then, the buffered reader has already
+   compacted its buffer, because the line doesn't fit into a single small read. */
+static void test_http_request_can_parse_last_line_without_crlf()
+{
+    test_http_request_with_parameters(
+        "GET / HTTP/1.1\r\n"
+        "Host: abcdefghijklmnopqrstuvwxyz0123456789AB",
+        64, /* max_headers_size */
+        20, /* read_buffer_size */
+        &test_http_request_can_parse_last_line_without_crlf_func,
+        HM_NULL /* user_data = HM_NULL */
+    );
+}
+
 static void test_http_request_supports_optional_whitespace_around_header_fields_func(hmHTTPRequest* request, void* user_data)
 {
     HM_TEST_ASSERT(hmHTTPRequestGetMethod(request) == HM_HTTP_METHOD_GET);
@@ -501,6 +527,7 @@ HM_TEST_SUITE_BEGIN(http_requests)
     HM_TEST_RUN(test_http_request_supports_put_requests)
     HM_TEST_RUN(test_http_request_supports_lf_newlines_inside_fields)
     HM_TEST_RUN(test_http_request_respects_max_headers_size)
+    HM_TEST_RUN(test_http_request_can_parse_last_line_without_crlf)
     HM_TEST_RUN(test_http_request_supports_optional_whitespace_around_header_fields)
     HM_TEST_RUN(test_http_request_supports_header_name_canonicaliaztion)
     HM_TEST_RUN_WITHOUT_OOM(test_http_request_respects_header_name_restrictions)
@@ -16,6 +16,8 @@
 #include <net/sockets/serversocket.h>
 #include <core/environment.h>
 #include <core/utils.h>
+#include <threading/coroutine.h>
+#include <threading/scheduler.h>
 #include <threading/thread.h>
 #include <threading/waitableevent.h>
 #include <threading/workerpool.h>
@@ -32,15 +34,17 @@
 #define LOCALHOST "127.0.0.1"
 #define PAYLOAD "Hello, World!"
 #define PAYLOAD_SIZE 13
+#define PARKED_CONNECTION_COUNT 32
 
 typedef struct {
     hmWaitableEvent* waitable_event;
     hmThread*        thread;
 } serverSocketContext;
 
-static hmError server_socket_worker_func(void* work_item)
+static hmError server_socket_worker_func(void* work_item, hmScheduler* scheduler_opt)
 {
     hmSocket* socket = (hmSocket*)work_item;
+    hmSocketSetScheduler(socket, scheduler_opt); /* HM_NULL for thread-based workers. */
     char buffer[1024];
     hm_nint bytes_read = 0;
     hmError err = hmSocketRead(socket, buffer, sizeof(buffer), &bytes_read);
@@ -66,12 +70,15 @@ static hmError server_socket_thread_func(void* user_data)
     hmWorkerPool worker_pool;
     err = hmCreateWorkerPool(
         &allocator,
+        HM_NULL,
         worker_count,
         &server_socket_worker_func,
         sizeof(hmSocket),
         &hmSocketDisposeFunc,
         HM_FALSE,
         QUEUE_SIZE,
+        HM_WORKER_NO_COROUTINES,
+        HM_WORKER_POOL_AFFINITY_NONE,
         &worker_pool
     );
     HM_TEST_ASSERT_OK(err);
@@ -475,6 +482,271 @@ static void test_server_socket_reacts_to_disconnect_on_read()
     HM_TEST_ASSERT_OK(err);
 }
 
+/* A single coroutine-based worker serves all connections, while the client sends requests in the reverse order of
+   connecting: a worker which blocked its thread on reading the first connection would never see the others. */
+static void test_coroutine_workers_park_on_socket_reads()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmWorkerPool worker_pool;
+    err = hmCreateWorkerPool(
+        &allocator,
+        HM_NULL,
+        1,
+        &server_socket_worker_func,
+        sizeof(hmSocket),
+        &hmSocketDisposeFunc,
+        HM_FALSE,
+        QUEUE_SIZE,
+        HM_COROUTINE_MIN_STACK_SIZE,
+        HM_WORKER_POOL_AFFINITY_NONE,
+        &worker_pool
+    );
+    HM_TEST_ASSERT_OK(err);
+    hmServerSocket server_socket;
+    err = hmCreateServerSocket(&allocator, PORT, SOCKET_TIMEOUT, &server_socket);
+    HM_TEST_ASSERT_OK(err);
+    hmString host;
+    err = hmCreateStringViewFromCString(LOCALHOST, &host);
+    HM_TEST_ASSERT_OK(err);
+    hmSocket client_sockets[PARKED_CONNECTION_COUNT];
+    for (hm_nint i = 0; i < PARKED_CONNECTION_COUNT; i++) {
+        err = hmCreateSocket(&allocator, &host, PORT, SOCKET_TIMEOUT, &client_sockets[i]);
+        HM_TEST_ASSERT_OK(err);
+        hmSocket server_side_socket;
+        err = hmServerSocketAccept(&server_socket, HM_NULL, &server_side_socket);
+        HM_TEST_ASSERT_OK(err);
+        err = hmWorkerPoolEnqueueItem(&worker_pool, &server_side_socket);
+        HM_TEST_ASSERT_OK(err);
+    }
+    for (hm_nint i = PARKED_CONNECTION_COUNT; i-- > 0;) {
+        char message[1024];
+        sprintf(message, "message #%d", (int)i);
+        err = hmSocketSend(&client_sockets[i], message, strlen(message), HM_NULL);
+        HM_TEST_ASSERT_OK(err);
+        char buffer[1024];
+        hm_nint bytes_read = 0;
+        err = hmSocketRead(&client_sockets[i], buffer, sizeof(buffer), &bytes_read);
+        HM_TEST_ASSERT_OK(err);
+        buffer[bytes_read] = 0;
+        HM_TEST_ASSERT(strcmp(message, buffer) == 0);
+        err = hmSocketDispose(&client_sockets[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmWorkerPoolStop(&worker_pool, HM_TRUE);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolWait(&worker_pool, THREADING_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolDispose(&worker_pool);
+    HM_TEST_ASSERT_OK(err);
+    err = hmServerSocketDispose(&server_socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+typedef struct {
+    hmServerSocket* server_socket;
+    hm_nint         accepted_count;
+} acceptingCoroutineContext;
+
+static hmError accepting_coroutine_func(void* user_data)
+{
+    acceptingCoroutineContext* context = (acceptingCoroutineContext*)user_data;
+    hmSocket socket;
+    hmError err = hmServerSocketAccept(context->server_socket, HM_NULL, &socket);
+    HM_TEST_ASSERT_OK(err);
+    context->accepted_count++;
+    return hmSocketDispose(&socket);
+}
+
+/* The coroutine is woken up for a connection which is then accepted by someone else (as it happens when several
+   workers accept on the same server socket): instead of blocking the thread in accept(..), it must park again. */
+static void test_coroutine_parks_again_if_connection_is_accepted_by_someone_else()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmServerSocket server_socket;
+    err = hmCreateServerSocket(&allocator, PORT, SOCKET_TIMEOUT, &server_socket);
+    HM_TEST_ASSERT_OK(err);
+    hmScheduler scheduler;
+    err = hmCreateScheduler(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    err = hmServerSocketSetScheduler(&server_socket, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    acceptingCoroutineContext context;
+    context.server_socket = &server_socket;
+    context.accepted_count = 0;
+    err = hmSchedulerSpawn(&scheduler, &accepting_coroutine_func, &context, HM_NULL);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerRun(&scheduler, 0); /* Parks on the server socket. */
+    HM_TEST_ASSERT_OK(err);
+    hmString host;
+    err = hmCreateStringViewFromCString(LOCALHOST, &host);
+    HM_TEST_ASSERT_OK(err);
+    hmSocket client_sockets[2];
+    err = hmCreateSocket(&allocator, &host, PORT, SOCKET_TIMEOUT, &client_sockets[0]);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerRun(&scheduler, SOCKET_TIMEOUT); /* Wakes up the coroutine... */
+    HM_TEST_ASSERT_OK(err);
+    hmSocket stolen_socket;
+    err = hmServerSocketAccept(&server_socket, HM_NULL, &stolen_socket); /* ...but the connection is taken away. */
+    HM_TEST_ASSERT_OK(err);
+    err = hmSocketDispose(&stolen_socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerRun(&scheduler, 0);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(context.accepted_count == 0);
+    HM_TEST_ASSERT(hmSchedulerGetCoroutineCount(&scheduler) == 1);
+    err = hmCreateSocket(&allocator, &host, PORT, SOCKET_TIMEOUT, &client_sockets[1]);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < 2 && hmSchedulerGetCoroutineCount(&scheduler) > 0; i++) {
+        err = hmSchedulerRun(&scheduler, SOCKET_TIMEOUT);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(context.accepted_count == 1);
+    HM_TEST_ASSERT(hmSchedulerGetCoroutineCount(&scheduler) == 0);
+    for (hm_nint i = 0; i < 2; i++) {
+        err = hmSocketDispose(&client_sockets[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmServerSocketSetScheduler(&server_socket, HM_NULL);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerDispose(&scheduler);
+    HM_TEST_ASSERT_OK(err);
+    err = hmServerSocketDispose(&server_socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+typedef struct {
+    hmServerSocket* server_socket;
+    hmScheduler*    scheduler;
+    hmError         accept_err;
+    hmError         read_err;
+} timingOutCoroutineContext;
+
+static hmError timing_out_coroutine_func(void* user_data)
+{
+    timingOutCoroutineContext* context = (timingOutCoroutineContext*)user_data;
+    hmSocket socket;
+    context->accept_err = hmServerSocketAccept(context->server_socket, HM_NULL, &socket); /* Nobody connects. */
+    hmError err = hmServerSocketAccept(context->server_socket, HM_NULL, &socket); /* The client is connected by now. */
+    HM_TEST_ASSERT_OK(err);
+    hmSocketSetScheduler(&socket, context->scheduler);
+    char buffer[128];
+    context->read_err = hmSocketRead(&socket, buffer, sizeof(buffer), HM_NULL); /* Nobody sends. */
+    return hmSocketDispose(&socket);
+}
+
+/* Parked coroutines must get HM_ERROR_TIMEOUT just like blocked threads do. */
+static void test_coroutines_time_out_on_socket_timeout()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmServerSocket server_socket;
+    err = hmCreateServerSocket(&allocator, PORT, SOCKET_TIMEOUT, &server_socket);
+    HM_TEST_ASSERT_OK(err);
+    hmScheduler scheduler;
+    err = hmCreateScheduler(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    err = hmServerSocketSetScheduler(&server_socket, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    timingOutCoroutineContext context;
+    context.server_socket = &server_socket;
+    context.scheduler = &scheduler;
+    context.accept_err = HM_OK;
+    context.read_err = HM_OK;
+    err = hmSchedulerSpawn(&scheduler, &timing_out_coroutine_func, &context, HM_NULL);
+    HM_TEST_ASSERT_OK(err);
+    hm_millis start_time = hmGetTickCount();
+    while (context.accept_err == HM_OK) {
+        err = hmSchedulerRun(&scheduler, HM_SCHEDULER_INFINITE_TIMEOUT); /* Woken up by the deadline. */
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(context.accept_err == HM_ERROR_TIMEOUT);
+    HM_TEST_ASSERT(hmGetTickCount() - start_time >= SOCKET_TIMEOUT);
+    hmString host;
+    err = hmCreateStringViewFromCString(LOCALHOST, &host);
+    HM_TEST_ASSERT_OK(err);
+    hmSocket client_socket;
+    err = hmCreateSocket(&allocator, &host, PORT, SOCKET_TIMEOUT, &client_socket);
+    HM_TEST_ASSERT_OK(err);
+    start_time = hmGetTickCount();
+    while (hmSchedulerGetCoroutineCount(&scheduler) > 0) {
+        err = hmSchedulerRun(&scheduler, HM_SCHEDULER_INFINITE_TIMEOUT);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(context.read_err == HM_ERROR_TIMEOUT);
+    HM_TEST_ASSERT(hmGetTickCount() - start_time >= SOCKET_TIMEOUT);
+    err = hmSocketDispose(&client_socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmServerSocketSetScheduler(&server_socket, HM_NULL);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerDispose(&scheduler);
+    HM_TEST_ASSERT_OK(err);
+    err = hmServerSocketDispose(&server_socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+/* hmCopy(..) must not move data inside the kernel for scheduler-bound sockets: it would block the scheduler's thread. */
+static void test_scheduler_bound_sockets_hide_native_handles()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmString host;
+    err = hmCreateStringViewFromCString(LOCALHOST, &host);
+    HM_TEST_ASSERT_OK(err);
+    hmSocket socket;
+    hmServerSocket server_socket;
+    err = hmCreateServerSocket(&allocator, PORT, SOCKET_TIMEOUT, &server_socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateSocket(&allocator, &host, PORT, SOCKET_TIMEOUT, &socket);
+    HM_TEST_ASSERT_OK(err);
+    hmScheduler scheduler;
+    err = hmCreateScheduler(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    hmReader reader;
+    err = hmSocketCreateReader(&socket, HM_NULL, &reader);
+    HM_TEST_ASSERT_OK(err);
+    hmWriter writer;
+    err = hmSocketCreateWriter(&socket, HM_NULL, &writer);
+    HM_TEST_ASSERT_OK(err);
+    hm_nint handle = 0;
+    hmSocketSetScheduler(&socket, &scheduler);
+    HM_TEST_ASSERT(hmSocketGetScheduler(&socket) == &scheduler);
+    err = hmReaderGetNativeHandle(&reader, &handle);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_IMPLEMENTED);
+    err = hmWriterGetNativeHandle(&writer, &handle);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_IMPLEMENTED);
+    hmSocketSetScheduler(&socket, HM_NULL);
+    err = hmReaderGetNativeHandle(&reader, &handle);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(handle == hmSocketGetNativeHandle(&socket));
+    err = hmWriterGetNativeHandle(&writer, &handle);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(handle == hmSocketGetNativeHandle(&socket));
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmReaderClose(&reader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerDispose(&scheduler);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSocketDispose(&socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmServerSocketDispose(&server_socket);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
 HM_TEST_SUITE_BEGIN(sockets)
     HM_TEST_RUN_WITHOUT_OOM(test_server_socket_reacts_to_disconnect_on_read)
     HM_TEST_RUN_WITHOUT_OOM(test_client_socket_reacts_to_disconnect_on_send)
@@ -482,4 +754,8 @@ HM_TEST_SUITE_BEGIN(sockets)
     HM_TEST_RUN_WITHOUT_OOM(test_server_socket_supports_accept_timeout)
     HM_TEST_RUN(test_socket_reports_error_if_connecting_to_nonexisting_host)
     HM_TEST_RUN_WITHOUT_OOM(test_can_send_and_read_from_sockets)
+    HM_TEST_RUN_WITHOUT_OOM(test_coroutine_workers_park_on_socket_reads)
+    HM_TEST_RUN_WITHOUT_OOM(test_coroutine_parks_again_if_connection_is_accepted_by_someone_else)
+    HM_TEST_RUN_WITHOUT_OOM(test_coroutines_time_out_on_socket_timeout)
+    HM_TEST_RUN_WITHOUT_OOM(test_scheduler_bound_sockets_hide_native_handles)
 HM_TEST_SUITE_END()
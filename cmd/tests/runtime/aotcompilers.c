@@ -0,0 +1,240 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <runtime/aot.h>
+#include <runtime/jit.h>
+#include <core/utils.h>
+#include <vendor/sqlite3/sqlite3.h>
+
+#include <stdlib.h> /* for mkstemp(..) */
+#include <string.h> /* for strstr(..) */
+#include <unistd.h> /* for close(..), unlink(..) */
+
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
+#define TEST_COMPILER_PATH      "/usr/bin/cc"
+
+#define TEST_IMAGE_SCHEMA_SQL \
+    "CREATE TABLE module (module_id INTEGER PRIMARY KEY, name TEXT);" \
+    "CREATE TABLE class (class_id INTEGER PRIMARY KEY, module_id INTEGER, name TEXT);" \
+    "CREATE TABLE method (method_id INTEGER PRIMARY KEY, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+
+/* select(a, b) = a; callSelect(a) = select(a, -5); negative() = -5; wide() = 0x1122334455667788;
+   roundTrip(a) = a (through a local, dup and pop); recurse() never returns. */
+#define TEST_IMAGE_SQL \
+    TEST_IMAGE_SCHEMA_SQL \
+    "INSERT INTO module VALUES (1, 'Main');" \
+    "INSERT INTO class VALUES (10, 1, 'Program'), (11, 1, 'Utils');" \
+    "INSERT INTO method VALUES (100, 10, 1, 'select', '(JI)J', x'020000');" \
+    "INSERT INTO method VALUES (101, 10, 1, 'callSelect', '(J)J', x'02000005FBFFFFFF0964000000');" \
+    "INSERT INTO method VALUES (102, 11, 1, 'negative', '()I', x'05FBFFFFFF');" \
+    "INSERT INTO method VALUES (103, 11, 1, 'wide', '()J', x'068877665544332211');" \
+    "INSERT INTO method VALUES (104, 11, 1, 'roundTrip', '(I)I', x'020000010000030000070800');" \
+    "INSERT INTO method VALUES (105, 11, 1, 'recurse', '()V', x'0969000000');"
+#define TEST_IMAGE_METHOD_COUNT 6
+
+static void create_temp_path(char* path_buffer)
+{
+    hmCopyMemory(path_buffer, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    int file_desc = mkstemp(path_buffer);
+    HM_TEST_ASSERT(file_desc != -1);
+    HM_TEST_ASSERT(close(file_desc) == 0);
+}
+
+static void create_sqlite_image(char* path_buffer, const char* sql)
+{
+    create_temp_path(path_buffer);
+    sqlite3* db = HM_NULL;
+    HM_TEST_ASSERT(sqlite3_open(path_buffer, &db) == SQLITE_OK);
+    HM_TEST_ASSERT(sqlite3_exec(db, sql, HM_NULL, HM_NULL, HM_NULL) == SQLITE_OK);
+    HM_TEST_ASSERT(sqlite3_close(db) == SQLITE_OK);
+}
+
+static hmMethod* get_test_method(hmModuleRegistry* registry, hm_metadata_id class_id, hm_metadata_id method_id)
+{
+    hmModule* module = HM_NULL;
+    hmError err = hmModuleRegistryGetModule(registry, 1, &module);
+    HM_TEST_ASSERT_OK(err);
+    hmClass* hm_class = HM_NULL;
+    err = hmModuleGetClass(module, class_id, &hm_class);
+    HM_TEST_ASSERT_OK(err);
+    hmMethod* method = HM_NULL;
+    err = hmClassGetMethod(hm_class, method_id, &method);
+    HM_TEST_ASSERT_OK(err);
+    return method;
+}
+
+/* Calls the entry point of an ahead-of-time compiled method directly, the way the interpreter does. */
+static hmError call_test_method(hmMethod* method, hm_uint64* registers)
+{
+    hmJitCode code;
+    hmMethodGetJitCode(method, &code);
+    HM_TEST_ASSERT(code != HM_NULL);
+    return code(registers, HM_NULL);
+}
+
+static void test_aot_compiler_translates_images_to_c()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_sqlite_image(path_buffer, TEST_IMAGE_SQL);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loader;
+    err = hmCreateImageFileMetadataLoader(&allocator, &path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    hmWriter writer;
+    err = hmCreateStringWriter(&allocator, &writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAotTranslateImage(&allocator, &loader, &writer);
+    HM_TEST_ASSERT_OK(err);
+    hmString code;
+    err = hmStringWriterGetString(&writer, HM_NULL, &code);
+    HM_TEST_ASSERT_OK(err);
+    const char* c_code = hmStringGetCString(&code);
+    HM_TEST_ASSERT(strstr(c_code, "unsigned char hm_aot_4Main7Program6select(uint64_t* registers, void* interpreter)"));
+    HM_TEST_ASSERT(strstr(c_code, "return hm_aot_method_100(registers, 65536, registers[0], registers[1]);"));
+    HM_TEST_ASSERT(strstr(c_code, "HM_AOT_CALL(hm_aot_method_100(&s0, stack_left, s0, s1));"));
+    /* Two arguments and one stack slot of select(..), plus the overhead. */
+    HM_TEST_ASSERT(strstr(c_code, "    if (stack_left < 88u) {\n        return 8;\n    }\n    stack_left -= 88u;\n"));
+    HM_TEST_ASSERT(strstr(c_code, "s0 = UINT64_C(0xfffffffffffffffb);"));
+    HM_TEST_ASSERT(strstr(c_code, "HM_AOT_CALL(hm_aot_method_105(0, stack_left));"));
+    err = hmStringDispose(&code);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_aot_compiler_rejects_invalid_methods()
+{
+    const char* invalid_images[] = {
+        /* A malformed signature. */
+        TEST_IMAGE_SCHEMA_SQL
+        "INSERT INTO module VALUES (1, 'Main');"
+        "INSERT INTO class VALUES (10, 1, 'Program');"
+        "INSERT INTO method VALUES (100, 10, 1, 'main', '(V)V', x'00');",
+        /* A body which fails verification (a call of a method which doesn't exist). */
+        TEST_IMAGE_SCHEMA_SQL
+        "INSERT INTO module VALUES (1, 'Main');"
+        "INSERT INTO class VALUES (10, 1, 'Program');"
+        "INSERT INTO method VALUES (100, 10, 1, 'main', '()V', x'0965000000');"
+    };
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    for (hm_nint i = 0; i < sizeof(invalid_images) / sizeof(invalid_images[0]); i++) {
+        char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+        create_sqlite_image(path_buffer, invalid_images[i]);
+        hmString path;
+        hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+        HM_TEST_ASSERT_OK(err);
+        hmMetadataLoader loader;
+        err = hmCreateImageFileMetadataLoader(&allocator, &path, &loader);
+        HM_TEST_ASSERT_OK(err);
+        hmWriter writer;
+        err = hmCreateStringWriter(&allocator, &writer);
+        HM_TEST_ASSERT_OK(err);
+        err = hmAotTranslateImage(&allocator, &loader, &writer);
+        HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+        err = hmWriterClose(&writer);
+        HM_TEST_ASSERT_OK(err);
+        err = hmMetadataLoaderDispose(&loader);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_aot_compiler_builds_native_code()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    char c_file_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    char shared_object_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_sqlite_image(image_path_buffer, TEST_IMAGE_SQL);
+    create_temp_path(c_file_path_buffer);
+    create_temp_path(shared_object_path_buffer);
+    hmString image_path, c_file_path, shared_object_path, compiler_path;
+    hmError err = hmCreateStringViewFromCString(image_path_buffer, &image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(c_file_path_buffer, &c_file_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(shared_object_path_buffer, &shared_object_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(TEST_COMPILER_PATH, &compiler_path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loader;
+    err = hmCreateImageFileMetadataLoader(&allocator, &image_path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    /* The generated code is plain C, which is compiled as is (the temporary file has no ".c" extension). */
+    err = hmAotCompileImage(&allocator, &loader, &compiler_path, &c_file_path, &shared_object_path);
+    if (err == HM_ERROR_NOT_FOUND) {
+        HM_TEST_LOG("        No C compiler found, skipped.");
+    } else {
+        HM_TEST_ASSERT_OK(err);
+        hmAotImage image;
+        err = hmLoadAotImage(&allocator, &shared_object_path, &image);
+        HM_TEST_ASSERT_OK(err);
+        hmModuleRegistry registry;
+        err = hmCreateModuleRegistry(&allocator, &registry);
+        HM_TEST_ASSERT_OK(err);
+        err = hmModuleRegistryLoad(&registry, &loader);
+        HM_TEST_ASSERT_OK(err);
+        hm_nint bound_count = 0;
+        err = hmAotImageBindModules(&image, &registry, &bound_count);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(bound_count == TEST_IMAGE_METHOD_COUNT);
+        hm_uint64 registers[2] = { 42, 7 };
+        err = call_test_method(get_test_method(&registry, 10, 100), registers);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(registers[0] == 42);
+        registers[0] = 43;
+        err = call_test_method(get_test_method(&registry, 10, 101), registers);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(registers[0] == 43);
+        err = call_test_method(get_test_method(&registry, 11, 102), registers);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(registers[0] == (hm_uint64)(hm_int64)-5); /* Sign-extended. */
+        err = call_test_method(get_test_method(&registry, 11, 103), registers);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(registers[0] == 0x1122334455667788ULL);
+        registers[0] = 17;
+        err = call_test_method(get_test_method(&registry, 11, 104), registers);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(registers[0] == 17);
+        err = call_test_method(get_test_method(&registry, 11, 105), registers);
+        HM_TEST_ASSERT(err == HM_ERROR_LIMIT_EXCEEDED);
+        err = hmModuleRegistryDispose(&registry);
+        HM_TEST_ASSERT_OK(err);
+        err = hmAotImageDispose(&image);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(image_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(c_file_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(shared_object_path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(aot_compilers)
+    HM_TEST_RUN_WITHOUT_OOM(test_aot_compiler_translates_images_to_c)
+    HM_TEST_RUN_WITHOUT_OOM(test_aot_compiler_rejects_invalid_methods)
+    HM_TEST_RUN_WITHOUT_OOM(test_aot_compiler_builds_native_code)
+HM_TEST_SUITE_END()
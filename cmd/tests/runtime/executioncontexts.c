@@ -0,0 +1,224 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <runtime/executioncontext.h>
+#include <threading/atomic.h>
+#include <threading/thread.h>
+#include <threading/workerpool.h>
+
+#define TEST_REGISTER_COUNT 256
+#define TEST_FRAME_COUNT    16
+#define TEST_WORKER_COUNT   4
+#define TEST_WORK_ITEM_COUNT 1000
+
+static hmValueType identity_param_types[] = { HM_VALUE_TYPE_INT64 };
+static hmSignature identity_signature = { identity_param_types, 1, HM_VALUE_TYPE_INT64 }; /* (J)J */
+
+typedef struct {
+    hmExecutionContextPool* pool;
+    hmMethod*               method;
+    hm_uint64               arg;
+} hmTestWorkItem;
+
+static hm_atomic_nint processed_count = 0;
+
+static hmError resolve_no_call_target(hm_metadata_id method_id, void* user_data, hmMethod** out_method, hmSignature** out_signature)
+{
+    return HM_ERROR_NOT_FOUND;
+}
+
+/* Returns its argument. */
+static void create_identity_method(hmAllocator* allocator, hmMethod* method)
+{
+    hmMethodMetadata metadata;
+    hmError err = hmCreateStringViewFromCString("identity", &metadata.name);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString("(J)J", &metadata.signature);
+    HM_TEST_ASSERT_OK(err);
+    metadata.method_id = 0;
+    metadata.class_id = 0;
+    metadata.module_id = 0;
+    err = hmCreateMethod(allocator, allocator, HM_NULL, &metadata, method);
+    HM_TEST_ASSERT_OK(err);
+    hm_uint8 opcodes[] = { HM_HLOPCODE_LDARG, 0, 0 };
+    hmMethodBody hl_body = { opcodes, sizeof(opcodes) };
+    hmLLMethodBody ll_body;
+    err = hmCompileMethodBody(allocator, &hl_body, &identity_signature, &resolve_no_call_target, HM_NULL, &ll_body);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMethodSetLLBody(method, &ll_body);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_execution_context_can_be_reused()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmExecutionContext context;
+    hm_bool is_context_created = HM_FALSE;
+    hmError err = hmCreateExecutionContext(&allocator, TEST_REGISTER_COUNT, TEST_FRAME_COUNT, &context);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_context_created = HM_TRUE;
+    for (hm_nint i = 0; i < 3; i++) {
+        /* Scratch data of a request. */
+        hmString temp;
+        err = hmCreateStringFromCString(hmExecutionContextGetArena(&context), "temporary", &temp);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+        HM_TEST_ASSERT(hmStringEqualsToCString(&temp, "temporary"));
+        hmString name;
+        err = hmCreateStringViewFromCString("name", &name);
+        HM_TEST_ASSERT_OK(err);
+        hmString* interned_name = HM_NULL;
+        err = hmStringPoolGetRef(hmExecutionContextGetStringPool(&context), &name, &interned_name);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+        HM_TEST_ASSERT(hmStringEqualsToCString(interned_name, "name"));
+        HM_TEST_ASSERT(hmStringPoolGetCount(hmExecutionContextGetStringPool(&context)) == 1);
+        err = hmExecutionContextReset(&context);
+        HM_TEST_ASSERT_OK(err);
+        /* Interned strings don't accumulate across requests. */
+        HM_TEST_ASSERT(hmStringPoolGetCount(hmExecutionContextGetStringPool(&context)) == 0);
+    }
+HM_TEST_ON_FINALIZE
+    if (is_context_created) {
+        err = hmExecutionContextDispose(&context);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_execution_context_pool_reuses_contexts()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmExecutionContextPool pool;
+    hm_bool is_pool_created = HM_FALSE;
+    hmExecutionContext *first_context = HM_NULL, *second_context = HM_NULL, *context = HM_NULL;
+    hmError err = hmCreateExecutionContextPool(&allocator, 0, TEST_FRAME_COUNT, &pool);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateExecutionContextPool(&allocator, TEST_REGISTER_COUNT, TEST_FRAME_COUNT, &pool);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_pool_created = HM_TRUE;
+    err = hmExecutionContextPoolAcquire(&pool, &first_context);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmExecutionContextPoolAcquire(&pool, &second_context);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(first_context != second_context);
+    HM_TEST_ASSERT(hmExecutionContextPoolGetCreatedCount(&pool) == 2);
+    err = hmExecutionContextPoolDispose(&pool);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    err = hmExecutionContextPoolRelease(&pool, first_context);
+    first_context = HM_NULL;
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmExecutionContextPoolRelease(&pool, second_context);
+    context = second_context;
+    second_context = HM_NULL;
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    /* The most recently released context is reused first. */
+    err = hmExecutionContextPoolAcquire(&pool, &first_context);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(first_context == context);
+    HM_TEST_ASSERT(hmExecutionContextPoolGetCreatedCount(&pool) == 2);
+HM_TEST_ON_FINALIZE
+    /* If releasing fails (because of OOM), the context is disposed of, which is also fine. */
+    if (first_context) {
+        err = hmExecutionContextPoolRelease(&pool, first_context);
+        HM_TEST_ASSERT(err == HM_OK || err == HM_ERROR_OUT_OF_MEMORY);
+    }
+    if (second_context) {
+        err = hmExecutionContextPoolRelease(&pool, second_context);
+        HM_TEST_ASSERT(err == HM_OK || err == HM_ERROR_OUT_OF_MEMORY);
+    }
+    if (is_pool_created) {
+        err = hmExecutionContextPoolDispose(&pool);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+/* Runs on a worker thread. */
+static hmError execution_context_pool_worker_func(void* work_item, hmScheduler* scheduler_opt)
+{
+    hmTestWorkItem* item = (hmTestWorkItem*)work_item;
+    hmExecutionContext* context = HM_NULL;
+    HM_TRY(hmExecutionContextPoolAcquire(item->pool, &context));
+    hm_uint64 result = 0;
+    hmError err = hmInterpreterRun(hmExecutionContextGetInterpreter(context), item->method, &item->arg, &result);
+    HM_TEST_ASSERT(err != HM_OK || result == item->arg);
+    if (err == HM_OK && !hmAllocZeroInitialized(hmExecutionContextGetArena(context), 64)) {
+        err = HM_ERROR_OUT_OF_MEMORY;
+    }
+    err = hmMergeErrors(err, hmExecutionContextPoolRelease(item->pool, context));
+    if (err == HM_OK) {
+        (void)hmAtomicIncrement(&processed_count);
+    }
+    return err;
+}
+
+/* Workers need a thread-safe allocator, so OOM simulation is not possible. */
+static void test_execution_context_pool_is_shared_by_workers()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmMethod method;
+    create_identity_method(&allocator, &method);
+    hmExecutionContextPool pool;
+    err = hmCreateExecutionContextPool(&allocator, TEST_REGISTER_COUNT, TEST_FRAME_COUNT, &pool);
+    HM_TEST_ASSERT_OK(err);
+    hmWorkerPool workers;
+    err = hmCreateWorkerPool(
+        &allocator,
+        HM_NULL,
+        TEST_WORKER_COUNT,
+        &execution_context_pool_worker_func,
+        sizeof(hmTestWorkItem),
+        HM_NULL,
+        HM_FALSE,
+        TEST_WORK_ITEM_COUNT,
+        HM_WORKER_NO_COROUTINES,
+        HM_WORKER_POOL_AFFINITY_NONE,
+        &workers
+    );
+    HM_TEST_ASSERT_OK(err);
+    hmAtomicStore(&processed_count, 0);
+    for (hm_nint i = 0; i < TEST_WORK_ITEM_COUNT; i++) {
+        hmTestWorkItem item;
+        item.pool = &pool;
+        item.method = &method;
+        item.arg = i * 1000;
+        err = hmWorkerPoolEnqueueItem(&workers, &item);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmWorkerPoolStop(&workers, HM_TRUE);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolWait(&workers, HM_THREAD_JOIN_MAX_TIMEOUT_MS);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolDispose(&workers);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmAtomicLoad(&processed_count) == TEST_WORK_ITEM_COUNT);
+    /* No more contexts than there are workers. */
+    HM_TEST_ASSERT(hmExecutionContextPoolGetCreatedCount(&pool) >= 1);
+    HM_TEST_ASSERT(hmExecutionContextPoolGetCreatedCount(&pool) <= TEST_WORKER_COUNT);
+    err = hmExecutionContextPoolDispose(&pool);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMethodDispose(&method);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+HM_TEST_SUITE_BEGIN(execution_contexts)
+    HM_TEST_RUN(test_execution_context_can_be_reused)
+    HM_TEST_RUN(test_execution_context_pool_reuses_contexts)
+    HM_TEST_RUN_WITHOUT_OOM(test_execution_context_pool_is_shared_by_workers)
+HM_TEST_SUITE_END()
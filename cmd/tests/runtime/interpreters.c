@@ -0,0 +1,495 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <runtime/interpreter.h>
+#include <core/utils.h>
+#include <threading/thread.h>
+
+#define TEST_METHOD_COUNT 7
+
+/* Method IDs are indices in the test method table. */
+#define SELECT_FIRST_METHOD_ID  0
+#define SELECT_SECOND_METHOD_ID 1
+#define CALL_SELECT_FIRST_ID    2
+#define CALL_SELECT_SECOND_ID   3
+#define RECURSE_METHOD_ID       4
+#define NOT_COMPILED_METHOD_ID  5 /* Compiled on first call, if the interpreter can do that. */
+#define CALL_NOT_COMPILED_ID    6
+
+static hmValueType select_param_types[] = { HM_VALUE_TYPE_INT64, HM_VALUE_TYPE_INT32 };
+static hmValueType caller_param_types[] = { HM_VALUE_TYPE_INT64 };
+static hmSignature select_first_signature = { select_param_types, 2, HM_VALUE_TYPE_INT64 };  /* (JI)J */
+static hmSignature select_second_signature = { select_param_types, 2, HM_VALUE_TYPE_INT32 }; /* (JI)I */
+static hmSignature call_select_first_signature = { caller_param_types, 1, HM_VALUE_TYPE_INT64 };  /* (J)J */
+static hmSignature call_select_second_signature = { caller_param_types, 1, HM_VALUE_TYPE_INT32 }; /* (J)I */
+static hmSignature void_signature = { HM_NULL, 0, HM_VALUE_TYPE_VOID }; /* ()V */
+
+typedef struct {
+    hmMethod         methods[TEST_METHOD_COUNT];
+    hmSignature*     signatures[TEST_METHOD_COUNT];
+    hm_nint          method_count;
+    hmMetadataLoader body_loader; /* Loads the body of the method which isn't compiled beforehand. */
+} hmTestMethodTable;
+
+/* selectFirst(42, 3), and the result is discarded. */
+static hm_uint8 not_compiled_body[] = {
+    HM_HLOPCODE_LDC64, 42, 0, 0, 0, 0, 0, 0, 0,
+    HM_HLOPCODE_LDC32, 3, 0, 0, 0,
+    HM_HLOPCODE_CALL, SELECT_FIRST_METHOD_ID, 0, 0, 0,
+    HM_HLOPCODE_POP
+};
+
+static hmError load_test_method_body(
+    hmMetadataLoader*    loader,
+    hm_metadata_id       method_id,
+    hmLoadMethodBodyFunc load_body_func,
+    void*                user_data
+)
+{
+    if (method_id != NOT_COMPILED_METHOD_ID) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    hmMethodBodyMetadata body = { not_compiled_body, sizeof(not_compiled_body) };
+    return load_body_func(&body, user_data);
+}
+
+static hmError resolve_test_call_target(
+    hm_metadata_id method_id,
+    void*          user_data,
+    hmMethod**     out_method,
+    hmSignature**  out_signature
+)
+{
+    hmTestMethodTable* table = (hmTestMethodTable*)user_data;
+    if (method_id >= TEST_METHOD_COUNT) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    *out_method = &table->methods[method_id];
+    *out_signature = table->signatures[method_id];
+    return HM_OK;
+}
+
+static void add_test_method(hmAllocator* allocator, hmTestMethodTable* table, const char* name, hmSignature* signature)
+{
+    hmMethodMetadata metadata;
+    hmError err = hmCreateStringViewFromCString(name, &metadata.name);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString("", &metadata.signature);
+    HM_TEST_ASSERT_OK(err);
+    metadata.method_id = (hm_metadata_id)table->method_count;
+    metadata.class_id = 0;
+    metadata.module_id = 0;
+    err = hmCreateMethod(allocator, allocator, &table->body_loader, &metadata, &table->methods[table->method_count]);
+    HM_TEST_ASSERT_OK(err);
+    table->signatures[table->method_count] = signature;
+    table->method_count++;
+}
+
+static void compile_test_method(hmAllocator* allocator, hmTestMethodTable* table, hm_metadata_id method_id, hm_uint8* opcodes, hm_nint size)
+{
+    hmMethodBody hl_body = { opcodes, (hm_method_size)size };
+    hmLLMethodBody ll_body;
+    hmError err = hmCompileMethodBody(allocator, &hl_body, table->signatures[method_id], &resolve_test_call_target, table, &ll_body);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMethodSetLLBody(&table->methods[method_id], &ll_body);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void create_test_methods(hmAllocator* allocator, hmTestMethodTable* table)
+{
+    table->method_count = 0;
+    hmZeroMemory(&table->body_loader, sizeof(hmMetadataLoader));
+    table->body_loader.loadMethodBody = &load_test_method_body;
+    add_test_method(allocator, table, "selectFirst", &select_first_signature);
+    add_test_method(allocator, table, "selectSecond", &select_second_signature);
+    add_test_method(allocator, table, "callSelectFirst", &call_select_first_signature);
+    add_test_method(allocator, table, "callSelectSecond", &call_select_second_signature);
+    add_test_method(allocator, table, "recurse", &void_signature);
+    add_test_method(allocator, table, "notCompiled", &void_signature);
+    add_test_method(allocator, table, "callNotCompiled", &void_signature);
+    hm_uint8 select_first[] = { HM_HLOPCODE_LDARG, 0, 0 };
+    compile_test_method(allocator, table, SELECT_FIRST_METHOD_ID, select_first, sizeof(select_first));
+    hm_uint8 select_second[] = { HM_HLOPCODE_LDARG, 1, 0 };
+    compile_test_method(allocator, table, SELECT_SECOND_METHOD_ID, select_second, sizeof(select_second));
+    /* ldc.32 + call are fused into a superinstruction. */
+    hm_uint8 call_select_second[] = {
+        HM_HLOPCODE_LDARG, 0, 0,
+        HM_HLOPCODE_LDC32, 0xFB, 0xFF, 0xFF, 0xFF, /* -5 */
+        HM_HLOPCODE_CALL, SELECT_SECOND_METHOD_ID, 0, 0, 0
+    };
+    compile_test_method(allocator, table, CALL_SELECT_SECOND_ID, call_select_second, sizeof(call_select_second));
+    /* ldarg + ldloc are fused into a superinstruction. The extra locals check that the frame of the callee doesn't
+       overwrite the frame of the caller. */
+    hm_uint8 call_select_first[] = {
+        HM_HLOPCODE_LDC32, 7, 0, 0, 0,
+        HM_HLOPCODE_STLOC, 0, 0,
+        HM_HLOPCODE_LDC64, 1, 0, 0, 0, 0, 0, 0, 0,
+        HM_HLOPCODE_STLOC, 1, 0,
+        HM_HLOPCODE_LDARG, 0, 0,
+        HM_HLOPCODE_LDLOC, 0, 0,
+        HM_HLOPCODE_CALL, SELECT_FIRST_METHOD_ID, 0, 0, 0,
+        HM_HLOPCODE_POP,
+        HM_HLOPCODE_LDLOC, 1, 0,
+        HM_HLOPCODE_LDLOC, 0, 0,
+        HM_HLOPCODE_CALL, SELECT_FIRST_METHOD_ID, 0, 0, 0,
+        HM_HLOPCODE_STARG, 0, 0,
+        HM_HLOPCODE_LDARG, 0, 0
+    };
+    compile_test_method(allocator, table, CALL_SELECT_FIRST_ID, call_select_first, sizeof(call_select_first));
+    hm_uint8 recurse[] = { HM_HLOPCODE_CALL, RECURSE_METHOD_ID, 0, 0, 0 };
+    compile_test_method(allocator, table, RECURSE_METHOD_ID, recurse, sizeof(recurse));
+    hm_uint8 call_not_compiled[] = { HM_HLOPCODE_CALL, NOT_COMPILED_METHOD_ID, 0, 0, 0 };
+    compile_test_method(allocator, table, CALL_NOT_COMPILED_ID, call_not_compiled, sizeof(call_not_compiled));
+}
+
+static void dispose_test_methods(hmTestMethodTable* table)
+{
+    for (hm_nint i = 0; i < table->method_count; i++) {
+        hmError err = hmMethodDispose(&table->methods[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+}
+
+static void test_interpreter_runs_methods()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmTestMethodTable table;
+    create_test_methods(&allocator, &table);
+    hmInterpreter interpreter;
+    err = hmCreateInterpreter(&allocator, HM_INTERPRETER_DEFAULT_REGISTER_COUNT, HM_INTERPRETER_DEFAULT_FRAME_COUNT, HM_NULL, HM_NULL, HM_NULL, &interpreter);
+    HM_TEST_ASSERT_OK(err);
+    hm_uint64 args[] = { 42, 3 };
+    hm_uint64 result = 0;
+    err = hmInterpreterRun(&interpreter, &table.methods[SELECT_FIRST_METHOD_ID], args, &result);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(result == 42);
+    err = hmInterpreterRun(&interpreter, &table.methods[SELECT_SECOND_METHOD_ID], args, &result);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(result == 3);
+    err = hmInterpreterRun(&interpreter, &table.methods[CALL_SELECT_SECOND_ID], args, &result);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT((hm_int64)result == -5); /* 32-bit constants are sign-extended. */
+    err = hmInterpreterRun(&interpreter, &table.methods[CALL_SELECT_FIRST_ID], args, &result);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(result == 1);
+    err = hmInterpreterDispose(&interpreter);
+    HM_TEST_ASSERT_OK(err);
+    dispose_test_methods(&table);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_interpreter_reports_stack_overflow()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmTestMethodTable table;
+    create_test_methods(&allocator, &table);
+    hmInterpreter interpreter;
+    err = hmCreateInterpreter(&allocator, HM_INTERPRETER_DEFAULT_REGISTER_COUNT, 16, HM_NULL, HM_NULL, HM_NULL, &interpreter);
+    HM_TEST_ASSERT_OK(err);
+    err = hmInterpreterRun(&interpreter, &table.methods[RECURSE_METHOD_ID], HM_NULL, HM_NULL);
+    HM_TEST_ASSERT(err == HM_ERROR_LIMIT_EXCEEDED);
+    err = hmInterpreterRun(&interpreter, &table.methods[NOT_COMPILED_METHOD_ID], HM_NULL, HM_NULL);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    /* The interpreter is still usable after an error. */
+    hm_uint64 args[] = { 42, 3 };
+    hm_uint64 result = 0;
+    err = hmInterpreterRun(&interpreter, &table.methods[CALL_SELECT_FIRST_ID], args, &result);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(result == 1);
+    err = hmInterpreterDispose(&interpreter);
+    HM_TEST_ASSERT_OK(err);
+    dispose_test_methods(&table);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static hmMethod* reentrant_run_method = HM_NULL;
+static hmError reentrant_run_err = HM_OK;
+
+/* Stands for native code which tries to start another method on the interpreter it's called from. */
+static hmError run_reentrantly(hm_uint64* registers, hmInterpreter* interpreter)
+{
+    hm_uint64 args[] = { 42, 3 };
+    reentrant_run_err = hmInterpreterRun(interpreter, reentrant_run_method, args, HM_NULL);
+    return HM_OK;
+}
+
+static void test_interpreter_rejects_reentrant_runs()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmTestMethodTable table;
+    create_test_methods(&allocator, &table);
+    hmInterpreter interpreter;
+    err = hmCreateInterpreter(&allocator, HM_INTERPRETER_DEFAULT_REGISTER_COUNT, HM_INTERPRETER_DEFAULT_FRAME_COUNT, HM_NULL, HM_NULL, HM_NULL, &interpreter);
+    HM_TEST_ASSERT_OK(err);
+    /* Bound the same way as ahead-of-time compiled code (see runtime/aot.h) */
+    hmJitCode code = &run_reentrantly;
+    void* native_code = HM_NULL;
+    hmCopyMemory(&native_code, &code, sizeof(native_code));
+    hmAtomicStore(&table.methods[SELECT_SECOND_METHOD_ID].jit_code_opt, native_code);
+    reentrant_run_method = &table.methods[SELECT_FIRST_METHOD_ID];
+    reentrant_run_err = HM_OK;
+    hm_uint64 args[] = { 42, 3 };
+    err = hmInterpreterRun(&interpreter, &table.methods[CALL_SELECT_SECOND_ID], args, HM_NULL);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(reentrant_run_err == HM_ERROR_INVALID_STATE);
+    /* Not running anymore. */
+    hm_uint64 result = 0;
+    err = hmInterpreterRun(&interpreter, &table.methods[SELECT_FIRST_METHOD_ID], args, &result);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(result == 42);
+    err = hmInterpreterDispose(&interpreter);
+    HM_TEST_ASSERT_OK(err);
+    dispose_test_methods(&table);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void run_test_methods(hmInterpreter* interpreter, hmTestMethodTable* table, hm_nint run_count)
+{
+    hm_uint64 args[] = { 42, 3 };
+    for (hm_nint i = 0; i < run_count; i++) {
+        hm_uint64 result = 0;
+        hmError err = hmInterpreterRun(interpreter, &table->methods[CALL_SELECT_FIRST_ID], args, &result);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(result == 1);
+        err = hmInterpreterRun(interpreter, &table->methods[CALL_SELECT_SECOND_ID], args, &result);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT((hm_int64)result == -5);
+        err = hmInterpreterRun(interpreter, &table->methods[RECURSE_METHOD_ID], HM_NULL, HM_NULL);
+        HM_TEST_ASSERT(err == HM_ERROR_LIMIT_EXCEEDED);
+    }
+}
+
+static void test_interpreter_runs_jit_compiled_methods()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmTestMethodTable table;
+    create_test_methods(&allocator, &table);
+    hmJit jit;
+    err = hmCreateJit(&allocator, HM_JIT_DEFAULT_CODE_HEAP_CAPACITY, 2, &jit);
+    HM_TEST_ASSERT_OK(err);
+    hmInterpreter interpreter;
+    err = hmCreateInterpreter(&allocator, HM_INTERPRETER_DEFAULT_REGISTER_COUNT, 256, &jit, HM_NULL, HM_NULL, &interpreter);
+    HM_TEST_ASSERT_OK(err);
+    run_test_methods(&interpreter, &table, 1);
+    HM_TEST_ASSERT(!hmMethodIsJitCompiled(&table.methods[CALL_SELECT_FIRST_ID]));
+    /* Every method crosses the threshold: results must stay the same whether a caller and a callee are interpreted
+       or compiled, in any combination. */
+    run_test_methods(&interpreter, &table, 5);
+#ifdef HM_JIT_SUPPORTED
+    for (hm_nint i = 0; i < NOT_COMPILED_METHOD_ID; i++) {
+        HM_TEST_ASSERT(hmMethodIsJitCompiled(&table.methods[i]));
+        /* Small methods share pages instead of taking one each. */
+        void* code = hmAtomicLoad(&table.methods[i].jit_code_opt);
+        HM_TEST_ASSERT((hm_uint8*)code - jit.code_heap.base < 4096);
+        HM_TEST_ASSERT((hm_nint)code % HM_CODE_HEAP_ALIGNMENT == 0);
+    }
+#endif
+    err = hmInterpreterRun(&interpreter, &table.methods[NOT_COMPILED_METHOD_ID], HM_NULL, HM_NULL);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    err = hmJitCompile(&jit, &table.methods[NOT_COMPILED_METHOD_ID]);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    err = hmJitCompile(&jit, &table.methods[SELECT_FIRST_METHOD_ID]);
+#ifdef HM_JIT_SUPPORTED
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE); /* Already compiled. */
+#else
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_IMPLEMENTED);
+#endif
+    err = hmInterpreterDispose(&interpreter);
+    HM_TEST_ASSERT_OK(err);
+    err = hmJitDispose(&jit);
+    HM_TEST_ASSERT_OK(err);
+    dispose_test_methods(&table);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_interpreter_falls_back_if_code_heap_is_full()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmTestMethodTable table;
+    create_test_methods(&allocator, &table);
+    hmJit jit;
+    err = hmCreateJit(&allocator, 1, 0, &jit); /* Too small for any method. */
+    HM_TEST_ASSERT_OK(err);
+    hmInterpreter interpreter;
+    err = hmCreateInterpreter(&allocator, HM_INTERPRETER_DEFAULT_REGISTER_COUNT, 256, &jit, HM_NULL, HM_NULL, &interpreter);
+    HM_TEST_ASSERT_OK(err);
+    run_test_methods(&interpreter, &table, 3);
+    hm_nint compiled_count = 0;
+    for (hm_nint i = 0; i < TEST_METHOD_COUNT; i++) {
+        if (hmMethodIsJitCompiled(&table.methods[i])) {
+            compiled_count++;
+        }
+    }
+    HM_TEST_ASSERT(compiled_count == 0);
+    err = hmInterpreterDispose(&interpreter);
+    HM_TEST_ASSERT_OK(err);
+    err = hmJitDispose(&jit);
+    HM_TEST_ASSERT_OK(err);
+    dispose_test_methods(&table);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_interpreter_compiles_methods_on_first_call()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    /* The method is called directly the first time, then from interpreted code. */
+    hm_metadata_id entry_method_ids[] = { NOT_COMPILED_METHOD_ID, CALL_NOT_COMPILED_ID };
+    for (hm_nint i = 0; i < sizeof(entry_method_ids) / sizeof(hm_metadata_id); i++) {
+        hmTestMethodTable table;
+        create_test_methods(&allocator, &table);
+        hmInterpreter interpreter;
+        err = hmCreateInterpreter(
+            &allocator,
+            HM_INTERPRETER_DEFAULT_REGISTER_COUNT,
+            HM_INTERPRETER_DEFAULT_FRAME_COUNT,
+            HM_NULL,
+            &resolve_test_call_target,
+            &table,
+            &interpreter
+        );
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(!hmMethodIsCompiled(&table.methods[NOT_COMPILED_METHOD_ID]));
+        err = hmInterpreterRun(&interpreter, &table.methods[entry_method_ids[i]], HM_NULL, HM_NULL);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(hmMethodIsCompiled(&table.methods[NOT_COMPILED_METHOD_ID]));
+        /* Already compiled. */
+        err = hmInterpreterRun(&interpreter, &table.methods[NOT_COMPILED_METHOD_ID], HM_NULL, HM_NULL);
+        HM_TEST_ASSERT_OK(err);
+        err = hmInterpreterDispose(&interpreter);
+        HM_TEST_ASSERT_OK(err);
+        dispose_test_methods(&table);
+    }
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+#define SHARED_METHODS_THREAD_COUNT 4
+#define SHARED_METHODS_RUN_COUNT    100
+#define THREAD_JOIN_TIMEOUT         (5*1000)
+
+typedef struct {
+    hmAllocator*       allocator;
+    hmTestMethodTable* table;
+    hmJit              jit;
+} hmTestSharedMethodsContext;
+
+static hmError run_shared_methods_thread_func(void* user_data)
+{
+    hmTestSharedMethodsContext* context = (hmTestSharedMethodsContext*)user_data;
+    hmInterpreter interpreter;
+    HM_TRY(hmCreateInterpreter(
+        context->allocator,
+        HM_INTERPRETER_DEFAULT_REGISTER_COUNT,
+        HM_INTERPRETER_DEFAULT_FRAME_COUNT,
+        &context->jit,
+        &resolve_test_call_target,
+        context->table,
+        &interpreter
+    ));
+    hm_uint64 args[] = { 42, 3 };
+    hmError err = HM_OK;
+    for (hm_nint i = 0; i < SHARED_METHODS_RUN_COUNT && err == HM_OK; i++) {
+        hm_uint64 result = 0;
+        err = hmInterpreterRun(&interpreter, &context->table->methods[CALL_NOT_COMPILED_ID], HM_NULL, HM_NULL);
+        if (err == HM_OK) {
+            err = hmInterpreterRun(&interpreter, &context->table->methods[CALL_SELECT_FIRST_ID], args, &result);
+        }
+        if (err == HM_OK && result != 1) {
+            err = HM_ERROR_INVALID_STATE;
+        }
+    }
+    return hmMergeErrors(err, hmInterpreterDispose(&interpreter));
+}
+
+/* Interpreters of several threads compile the same methods on first call and make them hot at the same time. */
+static void test_interpreters_of_several_threads_share_methods()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmTestMethodTable table;
+    create_test_methods(&allocator, &table);
+    hmTestSharedMethodsContext contexts[SHARED_METHODS_THREAD_COUNT];
+    hmThread threads[SHARED_METHODS_THREAD_COUNT];
+    for (hm_nint i = 0; i < SHARED_METHODS_THREAD_COUNT; i++) {
+        contexts[i].allocator = &allocator;
+        contexts[i].table = &table;
+        /* Every thread has its own JIT, but code compiled by one is run by all of them. */
+        err = hmCreateJit(&allocator, HM_JIT_DEFAULT_CODE_HEAP_CAPACITY, 2, &contexts[i].jit);
+        HM_TEST_ASSERT_OK(err);
+    }
+    for (hm_nint i = 0; i < SHARED_METHODS_THREAD_COUNT; i++) {
+        err = hmCreateThread(&allocator, HM_NULL, &run_shared_methods_thread_func, &contexts[i], &threads[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    for (hm_nint i = 0; i < SHARED_METHODS_THREAD_COUNT; i++) {
+        err = hmThreadJoin(&threads[i], THREAD_JOIN_TIMEOUT);
+        HM_TEST_ASSERT_OK(err);
+        err = hmThreadGetExitError(&threads[i]);
+        HM_TEST_ASSERT_OK(err);
+        err = hmThreadDispose(&threads[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(hmMethodIsCompiled(&table.methods[NOT_COMPILED_METHOD_ID]));
+    for (hm_nint i = 0; i < SHARED_METHODS_THREAD_COUNT; i++) {
+        err = hmJitDispose(&contexts[i].jit);
+        HM_TEST_ASSERT_OK(err);
+    }
+    dispose_test_methods(&table);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_interpreter_can_be_created()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmInterpreter interpreter;
+    hmError err = hmCreateInterpreter(&allocator, 0, HM_INTERPRETER_DEFAULT_FRAME_COUNT, HM_NULL, HM_NULL, HM_NULL, &interpreter);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateInterpreter(&allocator, HM_INTERPRETER_DEFAULT_REGISTER_COUNT, HM_INTERPRETER_DEFAULT_FRAME_COUNT, HM_NULL, HM_NULL, HM_NULL, &interpreter);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    err = hmInterpreterDispose(&interpreter);
+    HM_TEST_ASSERT_OK(err);
+HM_TEST_ON_FINALIZE
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(interpreters)
+    HM_TEST_RUN(test_interpreter_can_be_created)
+    HM_TEST_RUN_WITHOUT_OOM(test_interpreter_runs_methods)
+    HM_TEST_RUN_WITHOUT_OOM(test_interpreter_compiles_methods_on_first_call)
+    HM_TEST_RUN_WITHOUT_OOM(test_interpreter_reports_stack_overflow)
+    HM_TEST_RUN_WITHOUT_OOM(test_interpreter_rejects_reentrant_runs)
+    HM_TEST_RUN_WITHOUT_OOM(test_interpreter_runs_jit_compiled_methods)
+    HM_TEST_RUN_WITHOUT_OOM(test_interpreter_falls_back_if_code_heap_is_full)
+    HM_TEST_RUN_WITHOUT_OOM(test_interpreters_of_several_threads_share_methods)
+HM_TEST_SUITE_END()
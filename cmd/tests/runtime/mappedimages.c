@@ -0,0 +1,408 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <runtime/mappedimage.h>
+#include <core/utils.h>
+#include <io/writer.h>
+#include <vendor/sqlite3/sqlite3.h>
+
+#include <stdio.h> /* for snprintf(..) */
+#include <stdlib.h> /* for mkstemp(..) */
+#include <string.h> /* for strlen(..) */
+#include <unistd.h> /* for close(..), unlink(..) */
+
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
+#define MAX_TEST_OBJECT_COUNT 8
+
+/* IDs are deliberately out of order: the converter sorts them. */
+#define TEST_IMAGE_SQL \
+    "CREATE TABLE module (module_id INTEGER PRIMARY KEY, name TEXT);" \
+    "CREATE TABLE class (class_id INTEGER PRIMARY KEY, module_id INTEGER, name TEXT);" \
+    "CREATE TABLE method (method_id INTEGER PRIMARY KEY, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);" \
+    "INSERT INTO module VALUES (7, 'core'), (3, 'net');" \
+    "INSERT INTO class VALUES (20, 7, 'String'), (10, 3, 'Socket'), (15, 7, 'Array');" \
+    "INSERT INTO method VALUES (102, 20, 7, 'length', '()I', x'01020304');" \
+    "INSERT INTO method VALUES (100, 10, 3, 'close', '()V', x'0A00');" \
+    "INSERT INTO method VALUES (101, 15, 7, 'length', '()I', x'0B0C0D0E0F10111213');"
+
+/* A module without classes and a class without methods are also part of joined metadata. */
+#define JOINED_TEST_IMAGE_SQL \
+    TEST_IMAGE_SQL \
+    "INSERT INTO module VALUES (5, 'io');" \
+    "INSERT INTO class VALUES (30, 3, 'Stream');"
+#define JOINED_TEST_IMAGE_TRACE "M3 C10 m100 C30 M5 M7 C15 m101 C20 m102 "
+
+typedef struct {
+    hm_metadata_id ids[MAX_TEST_OBJECT_COUNT];
+    char           names[MAX_TEST_OBJECT_COUNT][16];
+    hm_method_size body_sizes[MAX_TEST_OBJECT_COUNT];
+    hm_uint8       first_opcodes[MAX_TEST_OBJECT_COUNT];
+    hm_nint        count;
+} collected_metadata;
+
+static void create_temp_path(char* path_buffer)
+{
+    hmCopyMemory(path_buffer, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    int file_desc = mkstemp(path_buffer);
+    HM_TEST_ASSERT(file_desc != -1);
+    HM_TEST_ASSERT(close(file_desc) == 0);
+}
+
+static void create_sqlite_image(const char* path, const char* sql)
+{
+    sqlite3* db = HM_NULL;
+    HM_TEST_ASSERT(sqlite3_open(path, &db) == SQLITE_OK);
+    HM_TEST_ASSERT(sqlite3_exec(db, sql, HM_NULL, HM_NULL, HM_NULL) == SQLITE_OK);
+    HM_TEST_ASSERT(sqlite3_close(db) == SQLITE_OK);
+}
+
+static void collect_name(collected_metadata* collected, hm_metadata_id id, hmString* name)
+{
+    HM_TEST_ASSERT(collected->count < MAX_TEST_OBJECT_COUNT);
+    HM_TEST_ASSERT(hmStringGetLengthInBytes(name) < sizeof(collected->names[0]));
+    collected->ids[collected->count] = id;
+    hmCopyMemory(collected->names[collected->count], hmStringGetChars(name), hmStringGetLengthInBytes(name) + 1);
+}
+
+static hmError collect_module(hmModuleMetadata* metadata, void* user_data)
+{
+    collected_metadata* collected = (collected_metadata*)user_data;
+    collect_name(&collected[0], metadata->module_id, &metadata->name);
+    collected[0].count++;
+    return HM_OK;
+}
+
+static hmError collect_class(hmClassMetadata* metadata, void* user_data)
+{
+    collected_metadata* collected = (collected_metadata*)user_data;
+    collect_name(&collected[1], metadata->class_id, &metadata->name);
+    collected[1].count++;
+    return HM_OK;
+}
+
+static hmError collect_method(hmMethodMetadata* metadata, void* user_data)
+{
+    collected_metadata* collected = (collected_metadata*)user_data;
+    HM_TEST_ASSERT(hmStringEqualsToCString(&metadata->signature, metadata->method_id == 100 ? "()V" : "()I"));
+    collect_name(&collected[2], metadata->method_id, &metadata->name);
+    collected[2].count++;
+    return HM_OK;
+}
+
+/* `user_data` points to the slot of the method in the collected methods. */
+static hmError collect_method_body(hmMethodBodyMetadata* body, void* user_data)
+{
+    collected_metadata* collected = (collected_metadata*)user_data;
+    HM_TEST_ASSERT(((hm_nint)body->opcodes % 8) == 0); /* method bodies are aligned */
+    collected->body_sizes[collected->count] = body->size;
+    collected->first_opcodes[collected->count] = body->opcodes[0];
+    return HM_OK;
+}
+
+/* Records joined metadata as "M<module_id> C<class_id> m<method_id> ..." */
+static void trace_joined_metadata(char* trace, char kind, hm_metadata_id id)
+{
+    hm_nint length = strlen(trace);
+    int written = snprintf(trace + length, sizeof(JOINED_TEST_IMAGE_TRACE) * 2 - length, "%c%u ", kind, (unsigned)id);
+    HM_TEST_ASSERT(written > 0 && (hm_nint)written < sizeof(JOINED_TEST_IMAGE_TRACE) * 2 - length);
+}
+
+static hmError trace_joined_module(hmModuleMetadata* metadata, void* user_data)
+{
+    trace_joined_metadata((char*)user_data, 'M', metadata->module_id);
+    return HM_OK;
+}
+
+static hmError trace_joined_class(hmClassMetadata* metadata, void* user_data)
+{
+    trace_joined_metadata((char*)user_data, 'C', metadata->class_id);
+    return HM_OK;
+}
+
+static hmError trace_joined_method(hmMethodMetadata* metadata, void* user_data)
+{
+    trace_joined_metadata((char*)user_data, 'm', metadata->method_id);
+    return HM_OK;
+}
+
+static void write_file(const char* path, const hm_uint8* data, hm_nint size)
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmString path_string;
+    err = hmCreateStringViewFromCString(path, &path_string);
+    HM_TEST_ASSERT_OK(err);
+    hmWriter writer;
+    err = hmCreateFileWriter(&allocator, &path_string, HM_FALSE, &writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterWriteAll(&writer, (const char*)data, size);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWriterClose(&writer);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_mapped_image_round_trip()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)], mapped_image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_path(image_path_buffer);
+    create_temp_path(mapped_image_path_buffer);
+    create_sqlite_image(image_path_buffer, TEST_IMAGE_SQL);
+    hmString image_path, mapped_image_path;
+    hmError err = hmCreateStringViewFromCString(image_path_buffer, &image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(mapped_image_path_buffer, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmConvertImageFileToMappedImage(&allocator, &image_path, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loader;
+    err = hmCreateMappedImageMetadataLoader(&allocator, &mapped_image_path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    collected_metadata collected[3] = {{{0}}}; /* modules, classes, methods */
+    err = hmMetadataLoaderEnumMetadata(&loader, &collect_module, &collect_class, &collect_method, collected);
+    HM_TEST_ASSERT_OK(err);
+    /* Objects are enumerated in the order of their IDs. */
+    HM_TEST_ASSERT(collected[0].count == 2);
+    HM_TEST_ASSERT(collected[0].ids[0] == 3 && strcmp(collected[0].names[0], "net") == 0);
+    HM_TEST_ASSERT(collected[0].ids[1] == 7 && strcmp(collected[0].names[1], "core") == 0);
+    HM_TEST_ASSERT(collected[1].count == 3);
+    HM_TEST_ASSERT(collected[1].ids[0] == 10 && strcmp(collected[1].names[0], "Socket") == 0);
+    HM_TEST_ASSERT(collected[1].ids[1] == 15 && strcmp(collected[1].names[1], "Array") == 0);
+    HM_TEST_ASSERT(collected[1].ids[2] == 20 && strcmp(collected[1].names[2], "String") == 0);
+    HM_TEST_ASSERT(collected[2].count == 3);
+    /* Bodies are loaded separately, by ID (in any order). */
+    for (hm_nint i = 3; i > 0; i--) {
+        collected[2].count = i - 1;
+        err = hmMetadataLoaderLoadMethodBody(&loader, collected[2].ids[i - 1], &collect_method_body, &collected[2]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmMetadataLoaderLoadMethodBody(&loader, 103, &collect_method_body, &collected[2]);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    HM_TEST_ASSERT(collected[2].ids[0] == 100 && strcmp(collected[2].names[0], "close") == 0);
+    HM_TEST_ASSERT(collected[2].body_sizes[0] == 2 && collected[2].first_opcodes[0] == 0x0A);
+    HM_TEST_ASSERT(collected[2].ids[1] == 101 && strcmp(collected[2].names[1], "length") == 0);
+    HM_TEST_ASSERT(collected[2].body_sizes[1] == 9 && collected[2].first_opcodes[1] == 0x0B);
+    HM_TEST_ASSERT(collected[2].ids[2] == 102 && strcmp(collected[2].names[2], "length") == 0);
+    HM_TEST_ASSERT(collected[2].body_sizes[2] == 4 && collected[2].first_opcodes[2] == 0x01);
+    /* Only some of the callbacks can be provided. */
+    collected_metadata only_classes[3] = {{{0}}};
+    err = hmMetadataLoaderEnumMetadata(&loader, HM_NULL, &collect_class, HM_NULL, only_classes);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(only_classes[0].count == 0 && only_classes[1].count == 3 && only_classes[2].count == 0);
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(image_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(mapped_image_path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_mapped_image_converter_rejects_duplicate_ids()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)], mapped_image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_path(image_path_buffer);
+    create_temp_path(mapped_image_path_buffer);
+    create_sqlite_image(
+        image_path_buffer,
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core'), (1, 'net');"
+    );
+    hmString image_path, mapped_image_path;
+    hmError err = hmCreateStringViewFromCString(image_path_buffer, &image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(mapped_image_path_buffer, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmConvertImageFileToMappedImage(&allocator, &image_path, &mapped_image_path);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    HM_TEST_ASSERT(unlink(image_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(mapped_image_path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_mapped_image_loader_rejects_malformed_images()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_path(path_buffer);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    /* One module whose name is "m"; the string table is at 56. */
+    hm_uint8 image[] = {
+        'H', 'M', 'I', 'M', 1, 0, 0, 0,  /* magic, version */
+        1, 0, 0, 0, 0, 0, 0, 0,          /* module count, class count */
+        0, 0, 0, 0, 48, 0, 0, 0,         /* method count, module table offset */
+        56, 0, 0, 0, 56, 0, 0, 0,        /* class table offset, method table offset */
+        56, 0, 0, 0, 2, 0, 0, 0,         /* string table offset, string table size */
+        64, 0, 0, 0, 0, 0, 0, 0,         /* opcode area offset, opcode area size */
+        5, 0, 0, 0, 0, 0, 0, 0,          /* module #5 */
+        'm', 0, 0, 0, 0, 0, 0, 0         /* the string table */
+    };
+    /* The image itself is valid. */
+    write_file(path_buffer, image, sizeof(image));
+    hmMetadataLoader loader;
+    err = hmCreateMappedImageMetadataLoader(&allocator, &path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    collected_metadata collected[3] = {{{0}}};
+    err = hmMetadataLoaderEnumMetadata(&loader, &collect_module, HM_NULL, HM_NULL, collected);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(collected[0].count == 1 && collected[0].ids[0] == 5 && strcmp(collected[0].names[0], "m") == 0);
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    /* Corruptions detected when the image is loaded: index, value. */
+    const hm_uint8 load_corruptions[][2] = {
+        {0, 'X'},   /* magic */
+        {4, 2},     /* unknown version */
+        {8, 200},   /* too many modules */
+        {20, 44},   /* misaligned module table */
+        {32, 200},  /* the string table is out of range */
+        {57, 'x'}   /* the string table is not null-terminated */
+    };
+    for (hm_nint i = 0; i < sizeof(load_corruptions) / sizeof(load_corruptions[0]); i++) {
+        hm_uint8 corrupted_image[sizeof(image)];
+        hmCopyMemory(corrupted_image, image, sizeof(image));
+        corrupted_image[load_corruptions[i][0]] = load_corruptions[i][1];
+        write_file(path_buffer, corrupted_image, sizeof(corrupted_image));
+        err = hmCreateMappedImageMetadataLoader(&allocator, &path, &loader);
+        HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    }
+    /* A truncated image. */
+    write_file(path_buffer, image, 47 /* shorter than the header */);
+    err = hmCreateMappedImageMetadataLoader(&allocator, &path, &loader);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    /* A corruption detected when the image is enumerated: the name is out of the string table's range. */
+    image[52] = 2;
+    write_file(path_buffer, image, sizeof(image));
+    err = hmCreateMappedImageMetadataLoader(&allocator, &path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMetadataLoaderEnumMetadata(&loader, &collect_module, HM_NULL, HM_NULL, collected);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+/* Both loaders must produce the same joined metadata from the same image. */
+static void test_loaders_enumerate_joined_metadata_in_order()
+{
+    const char* orphaned_images[] = {
+        /* A class in a module which doesn't exist. */
+        "CREATE TABLE module (module_id INTEGER PRIMARY KEY, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER PRIMARY KEY, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER PRIMARY KEY, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 5, 'String');",
+        /* A method in a class which belongs to a different module. */
+        "CREATE TABLE module (module_id INTEGER PRIMARY KEY, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER PRIMARY KEY, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER PRIMARY KEY, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core'), (3, 'net');"
+        "INSERT INTO class VALUES (2, 1, 'String');"
+        "INSERT INTO method VALUES (4, 2, 3, 'length', '()I', x'01');"
+    };
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)], mapped_image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_path(image_path_buffer);
+    create_temp_path(mapped_image_path_buffer);
+    hmString image_path, mapped_image_path;
+    hmError err = hmCreateStringViewFromCString(image_path_buffer, &image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(mapped_image_path_buffer, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i <= sizeof(orphaned_images) / sizeof(orphaned_images[0]); i++) {
+        HM_TEST_ASSERT(unlink(image_path_buffer) == 0);
+        hm_bool is_valid = i == 0;
+        create_sqlite_image(image_path_buffer, is_valid ? JOINED_TEST_IMAGE_SQL : orphaned_images[i - 1]);
+        err = hmConvertImageFileToMappedImage(&allocator, &image_path, &mapped_image_path);
+        HM_TEST_ASSERT_OK(err);
+        hmMetadataLoader loaders[2];
+        err = hmCreateImageFileMetadataLoader(&allocator, &image_path, &loaders[0]);
+        HM_TEST_ASSERT_OK(err);
+        err = hmCreateMappedImageMetadataLoader(&allocator, &mapped_image_path, &loaders[1]);
+        HM_TEST_ASSERT_OK(err);
+        for (hm_nint j = 0; j < 2; j++) {
+            for (hm_nint k = 0; k < 2; k++) { /* Cached statements are reused. */
+                char trace[sizeof(JOINED_TEST_IMAGE_TRACE) * 2] = {0};
+                err = hmMetadataLoaderEnumJoinedMetadata(
+                    &loaders[j],
+                    &trace_joined_module,
+                    &trace_joined_class,
+                    &trace_joined_method,
+                    trace
+                );
+                if (is_valid) {
+                    HM_TEST_ASSERT_OK(err);
+                    HM_TEST_ASSERT(strcmp(trace, JOINED_TEST_IMAGE_TRACE) == 0);
+                } else {
+                    HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+                }
+            }
+            err = hmMetadataLoaderDispose(&loaders[j]);
+            HM_TEST_ASSERT_OK(err);
+        }
+    }
+    HM_TEST_ASSERT(unlink(image_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(mapped_image_path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_mapped_image_loader_can_be_created()
+{
+    char image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)], mapped_image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_temp_path(image_path_buffer);
+    create_temp_path(mapped_image_path_buffer);
+    create_sqlite_image(image_path_buffer, TEST_IMAGE_SQL);
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    HM_TEST_TRACK_OOM(&allocator, HM_FALSE);
+    hmString image_path, mapped_image_path;
+    hmError err = hmCreateStringViewFromCString(image_path_buffer, &image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(mapped_image_path_buffer, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmConvertImageFileToMappedImage(&allocator, &image_path, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_TRACK_OOM(&allocator, HM_TRUE);
+    hmMetadataLoader loader;
+    hm_bool is_loader_initialized = HM_FALSE;
+    err = hmCreateMappedImageMetadataLoader(&allocator, &mapped_image_path, &loader);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_loader_initialized = HM_TRUE;
+HM_TEST_ON_FINALIZE
+    if (is_loader_initialized) {
+        err = hmMetadataLoaderDispose(&loader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(unlink(image_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(mapped_image_path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(mapped_images)
+    HM_TEST_RUN_WITHOUT_OOM(test_mapped_image_round_trip)
+    HM_TEST_RUN_WITHOUT_OOM(test_mapped_image_converter_rejects_duplicate_ids)
+    HM_TEST_RUN_WITHOUT_OOM(test_mapped_image_loader_rejects_malformed_images)
+    HM_TEST_RUN_WITHOUT_OOM(test_loaders_enumerate_joined_metadata_in_order)
+    HM_TEST_RUN(test_mapped_image_loader_can_be_created)
+HM_TEST_SUITE_END()
@@ -12,7 +12,592 @@
 * ******************************************************************************/
 
 #include "../common.h"
+#include <runtime/moduleregistry.h>
+#include <runtime/mappedimage.h>
+#include <core/utils.h>
+#include <threading/thread.h>
+#include <vendor/sqlite3/sqlite3.h>
+
+#include <stdlib.h> /* for mkstemp(..) */
+#include <unistd.h> /* for close(..), unlink(..) */
+
+#define TEMP_FILE_PATH_TEMPLATE "/tmp/hammer_test_XXXXXX"
+
+#define TEST_IMAGE_SQL \
+    "CREATE TABLE module (module_id INTEGER PRIMARY KEY, name TEXT);" \
+    "CREATE TABLE class (class_id INTEGER PRIMARY KEY, module_id INTEGER, name TEXT);" \
+    "CREATE TABLE method (method_id INTEGER PRIMARY KEY, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);" \
+    "INSERT INTO module VALUES (7, 'core'), (3, 'net');" \
+    "INSERT INTO class VALUES (20, 7, 'String'), (10, 3, 'Socket');" \
+    "INSERT INTO method VALUES (102, 20, 7, 'length', '()I', x'01020304');" \
+    "INSERT INTO method VALUES (100, 10, 3, 'close', '()V', x'0A00');"
+
+static void create_temp_path(char* path_buffer)
+{
+    hmCopyMemory(path_buffer, TEMP_FILE_PATH_TEMPLATE, sizeof(TEMP_FILE_PATH_TEMPLATE));
+    int file_desc = mkstemp(path_buffer);
+    HM_TEST_ASSERT(file_desc != -1);
+    HM_TEST_ASSERT(close(file_desc) == 0);
+}
+
+static void create_sqlite_image(char* path_buffer, const char* sql)
+{
+    create_temp_path(path_buffer);
+    sqlite3* db = HM_NULL;
+    HM_TEST_ASSERT(sqlite3_open(path_buffer, &db) == SQLITE_OK);
+    HM_TEST_ASSERT(sqlite3_exec(db, sql, HM_NULL, HM_NULL, HM_NULL) == SQLITE_OK);
+    HM_TEST_ASSERT(sqlite3_close(db) == SQLITE_OK);
+}
+
+/* Methods #1..#1000 are split between two classes; the body of each method is one opcode: its ID modulo 127, plus 1. */
+#define LARGE_TEST_IMAGE_SQL \
+    "CREATE TABLE module (module_id INTEGER PRIMARY KEY, name TEXT);" \
+    "CREATE TABLE class (class_id INTEGER PRIMARY KEY, module_id INTEGER, name TEXT);" \
+    "CREATE TABLE method (method_id INTEGER PRIMARY KEY, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);" \
+    "INSERT INTO module VALUES (7, 'core');" \
+    "INSERT INTO class VALUES (20, 7, 'Even'), (21, 7, 'Odd');" \
+    "WITH RECURSIVE ids(id) AS (SELECT 1 UNION ALL SELECT id + 1 FROM ids WHERE id < 1000) " \
+    "INSERT INTO method SELECT id, 20 + id % 2, 7, 'method' || id, '()V', CAST(char(id % 127 + 1) AS BLOB) FROM ids;"
+#define LARGE_TEST_IMAGE_METHOD_COUNT 1000
+
+static void test_module_registry_loads_method_bodies_on_demand()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_sqlite_image(path_buffer, TEST_IMAGE_SQL);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loader;
+    err = hmCreateImageFileMetadataLoader(&allocator, &path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    hmModuleRegistry registry;
+    err = hmCreateModuleRegistry(&allocator, &registry);
+    HM_TEST_ASSERT_OK(err);
+    err = hmModuleRegistryLoad(&registry, &loader);
+    HM_TEST_ASSERT_OK(err);
+    hmModule* module = HM_NULL;
+    err = hmModuleRegistryGetModule(&registry, 7, &module);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(hmModuleGetName(module), "core"));
+    hmClass* hm_class = HM_NULL;
+    err = hmModuleGetClass(module, 20, &hm_class);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&hmClassGetName(hm_class), "String"));
+    err = hmModuleGetClass(module, 10, &hm_class);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND); /* belongs to a different module */
+    err = hmModuleGetClass(module, 20, &hm_class);
+    HM_TEST_ASSERT_OK(err);
+    hmMethod* method = HM_NULL;
+    err = hmClassGetMethod(hm_class, 102, &method);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmStringEqualsToCString(&hmMethodGetName(method), "length"));
+    HM_TEST_ASSERT(hmStringEqualsToCString(&method->signature, "()I"));
+    /* Only the declaration is loaded at first. */
+    HM_TEST_ASSERT(!hmMethodIsHLBodyLoaded(method));
+    hmMethodBody* body = HM_NULL;
+    err = hmMethodGetHLBody(method, &body);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmMethodIsHLBodyLoaded(method));
+    HM_TEST_ASSERT(body->size == 4 && body->opcodes[0] == 0x01 && body->opcodes[3] == 0x04);
+    hmMethodBody* same_body = HM_NULL;
+    err = hmMethodGetHLBody(method, &same_body);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(same_body == body);
+    /* The lookup statement is reused for other methods. */
+    err = hmModuleRegistryGetModule(&registry, 3, &module);
+    HM_TEST_ASSERT_OK(err);
+    err = hmModuleGetClass(module, 10, &hm_class);
+    HM_TEST_ASSERT_OK(err);
+    err = hmClassGetMethod(hm_class, 100, &method);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMethodGetHLBody(method, &body);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(body->size == 2 && body->opcodes[0] == 0x0A);
+    err = hmMetadataLoaderLoadMethodBody(&loader, 101, HM_NULL, HM_NULL);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    err = hmModuleRegistryDispose(&registry);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_module_registry_rejects_invalid_metadata()
+{
+    const char* invalid_images[] = {
+        /* Duplicate module IDs. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core'), (1, 'net');",
+        /* A class in a module which doesn't exist. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 5, 'String');",
+        /* A method in a class which doesn't exist. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 1, 'String');"
+        "INSERT INTO method VALUES (3, 4, 1, 'length', '()I', x'01');",
+        /* The same method ID in different classes. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 1, 'String'), (4, 1, 'Array');"
+        "INSERT INTO method VALUES (3, 2, 1, 'length', '()I', x'01'), (3, 4, 1, 'length', '()I', x'01');",
+        /* A malformed signature. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 1, 'String');"
+        "INSERT INTO method VALUES (3, 2, 1, 'length', '(V)I', x'01');",
+        /* An invalid name. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, '1core');"
+    };
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    for (hm_nint i = 0; i < sizeof(invalid_images) / sizeof(invalid_images[0]); i++) {
+        char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+        create_sqlite_image(path_buffer, invalid_images[i]);
+        hmString path;
+        hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+        HM_TEST_ASSERT_OK(err);
+        hmMetadataLoader loader;
+        err = hmCreateImageFileMetadataLoader(&allocator, &path, &loader);
+        HM_TEST_ASSERT_OK(err);
+        hmModuleRegistry registry;
+        err = hmCreateModuleRegistry(&allocator, &registry);
+        HM_TEST_ASSERT_OK(err);
+        err = hmModuleRegistryLoad(&registry, &loader);
+        HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+        err = hmModuleRegistryDispose(&registry);
+        HM_TEST_ASSERT_OK(err);
+        err = hmMetadataLoaderDispose(&loader);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_module_registry_can_load_modules()
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_sqlite_image(path_buffer, TEST_IMAGE_SQL);
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loader;
+    hmModuleRegistry registry;
+    hm_bool is_loader_initialized = HM_FALSE, is_registry_initialized = HM_FALSE;
+    err = hmCreateImageFileMetadataLoader(&allocator, &path, &loader);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_loader_initialized = HM_TRUE;
+    err = hmCreateModuleRegistry(&allocator, &registry);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_registry_initialized = HM_TRUE;
+    err = hmModuleRegistryLoad(&registry, &loader);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    hmModule* module = HM_NULL;
+    err = hmModuleRegistryGetModule(&registry, 7, &module);
+    HM_TEST_ASSERT_OK(err);
+    hmClass* hm_class = HM_NULL;
+    err = hmModuleGetClass(module, 20, &hm_class);
+    HM_TEST_ASSERT_OK(err);
+    hmMethod* method = HM_NULL;
+    err = hmClassGetMethod(hm_class, 102, &method);
+    HM_TEST_ASSERT_OK(err);
+    hmMethod* same_method = HM_NULL;
+    err = hmModuleRegistryGetMethod(&registry, 102, &same_method);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(same_method == method);
+    hmMethodBody* body = HM_NULL;
+    err = hmMethodGetHLBody(method, &body);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+HM_TEST_ON_FINALIZE
+    if (is_registry_initialized) {
+        err = hmModuleRegistryDispose(&registry);
+        HM_TEST_ASSERT_OK(err);
+    }
+    if (is_loader_initialized) {
+        err = hmMetadataLoaderDispose(&loader);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+typedef struct {
+    hm_metadata_id method_ids[LARGE_TEST_IMAGE_METHOD_COUNT];
+    hm_nint        method_count;
+} hmTestEnumeratedMethods;
+
+static hmError enum_methods_func(hmMethod* method, void* user_data)
+{
+    hmTestEnumeratedMethods* enumerated_methods = (hmTestEnumeratedMethods*)user_data;
+    HM_TEST_ASSERT(enumerated_methods->method_count < LARGE_TEST_IMAGE_METHOD_COUNT);
+    enumerated_methods->method_ids[enumerated_methods->method_count++] = hmMethodGetID(method);
+    return HM_OK;
+}
+
+static hmError fail_enum_methods_func(hmMethod* method, void* user_data)
+{
+    (*(hm_nint*)user_data)++;
+    return HM_ERROR_INVALID_STATE;
+}
+
+static void load_image(hmAllocator* allocator, hmModuleRegistry* registry, const char* sql, hmError expected_err)
+{
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_sqlite_image(path_buffer, sql);
+    hmString path;
+    hmError err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loader;
+    err = hmCreateImageFileMetadataLoader(allocator, &path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    err = hmModuleRegistryLoad(registry, &loader);
+    HM_TEST_ASSERT(err == expected_err);
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+}
+
+/* Method IDs are unique across images, so the method table of the registry grows to cover every loaded image. */
+static void test_module_registry_looks_up_methods_by_id()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmModuleRegistry registry;
+    hmError err = hmCreateModuleRegistry(&allocator, &registry);
+    HM_TEST_ASSERT_OK(err);
+    load_image(&allocator, &registry, TEST_IMAGE_SQL, HM_OK);
+    /* Method IDs which are smaller than those loaded before. */
+    load_image(
+        &allocator,
+        &registry,
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (5, 'io');"
+        "INSERT INTO class VALUES (30, 5, 'File');"
+        "INSERT INTO method VALUES (50, 30, 5, 'open', '()V', x'01'), (52, 30, 5, 'read', '()I', x'01');",
+        HM_OK
+    );
+    const hm_metadata_id method_ids[] = { 50, 52, 100, 102 };
+    const char* method_names[] = { "open", "read", "close", "length" };
+    for (hm_nint i = 0; i < sizeof(method_ids) / sizeof(method_ids[0]); i++) {
+        hmMethod* method = HM_NULL;
+        err = hmModuleRegistryGetMethod(&registry, method_ids[i], &method);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(hmStringEqualsToCString(&hmMethodGetName(method), method_names[i]));
+    }
+    /* Signatures are interned: "()V" and "()I" are shared across images. */
+    hmMethod *close_method = HM_NULL, *open_method = HM_NULL, *length_method = HM_NULL, *read_method = HM_NULL;
+    HM_TEST_ASSERT_OK(hmModuleRegistryGetMethod(&registry, 100, &close_method));
+    HM_TEST_ASSERT_OK(hmModuleRegistryGetMethod(&registry, 50, &open_method));
+    HM_TEST_ASSERT_OK(hmModuleRegistryGetMethod(&registry, 102, &length_method));
+    HM_TEST_ASSERT_OK(hmModuleRegistryGetMethod(&registry, 52, &read_method));
+    HM_TEST_ASSERT(close_method->parsed_signature_opt == open_method->parsed_signature_opt);
+    HM_TEST_ASSERT(length_method->parsed_signature_opt == read_method->parsed_signature_opt);
+    HM_TEST_ASSERT(length_method->parsed_signature_opt != close_method->parsed_signature_opt);
+    HM_TEST_ASSERT(length_method->parsed_signature_opt->return_type == HM_VALUE_TYPE_INT32);
+    HM_TEST_ASSERT(hmSignatureTableGetCount(&registry.signatures) == 2);
+    hmMethod* call_target = HM_NULL;
+    hmSignature* call_target_signature = HM_NULL;
+    /* Signatures of the methods loaded before are moved together with them when lower IDs are added. */
+    for (hm_nint i = 0; i < sizeof(method_ids) / sizeof(method_ids[0]); i++) {
+        err = hmModuleRegistryResolveCallTargetFunc(method_ids[i], &registry, &call_target, &call_target_signature);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(hmMethodGetID(call_target) == method_ids[i]);
+        HM_TEST_ASSERT(call_target_signature == call_target->parsed_signature_opt);
+    }
+    err = hmModuleRegistryResolveCallTargetFunc(101, &registry, &call_target, &call_target_signature);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    /* Methods are enumerated in the order of IDs, regardless of the order of loading. */
+    hmTestEnumeratedMethods enumerated_methods;
+    enumerated_methods.method_count = 0;
+    err = hmModuleRegistryEnumMethods(&registry, &enum_methods_func, &enumerated_methods);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(enumerated_methods.method_count == sizeof(method_ids) / sizeof(method_ids[0]));
+    for (hm_nint i = 0; i < enumerated_methods.method_count; i++) {
+        HM_TEST_ASSERT(enumerated_methods.method_ids[i] == method_ids[i]);
+    }
+    hm_nint call_count = 0;
+    err = hmModuleRegistryEnumMethods(&registry, &fail_enum_methods_func, &call_count);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    HM_TEST_ASSERT(call_count == 1);
+    const hm_metadata_id unknown_method_ids[] = { 0, 49, 51, 101, 103, 0xFFFFFFFF };
+    for (hm_nint i = 0; i < sizeof(unknown_method_ids) / sizeof(unknown_method_ids[0]); i++) {
+        hmMethod* method = HM_NULL;
+        err = hmModuleRegistryGetMethod(&registry, unknown_method_ids[i], &method);
+        HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    }
+    /* Too sparse IDs. */
+    load_image(
+        &allocator,
+        &registry,
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (6, 'math');"
+        "INSERT INTO class VALUES (31, 6, 'Vector');"
+        "INSERT INTO method VALUES (4000000000, 31, 6, 'length', '()I', x'01');",
+        HM_ERROR_LIMIT_EXCEEDED
+    );
+    /* Duplicate IDs across images. */
+    load_image(
+        &allocator,
+        &registry,
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (8, 'text');"
+        "INSERT INTO class VALUES (32, 8, 'Regex');"
+        "INSERT INTO method VALUES (52, 32, 8, 'match', '()I', x'01');",
+        HM_ERROR_INVALID_DATA
+    );
+    err = hmModuleRegistryDispose(&registry);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void assert_large_test_image_is_loaded(hmModuleRegistry* registry)
+{
+    hmModule* module = HM_NULL;
+    hmError err = hmModuleRegistryGetModule(registry, 7, &module);
+    HM_TEST_ASSERT_OK(err);
+    hmClass* classes[2];
+    err = hmModuleGetClass(module, 20, &classes[0]);
+    HM_TEST_ASSERT_OK(err);
+    err = hmModuleGetClass(module, 21, &classes[1]);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmHashMapGetCount(&classes[0]->methods) == LARGE_TEST_IMAGE_METHOD_COUNT / 2);
+    HM_TEST_ASSERT(hmHashMapGetCount(&classes[1]->methods) == LARGE_TEST_IMAGE_METHOD_COUNT / 2);
+    for (hm_metadata_id method_id = 1; method_id <= LARGE_TEST_IMAGE_METHOD_COUNT; method_id++) {
+        hmMethod* method = HM_NULL;
+        err = hmClassGetMethod(classes[method_id % 2], method_id, &method);
+        HM_TEST_ASSERT_OK(err);
+        char expected_name[16];
+        snprintf(expected_name, sizeof(expected_name), "method%u", method_id);
+        HM_TEST_ASSERT(hmStringEqualsToCString(&hmMethodGetName(method), expected_name));
+        hmMethod* same_method = HM_NULL;
+        err = hmModuleRegistryGetMethod(registry, method_id, &same_method);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(same_method == method);
+        HM_TEST_ASSERT(method->body_allocator == registry->allocator); /* not the arena: bodies are loaded on workers */
+        hmMethodBody* body = HM_NULL;
+        err = hmMethodGetHLBody(method, &body);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(body->size == 1 && body->opcodes[0] == method_id % 127 + 1);
+    }
+    hmTestEnumeratedMethods enumerated_methods;
+    enumerated_methods.method_count = 0;
+    err = hmModuleRegistryEnumMethods(registry, &enum_methods_func, &enumerated_methods);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(enumerated_methods.method_count == LARGE_TEST_IMAGE_METHOD_COUNT);
+    for (hm_nint i = 0; i < LARGE_TEST_IMAGE_METHOD_COUNT; i++) {
+        HM_TEST_ASSERT(enumerated_methods.method_ids[i] == i + 1);
+    }
+}
+
+static void load_in_parallel(hmAllocator* allocator, hmMetadataLoader* loader, hm_nint worker_count, hmError expected_err)
+{
+    hmModuleRegistry registry;
+    hmError err = hmCreateModuleRegistry(allocator, &registry);
+    HM_TEST_ASSERT_OK(err);
+    err = hmModuleRegistryLoadInParallel(&registry, loader, worker_count);
+    HM_TEST_ASSERT(err == expected_err);
+    if (expected_err == HM_OK) {
+        assert_large_test_image_is_loaded(&registry);
+    }
+    err = hmModuleRegistryDispose(&registry);
+    HM_TEST_ASSERT_OK(err);
+}
+
+/* Workers need a thread-safe allocator, so OOM simulation is not possible. */
+static void test_module_registry_loads_methods_in_parallel()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    char image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)], mapped_image_path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_sqlite_image(image_path_buffer, LARGE_TEST_IMAGE_SQL);
+    create_temp_path(mapped_image_path_buffer);
+    hmString image_path, mapped_image_path;
+    err = hmCreateStringViewFromCString(image_path_buffer, &image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateStringViewFromCString(mapped_image_path_buffer, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    err = hmConvertImageFileToMappedImage(&allocator, &image_path, &mapped_image_path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loaders[2];
+    err = hmCreateImageFileMetadataLoader(&allocator, &image_path, &loaders[0]);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCreateMappedImageMetadataLoader(&allocator, &mapped_image_path, &loaders[1]);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < 2; i++) {
+        hm_metadata_id min_method_id = 0, max_method_id = 0;
+        err = hmMetadataLoaderGetMethodIDRange(&loaders[i], &min_method_id, &max_method_id);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(min_method_id == 1 && max_method_id == LARGE_TEST_IMAGE_METHOD_COUNT);
+        load_in_parallel(&allocator, &loaders[i], 1, HM_OK);
+        load_in_parallel(&allocator, &loaders[i], 3, HM_OK); /* partitions of uneven sizes */
+        load_in_parallel(&allocator, &loaders[i], 8, HM_OK);
+        load_in_parallel(&allocator, &loaders[i], 0, HM_ERROR_INVALID_ARGUMENT);
+        /* For comparison. */
+        hmModuleRegistry registry;
+        err = hmCreateModuleRegistry(&allocator, &registry);
+        HM_TEST_ASSERT_OK(err);
+        err = hmModuleRegistryLoad(&registry, &loaders[i]);
+        HM_TEST_ASSERT_OK(err);
+        assert_large_test_image_is_loaded(&registry);
+        err = hmModuleRegistryDispose(&registry);
+        HM_TEST_ASSERT_OK(err);
+        err = hmMetadataLoaderDispose(&loaders[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(unlink(image_path_buffer) == 0);
+    HM_TEST_ASSERT(unlink(mapped_image_path_buffer) == 0);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+#define CONCURRENT_LOAD_THREAD_COUNT 4
+#define THREAD_JOIN_TIMEOUT (5*1000)
+
+typedef struct {
+    hmModuleRegistry* registry;
+    hmMethodBody*     bodies[LARGE_TEST_IMAGE_METHOD_COUNT];
+} hmTestConcurrentLoadContext;
+
+static hmError load_method_bodies_thread_func(void* user_data)
+{
+    hmTestConcurrentLoadContext* context = (hmTestConcurrentLoadContext*)user_data;
+    for (hm_metadata_id method_id = 1; method_id <= LARGE_TEST_IMAGE_METHOD_COUNT; method_id++) {
+        hmMethod* method = HM_NULL;
+        HM_TRY(hmModuleRegistryGetMethod(context->registry, method_id, &method));
+        HM_TRY(hmMethodGetHLBody(method, &context->bodies[method_id - 1]));
+    }
+    return HM_OK;
+}
+
+/* Workers which call the same methods for the first time at the same time all end up with the same copy of each body. */
+static void test_module_registry_loads_method_bodies_concurrently()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+    create_sqlite_image(path_buffer, LARGE_TEST_IMAGE_SQL);
+    hmString path;
+    err = hmCreateStringViewFromCString(path_buffer, &path);
+    HM_TEST_ASSERT_OK(err);
+    hmMetadataLoader loader;
+    err = hmCreateImageFileMetadataLoader(&allocator, &path, &loader);
+    HM_TEST_ASSERT_OK(err);
+    hmModuleRegistry registry;
+    err = hmCreateModuleRegistry(&allocator, &registry);
+    HM_TEST_ASSERT_OK(err);
+    err = hmModuleRegistryLoad(&registry, &loader);
+    HM_TEST_ASSERT_OK(err);
+    hmTestConcurrentLoadContext contexts[CONCURRENT_LOAD_THREAD_COUNT];
+    hmThread threads[CONCURRENT_LOAD_THREAD_COUNT];
+    for (hm_nint i = 0; i < CONCURRENT_LOAD_THREAD_COUNT; i++) {
+        contexts[i].registry = &registry;
+        err = hmCreateThread(&allocator, HM_NULL, &load_method_bodies_thread_func, &contexts[i], &threads[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    for (hm_nint i = 0; i < CONCURRENT_LOAD_THREAD_COUNT; i++) {
+        err = hmThreadJoin(&threads[i], THREAD_JOIN_TIMEOUT);
+        HM_TEST_ASSERT_OK(err);
+        err = hmThreadGetExitError(&threads[i]);
+        HM_TEST_ASSERT_OK(err);
+        err = hmThreadDispose(&threads[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    for (hm_nint i = 0; i < LARGE_TEST_IMAGE_METHOD_COUNT; i++) {
+        hmMethodBody* body = contexts[0].bodies[i];
+        HM_TEST_ASSERT(body->size == 1 && body->opcodes[0] == (i + 1) % 127 + 1);
+        for (hm_nint j = 1; j < CONCURRENT_LOAD_THREAD_COUNT; j++) {
+            HM_TEST_ASSERT(contexts[j].bodies[i] == body);
+        }
+    }
+    err = hmModuleRegistryDispose(&registry);
+    HM_TEST_ASSERT_OK(err);
+    err = hmMetadataLoaderDispose(&loader);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+/* Errors which happen on worker threads are reported, and methods loaded so far are disposed of properly. */
+static void test_module_registry_rejects_invalid_metadata_in_parallel()
+{
+    const char* invalid_images[] = {
+        /* A method in a class which doesn't exist. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 1, 'String');"
+        "INSERT INTO method VALUES (3, 2, 1, 'length', '()I', x'01'), (40, 4, 1, 'trim', '()V', x'01');",
+        /* An invalid name (validated on a worker thread). */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 1, 'String');"
+        "INSERT INTO method VALUES (3, 2, 1, 'length', '()I', x'01'), (40, 2, 1, 'trim()', '()V', x'01');",
+        /* Duplicate method IDs in different partitions can't happen, so: duplicate IDs in the same partition. */
+        "CREATE TABLE module (module_id INTEGER, name TEXT);"
+        "CREATE TABLE class (class_id INTEGER, module_id INTEGER, name TEXT);"
+        "CREATE TABLE method (method_id INTEGER, class_id INTEGER, module_id INTEGER, name TEXT, signature TEXT, code BLOB);"
+        "INSERT INTO module VALUES (1, 'core');"
+        "INSERT INTO class VALUES (2, 1, 'String');"
+        "INSERT INTO method VALUES (3, 2, 1, 'length', '()I', x'01'), (3, 2, 1, 'trim', '()V', x'01');"
+    };
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < sizeof(invalid_images) / sizeof(invalid_images[0]); i++) {
+        char path_buffer[sizeof(TEMP_FILE_PATH_TEMPLATE)];
+        create_sqlite_image(path_buffer, invalid_images[i]);
+        hmString path;
+        err = hmCreateStringViewFromCString(path_buffer, &path);
+        HM_TEST_ASSERT_OK(err);
+        hmMetadataLoader loader;
+        err = hmCreateImageFileMetadataLoader(&allocator, &path, &loader);
+        HM_TEST_ASSERT_OK(err);
+        load_in_parallel(&allocator, &loader, 2, HM_ERROR_INVALID_DATA);
+        err = hmMetadataLoaderDispose(&loader);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(unlink(path_buffer) == 0);
+    }
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
 
 HM_TEST_SUITE_BEGIN(modules)
-    /* TODO add tests */
+    HM_TEST_RUN_WITHOUT_OOM(test_module_registry_loads_method_bodies_on_demand)
+    HM_TEST_RUN_WITHOUT_OOM(test_module_registry_rejects_invalid_metadata)
+    HM_TEST_RUN(test_module_registry_can_load_modules)
+    HM_TEST_RUN_WITHOUT_OOM(test_module_registry_looks_up_methods_by_id)
+    HM_TEST_RUN_WITHOUT_OOM(test_module_registry_loads_methods_in_parallel)
+    HM_TEST_RUN_WITHOUT_OOM(test_module_registry_rejects_invalid_metadata_in_parallel)
+    HM_TEST_RUN_WITHOUT_OOM(test_module_registry_loads_method_bodies_concurrently)
 HM_TEST_SUITE_END()
@@ -12,7 +12,107 @@
 * ******************************************************************************/
 
 #include "../common.h"
+#include <runtime/signature.h>
+
+static void test_signature_parses_valid_signatures()
+{
+    const struct {
+        const char* encoded;
+        hm_uint16   param_count;
+        hmValueType param_types[2];
+        hmValueType return_type;
+    } signatures[] = {
+        { "()V", 0, { 0 }, HM_VALUE_TYPE_VOID },
+        { "()J", 0, { 0 }, HM_VALUE_TYPE_INT64 },
+        { "(I)V", 1, { HM_VALUE_TYPE_INT32 }, HM_VALUE_TYPE_VOID },
+        { "(JI)I", 2, { HM_VALUE_TYPE_INT64, HM_VALUE_TYPE_INT32 }, HM_VALUE_TYPE_INT32 }
+    };
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmError err = HM_OK;
+    for (hm_nint i = 0; i < sizeof(signatures) / sizeof(signatures[0]); i++) {
+        hmString encoded;
+        err = hmCreateStringViewFromCString(signatures[i].encoded, &encoded);
+        HM_TEST_ASSERT_OK(err);
+        hmSignature signature;
+        err = hmParseSignature(&allocator, &encoded, &signature);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+        HM_TEST_ASSERT(signature.param_count == signatures[i].param_count);
+        HM_TEST_ASSERT(signature.return_type == signatures[i].return_type);
+        for (hm_nint j = 0; j < signature.param_count; j++) {
+            HM_TEST_ASSERT(signature.param_types[j] == signatures[i].param_types[j]);
+        }
+        if (signature.param_types) {
+            hmFree(&allocator, signature.param_types);
+        }
+    }
+HM_TEST_ON_FINALIZE
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_signature_rejects_malformed_signatures()
+{
+    const char* signatures[] = { "", "V", "()", "(V", "(I)", "I)V", "(V)V", "(X)V", "()X", "(I)VV", "((I)V" };
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < sizeof(signatures) / sizeof(signatures[0]); i++) {
+        hmString encoded;
+        err = hmCreateStringViewFromCString(signatures[i], &encoded);
+        HM_TEST_ASSERT_OK(err);
+        hmSignature signature;
+        err = hmParseSignature(&allocator, &encoded, &signature);
+        HM_TEST_ASSERT(err == HM_ERROR_INVALID_DATA);
+    }
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_signature_table_interns_signatures()
+{
+    const char* encoded_signatures[] = { "(JI)I", "()V", "(JI)I", "(JI)J", "()V" };
+    const hm_nint canonical_indices[] = { 0, 1, 0, 3, 1 };
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmSignatureTable table;
+    hm_bool is_table_created = HM_FALSE;
+    hmError err = hmCreateSignatureTable(&allocator, &table);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_table_created = HM_TRUE;
+    hmSignature* signatures[sizeof(encoded_signatures) / sizeof(encoded_signatures[0])];
+    for (hm_nint i = 0; i < sizeof(encoded_signatures) / sizeof(encoded_signatures[0]); i++) {
+        /* A new buffer every time: signatures are interned by content, not by address. */
+        hmString encoded;
+        err = hmCreateStringFromCString(&allocator, encoded_signatures[i], &encoded);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+        err = hmSignatureTableIntern(&table, &encoded, &signatures[i]);
+        err = hmMergeErrors(err, hmStringDispose(&encoded));
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+        HM_TEST_ASSERT(signatures[i] == signatures[canonical_indices[i]]);
+    }
+    HM_TEST_ASSERT(hmSignatureTableGetCount(&table) == 3);
+    HM_TEST_ASSERT(signatures[0]->param_count == 2 && signatures[0]->return_type == HM_VALUE_TYPE_INT32);
+    HM_TEST_ASSERT(signatures[0]->param_types[0] == HM_VALUE_TYPE_INT64 && signatures[0]->param_types[1] == HM_VALUE_TYPE_INT32);
+    HM_TEST_ASSERT(signatures[3]->return_type == HM_VALUE_TYPE_INT64);
+    HM_TEST_ASSERT(signatures[1]->param_count == 0 && signatures[1]->return_type == HM_VALUE_TYPE_VOID);
+    /* Malformed signatures aren't added. */
+    hmString malformed;
+    err = hmCreateStringViewFromCString("(V)V", &malformed);
+    HM_TEST_ASSERT_OK(err);
+    hmSignature* signature = HM_NULL;
+    err = hmSignatureTableIntern(&table, &malformed, &signature);
+    HM_TEST_ASSERT_ERROR_OR_OOM(HM_ERROR_INVALID_DATA, err);
+    HM_TEST_ASSERT(hmSignatureTableGetCount(&table) == 3);
+HM_TEST_ON_FINALIZE
+    if (is_table_created) {
+        err = hmSignatureTableDispose(&table);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
 
 HM_TEST_SUITE_BEGIN(signatures)
-    /* TODO add tests */
+    HM_TEST_RUN(test_signature_parses_valid_signatures)
+    HM_TEST_RUN_WITHOUT_OOM(test_signature_rejects_malformed_signatures)
+    HM_TEST_RUN(test_signature_table_interns_signatures)
 HM_TEST_SUITE_END()
@@ -0,0 +1,187 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <runtime/lowering.h>
+#include <core/utils.h>
+
+#define TEST_CALLEE_ID 42
+
+static hmValueType test_param_types[] = { HM_VALUE_TYPE_INT32, HM_VALUE_TYPE_INT64 };
+static hmSignature test_signature = { test_param_types, 2, HM_VALUE_TYPE_INT64 }; /* (IJ)J */
+static hmSignature test_void_signature = { HM_NULL, 0, HM_VALUE_TYPE_VOID };     /* ()V */
+static hmValueType test_callee_param_types[] = { HM_VALUE_TYPE_INT64, HM_VALUE_TYPE_INT32 };
+static hmSignature test_callee_signature = { test_callee_param_types, 2, HM_VALUE_TYPE_INT64 }; /* (JI)J */
+static hmMethod test_callee;
+
+static hmError resolve_test_call_target(
+    hm_metadata_id method_id,
+    void*          user_data,
+    hmMethod**     out_method,
+    hmSignature**  out_signature
+)
+{
+    if (method_id != TEST_CALLEE_ID) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    *out_method = &test_callee;
+    *out_signature = &test_callee_signature;
+    return HM_OK;
+}
+
+static hm_nint append_bytes(hm_uint8* buffer, hm_nint offset, const void* bytes, hm_nint size)
+{
+    hmCopyMemory(buffer + offset, bytes, size);
+    return offset + size;
+}
+
+static hm_nint append_registers(hm_uint8* buffer, hm_nint offset, hm_uint16 dest_register, hm_uint16 source_register)
+{
+    offset = append_bytes(buffer, offset, &dest_register, sizeof(dest_register));
+    return append_bytes(buffer, offset, &source_register, sizeof(source_register));
+}
+
+static hm_nint append_mov(hm_uint8* buffer, hm_nint offset, hm_uint16 dest_register, hm_uint16 source_register)
+{
+    hmLLOpcode opcode = HM_LLOPCODE_MOV;
+    offset = append_bytes(buffer, offset, &opcode, sizeof(opcode));
+    return append_registers(buffer, offset, dest_register, source_register);
+}
+
+static void test_verifier_lowers_valid_bytecode()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hm_uint8 hl_opcodes[] = {
+        HM_HLOPCODE_LDC32, 5, 0, 0, 0,
+        HM_HLOPCODE_STLOC, 0, 0,
+        HM_HLOPCODE_LDARG, 1, 0,
+        HM_HLOPCODE_LDLOC, 0, 0,
+        HM_HLOPCODE_CALL, TEST_CALLEE_ID, 0, 0, 0,
+        HM_HLOPCODE_DUP,
+        HM_HLOPCODE_POP,
+        HM_HLOPCODE_NOP
+    };
+    hmMethodBody hl_body = { hl_opcodes, sizeof(hl_opcodes) };
+    hmVerifiedMethodBody verified_body;
+    hm_bool is_verified_body_initialized = HM_FALSE;
+    hmError err = hmVerifyMethodBody(&allocator, &hl_body, &test_signature, &resolve_test_call_target, HM_NULL, &verified_body);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    is_verified_body_initialized = HM_TRUE;
+    HM_TEST_ASSERT(hmArrayGetCount(&verified_body.instructions) == 8);
+    HM_TEST_ASSERT(hmVerifiedMethodBodyGetLocalCount(&verified_body) == 1);
+    hmValueType* local_types = hmArrayGetRaw(&verified_body.local_types, hmValueType);
+    HM_TEST_ASSERT(local_types[0] == HM_VALUE_TYPE_INT32);
+    HM_TEST_ASSERT(verified_body.max_stack_depth == 2);
+    hmVerifiedInstruction* instructions = hmArrayGetRaw(&verified_body.instructions, hmVerifiedInstruction);
+    hmVerifiedInstruction* call = &instructions[4];
+    HM_TEST_ASSERT(call->offset == 14);
+    HM_TEST_ASSERT(call->stack_depth == 2);
+    HM_TEST_ASSERT(call->popped_count == 2);
+    HM_TEST_ASSERT(call->pushed_type == HM_VALUE_TYPE_INT64);
+    HM_TEST_ASSERT(call->call_target_opt == &test_callee);
+    hmLLMethodBody ll_body;
+    err = hmLowerMethodBody(&allocator, &verified_body, &ll_body);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    /* r0..r1: arguments, r2: the local, r3..r4: the evaluation stack. */
+    HM_TEST_ASSERT(ll_body.arg_count == 2);
+    HM_TEST_ASSERT(ll_body.register_count == 5);
+    hm_uint8 expected_ll_opcodes[64];
+    hm_nint offset = 0;
+    hmLLOpcode opcode = HM_LLOPCODE_LDC32;
+    hm_uint16 register_index = 3;
+    hm_uint32 constant = 5;
+    hmMethod* target = &test_callee;
+    offset = append_bytes(expected_ll_opcodes, offset, &opcode, sizeof(opcode));
+    offset = append_bytes(expected_ll_opcodes, offset, &register_index, sizeof(register_index));
+    offset = append_bytes(expected_ll_opcodes, offset, &constant, sizeof(constant));
+    opcode = HM_LLOPCODE_MOV2; /* stloc + ldarg */
+    offset = append_bytes(expected_ll_opcodes, offset, &opcode, sizeof(opcode));
+    offset = append_registers(expected_ll_opcodes, offset, 2, 3);
+    offset = append_registers(expected_ll_opcodes, offset, 3, 1);
+    offset = append_mov(expected_ll_opcodes, offset, 4, 2);
+    opcode = HM_LLOPCODE_CALL;
+    offset = append_bytes(expected_ll_opcodes, offset, &opcode, sizeof(opcode));
+    offset = append_bytes(expected_ll_opcodes, offset, &register_index, sizeof(register_index));
+    offset = append_bytes(expected_ll_opcodes, offset, &target, sizeof(target));
+    offset = append_mov(expected_ll_opcodes, offset, 4, 3);
+    opcode = HM_LLOPCODE_RET;
+    offset = append_bytes(expected_ll_opcodes, offset, &opcode, sizeof(opcode));
+    offset = append_bytes(expected_ll_opcodes, offset, &register_index, sizeof(register_index));
+    HM_TEST_ASSERT(ll_body.size == offset);
+    HM_TEST_ASSERT(hmCompareMemory(ll_body.opcodes, expected_ll_opcodes, offset) == 0);
+    err = hmLLMethodBodyDispose(&ll_body);
+    HM_TEST_ASSERT_OK(err);
+HM_TEST_ON_FINALIZE
+    if (is_verified_body_initialized) {
+        err = hmVerifiedMethodBodyDispose(&verified_body);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+typedef struct {
+    hm_uint8     opcodes[16];
+    hm_nint      size;
+    hmSignature* signature;
+    hmError      expected_err;
+} hmTestInvalidBody;
+
+static void test_verifier_rejects_invalid_bytecode()
+{
+    hmTestInvalidBody bodies[] = {
+        { { 0 }, 0, &test_void_signature, HM_ERROR_INVALID_DATA }, /* Empty body. */
+        { { HM_HLOPCODE_POP }, 1, &test_void_signature, HM_ERROR_INVALID_DATA }, /* Stack underflow. */
+        { { HM_HLOPCODE_DUP }, 1, &test_void_signature, HM_ERROR_INVALID_DATA },
+        { { HM_HLOPCODE_STLOC, 0, 0 }, 3, &test_void_signature, HM_ERROR_INVALID_DATA },
+        { { HM_HLOPCODE_LDLOC, 0, 0 }, 3, &test_signature, HM_ERROR_INVALID_DATA }, /* Local not stored yet. */
+        { { HM_HLOPCODE_LDC64, 1, 0, 0, 0, 0, 0, 0, 0, HM_HLOPCODE_STLOC, 1, 0, HM_HLOPCODE_LDLOC, 0, 0 }, 15,
+          &test_signature, HM_ERROR_INVALID_DATA },
+        { { HM_HLOPCODE_LDC32, 1, 0, 0, 0, HM_HLOPCODE_STLOC, 0, 0, HM_HLOPCODE_LDARG, 1, 0, HM_HLOPCODE_STLOC, 0, 0 }, 14,
+          &test_void_signature, HM_ERROR_INVALID_DATA }, /* Local type mismatch. */
+        { { HM_HLOPCODE_LDC32, 1, 0, 0, 0, HM_HLOPCODE_STARG, 1, 0, HM_HLOPCODE_LDARG, 1, 0 }, 11,
+          &test_signature, HM_ERROR_INVALID_DATA }, /* Argument type mismatch. */
+        { { HM_HLOPCODE_LDARG, 2, 0 }, 3, &test_signature, HM_ERROR_INVALID_DATA }, /* Argument out of range. */
+        { { HM_HLOPCODE_LDARG, 1 }, 2, &test_signature, HM_ERROR_INVALID_DATA }, /* Truncated operand. */
+        { { HM_HLOPCODE_LDC64, 1, 0, 0, 0 }, 5, &test_signature, HM_ERROR_INVALID_DATA },
+        { { 0xFF }, 1, &test_void_signature, HM_ERROR_INVALID_DATA }, /* Unknown opcode. */
+        { { HM_HLOPCODE_LDARG, 1, 0, HM_HLOPCODE_LDARG, 0, 0, HM_HLOPCODE_CALL, 7, 0, 0, 0 }, 11,
+          &test_signature, HM_ERROR_INVALID_DATA }, /* Unresolved call target. */
+        { { HM_HLOPCODE_LDARG, 0, 0, HM_HLOPCODE_LDARG, 1, 0, HM_HLOPCODE_CALL, TEST_CALLEE_ID, 0, 0, 0 }, 11,
+          &test_signature, HM_ERROR_INVALID_DATA }, /* Call argument type mismatch. */
+        { { HM_HLOPCODE_LDARG, 1, 0, HM_HLOPCODE_CALL, TEST_CALLEE_ID, 0, 0, 0 }, 8,
+          &test_signature, HM_ERROR_INVALID_DATA }, /* Not enough call arguments. */
+        { { HM_HLOPCODE_LDARG, 0, 0 }, 3, &test_signature, HM_ERROR_INVALID_DATA }, /* Wrong return type. */
+        { { HM_HLOPCODE_LDARG, 1, 0, HM_HLOPCODE_DUP }, 4, &test_signature, HM_ERROR_INVALID_DATA }, /* Extra values. */
+        { { HM_HLOPCODE_NOP }, 1, &test_signature, HM_ERROR_INVALID_DATA }, /* No return value. */
+        { { HM_HLOPCODE_LDC32, 1, 0, 0, 0 }, 5, &test_void_signature, HM_ERROR_INVALID_DATA },
+        { { HM_HLOPCODE_LDC32, 1, 0, 0, 0, HM_HLOPCODE_STLOC, 0xFF, 0xFF }, 8,
+          &test_void_signature, HM_ERROR_LIMIT_EXCEEDED } /* Too many registers. */
+    };
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < sizeof(bodies) / sizeof(bodies[0]); i++) {
+        hmMethodBody hl_body = { bodies[i].opcodes, (hm_method_size)bodies[i].size };
+        hmLLMethodBody ll_body;
+        err = hmCompileMethodBody(&allocator, &hl_body, bodies[i].signature, &resolve_test_call_target, HM_NULL, &ll_body);
+        HM_TEST_ASSERT(err == bodies[i].expected_err);
+    }
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+HM_TEST_SUITE_BEGIN(verifiers)
+    HM_TEST_RUN(test_verifier_lowers_valid_bytecode)
+    HM_TEST_RUN_WITHOUT_OOM(test_verifier_rejects_invalid_bytecode)
+HM_TEST_SUITE_END()
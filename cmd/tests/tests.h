@@ -17,26 +17,41 @@ HM_TEST_DECLARE_SUITE(allocators)
 HM_TEST_DECLARE_SUITE(readers)
 HM_TEST_DECLARE_SUITE(writers)
 HM_TEST_DECLARE_SUITE(line_readers)
+HM_TEST_DECLARE_SUITE(copy)
+HM_TEST_DECLARE_SUITE(buffered_readers)
+HM_TEST_DECLARE_SUITE(deflate)
+HM_TEST_DECLARE_SUITE(lz4)
 HM_TEST_DECLARE_SUITE(arrays)
 HM_TEST_DECLARE_SUITE(strings)
 HM_TEST_DECLARE_SUITE(string_pools)
 HM_TEST_DECLARE_SUITE(string_builders)
+HM_TEST_DECLARE_SUITE(segmented_string_builders)
 HM_TEST_DECLARE_SUITE(utils)
 HM_TEST_DECLARE_SUITE(hash_maps)
 HM_TEST_DECLARE_SUITE(hashes)
 HM_TEST_DECLARE_SUITE(errors)
 HM_TEST_DECLARE_SUITE(queues)
+HM_TEST_DECLARE_SUITE(timer_wheels)
 HM_TEST_DECLARE_SUITE(signatures)
 HM_TEST_DECLARE_SUITE(modules)
+HM_TEST_DECLARE_SUITE(mapped_images)
+HM_TEST_DECLARE_SUITE(verifiers)
+HM_TEST_DECLARE_SUITE(interpreters)
+HM_TEST_DECLARE_SUITE(aot_compilers)
+HM_TEST_DECLARE_SUITE(execution_contexts)
 HM_TEST_DECLARE_SUITE(http_requests)
 HM_TEST_DECLARE_SUITE(sockets)
 HM_TEST_DECLARE_SUITE(mutexes)
 HM_TEST_DECLARE_SUITE(waitable_events)
 HM_TEST_DECLARE_SUITE(threads)
+HM_TEST_DECLARE_SUITE(coroutines)
+HM_TEST_DECLARE_SUITE(schedulers)
+HM_TEST_DECLARE_SUITE(timer_services)
 HM_TEST_DECLARE_SUITE(processes)
 HM_TEST_DECLARE_SUITE(environment)
 HM_TEST_DECLARE_SUITE(random)
 HM_TEST_DECLARE_SUITE(math)
+HM_TEST_DECLARE_SUITE(format)
 HM_TEST_DECLARE_SUITE(workers)
 
 hm_bool is_process_test(hmAllocator* allocator);
@@ -0,0 +1,171 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <threading/coroutine.h>
+
+#define YIELD_COUNT 3
+#define STACK_BUFFER_SIZE (64*1024)
+
+typedef struct {
+    hmCoroutine* coroutine;
+    hm_nint      counter;
+    hm_bool      is_running;
+} counterContext;
+
+static hmError counter_coroutine_func(void* user_data)
+{
+    counterContext* context = (counterContext*)user_data;
+    context->is_running = hmCoroutineGetState(context->coroutine) == HM_COROUTINE_STATE_RUNNING;
+    hmError err = hmCoroutineResume(context->coroutine); /* Already running. */
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    for (hm_nint i = 0; i < YIELD_COUNT; i++) {
+        context->counter++;
+        err = hmCoroutineYield(context->coroutine);
+        HM_TEST_ASSERT_OK(err);
+    }
+    return HM_ERROR_NOT_FOUND; /* To check it's propagated to hmCoroutineGetExitError(..) */
+}
+
+static void test_coroutine_can_yield_and_resume()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmCoroutine coroutine;
+    counterContext context;
+    context.coroutine = &coroutine;
+    context.counter = 0;
+    context.is_running = HM_FALSE;
+    hmError err = hmCreateCoroutine(&allocator, HM_COROUTINE_DEFAULT_STACK_SIZE, &counter_coroutine_func, &context, &coroutine);
+    HM_TEST_ASSERT_OK_OR_OOM(err);
+    HM_TEST_ASSERT(hmCoroutineGetState(&coroutine) == HM_COROUTINE_STATE_SUSPENDED);
+    for (hm_nint i = 0; i < YIELD_COUNT; i++) {
+        err = hmCoroutineResume(&coroutine);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(context.counter == i + 1);
+        HM_TEST_ASSERT(hmCoroutineGetState(&coroutine) == HM_COROUTINE_STATE_SUSPENDED);
+        HM_TEST_ASSERT(hmCoroutineGetExitError(&coroutine) == HM_OK);
+    }
+    HM_TEST_ASSERT(context.is_running);
+    err = hmCoroutineResume(&coroutine);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(context.counter == YIELD_COUNT);
+    HM_TEST_ASSERT(hmCoroutineGetState(&coroutine) == HM_COROUTINE_STATE_FINISHED);
+    HM_TEST_ASSERT(hmCoroutineGetExitError(&coroutine) == HM_ERROR_NOT_FOUND);
+    err = hmCoroutineResume(&coroutine);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    err = hmCoroutineDispose(&coroutine);
+    HM_TEST_ASSERT_OK(err);
+HM_TEST_ON_FINALIZE
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_coroutine_yield_fails_outside_of_coroutine()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmCoroutine coroutine;
+    hmError err = hmCreateCoroutine(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &counter_coroutine_func, HM_NULL, &coroutine);
+    HM_TEST_ASSERT_OK(err);
+    err = hmCoroutineYield(&coroutine); /* Not running. */
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    err = hmCoroutineDispose(&coroutine);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_coroutine_returns_error_if_stack_size_is_invalid()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmCoroutine coroutine;
+    hmError err = hmCreateCoroutine(&allocator, HM_COROUTINE_MIN_STACK_SIZE - 1, &counter_coroutine_func, HM_NULL, &coroutine);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateCoroutine(&allocator, HM_COROUTINE_MAX_STACK_SIZE + 1, &counter_coroutine_func, HM_NULL, &coroutine);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+typedef struct {
+    hmCoroutine* coroutine;
+    hm_nint      id;
+    hm_nint*     trace;
+    hm_nint*     trace_index;
+} interleavingContext;
+
+static hmError interleaving_coroutine_func(void* user_data)
+{
+    interleavingContext* context = (interleavingContext*)user_data;
+    /* Makes sure the stack is usable beyond the first page, and that locals survive switches. */
+    volatile char stack_buffer[STACK_BUFFER_SIZE];
+    for (hm_nint i = 0; i < STACK_BUFFER_SIZE; i++) {
+        stack_buffer[i] = (char)(context->id + i);
+    }
+    hm_float64 value = (hm_float64)context->id;
+    for (hm_nint i = 0; i < YIELD_COUNT; i++) {
+        context->trace[(*context->trace_index)++] = context->id;
+        value *= 2.0;
+        hmError err = hmCoroutineYield(context->coroutine);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(value == (hm_float64)(context->id * 8));
+    for (hm_nint i = 0; i < STACK_BUFFER_SIZE; i++) {
+        HM_TEST_ASSERT(stack_buffer[i] == (char)(context->id + i));
+    }
+    return HM_OK;
+}
+
+static void test_coroutines_can_interleave()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hm_nint trace[YIELD_COUNT * 2];
+    hm_nint trace_index = 0;
+    interleavingContext contexts[2];
+    hmCoroutine coroutines[2];
+    hm_nint coroutine_count = 0;
+    hmError err = HM_OK;
+    for (hm_nint i = 0; i < 2; i++) {
+        contexts[i].coroutine = &coroutines[i];
+        contexts[i].id = i + 1;
+        contexts[i].trace = trace;
+        contexts[i].trace_index = &trace_index;
+        err = hmCreateCoroutine(&allocator, HM_COROUTINE_DEFAULT_STACK_SIZE, &interleaving_coroutine_func, &contexts[i], &coroutines[i]);
+        HM_TEST_ASSERT_OK_OR_OOM(err);
+        coroutine_count++;
+    }
+    while (hmCoroutineGetState(&coroutines[0]) != HM_COROUTINE_STATE_FINISHED) {
+        for (hm_nint i = 0; i < 2; i++) {
+            err = hmCoroutineResume(&coroutines[i]);
+            HM_TEST_ASSERT_OK(err);
+        }
+    }
+    HM_TEST_ASSERT(trace_index == YIELD_COUNT * 2);
+    for (hm_nint i = 0; i < YIELD_COUNT * 2; i++) {
+        HM_TEST_ASSERT(trace[i] == i % 2 + 1);
+    }
+    HM_TEST_ASSERT(hmCoroutineGetExitError(&coroutines[1]) == HM_OK);
+HM_TEST_ON_FINALIZE
+    for (hm_nint i = 0; i < coroutine_count; i++) {
+        err = hmCoroutineDispose(&coroutines[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(coroutines)
+    HM_TEST_RUN(test_coroutine_can_yield_and_resume)
+    HM_TEST_RUN_WITHOUT_OOM(test_coroutine_yield_fails_outside_of_coroutine)
+    HM_TEST_RUN_WITHOUT_OOM(test_coroutine_returns_error_if_stack_size_is_invalid)
+    HM_TEST_RUN(test_coroutines_can_interleave)
+HM_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <threading/scheduler.h>
+#include <threading/thread.h>
+
+/* These tests rely on some timing, so sporadically they can fail on busy machines. */
+
+#define COROUTINE_COUNT 1000
+#define YIELD_COUNT 3
+#define THREADING_WAIT_TIMEOUT 1000
+
+typedef struct {
+    hmScheduler* scheduler;
+    hm_nint      counter;
+    hm_nint      dispose_count;
+} schedulerTestContext;
+
+static hmError yielding_coroutine_func(void* user_data)
+{
+    schedulerTestContext* context = (schedulerTestContext*)user_data;
+    hmError err = hmSchedulerRun(context->scheduler, 0); /* Not reentrant. */
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    for (hm_nint i = 0; i < YIELD_COUNT; i++) {
+        context->counter++;
+        err = hmSchedulerYield(context->scheduler);
+        HM_TEST_ASSERT_OK(err);
+    }
+    return HM_OK;
+}
+
+static hmError scheduler_test_context_dispose_func(void* obj)
+{
+    schedulerTestContext* context = (schedulerTestContext*)obj;
+    context->dispose_count++;
+    return HM_OK;
+}
+
+static void test_scheduler_runs_many_coroutines()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmScheduler scheduler;
+    schedulerTestContext context;
+    context.scheduler = &scheduler;
+    context.counter = 0;
+    context.dispose_count = 0;
+    hmError err = hmCreateScheduler(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < COROUTINE_COUNT; i++) {
+        err = hmSchedulerSpawn(&scheduler, &yielding_coroutine_func, &context, &scheduler_test_context_dispose_func);
+        HM_TEST_ASSERT_OK(err);
+    }
+    HM_TEST_ASSERT(hmSchedulerGetCoroutineCount(&scheduler) == COROUTINE_COUNT);
+    /* Every call runs every coroutine once. */
+    for (hm_nint i = 0; i < YIELD_COUNT; i++) {
+        err = hmSchedulerRun(&scheduler, 0);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(context.counter == COROUTINE_COUNT * (i + 1));
+    }
+    err = hmSchedulerRun(&scheduler, 0);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmSchedulerGetCoroutineCount(&scheduler) == 0);
+    HM_TEST_ASSERT(context.dispose_count == COROUTINE_COUNT);
+    err = hmSchedulerYield(&scheduler); /* Not running a coroutine. */
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    err = hmSchedulerWaitForHandle(&scheduler, 0, HM_FALSE, HM_SCHEDULER_INFINITE_TIMEOUT);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_STATE);
+    err = hmSchedulerDispose(&scheduler);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static void test_scheduler_disposes_unfinished_coroutines()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmScheduler scheduler;
+    schedulerTestContext context;
+    context.scheduler = &scheduler;
+    context.counter = 0;
+    context.dispose_count = 0;
+    hmError err = hmCreateScheduler(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < 2; i++) {
+        err = hmSchedulerSpawn(&scheduler, &yielding_coroutine_func, &context, &scheduler_test_context_dispose_func);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmSchedulerRun(&scheduler, 0); /* Both coroutines are suspended in the middle. */
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(context.counter == 2);
+    err = hmSchedulerDispose(&scheduler);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(context.dispose_count == 2);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static hmError failing_coroutine_func(void* user_data)
+{
+    return HM_ERROR_NOT_FOUND;
+}
+
+static void test_scheduler_returns_coroutine_errors()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmScheduler scheduler;
+    hmError err = hmCreateScheduler(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerSpawn(&scheduler, &failing_coroutine_func, HM_NULL, HM_NULL);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerRun(&scheduler, 0);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND);
+    HM_TEST_ASSERT(hmSchedulerGetCoroutineCount(&scheduler) == 0);
+    err = hmSchedulerRun(&scheduler, HM_SCHEDULER_MAX_TIMEOUT_MS + 1);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmSchedulerDispose(&scheduler);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+static hmError wake_up_thread_func(void* user_data)
+{
+    hmScheduler* scheduler = (hmScheduler*)user_data;
+    hmError err = hmSleep(200);
+    HM_TEST_ASSERT_OK(err);
+    return hmSchedulerWakeUp(scheduler);
+}
+
+static void test_scheduler_can_be_woken_up_from_another_thread()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmScheduler scheduler;
+    err = hmCreateScheduler(&allocator, HM_COROUTINE_MIN_STACK_SIZE, &scheduler);
+    HM_TEST_ASSERT_OK(err);
+    hmThread thread;
+    err = hmCreateThread(&allocator, HM_NULL, &wake_up_thread_func, &scheduler, &thread);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerRun(&scheduler, HM_SCHEDULER_INFINITE_TIMEOUT); /* Blocks until woken up. */
+    HM_TEST_ASSERT_OK(err);
+    err = hmThreadJoin(&thread, THREADING_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmThreadGetExitError(&thread) == HM_OK);
+    err = hmThreadDispose(&thread);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSchedulerDispose(&scheduler);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+HM_TEST_SUITE_BEGIN(schedulers)
+    HM_TEST_RUN_WITHOUT_OOM(test_scheduler_runs_many_coroutines)
+    HM_TEST_RUN_WITHOUT_OOM(test_scheduler_disposes_unfinished_coroutines)
+    HM_TEST_RUN_WITHOUT_OOM(test_scheduler_returns_coroutine_errors)
+    HM_TEST_RUN_WITHOUT_OOM(test_scheduler_can_be_woken_up_from_another_thread)
+HM_TEST_SUITE_END()
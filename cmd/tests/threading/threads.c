@@ -184,6 +184,89 @@ static void test_can_retrieve_thread_name()
     dispose_thread_and_allocator(&thread, &allocator);
 }
 
+static hmError can_set_thread_affinity_thread_func(void* user_data)
+{
+    return hmSleep(200);
+}
+
+static void test_can_set_thread_affinity()
+{
+    hmThread thread;
+    hmAllocator allocator;
+    create_thread_and_allocator(&thread, &allocator, &can_set_thread_affinity_thread_func, HM_NULL);
+    hmArray processors;
+    hmError err = hmGetAvailableProcessors(&allocator, &processors);
+    HM_TEST_ASSERT_OK(err);
+    hmProcessorInfo* processor_infos = hmArrayGetRaw(&processors, hmProcessorInfo);
+    err = hmThreadSetAffinity(&thread, &processor_infos[0].index, 0);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmThreadSetAffinity(&thread, &processor_infos[0].index, 1);
+    HM_TEST_ASSERT_OK(err);
+    err = hmArrayDispose(&processors);
+    HM_TEST_ASSERT_OK(err);
+    err = hmThreadJoin(&thread, THREAD_JOIN_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    dispose_thread_and_allocator(&thread, &allocator);
+}
+
+typedef struct {
+    hmAllocator* allocator;
+    hm_nint      processor_index;
+} can_create_thread_with_affinity_context;
+
+/* On Linux, the processors available to a thread are those it's pinned to. */
+static hmError can_create_thread_with_affinity_thread_func(void* user_data)
+{
+    can_create_thread_with_affinity_context* context = (can_create_thread_with_affinity_context*)user_data;
+    hmArray processors;
+    HM_TRY(hmGetAvailableProcessors(context->allocator, &processors));
+    hmProcessorInfo* processor_infos = hmArrayGetRaw(&processors, hmProcessorInfo);
+    hm_bool is_pinned = hmArrayGetCount(&processors) == 1 && processor_infos[0].index == context->processor_index;
+    HM_TRY(hmArrayDispose(&processors));
+    return is_pinned ? HM_OK : HM_ERROR_INVALID_STATE;
+}
+
+static void test_can_create_thread_with_affinity()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmArray processors;
+    err = hmGetAvailableProcessors(&allocator, &processors);
+    HM_TEST_ASSERT_OK(err);
+    hmProcessorInfo* processor_infos = hmArrayGetRaw(&processors, hmProcessorInfo);
+    can_create_thread_with_affinity_context context;
+    context.allocator = &allocator;
+    context.processor_index = processor_infos[hmArrayGetCount(&processors) - 1].index;
+    hmThread thread;
+    err = hmCreateThreadWithAffinity(
+        &allocator,
+        HM_NULL,
+        &context.processor_index,
+        0,
+        &can_create_thread_with_affinity_thread_func,
+        &context,
+        &thread
+    );
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateThreadWithAffinity(
+        &allocator,
+        HM_NULL,
+        &context.processor_index,
+        1,
+        &can_create_thread_with_affinity_thread_func,
+        &context,
+        &thread
+    );
+    HM_TEST_ASSERT_OK(err);
+    err = hmThreadJoin(&thread, THREAD_JOIN_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmThreadGetExitError(&thread) == HM_OK);
+    err = hmArrayDispose(&processors);
+    HM_TEST_ASSERT_OK(err);
+    dispose_thread_and_allocator(&thread, &allocator);
+}
+
 static hmError thread_reports_processor_time_thread_func(void* user_data)
 {
     hmThread* thread = (hmThread*)user_data;
@@ -292,6 +375,8 @@ HM_TEST_SUITE_BEGIN(threads)
     HM_TEST_RUN_WITHOUT_OOM(test_threads_have_correct_statuses)
     HM_TEST_RUN_WITHOUT_OOM(test_can_dispose_thread_before_it_finishes)
     HM_TEST_RUN_WITHOUT_OOM(test_can_retrieve_thread_name)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_set_thread_affinity)
+    HM_TEST_RUN_WITHOUT_OOM(test_can_create_thread_with_affinity)
     HM_TEST_RUN_WITHOUT_OOM(test_thread_reports_processor_time)
     HM_TEST_RUN_WITHOUT_OOM(test_can_create_and_join_many_threads)
     HM_TEST_RUN_WITHOUT_OOM(test_can_sleep);
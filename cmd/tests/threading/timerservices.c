@@ -0,0 +1,174 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include "../common.h"
+#include <core/environment.h>
+#include <threading/thread.h>
+#include <threading/timerservice.h>
+#include <threading/workerpool.h>
+
+/* These tests rely on some timing, so sporadically they can fail on busy machines. */
+
+#define TIMER_COUNT 4
+#define WORKER_COUNT 2
+#define QUEUE_SIZE 16
+#define THREADING_WAIT_TIMEOUT 1000
+
+static hm_atomic_nint fired_times[TIMER_COUNT]; /* When timers fire, in terms of hmGetTickCount(). */
+
+static hmError timer_worker_func(void* work_item, hmScheduler* scheduler_opt)
+{
+    hm_nint index = *(hm_nint*)work_item;
+    hmAtomicStore(&fired_times[index], (hm_nint)hmGetTickCount());
+    return HM_OK;
+}
+
+static void test_timer_service_posts_expired_timers_to_worker_pool()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    for (hm_nint i = 0; i < TIMER_COUNT; i++) {
+        hmAtomicStore(&fired_times[i], 0);
+    }
+    hmWorkerPool worker_pool;
+    err = hmCreateWorkerPool(
+        &allocator,
+        HM_NULL,
+        WORKER_COUNT,
+        &timer_worker_func,
+        sizeof(hm_nint),
+        HM_NULL,
+        HM_FALSE,
+        QUEUE_SIZE,
+        HM_WORKER_NO_COROUTINES,
+        HM_WORKER_POOL_AFFINITY_NONE,
+        &worker_pool
+    );
+    HM_TEST_ASSERT_OK(err);
+    hmTimerService timer_service;
+    err = hmCreateTimerService(&allocator, &worker_pool, sizeof(hm_nint), HM_NULL, HM_TIMER_SERVICE_DEFAULT_RESOLUTION_MS, &timer_service);
+    HM_TEST_ASSERT_OK(err);
+    hm_millis start_time = hmGetTickCount();
+    hmTimer timers[TIMER_COUNT];
+    for (hm_nint i = 0; i < TIMER_COUNT - 1; i++) {
+        err = hmScheduleAfter(&timer_service, (i + 1) * 50, &i, &timers[i]);
+        HM_TEST_ASSERT_OK(err);
+    }
+    hm_nint index = TIMER_COUNT - 1;
+    err = hmScheduleAt(&timer_service, start_time + 80, &index, &timers[index]);
+    HM_TEST_ASSERT_OK(err);
+    err = hmTimerServiceCancel(&timer_service, &timers[1]);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSleep(400);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmAtomicLoad(&fired_times[1]) == 0);
+    HM_TEST_ASSERT((hm_millis)hmAtomicLoad(&fired_times[0]) >= start_time + 50);
+    HM_TEST_ASSERT((hm_millis)hmAtomicLoad(&fired_times[2]) >= start_time + 150);
+    HM_TEST_ASSERT((hm_millis)hmAtomicLoad(&fired_times[3]) >= start_time + 80);
+    err = hmTimerServiceCancel(&timer_service, &timers[0]);
+    HM_TEST_ASSERT(err == HM_ERROR_NOT_FOUND); /* Already fired. */
+    HM_TEST_ASSERT(hmTimerServiceGetExitError(&timer_service) == HM_OK);
+    err = hmTimerServiceDispose(&timer_service, THREADING_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolStop(&worker_pool, HM_TRUE);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolWait(&worker_pool, THREADING_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolDispose(&worker_pool);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static hm_atomic_nint processed_count;
+
+static hmError slow_worker_func(void* work_item, hmScheduler* scheduler_opt)
+{
+    HM_TEST_ASSERT_OK(hmSleep(100));
+    (void)hmAtomicIncrement(&processed_count);
+    return HM_OK;
+}
+
+static void test_timer_service_keeps_running_if_work_items_are_dropped()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmAtomicStore(&processed_count, 0);
+    hmWorkerPool worker_pool;
+    err = hmCreateWorkerPool(
+        &allocator,
+        HM_NULL,
+        1,
+        &slow_worker_func,
+        sizeof(hm_nint),
+        HM_NULL,
+        HM_TRUE, /* is_queue_bounded */
+        1,       /* queue_capacity */
+        HM_WORKER_NO_COROUTINES,
+        HM_WORKER_POOL_AFFINITY_NONE,
+        &worker_pool
+    );
+    HM_TEST_ASSERT_OK(err);
+    hmTimerService timer_service;
+    err = hmCreateTimerService(&allocator, &worker_pool, sizeof(hm_nint), HM_NULL, HM_TIMER_SERVICE_DEFAULT_RESOLUTION_MS, &timer_service);
+    HM_TEST_ASSERT_OK(err);
+    /* All the timers fire at once, while the only worker can hold at most one item in its queue and one in progress. */
+    hm_millis fire_time = hmGetTickCount() + 20;
+    for (hm_nint i = 0; i < TIMER_COUNT; i++) {
+        err = hmScheduleAt(&timer_service, fire_time, &i, HM_NULL);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmSleep(400);
+    HM_TEST_ASSERT_OK(err);
+    hm_nint dropped_count = hmTimerServiceGetDroppedCount(&timer_service);
+    HM_TEST_ASSERT(dropped_count >= TIMER_COUNT - 2);
+    HM_TEST_ASSERT(hmAtomicLoad(&processed_count) == TIMER_COUNT - dropped_count);
+    /* Timers scheduled later still fire. */
+    hm_nint index = 0;
+    err = hmScheduleAfter(&timer_service, 20, &index, HM_NULL);
+    HM_TEST_ASSERT_OK(err);
+    err = hmSleep(400);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmAtomicLoad(&processed_count) == TIMER_COUNT - dropped_count + 1);
+    HM_TEST_ASSERT(hmTimerServiceGetExitError(&timer_service) == HM_OK);
+    err = hmTimerServiceDispose(&timer_service, THREADING_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolStop(&worker_pool, HM_TRUE);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolWait(&worker_pool, THREADING_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerPoolDispose(&worker_pool);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
+static void test_timer_service_returns_error_if_resolution_is_invalid()
+{
+    hmAllocator allocator;
+    HM_TEST_INIT_ALLOC(&allocator);
+    hmTimerService timer_service;
+    hmError err = hmCreateTimerService(&allocator, HM_NULL, sizeof(hm_nint), HM_NULL, 0, &timer_service);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    err = hmCreateTimerService(&allocator, HM_NULL, sizeof(hm_nint), HM_NULL, HM_TIMER_SERVICE_MAX_RESOLUTION_MS + 1, &timer_service);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
+    HM_TEST_DEINIT_ALLOC(&allocator);
+}
+
+HM_TEST_SUITE_BEGIN(timer_services)
+    HM_TEST_RUN_WITHOUT_OOM(test_timer_service_posts_expired_timers_to_worker_pool)
+    HM_TEST_RUN_WITHOUT_OOM(test_timer_service_keeps_running_if_work_items_are_dropped)
+    HM_TEST_RUN_WITHOUT_OOM(test_timer_service_returns_error_if_resolution_is_invalid)
+HM_TEST_SUITE_END()
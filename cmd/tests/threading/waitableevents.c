@@ -152,8 +152,50 @@ static void test_waitable_event_remains_signaled_when_without_waiters()
     HM_TEST_ASSERT_OK(err);
 }
 
+static hmError delayed_signal_thread_func(void* user_data)
+{
+    shared_thread_context* context = (shared_thread_context*)user_data;
+    hmError err = hmSleep(200); /* Makes sure the main thread is already waiting. */
+    HM_TEST_ASSERT_OK(err);
+    err = hmWaitableEventSignal(&context->waitable_event);
+    HM_TEST_ASSERT_OK(err);
+    return HM_OK;
+}
+
+static void test_waitable_event_can_wait_without_timeout()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    shared_thread_context context;
+    err = hmCreateWaitableEvent(&allocator, &context.waitable_event);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWaitableEventWait(&context.waitable_event, 0);
+    HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT); /* zero timeouts are still not supported */
+    hmThread thread;
+    err = hmCreateThread(
+        &allocator,
+        HM_NULL,
+        &delayed_signal_thread_func,
+        &context,
+        &thread
+    );
+    HM_TEST_ASSERT_OK(err);
+    err = hmWaitableEventWait(&context.waitable_event, HM_WAITABLE_EVENT_INFINITE_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    err = hmThreadJoin(&thread, HM_THREAD_JOIN_MAX_TIMEOUT_MS);
+    HM_TEST_ASSERT_OK(err);
+    err = hmThreadDispose(&thread);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWaitableEventDispose(&context.waitable_event);
+    HM_TEST_ASSERT_OK(err);
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
 HM_TEST_SUITE_BEGIN(waitable_events)
     HM_TEST_RUN_WITHOUT_OOM(test_waitable_event_can_timeout)
     HM_TEST_RUN_WITHOUT_OOM(test_can_wait_and_signal_with_waitable_events)
     HM_TEST_RUN_WITHOUT_OOM(test_waitable_event_remains_signaled_when_without_waiters)
+    HM_TEST_RUN_WITHOUT_OOM(test_waitable_event_can_wait_without_timeout)
 HM_TEST_SUITE_END()
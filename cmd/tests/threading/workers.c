@@ -13,6 +13,7 @@
 
 #include "../common.h"
 #include <core/environment.h>
+#include <threading/scheduler.h>
 #include <threading/worker.h>
 #include <threading/workerpool.h>
 #include <threading/thread.h>
@@ -24,6 +25,9 @@
 #define WORKER_WAIT_TIMEOUT 4000
 #define THROUGHPUT_WORK_ITEM_COUNT 1000000
 #define WORKER_POOL_WORKER_COUNT 50
+#define PINNED_WORKER_POOL_WORKER_COUNT 4 /* Can exceed the number of processors: workers are then placed round robin. */
+#define WORKER_POOL_NAME "pinned"
+#define IDLE_WORKER_STOP_MAX_MS 1000 /* Much less than any timeout-based wakeup would take. */
 
 static hm_atomic_nint processed_count = 0;
 
@@ -42,7 +46,7 @@ static void create_worker_and_allocator(
     hmString worker_name;
     err = hmCreateStringViewFromCString(WORKER_NAME, &worker_name);
     HM_TEST_ASSERT_OK(err);
-    err = hmCreateWorker(allocator, &worker_name, worker_func, item_size, item_dispose_func, is_queue_bounded, queue_size, worker);
+    err = hmCreateWorker(allocator, &worker_name, worker_func, item_size, item_dispose_func, is_queue_bounded, queue_size, HM_WORKER_NO_COROUTINES, HM_NULL, 0, worker);
     HM_TEST_ASSERT_OK(err);
 }
 
@@ -59,7 +63,7 @@ static void dispose_worker_and_allocator(hmWorker* worker, hmAllocator* allocato
     HM_TEST_ASSERT_OK(err);
 }
 
-static hmError can_start_stop_wait_worker_and_get_name_worker_func(void* work_item)
+static hmError can_start_stop_wait_worker_and_get_name_worker_func(void* work_item, hmScheduler* scheduler_opt)
 {
     return HM_OK;
 }
@@ -82,6 +86,22 @@ static void test_can_start_stop_wait_worker_and_get_name()
     dispose_worker_and_allocator(&worker, &allocator);
 }
 
+static void test_idle_worker_is_woken_up_by_stop()
+{
+    hmWorker worker;
+    hmAllocator allocator;
+    create_worker_and_allocator_simple(&worker, &allocator, &can_start_stop_wait_worker_and_get_name_worker_func, sizeof(hm_nint));
+    hmError err = hmSleep(100); /* Lets the worker park. */
+    HM_TEST_ASSERT_OK(err);
+    hm_millis start_time = hmGetTickCount();
+    err = hmWorkerStop(&worker, HM_TRUE);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerWait(&worker, WORKER_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(hmGetTickCount() - start_time < IDLE_WORKER_STOP_MAX_MS);
+    dispose_worker_and_allocator(&worker, &allocator);
+}
+
 typedef struct {
     hmAllocator* allocator;
     hm_nint      value;
@@ -94,7 +114,7 @@ static hmError integer_work_item_dispose_func(void* obj)
     return HM_OK;
 }
 
-static hmError can_process_work_items_fast_with_dispose_func_worker_func(void* obj)
+static hmError can_process_work_items_fast_with_dispose_func_worker_func(void* obj, hmScheduler* scheduler_opt)
 {
     integer_work_item* work_item = *((integer_work_item**)obj);
     processed_count += work_item->value;
@@ -131,7 +151,65 @@ static void test_can_process_work_items_fast_with_dispose_func()
     dispose_worker_and_allocator(&worker, &allocator);
 }
 
-static hmError worker_drains_queue_when_stopped_worker_func(void* obj)
+static hm_nint in_flight_count = 0;     /* Only accessed from the worker's thread. */
+static hm_nint max_in_flight_count = 0;
+
+static hmError coroutine_worker_func(void* obj, hmScheduler* scheduler_opt)
+{
+    integer_work_item* work_item = *((integer_work_item**)obj);
+    in_flight_count++;
+    if (in_flight_count > max_in_flight_count) {
+        max_in_flight_count = in_flight_count;
+    }
+    /* Lets other items start before this one finishes. */
+    HM_TEST_ASSERT(scheduler_opt);
+    hmError err = hmSchedulerYield(scheduler_opt);
+    in_flight_count--;
+    processed_count += work_item->value;
+    return err;
+}
+
+static void test_coroutine_worker_interleaves_work_items()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmWorker worker;
+    err = hmCreateWorker(
+        &allocator,
+        HM_NULL,
+        &coroutine_worker_func,
+        sizeof(integer_work_item*),
+        &integer_work_item_dispose_func,
+        HM_FALSE,
+        DEFAULT_WORKER_QUEUE_SIZE,
+        HM_COROUTINE_MIN_STACK_SIZE,
+        HM_NULL,
+        0,
+        &worker
+    );
+    HM_TEST_ASSERT_OK(err);
+    processed_count = 0;
+    in_flight_count = 0;
+    max_in_flight_count = 0;
+    for (hm_nint i = 0; i <= 1000; i++) {
+        integer_work_item* arg = hmAlloc(&allocator, sizeof(integer_work_item));
+        HM_TEST_ASSERT(arg);
+        arg->allocator = &allocator;
+        arg->value = i;
+        err = hmWorkerEnqueueItem(&worker, &arg);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmWorkerStop(&worker, HM_TRUE);
+    HM_TEST_ASSERT_OK(err);
+    err = hmWorkerWait(&worker, WORKER_WAIT_TIMEOUT);
+    HM_TEST_ASSERT_OK(err);
+    HM_TEST_ASSERT(processed_count == 500500);
+    HM_TEST_ASSERT(max_in_flight_count > 1);
+    dispose_worker_and_allocator(&worker, &allocator);
+}
+
+static hmError worker_drains_queue_when_stopped_worker_func(void* obj, hmScheduler* scheduler_opt)
 {
     integer_work_item* work_item = *((integer_work_item**)obj);
     processed_count += work_item->value;
@@ -168,7 +246,7 @@ static void test_worker_drains_queue_when_stopped()
     dispose_worker_and_allocator(&worker, &allocator);
 }
 
-static hmError worker_does_not_drain_queue_when_stopped_worker_func(void* obj)
+static hmError worker_does_not_drain_queue_when_stopped_worker_func(void* obj, hmScheduler* scheduler_opt)
 {
     integer_work_item* work_item = *((integer_work_item**)obj);
     processed_count += work_item->value;
@@ -205,7 +283,7 @@ static void test_worker_does_not_drain_queue_when_stopped()
     dispose_worker_and_allocator(&worker, &allocator);
 }
 
-static hmError worker_returns_error_if_item_size_is_too_big_thread_func(void* obj)
+static hmError worker_returns_error_if_item_size_is_too_big_thread_func(void* obj, hmScheduler* scheduler_opt)
 {
     return HM_OK;
 }
@@ -224,13 +302,16 @@ void test_worker_returns_error_if_item_size_is_too_big()
         HM_NULL,
         HM_TRUE,
         DEFAULT_WORKER_QUEUE_SIZE,
+        HM_WORKER_NO_COROUTINES,
+        HM_NULL,
+        0,
         &worker);
     HM_TEST_ASSERT(err == HM_ERROR_INVALID_ARGUMENT);
     err = hmAllocatorDispose(&allocator);
     HM_TEST_ASSERT_OK(err);
 }
 
-static hmError worker_can_enqueue_by_value_worker_func(void* obj)
+static hmError worker_can_enqueue_by_value_worker_func(void* obj, hmScheduler* scheduler_opt)
 {
     integer_work_item* work_item = (integer_work_item*)obj;
     processed_count += work_item->value;
@@ -271,7 +352,7 @@ typedef struct {
     hm_millis end_time;
 } throughput_work_item;
 
-static hmError worker_throughput_worker_with_tick_count_func(void* obj)
+static hmError worker_throughput_worker_with_tick_count_func(void* obj, hmScheduler* scheduler_opt)
 {
     throughput_work_item* work_item = *((throughput_work_item**)obj);
     work_item->end_time = hmGetTickCount();
@@ -279,7 +360,7 @@ static hmError worker_throughput_worker_with_tick_count_func(void* obj)
     return HM_OK;
 }
 
-static hmError worker_throughput_worker_without_tick_count_func(void* obj)
+static hmError worker_throughput_worker_without_tick_count_func(void* obj, hmScheduler* scheduler_opt)
 {
     return HM_OK;
 }
@@ -304,6 +385,9 @@ static void worker_throughput_calculate_times(hm_bool with_tick_count, hm_float6
             HM_NULL,
             HM_FALSE,
             DEFAULT_WORKER_QUEUE_SIZE,
+            HM_WORKER_NO_COROUTINES,
+            HM_NULL,
+            0,
             &workers[i]
         );
         HM_TEST_ASSERT_OK(err);
@@ -372,7 +456,7 @@ static void test_worker_throughput()
     printf("        Average latency: %.2f ms for enqueue rate = %.2f items/sec (total: %d items)\n", corrected_average_latency, enqueue_rate, THROUGHPUT_WORK_ITEM_COUNT);
 }
 
-static hmError test_worker_pool_worker_func(void* work_item)
+static hmError test_worker_pool_worker_func(void* work_item, hmScheduler* scheduler_opt)
 {
     hm_nint** nint_item = (hm_nint**)work_item;
     **nint_item *= 2;
@@ -387,12 +471,15 @@ static void test_worker_pool_dispatches_to_workers_evenly()
     hmWorkerPool worker_pool;
     err = hmCreateWorkerPool(
         &allocator,
+        HM_NULL, /* name_opt */
         WORKER_POOL_WORKER_COUNT,
         &test_worker_pool_worker_func,
         sizeof(hm_nint*),
         HM_NULL,
         HM_TRUE, /* is_queue_bounded = HM_TRUE */
         2,       /* queue_capacity = 2; allows a simple check that new work items don't all go to the same worker */
+        HM_WORKER_NO_COROUTINES,
+        HM_WORKER_POOL_AFFINITY_NONE,
         &worker_pool
     );
     HM_TEST_ASSERT_OK(err);
@@ -416,13 +503,68 @@ static void test_worker_pool_dispatches_to_workers_evenly()
     HM_TEST_ASSERT_OK(err);
 }
 
+static void test_worker_pool_can_pin_and_name_workers()
+{
+    hmAllocator allocator;
+    hmError err = hmCreateSystemAllocator(&allocator);
+    HM_TEST_ASSERT_OK(err);
+    hmString pool_name;
+    err = hmCreateStringViewFromCString(WORKER_POOL_NAME, &pool_name);
+    HM_TEST_ASSERT_OK(err);
+    hmWorkerPoolAffinity affinities[] = { HM_WORKER_POOL_AFFINITY_PROCESSOR, HM_WORKER_POOL_AFFINITY_NODE };
+    for (hm_nint i = 0; i < sizeof(affinities) / sizeof(affinities[0]); i++) {
+        hmWorkerPool worker_pool;
+        err = hmCreateWorkerPool(
+            &allocator,
+            &pool_name,
+            PINNED_WORKER_POOL_WORKER_COUNT,
+            &test_worker_pool_worker_func,
+            sizeof(hm_nint*),
+            HM_NULL,
+            HM_FALSE, /* is_queue_bounded = HM_FALSE */
+            DEFAULT_WORKER_QUEUE_SIZE,
+            HM_WORKER_NO_COROUTINES,
+            affinities[i],
+            &worker_pool
+        );
+        HM_TEST_ASSERT_OK(err);
+        hmString worker_name;
+        err = hmWorkerGetName(&worker_pool.workers[1], &worker_name);
+        HM_TEST_ASSERT_OK(err);
+        HM_TEST_ASSERT(hmStringEqualsToCString(&worker_name, WORKER_POOL_NAME "-1"));
+        err = hmStringDispose(&worker_name);
+        HM_TEST_ASSERT_OK(err);
+        hm_nint work_items[PINNED_WORKER_POOL_WORKER_COUNT * 2] = {0};
+        for (hm_nint j = 0; j < PINNED_WORKER_POOL_WORKER_COUNT * 2; j++) {
+            work_items[j] = j;
+            hm_nint* worker_item_ref = &work_items[j];
+            err = hmWorkerPoolEnqueueItem(&worker_pool, &worker_item_ref);
+            HM_TEST_ASSERT_OK(err);
+        }
+        err = hmWorkerPoolStop(&worker_pool, HM_TRUE);
+        HM_TEST_ASSERT_OK(err);
+        err = hmWorkerPoolWait(&worker_pool, WORKER_WAIT_TIMEOUT);
+        HM_TEST_ASSERT_OK(err);
+        for (hm_nint j = 0; j < PINNED_WORKER_POOL_WORKER_COUNT * 2; j++) {
+            HM_TEST_ASSERT(work_items[j] == j * 2);
+        }
+        err = hmWorkerPoolDispose(&worker_pool);
+        HM_TEST_ASSERT_OK(err);
+    }
+    err = hmAllocatorDispose(&allocator);
+    HM_TEST_ASSERT_OK(err);
+}
+
 HM_TEST_SUITE_BEGIN(workers)
     HM_TEST_RUN_WITHOUT_OOM(test_can_start_stop_wait_worker_and_get_name)
+    HM_TEST_RUN_WITHOUT_OOM(test_idle_worker_is_woken_up_by_stop)
     HM_TEST_RUN_WITHOUT_OOM(test_can_process_work_items_fast_with_dispose_func)
+    HM_TEST_RUN_WITHOUT_OOM(test_coroutine_worker_interleaves_work_items)
     HM_TEST_RUN_WITHOUT_OOM(test_worker_drains_queue_when_stopped)
     HM_TEST_RUN_WITHOUT_OOM(test_worker_does_not_drain_queue_when_stopped)
     HM_TEST_RUN_WITHOUT_OOM(test_worker_returns_error_if_item_size_is_too_big)
     HM_TEST_RUN_WITHOUT_OOM(test_worker_can_enqueue_by_value)
     HM_TEST_RUN_WITHOUT_OOM(test_worker_throughput)
     HM_TEST_RUN_WITHOUT_OOM(test_worker_pool_dispatches_to_workers_evenly)
+    HM_TEST_RUN_WITHOUT_OOM(test_worker_pool_can_pin_and_name_workers)
 HM_TEST_SUITE_END()
@@ -112,6 +112,17 @@ hmError hmArraySet(hmArray* array, hm_nint index, void* in_value)
     return HM_OK;
 }
 
+hmError hmArrayRemoveLast(hmArray* array, void* in_value)
+{
+    if (!array->count) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    array->count--;
+    /* No hmMulNint because the item was already added, so the offset must be valid. */
+    hmCopyMemory(in_value, array->items + array->count * array->item_size, array->item_size);
+    return HM_OK;
+}
+
 hmError hmArrayClear(hmArray* array)
 {
     hmError err = HM_OK;
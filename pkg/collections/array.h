@@ -64,6 +64,10 @@ hmError hmArrayAddRange(hmArray* array, void* in_values, hm_nint count);
 hmError hmArrayGet(hmArray* array, hm_nint index, void* in_value);
 /* See hmArrayGet(..) */
 hmError hmArraySet(hmArray* array, hm_nint index, void* in_value);
+/* Removes the last item from the array and copies it to a memory block pointed to by `in_value` (the item isn't disposed
+   of: its ownership, if any, moves to the caller). Returns HM_ERROR_INVALID_STATE if the array is empty. Together with
+   hmArrayAdd(..), allows to use the array as a stack. */
+hmError hmArrayRemoveLast(hmArray* array, void* in_value);
 /* Removes all the items in the array, allowing to reuse it.
    Calls `item_dispose_func` on all the items, if it's specified. */
 hmError hmArrayClear(hmArray* array);
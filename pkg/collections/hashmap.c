@@ -32,6 +32,7 @@ static hm_bool hmHashMapAreKeysEqual(hmHashMap* hash_map, void* value1, void* va
 static hmHashMapEntry* hmHashMapEntryFindByBucketIndexAndKey(hmHashMap* hash_map, hm_nint bucket_index, void* key);
 static hmHashMapEntry* hmHashMapEntryFindByKey(hmHashMap* hash_map, void* key);
 static hmError hmHashMapRehash(hmHashMap* hash_map);
+static hmError hmHashMapFreeEntries(hmHashMap* hash_map);
 
 hmError hmCreateHashMap(
     hmAllocator*        allocator,
@@ -123,6 +124,21 @@ hmError hmCreateHashMapWithStringRefKeys(
 }
 
 hmError hmHashMapDispose(hmHashMap* hash_map)
+{
+    hmError err = hmHashMapFreeEntries(hash_map);
+    hmFree(hash_map->allocator, hash_map->buckets);
+    return err;
+}
+
+hmError hmHashMapClear(hmHashMap* hash_map)
+{
+    hmError err = hmHashMapFreeEntries(hash_map);
+    hmZeroMemory(hash_map->buckets, hash_map->bucket_count * sizeof(hmHashMapEntry*));
+    hash_map->count = 0;
+    return err;
+}
+
+static hmError hmHashMapFreeEntries(hmHashMap* hash_map)
 {
     hmError err = HM_OK;
     for (hm_nint i = 0; i < hash_map->bucket_count; i++) {
@@ -142,7 +158,6 @@ hmError hmHashMapDispose(hmHashMap* hash_map)
             entry = next_entry;
         }
     }
-    hmFree(hash_map->allocator, hash_map->buckets);
     return err;
 }
 
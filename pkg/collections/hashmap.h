@@ -119,6 +119,9 @@ hm_bool hmHashMapContains(hmHashMap* hash_map, void* key);
 /* Removes an item from the map, by the given key. Returns `out_removed_opt`, if the item was actually removed.
    `out_removed` can be HM_NULL. */
 hmError hmHashMapRemove(hmHashMap* hash_map, void* key, hm_bool* out_removed_opt);
+/* Removes all the items from the map, disposing of them as hmHashMapDispose(..) does, but keeps the buckets, so
+   the map doesn't have to grow again when it's refilled. */
+hmError hmHashMapClear(hmHashMap* hash_map);
 /* Enumerates all the keys and values in the map by calling function `enumerate_func`. The error returned from `enumerate_func`
    is returned from hmHashMapEnumerate(..) as is. On any error other than HM_OK, enumeration is immediately terminated.
    Use `user_data` to pass additional context to the callback.
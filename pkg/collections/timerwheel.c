@@ -0,0 +1,237 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <collections/timerwheel.h>
+#include <core/utils.h>
+
+#define HM_TIMER_WHEEL_SLOT_MASK ((hm_uint64)(HM_TIMER_WHEEL_SLOT_COUNT - 1))
+
+typedef struct hmTimerWheelNode_ {
+    struct hmTimerWheelNode_*  prev;
+    struct hmTimerWheelNode_*  next;
+    struct hmTimerWheelNode_** slot;        /* The slot the node is linked into; HM_NULL if the node is free. */
+    hm_uint64                  expiry_tick;
+    hm_uint64                  id;          /* Changes every time the node is reused, to detect stale hmTimer handles. */
+    char                       item[];
+} hmTimerWheelNode;
+
+static void hmTimerWheelLink(hmTimerWheel* timer_wheel, hmTimerWheelNode* node);
+static void hmTimerWheelUnlink(hmTimerWheelNode* node);
+static void hmTimerWheelFreeNode(hmTimerWheel* timer_wheel, hmTimerWheelNode* node);
+static hmError hmTimerWheelDisposeNodeList(hmTimerWheel* timer_wheel, hmTimerWheelNode* node);
+
+hmError hmCreateTimerWheel(
+    hmAllocator*  allocator,
+    hm_nint       item_size,
+    hmDisposeFunc item_dispose_func_opt,
+    hmTimerWheel* in_timer_wheel
+)
+{
+    if (item_size > HM_TIMER_WHEEL_MAX_ITEM_SIZE) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hmZeroMemory(in_timer_wheel->slots, sizeof(in_timer_wheel->slots));
+    in_timer_wheel->allocator = allocator;
+    in_timer_wheel->free_nodes = HM_NULL;
+    in_timer_wheel->item_dispose_func_opt = item_dispose_func_opt;
+    in_timer_wheel->item_size = item_size;
+    in_timer_wheel->count = 0;
+    in_timer_wheel->current_tick = 0;
+    in_timer_wheel->last_id = 0;
+    return HM_OK;
+}
+
+hmError hmTimerWheelDispose(hmTimerWheel* timer_wheel)
+{
+    hmError err = HM_OK;
+    for (hm_nint level = 0; level < HM_TIMER_WHEEL_LEVEL_COUNT; level++) {
+        for (hm_nint i = 0; i < HM_TIMER_WHEEL_SLOT_COUNT; i++) {
+            err = hmMergeErrors(err, hmTimerWheelDisposeNodeList(timer_wheel, timer_wheel->slots[level][i]));
+        }
+    }
+    hmTimerWheelNode* node = timer_wheel->free_nodes;
+    while (node) {
+        hmTimerWheelNode* next = node->next;
+        hmFree(timer_wheel->allocator, node);
+        node = next;
+    }
+    return err;
+}
+
+hmError hmTimerWheelAdd(hmTimerWheel* timer_wheel, hm_uint64 expiry_tick, void* in_item, hmTimer* out_timer_opt)
+{
+    hmTimerWheelNode* node = timer_wheel->free_nodes;
+    if (node) {
+        timer_wheel->free_nodes = node->next;
+    } else {
+        node = (hmTimerWheelNode*)hmAlloc(timer_wheel->allocator, sizeof(hmTimerWheelNode) + timer_wheel->item_size);
+        if (!node) {
+            return HM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    node->expiry_tick = expiry_tick > timer_wheel->current_tick ? expiry_tick : timer_wheel->current_tick + 1;
+    node->id = ++timer_wheel->last_id;
+    hmCopyMemory(node->item, in_item, timer_wheel->item_size);
+    hmTimerWheelLink(timer_wheel, node);
+    timer_wheel->count++;
+    if (out_timer_opt) {
+        out_timer_opt->node = node;
+        out_timer_opt->id = node->id;
+    }
+    return HM_OK;
+}
+
+hmError hmTimerWheelCancel(hmTimerWheel* timer_wheel, hmTimer* timer)
+{
+    hmTimerWheelNode* node = timer->node;
+    if (!node || !node->slot || node->id != timer->id) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    hmTimerWheelUnlink(node);
+    timer_wheel->count--;
+    hmError err = HM_OK;
+    if (timer_wheel->item_dispose_func_opt) {
+        err = timer_wheel->item_dispose_func_opt(node->item);
+    }
+    hmTimerWheelFreeNode(timer_wheel, node);
+    return err;
+}
+
+hmError hmTimerWheelAdvance(hmTimerWheel* timer_wheel, hm_uint64 tick, hmTimerWheelExpireFunc expire_func, void* user_data)
+{
+    if (!timer_wheel->count && tick > timer_wheel->current_tick) {
+        timer_wheel->current_tick = tick; /* Nothing to expire or cascade on the way. */
+        return HM_OK;
+    }
+    hmError err = HM_OK;
+    while (timer_wheel->current_tick < tick) {
+        hm_uint64 current_tick = ++timer_wheel->current_tick;
+        /* When the index of a level wraps around, the next slot of the upper level becomes due: its timers now expire
+           within the range of the lower levels, so they are moved down. */
+        for (hm_nint level = 1; level < HM_TIMER_WHEEL_LEVEL_COUNT; level++) {
+            if (current_tick & (((hm_uint64)1 << (level * HM_TIMER_WHEEL_LEVEL_BITS)) - 1)) {
+                break;
+            }
+            hmTimerWheelNode** slot = &timer_wheel->slots[level][(current_tick >> (level * HM_TIMER_WHEEL_LEVEL_BITS)) & HM_TIMER_WHEEL_SLOT_MASK];
+            hmTimerWheelNode* node = *slot;
+            *slot = HM_NULL;
+            while (node) {
+                hmTimerWheelNode* next = node->next;
+                hmTimerWheelLink(timer_wheel, node);
+                node = next;
+            }
+        }
+        /* Every timer in the slot of the lowest level expires exactly at this tick. */
+        hmTimerWheelNode** slot = &timer_wheel->slots[0][current_tick & HM_TIMER_WHEEL_SLOT_MASK];
+        while (*slot) {
+            hmTimerWheelNode* node = *slot;
+            hmTimerWheelUnlink(node);
+            timer_wheel->count--;
+            hmError expire_err = expire_func(node->item, user_data);
+            if (expire_err != HM_OK && timer_wheel->item_dispose_func_opt) {
+                expire_err = hmMergeErrors(expire_err, timer_wheel->item_dispose_func_opt(node->item));
+            }
+            err = hmMergeErrors(err, expire_err);
+            hmTimerWheelFreeNode(timer_wheel, node);
+        }
+    }
+    return err;
+}
+
+hmError hmTimerWheelGetNextExpiry(hmTimerWheel* timer_wheel, hm_uint64* out_tick)
+{
+    if (!timer_wheel->count) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    /* A timer is always linked less than a full revolution ahead of the current index of its level (see
+       hmTimerWheelLink(..)), so within a level, slots hold later and later timers starting from the one after the current
+       index. The levels themselves overlap, though: a timer of an upper level which hasn't been cascaded yet can expire
+       earlier than some timers of a lower level, so the first non-empty slot of every level must be checked.
+       A slot is due at the first tick of its range: for the lowest level, it's exactly when its timers expire; for the
+       upper levels, it's when the slot is cascaded, which is never after any of its timers expire. The nodes themselves
+       are never looked at, so slots with many timers cost nothing extra. */
+    hm_uint64 next_tick = HM_UINT64_MAX;
+    for (hm_nint level = 0; level < HM_TIMER_WHEEL_LEVEL_COUNT; level++) {
+        hm_uint64 current_index = timer_wheel->current_tick >> (level * HM_TIMER_WHEEL_LEVEL_BITS);
+        for (hm_uint64 offset = 1; offset < HM_TIMER_WHEEL_SLOT_COUNT; offset++) {
+            if (timer_wheel->slots[level][(current_index + offset) & HM_TIMER_WHEEL_SLOT_MASK]) {
+                hm_uint64 slot_tick = (current_index + offset) << (level * HM_TIMER_WHEEL_LEVEL_BITS);
+                next_tick = slot_tick < next_tick ? slot_tick : next_tick;
+                break;
+            }
+        }
+    }
+    *out_tick = next_tick;
+    return HM_OK;
+}
+
+static void hmTimerWheelLink(hmTimerWheel* timer_wheel, hmTimerWheelNode* node)
+{
+    /* The lowest level at which the timer's slot index is less than a full revolution away from the current one; a
+       timer can never land in the slot of the current index, because the slot is then already processed. */
+    hm_uint64 current_tick = timer_wheel->current_tick;
+    hm_nint level = 0;
+    hm_uint64 index = node->expiry_tick;
+    while (level < HM_TIMER_WHEEL_LEVEL_COUNT - 1 && index - (current_tick >> (level * HM_TIMER_WHEEL_LEVEL_BITS)) >= HM_TIMER_WHEEL_SLOT_COUNT) {
+        level++;
+        index = node->expiry_tick >> (level * HM_TIMER_WHEEL_LEVEL_BITS);
+    }
+    hm_uint64 current_index = current_tick >> (level * HM_TIMER_WHEEL_LEVEL_BITS);
+    if (index - current_index >= HM_TIMER_WHEEL_SLOT_COUNT) {
+        /* Too far in the future even for the top level: the timer is cascaded down again (and re-linked here) until
+           it fits. */
+        index = current_index + HM_TIMER_WHEEL_SLOT_COUNT - 1;
+    }
+    hmTimerWheelNode** slot = &timer_wheel->slots[level][index & HM_TIMER_WHEEL_SLOT_MASK];
+    node->prev = HM_NULL;
+    node->next = *slot;
+    if (*slot) {
+        (*slot)->prev = node;
+    }
+    *slot = node;
+    node->slot = slot;
+}
+
+static void hmTimerWheelUnlink(hmTimerWheelNode* node)
+{
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        *node->slot = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
+    node->slot = HM_NULL;
+}
+
+static void hmTimerWheelFreeNode(hmTimerWheel* timer_wheel, hmTimerWheelNode* node)
+{
+    node->slot = HM_NULL;
+    node->next = timer_wheel->free_nodes;
+    timer_wheel->free_nodes = node;
+}
+
+static hmError hmTimerWheelDisposeNodeList(hmTimerWheel* timer_wheel, hmTimerWheelNode* node)
+{
+    hmError err = HM_OK;
+    while (node) {
+        hmTimerWheelNode* next = node->next;
+        if (timer_wheel->item_dispose_func_opt) {
+            err = hmMergeErrors(err, timer_wheel->item_dispose_func_opt(node->item));
+        }
+        hmFree(timer_wheel->allocator, node);
+        node = next;
+    }
+    return err;
+}
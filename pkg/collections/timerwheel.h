@@ -0,0 +1,86 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_TIMER_WHEEL_H
+#define HM_TIMER_WHEEL_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+
+/* An internal hardcoded limit for optimization (same as HM_WORKER_MAX_ITEM_SIZE, so that any work item can be scheduled). */
+#define HM_TIMER_WHEEL_MAX_ITEM_SIZE 1024
+#define HM_TIMER_WHEEL_LEVEL_BITS    6
+#define HM_TIMER_WHEEL_SLOT_COUNT    (1 << HM_TIMER_WHEEL_LEVEL_BITS) /* Slots per level. */
+#define HM_TIMER_WHEEL_LEVEL_COUNT   4 /* With 64 slots per level, covers 16M ticks before timers have to be re-cascaded. */
+
+struct hmTimerWheelNode_;
+
+/* A handle to a scheduled timer, see hmTimerWheelCancel(..) Handles stay safe to use after the timer fires or is cancelled. */
+typedef struct {
+    struct hmTimerWheelNode_* node;
+    hm_uint64                 id;
+} hmTimer;
+
+/* Called for every expired item: the item is moved out of the timer wheel (the callee takes ownership). If an error is
+   returned, the timer wheel disposes of the item itself. */
+typedef hmError (*hmTimerWheelExpireFunc)(void* item, void* user_data);
+
+typedef struct {
+    hmAllocator*              allocator;
+    struct hmTimerWheelNode_* slots[HM_TIMER_WHEEL_LEVEL_COUNT][HM_TIMER_WHEEL_SLOT_COUNT];
+    struct hmTimerWheelNode_* free_nodes;            /* Nodes are reused instead of being freed, see hmTimer. */
+    hmDisposeFunc             item_dispose_func_opt;
+    hm_nint                   item_size;
+    hm_nint                   count;                 /* The number of scheduled timers. */
+    hm_uint64                 current_tick;
+    hm_uint64                 last_id;
+} hmTimerWheel;
+
+/* A hierarchical timer wheel allows to schedule a very large number of timers (for example, per-connection and per-request
+   deadlines) with O(1) insertion and cancellation: a timer is put into one of the slots of the level which matches how far
+   in the future it expires, and timers of the upper levels are moved ("cascaded") to the lower levels as time goes by.
+   Time is measured in abstract ticks: the timer wheel doesn't read the clock by itself, so it can be driven by an event
+   loop or a dedicated thread (see hmTimerService). Not thread-safe.
+   `item_size` is the size of an item stored with every timer; returns HM_ERROR_INVALID_ARGUMENT if it's bigger than
+    HM_TIMER_WHEEL_MAX_ITEM_SIZE.
+   `item_dispose_func_opt` specifies how items of timers which were cancelled, or never fired before the timer wheel
+    was disposed of, are disposed of. Can be HM_NULL. */
+hmError hmCreateTimerWheel(
+    hmAllocator*  allocator,
+    hm_nint       item_size,
+    hmDisposeFunc item_dispose_func_opt,
+    hmTimerWheel* in_timer_wheel
+);
+hmError hmTimerWheelDispose(hmTimerWheel* timer_wheel);
+/* Schedules a timer which expires at `expiry_tick`. If the tick is already current or in the past, the timer expires
+   on the next hmTimerWheelAdvance(..) The item's value is moved inside the timer wheel.
+   `out_timer_opt` receives a handle which can be used to cancel the timer. Can be HM_NULL. */
+hmError hmTimerWheelAdd(hmTimerWheel* timer_wheel, hm_uint64 expiry_tick, void* in_item, hmTimer* out_timer_opt);
+/* Cancels a scheduled timer and disposes of its item. Returns HM_ERROR_NOT_FOUND if the timer has already expired or
+   has already been cancelled. */
+hmError hmTimerWheelCancel(hmTimerWheel* timer_wheel, hmTimer* timer);
+/* Moves the current tick forward to `tick`, calling `expire_func` for every timer which expires on the way, in the order
+   of their expiry ticks. Does nothing if `tick` isn't in the future. Errors returned by `expire_func` don't stop the
+   process: all the errors are merged and returned at the end. */
+hmError hmTimerWheelAdvance(hmTimerWheel* timer_wheel, hm_uint64 tick, hmTimerWheelExpireFunc expire_func, void* user_data);
+/* Returns the next tick (always in the future) at which the timer wheel has work to do, so that the caller could sleep
+   until then instead of advancing the timer wheel tick by tick. It's never later than the expiry of the earliest timer,
+   but can be earlier: timers of the upper levels are only known to expire somewhere within the range of their slot, so
+   for them, it's the tick at which their slot is cascaded; the caller then advances the timer wheel and asks again. Only
+   the first non-empty slot of every level is looked at, so it costs at most a few hundred slot checks regardless of the
+   number of timers. Returns HM_ERROR_NOT_FOUND if there are no timers. */
+hmError hmTimerWheelGetNextExpiry(hmTimerWheel* timer_wheel, hm_uint64* out_tick);
+#define hmTimerWheelGetCount(timer_wheel) (timer_wheel)->count
+#define hmTimerWheelGetCurrentTick(timer_wheel) (timer_wheel)->current_tick
+
+#endif /* HM_TIMER_WHEEL_H */
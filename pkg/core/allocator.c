@@ -197,6 +197,29 @@ static hmError hmBumpPointerAllocator_dispose(hmAllocator* allocator)
     return HM_OK;
 }
 
+void hmBumpPointerAllocatorReset(hmAllocator* allocator)
+{
+    hmBumpPointerAllocatorData* data = (hmBumpPointerAllocatorData*)allocator->data;
+    hmBumpPointerAllocatorSegment* cur_segment = data->cur_segment;
+    if (cur_segment) {
+        hmBumpPointerAllocatorSegment* next_segment = cur_segment->next;
+        while (next_segment) {
+            hmBumpPointerAllocatorSegment* segment = next_segment;
+            next_segment = segment->next;
+            hmFree(data->base_allocator, segment);
+        }
+        cur_segment->next = HM_NULL;
+        cur_segment->index = 0;
+    }
+    for (hm_nint i = 0; i < data->large_object_count; i++) {
+        hmFree(data->base_allocator, data->large_objects[i]);
+    }
+    hmFree(data->base_allocator, data->large_objects);
+    data->large_objects = HM_NULL;
+    data->large_object_count = 0;
+    data->used_memory = 0;
+}
+
 hmError hmCreateBumpPointerAllocator(hmAllocator* base_allocator, hm_nint memory_limit, hmAllocator* in_allocator)
 {
     hmBumpPointerAllocatorData* data = hmAlloc(base_allocator, sizeof(hmBumpPointerAllocatorData));
@@ -70,6 +70,10 @@ hmError hmCreateSystemAllocator(hmAllocator* in_allocator);
    HM_NINT_MAX means there's practically no limit, however it may be limited by the base allocator's own limits.
    The minimum amount of memory reserved for the allocator is HM_BUMP_POINTER_ALLOCATOR_SEGMENT_SIZE. */
 hmError hmCreateBumpPointerAllocator(hmAllocator* base_allocator, hm_nint memory_limit, hmAllocator* in_allocator);
+/* Frees everything allocated with the given bump pointer allocator at once, except for the last segment, which is kept
+   for future allocations, so that an allocator reused in a loop doesn't go to the base allocator every time.
+   WARNING It may crash if the underlying allocator is not a BumpPointerAllocator. */
+void hmBumpPointerAllocatorReset(hmAllocator* allocator);
 /* Creates an allocator which wraps another allocator and additionally keeps track of statistics. */
 hmError hmCreateStatsAllocator(hmAllocator* base_allocator, hmAllocator* in_allocator);
 /* Returns the number of allocations.
@@ -34,6 +34,7 @@ typedef uint16_t hm_uint16;
 typedef uint32_t hm_uint32;
 typedef int32_t hm_int32;
 typedef uint64_t hm_uint64;
+typedef int64_t hm_int64;
 typedef uint64_t hm_millis;
 /* Represents a Unicode code point (in the 32-bit range). The name follows Go's convention to make it clear
    it's different from the usual "char". */
@@ -49,6 +50,9 @@ typedef double hm_float64;
 #define HM_UINT32_MAX UINT32_MAX
 #define HM_INT32_MIN INT32_MIN
 #define HM_INT32_MAX INT32_MAX
+#define HM_INT64_MIN INT64_MIN
+#define HM_INT64_MAX INT64_MAX
+#define HM_UINT64_MAX UINT64_MAX
 #define HM_NINT_MAX UINTPTR_MAX
 #define HM_MILLIS_MAX UINT32_MAX
 
@@ -18,11 +18,23 @@
 #include <core/string.h>
 #include <collections/array.h>
 
+/* A processor the current process is allowed to run on (see hmGetAvailableProcessors(..)) */
+typedef struct {
+    hm_nint index; /* The index of the processor as understood by the OS (see hmThreadSetAffinity(..)) */
+    hm_nint node;  /* The NUMA node the processor belongs to. Always 0 on systems without NUMA. */
+} hmProcessorInfo;
+
 /* Gets the number of milliseconds elapsed since a platform-dependent epoch. */
 hm_millis hmGetTickCount();
 /* Returns the number of processors available in the current environment.
    May return 1 if it's not possible to detect the number of processors. */
 hm_nint hmGetProcessorCount();
+/* Returns the list of processors the current process is allowed to run on (which can be fewer than all processors in the
+   system, for example, inside a container), together with the NUMA nodes they belong to. Useful for pinning threads to
+   processors (see hmCreateThreadWithAffinity(..))
+   `in_array` is an array of hmProcessorInfo, ordered by processor index, which should be disposed by the caller with
+   hmArrayDispose(..) */
+hmError hmGetAvailableProcessors(hmAllocator* allocator, hmArray* in_array);
 /* Returns the size of the available memory of the entire device, in bytes. Useful for diagnostics. */
 hm_nint hmGetAvailableMemory();
 /* Returns a list of the program's command line arguments as passed to the executable (not including the
@@ -0,0 +1,491 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <core/format.h>
+#include <core/math.h>
+#include <core/utils.h>
+
+/* Digits are converted two at a time using this table, which halves the number of (expensive) divisions. */
+static const char HM_DIGIT_PAIRS[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char HM_HEX_DIGITS[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+};
+
+static hm_nint hmGetDecimalLength(hm_uint64 value);
+static void hmWriteDecimalDigits(hm_uint64 value, char* buffer_end);
+static hm_nint hmWriteZeros(char* buffer, hm_nint count);
+static void hmConvertFloat64ToDecimal(
+    hm_uint64  ieee_mantissa,
+    hm_uint32  ieee_exponent,
+    hm_uint64* out_mantissa,
+    hm_int32*  out_exponent
+);
+
+hm_nint hmFormatUint64(hm_uint64 value, char* buffer)
+{
+    hm_nint length = hmGetDecimalLength(value);
+    hmWriteDecimalDigits(value, buffer + length);
+    return length;
+}
+
+hm_nint hmFormatInt64(hm_int64 value, char* buffer)
+{
+    if (value >= 0) {
+        return hmFormatUint64((hm_uint64)value, buffer);
+    }
+    buffer[0] = '-';
+    /* Negation is done on unsigned values to correctly handle HM_INT64_MIN (its absolute value doesn't fit
+       in hm_int64). */
+    return hmFormatUint64(0u - (hm_uint64)value, buffer + 1) + 1;
+}
+
+hm_nint hmFormatHex(hm_uint64 value, char* buffer)
+{
+    hm_nint length = 1;
+    for (hm_uint64 rest = value >> 4; rest; rest >>= 4) {
+        length++;
+    }
+    for (hm_nint i = length; i > 0; i--) {
+        buffer[i - 1] = HM_HEX_DIGITS[value & 0xF];
+        value >>= 4;
+    }
+    return length;
+}
+
+hm_nint hmFormatFloat64(hm_float64 value, char* buffer)
+{
+    hm_uint64 bits = 0;
+    hmCopyMemory(&bits, &value, sizeof(hm_uint64));
+    hm_bool is_negative = (bits >> 63) != 0;
+    hm_uint64 ieee_mantissa = bits & ((1ull << 52) - 1);
+    hm_uint32 ieee_exponent = (hm_uint32)((bits >> 52) & 0x7FF);
+    hm_nint index = 0;
+    if (ieee_exponent == 0x7FF) {
+        if (ieee_mantissa) {
+            hmCopyMemory(buffer, "NaN", 3);
+            return 3;
+        }
+        if (is_negative) {
+            buffer[index++] = '-';
+        }
+        hmCopyMemory(buffer + index, "Infinity", 8);
+        return index + 8;
+    }
+    if (is_negative) {
+        buffer[index++] = '-';
+    }
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        buffer[index++] = '0';
+        return index;
+    }
+    hm_uint64 mantissa = 0;
+    hm_int32 exponent = 0;
+    hmConvertFloat64ToDecimal(ieee_mantissa, ieee_exponent, &mantissa, &exponent);
+    /* The value is now `digits * 10^exponent`; `point_position` is where the decimal point goes relative to the first
+       digit (see Number::toString in the ECMAScript specification: `digit_count` is "k", `point_position` is "n"). */
+    char digits[HM_FORMAT_BUFFER_SIZE];
+    hm_int32 digit_count = (hm_int32)hmFormatUint64(mantissa, digits);
+    hm_int32 point_position = digit_count + exponent;
+    if (digit_count <= point_position && point_position <= 21) {        /* 1200 */
+        hmCopyMemory(buffer + index, digits, digit_count);
+        index += digit_count;
+        index += hmWriteZeros(buffer + index, point_position - digit_count);
+    } else if (0 < point_position && point_position <= 21) {            /* 12.34 */
+        hmCopyMemory(buffer + index, digits, point_position);
+        index += point_position;
+        buffer[index++] = '.';
+        hmCopyMemory(buffer + index, digits + point_position, digit_count - point_position);
+        index += digit_count - point_position;
+    } else if (-6 < point_position && point_position <= 0) {            /* 0.0012 */
+        buffer[index++] = '0';
+        buffer[index++] = '.';
+        index += hmWriteZeros(buffer + index, -point_position);
+        hmCopyMemory(buffer + index, digits, digit_count);
+        index += digit_count;
+    } else {                                                            /* 1.2e+34 */
+        buffer[index++] = digits[0];
+        if (digit_count > 1) {
+            buffer[index++] = '.';
+            hmCopyMemory(buffer + index, digits + 1, digit_count - 1);
+            index += digit_count - 1;
+        }
+        buffer[index++] = 'e';
+        hm_int32 scientific_exponent = point_position - 1;
+        buffer[index++] = scientific_exponent < 0 ? '-' : '+';
+        index += hmFormatUint64(scientific_exponent < 0 ? -scientific_exponent : scientific_exponent, buffer + index);
+    }
+    return index;
+}
+
+static hm_nint hmGetDecimalLength(hm_uint64 value)
+{
+    hm_nint length = 1;
+    /* Four digits per step keeps the number of comparisons small for typical values. */
+    while (value >= 10000) {
+        value /= 10000;
+        length += 4;
+    }
+    if (value >= 1000) {
+        return length + 3;
+    }
+    if (value >= 100) {
+        return length + 2;
+    }
+    if (value >= 10) {
+        return length + 1;
+    }
+    return length;
+}
+
+/* Writes digits from right to left, ending right before `buffer_end`. */
+static void hmWriteDecimalDigits(hm_uint64 value, char* buffer_end)
+{
+    while (value >= 100) {
+        hm_uint32 pair_index = (hm_uint32)(value % 100) * 2;
+        value /= 100;
+        buffer_end -= 2;
+        buffer_end[0] = HM_DIGIT_PAIRS[pair_index];
+        buffer_end[1] = HM_DIGIT_PAIRS[pair_index + 1];
+    }
+    if (value >= 10) {
+        hm_uint32 pair_index = (hm_uint32)value * 2;
+        buffer_end -= 2;
+        buffer_end[0] = HM_DIGIT_PAIRS[pair_index];
+        buffer_end[1] = HM_DIGIT_PAIRS[pair_index + 1];
+    } else {
+        buffer_end[-1] = (char)('0' + value);
+    }
+}
+
+static hm_nint hmWriteZeros(char* buffer, hm_nint count)
+{
+    for (hm_nint i = 0; i < count; i++) {
+        buffer[i] = '0';
+    }
+    return count;
+}
+
+/* ************************ */
+/*    Shortest round-trip.  */
+/* ************************ */
+
+/* Based on github.com/ulfjack/ryu (Apache License 2.0 or Boost Software License 1.0), the "small table" variant:
+   the 128-bit powers of 5 are computed on the fly from a few base entries instead of being stored in ~10KB tables. */
+
+#define HM_DOUBLE_MANTISSA_BITS 52
+#define HM_DOUBLE_BIAS 1023
+#define HM_DOUBLE_POW5_INV_BITCOUNT 125
+#define HM_DOUBLE_POW5_BITCOUNT 125
+#define HM_POW5_TABLE_SIZE 26
+
+static const hm_uint64 HM_DOUBLE_POW5_INV_SPLIT2[15][2] = {
+    {                    1u, 2305843009213693952u },
+    {  5955668970331000884u, 1784059615882449851u },
+    {  8982663654677661702u, 1380349269358112757u },
+    {  7286864317269821294u, 2135987035920910082u },
+    {  7005857020398200553u, 1652639921975621497u },
+    { 17965325103354776697u, 1278668206209430417u },
+    {  8928596168509315048u, 1978643211784836272u },
+    { 10075671573058298858u, 1530901034580419511u },
+    {   597001226353042382u, 1184477304306571148u },
+    {  1527430471115325346u, 1832889850782397517u },
+    { 12533209867169019542u, 1418129833677084982u },
+    {  5577825024675947042u, 2194449627517475473u },
+    { 11006974540203867551u, 1697873161311732311u },
+    { 10313493231639821582u, 1313665730009899186u },
+    { 12701016819766672773u, 2032799256770390445u }
+};
+
+static const hm_uint32 HM_POW5_INV_OFFSETS[19] = {
+    0x54544554, 0x04055545, 0x10041000, 0x00400414, 0x40010000, 0x41155555, 0x00000454, 0x00010044,
+    0x40000000, 0x44000041, 0x50454450, 0x55550054, 0x51655554, 0x40004000, 0x01000001, 0x00010500,
+    0x51515411, 0x05555554, 0x00000000
+};
+
+static const hm_uint64 HM_DOUBLE_POW5_SPLIT2[13][2] = {
+    {                    0u, 1152921504606846976u },
+    {                    0u, 1490116119384765625u },
+    {  1032610780636961552u, 1925929944387235853u },
+    {  7910200175544436838u, 1244603055572228341u },
+    { 16941905809032713930u, 1608611746708759036u },
+    { 13024893955298202172u, 2079081953128979843u },
+    {  6607496772837067824u, 1343575221513417750u },
+    { 17332926989895652603u, 1736530273035216783u },
+    { 13037379183483547984u, 2244412773384604712u },
+    {  1605989338741628675u, 1450417759929778918u },
+    {  9630225068416591280u, 1874621017369538693u },
+    {   665883850346957067u, 1211445438634777304u },
+    { 14931890668723713708u, 1565756531257009982u }
+};
+
+static const hm_uint32 HM_POW5_OFFSETS[21] = {
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x40000000, 0x59695995, 0x55545555, 0x56555515,
+    0x41150504, 0x40555410, 0x44555145, 0x44504540, 0x45555550, 0x40004000, 0x96440440, 0x55565565,
+    0x54454045, 0x40154151, 0x55559155, 0x51405555, 0x00000105
+};
+
+static const hm_uint64 HM_DOUBLE_POW5_TABLE[HM_POW5_TABLE_SIZE] = {
+    1u, 5u, 25u, 125u, 625u, 3125u, 15625u, 78125u, 390625u, 1953125u, 9765625u, 48828125u, 244140625u,
+    1220703125u, 6103515625u, 30517578125u, 152587890625u, 762939453125u, 3814697265625u, 19073486328125u,
+    95367431640625u, 476837158203125u, 2384185791015625u, 11920928955078125u, 59604644775390625u,
+    298023223876953125u
+};
+
+/* Returns e == 0 ? 1 : ceil(log2(5^e)); requires 0 <= e <= 3528. */
+static hm_int32 hmPow5Bits(hm_int32 e)
+{
+    return (hm_int32)((((hm_uint32)e * 1217359) >> 19) + 1);
+}
+
+/* Returns floor(log10(2^e)); requires 0 <= e <= 1650. */
+static hm_uint32 hmLog10Pow2(hm_int32 e)
+{
+    return ((hm_uint32)e * 78913) >> 18;
+}
+
+/* Returns floor(log10(5^e)); requires 0 <= e <= 2620. */
+static hm_uint32 hmLog10Pow5(hm_int32 e)
+{
+    return ((hm_uint32)e * 732923) >> 20;
+}
+
+static hm_uint32 hmPow5Factor(hm_uint64 value)
+{
+    const hm_uint64 m_inv_5 = 14757395258967641293u; /* 5 * m_inv_5 = 1 (mod 2^64) */
+    const hm_uint64 n_div_5 = 3689348814741910323u;  /* 2^64 / 5 */
+    hm_uint32 count = 0;
+    for (;;) {
+        value *= m_inv_5;
+        if (value > n_div_5) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+static hm_bool hmIsMultipleOfPowerOf5(hm_uint64 value, hm_uint32 p)
+{
+    return hmPow5Factor(value) >= p;
+}
+
+static hm_bool hmIsMultipleOfPowerOf2(hm_uint64 value, hm_uint32 p)
+{
+    return (value & ((1ull << p) - 1)) == 0;
+}
+
+/* Shifts the 128-bit value `high:low` right by `distance` (which is in range [1; 63]) and returns the lower 64 bits. */
+static hm_uint64 hmShiftRight128(hm_uint64 low, hm_uint64 high, hm_uint32 distance)
+{
+    return (high << (64 - distance)) | (low >> distance);
+}
+
+/* Computes 5^i in the form required by Ryu. */
+static void hmComputePow5(hm_uint32 i, hm_uint64* result)
+{
+    hm_uint32 base = i / HM_POW5_TABLE_SIZE;
+    hm_uint32 base2 = base * HM_POW5_TABLE_SIZE;
+    hm_uint32 offset = i - base2;
+    const hm_uint64* mul = HM_DOUBLE_POW5_SPLIT2[base];
+    if (offset == 0) {
+        result[0] = mul[0];
+        result[1] = mul[1];
+        return;
+    }
+    hm_uint64 m = HM_DOUBLE_POW5_TABLE[offset];
+    hm_uint64 high1 = 0;
+    hm_uint64 low1 = hmMulUint64Wide(m, mul[1], &high1);
+    hm_uint64 high0 = 0;
+    hm_uint64 low0 = hmMulUint64Wide(m, mul[0], &high0);
+    hm_uint64 sum = high0 + low1;
+    if (sum < high0) {
+        high1++;
+    }
+    hm_uint32 delta = (hm_uint32)(hmPow5Bits((hm_int32)i) - hmPow5Bits((hm_int32)base2));
+    hm_uint64 correction = (HM_POW5_OFFSETS[i / 16] >> ((i % 16) << 1)) & 3;
+    result[0] = hmShiftRight128(low0, sum, delta) + correction;
+    result[1] = hmShiftRight128(sum, high1, delta) + (result[0] < correction);
+}
+
+/* Computes 5^-i in the form required by Ryu. */
+static void hmComputeInvPow5(hm_uint32 i, hm_uint64* result)
+{
+    hm_uint32 base = (i + HM_POW5_TABLE_SIZE - 1) / HM_POW5_TABLE_SIZE;
+    hm_uint32 base2 = base * HM_POW5_TABLE_SIZE;
+    hm_uint32 offset = base2 - i;
+    const hm_uint64* mul = HM_DOUBLE_POW5_INV_SPLIT2[base]; /* 1/5^base2 */
+    if (offset == 0) {
+        result[0] = mul[0];
+        result[1] = mul[1];
+        return;
+    }
+    hm_uint64 m = HM_DOUBLE_POW5_TABLE[offset];
+    hm_uint64 high1 = 0;
+    hm_uint64 low1 = hmMulUint64Wide(m, mul[1], &high1);
+    hm_uint64 high0 = 0;
+    hm_uint64 low0 = hmMulUint64Wide(m, mul[0] - 1, &high0);
+    hm_uint64 sum = high0 + low1;
+    if (sum < high0) {
+        high1++;
+    }
+    hm_uint32 delta = (hm_uint32)(hmPow5Bits((hm_int32)base2) - hmPow5Bits((hm_int32)i));
+    hm_uint64 correction = 1 + ((HM_POW5_INV_OFFSETS[i / 16] >> ((i % 16) << 1)) & 3);
+    result[0] = hmShiftRight128(low0, sum, delta) + correction;
+    result[1] = hmShiftRight128(sum, high1, delta) + (result[0] < correction);
+}
+
+static hm_uint64 hmMulShift64(hm_uint64 m, const hm_uint64* mul, hm_int32 j)
+{
+    hm_uint64 high1 = 0;
+    hm_uint64 low1 = hmMulUint64Wide(m, mul[1], &high1);
+    hm_uint64 high0 = 0;
+    hmMulUint64Wide(m, mul[0], &high0);
+    hm_uint64 sum = high0 + low1;
+    if (sum < high0) {
+        high1++;
+    }
+    return hmShiftRight128(sum, high1, (hm_uint32)(j - 64));
+}
+
+/* Finds the shortest decimal `out_mantissa * 10^out_exponent` which lies within the rounding interval of the given
+   finite non-zero double. */
+static void hmConvertFloat64ToDecimal(
+    hm_uint64  ieee_mantissa,
+    hm_uint32  ieee_exponent,
+    hm_uint64* out_mantissa,
+    hm_int32*  out_exponent
+)
+{
+    hm_int32 e2 = 0;
+    hm_uint64 m2 = 0;
+    /* 2 is subtracted so that the bounds computation has 2 additional bits. */
+    if (ieee_exponent == 0) {
+        e2 = 1 - HM_DOUBLE_BIAS - HM_DOUBLE_MANTISSA_BITS - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (hm_int32)ieee_exponent - HM_DOUBLE_BIAS - HM_DOUBLE_MANTISSA_BITS - 2;
+        m2 = (1ull << HM_DOUBLE_MANTISSA_BITS) | ieee_mantissa;
+    }
+    hm_bool accept_bounds = (m2 & 1) == 0;
+    /* Step 2: determines the interval of valid decimal representations. */
+    hm_uint64 mv = 4 * m2;
+    hm_uint32 mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    /* Step 3: converts to a decimal power base using 128-bit arithmetic. */
+    hm_uint64 vr = 0, vp = 0, vm = 0;
+    hm_int32 e10 = 0;
+    hm_bool vm_is_trailing_zeros = HM_FALSE;
+    hm_bool vr_is_trailing_zeros = HM_FALSE;
+    hm_uint64 pow5[2] = {0, 0};
+    if (e2 >= 0) {
+        hm_uint32 q = hmLog10Pow2(e2) - (e2 > 3);
+        e10 = (hm_int32)q;
+        hm_int32 k = HM_DOUBLE_POW5_INV_BITCOUNT + hmPow5Bits((hm_int32)q) - 1;
+        hm_int32 i = -e2 + (hm_int32)q + k;
+        hmComputeInvPow5(q, pow5);
+        vr = hmMulShift64(4 * m2, pow5, i);
+        vp = hmMulShift64(4 * m2 + 2, pow5, i);
+        vm = hmMulShift64(4 * m2 - 1 - mm_shift, pow5, i);
+        if (q <= 21) {
+            /* Only one of mp, mv, and mm can be a multiple of 5, if any. */
+            if (mv % 5 == 0) {
+                vr_is_trailing_zeros = hmIsMultipleOfPowerOf5(mv, q);
+            } else if (accept_bounds) {
+                vm_is_trailing_zeros = hmIsMultipleOfPowerOf5(mv - 1 - mm_shift, q);
+            } else {
+                vp -= hmIsMultipleOfPowerOf5(mv + 2, q);
+            }
+        }
+    } else {
+        hm_uint32 q = hmLog10Pow5(-e2) - (-e2 > 1);
+        e10 = (hm_int32)q + e2;
+        hm_int32 i = -e2 - (hm_int32)q;
+        hm_int32 k = hmPow5Bits(i) - HM_DOUBLE_POW5_BITCOUNT;
+        hm_int32 j = (hm_int32)q - k;
+        hmComputePow5((hm_uint32)i, pow5);
+        vr = hmMulShift64(4 * m2, pow5, j);
+        vp = hmMulShift64(4 * m2 + 2, pow5, j);
+        vm = hmMulShift64(4 * m2 - 1 - mm_shift, pow5, j);
+        if (q <= 1) {
+            /* mv = 4 * m2, so it always has at least two trailing 0 bits. */
+            vr_is_trailing_zeros = HM_TRUE;
+            if (accept_bounds) {
+                vm_is_trailing_zeros = mm_shift == 1;
+            } else {
+                vp--;
+            }
+        } else if (q < 63) {
+            vr_is_trailing_zeros = hmIsMultipleOfPowerOf2(mv, q);
+        }
+    }
+    /* Step 4: finds the shortest decimal representation in the interval of valid representations. */
+    hm_int32 removed = 0;
+    hm_uint8 last_removed_digit = 0;
+    hm_uint64 output = 0;
+    if (vm_is_trailing_zeros || vr_is_trailing_zeros) {
+        /* The general case, which happens rarely (~0.7%). */
+        while (vp / 10 > vm / 10) {
+            vm_is_trailing_zeros &= vm % 10 == 0;
+            vr_is_trailing_zeros &= last_removed_digit == 0;
+            last_removed_digit = (hm_uint8)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_is_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_is_trailing_zeros &= last_removed_digit == 0;
+                last_removed_digit = (hm_uint8)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+            last_removed_digit = 4; /* rounds to even if the exact number is .....50..0 */
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_is_trailing_zeros)) || last_removed_digit >= 5);
+    } else {
+        /* The common case (~99.3%). */
+        hm_bool round_up = HM_FALSE;
+        if (vp / 100 > vm / 100) { /* removes two digits at a time (~86.2%) */
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *out_mantissa = output;
+    *out_exponent = e10 + removed;
+}
@@ -0,0 +1,39 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_FORMAT_H
+#define HM_FORMAT_H
+
+#include <core/common.h>
+
+/* The minimum size of a buffer passed to any of the hmFormatXxx functions below: enough for the longest output
+   of any of them. The functions never write a null terminator. */
+#define HM_FORMAT_BUFFER_SIZE 32
+
+/* Allocation-free conversion of numbers to text. Each function writes the characters to `buffer` (which must have
+   space for at least HM_FORMAT_BUFFER_SIZE characters) and returns the number of characters written.
+   Unlike sprintf(..), these functions never depend on the current locale and never parse a format string. */
+
+/* Formats an unsigned integer in decimal notation. */
+hm_nint hmFormatUint64(hm_uint64 value, char* buffer);
+/* Formats a signed integer in decimal notation ('-' is prepended for negative values). */
+hm_nint hmFormatInt64(hm_int64 value, char* buffer);
+/* Formats an unsigned integer in hexadecimal notation, lowercase, without the "0x" prefix or leading zeros. */
+hm_nint hmFormatHex(hm_uint64 value, char* buffer);
+/* Formats a floating-point value using the shortest sequence of digits which parses back to exactly the same value.
+   Follows the rules of JavaScript's Number.prototype.toString(): the decimal notation is used for values in range
+   [1e-6; 1e21), the scientific notation otherwise ("1.5e+300"). Integral values are printed without a fractional part.
+   Special values are formatted as "NaN", "Infinity" and "-Infinity"; negative zero is formatted as "-0". */
+hm_nint hmFormatFloat64(hm_float64 value, char* buffer);
+
+#endif /* HM_FORMAT_H */
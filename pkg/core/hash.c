@@ -12,52 +12,181 @@
 * ******************************************************************************/
 
 #include <core/hash.h>
+#include <core/math.h>
 #include <core/utils.h>
 
 /* Based on github.com/wangyi-fudan/wyhash which is in public domain. */
 
-static hm_uint32 wyr32(const hm_uint8 *p)
+#define HM_WYHASH_SECRET0 0xa0761d6478bd642full
+#define HM_WYHASH_SECRET1 0xe7037ed1a0b428dbull
+#define HM_WYHASH_SECRET2 0x8ebc6af09c88c6e3ull
+#define HM_WYHASH_SECRET3 0x589965cc75374cc3ull
+
+static hm_uint64 wyr64(const hm_uint8* p);
+static hm_uint64 wyr32(const hm_uint8* p);
+static hm_uint64 wyr3(const hm_uint8* p, hm_nint k);
+static void wymum(hm_uint64* a, hm_uint64* b);
+static hm_uint64 wymix(hm_uint64 a, hm_uint64 b);
+static hm_uint64 hmHashInitSeed(hm_uint64 salt);
+static void hmHashRound(const hm_uint8* p, hm_uint64* seed, hm_uint64* see1);
+static hm_uint64 hmHashMergeLanes(hm_uint64 total_size, hm_uint64 seed, hm_uint64 see1);
+static hm_uint64 hmHashFinish(const hm_uint8* p, hm_nint tail_size, hm_uint64 total_size, hm_uint64 seed);
+
+hm_uint32 hmHash(void* bytes, hm_nint size, hm_uint32 salt)
+{
+    hm_uint64 hash = hmHash64(bytes, size, salt);
+    return (hm_uint32)(hash ^ (hash >> 32));
+}
+
+hm_uint64 hmHash64(const void* bytes, hm_nint size, hm_uint64 salt)
+{
+    const hm_uint8* p = (const hm_uint8*)bytes;
+    hm_uint64 seed = hmHashInitSeed(salt);
+    hm_uint64 see1 = seed;
+    hm_nint i = size;
+    /* The last block is always processed by hmHashFinish(..) so that hmHasher could produce identical results without
+       knowing in advance where the data ends. */
+    for (; i > HM_HASHER_BLOCK_SIZE; i -= HM_HASHER_BLOCK_SIZE, p += HM_HASHER_BLOCK_SIZE) {
+        hmHashRound(p, &seed, &see1);
+    }
+    return hmHashFinish(p, i, size, hmHashMergeLanes(size, seed, see1));
+}
+
+void hmHash64Many(const void* keys, hm_nint key_size, hm_nint count, hm_uint64 salt, hm_uint64* out_hashes)
+{
+    const hm_uint8* key = (const hm_uint8*)keys;
+    hm_uint64 initial_seed = hmHashInitSeed(salt);
+    for (hm_nint i = 0; i < count; i++) {
+        const hm_uint8* p = key;
+        hm_uint64 seed = initial_seed;
+        hm_uint64 see1 = initial_seed;
+        hm_nint j = key_size;
+        for (; j > HM_HASHER_BLOCK_SIZE; j -= HM_HASHER_BLOCK_SIZE, p += HM_HASHER_BLOCK_SIZE) {
+            hmHashRound(p, &seed, &see1);
+        }
+        out_hashes[i] = hmHashFinish(p, j, key_size, hmHashMergeLanes(key_size, seed, see1));
+        key += key_size; /* No overflow checks because `keys` is an existing buffer of `key_size*count` bytes. */
+    }
+}
+
+hmError hmCreateHasher(hm_uint64 salt, hmHasher* in_hasher)
+{
+    in_hasher->seed = hmHashInitSeed(salt);
+    in_hasher->see1 = in_hasher->seed;
+    in_hasher->total_size = 0;
+    in_hasher->buffer_size = 0;
+    return HM_OK;
+}
+
+hmError hmHasherDispose(hmHasher* hasher)
+{
+    /* Nothing to do. */
+    return HM_OK;
+}
+
+void hmHasherUpdate(hmHasher* hasher, const void* bytes, hm_nint size)
+{
+    const hm_uint8* p = (const hm_uint8*)bytes;
+    hasher->total_size += size;
+    /* Fills up the pending block first. The block is processed only when it's known that more data follows it
+       (see the comment in hmHash64(..)). */
+    if (hasher->buffer_size > 0) {
+        hm_nint to_copy = HM_HASHER_BLOCK_SIZE - hasher->buffer_size;
+        if (to_copy > size) {
+            to_copy = size;
+        }
+        hmCopyMemory(hasher->buffer + hasher->buffer_size, p, to_copy);
+        hasher->buffer_size += to_copy;
+        p += to_copy;
+        size -= to_copy;
+        if (!size) {
+            return;
+        }
+        hmHashRound(hasher->buffer, &hasher->seed, &hasher->see1);
+        hasher->buffer_size = 0;
+    }
+    for (; size > HM_HASHER_BLOCK_SIZE; size -= HM_HASHER_BLOCK_SIZE, p += HM_HASHER_BLOCK_SIZE) {
+        hmHashRound(p, &hasher->seed, &hasher->see1);
+    }
+    hmCopyMemory(hasher->buffer, p, size);
+    hasher->buffer_size = size;
+}
+
+hm_uint64 hmHasherGetHash(hmHasher* hasher)
+{
+    hm_uint64 seed = hmHashMergeLanes(hasher->total_size, hasher->seed, hasher->see1);
+    return hmHashFinish(hasher->buffer, hasher->buffer_size, hasher->total_size, seed);
+}
+
+static hm_uint64 wyr64(const hm_uint8* p)
+{
+    hm_uint64 v = 0;
+    hmCopyMemory(&v, p, sizeof(hm_uint64));
+    return v;
+}
+
+static hm_uint64 wyr32(const hm_uint8* p)
 {
     hm_uint32 v = 0;
     hmCopyMemory(&v, p, sizeof(hm_uint32));
     return v;
 }
 
-static hm_uint32 wyr24(const hm_uint8 *p, hm_uint32 k)
+static hm_uint64 wyr3(const hm_uint8* p, hm_nint k)
 {
-    return (((hm_uint32)p[0]) << 16) | (((hm_uint32)p[k >> 1]) << 8) | p[k - 1];
+    return (((hm_uint64)p[0]) << 16) | (((hm_uint64)p[k >> 1]) << 8) | p[k - 1];
 }
 
-static void wymix32(hm_uint32 *A, hm_uint32 *B)
+static void wymum(hm_uint64* a, hm_uint64* b)
 {
-    uint64_t c = *A ^ 0x53c5ca59u;
-    c *= *B ^ 0x74743c1bu;
-    *A = (hm_uint32)c;
-    *B = (hm_uint32)(c >> 32);
+    hm_uint64 high = 0;
+    *a = hmMulUint64Wide(*a, *b, &high);
+    *b = high;
 }
 
-hm_uint32 hmHash(void* bytes, hm_nint size, hm_uint32 salt)
+static hm_uint64 wymix(hm_uint64 a, hm_uint64 b)
+{
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+static hm_uint64 hmHashInitSeed(hm_uint64 salt)
+{
+    return salt ^ wymix(salt ^ HM_WYHASH_SECRET0, HM_WYHASH_SECRET1);
+}
+
+static void hmHashRound(const hm_uint8* p, hm_uint64* seed, hm_uint64* see1)
+{
+    /* Two independent lanes allow the CPU to execute both multiplications in parallel. */
+    *seed = wymix(wyr64(p) ^ HM_WYHASH_SECRET1, wyr64(p + 8) ^ *seed);
+    *see1 = wymix(wyr64(p + 16) ^ HM_WYHASH_SECRET2, wyr64(p + 24) ^ *see1);
+}
+
+static hm_uint64 hmHashMergeLanes(hm_uint64 total_size, hm_uint64 seed, hm_uint64 see1)
+{
+    /* Both lanes start with the same value, so merging them when no rounds were made would cancel out the salt. */
+    return total_size > HM_HASHER_BLOCK_SIZE ? seed ^ see1 : seed;
+}
+
+/* `tail_size` is in range [0; HM_HASHER_BLOCK_SIZE] */
+static hm_uint64 hmHashFinish(const hm_uint8* p, hm_nint tail_size, hm_uint64 total_size, hm_uint64 seed)
 {
-    if (!size) {
-        return salt;
+    hm_uint64 a = 0;
+    hm_uint64 b = 0;
+    if (tail_size > 16) {
+        seed = wymix(wyr64(p) ^ HM_WYHASH_SECRET1, wyr64(p + 8) ^ seed);
+        p += 16;
+        tail_size -= 16;
     }
-    const hm_uint8 *p = (const hm_uint8*)bytes;
-    hm_uint64 i = size;
-    hm_uint32 see1 = (hm_uint32)size;
-    salt ^= (hm_uint32)(size >> 32);
-    wymix32(&salt, &see1);
-    for (; i > 8; i -= 8, p += 8) {
-        salt ^= wyr32(p);
-        see1 ^= wyr32(p + 4);
-        wymix32(&salt, &see1);
+    if (tail_size >= 4) {
+        hm_nint shift = (tail_size >> 3) << 2;
+        a = (wyr32(p) << 32) | wyr32(p + shift);
+        b = (wyr32(p + tail_size - 4) << 32) | wyr32(p + tail_size - 4 - shift);
+    } else if (tail_size > 0) {
+        a = wyr3(p, tail_size);
     }
-    if (i >= 4) {
-        salt ^= wyr32(p);
-        see1 ^= wyr32(p + i - 4);
-     } else if (i) {
-        salt ^= wyr24(p, (hm_uint32)i);
-     }
-    wymix32(&salt, &see1);
-    wymix32(&salt, &see1);
-    return salt ^ see1;
+    a ^= HM_WYHASH_SECRET1;
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ HM_WYHASH_SECRET0 ^ total_size, b ^ HM_WYHASH_SECRET3);
 }
@@ -16,11 +16,41 @@
 
 #include <core/common.h>
 
+#define HM_HASHER_BLOCK_SIZE 32 /* The number of bytes consumed per round (see hmHash64(..) and hmHasher). */
+
+/* Allows to hash data which arrives in pieces (for example, from a reader) without materializing it in one contiguous
+   buffer first. The final hash is identical to the hash returned by hmHash64(..) for the concatenation of all the pieces.
+   The hasher owns no resources; it can be freely allocated on the stack. */
+typedef struct {
+    hm_uint64 seed;                         /* The state of the first lane. */
+    hm_uint64 see1;                         /* The state of the second lane. */
+    hm_uint64 total_size;                   /* The total number of bytes passed to hmHasherUpdate(..) so far. */
+    hm_nint   buffer_size;                  /* The number of pending bytes in `buffer`. */
+    hm_uint8  buffer[HM_HASHER_BLOCK_SIZE]; /* Pending bytes which are not yet known to be followed by more data. */
+} hmHasher;
+
 /* Hashes a byte buffer by mixing it with a predefined salt (to fight against hash DoS attacks).
    The salt should be stable for the duration of the process (subprocess) but different across different
    process (subprocess) runs.
    Returns uint32 (not native int) to make hashing more predictable across platforms. Unsigned values
-   also allow wraparounds without undefined behavior. */
+   also allow wraparounds without undefined behavior.
+   Implemented by folding the result of hmHash64(..), so it benefits from the same distribution and throughput. */
 hm_uint32 hmHash(void* bytes, hm_nint size, hm_uint32 salt);
+/* Same as hmHash(..), except returns the full 64-bit hash. Consumes HM_HASHER_BLOCK_SIZE bytes per round using two
+   independent 64-bit lanes, so it's noticeably faster on large inputs, and has fewer collisions in large tables. */
+hm_uint64 hmHash64(const void* bytes, hm_nint size, hm_uint64 salt);
+/* Hashes `count` keys of `key_size` bytes each, stored contiguously in `keys`, and places the results in `out_hashes`
+   (which must have space for `count` items). Equivalent to calling hmHash64(..) on every key, except that the
+   salt-dependent setup is done only once for all the keys. */
+void hmHash64Many(const void* keys, hm_nint key_size, hm_nint count, hm_uint64 salt, hm_uint64* out_hashes);
+
+/* Creates a hasher for incremental hashing (see hmHasher). For `salt`, see hmHash(..) */
+hmError hmCreateHasher(hm_uint64 salt, hmHasher* in_hasher);
+hmError hmHasherDispose(hmHasher* hasher);
+/* Feeds the next piece of data to the hasher. Pieces can be of any size, including zero. */
+void hmHasherUpdate(hmHasher* hasher, const void* bytes, hm_nint size);
+/* Returns the hash of all the data fed to the hasher so far. Does not change the state of the hasher, so it's
+   possible to continue feeding data afterwards. */
+hm_uint64 hmHasherGetHash(hmHasher* hasher);
 
 #endif /* HM_HASH_H */
@@ -77,3 +77,20 @@ hmError hmAbsInt32(hm_int32 value, hm_int32* out_value)
     *out_value = value >= 0 ? value : -value;
     return HM_OK;
 }
+
+hm_uint64 hmMulUint64Wide(hm_uint64 a, hm_uint64 b, hm_uint64* out_high)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 hm_uint128;
+    hm_uint128 result = (hm_uint128)a * b;
+    *out_high = (hm_uint64)(result >> 64);
+    return (hm_uint64)result;
+#else
+    /* Schoolbook multiplication of 32-bit halves; unsigned arithmetic wraps around without undefined behavior. */
+    hm_uint64 a_high = a >> 32, a_low = (hm_uint32)a, b_high = b >> 32, b_low = (hm_uint32)b;
+    hm_uint64 low_low = a_low * b_low, low_high = a_low * b_high, high_low = a_high * b_low, high_high = a_high * b_high;
+    hm_uint64 middle = (low_low >> 32) + (hm_uint32)low_high + (hm_uint32)high_low;
+    *out_high = high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+    return (middle << 32) | (hm_uint32)low_low;
+#endif
+}
@@ -32,5 +32,8 @@ hmError hmSubNint(hm_nint a, hm_nint b, hm_nint* result);
 /* Takes the absolute value of a 32-bit integer. Since taking the absolute value of the most negative integer
    is not defined, this function is designed to return HM_ERROR_INVALID_ARGUMENT if the value is HM_INT32_MIN. */
 hmError hmAbsInt32(hm_int32 value, hm_int32* out_value);
+/* Multiplies two 64-bit values without losing the upper half of the 128-bit result: returns the lower 64 bits and places
+   the upper 64 bits in `out_high`. Uses native 128-bit arithmetic where the compiler supports it. */
+hm_uint64 hmMulUint64Wide(hm_uint64 a, hm_uint64 b, hm_uint64* out_high);
 
 #endif /* HM_MATH_H */
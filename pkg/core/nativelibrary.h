@@ -0,0 +1,36 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_NATIVE_LIBRARY_H
+#define HM_NATIVE_LIBRARY_H
+
+#include <core/common.h>
+#include <core/string.h>
+
+/* A shared library (a shared object, a DLL) loaded into the current process, for example, ahead-of-time compiled code
+   (see runtime/aot.h). */
+typedef struct {
+    void* handle;
+} hmNativeLibrary;
+
+/* Loads the library at `path`, resolving all of its symbols right away. As with hmStartProcess(..), the path should be
+   absolute. Returns HM_ERROR_NOT_FOUND if there's no such file, and HM_ERROR_INVALID_DATA if the file can't be loaded
+   (for example, it's not a library). */
+hmError hmLoadNativeLibrary(hmString* path, hmNativeLibrary* in_library);
+/* Unloads the library: all the symbols it exports become invalid. */
+hmError hmNativeLibraryDispose(hmNativeLibrary* library);
+/* Returns the address of an exported symbol (a function or a variable). Returns HM_ERROR_NOT_FOUND if there's no such
+   symbol. */
+hmError hmNativeLibraryGetSymbol(hmNativeLibrary* library, const char* name, void** out_symbol);
+
+#endif /* HM_NATIVE_LIBRARY_H */
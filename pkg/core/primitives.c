@@ -12,11 +12,9 @@
 * ******************************************************************************/
 
 #include <core/primitives.h>
+#include <core/format.h>
 #include <core/hash.h>
 
-#include <inttypes.h> /* for PRId32 */
-#include <stdio.h> /* for sprintf(..) */
-
 hm_uint32 hmNintHashFunc(void* key, hm_uint32 salt)
 {
     return hmHash(key, sizeof(hm_nint), salt);
@@ -55,7 +53,7 @@ hm_bool hmUint32EqualsFunc(void* value1, void* value2)
 
 hmError hmInt32ToString(hmAllocator* allocator, hm_int32 value, hmString* in_string)
 {
-    char buffer[64];
-    sprintf(buffer, "%" PRId32, value);
-    return hmCreateStringFromCString(allocator, buffer, in_string);
+    char buffer[HM_FORMAT_BUFFER_SIZE];
+    hm_nint length_in_bytes = hmFormatInt64(value, buffer);
+    return hmCreateStringFromCStringWithLengthInBytes(allocator, buffer, length_in_bytes, in_string);
 }
@@ -0,0 +1,191 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <core/segmentedstringbuilder.h>
+#include <core/allocator.h>
+#include <core/math.h>
+#include <core/string.h>
+#include <core/utils.h>
+
+#include <string.h> /* for strlen(..) */
+
+static hmError hmSegmentedStringBuilderFlatten(hmSegmentedStringBuilder* string_builder, hmAllocator* allocator, char** out_chars);
+
+hmError hmCreateSegmentedStringBuilder(
+    hmAllocator*              allocator,
+    hm_nint                   segment_size,
+    hmSegmentedStringBuilder* in_string_builder
+)
+{
+    if (!segment_size) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    HM_TRY(hmCreateArray(
+        allocator,
+        sizeof(hmStringSegment),
+        HM_ARRAY_DEFAULT_CAPACITY,
+        HM_NULL, /* segments are freed manually because they require the allocator */
+        &in_string_builder->segments
+    ));
+    in_string_builder->allocator = allocator;
+    in_string_builder->segment_size = segment_size;
+    in_string_builder->last_segment_capacity = 0;
+    in_string_builder->length_in_bytes = 0;
+    return HM_OK;
+}
+
+hmError hmSegmentedStringBuilderDispose(hmSegmentedStringBuilder* string_builder)
+{
+    hmError err = hmSegmentedStringBuilderClear(string_builder);
+    return hmMergeErrors(err, hmArrayDispose(&string_builder->segments));
+}
+
+hmError hmSegmentedStringBuilderAppendCString(hmSegmentedStringBuilder* string_builder, const char* c_string)
+{
+    return hmSegmentedStringBuilderAppendCStringWithLength(string_builder, c_string, strlen(c_string));
+}
+
+hmError hmSegmentedStringBuilderAppendCStringWithLength(
+    hmSegmentedStringBuilder* string_builder,
+    const char*               c_string,
+    hm_nint                   length
+)
+{
+    if (!length) {
+        return HM_OK;
+    }
+    hm_nint new_length_in_bytes = 0;
+    HM_TRY(hmAddNint(string_builder->length_in_bytes, length, &new_length_in_bytes));
+    hm_nint segment_count = hmArrayGetCount(&string_builder->segments);
+    hm_nint free_space = 0;
+    if (segment_count > 0) {
+        hmStringSegment* last_segment = hmArrayGetRaw(&string_builder->segments, hmStringSegment) + segment_count - 1;
+        /* No hmSubNint because the length of a segment never exceeds its capacity. */
+        free_space = string_builder->last_segment_capacity - last_segment->length_in_bytes;
+        if (length <= free_space) {
+            hmCopyMemory(last_segment->chars + last_segment->length_in_bytes, c_string, length);
+            last_segment->length_in_bytes += length;
+            string_builder->length_in_bytes = new_length_in_bytes;
+            return HM_OK;
+        }
+    }
+    /* The rest of the content always fits in one new segment, which is allocated before anything is copied, so that
+       the content is never partially appended in case of an out-of-memory error. */
+    hm_nint remaining_length = length - free_space;
+    hm_nint new_segment_capacity = string_builder->segment_size;
+    if (new_segment_capacity < remaining_length) {
+        new_segment_capacity = remaining_length;
+    }
+    hm_nint new_segment_capacity_with_null = 0;
+    /* Reserves space for the null terminator, so that the segment could become a string's buffer without copying
+       (see hmSegmentedStringBuilderStealString(..)) */
+    HM_TRY(hmAddNint(new_segment_capacity, 1, &new_segment_capacity_with_null));
+    hmStringSegment new_segment;
+    new_segment.chars = (char*)hmAlloc(string_builder->allocator, new_segment_capacity_with_null);
+    if (!new_segment.chars) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    new_segment.length_in_bytes = 0;
+    hmError err = hmArrayAdd(&string_builder->segments, &new_segment);
+    if (err != HM_OK) {
+        hmFree(string_builder->allocator, new_segment.chars);
+        return err;
+    }
+    /* The raw array is retrieved after hmArrayAdd(..) because it could have been reallocated. */
+    hmStringSegment* segments = hmArrayGetRaw(&string_builder->segments, hmStringSegment);
+    if (free_space > 0) {
+        hmStringSegment* previous_segment = segments + segment_count - 1;
+        hmCopyMemory(previous_segment->chars + previous_segment->length_in_bytes, c_string, free_space);
+        previous_segment->length_in_bytes += free_space;
+    }
+    hmStringSegment* last_segment = segments + segment_count;
+    hmCopyMemory(last_segment->chars, c_string + free_space, remaining_length);
+    last_segment->length_in_bytes = remaining_length;
+    string_builder->last_segment_capacity = new_segment_capacity;
+    string_builder->length_in_bytes = new_length_in_bytes;
+    return HM_OK;
+}
+
+hmError hmSegmentedStringBuilderToString(
+    hmSegmentedStringBuilder* string_builder,
+    hmAllocator*              allocator_opt,
+    hmString*                 in_string
+)
+{
+    if (!allocator_opt) {
+        allocator_opt = string_builder->allocator;
+    }
+    if (!string_builder->length_in_bytes) {
+        return hmCreateEmptyStringView(in_string);
+    }
+    char* chars = HM_NULL;
+    HM_TRY(hmSegmentedStringBuilderFlatten(string_builder, allocator_opt, &chars));
+    return hmCreateStringByTakingOwnership(allocator_opt, chars, string_builder->length_in_bytes, in_string);
+}
+
+hmError hmSegmentedStringBuilderStealString(hmSegmentedStringBuilder* string_builder, hmString* in_string)
+{
+    hm_nint length_in_bytes = string_builder->length_in_bytes;
+    if (!length_in_bytes) {
+        return hmCreateEmptyStringView(in_string);
+    }
+    if (hmArrayGetCount(&string_builder->segments) == 1) {
+        hmStringSegment* segment = hmArrayGetRaw(&string_builder->segments, hmStringSegment);
+        char* chars = segment->chars;
+        chars[length_in_bytes] = '\0'; /* there's always space reserved for the null terminator */
+        /* The segment now belongs to the string, so it's removed without being freed. */
+        HM_TRY(hmArrayClear(&string_builder->segments));
+        string_builder->last_segment_capacity = 0;
+        string_builder->length_in_bytes = 0;
+        return hmCreateStringByTakingOwnership(string_builder->allocator, chars, length_in_bytes, in_string);
+    }
+    char* chars = HM_NULL;
+    HM_TRY(hmSegmentedStringBuilderFlatten(string_builder, string_builder->allocator, &chars));
+    hmError err = hmSegmentedStringBuilderClear(string_builder);
+    if (err != HM_OK) {
+        hmFree(string_builder->allocator, chars);
+        return err;
+    }
+    return hmCreateStringByTakingOwnership(string_builder->allocator, chars, length_in_bytes, in_string);
+}
+
+hmError hmSegmentedStringBuilderClear(hmSegmentedStringBuilder* string_builder)
+{
+    hmStringSegment* segments = hmArrayGetRaw(&string_builder->segments, hmStringSegment);
+    for (hm_nint i = 0; i < hmArrayGetCount(&string_builder->segments); i++) {
+        hmFree(string_builder->allocator, segments[i].chars);
+    }
+    string_builder->last_segment_capacity = 0;
+    string_builder->length_in_bytes = 0;
+    return hmArrayClear(&string_builder->segments);
+}
+
+static hmError hmSegmentedStringBuilderFlatten(hmSegmentedStringBuilder* string_builder, hmAllocator* allocator, char** out_chars)
+{
+    hm_nint length_in_bytes_with_null = 0;
+    HM_TRY(hmAddNint(string_builder->length_in_bytes, 1, &length_in_bytes_with_null));
+    char* chars = (char*)hmAlloc(allocator, length_in_bytes_with_null);
+    if (!chars) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    const hmStringSegment* segments = hmSegmentedStringBuilderGetSegments(string_builder);
+    hm_nint offset = 0;
+    for (hm_nint i = 0; i < hmSegmentedStringBuilderGetSegmentCount(string_builder); i++) {
+        hmCopyMemory(chars + offset, segments[i].chars, segments[i].length_in_bytes);
+        /* No hmAddNint because the total length was already validated when appending. */
+        offset += segments[i].length_in_bytes;
+    }
+    chars[offset] = '\0'; /* null terminator */
+    *out_chars = chars;
+    return HM_OK;
+}
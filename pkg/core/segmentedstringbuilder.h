@@ -0,0 +1,88 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_SEGMENTEDSTRINGBUILDER_H
+#define HM_SEGMENTEDSTRINGBUILDER_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <core/string.h>
+#include <collections/array.h>
+
+#define HM_SEGMENTED_STRING_BUILDER_DEFAULT_SEGMENT_SIZE (16*1024) /* 16KB */
+
+/* A contiguous piece of the content of a segmented string builder. See hmSegmentedStringBuilderGetSegments(..) */
+typedef struct {
+    char*   chars;           /* Not null-terminated. */
+    hm_nint length_in_bytes;
+} hmStringSegment;
+
+/* Unlike hmStringBuilder (see), which is backed by a single array that is reallocated (and copied) as it grows,
+   a segmented string builder appends data to a list of fixed-size segments, so previously appended content is never
+   moved. Useful for constructing large strings (such as multi-megabyte responses) which can be sent segment by segment,
+   without ever materializing the whole string in one contiguous memory block (see hmSegmentedStringBuilderGetSegments(..)).
+   The content is flattened only on demand: see hmSegmentedStringBuilderToString(..) and
+   hmSegmentedStringBuilderStealString(..) */
+typedef struct {
+    hmAllocator* allocator;
+    hmArray      segments;               /* Segments of type hmStringSegment. Only the last segment can have free space. */
+    hm_nint      segment_size;           /* The default capacity of a new segment. */
+    hm_nint      last_segment_capacity;  /* The capacity of the last segment (can be larger than `segment_size`). */
+    hm_nint      length_in_bytes;        /* The total length of all the segments. */
+} hmSegmentedStringBuilder;
+
+/* Creates a segmented string builder (see hmSegmentedStringBuilder).
+   `segment_size` is the size of a single segment in bytes, for example, HM_SEGMENTED_STRING_BUILDER_DEFAULT_SEGMENT_SIZE.
+   Content larger than `segment_size` which is appended in one call is placed in a single segment of the required size.
+   Returns HM_ERROR_INVALID_ARGUMENT if `segment_size` is zero. */
+hmError hmCreateSegmentedStringBuilder(
+    hmAllocator*              allocator,
+    hm_nint                   segment_size,
+    hmSegmentedStringBuilder* in_string_builder
+);
+hmError hmSegmentedStringBuilderDispose(hmSegmentedStringBuilder* string_builder);
+/* Appends a C string to the end of the string being constructed. */
+hmError hmSegmentedStringBuilderAppendCString(hmSegmentedStringBuilder* string_builder, const char* c_string);
+/* Same as hmSegmentedStringBuilderAppendCString(..), except uses the provided argument for length instead of null
+   termination. The content is either appended fully, or not appended at all (in case of an error). */
+hmError hmSegmentedStringBuilderAppendCStringWithLength(
+    hmSegmentedStringBuilder* string_builder,
+    const char*               c_string,
+    hm_nint                   length
+);
+/* Creates a string from the string builder by copying all the segments into one buffer. The string builder stays intact.
+  `allocator` is the allocator to create the string with. If it's not provided, the string builder's allocator
+   will be reused. */
+hmError hmSegmentedStringBuilderToString(
+    hmSegmentedStringBuilder* string_builder,
+    hmAllocator*              allocator_opt,
+    hmString*                 in_string
+);
+/* Same as hmSegmentedStringBuilderToString(..), except transfers the content to the string, leaving the string builder
+   empty (but still usable). If the content fits in a single segment, the segment's buffer itself becomes the string's
+   buffer, without any copying. Otherwise, the segments are flattened once into a buffer of the exact size, and then
+   freed. The string is always allocated with the string builder's allocator. */
+hmError hmSegmentedStringBuilderStealString(hmSegmentedStringBuilder* string_builder, hmString* in_string);
+/* Clears the string builder, allowing the instance to be reused: the length is reset to 0 and all the segments
+   are freed. */
+hmError hmSegmentedStringBuilderClear(hmSegmentedStringBuilder* string_builder);
+/* Returns the length of the string builder in bytes (the total number of appended characters). */
+#define hmSegmentedStringBuilderGetLengthInBytes(sb) ((sb)->length_in_bytes)
+/* Returns the segments of the string builder as an array of hmStringSegment (see) without copying, in the order of
+   appending. Useful for scatter/gather I/O. The returned array is invalidated by any subsequent modification
+   of the string builder. See also hmSegmentedStringBuilderGetSegmentCount(..) */
+#define hmSegmentedStringBuilderGetSegments(sb) (hmArrayGetRaw(&((sb)->segments), const hmStringSegment))
+/* Returns the number of segments returned by hmSegmentedStringBuilderGetSegments(..) */
+#define hmSegmentedStringBuilderGetSegmentCount(sb) (hmArrayGetCount(&((sb)->segments)))
+
+#endif /* HM_SEGMENTEDSTRINGBUILDER_H */
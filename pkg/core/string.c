@@ -57,6 +57,14 @@ hmError hmCreateStringFromCStringWithLengthInBytes(hmAllocator* allocator, const
     return HM_OK;
 }
 
+hmError hmCreateStringByTakingOwnership(hmAllocator* allocator, char* content, hm_nint length_in_bytes, hmString* in_string)
+{
+    in_string->content = content;
+    in_string->allocator_opt = allocator;
+    in_string->length_in_bytes = length_in_bytes;
+    return HM_OK;
+}
+
 hmError hmCreateSubstring(hmAllocator* allocator, hmString* source, hm_nint start_index, hm_nint length_in_bytes, hmString* in_string)
 {
     if (length_in_bytes == 0) {
@@ -37,6 +37,11 @@ hmError hmCreateStringFromCString(hmAllocator* allocator, const char* content, h
    Strings are generally immutable. The encoding is expected to be UTF8; although it's not enforced in this constructor,
    certain functions such as hmStringIndexRune(..) do check that it's a valid UTF8 string. */
 hmError hmCreateStringFromCStringWithLengthInBytes(hmAllocator* allocator, const char* content, hm_nint length_in_bytes, hmString* in_string);
+/* Creates a Hammer string from a null-terminated buffer previously allocated with `allocator`, without copying it:
+   the string takes ownership of the buffer and frees it when the string is disposed of. `length_in_bytes` is the length
+   of the content without the null terminator. Useful for transferring buffers which were constructed elsewhere
+   (for example, by string builders) to strings. */
+hmError hmCreateStringByTakingOwnership(hmAllocator* allocator, char* content, hm_nint length_in_bytes, hmString* in_string);
 /* Creates a Hammer string from a null-terminated C string. Unlike hmCreateStringFromCString (see), does not duplicate
    the string and does not own the internal buffer. The string view will be invalidated after the referenced string
    is deleted; it's undefined behavior to try to use such a string afterwards. Mostly useful for creating short-lived
@@ -13,6 +13,7 @@
 
 #include <core/stringbuilder.h>
 #include <core/allocator.h>
+#include <core/format.h>
 #include <core/math.h>
 #include <core/string.h>
 #include <core/utils.h>
@@ -59,6 +60,37 @@ hmError hmStringBuilderAppendCStringWithLength(hmStringBuilder* string_builder,
     return hmArrayAddRange(&string_builder->buffer, (void*)c_string, length);
 }
 
+/* The numbers are formatted into a small stack buffer first because the final length is not known in advance;
+   copying a few bytes is much cheaper than a temporary heap allocation. */
+
+hmError hmStringBuilderAppendInt(hmStringBuilder* string_builder, hm_int64 value)
+{
+    char buffer[HM_FORMAT_BUFFER_SIZE];
+    hm_nint length = hmFormatInt64(value, buffer);
+    return hmArrayAddRange(&string_builder->buffer, buffer, length);
+}
+
+hmError hmStringBuilderAppendUint64(hmStringBuilder* string_builder, hm_uint64 value)
+{
+    char buffer[HM_FORMAT_BUFFER_SIZE];
+    hm_nint length = hmFormatUint64(value, buffer);
+    return hmArrayAddRange(&string_builder->buffer, buffer, length);
+}
+
+hmError hmStringBuilderAppendFloat(hmStringBuilder* string_builder, hm_float64 value)
+{
+    char buffer[HM_FORMAT_BUFFER_SIZE];
+    hm_nint length = hmFormatFloat64(value, buffer);
+    return hmArrayAddRange(&string_builder->buffer, buffer, length);
+}
+
+hmError hmStringBuilderAppendHex(hmStringBuilder* string_builder, hm_uint64 value)
+{
+    char buffer[HM_FORMAT_BUFFER_SIZE];
+    hm_nint length = hmFormatHex(value, buffer);
+    return hmArrayAddRange(&string_builder->buffer, buffer, length);
+}
+
 hmError hmStringBuilderToString(hmStringBuilder* string_builder, hmAllocator* allocator_opt, hmString* in_string)
 {
     if (!allocator_opt) {
@@ -119,6 +151,23 @@ hmError hmStringBuilderToCString(hmStringBuilder* string_builder, hmAllocator* a
     return HM_OK;
 }
 
+hmError hmStringBuilderStealString(hmStringBuilder* string_builder, hmString* in_string)
+{
+    /* The replacement buffer is created first so that the string builder stays intact in case of an error. */
+    hmArray new_buffer;
+    HM_TRY(hmCreateArray(string_builder->allocator, sizeof(char), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &new_buffer));
+    char null_terminator = '\0';
+    hmError err = hmArrayAdd(&string_builder->buffer, &null_terminator);
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmArrayDispose(&new_buffer));
+    }
+    char* chars = hmArrayGetRaw(&string_builder->buffer, char);
+    /* No hmSubNint because the count includes the null terminator which was just added. */
+    hm_nint length_in_bytes = hmArrayGetCount(&string_builder->buffer) - 1;
+    string_builder->buffer = new_buffer; /* the old buffer is now owned by the string */
+    return hmCreateStringByTakingOwnership(string_builder->allocator, chars, length_in_bytes, in_string);
+}
+
 hmError hmStringBuilderClear(hmStringBuilder* string_builder)
 {
     return hmArrayClear(&string_builder->buffer);
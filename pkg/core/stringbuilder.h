@@ -35,6 +35,16 @@ hmError hmStringBuilderAppendCString(hmStringBuilder* string_builder, const char
 hmError hmStringBuilderAppendCStrings(hmStringBuilder* string_builder, ...);
 /* Same as hmStringBuilderAppendCString(..), except uses the provided argument for length instead of null termination. */
 hmError hmStringBuilderAppendCStringWithLength(hmStringBuilder* string_builder, const char* c_string, hm_nint length);
+/* Appends a signed integer in decimal notation. Does not allocate anything except, possibly, for growing the buffer.
+   See hmFormatInt64(..) */
+hmError hmStringBuilderAppendInt(hmStringBuilder* string_builder, hm_int64 value);
+/* Appends an unsigned integer in decimal notation. See hmFormatUint64(..) */
+hmError hmStringBuilderAppendUint64(hmStringBuilder* string_builder, hm_uint64 value);
+/* Appends a floating-point value using the shortest representation which parses back to the same value.
+   See hmFormatFloat64(..) for the exact format. */
+hmError hmStringBuilderAppendFloat(hmStringBuilder* string_builder, hm_float64 value);
+/* Appends an unsigned integer in lowercase hexadecimal notation, without a prefix. See hmFormatHex(..) */
+hmError hmStringBuilderAppendHex(hmStringBuilder* string_builder, hm_uint64 value);
 /* Creates a string from the string builder.
   `allocator` is the allocator to create the string with. If it's not provided, the string builder's allocator
    will be reused. */
@@ -50,6 +60,11 @@ hmError hmStringBuilderToStringWithStartIndexAndLengthInBytes(
 );
 /* Same as hmStringBuilderToString, except creates a C string. */
 hmError hmStringBuilderToCString(hmStringBuilder* string_builder, hmAllocator* allocator_opt, char** out_c_string);
+/* Same as hmStringBuilderToString(..), except transfers the internal buffer to the string without copying, leaving
+   the string builder empty (but still usable). The string is allocated with the string builder's allocator.
+   Note that the buffer can have unused capacity left after growing; prefer hmStringBuilderToString(..) for
+   long-lived strings. See also hmSegmentedStringBuilder. */
+hmError hmStringBuilderStealString(hmStringBuilder* string_builder, hmString* in_string);
 /* Clears the string builder, allowing the instance to be reused in a different case: the length is reset to 0
    and all the previous content is wiped out. */
 hmError hmStringBuilderClear(hmStringBuilder* string_builder);
@@ -54,7 +54,7 @@ hmError hmStringPoolDispose(hmStringPool* pool)
    the documentation), we don't bother freeing strings on error here which simplifies the code. */
 hmError hmStringPoolGetRef(hmStringPool* pool, hmString* in_string_view, hmString** out_string_ref)
 {
-    hmError err = hmHashMapGet(&pool->pool, (void*)&in_string_view, &out_string_ref);
+    hmError err = hmHashMapGet(&pool->pool, (void*)&in_string_view, out_string_ref);
     /* If the value is found -- just return it immediately. Also immediately returns if an unexpected error happened
        (HM_ERROR_NOT_FOUND is expected, on the other hand). */
     if (err == HM_OK || err != HM_ERROR_NOT_FOUND) {
@@ -71,6 +71,13 @@ hmError hmStringPoolGetRef(hmStringPool* pool, hmString* in_string_view, hmStrin
     return HM_OK;
 }
 
+hmError hmStringPoolReset(hmStringPool* pool)
+{
+    HM_TRY(hmHashMapClear(&pool->pool)); /* Before the strings, which the map refers to. */
+    hmBumpPointerAllocatorReset(&pool->string_allocator);
+    return HM_OK;
+}
+
 hm_nint hmStringPoolGetCount(hmStringPool* pool)
 {
     return hmHashMapGetCount(&pool->pool);
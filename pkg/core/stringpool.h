@@ -40,6 +40,9 @@ hmError hmStringPoolDispose(hmStringPool* pool);
    duplicated, saved inside the pool, and returned.
    If the pool is destroyed, all its strings are invalidated and cannot be used anymore. */
 hmError hmStringPoolGetRef(hmStringPool* pool, hmString* in_string_view, hmString** out_string_ref);
+/* Removes all the strings from the pool at once, invalidating them, while keeping some of the memory for future strings
+   (see hmBumpPointerAllocatorReset(..)) Allows to bound the memory of a long-lived pool which is refilled over and over. */
+hmError hmStringPoolReset(hmStringPool* pool);
 /* Returns the number of strings currently in the pool. Useful for debugging and in tests. */
 hm_nint hmStringPoolGetCount(hmStringPool* pool);
 
@@ -35,6 +35,8 @@ void hmPanicIf(hm_bool condition, const char* description);
 
 /* Copies a chunk of memory from `src` to `dest` using `size` number of bytes. */
 #define hmCopyMemory(dest, src, size) memcpy(dest, src, size)
+/* Same as hmCopyMemory(..), except the memory blocks are allowed to overlap. */
+#define hmMoveMemory(dest, src, size) memmove(dest, src, size)
 /* Compares two values for bitwise equality: -1 means the first value is smaller, 0 means both equal, +1 the first value is greater. */
 #define hmCompareMemory(value1, value2, size) memcmp(value1, value2, size)
 /* Clear all bytes and bits of the memory block starting at `dest` with the given `size`; that is, they are all set to 0. */
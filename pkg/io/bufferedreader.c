@@ -0,0 +1,224 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <io/bufferedreader.h>
+#include <core/utils.h>
+
+static hmError hmBufferedReaderReadFromSourceReader(hmBufferedReader* buffered_reader, char* buffer, hm_nint size, hm_nint* out_bytes_read);
+static void hmBufferedReaderReadahead(hmBufferedReader* buffered_reader);
+
+hmError hmCreateBufferedReader(
+    hmAllocator*      allocator,
+    hmReader          source_reader,
+    hm_bool           close_source_reader,
+    hm_nint           buffer_size,
+    hmBufferedReader* in_buffered_reader
+)
+{
+    if (!buffer_size) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    char* buffer = (char*)hmAlloc(allocator, buffer_size);
+    if (!buffer) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    in_buffered_reader->source_reader = source_reader;
+    in_buffered_reader->allocator = allocator;
+    in_buffered_reader->buffer = buffer;
+    in_buffered_reader->buffer_size = buffer_size;
+    in_buffered_reader->start_index = 0;
+    in_buffered_reader->end_index = 0;
+    in_buffered_reader->readahead_remaining = 0;
+    in_buffered_reader->has_more_data = HM_TRUE;
+    in_buffered_reader->close_source_reader = close_source_reader;
+    in_buffered_reader->is_readahead_supported = HM_TRUE;
+    hmBufferedReaderReadahead(in_buffered_reader);
+    return HM_OK;
+}
+
+hmError hmBufferedReaderDispose(hmBufferedReader* buffered_reader)
+{
+    hmError err = HM_OK;
+    if (buffered_reader->close_source_reader) {
+        err = hmReaderClose(&buffered_reader->source_reader);
+    }
+    hmFree(buffered_reader->allocator, buffered_reader->buffer);
+    return err;
+}
+
+hmError hmBufferedReaderFill(hmBufferedReader* buffered_reader, hm_nint max_size, hm_nint* out_bytes_read)
+{
+    if (!max_size) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    *out_bytes_read = 0;
+    if (!buffered_reader->has_more_data) {
+        return HM_OK;
+    }
+    /* No safe math below because `start_index <= end_index <= buffer_size` always holds. */
+    hm_nint buffered_size = buffered_reader->end_index - buffered_reader->start_index;
+    hm_nint free_tail_size = buffered_reader->buffer_size - buffered_reader->end_index;
+    if (free_tail_size < max_size && buffered_reader->start_index > 0) {
+        /* Makes room for new data by moving the unconsumed data to the beginning of the buffer. It's cheap as long as
+           parsers consume most of what they peek, which is the common case. */
+        hmMoveMemory(buffered_reader->buffer, buffered_reader->buffer + buffered_reader->start_index, buffered_size);
+        buffered_reader->start_index = 0;
+        buffered_reader->end_index = buffered_size;
+        free_tail_size = buffered_reader->buffer_size - buffered_size;
+    }
+    if (!free_tail_size) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hm_nint size = max_size < free_tail_size ? max_size : free_tail_size;
+    HM_TRY(hmBufferedReaderReadFromSourceReader(
+        buffered_reader,
+        buffered_reader->buffer + buffered_reader->end_index,
+        size,
+        out_bytes_read
+    ));
+    buffered_reader->end_index += *out_bytes_read; /* no safe math because `out_bytes_read <= size <= free_tail_size` */
+    return HM_OK;
+}
+
+hmError hmBufferedReaderPeek(hmBufferedReader* buffered_reader, hm_nint size, const char** out_chars, hm_nint* out_size)
+{
+    if (size > buffered_reader->buffer_size) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    while (buffered_reader->end_index - buffered_reader->start_index < size && buffered_reader->has_more_data) {
+        hm_nint bytes_read = 0;
+        HM_TRY(hmBufferedReaderFill(buffered_reader, buffered_reader->buffer_size, &bytes_read));
+    }
+    hmBufferedReaderGetBuffered(buffered_reader, out_chars, out_size);
+    return HM_OK;
+}
+
+void hmBufferedReaderGetBuffered(hmBufferedReader* buffered_reader, const char** out_chars, hm_nint* out_size)
+{
+    *out_chars = buffered_reader->buffer + buffered_reader->start_index;
+    *out_size = buffered_reader->end_index - buffered_reader->start_index; /* no safe math because `start_index <= end_index` */
+}
+
+hmError hmBufferedReaderConsume(hmBufferedReader* buffered_reader, hm_nint size)
+{
+    if (size > buffered_reader->end_index - buffered_reader->start_index) {
+        return HM_ERROR_OUT_OF_RANGE;
+    }
+    buffered_reader->start_index += size;
+    if (buffered_reader->start_index == buffered_reader->end_index) {
+        /* Everything is consumed: the next fill can start from the beginning of the buffer without moving anything. */
+        buffered_reader->start_index = 0;
+        buffered_reader->end_index = 0;
+    }
+    return HM_OK;
+}
+
+hmError hmBufferedReaderRead(hmBufferedReader* buffered_reader, char* buffer, hm_nint size, hm_nint* out_bytes_read)
+{
+    *out_bytes_read = 0;
+    if (!size) {
+        return HM_OK;
+    }
+    if (buffered_reader->start_index == buffered_reader->end_index) {
+        if (size >= buffered_reader->buffer_size) {
+            /* Large reads gain nothing from buffering, so they bypass the buffer to avoid an extra copy. */
+            if (!buffered_reader->has_more_data) {
+                return HM_OK;
+            }
+            return hmBufferedReaderReadFromSourceReader(buffered_reader, buffer, size, out_bytes_read);
+        }
+        hm_nint bytes_read = 0;
+        HM_TRY(hmBufferedReaderFill(buffered_reader, buffered_reader->buffer_size, &bytes_read));
+    }
+    const char* chars = HM_NULL;
+    hm_nint buffered_size = 0;
+    hmBufferedReaderGetBuffered(buffered_reader, &chars, &buffered_size);
+    if (size > buffered_size) {
+        size = buffered_size;
+    }
+    if (size > 0) {
+        hmCopyMemory(buffer, chars, size);
+    }
+    *out_bytes_read = size;
+    return hmBufferedReaderConsume(buffered_reader, size);
+}
+
+/* *************************** */
+/*    BufferedReaderReader.    */
+/* *************************** */
+
+typedef struct {
+    hmAllocator*      allocator;
+    hmBufferedReader* buffered_reader;
+} hmBufferedReaderReaderData;
+
+static hmError hmBufferedReaderReader_read(hmReader* reader, char* buffer, hm_nint size, hm_nint* out_bytes_read)
+{
+    hmBufferedReaderReaderData* data = (hmBufferedReaderReaderData*)reader->data;
+    return hmBufferedReaderRead(data->buffered_reader, buffer, size, out_bytes_read);
+}
+
+static hmError hmBufferedReaderReader_close(hmReader* reader)
+{
+    hmBufferedReaderReaderData* data = (hmBufferedReaderReaderData*)reader->data;
+    hmFree(data->allocator, data);
+    return HM_OK;
+}
+
+hmError hmBufferedReaderCreateReader(hmBufferedReader* buffered_reader, hmAllocator* reader_allocator_opt, hmReader* in_reader)
+{
+    hmAllocator* allocator = reader_allocator_opt ? reader_allocator_opt : buffered_reader->allocator;
+    hmBufferedReaderReaderData* data = (hmBufferedReaderReaderData*)hmAlloc(allocator, sizeof(hmBufferedReaderReaderData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    data->allocator = allocator;
+    data->buffered_reader = buffered_reader;
+    in_reader->read = &hmBufferedReaderReader_read;
+    in_reader->close = &hmBufferedReaderReader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = HM_NULL; /* reading from the handle directly would skip the buffered data */
+    in_reader->data = data;
+    return HM_OK;
+}
+
+static hmError hmBufferedReaderReadFromSourceReader(hmBufferedReader* buffered_reader, char* buffer, hm_nint size, hm_nint* out_bytes_read)
+{
+    HM_TRY(hmReaderRead(&buffered_reader->source_reader, buffer, size, out_bytes_read));
+    if (!*out_bytes_read) {
+        buffered_reader->has_more_data = HM_FALSE;
+        return HM_OK;
+    }
+    if (buffered_reader->is_readahead_supported) {
+        buffered_reader->readahead_remaining -= *out_bytes_read < buffered_reader->readahead_remaining
+                                              ? *out_bytes_read
+                                              : buffered_reader->readahead_remaining;
+        /* The next window is requested while half of the current one is still unread, so that the disk keeps working
+           in the background while the parser processes the data which is already in the page cache. */
+        if (buffered_reader->readahead_remaining < HM_BUFFERED_READER_READAHEAD_SIZE / 2) {
+            hmBufferedReaderReadahead(buffered_reader);
+        }
+    }
+    return HM_OK;
+}
+
+static void hmBufferedReaderReadahead(hmBufferedReader* buffered_reader)
+{
+    /* Readahead is only an optimization: if the source reader can't do it (for example, it's a socket), the buffered
+       reader just stops trying. */
+    if (hmReaderReadahead(&buffered_reader->source_reader, HM_BUFFERED_READER_READAHEAD_SIZE) != HM_OK) {
+        buffered_reader->is_readahead_supported = HM_FALSE;
+        return;
+    }
+    buffered_reader->readahead_remaining = HM_BUFFERED_READER_READAHEAD_SIZE;
+}
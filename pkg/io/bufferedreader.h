@@ -0,0 +1,77 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_BUFFERED_READER_H
+#define HM_BUFFERED_READER_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <io/reader.h>
+
+#define HM_BUFFERED_READER_DEFAULT_BUFFER_SIZE (64*1024)  /* 64KB */
+#define HM_BUFFERED_READER_READAHEAD_SIZE      (512*1024) /* 512KB; see hmCreateBufferedReader(..) */
+
+typedef struct {
+    hmReader     source_reader;          /* The source reader. */
+    hmAllocator* allocator;
+    char*        buffer;                 /* Buffered data lives in buffer[start_index:end_index) */
+    hm_nint      buffer_size;            /* The capacity of `buffer`. */
+    hm_nint      start_index;            /* Everything before `start_index` was already consumed. */
+    hm_nint      end_index;              /* New data from the source reader is appended at `end_index`. */
+    hm_nint      readahead_remaining;    /* How many bytes are left until the end of the last readahead window. */
+    hm_bool      has_more_data;          /* Becomes HM_FALSE the first time `source_reader` returns 0 read bytes. */
+    hm_bool      close_source_reader;    /* If true, the source reader will be closed when the buffered reader is disposed. */
+    hm_bool      is_readahead_supported; /* Becomes HM_FALSE if the source reader doesn't support hmReaderReadahead(..) */
+} hmBufferedReader;
+
+/* A buffered reader takes a `source_reader` and reads from it in large chunks into an internal buffer of `buffer_size`
+   bytes, which parsers can then inspect in place with hmBufferedReaderPeek(..) and hmBufferedReaderConsume(..) (see),
+   without copying. Several parsers can be layered on a single buffered reader one after another: whatever one parser
+   didn't consume is naturally left for the next one (see also hmBufferedReaderCreateReader(..)).
+   If the source reader is backed by a file, the buffered reader asks the operating system to asynchronously read ahead
+   HM_BUFFERED_READER_READAHEAD_SIZE bytes at a time (see hmReaderReadahead(..)), so that reading rarely has to wait for the disk.
+   If `close_source_reader` is true, `source_reader` is automatically closed when the buffered reader is disposed.
+   Returns HM_ERROR_INVALID_ARGUMENT if `buffer_size` is 0. */
+hmError hmCreateBufferedReader(
+    hmAllocator*      allocator,
+    hmReader          source_reader,
+    hm_bool           close_source_reader,
+    hm_nint           buffer_size,
+    hmBufferedReader* in_buffered_reader
+);
+/* Disposes of the buffered reader. If `close_source_reader` is true, also closes the source reader specified in the
+   constructor (see). */
+hmError hmBufferedReaderDispose(hmBufferedReader* buffered_reader);
+/* Reads up to `max_size` more bytes from the source reader and appends them to the buffered data (making room for them by
+   moving buffered data to the beginning of the buffer, if necessary). The number of read bytes is returned in `out_bytes_read`:
+   0 means there's no more data in the source reader. Returns HM_ERROR_LIMIT_EXCEEDED if the buffer is already full.
+   Usually, there's no need to call it directly, see hmBufferedReaderPeek(..) */
+hmError hmBufferedReaderFill(hmBufferedReader* buffered_reader, hm_nint max_size, hm_nint* out_bytes_read);
+/* Makes sure at least `size` bytes are buffered (reading from the source reader as many times as needed), and returns
+   all the buffered data in `out_chars` and `out_size`, without consuming it. `out_size` can be smaller than `size` only
+   if there's no more data in the source reader. Returns HM_ERROR_INVALID_ARGUMENT if `size` is larger than the buffer size.
+   The returned pointer is valid until the next call to any function of the buffered reader other than hmBufferedReaderConsume(..) */
+hmError hmBufferedReaderPeek(hmBufferedReader* buffered_reader, hm_nint size, const char** out_chars, hm_nint* out_size);
+/* Returns the currently buffered data in `out_chars` and `out_size` without reading from the source reader. */
+void hmBufferedReaderGetBuffered(hmBufferedReader* buffered_reader, const char** out_chars, hm_nint* out_size);
+/* Marks `size` bytes of buffered data as consumed. Returns HM_ERROR_OUT_OF_RANGE if fewer bytes are buffered. */
+hmError hmBufferedReaderConsume(hmBufferedReader* buffered_reader, hm_nint size);
+/* Same as hmReaderRead(..): copies buffered data (if any) to `buffer` and consumes it. If nothing is buffered, large
+   reads go directly to the source reader, while small reads fill the buffer first. */
+hmError hmBufferedReaderRead(hmBufferedReader* buffered_reader, char* buffer, hm_nint size, hm_nint* out_bytes_read);
+/* Returns the buffered reader as a reader interface (see hmBufferedReaderRead(..)), which allows to pass what's left
+   after parsing to code which knows nothing about buffered readers. Closing the returned reader does not dispose
+   of the buffered reader, which should outlive it. */
+hmError hmBufferedReaderCreateReader(hmBufferedReader* buffered_reader, hmAllocator* reader_allocator_opt, hmReader* in_reader);
+
+#endif /* HM_BUFFERED_READER_H */
@@ -0,0 +1,51 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <io/copy.h>
+#include <core/math.h>
+
+hmError hmCopy(hmReader* reader, hmWriter* writer, char* buffer, hm_nint buffer_size, hm_nint* out_bytes_copied_opt)
+{
+    if (!buffer_size) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hm_nint bytes_copied = 0;
+    hmError err = hmCopyNatively(reader, writer, &bytes_copied);
+    if (err == HM_ERROR_NOT_IMPLEMENTED) {
+        err = HM_OK;
+        if (hmReaderSupportsBorrowing(reader)) {
+            const char* chars = HM_NULL;
+            hm_nint bytes_borrowed = 0;
+            while ((err = hmReaderBorrow(reader, HM_NINT_MAX, &chars, &bytes_borrowed)) == HM_OK && bytes_borrowed > 0) {
+                HM_TRY_OR_FINALIZE(err, hmWriterWriteAll(writer, chars, bytes_borrowed));
+                HM_TRY_OR_FINALIZE(err, hmAddNint(bytes_copied, bytes_borrowed, &bytes_copied));
+            }
+        } else {
+            hm_nint bytes_read = 0;
+            while ((err = hmReaderRead(reader, buffer, buffer_size, &bytes_read)) == HM_OK && bytes_read > 0) {
+                /* A check to avoid buffer overflows, as we don't know if the underlying reader behaves correctly. */
+                if (bytes_read > buffer_size) {
+                    err = HM_ERROR_OVERFLOW;
+                    HM_FINALIZE;
+                }
+                HM_TRY_OR_FINALIZE(err, hmWriterWriteAll(writer, buffer, bytes_read));
+                HM_TRY_OR_FINALIZE(err, hmAddNint(bytes_copied, bytes_read, &bytes_copied));
+            }
+        }
+    }
+HM_ON_FINALIZE
+    if (out_bytes_copied_opt) {
+        *out_bytes_copied_opt = bytes_copied;
+    }
+    return err;
+}
@@ -0,0 +1,41 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_COPY_H
+#define HM_COPY_H
+
+#include <io/reader.h>
+#include <io/writer.h>
+
+#define HM_COPY_DEFAULT_BUFFER_SIZE (64*1024) /* 64KB */
+
+/* Copies all data from `reader` to `writer` until there's no more data in the reader. Returns the number of copied bytes
+   in `out_bytes_copied_opt` (also on failure, to know how much was copied before the error; a chunk which failed to be written completely is
+   not counted).
+   Picks the fastest way available:
+   - if both the reader and the writer expose their native handles (see hmReaderGetNativeHandle(..)), and the platform
+     supports moving data between such handles inside the kernel (for example, file-to-socket or socket-to-socket),
+     the data never reaches user space;
+   - if the reader supports borrowing (see hmReaderBorrow(..)), the data is written directly from the reader's memory;
+   - otherwise, the data is read to the scratch buffer specified by `buffer` and `buffer_size`, and then written out.
+     Large buffers (see HM_COPY_DEFAULT_BUFFER_SIZE) are preferred, and can be reused across calls.
+   Partial writes are retried until everything is written. Returns HM_ERROR_INVALID_ARGUMENT if `buffer_size` is 0.
+   Neither the reader nor the writer are closed by this function. */
+hmError hmCopy(hmReader* reader, hmWriter* writer, char* buffer, hm_nint buffer_size, hm_nint* out_bytes_copied_opt);
+/* Used by hmCopy(..): copies data between the native handles of `reader` and `writer` inside the kernel. Implemented by
+   the platform layer. Returns HM_ERROR_NOT_IMPLEMENTED if there's no native way to copy between the given reader and
+   writer. It can also turn out in the middle of copying: `out_bytes_copied` then tells how much was copied already, and
+   the rest is left for the caller. */
+hmError hmCopyNatively(hmReader* reader, hmWriter* writer, hm_nint* out_bytes_copied);
+
+#endif /* HM_COPY_H */
@@ -0,0 +1,289 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <io/deflate.h>
+#include <core/math.h>
+#include <vendor/zlib/zlib.h>
+
+#include <limits.h> /* for UINT_MAX */
+
+#define HM_DEFLATE_WINDOW_BITS 15 /* The largest window (32KB), as required to decompress arbitrary streams. */
+#define HM_DEFLATE_MEMORY_LEVEL 8 /* zlib's default */
+
+static int hmDeflateFormatToWindowBits(hmDeflateFormat format);
+static hmError hmZlibErrorToHammer(int result);
+static voidpf hmZlibAlloc(voidpf opaque, uInt item_count, uInt item_size);
+static void hmZlibFree(voidpf opaque, voidpf address);
+
+/* ******************** */
+/*    DeflateReader.    */
+/* ******************** */
+
+typedef struct {
+    hmAllocator* allocator;           /* The allocator which governs this structure's lifetime. */
+    hmReader     source_reader;       /* Compressed data is read from this reader. */
+    z_stream     stream;
+    char*        buffer;              /* Compressed data read from `source_reader` which is not yet decompressed. */
+    hm_bool      close_source_reader; /* If true, the source reader is closed when the deflate reader is closed. */
+    hm_bool      is_stream_end;       /* Becomes HM_TRUE once the whole compressed stream is decompressed. */
+} hmDeflateReaderData;
+
+static hmError hmDeflateReader_read(hmReader* reader, char* buffer, hm_nint size, hm_nint* out_bytes_read)
+{
+    hmDeflateReaderData* data = (hmDeflateReaderData*)reader->data;
+    *out_bytes_read = 0;
+    if (data->is_stream_end || !size) {
+        return HM_OK;
+    }
+    uInt output_size = size > UINT_MAX ? UINT_MAX : (uInt)size;
+    data->stream.next_out = (Bytef*)buffer;
+    data->stream.avail_out = output_size;
+    /* Returning 0 bytes would mean the end of the stream, so keep decompressing until at least something is produced. */
+    while (data->stream.avail_out == output_size) {
+        if (!data->stream.avail_in) {
+            hm_nint bytes_read = 0;
+            HM_TRY(hmReaderRead(&data->source_reader, data->buffer, HM_DEFLATE_BUFFER_SIZE, &bytes_read));
+            if (!bytes_read) { /* the source reader ended before the compressed stream did */
+                return HM_ERROR_INVALID_DATA;
+            }
+            data->stream.next_in = (Bytef*)data->buffer;
+            data->stream.avail_in = (uInt)bytes_read; /* no overflow because `bytes_read <= HM_DEFLATE_BUFFER_SIZE` */
+        }
+        int result = inflate(&data->stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            data->is_stream_end = HM_TRUE;
+            break;
+        }
+        /* Z_BUF_ERROR only means no progress was possible with the given input, so more input is read in the next iteration. */
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            return hmZlibErrorToHammer(result);
+        }
+    }
+    *out_bytes_read = output_size - data->stream.avail_out;
+    return HM_OK;
+}
+
+static hmError hmDeflateReader_close(hmReader* reader)
+{
+    hmDeflateReaderData* data = (hmDeflateReaderData*)reader->data;
+    hmError err = hmZlibErrorToHammer(inflateEnd(&data->stream));
+    if (data->close_source_reader) {
+        err = hmMergeErrors(err, hmReaderClose(&data->source_reader));
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateDeflateReader(
+    hmAllocator*    allocator,
+    hmReader        source_reader,
+    hm_bool         close_source_reader,
+    hmDeflateFormat format,
+    hmReader*       in_reader
+)
+{
+    int window_bits = hmDeflateFormatToWindowBits(format);
+    if (!window_bits) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    /* The buffer is allocated together with the structure to save an allocation. */
+    hmDeflateReaderData* data = (hmDeflateReaderData*)hmAlloc(allocator, sizeof(hmDeflateReaderData) + HM_DEFLATE_BUFFER_SIZE);
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    data->stream.zalloc = &hmZlibAlloc;
+    data->stream.zfree = &hmZlibFree;
+    data->stream.opaque = allocator;
+    data->stream.next_in = Z_NULL;
+    data->stream.avail_in = 0;
+    hmError err = hmZlibErrorToHammer(inflateInit2(&data->stream, window_bits));
+    if (err != HM_OK) {
+        hmFree(allocator, data);
+        return err;
+    }
+    data->allocator = allocator;
+    data->source_reader = source_reader;
+    data->buffer = (char*)(data + 1);
+    data->close_source_reader = close_source_reader;
+    data->is_stream_end = HM_FALSE;
+    in_reader->read = &hmDeflateReader_read;
+    in_reader->close = &hmDeflateReader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = HM_NULL;
+    in_reader->data = data;
+    return HM_OK;
+}
+
+/* ******************** */
+/*    DeflateWriter.    */
+/* ******************** */
+
+typedef struct {
+    hmAllocator* allocator;          /* The allocator which governs this structure's lifetime. */
+    hmWriter     inner_writer;       /* Compressed data is written to this writer. */
+    z_stream     stream;
+    char*        buffer;             /* Compressed data is accumulated here before it's written to `inner_writer`. */
+    hm_bool      close_inner_writer; /* If true, the inner writer is closed when the deflate writer is closed. */
+} hmDeflateWriterData;
+
+/* Compresses everything in the stream's input with the given `flush` mode, writing compressed data out to the inner writer. */
+static hmError hmDeflateWriterDeflate(hmDeflateWriterData* data, int flush)
+{
+    while (HM_TRUE) {
+        data->stream.next_out = (Bytef*)data->buffer;
+        data->stream.avail_out = HM_DEFLATE_BUFFER_SIZE;
+        int result = deflate(&data->stream, flush);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            return hmZlibErrorToHammer(result);
+        }
+        hm_nint compressed_size = HM_DEFLATE_BUFFER_SIZE - data->stream.avail_out; /* no safe math because `avail_out` only decreases */
+        HM_TRY(hmWriterWriteAll(&data->inner_writer, data->buffer, compressed_size));
+        /* If the output buffer was filled completely, there may be more pending output. */
+        if (data->stream.avail_out > 0 && (flush != Z_FINISH || result == Z_STREAM_END)) {
+            return HM_OK;
+        }
+    }
+}
+
+static hmError hmDeflateWriter_write(hmWriter* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
+{
+    hmDeflateWriterData* data = (hmDeflateWriterData*)writer->data;
+    *out_bytes_written = 0;
+    while (*out_bytes_written < size) {
+        hm_nint input_size = size - *out_bytes_written; /* no safe math because `out_bytes_written < size` */
+        if (input_size > UINT_MAX) {
+            input_size = UINT_MAX;
+        }
+        data->stream.next_in = (Bytef*)(buffer + *out_bytes_written);
+        data->stream.avail_in = (uInt)input_size;
+        HM_TRY(hmDeflateWriterDeflate(data, Z_NO_FLUSH));
+        *out_bytes_written += input_size; /* zlib consumes the whole input when there's enough room for output */
+    }
+    return HM_OK;
+}
+
+static hmError hmDeflateWriter_close(hmWriter* writer)
+{
+    hmDeflateWriterData* data = (hmDeflateWriterData*)writer->data;
+    data->stream.avail_in = 0;
+    hmError err = hmDeflateWriterDeflate(data, Z_FINISH);
+    int result = deflateEnd(&data->stream);
+    /* deflateEnd(..) returns Z_DATA_ERROR if the stream wasn't finished, which is expected if finishing it failed above. */
+    if (err == HM_OK) {
+        err = hmZlibErrorToHammer(result);
+    }
+    if (data->close_inner_writer) {
+        err = hmMergeErrors(err, hmWriterClose(&data->inner_writer));
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateDeflateWriter(
+    hmAllocator*    allocator,
+    hmWriter        inner_writer,
+    hm_bool         close_inner_writer,
+    hmDeflateFormat format,
+    hm_nint         level,
+    hmWriter*       in_writer
+)
+{
+    int window_bits = hmDeflateFormatToWindowBits(format);
+    if (!window_bits || level < HM_DEFLATE_MIN_LEVEL || level > HM_DEFLATE_MAX_LEVEL) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    /* The buffer is allocated together with the structure to save an allocation. */
+    hmDeflateWriterData* data = (hmDeflateWriterData*)hmAlloc(allocator, sizeof(hmDeflateWriterData) + HM_DEFLATE_BUFFER_SIZE);
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    data->stream.zalloc = &hmZlibAlloc;
+    data->stream.zfree = &hmZlibFree;
+    data->stream.opaque = allocator;
+    hmError err = hmZlibErrorToHammer(deflateInit2(
+        &data->stream,
+        (int)level,
+        Z_DEFLATED,
+        window_bits,
+        HM_DEFLATE_MEMORY_LEVEL,
+        Z_DEFAULT_STRATEGY
+    ));
+    if (err != HM_OK) {
+        hmFree(allocator, data);
+        return err;
+    }
+    data->allocator = allocator;
+    data->inner_writer = inner_writer;
+    data->buffer = (char*)(data + 1);
+    data->close_inner_writer = close_inner_writer;
+    in_writer->write = &hmDeflateWriter_write;
+    in_writer->close = &hmDeflateWriter_close;
+    in_writer->write_vector_opt = HM_NULL;
+    in_writer->get_native_handle_opt = HM_NULL;
+    in_writer->data = data;
+    return HM_OK;
+}
+
+hmError hmDeflateWriterFlush(hmWriter* writer)
+{
+    hmDeflateWriterData* data = (hmDeflateWriterData*)writer->data;
+    data->stream.avail_in = 0;
+    return hmDeflateWriterDeflate(data, Z_SYNC_FLUSH);
+}
+
+static int hmDeflateFormatToWindowBits(hmDeflateFormat format)
+{
+    /* zlib encodes the container in the sign/range of `windowBits`. */
+    switch (format) {
+        case HM_DEFLATE_FORMAT_RAW:
+            return -HM_DEFLATE_WINDOW_BITS;
+        case HM_DEFLATE_FORMAT_ZLIB:
+            return HM_DEFLATE_WINDOW_BITS;
+        case HM_DEFLATE_FORMAT_GZIP:
+            return HM_DEFLATE_WINDOW_BITS + 16;
+        default:
+            return 0;
+    }
+}
+
+static hmError hmZlibErrorToHammer(int result)
+{
+    switch (result) {
+        case Z_OK:
+        case Z_STREAM_END:
+            return HM_OK;
+        case Z_MEM_ERROR:
+            return HM_ERROR_OUT_OF_MEMORY;
+        case Z_DATA_ERROR:
+        case Z_NEED_DICT: /* preset dictionaries are not supported */
+            return HM_ERROR_INVALID_DATA;
+        case Z_VERSION_ERROR:
+            return HM_ERROR_NOT_IMPLEMENTED;
+        default:
+            return HM_ERROR_PLATFORM_DEPENDENT;
+    }
+}
+
+static voidpf hmZlibAlloc(voidpf opaque, uInt item_count, uInt item_size)
+{
+    hm_nint size = 0;
+    if (hmMulNint((hm_nint)item_count, (hm_nint)item_size, &size) != HM_OK) {
+        return Z_NULL;
+    }
+    return hmAlloc((hmAllocator*)opaque, size);
+}
+
+static void hmZlibFree(voidpf opaque, voidpf address)
+{
+    hmFree((hmAllocator*)opaque, address);
+}
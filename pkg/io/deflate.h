@@ -0,0 +1,64 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_DEFLATE_H
+#define HM_DEFLATE_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <io/reader.h>
+#include <io/writer.h>
+
+/* The container around deflate-compressed data. */
+typedef int hmDeflateFormat;
+#define HM_DEFLATE_FORMAT_RAW  ((hmDeflateFormat)0) /* No container (RFC1951). */
+#define HM_DEFLATE_FORMAT_ZLIB ((hmDeflateFormat)1) /* The zlib container (RFC1950), used by "Content-Encoding: deflate" in HTTP. */
+#define HM_DEFLATE_FORMAT_GZIP ((hmDeflateFormat)2) /* The gzip container (RFC1952), used by "Content-Encoding: gzip" in HTTP. */
+
+#define HM_DEFLATE_BUFFER_SIZE   (16*1024) /* 16KB; the size of the internal buffer of deflate readers/writers */
+#define HM_DEFLATE_DEFAULT_LEVEL 6         /* A good balance between speed and compression ratio, see hmCreateDeflateWriter(..) */
+#define HM_DEFLATE_MIN_LEVEL     1         /* The fastest compression. */
+#define HM_DEFLATE_MAX_LEVEL     9         /* The best compression. */
+
+/* Creates a reader which decompresses deflate-compressed data in the given `format` read from `source_reader`, as it
+   goes, without ever buffering the whole payload: the memory used is bounded by HM_DEFLATE_BUFFER_SIZE plus the
+   decompressor's window (32KB). Returns HM_ERROR_INVALID_DATA from hmReaderRead(..) if the data is corrupted or truncated.
+   Only the first gzip member is read.
+   If `close_source_reader` is set to true, the deflate reader closes `source_reader` when it's closed itself. */
+hmError hmCreateDeflateReader(
+    hmAllocator*    allocator,
+    hmReader        source_reader,
+    hm_bool         close_source_reader,
+    hmDeflateFormat format,
+    hmReader*       in_reader
+);
+/* Creates a writer which compresses data written to it with deflate in the given `format` and writes the compressed
+   data to `inner_writer`. `level` is in the range [HM_DEFLATE_MIN_LEVEL, HM_DEFLATE_MAX_LEVEL] (it's recommended to use
+   HM_DEFLATE_DEFAULT_LEVEL). The compressor holds back data until it has enough of it to compress well: the stream is
+   only complete after the writer is closed (see also hmDeflateWriterFlush(..)).
+   If `close_inner_writer` is set to true, the deflate writer closes `inner_writer` when it's closed itself. */
+hmError hmCreateDeflateWriter(
+    hmAllocator*    allocator,
+    hmWriter        inner_writer,
+    hm_bool         close_inner_writer,
+    hmDeflateFormat format,
+    hm_nint         level,
+    hmWriter*       in_writer
+);
+/* Writes all the data which was written to the deflate writer so far to the inner writer, in such a way that the other
+   side can decompress it without waiting for the rest of the stream. Useful for streaming responses. Flushing too often
+   hurts the compression ratio.
+   The behavior is undefined if `writer` is not a deflate writer. */
+hmError hmDeflateWriterFlush(hmWriter* writer);
+
+#endif /* HM_DEFLATE_H */
@@ -13,22 +13,46 @@
 
 #include <io/linereader.h>
 #include <core/math.h>
+#include <threading/thread.h>
+
+#include <string.h> /* for memchr(..) */
+
+/* Chunks smaller than this are not worth a separate thread in hmReadAllLinesInParallel(..) */
+#define HM_LINE_READER_MIN_PARALLEL_CHUNK_SIZE (64*1024)
+
+/* A part of the buffer processed by hmReadAllLinesInParallel(..) on a separate thread. */
+typedef struct {
+    hmAllocator* allocator;
+    const char*  chars;                 /* The whole buffer (not just the chunk). */
+    hm_nint      start_index;           /* Always points to the beginning of a line. */
+    hm_nint      end_index;             /* Always points to the beginning of a line (or to the end of the buffer). */
+    hm_bool      has_crlf_newlines;
+    hmArray      lines;                 /* The lines of the chunk. Has no dispose function: the strings are moved to the resulting array. */
+    hm_bool      is_lines_initialized;
+    hmThread     thread;
+    hm_bool      is_thread_initialized;
+    hmError      err;                   /* The result of hmLineChunkSplitLines(..) */
+} hmLineChunk;
 
 static hm_bool hmLineReaderShouldReadFromSourceReader(hmLineReader* line_reader);
 static void hmLineReaderScheduleMoreReadingFromSourceReader(hmLineReader* line_reader);
 static hmError hmLineReaderReadFromSourceReader(
     hmLineReader* line_reader,
-    hmAllocator*  allocator_opt,
-    hmString*     in_line,
+    const char**  out_chars,
+    hm_nint*      out_length_in_bytes,
     hm_bool*      out_is_line_formed
 );
 static hmError hmLineReaderScanBufferForNextLine(
     hmLineReader* line_reader,
-    hmAllocator*  allocator_opt,
-    hmString*     in_line,
+    const char**  out_chars,
+    hm_nint*      out_length_in_bytes,
     hm_bool*      out_is_line_formed
 );
 static hmError hmLineReaderAppendRemainingInBufferToNextLine(hmLineReader* line_reader);
+static hmError hmLineReaderResetNextLineBuilder(hmLineReader* line_reader);
+static hm_nint hmFindNewline(const char* chars, hm_nint start_index, hm_nint end_index, hm_bool has_crlf_newlines);
+static hmError hmLineChunkSplitLines(void* user_data);
+static hmError hmLineChunkDispose(hmLineChunk* chunk, hm_bool should_dispose_lines);
 
 hmError hmCreateLineReader(
     hmAllocator*  allocator,
@@ -48,11 +72,13 @@ hmError hmCreateLineReader(
     in_line_reader->allocator = allocator;
     in_line_reader->buffer = buffer;
     in_line_reader->buffer_size = buffer_size;
+    in_line_reader->data = buffer;
     in_line_reader->buffer_index = 0;
     in_line_reader->bytes_read = 0;
     in_line_reader->has_more_lines = HM_TRUE;
     in_line_reader->close_source_reader = close_source_reader;
     in_line_reader->has_crlf_newlines = has_crlf_newlines;
+    in_line_reader->has_stale_next_line = HM_FALSE;
     return HM_OK;
 }
 
@@ -66,6 +92,19 @@ hmError hmLineReaderDispose(hmLineReader* line_reader)
 }
 
 hmError hmLineReaderReadLine(hmLineReader* line_reader, hmAllocator* allocator_opt, hmString* in_line)
+{
+    const char* chars = HM_NULL;
+    hm_nint length_in_bytes = 0;
+    HM_TRY(hmLineReaderReadLineView(line_reader, &chars, &length_in_bytes));
+    return hmCreateStringFromCStringWithLengthInBytes(
+        allocator_opt ? allocator_opt : line_reader->allocator,
+        chars,
+        length_in_bytes,
+        in_line
+    );
+}
+
+hmError hmLineReaderReadLineView(hmLineReader* line_reader, const char** out_chars, hm_nint* out_length_in_bytes)
 {
     /* The loop is quite simple:
        - reads from the source reader into the buffer if necessary (may form the next line if it can't read from the
@@ -73,19 +112,25 @@ hmError hmLineReaderReadLine(hmLineReader* line_reader, hmAllocator* allocator_o
        - scans the buffer for the next line (i.e. by looking for the first "\n") and forms a new line on success;
        - appends remaining stuff in the buffer to the next line if the previous scanning of the buffer for "\n" was not
          successful (i.e. the next line spans several buffered reading calls because it's large);
-       - repeats until one of the functions above forms a line. */
+       - repeats until one of the functions above forms a line.
+       A formed line is just a view: either directly into the buffer (the common case), or into the next line builder
+       (if the line spans several buffered reading calls). In the latter case, the builder is cleared on the next call. */
     if (!line_reader->has_more_lines) {
         return HM_ERROR_INVALID_STATE;
     }
+    if (line_reader->has_stale_next_line) {
+        HM_TRY(hmLineReaderResetNextLineBuilder(line_reader));
+        line_reader->has_stale_next_line = HM_FALSE;
+    }
     while (HM_TRUE) {
         hm_bool is_line_formed = HM_FALSE;
         if (hmLineReaderShouldReadFromSourceReader(line_reader)) {
-            HM_TRY(hmLineReaderReadFromSourceReader(line_reader, allocator_opt, in_line, &is_line_formed));
+            HM_TRY(hmLineReaderReadFromSourceReader(line_reader, out_chars, out_length_in_bytes, &is_line_formed));
             if (is_line_formed) {
                 break;
             }
         }
-        HM_TRY(hmLineReaderScanBufferForNextLine(line_reader, allocator_opt, in_line, &is_line_formed));
+        HM_TRY(hmLineReaderScanBufferForNextLine(line_reader, out_chars, out_length_in_bytes, &is_line_formed));
         if (is_line_formed) {
             break;
         }
@@ -96,12 +141,12 @@ hmError hmLineReaderReadLine(hmLineReader* line_reader, hmAllocator* allocator_o
 }
 
 /* NOTE: similar to hmLineReaderAppendRemainingInBufferToNextLine(..) */
-hmError hmLineReaderGetBuffered(hmLineReader* line_reader, char** out_buffer, hm_nint* out_size)
+hmError hmLineReaderGetBuffered(hmLineReader* line_reader, const char** out_buffer, hm_nint* out_size)
 {
     hm_nint buffer_with_index_offset = 0, remaining_size = 0;
-    HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->buffer), line_reader->buffer_index, &buffer_with_index_offset));
+    HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->data), line_reader->buffer_index, &buffer_with_index_offset));
     HM_TRY(hmSubNint(line_reader->bytes_read, line_reader->buffer_index, &remaining_size));
-    *out_buffer = hmCastNintToPointer(buffer_with_index_offset, char*);
+    *out_buffer = hmCastNintToPointer(buffer_with_index_offset, const char*);
     *out_size = remaining_size;
     return HM_OK;
 }
@@ -159,6 +204,111 @@ HM_ON_FINALIZE
     return err;
 }
 
+hmError hmReadAllLinesInParallel(
+    hmAllocator* allocator,
+    const char*  chars,
+    hm_nint      size,
+    hm_bool      has_crlf_newlines,
+    hm_nint      thread_count,
+    hmArray*     in_array
+)
+{
+    if (!thread_count) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hm_nint chunk_count = size / HM_LINE_READER_MIN_PARALLEL_CHUNK_SIZE;
+    if (chunk_count > thread_count) {
+        chunk_count = thread_count;
+    }
+    if (!chunk_count) {
+        chunk_count = 1;
+    }
+    hm_nint chunks_size = 0;
+    HM_TRY(hmMulNint(chunk_count, sizeof(hmLineChunk), &chunks_size));
+    hmLineChunk* chunks = hmAlloc(allocator, chunks_size);
+    if (!chunks) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    /* Chunk boundaries are moved forward to the nearest newline, so that every chunk consists of whole lines.
+       No safe math for "approx_chunk_size * (i + 1)" because it never exceeds `size`. */
+    hm_nint approx_chunk_size = size / chunk_count;
+    hm_nint start_index = 0;
+    for (hm_nint i = 0; i < chunk_count; i++) {
+        hm_nint end_index = size;
+        if (i + 1 < chunk_count) {
+            hm_nint approx_end_index = approx_chunk_size * (i + 1);
+            if (approx_end_index < start_index) {
+                approx_end_index = start_index;
+            }
+            end_index = hmFindNewline(chars, approx_end_index, size, has_crlf_newlines);
+            if (end_index < size) {
+                end_index++; /* skips the newline itself; no safe math because "end_index < size" */
+            }
+        }
+        hmLineChunk* chunk = &chunks[i];
+        chunk->allocator = allocator;
+        chunk->chars = chars;
+        chunk->start_index = start_index;
+        chunk->end_index = end_index;
+        chunk->has_crlf_newlines = has_crlf_newlines;
+        chunk->is_lines_initialized = HM_FALSE;
+        chunk->is_thread_initialized = HM_FALSE;
+        chunk->err = HM_OK;
+        start_index = end_index;
+    }
+    hmError err = HM_OK;
+    /* The first chunk is processed on the current thread, the rest are offloaded to new threads. */
+    for (hm_nint i = 1; i < chunk_count; i++) {
+        err = hmCreateThread(allocator, HM_NULL, &hmLineChunkSplitLines, &chunks[i], &chunks[i].thread);
+        if (err != HM_OK) {
+            break;
+        }
+        chunks[i].is_thread_initialized = HM_TRUE;
+    }
+    if (err == HM_OK) {
+        err = hmLineChunkSplitLines(&chunks[0]);
+    }
+    for (hm_nint i = 1; i < chunk_count; i++) {
+        if (chunks[i].is_thread_initialized) {
+            err = hmMergeErrors(err, hmThreadJoin(&chunks[i].thread, HM_THREAD_JOIN_MAX_TIMEOUT_MS));
+            err = hmMergeErrors(err, hmThreadDispose(&chunks[i].thread));
+            err = hmMergeErrors(err, chunks[i].err);
+        }
+    }
+    hm_nint moved_chunk_count = 0;
+    hm_bool is_array_initialized = HM_FALSE;
+    if (err != HM_OK) {
+        HM_FINALIZE;
+    }
+    /* No safe math for "line_count += .." because there can't be more lines than bytes in the buffer. */
+    hm_nint line_count = 0;
+    for (hm_nint i = 0; i < chunk_count; i++) {
+        line_count += hmArrayGetCount(&chunks[i].lines);
+    }
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(
+        allocator,
+        sizeof(hmString),
+        line_count ? line_count : HM_ARRAY_DEFAULT_CAPACITY,
+        &hmStringDisposeFunc,
+        in_array
+    ));
+    is_array_initialized = HM_TRUE;
+    for (; moved_chunk_count < chunk_count; moved_chunk_count++) {
+        hmArray* lines = &chunks[moved_chunk_count].lines;
+        HM_TRY_OR_FINALIZE(err, hmArrayAddRange(in_array, hmArrayGetRaw(lines, hmString), hmArrayGetCount(lines)));
+    }
+HM_ON_FINALIZE
+    for (hm_nint i = 0; i < chunk_count; i++) {
+        /* The lines of the chunks which weren't moved to the resulting array are owned by the chunks. */
+        err = hmMergeErrors(err, hmLineChunkDispose(&chunks[i], i >= moved_chunk_count));
+    }
+    if (err != HM_OK && is_array_initialized) {
+        err = hmMergeErrors(err, hmArrayDispose(in_array));
+    }
+    hmFree(allocator, chunks);
+    return err;
+}
+
 static hm_bool hmLineReaderShouldReadFromSourceReader(hmLineReader* line_reader)
 {
     return line_reader->bytes_read == 0;
@@ -169,24 +319,34 @@ static void hmLineReaderScheduleMoreReadingFromSourceReader(hmLineReader* line_r
     line_reader->bytes_read = 0;
 }
 
-static hmError hmLineReaderAppendToNextLineBuilder(hmLineReader* line_reader, char* chars, hm_nint length_in_bytes)
+static hmError hmLineReaderAppendToNextLineBuilder(hmLineReader* line_reader, const char* chars, hm_nint length_in_bytes)
 {
     return hmStringBuilderAppendCStringWithLength(&line_reader->next_line_builder, chars, length_in_bytes);
 }
 
-static hmError hmLineReaderCreateLineFromNextLineBuilder(hmLineReader* line_reader, hmAllocator* allocator_opt, hmString* in_line)
+static void hmLineReaderFormLine(hmLineReader* line_reader, const char* chars, hm_nint length_in_bytes, const char** out_chars, hm_nint* out_length_in_bytes)
 {
-    hm_nint line_length_in_bytes = hmStringBuilderGetLengthInBytes(&line_reader->next_line_builder);
     /* Support for CRLF newlines: removes "\r" before "\n" (this function accepts lines which are always split by "\n"
        whether we want CRLF or LF newlines).
-       No safe math for "line_length_in_bytes - 1" and "line_length_in_bytes--" because the bounds are checked in "line_length_in_bytes > 0". */
-    if (line_reader->has_crlf_newlines
-        && line_length_in_bytes > 0
-        && hmStringBuilderGetChars(&line_reader->next_line_builder)[line_length_in_bytes - 1] == '\r')
-    {
-        line_length_in_bytes--;
-    }
-    return hmStringBuilderToStringWithStartIndexAndLengthInBytes(&line_reader->next_line_builder, allocator_opt, 0, line_length_in_bytes, in_line);
+       No safe math for "length_in_bytes - 1" and "length_in_bytes--" because the bounds are checked in "length_in_bytes > 0". */
+    if (line_reader->has_crlf_newlines && length_in_bytes > 0 && chars[length_in_bytes - 1] == '\r') {
+        length_in_bytes--;
+    }
+    *out_chars = chars;
+    *out_length_in_bytes = length_in_bytes;
+}
+
+static void hmLineReaderFormLineFromNextLineBuilder(hmLineReader* line_reader, const char** out_chars, hm_nint* out_length_in_bytes)
+{
+    hmLineReaderFormLine(
+        line_reader,
+        hmStringBuilderGetChars(&line_reader->next_line_builder),
+        hmStringBuilderGetLengthInBytes(&line_reader->next_line_builder),
+        out_chars,
+        out_length_in_bytes
+    );
+    /* The view refers to the builder's memory, so the builder can be cleared only on the next read. */
+    line_reader->has_stale_next_line = HM_TRUE;
 }
 
 static hmError hmLineReaderResetNextLineBuilder(hmLineReader* line_reader)
@@ -198,19 +358,32 @@ static hmError hmLineReaderResetNextLineBuilder(hmLineReader* line_reader)
 static hmError hmLineReaderAppendRemainingInBufferToNextLine(hmLineReader* line_reader)
 {
     hm_nint buffer_with_index_offset = 0, remaining_size = 0;
-    HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->buffer), line_reader->buffer_index, &buffer_with_index_offset));
+    HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->data), line_reader->buffer_index, &buffer_with_index_offset));
     HM_TRY(hmSubNint(line_reader->bytes_read, line_reader->buffer_index, &remaining_size));
-    HM_TRY(hmLineReaderAppendToNextLineBuilder(line_reader, hmCastNintToPointer(buffer_with_index_offset, char*), remaining_size));
+    HM_TRY(hmLineReaderAppendToNextLineBuilder(line_reader, hmCastNintToPointer(buffer_with_index_offset, const char*), remaining_size));
     line_reader->buffer_index = 0;
     return HM_OK;
 }
 
 /* See hmLineReaderReadLine(..) for the overview of the algorithm. */
-static hmError hmLineReaderReadFromSourceReader(hmLineReader* line_reader, hmAllocator* allocator_opt, hmString* in_line, hm_bool* out_is_line_formed)
+static hmError hmLineReaderReadFromSourceReader(
+    hmLineReader* line_reader,
+    const char**  out_chars,
+    hm_nint*      out_length_in_bytes,
+    hm_bool*      out_is_line_formed
+)
 {
     *out_is_line_formed = HM_FALSE;
     hm_nint bytes_read = 0;
-    HM_TRY(hmReaderRead(&line_reader->source_reader, line_reader->buffer, line_reader->buffer_size, &bytes_read));
+    if (hmReaderSupportsBorrowing(&line_reader->source_reader)) {
+        /* The source reader keeps the whole data in memory => lines are scanned right in the borrowed span, and only
+           lines which cross the boundary between two borrowed spans are copied to the next line builder. The span is
+           limited to `buffer_size` so that the behavior is the same as with regular reading. */
+        HM_TRY(hmReaderBorrow(&line_reader->source_reader, line_reader->buffer_size, &line_reader->data, &bytes_read));
+    } else {
+        HM_TRY(hmReaderRead(&line_reader->source_reader, line_reader->buffer, line_reader->buffer_size, &bytes_read));
+        line_reader->data = line_reader->buffer;
+    }
     /* A check to avoid buffer overflows, as we don't know if the underlying reader behaves correctly. */
     if (bytes_read > line_reader->buffer_size) {
         return HM_ERROR_OVERFLOW;
@@ -223,20 +396,12 @@ static hmError hmLineReaderReadFromSourceReader(hmLineReader* line_reader, hmAll
         /* We can't read from the source reader anymore but there's some stuff still found in the buffer => form it as the
            next (and last) line. */
         hm_nint buffer_with_index_offset = 0, remaining_size = 0;
-        HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->buffer), line_reader->buffer_index, &buffer_with_index_offset));
+        HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->data), line_reader->buffer_index, &buffer_with_index_offset));
         HM_TRY(hmSubNint(line_reader->bytes_read, line_reader->buffer_index, &remaining_size));
-        HM_TRY(hmLineReaderAppendToNextLineBuilder(line_reader, hmCastNintToPointer(buffer_with_index_offset, char*), remaining_size));
-        hmError err = hmLineReaderCreateLineFromNextLineBuilder(line_reader, allocator_opt, in_line);
-        hm_bool is_string_initialized = err == HM_OK;
-        err = hmMergeErrors(err, hmLineReaderResetNextLineBuilder(line_reader));
-        if (err != HM_OK) {
-            if (is_string_initialized) {
-                err = hmMergeErrors(err, hmStringDispose(in_line));
-            }
-        } else {
-            *out_is_line_formed = HM_TRUE;
-        }
-        return err;
+        HM_TRY(hmLineReaderAppendToNextLineBuilder(line_reader, hmCastNintToPointer(buffer_with_index_offset, const char*), remaining_size));
+        hmLineReaderFormLineFromNextLineBuilder(line_reader, out_chars, out_length_in_bytes);
+        *out_is_line_formed = HM_TRUE;
+        return HM_OK;
     }
     line_reader->bytes_read = bytes_read;
     return HM_OK;
@@ -246,12 +411,12 @@ static hm_bool hmLineReaderIsNewline(hmLineReader* line_reader, hm_nint index)
 {
     /* NOTE: it's safe to look for '\n' in a UTF8 string as it's guaranteed to not be part of any non-ASCII code point by design. */
     if (line_reader->has_crlf_newlines) {
-        if (line_reader->buffer[index] != '\n') {
+        if (line_reader->data[index] != '\n') {
             return HM_FALSE;
         }
         /* Looks for the preceding "\r" in the buffer as there's some space in it before "\n". */
         if (index > line_reader->buffer_index) {
-            return line_reader->buffer[index - 1] == '\r'; /* no safe math because "index" can't be 0 after "index > line_reader->buffer_index" */
+            return line_reader->data[index - 1] == '\r'; /* no safe math because "index" can't be 0 after "index > line_reader->buffer_index" */
         }
         /* Checks for "\r" in the next line builder. */
         hm_nint next_line_builder_length_in_bytes = hmStringBuilderGetLengthInBytes(&line_reader->next_line_builder);
@@ -261,39 +426,115 @@ static hm_bool hmLineReaderIsNewline(hmLineReader* line_reader, hm_nint index)
         /* No safe math for "next_line_builder_length_in_bytes - 1" because we checked above that "next_line_builder_length_in_bytes > 0" */
         return hmStringBuilderGetChars(&line_reader->next_line_builder)[next_line_builder_length_in_bytes - 1] == '\r';
     } else {
-        return line_reader->buffer[index] == '\n';
+        return line_reader->data[index] == '\n';
     }
 }
 
 /* See hmLineReaderReadLine(..) for the overview of the algorithm. */
 static hmError hmLineReaderScanBufferForNextLine(
     hmLineReader* line_reader,
-    hmAllocator*  allocator_opt,
-    hmString*     in_line,
+    const char**  out_chars,
+    hm_nint*      out_length_in_bytes,
     hm_bool*      out_is_line_formed
 )
 {
     *out_is_line_formed = HM_FALSE;
     for (hm_nint i = line_reader->buffer_index; i < line_reader->bytes_read; i++) {
         if (hmLineReaderIsNewline(line_reader, i)) {
-            hm_nint buffer_with_index_offset = 0, remaining_size = 0;
-            HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->buffer), line_reader->buffer_index, &buffer_with_index_offset));
+            hm_nint buffer_with_index_offset = 0, remaining_size = 0, next_buffer_index = 0;
+            HM_TRY(hmAddNint(hmCastPointerToNint(line_reader->data), line_reader->buffer_index, &buffer_with_index_offset));
             HM_TRY(hmSubNint(i, line_reader->buffer_index, &remaining_size));
-            HM_TRY(hmLineReaderAppendToNextLineBuilder(line_reader, hmCastNintToPointer(buffer_with_index_offset, char*), remaining_size));
-            hmError err = hmLineReaderCreateLineFromNextLineBuilder(line_reader, allocator_opt, in_line);
-            hm_bool is_string_initialized = err == HM_OK;
-            err = hmMergeErrors(err, hmLineReaderResetNextLineBuilder(line_reader));
-            if (err == HM_OK) {
-                err = hmMergeErrors(err, hmAddNint(i, 1, &line_reader->buffer_index));
+            HM_TRY(hmAddNint(i, 1, &next_buffer_index));
+            const char* chars = hmCastNintToPointer(buffer_with_index_offset, const char*);
+            if (hmStringBuilderGetLengthInBytes(&line_reader->next_line_builder) == 0) {
+                /* The whole line fits in the buffer => no copying. */
+                hmLineReaderFormLine(line_reader, chars, remaining_size, out_chars, out_length_in_bytes);
             } else {
-                if (is_string_initialized) {
-                    err = hmMergeErrors(err, hmStringDispose(in_line));
-                }
-                return err;
+                /* The line spans several buffered reading calls => its beginning is already in the next line builder. */
+                HM_TRY(hmLineReaderAppendToNextLineBuilder(line_reader, chars, remaining_size));
+                hmLineReaderFormLineFromNextLineBuilder(line_reader, out_chars, out_length_in_bytes);
             }
+            line_reader->buffer_index = next_buffer_index;
             *out_is_line_formed = HM_TRUE;
             return HM_OK;
         }
     }
     return HM_OK;
 }
+
+/* Returns the index of the next newline ("\n", or "\r\n" if `has_crlf_newlines` is set, in which case the index of "\n"
+   is returned) between `start_index` and `end_index`, or `end_index` if there's none. */
+static hm_nint hmFindNewline(const char* chars, hm_nint start_index, hm_nint end_index, hm_bool has_crlf_newlines)
+{
+    /* No safe math for pointer arithmetic because all indices are inside the buffer. */
+    hm_nint index = start_index;
+    while (index < end_index) {
+        const char* newline = memchr(chars + index, '\n', end_index - index);
+        if (!newline) {
+            return end_index;
+        }
+        index = (hm_nint)(newline - chars);
+        /* With CRLF newlines, "\r" should be a part of the current line. */
+        if (!has_crlf_newlines || (index > start_index && chars[index - 1] == '\r')) {
+            return index;
+        }
+        index++;
+    }
+    return end_index;
+}
+
+/* See hmReadAllLinesInParallel(..) Follows the same rules as hmLineReaderReadLine(..): for example, no empty line is
+   formed after a trailing newline. */
+static hmError hmLineChunkSplitLines(void* user_data)
+{
+    hmLineChunk* chunk = (hmLineChunk*)user_data;
+    hmError err = hmCreateArray(
+        chunk->allocator,
+        sizeof(hmString),
+        HM_ARRAY_DEFAULT_CAPACITY,
+        HM_NULL, /* no dispose function, see hmLineChunkDispose(..) */
+        &chunk->lines
+    );
+    if (err != HM_OK) {
+        chunk->err = err;
+        return err;
+    }
+    chunk->is_lines_initialized = HM_TRUE;
+    hm_nint index = chunk->start_index;
+    while (index < chunk->end_index) {
+        hm_nint newline_index = hmFindNewline(chunk->chars, index, chunk->end_index, chunk->has_crlf_newlines);
+        /* No safe math: "newline_index >= index" and the bounds are checked in "length_in_bytes > 0". */
+        hm_nint length_in_bytes = newline_index - index;
+        if (chunk->has_crlf_newlines && length_in_bytes > 0 && chunk->chars[newline_index - 1] == '\r') {
+            length_in_bytes--;
+        }
+        hmString line;
+        err = hmCreateStringFromCStringWithLengthInBytes(chunk->allocator, chunk->chars + index, length_in_bytes, &line);
+        if (err != HM_OK) {
+            break;
+        }
+        err = hmArrayAdd(&chunk->lines, &line);
+        if (err != HM_OK) {
+            err = hmMergeErrors(err, hmStringDispose(&line));
+            break;
+        }
+        index = newline_index < chunk->end_index ? newline_index + 1 : chunk->end_index;
+    }
+    chunk->err = err;
+    return err;
+}
+
+static hmError hmLineChunkDispose(hmLineChunk* chunk, hm_bool should_dispose_lines)
+{
+    if (!chunk->is_lines_initialized) {
+        return HM_OK;
+    }
+    hmError err = HM_OK;
+    if (should_dispose_lines) {
+        hmString* lines = hmArrayGetRaw(&chunk->lines, hmString);
+        for (hm_nint i = 0; i < hmArrayGetCount(&chunk->lines); i++) {
+            err = hmMergeErrors(err, hmStringDispose(&lines[i]));
+        }
+    }
+    return hmMergeErrors(err, hmArrayDispose(&chunk->lines));
+}
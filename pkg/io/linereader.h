@@ -25,17 +25,21 @@ typedef struct {
     hmAllocator*    allocator;
     char*           buffer;              /* Scratch memory for buffered reading. */
     hm_nint         buffer_size;         /* The size of the scratch memory for buffered reading. */
+    const char*     data;                /* The data being scanned: either `buffer`, or a span borrowed from `source_reader`. */
     hm_nint         buffer_index;        /* The current index inside buffered data when scanning the buffer for newlines. */
     hm_nint         bytes_read;          /* The number of read bytes can be less than `buffer_size`, so we remember that. */
     hm_bool         has_more_lines;      /* Becomes HM_FALSE the first time `source_reader` returns 0 read bytes. */
     hm_bool         close_source_reader; /* If true, the source reader will be closed when the line reader is disposed. */
     hm_bool         has_crlf_newlines;   /* Tells if newlines should be treated as CRLF ("\r\n") instead of LF ("\n"). */
+    hm_bool         has_stale_next_line; /* The last line view refers to `next_line_builder`, so it should be cleared lazily on the next read. */
 } hmLineReader;
 
 /* A line reader takes a `source_reader` and progressively reads lines separated by newlines from it via hmLineReaderReadLine(..) (see).
    If `close_source_reader` is true, `source_reader` is automatically closed when the line reader is disposed.
   `buffer` and `buffer_size` specify the internal scratch buffer which will be used. Useful for tests and to control memory usage.
   `buffer` is not copied into the line reader and should retained by the caller for as long as the line reader is alive.
+   If `source_reader` supports borrowing (see hmReaderSupportsBorrowing(..)), `buffer` is not used: the data is borrowed
+   from the source reader in spans of `buffer_size` bytes instead.
    If `has_crlf_newlines` is set to HM_TRUE, treats newlines as CRLF ("\r\n") instead of LF ("\n"). For example, the HTTP protocol
    supports only CRLF newlines. */
 hmError hmCreateLineReader(
@@ -59,6 +63,14 @@ hmError hmLineReaderDispose(hmLineReader* line_reader);
    All reading errors from the underlying source reader are simply propagated.
    NOTE If the stream ends with a trailing newline (for example, "Hello World\n"), no empty line is returned. */
 hmError hmLineReaderReadLine(hmLineReader* line_reader, hmAllocator* allocator_opt, hmString* in_line);
+/* Same as hmLineReaderReadLine(..), except nothing is allocated: the line is returned as a pointer to its characters
+   in `out_chars` (NOT null-terminated) and its length in `out_length_in_bytes`. If the line fits in the scratch buffer,
+   the pointer refers directly to the scratch buffer (or to the source reader's own memory if the source reader supports
+   borrowing, see hmReaderBorrow(..)); lines spanning several buffered reading calls are accumulated in the internal
+   string builder, and the pointer refers to the builder's memory.
+   The view is valid only until the next call to hmLineReaderReadLine(..), hmLineReaderReadLineView(..) or
+   hmLineReaderDispose(..): copy it if you want it to survive. */
+hmError hmLineReaderReadLineView(hmLineReader* line_reader, const char** out_chars, hm_nint* out_length_in_bytes);
 /* The line reader can "overshoot", i.e. while reading the next line from the source reader, it can read more bytes
    than necessary for the next line, because it reads in fixed size chunks. This function returns what's left in the buffer by
    placing the pointer to the internal buffer in `out_buffer` with `out_size`. The returned buffer is valid as long as
@@ -66,7 +78,7 @@ hmError hmLineReaderReadLine(hmLineReader* line_reader, hmAllocator* allocator_o
    The function is useful when the source reader is shared between multiple clients: for example, one client (i.e. hmLineReader)
    wants to read several lines up to some point, and another client wants to start reading where hmLineReader left off.
    Subsequent calls to hmLineReaderReadLine(..) can change the contents of the buffer. */
-hmError hmLineReaderGetBuffered(hmLineReader* line_reader, char** out_buffer, hm_nint* out_size);
+hmError hmLineReaderGetBuffered(hmLineReader* line_reader, const char** out_buffer, hm_nint* out_size);
 
 /* A helper function which creates a temporary line reader from the given `reader`, reads all lines, accumulates them
    in an array, and then disposes of the temporary line reader.
@@ -80,5 +92,19 @@ hmError hmReadAllLines(
     hm_bool      has_crlf_newlines,
     hmArray*     in_array
 );
+/* Same as hmReadAllLines(..), but splits the lines of an already available buffer specified by `chars` and `size`
+   (for example, the contents of a mapped file borrowed with hmReaderBorrow(..), see hmCreateMappedFileReader(..)).
+   The buffer is cut into up to `thread_count` chunks at newline boundaries, and each chunk is processed on a separate
+   thread; the resulting lines are then gathered in `in_array` in the original order. Small buffers are split into fewer
+   chunks (down to just one, in which case no threads are started at all). `thread_count` should be at least 1.
+   The allocator must be thread-safe if `thread_count` is larger than 1 (see hmCreateThread(..)) */
+hmError hmReadAllLinesInParallel(
+    hmAllocator* allocator,
+    const char*  chars,
+    hm_nint      size,
+    hm_bool      has_crlf_newlines,
+    hm_nint      thread_count,
+    hmArray*     in_array
+);
 
 #endif /* HM_LINE_READER_H */
@@ -0,0 +1,417 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <io/lz4.h>
+#include <io/bufferedreader.h>
+#include <core/utils.h>
+#include <vendor/lz4/lz4.h>
+
+#include <limits.h> /* for INT_MAX */
+
+/* See the LZ4 frame format specification. */
+#define HM_LZ4_FRAME_MAGIC               0x184D2204U
+#define HM_LZ4_FRAME_HEADER_SIZE         7           /* Magic (4) + FLG (1) + BD (1) + HC (1), without optional fields. */
+#define HM_LZ4_FRAME_VERSION             0x40U       /* FLG: bits 7-6 must be "01" */
+#define HM_LZ4_FRAME_VERSION_MASK        0xC0U
+#define HM_LZ4_FRAME_BLOCK_INDEPENDENCE  0x20U       /* FLG: blocks don't refer to previous blocks */
+#define HM_LZ4_FRAME_BLOCK_CHECKSUM      0x10U       /* FLG: each block is followed by a 4-byte checksum */
+#define HM_LZ4_FRAME_CONTENT_SIZE        0x08U       /* FLG: the header contains the 8-byte size of the content */
+#define HM_LZ4_FRAME_CONTENT_CHECKSUM    0x04U       /* FLG: the end mark is followed by a 4-byte checksum */
+#define HM_LZ4_FRAME_RESERVED            0x02U       /* FLG: must be zero */
+#define HM_LZ4_FRAME_DICTIONARY_ID       0x01U       /* FLG: the header contains the 4-byte ID of a preset dictionary */
+#define HM_LZ4_FRAME_BLOCK_SIZE_64KB     0x40U       /* BD: the block size ID 4 in bits 6-4 */
+#define HM_LZ4_FRAME_UNCOMPRESSED_BLOCK  0x80000000U /* The high bit of a block size tells that the block is stored as is. */
+#define HM_LZ4_FRAME_WORD_SIZE           4           /* Block sizes, checksums and the end mark are 4-byte words. */
+
+static hm_uint32 hmLZ4ReadLittleEndian32(const char* chars);
+static void hmLZ4WriteLittleEndian32(char* chars, hm_uint32 value);
+static hm_uint8 hmLZ4HashFrameDescriptor(const char* chars, hm_nint size);
+static hmError hmLZ4ReadExactly(hmReader* reader, char* buffer, hm_nint size);
+
+hmError hmLZ4CompressBlock(const char* source, hm_nint source_size, char* dest, hm_nint dest_size, hm_nint* out_size)
+{
+    if (source_size > HM_LZ4_BLOCK_SIZE) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    /* The library takes sizes as ints: `source_size` is at most 64KB, and larger destinations are simply clamped,
+       because a 64KB block never compresses to more than INT_MAX bytes anyway. */
+    int dest_capacity = dest_size > INT_MAX ? INT_MAX : (int)dest_size;
+    int compressed_size = LZ4_compress_default(source, dest, (int)source_size, dest_capacity);
+    if (compressed_size <= 0) { /* the compressed data doesn't fit in `dest` */
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    *out_size = (hm_nint)compressed_size;
+    return HM_OK;
+}
+
+hmError hmLZ4DecompressBlock(const char* source, hm_nint source_size, char* dest, hm_nint dest_size, hm_nint* out_size)
+{
+    if (source_size > INT_MAX) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    /* LZ4_decompress_safe(..) validates every length and offset, so it's safe to call on untrusted data. */
+    int dest_capacity = dest_size > INT_MAX ? INT_MAX : (int)dest_size;
+    int decompressed_size = LZ4_decompress_safe(source, dest, (int)source_size, dest_capacity);
+    if (decompressed_size < 0) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    *out_size = (hm_nint)decompressed_size;
+    return HM_OK;
+}
+
+/* **************** */
+/*    LZ4Reader.    */
+/* **************** */
+
+typedef struct {
+    hmAllocator*     allocator;            /* The allocator which governs this structure's lifetime. */
+    hmReader         source_reader;        /* Compressed data is read from this reader. */
+    hmBufferedReader buffered_reader;      /* Wraps `source_reader`, so that blocks are decompressed in place. Created
+                                              after the frame header is read, because the buffer size depends on it. */
+    char*            block;                /* The current decompressed block. Allocated together with the buffered reader. */
+    hm_nint          max_block_size;       /* Specified in the frame header. */
+    hm_nint          block_start_index;    /* Everything in `block` before this index was already read. */
+    hm_nint          block_end_index;      /* The size of the current decompressed block. */
+    hm_bool          close_source_reader;  /* If true, the source reader is closed when the LZ4 reader is closed. */
+    hm_bool          has_block_checksum;   /* Specified in the frame header. */
+    hm_bool          has_content_checksum; /* Specified in the frame header. */
+    hm_bool          is_frame_end;         /* Becomes HM_TRUE once the end mark is read. */
+} hmLZ4ReaderData;
+
+static hmError hmLZ4ReaderReadFrameHeader(hmLZ4ReaderData* data)
+{
+    /* The header is read directly from the source reader because the buffered reader's size depends on the header. */
+    char header[HM_LZ4_FRAME_HEADER_SIZE + sizeof(hm_uint64)];
+    HM_TRY(hmLZ4ReadExactly(&data->source_reader, header, 6)); /* magic + FLG + BD */
+    hm_uint8 flags = (hm_uint8)header[4], block_descriptor = (hm_uint8)header[5];
+    if (hmLZ4ReadLittleEndian32(header) != HM_LZ4_FRAME_MAGIC
+        || (flags & HM_LZ4_FRAME_VERSION_MASK) != HM_LZ4_FRAME_VERSION
+        || !(flags & HM_LZ4_FRAME_BLOCK_INDEPENDENCE)
+        || (flags & (HM_LZ4_FRAME_RESERVED | HM_LZ4_FRAME_DICTIONARY_ID))
+        || (block_descriptor & 0x8FU)) /* reserved bits of BD */
+    {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hm_nint block_size_id = block_descriptor >> 4;
+    if (block_size_id < 4) { /* IDs 4-7 stand for 64KB, 256KB, 1MB and 4MB */
+        return HM_ERROR_INVALID_DATA;
+    }
+    /* The content size (if any) isn't needed because the content is streamed anyway, but it's covered by the checksum. */
+    hm_nint remaining_header_size = (flags & HM_LZ4_FRAME_CONTENT_SIZE) ? sizeof(hm_uint64) + 1 : 1;
+    HM_TRY(hmLZ4ReadExactly(&data->source_reader, header + 6, remaining_header_size));
+    hm_nint descriptor_size = 2 + remaining_header_size - 1; /* FLG + BD + optional fields, without HC */
+    if (hmLZ4HashFrameDescriptor(header + 4, descriptor_size) != (hm_uint8)header[4 + descriptor_size]) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    data->max_block_size = (hm_nint)1 << (8 + 2 * block_size_id);
+    data->has_block_checksum = (flags & HM_LZ4_FRAME_BLOCK_CHECKSUM) != 0;
+    data->has_content_checksum = (flags & HM_LZ4_FRAME_CONTENT_CHECKSUM) != 0;
+    data->block = (char*)hmAlloc(data->allocator, data->max_block_size);
+    if (!data->block) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    /* Fits a whole block together with its size and checksum, so that it can be decompressed directly from the buffer. */
+    hmError err = hmCreateBufferedReader(
+        data->allocator,
+        data->source_reader,
+        HM_FALSE, /* close_source_reader = HM_FALSE, because the source reader is closed by the LZ4 reader itself */
+        data->max_block_size + 2 * HM_LZ4_FRAME_WORD_SIZE,
+        &data->buffered_reader
+    );
+    if (err != HM_OK) {
+        hmFree(data->allocator, data->block);
+        data->block = HM_NULL;
+    }
+    return err;
+}
+
+static hmError hmLZ4ReaderReadBlock(hmLZ4ReaderData* data)
+{
+    const char* chars = HM_NULL;
+    hm_nint buffered_size = 0;
+    HM_TRY(hmBufferedReaderPeek(&data->buffered_reader, HM_LZ4_FRAME_WORD_SIZE, &chars, &buffered_size));
+    if (buffered_size < HM_LZ4_FRAME_WORD_SIZE) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hm_uint32 block_header = hmLZ4ReadLittleEndian32(chars);
+    if (!block_header) { /* the end mark */
+        HM_TRY(hmBufferedReaderConsume(&data->buffered_reader, HM_LZ4_FRAME_WORD_SIZE));
+        if (data->has_content_checksum) {
+            HM_TRY(hmBufferedReaderPeek(&data->buffered_reader, HM_LZ4_FRAME_WORD_SIZE, &chars, &buffered_size));
+            if (buffered_size < HM_LZ4_FRAME_WORD_SIZE) {
+                return HM_ERROR_INVALID_DATA;
+            }
+            HM_TRY(hmBufferedReaderConsume(&data->buffered_reader, HM_LZ4_FRAME_WORD_SIZE));
+        }
+        data->is_frame_end = HM_TRUE;
+        return HM_OK;
+    }
+    hm_nint block_size = block_header & ~HM_LZ4_FRAME_UNCOMPRESSED_BLOCK;
+    if (block_size > data->max_block_size) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    /* No safe math because `block_size` is at most 4MB. */
+    hm_nint total_size = HM_LZ4_FRAME_WORD_SIZE + block_size + (data->has_block_checksum ? HM_LZ4_FRAME_WORD_SIZE : 0);
+    HM_TRY(hmBufferedReaderPeek(&data->buffered_reader, total_size, &chars, &buffered_size));
+    if (buffered_size < total_size) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hm_nint decompressed_size = block_size;
+    if (block_header & HM_LZ4_FRAME_UNCOMPRESSED_BLOCK) {
+        hmCopyMemory(data->block, chars + HM_LZ4_FRAME_WORD_SIZE, block_size);
+    } else {
+        HM_TRY(hmLZ4DecompressBlock(chars + HM_LZ4_FRAME_WORD_SIZE, block_size, data->block, data->max_block_size, &decompressed_size));
+    }
+    data->block_start_index = 0;
+    data->block_end_index = decompressed_size;
+    return hmBufferedReaderConsume(&data->buffered_reader, total_size);
+}
+
+static hmError hmLZ4Reader_read(hmReader* reader, char* buffer, hm_nint size, hm_nint* out_bytes_read)
+{
+    hmLZ4ReaderData* data = (hmLZ4ReaderData*)reader->data;
+    *out_bytes_read = 0;
+    if (!size) {
+        return HM_OK;
+    }
+    if (!data->block) {
+        HM_TRY(hmLZ4ReaderReadFrameHeader(data));
+    }
+    while (data->block_start_index == data->block_end_index) { /* blocks can be empty */
+        if (data->is_frame_end) {
+            return HM_OK;
+        }
+        HM_TRY(hmLZ4ReaderReadBlock(data));
+    }
+    /* No safe math because `block_start_index` never exceeds `block_end_index`. */
+    hm_nint available_size = data->block_end_index - data->block_start_index;
+    if (size > available_size) {
+        size = available_size;
+    }
+    hmCopyMemory(buffer, data->block + data->block_start_index, size);
+    data->block_start_index += size;
+    *out_bytes_read = size;
+    return HM_OK;
+}
+
+static hmError hmLZ4Reader_close(hmReader* reader)
+{
+    hmLZ4ReaderData* data = (hmLZ4ReaderData*)reader->data;
+    hmError err = HM_OK;
+    if (data->block) {
+        err = hmBufferedReaderDispose(&data->buffered_reader);
+        hmFree(data->allocator, data->block);
+    }
+    if (data->close_source_reader) {
+        err = hmMergeErrors(err, hmReaderClose(&data->source_reader));
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateLZ4Reader(hmAllocator* allocator, hmReader source_reader, hm_bool close_source_reader, hmReader* in_reader)
+{
+    hmLZ4ReaderData* data = (hmLZ4ReaderData*)hmAlloc(allocator, sizeof(hmLZ4ReaderData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    data->allocator = allocator;
+    data->source_reader = source_reader;
+    data->block = HM_NULL; /* see hmLZ4ReaderReadFrameHeader(..) */
+    data->max_block_size = 0;
+    data->block_start_index = 0;
+    data->block_end_index = 0;
+    data->close_source_reader = close_source_reader;
+    data->has_block_checksum = HM_FALSE;
+    data->has_content_checksum = HM_FALSE;
+    data->is_frame_end = HM_FALSE;
+    in_reader->read = &hmLZ4Reader_read;
+    in_reader->close = &hmLZ4Reader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = HM_NULL;
+    in_reader->data = data;
+    return HM_OK;
+}
+
+/* **************** */
+/*    LZ4Writer.    */
+/* **************** */
+
+typedef struct {
+    hmAllocator* allocator;                                                    /* The allocator which governs this structure's lifetime. */
+    hmWriter     inner_writer;                                                 /* Compressed data is written to this writer. */
+    hm_nint      block_size;                                                   /* How much of `block` is filled. */
+    hm_bool      close_inner_writer;                                           /* If true, the inner writer is closed when the LZ4 writer is closed. */
+    hm_bool      is_frame_header_written;                                      /* The header is written together with the first block. */
+    char         block[HM_LZ4_BLOCK_SIZE];                                     /* Accumulates data until there's enough of it for a block. */
+    char         compressed_block[HM_LZ4_FRAME_WORD_SIZE + HM_LZ4_BLOCK_SIZE]; /* The block size followed by the compressed block. */
+} hmLZ4WriterData;
+
+static hmError hmLZ4WriterWriteFrameHeader(hmLZ4WriterData* data)
+{
+    if (data->is_frame_header_written) {
+        return HM_OK;
+    }
+    char header[HM_LZ4_FRAME_HEADER_SIZE];
+    hmLZ4WriteLittleEndian32(header, HM_LZ4_FRAME_MAGIC);
+    header[4] = (char)(HM_LZ4_FRAME_VERSION | HM_LZ4_FRAME_BLOCK_INDEPENDENCE);
+    header[5] = (char)HM_LZ4_FRAME_BLOCK_SIZE_64KB;
+    header[6] = (char)hmLZ4HashFrameDescriptor(header + 4, 2);
+    HM_TRY(hmWriterWriteAll(&data->inner_writer, header, HM_LZ4_FRAME_HEADER_SIZE));
+    data->is_frame_header_written = HM_TRUE;
+    return HM_OK;
+}
+
+static hmError hmLZ4WriterWriteBlock(hmLZ4WriterData* data, const char* chars, hm_nint size)
+{
+    if (!size) {
+        return HM_OK;
+    }
+    HM_TRY(hmLZ4WriterWriteFrameHeader(data));
+    hm_nint compressed_size = 0;
+    /* Compression which doesn't save anything is pointless: such blocks are stored as is. No safe math because `size > 0`. */
+    hmError err = hmLZ4CompressBlock(chars, size, data->compressed_block + HM_LZ4_FRAME_WORD_SIZE, size - 1, &compressed_size);
+    if (err == HM_ERROR_LIMIT_EXCEEDED) {
+        hmLZ4WriteLittleEndian32(data->compressed_block, (hm_uint32)size | HM_LZ4_FRAME_UNCOMPRESSED_BLOCK);
+        HM_TRY(hmWriterWriteAll(&data->inner_writer, data->compressed_block, HM_LZ4_FRAME_WORD_SIZE));
+        return hmWriterWriteAll(&data->inner_writer, chars, size);
+    }
+    HM_TRY(err);
+    hmLZ4WriteLittleEndian32(data->compressed_block, (hm_uint32)compressed_size);
+    return hmWriterWriteAll(&data->inner_writer, data->compressed_block, HM_LZ4_FRAME_WORD_SIZE + compressed_size);
+}
+
+static hmError hmLZ4Writer_write(hmWriter* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
+{
+    hmLZ4WriterData* data = (hmLZ4WriterData*)writer->data;
+    *out_bytes_written = 0;
+    /* No safe math below because `out_bytes_written` never exceeds `size`, and `block_size` never exceeds HM_LZ4_BLOCK_SIZE. */
+    while (*out_bytes_written < size) {
+        hm_nint remaining_size = size - *out_bytes_written;
+        if (!data->block_size && remaining_size >= HM_LZ4_BLOCK_SIZE) {
+            /* Whole blocks are compressed directly from the caller's buffer, without copying. */
+            HM_TRY(hmLZ4WriterWriteBlock(data, buffer + *out_bytes_written, HM_LZ4_BLOCK_SIZE));
+            *out_bytes_written += HM_LZ4_BLOCK_SIZE;
+            continue;
+        }
+        hm_nint copied_size = HM_LZ4_BLOCK_SIZE - data->block_size;
+        if (copied_size > remaining_size) {
+            copied_size = remaining_size;
+        }
+        hmCopyMemory(data->block + data->block_size, buffer + *out_bytes_written, copied_size);
+        data->block_size += copied_size;
+        *out_bytes_written += copied_size;
+        if (data->block_size == HM_LZ4_BLOCK_SIZE) {
+            HM_TRY(hmLZ4WriterFlush(writer));
+        }
+    }
+    return HM_OK;
+}
+
+static hmError hmLZ4Writer_close(hmWriter* writer)
+{
+    hmLZ4WriterData* data = (hmLZ4WriterData*)writer->data;
+    hmError err = hmLZ4WriterFlush(writer);
+    if (err == HM_OK) {
+        err = hmLZ4WriterWriteFrameHeader(data); /* an empty frame still has a header */
+    }
+    if (err == HM_OK) {
+        char end_mark[HM_LZ4_FRAME_WORD_SIZE] = {0};
+        err = hmWriterWriteAll(&data->inner_writer, end_mark, HM_LZ4_FRAME_WORD_SIZE);
+    }
+    if (data->close_inner_writer) {
+        err = hmMergeErrors(err, hmWriterClose(&data->inner_writer));
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateLZ4Writer(hmAllocator* allocator, hmWriter inner_writer, hm_bool close_inner_writer, hmWriter* in_writer)
+{
+    hmLZ4WriterData* data = (hmLZ4WriterData*)hmAlloc(allocator, sizeof(hmLZ4WriterData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    data->allocator = allocator;
+    data->inner_writer = inner_writer;
+    data->block_size = 0;
+    data->close_inner_writer = close_inner_writer;
+    data->is_frame_header_written = HM_FALSE;
+    in_writer->write = &hmLZ4Writer_write;
+    in_writer->close = &hmLZ4Writer_close;
+    in_writer->write_vector_opt = HM_NULL;
+    in_writer->get_native_handle_opt = HM_NULL;
+    in_writer->data = data;
+    return HM_OK;
+}
+
+hmError hmLZ4WriterFlush(hmWriter* writer)
+{
+    hmLZ4WriterData* data = (hmLZ4WriterData*)writer->data;
+    HM_TRY(hmLZ4WriterWriteBlock(data, data->block, data->block_size));
+    data->block_size = 0;
+    return HM_OK;
+}
+
+static hm_uint32 hmLZ4ReadLittleEndian32(const char* chars)
+{
+    const hm_uint8* bytes = (const hm_uint8*)chars;
+    return (hm_uint32)bytes[0] | ((hm_uint32)bytes[1] << 8) | ((hm_uint32)bytes[2] << 16) | ((hm_uint32)bytes[3] << 24);
+}
+
+static void hmLZ4WriteLittleEndian32(char* chars, hm_uint32 value)
+{
+    chars[0] = (char)(value & 0xFF);
+    chars[1] = (char)((value >> 8) & 0xFF);
+    chars[2] = (char)((value >> 16) & 0xFF);
+    chars[3] = (char)(value >> 24);
+}
+
+#define hmLZ4RotateLeft32(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+/* The frame header checksum is the second byte of the xxHash32 (with seed 0) of the frame descriptor. The descriptor
+   is always shorter than 16 bytes, so only the short-input path of xxHash32 is implemented. */
+static hm_uint8 hmLZ4HashFrameDescriptor(const char* chars, hm_nint size)
+{
+    const hm_uint32 prime1 = 2654435761U, prime2 = 2246822519U, prime3 = 3266489917U, prime4 = 668265263U, prime5 = 374761393U;
+    hm_uint32 hash = prime5 + (hm_uint32)size;
+    hm_nint index = 0;
+    for (; index + 4 <= size; index += 4) {
+        hash += hmLZ4ReadLittleEndian32(chars + index) * prime3;
+        hash = hmLZ4RotateLeft32(hash, 17) * prime4;
+    }
+    for (; index < size; index++) {
+        hash += (hm_uint32)(hm_uint8)chars[index] * prime5;
+        hash = hmLZ4RotateLeft32(hash, 11) * prime1;
+    }
+    hash ^= hash >> 15;
+    hash *= prime2;
+    hash ^= hash >> 13;
+    hash *= prime3;
+    hash ^= hash >> 16;
+    return (hm_uint8)(hash >> 8);
+}
+
+static hmError hmLZ4ReadExactly(hmReader* reader, char* buffer, hm_nint size)
+{
+    while (size > 0) {
+        hm_nint bytes_read = 0;
+        HM_TRY(hmReaderRead(reader, buffer, size, &bytes_read));
+        if (!bytes_read) {
+            return HM_ERROR_INVALID_DATA;
+        }
+        buffer += bytes_read;
+        size -= bytes_read; /* no safe math because readers never return more than requested */
+    }
+    return HM_OK;
+}
@@ -0,0 +1,53 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_LZ4_H
+#define HM_LZ4_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <io/reader.h>
+#include <io/writer.h>
+
+#define HM_LZ4_BLOCK_SIZE     (64*1024)    /* 64KB; the size of blocks produced by LZ4 writers */
+#define HM_LZ4_MAX_BLOCK_SIZE (4*1024*1024) /* 4MB; the largest block size allowed by the LZ4 frame format */
+
+/* Compresses `source_size` bytes of `source` as a single LZ4 block (without any framing) into `dest` of `dest_size` bytes,
+   returning the size of the compressed data in `out_size`. `source_size` must not exceed HM_LZ4_BLOCK_SIZE.
+   Returns HM_ERROR_LIMIT_EXCEEDED if the compressed data doesn't fit in `dest` (for example, because `source` is
+   incompressible), in which case it's better to store the data as is. */
+hmError hmLZ4CompressBlock(const char* source, hm_nint source_size, char* dest, hm_nint dest_size, hm_nint* out_size);
+/* Decompresses a single LZ4 block `source` of `source_size` bytes into `dest` of `dest_size` bytes, returning the size of
+   the decompressed data in `out_size`. Returns HM_ERROR_INVALID_DATA if the block is malformed or doesn't fit in `dest`:
+   it's safe to decompress untrusted data. */
+hmError hmLZ4DecompressBlock(const char* source, hm_nint source_size, char* dest, hm_nint dest_size, hm_nint* out_size);
+
+/* Creates a reader which decompresses data in the LZ4 frame format read from `source_reader`, as it goes, a block at
+   a time: the memory used is bounded by twice the frame's maximum block size. Returns HM_ERROR_INVALID_DATA from
+   hmReaderRead(..) if the data is malformed or truncated, and also for frames with linked blocks or preset dictionaries,
+   which are not supported (the LZ4 tool doesn't produce them by default). Block and content checksums are skipped,
+   not verified. Only the first frame is read.
+   If `close_source_reader` is set to true, the LZ4 reader closes `source_reader` when it's closed itself. */
+hmError hmCreateLZ4Reader(hmAllocator* allocator, hmReader source_reader, hm_bool close_source_reader, hmReader* in_reader);
+/* Creates a writer which compresses data written to it in the LZ4 frame format (with independent blocks of
+   HM_LZ4_BLOCK_SIZE bytes) and writes the compressed data to `inner_writer`. LZ4 compresses worse than deflate (see
+   hmCreateDeflateWriter(..)), but is many times faster, which makes it a better fit for internal transport.
+   A block is written out each time it's filled: the frame is only complete after the writer is closed (see also
+   hmLZ4WriterFlush(..)). If `close_inner_writer` is set to true, the LZ4 writer closes `inner_writer` when it's closed itself. */
+hmError hmCreateLZ4Writer(hmAllocator* allocator, hmWriter inner_writer, hm_bool close_inner_writer, hmWriter* in_writer);
+/* Compresses and writes out the current block even if it's not filled yet, so that the other side can decompress
+   everything written so far. Flushing too often hurts the compression ratio.
+   The behavior is undefined if `writer` is not an LZ4 writer. */
+hmError hmLZ4WriterFlush(hmWriter* writer);
+
+#endif /* HM_LZ4_H */
@@ -26,6 +26,22 @@ hmError hmReaderClose(hmReader* reader)
     return reader->close(reader);
 }
 
+hmError hmReaderBorrow(hmReader* reader, hm_nint size, const char** out_chars, hm_nint* out_bytes_borrowed)
+{
+    if (!reader->borrow_opt) {
+        return HM_ERROR_NOT_IMPLEMENTED;
+    }
+    return reader->borrow_opt(reader, size, out_chars, out_bytes_borrowed);
+}
+
+hmError hmReaderGetNativeHandle(hmReader* reader, hm_nint* out_handle)
+{
+    if (!reader->get_native_handle_opt) {
+        return HM_ERROR_NOT_IMPLEMENTED;
+    }
+    return reader->get_native_handle_opt(reader, out_handle);
+}
+
 /* ******************* */
 /*    MemoryReader.    */
 /* ******************* */
@@ -58,6 +74,20 @@ static hmError hmMemoryReader_read(hmReader* reader, char* buffer, hm_nint size,
     return HM_OK;
 }
 
+static hmError hmMemoryReader_borrow(hmReader* reader, hm_nint size, const char** out_chars, hm_nint* out_bytes_borrowed)
+{
+    hmMemoryReaderData* data = (hmMemoryReaderData*)reader->data;
+    /* No safe math below because `offset` never exceeds `size`, and `base + size` is a valid memory block. */
+    hm_nint remaining_size = data->size - data->offset;
+    if (size > remaining_size) {
+        size = remaining_size;
+    }
+    *out_chars = data->base + data->offset;
+    *out_bytes_borrowed = size;
+    data->offset += size;
+    return HM_OK;
+}
+
 static hmError hmMemoryReader_close(hmReader* reader)
 {
     hmMemoryReaderData* data = (hmMemoryReaderData*)reader->data;
@@ -77,6 +107,8 @@ hmError hmCreateMemoryReader(hmAllocator* allocator, const char* mem, hm_nint me
     data->size = mem_size;
     in_reader->read = &hmMemoryReader_read;
     in_reader->close = &hmMemoryReader_close;
+    in_reader->borrow_opt = &hmMemoryReader_borrow;
+    in_reader->get_native_handle_opt = HM_NULL;
     in_reader->data = data;
     return HM_OK;
 }
@@ -165,6 +197,8 @@ hmError hmCreateLimitedReader(
     data->total_bytes_read = 0;
     in_reader->read = &hmLimitedReader_read;
     in_reader->close = &hmLimitedReader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = HM_NULL;
     in_reader->data = data;
     return HM_OK;
 }
@@ -260,6 +294,8 @@ hmError hmCreateCompositeReader(
     data->current_source_reader_index = 0;
     in_reader->read = &hmCompositeReader_read;
     in_reader->close = &hmCompositeReader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = HM_NULL;
     in_reader->data = data;
     return HM_OK;
 }
@@ -16,6 +16,7 @@
 
 #include <core/common.h>
 #include <core/allocator.h>
+#include <core/string.h>
 
 #define HM_READER_DEFAULT_BUFFER_SIZE (4*1024) /* 4KB */
 
@@ -23,6 +24,8 @@
 typedef struct hmReader_ {
     hmError (*read)(struct hmReader_* reader, char* buffer, hm_nint size, hm_nint* out_bytes_read); /* Reads `size` number of bytes to `buffer`, returns `out_bytes_read`. */
     hmError (*close)(struct hmReader_* reader);
+    hmError (*borrow_opt)(struct hmReader_* reader, hm_nint size, const char** out_chars, hm_nint* out_bytes_borrowed); /* See hmReaderBorrow(..) Can be HM_NULL. */
+    hmError (*get_native_handle_opt)(struct hmReader_* reader, hm_nint* out_handle); /* See hmReaderGetNativeHandle(..) Can be HM_NULL. */
     void*     data;                                            /* Reader-specific data. */
 } hmReader;
 
@@ -34,9 +37,29 @@ typedef hmError (*hmOnNextReaderFunc)(hm_nint previous_reader_index, void* conte
 hmError hmReaderRead(hmReader* reader, char* buffer, hm_nint size, hm_nint* out_bytes_read);
 /* Closes the reader, freeing all additional resources. */
 hmError hmReaderClose(hmReader* reader);
+/* Same as hmReaderRead(..), except doesn't copy anything: returns in `out_chars` a pointer to up to `size` next bytes
+   which live in the reader's own memory (for example, in a memory-mapped file), and advances the reader past them.
+   If `out_bytes_borrowed` is 0, it means there's no more data in the reader. The returned memory is read-only and stays
+   valid until the reader is closed.
+   Returns HM_ERROR_NOT_IMPLEMENTED if the reader doesn't support borrowing (see hmReaderSupportsBorrowing(..)):
+   only readers which keep the whole data in memory can support it. */
+hmError hmReaderBorrow(hmReader* reader, hm_nint size, const char** out_chars, hm_nint* out_bytes_borrowed);
+/* Returns HM_TRUE if the reader supports hmReaderBorrow(..) */
+#define hmReaderSupportsBorrowing(reader) ((reader)->borrow_opt != HM_NULL)
+/* Returns in `out_handle` the operating system's handle (for example, a file descriptor on Unix) which the reader reads from
+   directly, without any additional processing or buffering. Allows the platform layer to move data between handles without
+   copying it to user space (see hmCopy(..)). The handle is owned by the reader and stays valid until the reader is closed.
+   Returns HM_ERROR_NOT_IMPLEMENTED if the reader isn't backed by a handle, or if reading from the handle directly would
+   bypass some of the reader's logic (for example, limits). */
+hmError hmReaderGetNativeHandle(hmReader* reader, hm_nint* out_handle);
+/* Asks the operating system to start reading the next `size` bytes of the reader's underlying file asynchronously in
+   the background, so that subsequent reads find the data already in the page cache and don't have to wait for the disk.
+   Only a hint: the reader's position doesn't change, and nothing is read into user space.
+   Returns HM_ERROR_NOT_IMPLEMENTED if the reader isn't backed by a regular file (see hmReaderGetNativeHandle(..)) */
+hmError hmReaderReadahead(hmReader* reader, hm_nint size);
 
 /* Creates a reader which reads from a given fixed memory block and initialized data pointed to by in_reader.
-   Useful when data is constructed in-memory; for example, in tests. */
+   Useful when data is constructed in-memory; for example, in tests. Supports hmReaderBorrow(..) */
 hmError hmCreateMemoryReader(hmAllocator* allocator, const char* mem, hm_nint mem_size, hmReader* in_reader);
 /* Gets the current position of the memory reader. Useful for tests.
    The behavior is undefined if `reader` is not a memory reader. */
@@ -74,5 +97,15 @@ hmError hmCreateCompositeReader(
    void*              context_opt,
    hmReader*          in_reader
 );
+/* Creates a reader which reads from the file at the given `path`, using the operating system's buffered reads.
+   Works for any kind of file, including pipes and special files. Returns HM_ERROR_NOT_FOUND if the file doesn't exist,
+   and HM_ERROR_ACCESS_DENIED if there are no permissions to read it. */
+hmError hmCreateFileReader(hmAllocator* allocator, hmString* path, hmReader* in_reader);
+/* Same as hmCreateFileReader(..), except maps the whole file into memory and serves reads directly from the mapping,
+   hinting the operating system that the file is going to be read sequentially (so it reads ahead more aggressively).
+   Supports hmReaderBorrow(..), which allows to process large files at page cache speed without copying. Only regular
+   files can be mapped: returns HM_ERROR_INVALID_ARGUMENT otherwise (use hmCreateFileReader(..) for such files).
+   The behavior is undefined if the file is truncated by another process while it's mapped. */
+hmError hmCreateMappedFileReader(hmAllocator* allocator, hmString* path, hmReader* in_reader);
 
 #endif /* HM_READER_H */
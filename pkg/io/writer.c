@@ -12,13 +12,60 @@
 * ******************************************************************************/
 
 #include <io/writer.h>
-#include <core/stringbuilder.h>
+#include <core/math.h>
+#include <core/segmentedstringbuilder.h>
+#include <core/utils.h>
 
 hmError hmWriterWrite(hmWriter* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
 {
     return writer->write(writer, buffer, size, out_bytes_written);
 }
 
+hmError hmWriterWriteAll(hmWriter* writer, const char* buffer, hm_nint size)
+{
+    while (size > 0) {
+        hm_nint bytes_written = 0;
+        HM_TRY(hmWriterWrite(writer, buffer, size, &bytes_written));
+        if (!bytes_written) { /* the writer accepts no data, so the loop would never finish */
+            return HM_ERROR_INVALID_STATE;
+        }
+        if (bytes_written > size) { /* we don't know if the writer behaves correctly */
+            return HM_ERROR_OVERFLOW;
+        }
+        buffer += bytes_written;
+        size -= bytes_written;
+    }
+    return HM_OK;
+}
+
+hmError hmWriterWriteVector(hmWriter* writer, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint* out_bytes_written)
+{
+    *out_bytes_written = 0;
+    if (buffer_count > HM_WRITER_MAX_BUFFER_COUNT) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    if (writer->write_vector_opt) {
+        return writer->write_vector_opt(writer, buffers, buffer_count, out_bytes_written);
+    }
+    for (hm_nint i = 0; i < buffer_count; i++) {
+        hm_nint bytes_written = 0;
+        HM_TRY(hmWriterWrite(writer, buffers[i].chars, buffers[i].size, &bytes_written));
+        HM_TRY(hmAddNint(*out_bytes_written, bytes_written, out_bytes_written));
+        if (bytes_written < buffers[i].size) { /* partial write => the rest of the buffers can't be written either */
+            break;
+        }
+    }
+    return HM_OK;
+}
+
+hmError hmWriterGetNativeHandle(hmWriter* writer, hm_nint* out_handle)
+{
+    if (!writer->get_native_handle_opt) {
+        return HM_ERROR_NOT_IMPLEMENTED;
+    }
+    return writer->get_native_handle_opt(writer, out_handle);
+}
+
 hmError hmWriterClose(hmWriter *writer)
 {
     return writer->close(writer);
@@ -29,14 +76,15 @@ hmError hmWriterClose(hmWriter *writer)
 /* ******************* */
 
 typedef struct {
-    hmAllocator* allocator;         /* The allocator which governs this structure's lifetime. */
-    hmStringBuilder string_builder; /* The string builder which accumulates written data (used in hmStringWriterGetString(..)). */
+    hmAllocator*             allocator;      /* The allocator which governs this structure's lifetime. */
+    hmSegmentedStringBuilder string_builder; /* The string builder which accumulates written data (used in hmStringWriterGetString(..)).
+                                                Segmented, so that large outputs aren't copied over and over as they grow. */
 } hmStringWriterData;
 
 static hmError hmStringWriter_write(struct hmWriter_* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
 {
     hmStringWriterData* data = (hmStringWriterData*)writer->data;
-    hmError err = hmStringBuilderAppendCStringWithLength(&data->string_builder, buffer, size);
+    hmError err = hmSegmentedStringBuilderAppendCStringWithLength(&data->string_builder, buffer, size);
     if (err != HM_OK) {
         *out_bytes_written = 0;
         return err;
@@ -48,7 +96,7 @@ static hmError hmStringWriter_write(struct hmWriter_* writer, const char* buffer
 static hmError hmStringWriter_close(struct hmWriter_* writer)
 {
     hmStringWriterData* data = (hmStringWriterData*)writer->data;
-    hmError err = hmStringBuilderDispose(&data->string_builder);
+    hmError err = hmSegmentedStringBuilderDispose(&data->string_builder);
     hmFree(data->allocator, data);
     return err;
 }
@@ -59,7 +107,11 @@ hmError hmCreateStringWriter(hmAllocator* allocator, hmWriter* in_writer)
     if (!data) {
         return HM_ERROR_OUT_OF_MEMORY;
     }
-    hmError err = hmCreateStringBuilder(allocator, &data->string_builder);
+    hmError err = hmCreateSegmentedStringBuilder(
+        allocator,
+        HM_SEGMENTED_STRING_BUILDER_DEFAULT_SEGMENT_SIZE,
+        &data->string_builder
+    );
     if (err != HM_OK) {
         hmFree(allocator, data);
         return err;
@@ -67,6 +119,8 @@ hmError hmCreateStringWriter(hmAllocator* allocator, hmWriter* in_writer)
     data->allocator = allocator;
     in_writer->write = &hmStringWriter_write;
     in_writer->close = &hmStringWriter_close;
+    in_writer->write_vector_opt = HM_NULL;
+    in_writer->get_native_handle_opt = HM_NULL;
     in_writer->data = data;
     return HM_OK;
 }
@@ -74,5 +128,163 @@ hmError hmCreateStringWriter(hmAllocator* allocator, hmWriter* in_writer)
 hmError hmStringWriterGetString(hmWriter* writer, hmAllocator* allocator_opt, hmString* in_string)
 {
     hmStringWriterData* data = (hmStringWriterData*)writer->data;
-    return hmStringBuilderToString(&data->string_builder, allocator_opt, in_string);
+    return hmSegmentedStringBuilderToString(&data->string_builder, allocator_opt, in_string);
+}
+
+/* ********************* */
+/*    BufferedWriter.    */
+/* ********************* */
+
+typedef struct {
+    hmAllocator* allocator;          /* The allocator which governs this structure's lifetime. */
+    hmWriter     inner_writer;       /* The writer to which buffered data is written out. */
+    hm_bool      close_inner_writer; /* If true, the inner writer is closed when the buffered writer is closed. */
+    char*        buffer;             /* Buffered data lives in buffer[start_index:end_index) */
+    hm_nint      buffer_size;        /* Also serves as the high watermark. */
+    hm_nint      low_watermark;      /* See hmCreateBufferedWriter(..) */
+    hm_nint      start_index;        /* Data before `start_index` was already written out (after a partial write). */
+    hm_nint      end_index;          /* New data is appended at `end_index`. */
+} hmBufferedWriterData;
+
+/* Writes out buffered data until no more than `target_size` bytes remain in the buffer. */
+static hmError hmBufferedWriterDrain(hmBufferedWriterData* data, hm_nint target_size)
+{
+    /* No safe math because `start_index` never exceeds `end_index`, and `end_index` never exceeds `buffer_size`. */
+    while (data->end_index - data->start_index > target_size) {
+        hm_nint bytes_written = 0;
+        HM_TRY(hmWriterWrite(
+            &data->inner_writer,
+            data->buffer + data->start_index,
+            data->end_index - data->start_index,
+            &bytes_written
+        ));
+        if (!bytes_written) { /* the inner writer accepts no data, so the loop would never finish */
+            return HM_ERROR_INVALID_STATE;
+        }
+        if (bytes_written > data->end_index - data->start_index) { /* we don't know if the inner writer behaves correctly */
+            return HM_ERROR_OVERFLOW;
+        }
+        data->start_index += bytes_written;
+    }
+    if (data->start_index == data->end_index) {
+        data->start_index = 0;
+        data->end_index = 0;
+    }
+    return HM_OK;
+}
+
+/* Sends buffered data together with `buffer` (which is large) to the inner writer, without copying `buffer`. */
+static hmError hmBufferedWriterWriteThrough(hmBufferedWriterData* data, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
+{
+    /* No safe math because all the offsets are bounded by their buffer sizes (the checks below make sure of it). */
+    while (*out_bytes_written < size) {
+        hm_nint buffered_size = data->end_index - data->start_index;
+        hmWriterBuffer buffers[2] = {
+            {data->buffer + data->start_index, buffered_size},
+            {buffer + *out_bytes_written, size - *out_bytes_written}
+        };
+        hm_nint bytes_written = 0;
+        if (buffered_size) {
+            HM_TRY(hmWriterWriteVector(&data->inner_writer, buffers, 2, &bytes_written));
+        } else {
+            HM_TRY(hmWriterWrite(&data->inner_writer, buffers[1].chars, buffers[1].size, &bytes_written));
+        }
+        if (!bytes_written) { /* the inner writer accepts no data, so the loop would never finish */
+            return HM_ERROR_INVALID_STATE;
+        }
+        if (bytes_written > buffered_size + buffers[1].size) { /* we don't know if the inner writer behaves correctly */
+            return HM_ERROR_OVERFLOW;
+        }
+        if (bytes_written >= buffered_size) {
+            data->start_index = 0;
+            data->end_index = 0;
+            *out_bytes_written += bytes_written - buffered_size;
+        } else {
+            data->start_index += bytes_written;
+        }
+    }
+    return HM_OK;
+}
+
+static hmError hmBufferedWriter_write(struct hmWriter_* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
+{
+    hmBufferedWriterData* data = (hmBufferedWriterData*)writer->data;
+    *out_bytes_written = 0;
+    if (size >= data->buffer_size) {
+        return hmBufferedWriterWriteThrough(data, buffer, size, out_bytes_written);
+    }
+    /* No safe math below because `size` is smaller than `buffer_size`, and the indices never exceed `buffer_size`. */
+    if (size > data->buffer_size - data->end_index) {
+        if (size > data->buffer_size - (data->end_index - data->start_index)) { /* reached the high watermark */
+            hm_nint target_size = data->buffer_size - size;
+            HM_TRY(hmBufferedWriterDrain(data, target_size < data->low_watermark ? target_size : data->low_watermark));
+        }
+        /* Compacts the remainder of a partial write to the beginning of the buffer to make room at the end. */
+        if (data->start_index > 0) {
+            hmMoveMemory(data->buffer, data->buffer + data->start_index, data->end_index - data->start_index);
+            data->end_index -= data->start_index;
+            data->start_index = 0;
+        }
+    }
+    hmCopyMemory(data->buffer + data->end_index, buffer, size);
+    data->end_index += size;
+    *out_bytes_written = size;
+    return HM_OK;
+}
+
+static hmError hmBufferedWriter_close(struct hmWriter_* writer)
+{
+    hmBufferedWriterData* data = (hmBufferedWriterData*)writer->data;
+    hmError err = hmBufferedWriterDrain(data, 0);
+    if (data->close_inner_writer) {
+        err = hmMergeErrors(err, hmWriterClose(&data->inner_writer));
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateBufferedWriter(
+    hmAllocator* allocator,
+    hmWriter     inner_writer,
+    hm_bool      close_inner_writer,
+    hm_nint      buffer_size,
+    hm_nint      low_watermark,
+    hmWriter*    in_writer
+)
+{
+    if (!buffer_size || low_watermark >= buffer_size) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    /* The buffer is allocated together with the structure to save an allocation. */
+    hm_nint data_size = 0;
+    HM_TRY(hmAddNint(sizeof(hmBufferedWriterData), buffer_size, &data_size));
+    hmBufferedWriterData* data = (hmBufferedWriterData*)hmAlloc(allocator, data_size);
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    data->allocator = allocator;
+    data->inner_writer = inner_writer;
+    data->close_inner_writer = close_inner_writer;
+    data->buffer = (char*)(data + 1);
+    data->buffer_size = buffer_size;
+    data->low_watermark = low_watermark;
+    data->start_index = 0;
+    data->end_index = 0;
+    in_writer->write = &hmBufferedWriter_write;
+    in_writer->close = &hmBufferedWriter_close;
+    in_writer->write_vector_opt = HM_NULL;
+    in_writer->get_native_handle_opt = HM_NULL;
+    in_writer->data = data;
+    return HM_OK;
+}
+
+hmError hmBufferedWriterFlush(hmWriter* writer)
+{
+    return hmBufferedWriterDrain((hmBufferedWriterData*)writer->data, 0);
+}
+
+hm_nint hmBufferedWriterGetBufferedSize(hmWriter* writer)
+{
+    hmBufferedWriterData* data = (hmBufferedWriterData*)writer->data;
+    return data->end_index - data->start_index;
 }
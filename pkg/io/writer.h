@@ -19,16 +19,37 @@
 #include <core/string.h>
 
 #define HM_WRITER_DEFAULT_BUFFER_SIZE (4*1024) /* 4KB */
+#define HM_WRITER_MAX_BUFFER_COUNT    16       /* The maximum number of buffers written at once by hmWriterWriteVector(..) */
+
+/* A block of memory to be written with hmWriterWriteVector(..) */
+typedef struct {
+    const char* chars;
+    hm_nint     size;
+} hmWriterBuffer;
 
 /* Generic structure for any writer. Writers can be used to write to any medium: memory, sockets, files on disk, etc. */
 typedef struct hmWriter_ {
     hmError (*write)(struct hmWriter_* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written); /* Reads `size` number of bytes to `buffer`, returns `out_bytes_written`. */
     hmError (*close)(struct hmWriter_* writer);
+    hmError (*write_vector_opt)(struct hmWriter_* writer, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint* out_bytes_written); /* See hmWriterWriteVector(..) Can be HM_NULL. */
+    hmError (*get_native_handle_opt)(struct hmWriter_* writer, hm_nint* out_handle); /* See hmWriterGetNativeHandle(..) Can be HM_NULL. */
     void*     data;                                            /* Writer-specific data. */
 } hmWriter;
 
 /* Writes `size` number of bytes from `buffer`, returns `out_bytes_written`. */
 hmError hmWriterWrite(hmWriter* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written);
+/* Same as hmWriterWrite(..), except keeps writing until all `size` bytes are written (writers are allowed to accept data
+   partially, for example, non-blocking sockets). Returns HM_ERROR_INVALID_STATE if the writer stops accepting data. */
+hmError hmWriterWriteAll(hmWriter* writer, const char* buffer, hm_nint size);
+/* Writes several buffers one after another (a "gather" write), returns the total number of written bytes in `out_bytes_written`.
+   Writers backed by the operating system (files, sockets) do it in a single system call, which allows to send, say, a header
+   and a large payload together without first copying them to a contiguous buffer. Just like with hmWriterWrite(..), fewer
+   bytes than requested can be written. At most HM_WRITER_MAX_BUFFER_COUNT buffers are accepted.
+   If the writer doesn't support vectored writes natively, falls back to calling hmWriterWrite(..) for each buffer. */
+hmError hmWriterWriteVector(hmWriter* writer, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint* out_bytes_written);
+/* Same as hmReaderGetNativeHandle(..), but for writers. Buffering writers don't expose their handles, since writing
+   to the handle directly would reorder the data. */
+hmError hmWriterGetNativeHandle(hmWriter* writer, hm_nint* out_handle);
 /* Closes the writer, freeing all additional resources. */
 hmError hmWriterClose(hmWriter *writer);
 
@@ -40,4 +61,35 @@ hmError hmCreateStringWriter(hmAllocator* allocator, hmWriter* in_writer);
    The behavior is undefined if `writer` is not a string writer. */
 hmError hmStringWriterGetString(hmWriter* writer, hmAllocator* allocator_opt, hmString* in_string);
 
+/* Creates a buffered writer which wraps another writer `inner_writer` and accumulates small writes in an internal buffer
+   of `buffer_size` bytes, so that chatty producers end up issuing fewer (and larger) writes to `inner_writer`.
+   The buffer size acts as the high watermark: when a write doesn't fit in the buffer anymore, buffered data is written out
+   until no more than `low_watermark` bytes remain (`inner_writer` is allowed to accept data partially, for example,
+   a non-blocking socket), so that a slow medium doesn't make every write wait for the whole buffer to drain.
+   Writes which are at least as large as the buffer bypass it: they're sent to `inner_writer` together with buffered data
+   via hmWriterWriteVector(..), without copying.
+   Returns HM_ERROR_INVALID_ARGUMENT if `buffer_size` is 0 or `low_watermark` is not smaller than `buffer_size`.
+   Buffered data is written out on hmBufferedWriterFlush(..) and when the writer is closed. If `close_inner_writer` is set
+   to true, the buffered writer closes `inner_writer` when it's closed itself. */
+hmError hmCreateBufferedWriter(
+    hmAllocator* allocator,
+    hmWriter     inner_writer,
+    hm_bool      close_inner_writer,
+    hm_nint      buffer_size,
+    hm_nint      low_watermark,
+    hmWriter*    in_writer
+);
+/* Writes all buffered data to the inner writer.
+   The behavior is undefined if `writer` is not a buffered writer. */
+hmError hmBufferedWriterFlush(hmWriter* writer);
+/* Returns the number of bytes which are buffered and not yet written to the inner writer.
+   The behavior is undefined if `writer` is not a buffered writer. */
+hm_nint hmBufferedWriterGetBufferedSize(hmWriter* writer);
+/* Creates a writer which writes to the file at the given `path`. The file is created if it doesn't exist; otherwise, it's
+   truncated, unless `should_append` is set to true, in which case new data is appended to the end of the file.
+   Supports native vectored writes (see hmWriterWriteVector(..)). Writes are not buffered: wrap the writer with
+   hmCreateBufferedWriter(..) if there are many small writes. Returns HM_ERROR_ACCESS_DENIED if there are no permissions
+   to write to the file, and HM_ERROR_NOT_FOUND if its directory doesn't exist. */
+hmError hmCreateFileWriter(hmAllocator* allocator, hmString* path, hm_bool should_append, hmWriter* in_writer);
+
 #endif /* HM_WRITER_H */
@@ -16,7 +16,6 @@
 #include <core/string.h>
 #include <core/utils.h>
 #include <collections/array.h>
-#include <io/linereader.h>
 
 /* From RFC9112:
    "Although the request-line grammar rule requires that each of the component elements be separated by a single SP octet,
@@ -48,6 +47,8 @@
 #define HM_HTTP_VERSION_LITERAL " HTTP/1.1"
 #define HM_HTTP_VERSION_LITERAL_SIZE 9
 
+#define HM_CRLF_SIZE 2
+
 static hmError hmHTTPRequestParseRequestLineAndHeaderFields(hmHTTPRequest* request);
 #define hmIsHTTPWhitespace(ch) ((ch) == ' ' || (ch) == '\t')
 
@@ -114,14 +115,27 @@ hmError hmCreateHTTPRequestFromReaderAndReadBufferSize(
         }
         return err;
     }
+    /* The buffer must be able to hold the longest possible line, which is limited by `max_headers_size` anyway. */
+    err = hmCreateBufferedReader(
+        allocator,
+        reader,
+        HM_FALSE, /* close_source_reader = HM_FALSE, because the reader is closed separately depending on `close_reader` */
+        max_headers_size,
+        &in_request->buffered_reader
+    );
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmHashMapDispose(&in_request->headers));
+        if (close_reader) {
+            err = hmMergeErrors(err, hmReaderClose(&reader));
+        }
+        return err;
+    }
     in_request->allocator = allocator;
-    in_request->remaining_buffer = HM_NULL;
     in_request->reader = reader;
     in_request->close_reader = close_reader;
     in_request->method = HM_HTTP_METHOD_GET;
     in_request->max_headers_size = max_headers_size;
     in_request->read_buffer_size = read_buffer_size;
-    in_request->remaining_buffer_size = 0;
     in_request->is_body_reader_created = HM_FALSE;
     err = hmCreateEmptyStringView(&in_request->url); /* doesn't need to be disposed on error */
     /* Must be called the last because depends on the fields above. */
@@ -143,10 +157,7 @@ hmError hmHTTPRequestDispose(hmHTTPRequest* request)
     if (request->is_body_reader_created) {
         err = hmMergeErrors(err, hmReaderClose(&request->body_reader));
     }
-    if (request->remaining_buffer) {
-        hmFree(request->allocator, request->remaining_buffer);
-    }
-    return err;
+    return hmMergeErrors(err, hmBufferedReaderDispose(&request->buffered_reader));
 }
 
 hmReader* hmHTTPRequestGetBodyReaderRef(hmHTTPRequest* request)
@@ -363,124 +374,94 @@ static hmError hmHTTPRequestParseRequestLineOrHeaderField(hmHTTPRequest* request
     }
 }
 
-static hmError hmHTTPRequestOnNextReader(hm_nint previous_reader_index, void* context_opt)
+static hmError hmHTTPRequestCreateBodyReader(hmHTTPRequest* request)
 {
-    hmHTTPRequest* request = (hmHTTPRequest*)context_opt;
-    /* Immediately disposes of the remaining buffer once the first reader (memory reader) is fully read from,
-       to avoid having unused memory hanging around. */
-    if (previous_reader_index == 0) {
-        hmFree(request->allocator, request->remaining_buffer);
-        request->remaining_buffer = HM_NULL;
-        request->remaining_buffer_size = 0;
+    const char* chars = HM_NULL;
+    hm_nint buffered_size = 0;
+    hmBufferedReaderGetBuffered(&request->buffered_reader, &chars, &buffered_size);
+    if (!buffered_size) {
+        /* If nothing is left in the buffered reader, do not create a separate body reader: just use the original reader
+           for reading the body. See hmHTTPRequestGetBodyReaderRef(..)
+           This serves two purposes: 1) we avoid unnecessary allocations and indirections 2) the body is read directly
+           into the caller's buffer. */
+        return HM_OK;
     }
+    /* The body reader starts with what's left in the buffered reader after the headers, and then continues with the
+       original reader. */
+    HM_TRY(hmBufferedReaderCreateReader(&request->buffered_reader, request->allocator, &request->body_reader));
+    request->is_body_reader_created = HM_TRUE;
     return HM_OK;
 }
 
-static hmError hmHTTPRequestCreateBodyReader(hmHTTPRequest* request, hmLineReader* line_reader)
+/* Reads the next CRLF-terminated line (without the CRLF) into `in_line`, or returns HM_ERROR_INVALID_STATE if there are
+   no more lines. The line is parsed directly in the buffered reader's buffer, and only then copied into a string.
+  `total_size` accumulates the size of all the lines read so far, to enforce `max_headers_size`. */
+static hmError hmHTTPRequestReadLine(hmHTTPRequest* request, hm_nint* total_size, hmString* in_line)
 {
-    /* Copies what's left in hmLineReader's fixed-size buffer into hmHTTPRequest's own buffer so that reading  of raw
-       body could continue where hmLineReader left off. */
-    char* remaining_buffer = HM_NULL;
-    hm_nint remaining_buffer_size = 0;
-    HM_TRY(hmLineReaderGetBuffered(line_reader, &remaining_buffer, &remaining_buffer_size));
-    if (!remaining_buffer_size) {
-        /* If no remaining buffer is left around, do not create a separate body reader: just use the original reader
-           for reading the body. See hmHTTPRequestGetBodyReaderRef(..)
-           This serves two purposes: 1) we avoid unnecessary allocations and indirections 2) a memory reader of size 0
-           would stop any loop which expects `bytes_read == 0` to be a stop condition. */
-        return HM_OK;
-    }
-    request->remaining_buffer = hmAlloc(request->allocator, remaining_buffer_size);
-    if (!request->remaining_buffer) {
-        return HM_ERROR_OUT_OF_MEMORY;
-    }
-    hmCopyMemory(request->remaining_buffer, remaining_buffer, remaining_buffer_size);
-    request->remaining_buffer_size = remaining_buffer_size;
-    hmError err = HM_OK;
-    hmReader memory_reader;
-    hm_bool is_memory_reader_initialized = HM_FALSE;
-    HM_TRY_OR_FINALIZE(err, hmCreateMemoryReader(
-        request->allocator,
-        request->remaining_buffer,
-        request->remaining_buffer_size,
-        &memory_reader
-    ));
-    is_memory_reader_initialized = HM_TRUE;
-    hmReader source_readers[2] = {memory_reader, request->reader};
-    /* `memory_reader` is owned by the composite reader from now on.
-       `request->reader` is closed separately in hmHTTPRequestDispose(..), depending on `close_reader` from the constructor. */
-    hm_bool close_source_readers[2] = {HM_TRUE, HM_FALSE};
-    HM_TRY_OR_FINALIZE(err, hmCreateCompositeReader(
-        request->allocator,
-        source_readers,
-        close_source_readers,
-        2,
-        &hmHTTPRequestOnNextReader,
-        request,
-        &request->body_reader
-    ));
-    request->is_body_reader_created = HM_TRUE;
-HM_ON_FINALIZE
-    if (err != HM_OK) {
-        if (is_memory_reader_initialized) {
-            err = hmMergeErrors(err, hmReaderClose(&memory_reader));
+    hm_nint search_start_index = 0;
+    while (HM_TRUE) {
+        const char* chars = HM_NULL;
+        hm_nint buffered_size = 0;
+        hmBufferedReaderGetBuffered(&request->buffered_reader, &chars, &buffered_size);
+        /* Only "\r\n" ends a line: as per RFC9112, bare LFs are allowed inside fields, while bare CRs are rejected later
+           in hmHTTPRequestParseRequestLineOrHeaderField(..) */
+        for (hm_nint i = search_start_index; i + 1 < buffered_size; i++) { /* no safe math because `i < buffered_size` */
+            if (chars[i] == '\r' && chars[i + 1] == '\n') {
+                hm_nint line_size = 0;
+                HM_TRY(hmAddNint3(*total_size, i, HM_CRLF_SIZE, &line_size));
+                if (line_size > request->max_headers_size) {
+                    return HM_ERROR_LIMIT_EXCEEDED;
+                }
+                HM_TRY(hmCreateStringFromCStringWithLengthInBytes(request->allocator, chars, i, in_line));
+                *total_size = line_size;
+                return hmBufferedReaderConsume(&request->buffered_reader, i + HM_CRLF_SIZE);
+            }
+        }
+        hm_nint total_buffered_size = 0;
+        HM_TRY(hmAddNint(*total_size, buffered_size, &total_buffered_size));
+        if (total_buffered_size > request->max_headers_size) {
+            return HM_ERROR_LIMIT_EXCEEDED;
+        }
+        /* The last char can be a CR whose LF is yet to be read. */
+        search_start_index = buffered_size > 0 ? buffered_size - 1 : 0;
+        hm_nint bytes_read = 0;
+        HM_TRY(hmBufferedReaderFill(&request->buffered_reader, request->read_buffer_size, &bytes_read));
+        if (!bytes_read) { /* no more data: whatever is left forms the last line */
+            /* Fill(..) may have moved the buffered data to the start of the buffer, so `chars` must be fetched again. */
+            hmBufferedReaderGetBuffered(&request->buffered_reader, &chars, &buffered_size);
+            if (!buffered_size) {
+                return HM_ERROR_INVALID_STATE;
+            }
+            HM_TRY(hmCreateStringFromCStringWithLengthInBytes(request->allocator, chars, buffered_size, in_line));
+            *total_size = total_buffered_size;
+            return hmBufferedReaderConsume(&request->buffered_reader, buffered_size);
         }
-        hmFree(request->allocator, request->remaining_buffer);
-        request->remaining_buffer = HM_NULL;
-        request->remaining_buffer_size = 0;
     }
-    return err;
 }
 
 static hmError hmHTTPRequestParseRequestLineAndHeaderFields(hmHTTPRequest* request)
 {
-    hmReader limited_reader;
-    HM_TRY(hmCreateLimitedReader(
-        request->allocator,
-        request->reader,
-        HM_FALSE, /* close_source_reader = HM_FALSE, because the reader will continue to be used after parsing the headers */
-        request->max_headers_size,
-        &limited_reader
-    ));
-    char buffer[HM_HTTP_REQUEST_MAX_READ_BUFFER_SIZE];
-    hmLineReader line_reader;
-    hm_bool is_line_reader_initialized = HM_FALSE;
     hmError err = HM_OK;
-    HM_TRY_OR_FINALIZE(err, hmCreateLineReader(
-        request->allocator,
-        limited_reader,
-        HM_FALSE, /* close_source_reader = HM_FALSE, same as above */
-        buffer,
-        request->read_buffer_size,
-        HM_TRUE,  /* has_crlf_newlines = HM_TRUE, as per the HTTP protocol */
-        &line_reader
-    ));
-    is_line_reader_initialized = HM_TRUE;
-    hm_nint header_count = 0;
+    hm_nint header_count = 0, total_size = 0;
     hmString string;
-    while ((err = hmLineReaderReadLine(&line_reader, HM_NULL, &string)) == HM_OK) {
+    while ((err = hmHTTPRequestReadLine(request, &total_size, &string)) == HM_OK) {
         if (hmStringIsEmpty(&string)) { /* an empty string is a signal that the header part is over */
-            HM_TRY_OR_FINALIZE(err, hmStringDispose(&string));
-            HM_TRY_OR_FINALIZE(err, hmHTTPRequestCreateBodyReader(request, &line_reader));
+            HM_TRY(hmStringDispose(&string));
+            HM_TRY(hmHTTPRequestCreateBodyReader(request));
             break;
         }
         err = hmHTTPRequestParseRequestLineOrHeaderField(request, &string, header_count);
-        HM_TRY_OR_FINALIZE(err, hmStringDispose(&string)); /* in the HTTP request, derived strings (if any) are retained, not the original one */
-        HM_TRY_OR_FINALIZE(err, hmAddNint(header_count, 1, &header_count));
+        err = hmMergeErrors(err, hmStringDispose(&string)); /* in the HTTP request, derived strings (if any) are retained, not the original one */
+        HM_TRY(err);
+        HM_TRY(hmAddNint(header_count, 1, &header_count));
     }
-    /* According to the specification of hmLineReaderReadLine(..), error code HM_ERROR_INVALID_STATE tells that there
-       are no more lines in the line reader, so we convert it to HM_OK, because it's not actually an error as far as
-       this function is concerned. */
+    /* According to the specification of hmHTTPRequestReadLine(..), error code HM_ERROR_INVALID_STATE tells that there
+       are no more lines, so we convert it to HM_OK, because it's not actually an error as far as this function is concerned. */
     if (err == HM_ERROR_INVALID_STATE) {
         err = HM_OK;
     }
     if (err == HM_OK && header_count == 0) { /* no headers at all */
         err = HM_ERROR_INVALID_DATA;
     }
-    /* cppcheck-suppress unknownMacro */
-HM_ON_FINALIZE
-    if (is_line_reader_initialized) {
-        err = hmMergeErrors(err, hmLineReaderDispose(&line_reader));
-    }
-    return hmMergeErrors(err, hmReaderClose(&limited_reader));
+    return err;
 }
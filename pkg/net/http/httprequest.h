@@ -17,6 +17,7 @@
 #include <core/common.h>
 #include <core/string.h>
 #include <collections/hashmap.h>
+#include <io/bufferedreader.h>
 #include <io/reader.h>
 #include <net/http/common.h>
 
@@ -25,22 +26,21 @@
 #define HM_HTTP_REQUEST_MAX_READ_BUFFER_SIZE     (8*1024) /* See hmCreateHTTPRequestFromReader(..) */
 
 typedef struct {
-    hmAllocator* allocator;
-    char*        remaining_buffer;       /* When we switch from line reading to reading raw content, we need to remember
-                                           what's left in hmLineReader's buffer to keep reading where it left off.
-                                           See hmLineReaderGetBuffered(..) */
-    hmReader     reader;                 /* Stores the reader in order to:
-                                           1) create the body reader based on it via hmHTTPRequestCreateBodyReader(..)
-                                           2) dispose of it in hmHTTPRequestDispose(..), if enabled via `close_reader` */
-    hmReader     body_reader;            /* Returned by hmHTTPRequestGetBodyReaderRef(..) */
-    hmHashMap    headers;                /* hmHashMap<hmString, hmArray<hmString>>. Stores the list of parsed HTTP headers. */
-    hmString     url;                    /* URL of the request. */
-    hmHTTPMethod method;                 /* The HTTP method: GET, POST, PUT etc. */
-    hm_nint      max_headers_size;       /* The maximum size of all HTTP headers. */
-    hm_nint      read_buffer_size;       /* The internal buffer size used when reading. */
-    hm_nint      remaining_buffer_size;  /* Describes the size of `remaining_buffer`. */
-    hm_bool      close_reader;           /* Copied from the same argument in hmCreateHTTPRequestFromReader(..) (see). */
-    hm_bool      is_body_reader_created; /* Tells if `body_reader` is actually initialized. */
+    hmAllocator*     allocator;
+    hmReader         reader;                 /* Stores the reader in order to:
+                                               1) create the body reader based on it via hmHTTPRequestCreateBodyReader(..)
+                                               2) dispose of it in hmHTTPRequestDispose(..), if enabled via `close_reader` */
+    hmBufferedReader buffered_reader;        /* Wraps `reader` while the headers are parsed; after that, whatever is left in
+                                               it is the beginning of the body, which the body reader keeps reading from
+                                               in place, without copying. */
+    hmReader         body_reader;            /* Returned by hmHTTPRequestGetBodyReaderRef(..) */
+    hmHashMap        headers;                /* hmHashMap<hmString, hmArray<hmString>>. Stores the list of parsed HTTP headers. */
+    hmString         url;                    /* URL of the request. */
+    hmHTTPMethod     method;                 /* The HTTP method: GET, POST, PUT etc. */
+    hm_nint          max_headers_size;       /* The maximum size of all HTTP headers. */
+    hm_nint          read_buffer_size;       /* How many bytes are read from `reader` at once. */
+    hm_bool          close_reader;           /* Copied from the same argument in hmCreateHTTPRequestFromReader(..) (see). */
+    hm_bool          is_body_reader_created; /* Tells if `body_reader` is actually initialized. */
 } hmHTTPRequest;
 
 /* Creates an HTTP request by reading from the given `reader`.
@@ -35,8 +35,12 @@ hmError hmCreateServerSocket(
     hmServerSocket* in_socket
 );
 /* Blocks the current thread until a new connection is available. If it's available, returns a new socket object
-   which can be used on another thread. */
+   which can be used on another thread (the new socket isn't bound to a scheduler, see hmSocketSetScheduler(..)) */
 hmError hmServerSocketAccept(hmServerSocket* socket, hmAllocator* socket_allocator_opt, hmSocket* out_socket);
+/* Same as hmSocketSetScheduler(..), but for hmServerSocketAccept(..) While the server socket is bound to a scheduler,
+   it's non-blocking, so that a coroutine which was woken up for a connection which another thread or process has
+   already accepted parks again instead of blocking its thread. */
+hmError hmServerSocketSetScheduler(hmServerSocket* socket, hmScheduler* scheduler_opt);
 hmError hmServerSocketDispose(hmServerSocket* socket);
 
 #endif /* HM_SERVER_SOCKET_H */
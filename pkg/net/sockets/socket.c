@@ -24,6 +24,16 @@ static hmError hmSocketReader_read(hmReader* reader, char* buffer, hm_nint size,
     return hmSocketRead(data->socket, buffer, size, out_bytes_read);
 }
 
+static hmError hmSocketReader_get_native_handle(hmReader* reader, hm_nint* out_handle)
+{
+    hmSocketReaderData* data = (hmSocketReaderData*)reader->data;
+    if (hmSocketGetScheduler(data->socket)) {
+        return HM_ERROR_NOT_IMPLEMENTED; /* The kernel would block the scheduler's thread instead of parking the coroutine. */
+    }
+    *out_handle = hmSocketGetNativeHandle(data->socket);
+    return HM_OK;
+}
+
 static hmError hmSocketReader_close(hmReader* reader)
 {
     hmSocketReaderData* data = (hmSocketReaderData*)reader->data;
@@ -42,6 +52,59 @@ hmError hmSocketCreateReader(hmSocket* socket, hmAllocator* reader_allocator_opt
     data->socket = socket;
     in_reader->read = &hmSocketReader_read;
     in_reader->close = &hmSocketReader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = &hmSocketReader_get_native_handle;
     in_reader->data = data;
     return HM_OK;
 }
+
+typedef struct {
+    hmAllocator* allocator;
+    hmSocket*    socket;
+} hmSocketWriterData;
+
+static hmError hmSocketWriter_write(hmWriter* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
+{
+    hmSocketWriterData* data = (hmSocketWriterData*)writer->data;
+    return hmSocketSend(data->socket, buffer, size, out_bytes_written);
+}
+
+static hmError hmSocketWriter_write_vector(hmWriter* writer, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint* out_bytes_written)
+{
+    hmSocketWriterData* data = (hmSocketWriterData*)writer->data;
+    return hmSocketSendVector(data->socket, buffers, buffer_count, out_bytes_written);
+}
+
+static hmError hmSocketWriter_get_native_handle(hmWriter* writer, hm_nint* out_handle)
+{
+    hmSocketWriterData* data = (hmSocketWriterData*)writer->data;
+    if (hmSocketGetScheduler(data->socket)) {
+        return HM_ERROR_NOT_IMPLEMENTED; /* The kernel would block the scheduler's thread instead of parking the coroutine. */
+    }
+    *out_handle = hmSocketGetNativeHandle(data->socket);
+    return HM_OK;
+}
+
+static hmError hmSocketWriter_close(hmWriter* writer)
+{
+    hmSocketWriterData* data = (hmSocketWriterData*)writer->data;
+    hmFree(data->allocator, (char*)writer->data);
+    return HM_OK;
+}
+
+hmError hmSocketCreateWriter(hmSocket* socket, hmAllocator* writer_allocator_opt, hmWriter* in_writer)
+{
+    hmAllocator* allocator = writer_allocator_opt ? writer_allocator_opt : socket->allocator;
+    hmSocketWriterData* data = (hmSocketWriterData*)hmAlloc(allocator, sizeof(hmSocketWriterData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    data->allocator = allocator;
+    data->socket = socket;
+    in_writer->write = &hmSocketWriter_write;
+    in_writer->close = &hmSocketWriter_close;
+    in_writer->write_vector_opt = &hmSocketWriter_write_vector;
+    in_writer->get_native_handle_opt = &hmSocketWriter_get_native_handle;
+    in_writer->data = data;
+    return HM_OK;
+}
@@ -17,6 +17,8 @@
 #include <core/common.h>
 #include <core/string.h>
 #include <io/reader.h>
+#include <io/writer.h>
+#include <threading/scheduler.h>
 
 #define HM_SOCKET_MAX_TIMEOUT (60*60*1000) /* 1 hour must be more than enough */
 
@@ -28,7 +30,8 @@ typedef struct {
 /* A socket allows for two machines to communicate via the network, with the given `host` and `port`.
    `timeout_ms` specifies for how long to wait before hmSocketRead(..), hmSocketWrite(..) and other blocking functions
    return HM_ERROR_TIMEOUT (data can be partially read/written).
-   If it's 0, no timeout is set. Can't be greater than HM_SOCKET_MAX_TIMEOUT. */
+   If it's 0, no timeout is set. Can't be greater than HM_SOCKET_MAX_TIMEOUT.
+   See also hmSocketSetScheduler(..) to use the socket from coroutines. */
 hmError hmCreateSocket(
     hmAllocator* allocator,
     hmString*    host,
@@ -42,6 +45,9 @@ hmError hmCreateSocket(
    Returns HM_ERROR_TIMEOUT if `timeout_ms` of the socket (see hmCreateSocket(..)) is non-zero and it takes more
    time than `timeout_ms` milliseconds to write to the socket (data can be partially written). */
 hmError hmSocketSend(hmSocket* socket, const char* buffer, hm_nint size, hm_nint *out_bytes_sent_opt);
+/* Same as hmSocketSend(..), except sends several buffers one after another in a single system call (see hmWriterWriteVector(..)).
+   At most HM_WRITER_MAX_BUFFER_COUNT buffers are accepted. */
+hmError hmSocketSendVector(hmSocket* socket, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint *out_bytes_sent_opt);
 /* Reads the given number of bytes, specified as buffer[0:size) to the socket. The number of read bytes can be 0 --
    that means there's no more data in the socket.
    The function is synchronous (blocking).
@@ -50,6 +56,20 @@ hmError hmSocketSend(hmSocket* socket, const char* buffer, hm_nint size, hm_nint
 hmError hmSocketRead(hmSocket* socket, char* buffer, hm_nint size, hm_nint* out_bytes_read_opt);
 /* Returns the socket as a reader interface, to be able to read from a socket without knowing it's a socket. */
 hmError hmSocketCreateReader(hmSocket* socket, hmAllocator* reader_allocator_opt, hmReader* in_reader);
+/* Returns the socket as a writer interface, to be able to write to a socket without knowing it's a socket. Writes are not
+   buffered: wrap the writer with hmCreateBufferedWriter(..) to batch small writes. */
+hmError hmSocketCreateWriter(hmSocket* socket, hmAllocator* writer_allocator_opt, hmWriter* in_writer);
+/* Returns the operating system's handle of the socket (see hmReaderGetNativeHandle(..)) */
+hm_nint hmSocketGetNativeHandle(hmSocket* socket);
+/* Binds the socket to the scheduler (see hmScheduler): from then on, blocking functions park the calling coroutine
+   instead of blocking the whole thread (see hmSchedulerWaitForHandle(..)), so the socket must only be used from
+   coroutines of that scheduler (otherwise, functions which would block return HM_ERROR_INVALID_STATE). `timeout_ms`
+   still applies: a coroutine which stays parked for longer gets HM_ERROR_TIMEOUT. While the socket is bound, its reader
+   and writer don't expose the native handle, so that hmCopy(..) never blocks the thread in the kernel. HM_NULL unbinds
+   the socket, so that it could be used on any thread again. */
+void hmSocketSetScheduler(hmSocket* socket, hmScheduler* scheduler_opt);
+/* Returns the scheduler the socket is bound to (see hmSocketSetScheduler(..)), or HM_NULL. */
+hmScheduler* hmSocketGetScheduler(hmSocket* socket);
 hmError hmSocketDispose(hmSocket* socket);
 hmError hmSocketDisposeFunc(void* obj);
 
@@ -0,0 +1,137 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/codeheap.h>
+#include <core/format.h>
+#include <core/math.h>
+#include <core/utils.h>
+#include <platform/unix/common.h>
+
+#include <errno.h>    /* for errno */
+#include <fcntl.h>    /* for O_RDWR, O_CREAT, O_EXCL */
+#include <sys/mman.h> /* for mmap(..), munmap(..), memfd_create(..), shm_open(..) */
+#include <unistd.h>   /* for sysconf(..), ftruncate(..), close(..), getpid(..) */
+
+static hmError hmCodeHeapCreateSharedMemory(hmCodeHeap* code_heap, int* out_file_desc);
+static hmError hmCodeHeapRoundUp(hm_nint size, hm_nint alignment, hm_nint* out_size);
+
+hmError hmCreateCodeHeap(hm_nint capacity, hmCodeHeap* in_code_heap)
+{
+    if (!capacity) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) {
+        return hmUnixErrorToHammer(errno);
+    }
+    hm_nint mapping_size;
+    HM_TRY(hmCodeHeapRoundUp(capacity, (hm_nint)page_size, &mapping_size));
+    int file_desc = -1;
+    HM_TRY(hmCodeHeapCreateSharedMemory(in_code_heap, &file_desc));
+    hmError err = HM_OK;
+    void* base = MAP_FAILED;
+    void* writable_base = MAP_FAILED;
+    /* Memory is committed only for the pages which are actually written to. */
+    if (ftruncate(file_desc, (off_t)mapping_size) == -1) {
+        err = hmUnixErrorToHammer(errno);
+        HM_FINALIZE;
+    }
+    base = mmap(HM_NULL, mapping_size, PROT_READ | PROT_EXEC, MAP_SHARED, file_desc, 0);
+    if (base == MAP_FAILED) {
+        err = hmUnixErrorToHammer(errno);
+        HM_FINALIZE;
+    }
+    writable_base = mmap(HM_NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_desc, 0);
+    if (writable_base == MAP_FAILED) {
+        err = hmUnixErrorToHammer(errno);
+        HM_FINALIZE;
+    }
+    in_code_heap->base = (hm_uint8*)base;
+    in_code_heap->writable_base = (hm_uint8*)writable_base;
+    in_code_heap->capacity = capacity;
+    in_code_heap->mapping_size = mapping_size;
+    in_code_heap->size = 0;
+HM_ON_FINALIZE
+    if (err != HM_OK && base != MAP_FAILED) {
+        munmap(base, mapping_size);
+    }
+    /* The mappings keep the memory alive. */
+    if (close(file_desc) == -1 && err == HM_OK) {
+        err = hmUnixErrorToHammer(errno);
+        munmap(base, mapping_size);
+        munmap(writable_base, mapping_size);
+    }
+    return err;
+}
+
+hmError hmCodeHeapDispose(hmCodeHeap* code_heap)
+{
+    hmError err = HM_OK;
+    if (munmap(code_heap->base, code_heap->mapping_size) == -1) {
+        err = hmUnixErrorToHammer(errno);
+    }
+    if (munmap(code_heap->writable_base, code_heap->mapping_size) == -1) {
+        err = hmMergeErrors(err, hmUnixErrorToHammer(errno));
+    }
+    return err;
+}
+
+hmError hmCodeHeapAddCode(hmCodeHeap* code_heap, const hm_uint8* code, hm_nint size, void** out_code)
+{
+    hm_nint offset;
+    HM_TRY(hmCodeHeapRoundUp(code_heap->size, HM_CODE_HEAP_ALIGNMENT, &offset));
+    if (!size || offset > code_heap->capacity || size > code_heap->capacity - offset) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hmCopyMemory(code_heap->writable_base + offset, code, size);
+    hm_uint8* code_copy = code_heap->base + offset;
+    /* A no-op on x86, but required on architectures with incoherent instruction caches. */
+    __builtin___clear_cache((char*)code_copy, (char*)code_copy + size);
+    code_heap->size = offset + size;
+    *out_code = code_copy;
+    return HM_OK;
+}
+
+/* Anonymous memory can't be mapped twice, so the heap is backed by an unnamed shared memory object instead. */
+static hmError hmCodeHeapCreateSharedMemory(hmCodeHeap* code_heap, int* out_file_desc)
+{
+#ifdef __linux__
+    int file_desc = memfd_create("hammer-code-heap", MFD_CLOEXEC);
+#else
+    /* The name only has to be unique while the object is being created: it's unlinked right away. */
+    char name[sizeof("/hammer-code-heap--") + 2 * HM_FORMAT_BUFFER_SIZE];
+    hm_nint length = sizeof("/hammer-code-heap-") - 1;
+    hmCopyMemory(name, "/hammer-code-heap-", length);
+    length += hmFormatUint64((hm_uint64)getpid(), name + length);
+    name[length++] = '-';
+    length += hmFormatHex((hm_uint64)(hm_nint)code_heap, name + length);
+    name[length] = 0;
+    int file_desc = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (file_desc != -1) {
+        shm_unlink(name);
+    }
+#endif
+    if (file_desc == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    *out_file_desc = file_desc;
+    return HM_OK;
+}
+
+static hmError hmCodeHeapRoundUp(hm_nint size, hm_nint alignment, hm_nint* out_size)
+{
+    hm_nint rounded_size;
+    HM_TRY(hmAddNint(size, alignment - 1, &rounded_size));
+    *out_size = rounded_size - rounded_size % alignment;
+    return HM_OK;
+}
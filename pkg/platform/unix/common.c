@@ -26,9 +26,12 @@ hmError hmUnixErrorToHammer(int unix_err)
         case EAGAIN:
             return HM_ERROR_TIMEOUT;
         case ENETUNREACH:
+        case ENOENT:
             return HM_ERROR_NOT_FOUND;
         case ECONNREFUSED:
         case EADDRINUSE:
+        case EACCES:
+        case EPERM:
             return HM_ERROR_ACCESS_DENIED;
         case ECONNRESET:
         case EPIPE:
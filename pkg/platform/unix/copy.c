@@ -0,0 +1,166 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <io/copy.h>
+#include <core/math.h>
+#include <platform/unix/common.h>
+
+#include <errno.h>        /* for errno */
+#include <sys/stat.h>     /* for fstat(..) */
+
+#ifdef __linux__
+#include <fcntl.h>        /* for splice(..) */
+#include <sys/sendfile.h> /* for sendfile(..) */
+#include <sys/socket.h>   /* for send(..) */
+#include <unistd.h>       /* for pipe2(..), read(..), close(..) */
+
+#define HM_COPY_MAX_NATIVE_CHUNK_SIZE (1024*1024*1024) /* 1GB: Linux transfers at most ~2GB per call anyway */
+#define HM_COPY_SPLICE_CHUNK_SIZE     (64*1024)        /* 64KB: the default capacity of a pipe */
+#define HM_COPY_DRAIN_BUFFER_SIZE     (4*1024)         /* See hmCopyDrainPipe(..) */
+
+static hmError hmCopyWithSendFile(int in_file_desc, int out_file_desc, hm_nint* out_bytes_copied);
+static hmError hmCopyWithSplice(int in_file_desc, int out_file_desc, hm_nint* out_bytes_copied);
+static hmError hmCopyDrainPipe(int pipe_file_desc, int out_file_desc, hm_nint size);
+#endif
+
+hmError hmCopyNatively(hmReader* reader, hmWriter* writer, hm_nint* out_bytes_copied)
+{
+    *out_bytes_copied = 0;
+#ifdef __linux__
+    hm_nint in_handle = 0, out_handle = 0;
+    HM_TRY(hmReaderGetNativeHandle(reader, &in_handle));
+    HM_TRY(hmWriterGetNativeHandle(writer, &out_handle));
+    int in_file_desc = (int)in_handle, out_file_desc = (int)out_handle;
+    struct stat in_stat, out_stat;
+    if (fstat(in_file_desc, &in_stat) == -1 || fstat(out_file_desc, &out_stat) == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    if (S_ISREG(in_stat.st_mode) && (S_ISSOCK(out_stat.st_mode) || S_ISREG(out_stat.st_mode))) {
+        return hmCopyWithSendFile(in_file_desc, out_file_desc, out_bytes_copied);
+    }
+    if (S_ISSOCK(in_stat.st_mode) && S_ISSOCK(out_stat.st_mode)) {
+        return hmCopyWithSplice(in_file_desc, out_file_desc, out_bytes_copied);
+    }
+#endif
+    return HM_ERROR_NOT_IMPLEMENTED;
+}
+
+#ifdef __linux__
+/* sendfile(..) reads from the current file offset and advances it, just like read(..) does, so the reader's state stays
+   consistent. */
+static hmError hmCopyWithSendFile(int in_file_desc, int out_file_desc, hm_nint* out_bytes_copied)
+{
+    while (HM_TRUE) {
+        ssize_t bytes_sent = sendfile(out_file_desc, in_file_desc, HM_NULL, HM_COPY_MAX_NATIVE_CHUNK_SIZE);
+        if (bytes_sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* Some file systems and older kernels don't support sendfile(..) for certain kinds of files; nothing was copied
+               yet, so hmCopy(..) can safely fall back to buffered copying. */
+            if (*out_bytes_copied == 0 && (errno == EINVAL || errno == ENOSYS)) {
+                return HM_ERROR_NOT_IMPLEMENTED;
+            }
+            return hmUnixErrorToHammer(errno);
+        }
+        if (bytes_sent == 0) {
+            return HM_OK;
+        }
+        HM_TRY(hmAddNint(*out_bytes_copied, (hm_nint)bytes_sent, out_bytes_copied));
+    }
+}
+
+/* splice(..) requires one of the ends to be a pipe, so the data is moved socket => pipe => socket (the pages are moved
+   between kernel buffers without copying). */
+static hmError hmCopyWithSplice(int in_file_desc, int out_file_desc, hm_nint* out_bytes_copied)
+{
+    int pipe_file_descs[2];
+    if (pipe2(pipe_file_descs, O_CLOEXEC) == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    hmError err = HM_OK;
+    while (HM_TRUE) {
+        ssize_t bytes_in_pipe = splice(in_file_desc, HM_NULL, pipe_file_descs[1], HM_NULL, HM_COPY_SPLICE_CHUNK_SIZE, SPLICE_F_MOVE);
+        if (bytes_in_pipe == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err = (*out_bytes_copied == 0 && (errno == EINVAL || errno == ENOSYS)) ? HM_ERROR_NOT_IMPLEMENTED : hmUnixErrorToHammer(errno);
+            HM_FINALIZE;
+        }
+        if (bytes_in_pipe == 0) {
+            break;
+        }
+        /* Drains the pipe completely, otherwise the data would be lost. The chunk is counted only once it's written
+           completely (see hmCopy(..)) */
+        hm_nint chunk_size = (hm_nint)bytes_in_pipe;
+        hm_bool is_splice_supported = HM_TRUE;
+        while (bytes_in_pipe > 0 && is_splice_supported) {
+            ssize_t bytes_sent = splice(pipe_file_descs[0], HM_NULL, out_file_desc, HM_NULL, (size_t)bytes_in_pipe, SPLICE_F_MOVE);
+            if (bytes_sent == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EINVAL && errno != ENOSYS) {
+                    err = hmUnixErrorToHammer(errno);
+                    HM_FINALIZE;
+                }
+                is_splice_supported = HM_FALSE;
+            } else {
+                bytes_in_pipe -= bytes_sent;
+            }
+        }
+        /* The data was already taken from the reader, so it can't be left for the fallback in hmCopy(..) */
+        if (!is_splice_supported) {
+            HM_TRY_OR_FINALIZE(err, hmCopyDrainPipe(pipe_file_descs[0], out_file_desc, (hm_nint)bytes_in_pipe));
+        }
+        HM_TRY_OR_FINALIZE(err, hmAddNint(*out_bytes_copied, chunk_size, out_bytes_copied));
+        if (!is_splice_supported) {
+            err = HM_ERROR_NOT_IMPLEMENTED; /* hmCopy(..) copies the rest through user space. */
+            HM_FINALIZE;
+        }
+    }
+HM_ON_FINALIZE
+    close(pipe_file_descs[0]);
+    close(pipe_file_descs[1]);
+    return err;
+}
+
+/* Used when the writer's end doesn't support splice(..): moves what's left in the pipe through a small user space buffer. */
+static hmError hmCopyDrainPipe(int pipe_file_desc, int out_file_desc, hm_nint size)
+{
+    char buffer[HM_COPY_DRAIN_BUFFER_SIZE];
+    while (size > 0) {
+        ssize_t bytes_read = read(pipe_file_desc, buffer, size < sizeof(buffer) ? size : sizeof(buffer));
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return hmUnixErrorToHammer(errno);
+        }
+        size -= (hm_nint)bytes_read;
+        for (ssize_t offset = 0; offset < bytes_read;) {
+            /* MSG_NOSIGNAL: an abruptly closed connection must return an error rather than raise SIGPIPE. */
+            ssize_t bytes_written = send(out_file_desc, buffer + offset, (size_t)(bytes_read - offset), MSG_NOSIGNAL);
+            if (bytes_written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return hmUnixErrorToHammer(errno);
+            }
+            offset += bytes_written;
+        }
+    }
+    return HM_OK;
+}
+#endif
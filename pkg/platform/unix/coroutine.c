@@ -0,0 +1,248 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <threading/coroutine.h>
+#include <core/math.h>
+#include <platform/unix/common.h>
+
+#include <errno.h>    /* for errno */
+#include <sys/mman.h> /* for mmap(..), munmap(..), mprotect(..) */
+#include <unistd.h>   /* for sysconf(..) */
+
+/* AddressSanitizer must be told about stack switches, otherwise it reports false positives. */
+#if defined(__SANITIZE_ADDRESS__)
+    #include <sanitizer/common_interface_defs.h> /* for __sanitizer_start_switch_fiber(..) & Co. */
+    #define HM_COROUTINE_START_SWITCH(fake_stack_save, bottom, size) __sanitizer_start_switch_fiber((fake_stack_save), (bottom), (size))
+    #define HM_COROUTINE_FINISH_SWITCH(fake_stack_save, out_bottom, out_size) __sanitizer_finish_switch_fiber((fake_stack_save), (out_bottom), (out_size))
+#else
+    #define HM_COROUTINE_START_SWITCH(fake_stack_save, bottom, size) (void)(fake_stack_save)
+    #define HM_COROUTINE_FINISH_SWITCH(fake_stack_save, out_bottom, out_size) (void)(fake_stack_save)
+#endif
+
+typedef struct {
+    hmAllocator*     allocator;
+    hmCoroutineFunc  coroutine_func;
+    void*            user_data;
+    hm_uint8*        stack_base;         /* The start of the mapped region (the guard page). */
+    hm_nint          stack_region_size;  /* The size of the mapped region, including the guard page. */
+    hm_nint          guard_size;
+    void*            stack_pointer;      /* The saved stack pointer of the coroutine while it's suspended. */
+    void*            caller_stack_pointer; /* The saved stack pointer of the thread while the coroutine is running. */
+    hmCoroutineState state;
+    hmError          exit_err;
+    void*            fake_stack;         /* for AddressSanitizer */
+    const void*      caller_stack_bottom; /* for AddressSanitizer */
+    size_t           caller_stack_size;   /* for AddressSanitizer */
+} hmCoroutinePlatformData;
+
+#define hmCoroutineGetPlatformData(coroutine) ((hmCoroutinePlatformData*)(coroutine)->platform_data)
+
+#if defined(__x86_64__)
+
+/* The number of 8-byte slots hmSwitchCoroutineContext(..) pushes (see below): 6 callee-saved registers, and MXCSR
+   together with the x87 control word. */
+#define HM_COROUTINE_SAVED_SLOT_COUNT 7
+#define HM_COROUTINE_DEFAULT_MXCSR    0x1F80 /* All exceptions masked, round to nearest. */
+#define HM_COROUTINE_DEFAULT_X87_CW   0x037F /* All exceptions masked, round to nearest, extended precision. */
+
+/* Saves the callee-saved state of the System V x86-64 ABI on the current stack, stores the stack pointer to
+   `*out_stack_pointer`, switches to `stack_pointer` and restores the state saved there. Everything else is saved
+   by the caller anyway, because this is a normal function call from the compiler's point of view. */
+void hmSwitchCoroutineContext(void** out_stack_pointer, void* stack_pointer);
+/* The first return address of a new coroutine: it receives the platform data in r12 (see hmCreateCoroutine(..)) */
+void hmCoroutineTrampoline();
+void hmCoroutineEntry(hmCoroutinePlatformData* platform_data);
+
+__asm__(
+    ".text\n"
+    ".globl hmSwitchCoroutineContext\n"
+    ".hidden hmSwitchCoroutineContext\n"
+    ".type hmSwitchCoroutineContext, @function\n"
+    "hmSwitchCoroutineContext:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size hmSwitchCoroutineContext, .-hmSwitchCoroutineContext\n"
+    ".globl hmCoroutineTrampoline\n"
+    ".hidden hmCoroutineTrampoline\n"
+    ".type hmCoroutineTrampoline, @function\n"
+    "hmCoroutineTrampoline:\n"
+    "    movq %r12, %rdi\n"
+    "    callq hmCoroutineEntry\n"
+    "    ud2\n" /* hmCoroutineEntry(..) never returns. */
+    ".size hmCoroutineTrampoline, .-hmCoroutineTrampoline\n"
+);
+
+static void hmCoroutineInitStack(hmCoroutinePlatformData* platform_data)
+{
+    /* The initial frame looks as if hmSwitchCoroutineContext(..) was called from the beginning of hmCoroutineTrampoline(..),
+       with the stack aligned so that the trampoline's call happens with a 16-byte aligned stack, as the ABI requires. */
+    hm_uint64* stack_top = (hm_uint64*)(platform_data->stack_base + platform_data->stack_region_size);
+    hm_uint64* slots = stack_top - (HM_COROUTINE_SAVED_SLOT_COUNT + 1);
+    slots[0] = (hm_uint64)HM_COROUTINE_DEFAULT_MXCSR | ((hm_uint64)HM_COROUTINE_DEFAULT_X87_CW << 32);
+    slots[1] = 0;                                /* r15 */
+    slots[2] = 0;                                /* r14 */
+    slots[3] = 0;                                /* r13 */
+    slots[4] = (hm_uint64)(uintptr_t)platform_data; /* r12 */
+    slots[5] = 0;                                /* rbx */
+    slots[6] = 0;                                /* rbp */
+    slots[7] = (hm_uint64)(uintptr_t)&hmCoroutineTrampoline; /* the return address */
+    platform_data->stack_pointer = slots;
+}
+
+void hmCoroutineEntry(hmCoroutinePlatformData* platform_data)
+{
+    HM_COROUTINE_FINISH_SWITCH(HM_NULL, &platform_data->caller_stack_bottom, &platform_data->caller_stack_size);
+    platform_data->exit_err = platform_data->coroutine_func(platform_data->user_data);
+    platform_data->state = HM_COROUTINE_STATE_FINISHED;
+    /* The coroutine's stack is never returned to, so AddressSanitizer can forget about its fake stack. */
+    HM_COROUTINE_START_SWITCH(HM_NULL, platform_data->caller_stack_bottom, platform_data->caller_stack_size);
+    hmSwitchCoroutineContext(&platform_data->stack_pointer, platform_data->caller_stack_pointer);
+}
+
+#endif /* defined(__x86_64__) */
+
+hmError hmCreateCoroutine(
+    hmAllocator*    allocator,
+    hm_nint         stack_size,
+    hmCoroutineFunc coroutine_func,
+    void*           user_data,
+    hmCoroutine*    in_coroutine
+)
+{
+#if defined(__x86_64__)
+    if (stack_size < HM_COROUTINE_MIN_STACK_SIZE || stack_size > HM_COROUTINE_MAX_STACK_SIZE) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) {
+        return hmUnixErrorToHammer(errno);
+    }
+    hm_nint stack_region_size;
+    HM_TRY(hmAddNint(stack_size, (hm_nint)page_size * 2 - 1, &stack_region_size)); /* +1 page for the guard page */
+    stack_region_size -= stack_region_size % (hm_nint)page_size;
+    hmCoroutinePlatformData* platform_data = (hmCoroutinePlatformData*)hmAlloc(allocator, sizeof(hmCoroutinePlatformData));
+    if (!platform_data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    /* MAP_NORESERVE: memory is committed only for the pages which are actually touched, so stacks effectively grow on demand. */
+    void* stack_base = mmap(HM_NULL, stack_region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stack_base == MAP_FAILED) {
+        hmFree(allocator, platform_data);
+        return hmUnixErrorToHammer(errno);
+    }
+    /* The stack grows down, so the guard page is at the start of the region. */
+    if (mprotect(stack_base, (hm_nint)page_size, PROT_NONE) == -1) {
+        hmError err = hmUnixErrorToHammer(errno);
+        munmap(stack_base, stack_region_size);
+        hmFree(allocator, platform_data);
+        return err;
+    }
+    platform_data->allocator = allocator;
+    platform_data->coroutine_func = coroutine_func;
+    platform_data->user_data = user_data;
+    platform_data->stack_base = (hm_uint8*)stack_base;
+    platform_data->stack_region_size = stack_region_size;
+    platform_data->guard_size = (hm_nint)page_size;
+    platform_data->caller_stack_pointer = HM_NULL;
+    platform_data->state = HM_COROUTINE_STATE_SUSPENDED;
+    platform_data->exit_err = HM_OK;
+    platform_data->fake_stack = HM_NULL;
+    platform_data->caller_stack_bottom = HM_NULL;
+    platform_data->caller_stack_size = 0;
+    hmCoroutineInitStack(platform_data);
+    in_coroutine->platform_data = platform_data;
+    return HM_OK;
+#else
+    return HM_ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+hmError hmCoroutineDispose(hmCoroutine* coroutine)
+{
+    hmCoroutinePlatformData* platform_data = hmCoroutineGetPlatformData(coroutine);
+    if (platform_data->state == HM_COROUTINE_STATE_RUNNING) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    hmError err = munmap(platform_data->stack_base, platform_data->stack_region_size) == -1 ? hmUnixErrorToHammer(errno) : HM_OK;
+    hmFree(platform_data->allocator, platform_data);
+    return err;
+}
+
+hmError hmCoroutineResume(hmCoroutine* coroutine)
+{
+#if defined(__x86_64__)
+    hmCoroutinePlatformData* platform_data = hmCoroutineGetPlatformData(coroutine);
+    if (platform_data->state != HM_COROUTINE_STATE_SUSPENDED) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    platform_data->state = HM_COROUTINE_STATE_RUNNING;
+    void* fake_stack = HM_NULL;
+    HM_COROUTINE_START_SWITCH(&fake_stack, platform_data->stack_base + platform_data->guard_size,
+                              platform_data->stack_region_size - platform_data->guard_size);
+    hmSwitchCoroutineContext(&platform_data->caller_stack_pointer, platform_data->stack_pointer);
+    HM_COROUTINE_FINISH_SWITCH(fake_stack, HM_NULL, HM_NULL);
+    if (platform_data->state == HM_COROUTINE_STATE_RUNNING) {
+        platform_data->state = HM_COROUTINE_STATE_SUSPENDED;
+    }
+    return HM_OK;
+#else
+    (void)coroutine;
+    return HM_ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+hmError hmCoroutineYield(hmCoroutine* coroutine)
+{
+#if defined(__x86_64__)
+    hmCoroutinePlatformData* platform_data = hmCoroutineGetPlatformData(coroutine);
+    if (platform_data->state != HM_COROUTINE_STATE_RUNNING) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    HM_COROUTINE_START_SWITCH(&platform_data->fake_stack, platform_data->caller_stack_bottom, platform_data->caller_stack_size);
+    hmSwitchCoroutineContext(&platform_data->stack_pointer, platform_data->caller_stack_pointer);
+    HM_COROUTINE_FINISH_SWITCH(platform_data->fake_stack, &platform_data->caller_stack_bottom, &platform_data->caller_stack_size);
+    return HM_OK;
+#else
+    (void)coroutine;
+    return HM_ERROR_INVALID_STATE;
+#endif
+}
+
+hmCoroutineState hmCoroutineGetState(hmCoroutine* coroutine)
+{
+    return hmCoroutineGetPlatformData(coroutine)->state;
+}
+
+hmError hmCoroutineGetExitError(hmCoroutine* coroutine)
+{
+    return hmCoroutineGetPlatformData(coroutine)->exit_err;
+}
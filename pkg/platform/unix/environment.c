@@ -13,14 +13,16 @@
 
 #include <core/environment.h>
 #include <core/allocator.h>
+#include <core/format.h>
 #include <core/math.h>
 #include <core/stringbuilder.h>
+#include <core/utils.h>
 #include <platform/unix/common.h>
 
+#include <dirent.h>      /* for opendir(..), readdir(..), closedir(..) */
 #include <errno.h>       /* for errno */
 #include <fcntl.h>       /* for open(..), read(..), close(..), O_RDONLY */
-#include <inttypes.h>    /* for PRId32 */
-#include <stdio.h>       /* for sprintf(..) */
+#include <sched.h>       /* for sched_getaffinity(..), cpu_set_t */
 #include <stdlib.h>      /* for getenv(..) */
 #include <sys/utsname.h> /* for uname(..) */
 #include <unistd.h>      /* for sysconf(..), _SC_NPROCESSORS_ONLN and getpid(..) */
@@ -29,6 +31,8 @@
 #define HM_EXECUTABLE_FILE_PATH_BUFFER_SIZE 1024
 #define HM_SYSTEM_FILE_NAME_BUFFER_SIZE 64
 #define HM_OS_VERSION_BUFFER_SIZE 512
+#define HM_PROCESSOR_DIRECTORY_PREFIX "/sys/devices/system/cpu/cpu"
+#define HM_NODE_ENTRY_PREFIX "node"
 
 static hmError hmFormatWithCurrentProcessId(
     hmAllocator* allocator,
@@ -36,6 +40,7 @@ static hmError hmFormatWithCurrentProcessId(
     const char* before_part,
     const char* after_part
 );
+static hm_nint hmGetProcessorNode(hm_nint processor_index);
 
 hm_millis hmGetTickCount()
 {
@@ -56,6 +61,30 @@ hm_nint hmGetProcessorCount()
 #endif /* _SC_NPROCESSORS_ONLN */
 }
 
+hmError hmGetAvailableProcessors(hmAllocator* allocator, hmArray* in_array)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    HM_TRY(hmCreateArray(allocator, sizeof(hmProcessorInfo), (hm_nint)CPU_COUNT(&cpu_set), HM_NULL, in_array));
+    hmError err = HM_OK;
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &cpu_set)) {
+            hmProcessorInfo processor_info;
+            processor_info.index = (hm_nint)i;
+            processor_info.node = hmGetProcessorNode((hm_nint)i);
+            HM_TRY_OR_FINALIZE(err, hmArrayAdd(in_array, &processor_info));
+        }
+    }
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmArrayDispose(in_array));
+    }
+    return err;
+}
+
 hm_nint hmGetAvailableMemory()
 {
     long pages = sysconf(_SC_PHYS_PAGES);
@@ -213,19 +242,46 @@ static hmError hmFormatWithCurrentProcessId(
     hmStringBuilder string_builder;
     HM_TRY(hmCreateStringBuilder(&buffer_allocator, &string_builder));
     hmError err = HM_OK;
-    hmString format;
-    hm_bool is_format_initialized = HM_FALSE;
-    HM_TRY_OR_FINALIZE(err, hmStringBuilderAppendCStrings(&string_builder, before_part, "%", PRId32, after_part, HM_NULL));
-    HM_TRY_OR_FINALIZE(err, hmStringBuilderToString(&string_builder, &buffer_allocator, &format));
-    is_format_initialized = HM_TRUE;
     pid_t process_id = getpid();
-    /* Not quite portable to cast pid_t to int32, but in GCC it's an integer and it's very unlikely
-       to be larger than int32. However, if this invariant is not upheld, we may end up reading arguments
-       of a different, unrelated process if there's a wraparound. */
-    sprintf(buffer, hmStringGetCString(&format), (hm_int32)process_id);
-HM_ON_FINALIZE
-    if (is_format_initialized) {
-        err = hmMergeErrors(err, hmStringDispose(&format));
+    HM_TRY_OR_FINALIZE(err, hmStringBuilderAppendCString(&string_builder, before_part));
+    HM_TRY_OR_FINALIZE(err, hmStringBuilderAppendInt(&string_builder, (hm_int64)process_id));
+    HM_TRY_OR_FINALIZE(err, hmStringBuilderAppendCString(&string_builder, after_part));
+    hm_nint length_in_bytes = hmStringBuilderGetLengthInBytes(&string_builder);
+    if (length_in_bytes >= HM_SYSTEM_FILE_NAME_BUFFER_SIZE) { /* leaves space for the null terminator */
+        err = HM_ERROR_LIMIT_EXCEEDED;
+        HM_FINALIZE;
     }
+    hmCopyMemory(buffer, hmStringBuilderGetChars(&string_builder), length_in_bytes);
+    buffer[length_in_bytes] = '\0'; /* null terminator */
+HM_ON_FINALIZE
     return hmMergeErrors(err, hmStringBuilderDispose(&string_builder));
 }
+
+/* Linux exposes the NUMA node of a processor as a "nodeN" entry in the processor's sysfs directory. */
+static hm_nint hmGetProcessorNode(hm_nint processor_index)
+{
+    char path[HM_SYSTEM_FILE_NAME_BUFFER_SIZE];
+    hm_nint prefix_length = sizeof(HM_PROCESSOR_DIRECTORY_PREFIX) - 1;
+    hmCopyMemory(path, HM_PROCESSOR_DIRECTORY_PREFIX, prefix_length);
+    hm_nint index_length = hmFormatUint64(processor_index, path + prefix_length); /* the prefix leaves space for HM_FORMAT_BUFFER_SIZE */
+    path[prefix_length + index_length] = '\0'; /* null terminator */
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return 0; /* No NUMA information (for example, sysfs isn't mounted), so we assume there's only one node. */
+    }
+    hm_nint node = 0;
+    hm_nint node_prefix_length = sizeof(HM_NODE_ENTRY_PREFIX) - 1;
+    struct dirent* entry = HM_NULL;
+    while ((entry = readdir(dir)) != HM_NULL) {
+        const char* name = entry->d_name;
+        if (hmCompareMemory(name, HM_NODE_ENTRY_PREFIX, node_prefix_length) != 0 || name[node_prefix_length] < '0' || name[node_prefix_length] > '9') {
+            continue;
+        }
+        for (const char* c = name + node_prefix_length; *c >= '0' && *c <= '9'; c++) {
+            node = node * 10 + (hm_nint)(*c - '0');
+        }
+        break;
+    }
+    (void)closedir(dir); /* Nothing to do if it fails: the directory was only read. */
+    return node;
+}
@@ -0,0 +1,52 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <core/nativelibrary.h>
+#include <platform/unix/common.h>
+
+#include <dlfcn.h>  /* for dlopen(..), dlsym(..), dlclose(..) */
+#include <errno.h>  /* for errno */
+#include <unistd.h> /* for access(..) */
+
+hmError hmLoadNativeLibrary(hmString* path, hmNativeLibrary* in_library)
+{
+    const char* c_path = hmStringGetCString(path);
+    /* dlopen(..) doesn't report why it failed other than as a message. */
+    if (access(c_path, F_OK) == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    void* handle = dlopen(c_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    in_library->handle = handle;
+    return HM_OK;
+}
+
+hmError hmNativeLibraryDispose(hmNativeLibrary* library)
+{
+    if (dlclose(library->handle) != 0) {
+        return HM_ERROR_PLATFORM_DEPENDENT;
+    }
+    return HM_OK;
+}
+
+hmError hmNativeLibraryGetSymbol(hmNativeLibrary* library, const char* name, void** out_symbol)
+{
+    void* symbol = dlsym(library->handle, name);
+    if (!symbol) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    *out_symbol = symbol;
+    return HM_OK;
+}
@@ -0,0 +1,217 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <io/reader.h>
+#include <core/allocator.h>
+#include <core/utils.h>
+#include <platform/unix/common.h>
+
+#include <errno.h>    /* for errno */
+#include <fcntl.h>    /* for open(..), posix_fadvise(..), O_RDONLY, O_CLOEXEC */
+#include <sys/mman.h> /* for mmap(..), munmap(..), madvise(..) */
+#include <sys/stat.h> /* for fstat(..) */
+#include <unistd.h>   /* for read(..), close(..), lseek(..) */
+
+static hmError hmOpenFileForReading(hmString* path, int* out_file_desc);
+
+/* ***************** */
+/*    FileReader.    */
+/* ***************** */
+
+typedef struct {
+    hmAllocator* allocator; /* The allocator which governs this structure's lifetime. */
+    int          file_desc; /* The file descriptor of the opened file. */
+} hmFileReaderData;
+
+static hmError hmFileReader_read(hmReader* reader, char* buffer, hm_nint size, hm_nint* out_bytes_read)
+{
+    hmFileReaderData* data = (hmFileReaderData*)reader->data;
+    ssize_t bytes_read = 0;
+    do {
+        bytes_read = read(data->file_desc, buffer, size);
+    } while (bytes_read == -1 && errno == EINTR);
+    if (bytes_read == -1) {
+        *out_bytes_read = 0;
+        return hmUnixErrorToHammer(errno);
+    }
+    *out_bytes_read = (hm_nint)bytes_read;
+    return HM_OK;
+}
+
+static hmError hmFileReader_get_native_handle(hmReader* reader, hm_nint* out_handle)
+{
+    hmFileReaderData* data = (hmFileReaderData*)reader->data;
+    *out_handle = (hm_nint)data->file_desc;
+    return HM_OK;
+}
+
+static hmError hmFileReader_close(hmReader* reader)
+{
+    hmFileReaderData* data = (hmFileReaderData*)reader->data;
+    hmError err = HM_OK;
+    if (close(data->file_desc) == -1) {
+        err = hmUnixErrorToHammer(errno);
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateFileReader(hmAllocator* allocator, hmString* path, hmReader* in_reader)
+{
+    hmFileReaderData* data = (hmFileReaderData*)hmAlloc(allocator, sizeof(hmFileReaderData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmOpenFileForReading(path, &data->file_desc);
+    if (err != HM_OK) {
+        hmFree(allocator, data);
+        return err;
+    }
+    data->allocator = allocator;
+    in_reader->read = &hmFileReader_read;
+    in_reader->close = &hmFileReader_close;
+    in_reader->borrow_opt = HM_NULL;
+    in_reader->get_native_handle_opt = &hmFileReader_get_native_handle;
+    in_reader->data = data;
+    return HM_OK;
+}
+
+/* *********************** */
+/*    MappedFileReader.    */
+/* *********************** */
+
+typedef struct {
+    const char*  base;      /* The beginning of the mapping. HM_NULL for empty files (they can't be mapped). */
+    hmAllocator* allocator; /* The allocator which governs this structure's lifetime. */
+    hm_nint      offset;    /* The current offset inside the mapping. Never exceeds `size`. */
+    hm_nint      size;      /* The size of the mapping (equals to the size of the file). */
+} hmMappedFileReaderData;
+
+static hmError hmMappedFileReader_borrow(hmReader* reader, hm_nint size, const char** out_chars, hm_nint* out_bytes_borrowed)
+{
+    hmMappedFileReaderData* data = (hmMappedFileReaderData*)reader->data;
+    /* No safe math below because `offset` never exceeds `size`, and `base + size` is a valid mapping. */
+    hm_nint remaining_size = data->size - data->offset;
+    if (size > remaining_size) {
+        size = remaining_size;
+    }
+    *out_chars = data->base + data->offset;
+    *out_bytes_borrowed = size;
+    data->offset += size;
+    return HM_OK;
+}
+
+static hmError hmMappedFileReader_read(hmReader* reader, char* buffer, hm_nint size, hm_nint* out_bytes_read)
+{
+    const char* chars = HM_NULL;
+    HM_TRY(hmMappedFileReader_borrow(reader, size, &chars, out_bytes_read));
+    if (*out_bytes_read > 0) {
+        hmCopyMemory(buffer, chars, *out_bytes_read);
+    }
+    return HM_OK;
+}
+
+static hmError hmMappedFileReader_close(hmReader* reader)
+{
+    hmMappedFileReaderData* data = (hmMappedFileReaderData*)reader->data;
+    hmError err = HM_OK;
+    if (data->base && munmap((void*)data->base, data->size) == -1) {
+        err = hmUnixErrorToHammer(errno);
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateMappedFileReader(hmAllocator* allocator, hmString* path, hmReader* in_reader)
+{
+    hmMappedFileReaderData* data = (hmMappedFileReaderData*)hmAlloc(allocator, sizeof(hmMappedFileReaderData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    int file_desc = -1;
+    hmError err = HM_OK;
+    HM_TRY_OR_FINALIZE(err, hmOpenFileForReading(path, &file_desc));
+    struct stat file_stat;
+    if (fstat(file_desc, &file_stat) == -1) {
+        err = hmUnixErrorToHammer(errno);
+        HM_FINALIZE;
+    }
+    if (!S_ISREG(file_stat.st_mode)) {
+        err = HM_ERROR_INVALID_ARGUMENT;
+        HM_FINALIZE;
+    }
+    if ((hm_uint64)file_stat.st_size > HM_NINT_MAX) { /* can happen on 32-bit platforms */
+        err = HM_ERROR_LIMIT_EXCEEDED;
+        HM_FINALIZE;
+    }
+    data->base = HM_NULL;
+    data->size = (hm_nint)file_stat.st_size;
+    if (data->size > 0) {
+        void* base = mmap(HM_NULL, data->size, PROT_READ, MAP_PRIVATE, file_desc, 0);
+        if (base == MAP_FAILED) {
+            err = hmUnixErrorToHammer(errno);
+            HM_FINALIZE;
+        }
+        /* The advice is only a hint, so the result is ignored. */
+        madvise(base, data->size, MADV_SEQUENTIAL);
+        data->base = (const char*)base;
+    }
+    data->allocator = allocator;
+    data->offset = 0;
+    in_reader->read = &hmMappedFileReader_read;
+    in_reader->close = &hmMappedFileReader_close;
+    in_reader->borrow_opt = &hmMappedFileReader_borrow;
+    in_reader->get_native_handle_opt = HM_NULL; /* the file descriptor is closed right after mapping */
+    in_reader->data = data;
+HM_ON_FINALIZE
+    /* The mapping stays valid after the file descriptor is closed. */
+    if (file_desc != -1 && close(file_desc) == -1 && err == HM_OK) {
+        err = hmUnixErrorToHammer(errno);
+        if (data->base) {
+            munmap((void*)data->base, data->size);
+        }
+    }
+    if (err != HM_OK) {
+        hmFree(allocator, data);
+    }
+    return err;
+}
+
+hmError hmReaderReadahead(hmReader* reader, hm_nint size)
+{
+    hm_nint handle = 0;
+    HM_TRY(hmReaderGetNativeHandle(reader, &handle));
+    int file_desc = (int)handle;
+    off_t offset = lseek(file_desc, 0, SEEK_CUR);
+    if (offset == (off_t)-1) {
+        return errno == ESPIPE ? HM_ERROR_NOT_IMPLEMENTED : hmUnixErrorToHammer(errno); /* pipes and sockets can't be read ahead */
+    }
+    int result = posix_fadvise(file_desc, offset, (off_t)size, POSIX_FADV_WILLNEED);
+    if (result != 0) { /* posix_fadvise(..) returns the error code instead of setting errno */
+        return result == ESPIPE ? HM_ERROR_NOT_IMPLEMENTED : hmUnixErrorToHammer(result);
+    }
+    return HM_OK;
+}
+
+static hmError hmOpenFileForReading(hmString* path, int* out_file_desc)
+{
+    int file_desc = -1;
+    do {
+        file_desc = open(hmStringGetCString(path), O_RDONLY | O_CLOEXEC);
+    } while (file_desc == -1 && errno == EINTR);
+    if (file_desc == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    *out_file_desc = file_desc;
+    return HM_OK;
+}
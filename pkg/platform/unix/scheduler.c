@@ -0,0 +1,386 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <threading/scheduler.h>
+#include <collections/queue.h>
+#include <collections/timerwheel.h>
+#include <core/environment.h>
+#include <platform/unix/common.h>
+
+#include <errno.h>       /* for errno */
+#include <sys/epoll.h>   /* for epoll_create1(..), epoll_ctl(..), epoll_wait(..) */
+#include <sys/eventfd.h> /* for eventfd(..) */
+#include <unistd.h>      /* for read(..), write(..), close(..) */
+
+#define HM_SCHEDULER_MAX_EVENT_COUNT 64 /* How many ready handles are collected with a single system call. */
+
+struct hmSchedulerPlatformData_;
+
+typedef struct hmSchedulerTask_ {
+    struct hmSchedulerPlatformData_* scheduler;
+    hmCoroutine                      coroutine;
+    void*                            user_data;
+    hmDisposeFunc                    user_data_dispose_func_opt;
+    struct hmSchedulerTask_*         prev;   /* All tasks of a scheduler form a list, see hmSchedulerDispose(..) */
+    struct hmSchedulerTask_*         next;
+    int                              parked_file_desc; /* -1 if the task isn't parked. */
+    hmTimer                          deadline;         /* Valid only if `has_deadline` is set. */
+    hm_bool                          has_deadline;
+    hm_bool                          is_timed_out;     /* Woken up by the deadline rather than the handle. */
+} hmSchedulerTask;
+
+typedef struct hmSchedulerPlatformData_ {
+    hmAllocator*     allocator;
+    hm_nint          stack_size;
+    hmQueue          ready_tasks;     /* hmQueue<hmSchedulerTask*> */
+    hmSchedulerTask* tasks;
+    hm_nint          task_count;
+    int              epoll_file_desc;
+    int              event_file_desc; /* Registered in epoll with HM_NULL as its data, see hmSchedulerWakeUp(..) */
+    hmSchedulerTask* current_task_opt; /* The task being run by hmSchedulerRun(..), if any. */
+    hmTimerWheel     deadlines;       /* hmTimerWheel<hmSchedulerTask*> Ticks are milliseconds since `start_time`. */
+    hm_millis        start_time;
+} hmSchedulerPlatformData;
+
+#define hmSchedulerGetPlatformData(scheduler) ((hmSchedulerPlatformData*)(scheduler)->platform_data)
+
+static hmError hmSchedulerDisposeTask(hmSchedulerTask* task);
+static hmError hmSchedulerPoll(hmSchedulerPlatformData* platform_data, hm_millis timeout_ms);
+static hm_uint64 hmSchedulerGetCurrentTick(hmSchedulerPlatformData* platform_data);
+static hm_millis hmSchedulerGetPollTimeout(hmSchedulerPlatformData* platform_data, hm_millis timeout_ms);
+static hmError hmSchedulerUnpark(hmSchedulerPlatformData* platform_data, hmSchedulerTask* task);
+static hmError hmSchedulerExpireDeadlineFunc(void* item, void* user_data);
+
+hmError hmCreateScheduler(hmAllocator* allocator, hm_nint stack_size, hmScheduler* in_scheduler)
+{
+    if (stack_size < HM_COROUTINE_MIN_STACK_SIZE || stack_size > HM_COROUTINE_MAX_STACK_SIZE) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hmSchedulerPlatformData* platform_data = (hmSchedulerPlatformData*)hmAlloc(allocator, sizeof(hmSchedulerPlatformData));
+    if (!platform_data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = HM_OK;
+    hm_bool is_queue_initialized       = HM_FALSE,
+            is_timer_wheel_initialized = HM_FALSE;
+    platform_data->epoll_file_desc = -1;
+    platform_data->event_file_desc = -1;
+    HM_TRY_OR_FINALIZE(err, hmCreateQueue(
+        allocator,
+        sizeof(hmSchedulerTask*),
+        HM_QUEUE_DEFAULT_CAPACITY,
+        HM_NULL,
+        HM_FALSE,
+        &platform_data->ready_tasks
+    ));
+    is_queue_initialized = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateTimerWheel(allocator, sizeof(hmSchedulerTask*), HM_NULL, &platform_data->deadlines));
+    is_timer_wheel_initialized = HM_TRUE;
+    if ((platform_data->epoll_file_desc = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        err = hmUnixErrorToHammer(errno);
+        HM_FINALIZE;
+    }
+    if ((platform_data->event_file_desc = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+        err = hmUnixErrorToHammer(errno);
+        HM_FINALIZE;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = HM_NULL;
+    if (epoll_ctl(platform_data->epoll_file_desc, EPOLL_CTL_ADD, platform_data->event_file_desc, &event) == -1) {
+        err = hmUnixErrorToHammer(errno);
+        HM_FINALIZE;
+    }
+    platform_data->allocator = allocator;
+    platform_data->stack_size = stack_size;
+    platform_data->tasks = HM_NULL;
+    platform_data->task_count = 0;
+    platform_data->current_task_opt = HM_NULL;
+    platform_data->start_time = hmGetTickCount();
+    in_scheduler->platform_data = platform_data;
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        if (platform_data->event_file_desc != -1) {
+            close(platform_data->event_file_desc);
+        }
+        if (platform_data->epoll_file_desc != -1) {
+            close(platform_data->epoll_file_desc);
+        }
+        if (is_timer_wheel_initialized) {
+            err = hmMergeErrors(err, hmTimerWheelDispose(&platform_data->deadlines));
+        }
+        if (is_queue_initialized) {
+            err = hmMergeErrors(err, hmQueueDispose(&platform_data->ready_tasks));
+        }
+        hmFree(allocator, platform_data);
+    }
+    return err;
+}
+
+hmError hmSchedulerDispose(hmScheduler* scheduler)
+{
+    hmSchedulerPlatformData* platform_data = hmSchedulerGetPlatformData(scheduler);
+    if (platform_data->current_task_opt) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    hmError err = HM_OK;
+    while (platform_data->tasks) {
+        err = hmMergeErrors(err, hmSchedulerDisposeTask(platform_data->tasks));
+    }
+    err = hmMergeErrors(err, hmTimerWheelDispose(&platform_data->deadlines));
+    err = hmMergeErrors(err, hmQueueDispose(&platform_data->ready_tasks));
+    if (close(platform_data->event_file_desc) == -1) {
+        err = hmMergeErrors(err, hmUnixErrorToHammer(errno));
+    }
+    if (close(platform_data->epoll_file_desc) == -1) {
+        err = hmMergeErrors(err, hmUnixErrorToHammer(errno));
+    }
+    hmFree(platform_data->allocator, platform_data);
+    return err;
+}
+
+hmError hmSchedulerSpawn(
+    hmScheduler*    scheduler,
+    hmCoroutineFunc coroutine_func,
+    void*           user_data,
+    hmDisposeFunc   user_data_dispose_func_opt
+)
+{
+    hmSchedulerPlatformData* platform_data = hmSchedulerGetPlatformData(scheduler);
+    hmSchedulerTask* task = (hmSchedulerTask*)hmAlloc(platform_data->allocator, sizeof(hmSchedulerTask));
+    if (!task) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmCreateCoroutine(platform_data->allocator, platform_data->stack_size, coroutine_func, user_data, &task->coroutine);
+    if (err != HM_OK) {
+        hmFree(platform_data->allocator, task);
+        return err;
+    }
+    err = hmQueueEnqueue(&platform_data->ready_tasks, &task);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmCoroutineDispose(&task->coroutine));
+        hmFree(platform_data->allocator, task);
+        return err;
+    }
+    task->scheduler = platform_data;
+    task->user_data = user_data;
+    task->user_data_dispose_func_opt = user_data_dispose_func_opt;
+    task->parked_file_desc = -1;
+    task->has_deadline = HM_FALSE;
+    task->is_timed_out = HM_FALSE;
+    task->prev = HM_NULL;
+    task->next = platform_data->tasks;
+    if (platform_data->tasks) {
+        platform_data->tasks->prev = task;
+    }
+    platform_data->tasks = task;
+    platform_data->task_count++;
+    return HM_OK;
+}
+
+hmError hmSchedulerRun(hmScheduler* scheduler, hm_millis timeout_ms)
+{
+    if (timeout_ms > HM_SCHEDULER_MAX_TIMEOUT_MS && timeout_ms != HM_SCHEDULER_INFINITE_TIMEOUT) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hmSchedulerPlatformData* platform_data = hmSchedulerGetPlatformData(scheduler);
+    if (platform_data->current_task_opt) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    /* Only the tasks which are ready at this point run: tasks which yield are enqueued again and run on the next call,
+       so that a task which keeps yielding can't starve I/O. */
+    hm_nint ready_count = hmQueueGetCount(&platform_data->ready_tasks);
+    for (hm_nint i = 0; i < ready_count; i++) {
+        hmSchedulerTask* task;
+        HM_TRY(hmQueueDequeue(&platform_data->ready_tasks, &task));
+        platform_data->current_task_opt = task;
+        hmError err = hmCoroutineResume(&task->coroutine);
+        platform_data->current_task_opt = HM_NULL;
+        HM_TRY(err);
+        if (hmCoroutineGetState(&task->coroutine) == HM_COROUTINE_STATE_FINISHED) {
+            err = hmCoroutineGetExitError(&task->coroutine);
+            err = hmMergeErrors(err, hmSchedulerDisposeTask(task));
+            HM_TRY(err);
+        } else if (task->parked_file_desc == -1) { /* The task yielded. */
+            HM_TRY(hmQueueEnqueue(&platform_data->ready_tasks, &task));
+        }
+    }
+    /* Blocks only if there was nothing to do: otherwise, the caller gets a chance to react to what the coroutines did
+       (for example, to stop once all of them finish). */
+    return hmSchedulerPoll(platform_data, ready_count == 0 ? timeout_ms : 0);
+}
+
+hmError hmSchedulerWakeUp(hmScheduler* scheduler)
+{
+    hmSchedulerPlatformData* platform_data = hmSchedulerGetPlatformData(scheduler);
+    hm_uint64 value = 1;
+    /* EAGAIN means the counter is saturated, i.e. the scheduler is going to wake up anyway. */
+    if (write(platform_data->event_file_desc, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+        return hmUnixErrorToHammer(errno);
+    }
+    return HM_OK;
+}
+
+hm_nint hmSchedulerGetCoroutineCount(hmScheduler* scheduler)
+{
+    return hmSchedulerGetPlatformData(scheduler)->task_count;
+}
+
+hmError hmSchedulerYield(hmScheduler* scheduler)
+{
+    hmSchedulerTask* task = hmSchedulerGetPlatformData(scheduler)->current_task_opt;
+    if (!task) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    return hmCoroutineYield(&task->coroutine); /* Enqueued again by hmSchedulerRun(..) */
+}
+
+hmError hmSchedulerWaitForHandle(hmScheduler* scheduler, hm_nint handle, hm_bool is_write, hm_millis timeout_ms)
+{
+    hmSchedulerPlatformData* platform_data = hmSchedulerGetPlatformData(scheduler);
+    hmSchedulerTask* task = platform_data->current_task_opt;
+    if (!task) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    if (timeout_ms > HM_SCHEDULER_MAX_TIMEOUT_MS && timeout_ms != HM_SCHEDULER_INFINITE_TIMEOUT) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    int file_desc = (int)handle;
+    struct epoll_event event;
+    /* EPOLLONESHOT: the handle is removed from the event loop right after it's reported (see hmSchedulerPoll(..)),
+       so the loop never spins on a handle nobody waits for. Hangups and errors are always reported. */
+    event.events = (is_write ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+    event.data.ptr = task;
+    if (epoll_ctl(platform_data->epoll_file_desc, EPOLL_CTL_ADD, file_desc, &event) == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    if (timeout_ms != HM_SCHEDULER_INFINITE_TIMEOUT) {
+        hm_uint64 expiry_tick = hmSchedulerGetCurrentTick(platform_data) + timeout_ms;
+        hmError err = hmTimerWheelAdd(&platform_data->deadlines, expiry_tick, &task, &task->deadline);
+        if (err != HM_OK) {
+            if (epoll_ctl(platform_data->epoll_file_desc, EPOLL_CTL_DEL, file_desc, HM_NULL) == -1) {
+                err = hmMergeErrors(err, hmUnixErrorToHammer(errno));
+            }
+            return err;
+        }
+        task->has_deadline = HM_TRUE;
+    }
+    task->parked_file_desc = file_desc;
+    HM_TRY(hmCoroutineYield(&task->coroutine));
+    if (task->is_timed_out) {
+        task->is_timed_out = HM_FALSE;
+        return HM_ERROR_TIMEOUT;
+    }
+    return HM_OK;
+}
+
+static hmError hmSchedulerDisposeTask(hmSchedulerTask* task)
+{
+    hmSchedulerPlatformData* platform_data = task->scheduler;
+    if (task->prev) {
+        task->prev->next = task->next;
+    } else {
+        platform_data->tasks = task->next;
+    }
+    if (task->next) {
+        task->next->prev = task->prev;
+    }
+    platform_data->task_count--;
+    hmError err = hmCoroutineDispose(&task->coroutine);
+    if (task->user_data_dispose_func_opt) {
+        err = hmMergeErrors(err, task->user_data_dispose_func_opt(task->user_data));
+    }
+    hmFree(platform_data->allocator, task);
+    return err;
+}
+
+static hmError hmSchedulerPoll(hmSchedulerPlatformData* platform_data, hm_millis timeout_ms)
+{
+    struct epoll_event events[HM_SCHEDULER_MAX_EVENT_COUNT];
+    timeout_ms = hmSchedulerGetPollTimeout(platform_data, timeout_ms);
+    int event_count = epoll_wait(
+        platform_data->epoll_file_desc,
+        events,
+        HM_SCHEDULER_MAX_EVENT_COUNT,
+        timeout_ms == HM_SCHEDULER_INFINITE_TIMEOUT ? -1 : (int)timeout_ms
+    );
+    if (event_count == -1) {
+        if (errno != EINTR) {
+            return hmUnixErrorToHammer(errno);
+        }
+        event_count = 0; /* Deadlines could have expired while waiting. */
+    }
+    hmError err = HM_OK;
+    for (int i = 0; i < event_count; i++) {
+        hmSchedulerTask* task = (hmSchedulerTask*)events[i].data.ptr;
+        if (!task) {
+            hm_uint64 value;
+            if (read(platform_data->event_file_desc, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+                err = hmMergeErrors(err, hmUnixErrorToHammer(errno));
+            }
+            continue;
+        }
+        if (task->has_deadline) {
+            task->has_deadline = HM_FALSE;
+            err = hmMergeErrors(err, hmTimerWheelCancel(&platform_data->deadlines, &task->deadline));
+        }
+        err = hmMergeErrors(err, hmSchedulerUnpark(platform_data, task));
+    }
+    /* Tasks whose handles became ready were removed from the timer wheel above, so a task is never enqueued twice. */
+    return hmMergeErrors(err, hmTimerWheelAdvance(
+        &platform_data->deadlines,
+        hmSchedulerGetCurrentTick(platform_data),
+        &hmSchedulerExpireDeadlineFunc,
+        platform_data
+    ));
+}
+
+static hm_uint64 hmSchedulerGetCurrentTick(hmSchedulerPlatformData* platform_data)
+{
+    return (hm_uint64)(hmGetTickCount() - platform_data->start_time);
+}
+
+/* Makes sure epoll_wait(..) doesn't sleep past the earliest deadline. */
+static hm_millis hmSchedulerGetPollTimeout(hmSchedulerPlatformData* platform_data, hm_millis timeout_ms)
+{
+    hm_uint64 next_tick;
+    if (!timeout_ms || hmTimerWheelGetNextExpiry(&platform_data->deadlines, &next_tick) != HM_OK) {
+        return timeout_ms;
+    }
+    hm_uint64 current_tick = hmSchedulerGetCurrentTick(platform_data);
+    hm_uint64 deadline_timeout_ms = next_tick > current_tick ? next_tick - current_tick : 0;
+    if (timeout_ms == HM_SCHEDULER_INFINITE_TIMEOUT || deadline_timeout_ms < timeout_ms) {
+        return (hm_millis)deadline_timeout_ms;
+    }
+    return timeout_ms;
+}
+
+static hmError hmSchedulerUnpark(hmSchedulerPlatformData* platform_data, hmSchedulerTask* task)
+{
+    hmError err = HM_OK;
+    /* The handle is disabled after the event (EPOLLONESHOT), but it's still registered: remove it so that it could be
+       added again by the next hmSchedulerWaitForHandle(..) */
+    if (epoll_ctl(platform_data->epoll_file_desc, EPOLL_CTL_DEL, task->parked_file_desc, HM_NULL) == -1) {
+        err = hmUnixErrorToHammer(errno);
+    }
+    task->parked_file_desc = -1;
+    return hmMergeErrors(err, hmQueueEnqueue(&platform_data->ready_tasks, &task));
+}
+
+static hmError hmSchedulerExpireDeadlineFunc(void* item, void* user_data)
+{
+    hmSchedulerTask* task = *((hmSchedulerTask**)item);
+    task->has_deadline = HM_FALSE;
+    task->is_timed_out = HM_TRUE;
+    return hmSchedulerUnpark((hmSchedulerPlatformData*)user_data, task);
+}
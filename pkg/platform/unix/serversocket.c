@@ -14,6 +14,7 @@
 #include <net/sockets/serversocket.h>
 #include <core/utils.h>
 #include <threading/atomic.h>
+#include <threading/scheduler.h>
 #include <platform/unix/common.h>
 #include <platform/unix/socket.h>
 
@@ -22,7 +23,7 @@
 #include <bits/socket.h> /* for SOMAXCONN */
 #include <sys/socket.h>  /* for socket(..), SO_RCVTIMEO etc. & Co. */
 #include <errno.h>       /* for errno */
-#include <fcntl.h>       /* for open(..), O_RDONLY */
+#include <fcntl.h>       /* for open(..), fcntl(..), O_RDONLY, O_NONBLOCK */
 #include <stdlib.h>      /* for atoi(..) */
 #include <unistd.h>      /* for read(..), close(..) */
 
@@ -31,6 +32,7 @@ typedef struct {
     hm_millis          timeout_ms;
     int                socket_file_desc;
     struct sockaddr_in address;
+    hmScheduler*       scheduler_opt; /* See hmServerSocketSetScheduler(..) */
 } hmServerSocketPlatformData;
 
 static hm_nint hmGetMaxConnectionBacklog();
@@ -76,6 +78,7 @@ hmError hmCreateServerSocket(
     address.sin_port = htons(port);
     platform_data->address = address;
     platform_data->timeout_ms = timeout_ms;
+    platform_data->scheduler_opt = HM_NULL;
     if (bind(platform_data->socket_file_desc, (struct sockaddr*)&address, sizeof(address)) == -1) {
         err = hmUnixErrorToHammer(errno);
         HM_FINALIZE;
@@ -105,8 +108,19 @@ hmError hmServerSocketAccept(hmServerSocket* socket, hmAllocator* socket_allocat
     hmServerSocketPlatformData* platform_data = (hmServerSocketPlatformData*)socket->platform_data;
     int socket_file_desc = 0;
     socklen_t address_length = sizeof(platform_data->address);
-    if ((socket_file_desc = accept(platform_data->socket_file_desc, (struct sockaddr*)&platform_data->address, (socklen_t*)&address_length)) == -1) {
-        return hmUnixErrorToHammer(errno);
+    /* A bound socket is non-blocking (see hmServerSocketSetScheduler(..)): readiness doesn't guarantee the connection is
+       still there when accept(..) is called, so the coroutine is parked again until there's another one. */
+    while ((socket_file_desc = accept(platform_data->socket_file_desc, (struct sockaddr*)&platform_data->address, (socklen_t*)&address_length)) == -1) {
+        if (!platform_data->scheduler_opt || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            return hmUnixErrorToHammer(errno);
+        }
+        HM_TRY(hmSchedulerWaitForHandle(
+            platform_data->scheduler_opt,
+            (hm_nint)platform_data->socket_file_desc,
+            HM_FALSE,
+            platform_data->timeout_ms ? platform_data->timeout_ms : HM_SCHEDULER_INFINITE_TIMEOUT
+        ));
+        address_length = sizeof(platform_data->address);
     }
     return hmCreateSocketFromDescriptor(
         socket_allocator_opt ? socket_allocator_opt : socket->allocator,
@@ -116,6 +130,21 @@ hmError hmServerSocketAccept(hmServerSocket* socket, hmAllocator* socket_allocat
     );
 }
 
+hmError hmServerSocketSetScheduler(hmServerSocket* socket, hmScheduler* scheduler_opt)
+{
+    hmServerSocketPlatformData* platform_data = (hmServerSocketPlatformData*)socket->platform_data;
+    int flags = fcntl(platform_data->socket_file_desc, F_GETFL, 0);
+    if (flags == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    flags = scheduler_opt ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    if (fcntl(platform_data->socket_file_desc, F_SETFL, flags) == -1) {
+        return hmUnixErrorToHammer(errno);
+    }
+    platform_data->scheduler_opt = scheduler_opt;
+    return HM_OK;
+}
+
 hmError hmServerSocketDispose(hmServerSocket* socket)
 {
     hmServerSocketPlatformData* platform_data = (hmServerSocketPlatformData*)socket->platform_data;
@@ -12,23 +12,35 @@
 * ******************************************************************************/
 
 #include <net/sockets/socket.h>
+#include <core/format.h>
 #include <core/utils.h>
+#include <threading/scheduler.h>
 #include <platform/unix/common.h>
 
 #include <arpa/inet.h>  /* for inet_pton(..) & Co. */
 #include <netinet/in.h> /* for sockaddr_in & Co. */
-#include <sys/socket.h> /* for socket(..), SO_RCVTIMEO, SO_SNDTIMEO & Co. */
+#include <sys/socket.h> /* for socket(..), sendmsg(..), SO_RCVTIMEO, SO_SNDTIMEO & Co. */
+#include <sys/uio.h>    /* for struct iovec */
 #include <errno.h>      /* for errno */
 #include <netdb.h>      /* for getaddrinfo(..) & Co. */
-#include <stdio.h>      /* for sprintf(..) */
 #include <unistd.h>     /* for close(..) & Co. */
 
 typedef struct {
     hmAllocator* allocator;
     int          socket_file_desc;
+    hmScheduler* scheduler_opt;   /* See hmSocketSetScheduler(..) */
+    hm_millis    park_timeout_ms; /* SO_RCVTIMEO/SO_SNDTIMEO don't apply to parked coroutines. */
 } hmSocketPlatformData;
 
 static hmError hmSetSocketTimeout(int file_socket_desk, hm_millis timeout_ms);
+static hm_millis hmGetSocketParkTimeout(hm_millis timeout_ms);
+static hmError hmSocketSendIovecs(
+    hmSocketPlatformData* platform_data,
+    struct iovec*         iovecs,
+    hm_nint               iovec_count,
+    hm_nint*              out_bytes_sent_opt
+);
+static hm_bool hmSocketWouldBlock(int unix_err);
 
 hmError hmCreateSocketFromDescriptor(
     hmAllocator* allocator,
@@ -43,6 +55,8 @@ hmError hmCreateSocketFromDescriptor(
         return HM_ERROR_OUT_OF_MEMORY;
     }
     platform_data->socket_file_desc = socket_file_desc;
+    platform_data->scheduler_opt = HM_NULL;
+    platform_data->park_timeout_ms = hmGetSocketParkTimeout(timeout_ms);
     in_socket->allocator = allocator;
     in_socket->platform_data = platform_data;
     return HM_OK;
@@ -72,14 +86,16 @@ hmError hmCreateSocket(
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_flags = AI_PASSIVE;
     struct addrinfo* addrinfo;
-    char port_str[32] = {0};
-    sprintf(port_str, "%d", (int)port);
+    char port_str[HM_FORMAT_BUFFER_SIZE + 1] = {0};
+    hmFormatUint64(port, port_str);
     int r = getaddrinfo(hmStringGetCString(host), port_str, &hints, &addrinfo);
     if (r) {
         err = (r == EAI_NONAME || r == EAI_AGAIN) ? HM_ERROR_NOT_FOUND : HM_ERROR_PLATFORM_DEPENDENT; /* getaddrinfo(..) has its own error codes */
         HM_FINALIZE;
     }
     is_addrinfo_initialized = HM_TRUE;
+    platform_data->scheduler_opt = HM_NULL;
+    platform_data->park_timeout_ms = hmGetSocketParkTimeout(timeout_ms);
     if ((platform_data->socket_file_desc = socket(addrinfo->ai_family, SOCK_STREAM, 0)) == -1) {
         err = hmUnixErrorToHammer(errno);
         HM_FINALIZE;
@@ -109,22 +125,68 @@ HM_ON_FINALIZE
 hmError hmSocketSend(hmSocket* socket, const char* buffer, hm_nint size, hm_nint *out_bytes_sent_opt)
 {
     hmSocketPlatformData* platform_data = (hmSocketPlatformData*)socket->platform_data;
-    /* MSG_NOSIGNAL avoids SIGPIPE-related crashes when the connection is abruptly closed. */
-    ssize_t bytes_send = send(platform_data->socket_file_desc, buffer, size, MSG_NOSIGNAL);
-    if (out_bytes_sent_opt) {
-        *out_bytes_sent_opt = bytes_send >= 0 ? (hm_nint)bytes_send : 0;
+    struct iovec iovec;
+    iovec.iov_base = (void*)buffer;
+    iovec.iov_len = size;
+    return hmSocketSendIovecs(platform_data, &iovec, 1, out_bytes_sent_opt);
+}
+
+hmError hmSocketSendVector(hmSocket* socket, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint *out_bytes_sent_opt)
+{
+    if (buffer_count > HM_WRITER_MAX_BUFFER_COUNT) {
+        return HM_ERROR_INVALID_ARGUMENT;
     }
-    return bytes_send == -1 ? hmUnixErrorToHammer(errno) : HM_OK;
+    hmSocketPlatformData* platform_data = (hmSocketPlatformData*)socket->platform_data;
+    struct iovec iovecs[HM_WRITER_MAX_BUFFER_COUNT];
+    for (hm_nint i = 0; i < buffer_count; i++) {
+        iovecs[i].iov_base = (void*)buffers[i].chars;
+        iovecs[i].iov_len = buffers[i].size;
+    }
+    return hmSocketSendIovecs(platform_data, iovecs, buffer_count, out_bytes_sent_opt);
 }
 
 hmError hmSocketRead(hmSocket* socket, char* buffer, hm_nint size, hm_nint* out_bytes_read_opt)
 {
     hmSocketPlatformData* platform_data = (hmSocketPlatformData*)socket->platform_data;
-    ssize_t bytes_read = read(platform_data->socket_file_desc, buffer, size);
+    hmError err = HM_OK;
+    ssize_t bytes_read = 0;
+    if (platform_data->scheduler_opt) {
+        /* Parks the coroutine instead of blocking the thread, see hmSchedulerWaitForHandle(..) */
+        while ((bytes_read = recv(platform_data->socket_file_desc, buffer, size, MSG_DONTWAIT)) == -1 && hmSocketWouldBlock(errno)) {
+            HM_TRY_OR_FINALIZE(err, hmSchedulerWaitForHandle(
+                platform_data->scheduler_opt,
+                (hm_nint)platform_data->socket_file_desc,
+                HM_FALSE,
+                platform_data->park_timeout_ms
+            ));
+        }
+    } else {
+        bytes_read = read(platform_data->socket_file_desc, buffer, size);
+    }
+    err = bytes_read == -1 ? hmUnixErrorToHammer(errno) : HM_OK;
+HM_ON_FINALIZE
     if (out_bytes_read_opt) {
-        *out_bytes_read_opt = bytes_read >= 0 ? (hm_nint)bytes_read : 0;
+        *out_bytes_read_opt = err == HM_OK ? (hm_nint)bytes_read : 0;
     }
-    return bytes_read == -1 ? hmUnixErrorToHammer(errno) : HM_OK;
+    return err;
+}
+
+hm_nint hmSocketGetNativeHandle(hmSocket* socket)
+{
+    hmSocketPlatformData* platform_data = (hmSocketPlatformData*)socket->platform_data;
+    return (hm_nint)platform_data->socket_file_desc;
+}
+
+void hmSocketSetScheduler(hmSocket* socket, hmScheduler* scheduler_opt)
+{
+    hmSocketPlatformData* platform_data = (hmSocketPlatformData*)socket->platform_data;
+    platform_data->scheduler_opt = scheduler_opt;
+}
+
+hmScheduler* hmSocketGetScheduler(hmSocket* socket)
+{
+    hmSocketPlatformData* platform_data = (hmSocketPlatformData*)socket->platform_data;
+    return platform_data->scheduler_opt;
 }
 
 hmError hmSocketDispose(hmSocket* socket)
@@ -155,3 +217,70 @@ static hmError hmSetSocketTimeout(int file_socket_desc, hm_millis timeout_ms)
     }
     return HM_OK;
 }
+
+static hm_millis hmGetSocketParkTimeout(hm_millis timeout_ms)
+{
+    return timeout_ms ? timeout_ms : HM_SCHEDULER_INFINITE_TIMEOUT;
+}
+
+static hm_bool hmSocketWouldBlock(int unix_err)
+{
+    return unix_err == EAGAIN || unix_err == EWOULDBLOCK;
+}
+
+static hmError hmSocketSendIovecs(
+    hmSocketPlatformData* platform_data,
+    struct iovec*         iovecs,
+    hm_nint               iovec_count,
+    hm_nint*              out_bytes_sent_opt
+)
+{
+    int socket_file_desc = platform_data->socket_file_desc;
+    /* A socket bound to a scheduler parks the coroutine instead of blocking the thread (see hmSchedulerWaitForHandle(..)) */
+    hm_bool should_park = platform_data->scheduler_opt != HM_NULL;
+    /* sendmsg(..) instead of writev(..) because the latter doesn't support MSG_NOSIGNAL which avoids SIGPIPE-related
+       crashes when the connection is abruptly closed. */
+    struct msghdr message;
+    hmZeroMemory(&message, sizeof(message));
+    message.msg_iov = iovecs;
+    message.msg_iovlen = iovec_count;
+    hm_nint total_bytes_sent = 0;
+    hmError err = HM_OK;
+    while (message.msg_iovlen > 0) {
+        ssize_t bytes_sent = sendmsg(socket_file_desc, &message, MSG_NOSIGNAL | (should_park ? MSG_DONTWAIT : 0));
+        if (bytes_sent == -1) {
+            if (should_park && hmSocketWouldBlock(errno)) {
+                HM_TRY_OR_FINALIZE(err, hmSchedulerWaitForHandle(
+                    platform_data->scheduler_opt,
+                    (hm_nint)socket_file_desc,
+                    HM_TRUE,
+                    platform_data->park_timeout_ms
+                ));
+                continue;
+            }
+            err = hmUnixErrorToHammer(errno);
+            HM_FINALIZE;
+        }
+        total_bytes_sent += (hm_nint)bytes_sent;
+        if (!should_park) {
+            break; /* A blocking call sends everything unless it times out. */
+        }
+        /* A non-blocking call sends only what fits in the socket's buffer: skip what was sent and wait for the rest to fit,
+           so that the coroutine sees the same semantics as a blocking call. */
+        hm_nint bytes_to_skip = (hm_nint)bytes_sent;
+        while (message.msg_iovlen > 0 && bytes_to_skip >= message.msg_iov->iov_len) {
+            bytes_to_skip -= message.msg_iov->iov_len;
+            message.msg_iov++;
+            message.msg_iovlen--;
+        }
+        if (message.msg_iovlen > 0) {
+            message.msg_iov->iov_base = (char*)message.msg_iov->iov_base + bytes_to_skip;
+            message.msg_iov->iov_len -= bytes_to_skip;
+        }
+    }
+HM_ON_FINALIZE
+    if (out_bytes_sent_opt) {
+        *out_bytes_sent_opt = total_bytes_sent;
+    }
+    return err;
+}
@@ -20,6 +20,7 @@
 
 #include <errno.h>   /* for ETIMEDOUT */
 #include <pthread.h> /* for all the POSIX thread functions */
+#include <sched.h>   /* for cpu_set_t */
 
 typedef struct {
     hmAllocator*      allocator;
@@ -42,6 +43,8 @@ volatile
 #define hmThreadGetPlatformData(thread) ((hmThreadPlatformData*)(thread)->platform_data)
 static hmError hmThreadTryDisposePlatformData(hmThreadPlatformData* platform_data);
 static void* hmAdaptPosixThreadToHammer(void* arg);
+static void hmThreadSetOSName(hmThreadPlatformData* platform_data);
+static hmError hmThreadFillCpuSet(const hm_nint* processor_indices, hm_nint processor_count, cpu_set_t* out_cpu_set);
 
 hmError hmCreateThread(
     hmAllocator*      allocator,
@@ -51,12 +54,38 @@ hmError hmCreateThread(
     hmThread*         in_thread
 )
 {
-    hmThreadPlatformData* platform_data = (hmThreadPlatformData*)hmAlloc(allocator, sizeof(hmThreadPlatformData));
-    if (!platform_data) {
-        return HM_ERROR_OUT_OF_MEMORY;
+    return hmCreateThreadWithAffinity(allocator, name_opt, HM_NULL, 0, thread_func, user_data, in_thread);
+}
+
+hmError hmCreateThreadWithAffinity(
+    hmAllocator*      allocator,
+    hmString*         name_opt,
+    const hm_nint*    processor_indices_opt,
+    hm_nint           processor_count,
+    hmThreadStartFunc thread_func,
+    void*             user_data,
+    hmThread*         in_thread
+)
+{
+    cpu_set_t cpu_set;
+    if (processor_indices_opt) {
+        HM_TRY(hmThreadFillCpuSet(processor_indices_opt, processor_count, &cpu_set));
     }
+    pthread_attr_t attr;
+    HM_TRY(hmUnixErrorToHammer(pthread_attr_init(&attr)));
+    hmThreadPlatformData* platform_data = HM_NULL;
     hmError err = HM_OK;
     hm_bool is_string_duplicated = HM_FALSE;
+    if (processor_indices_opt) {
+        /* Pinned before it starts, so the thread never runs elsewhere, and the memory it touches first (its stack, for
+           example) is committed on the node of its processors. */
+        HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set)));
+    }
+    platform_data = (hmThreadPlatformData*)hmAlloc(allocator, sizeof(hmThreadPlatformData));
+    if (!platform_data) {
+        err = HM_ERROR_OUT_OF_MEMORY;
+        HM_FINALIZE;
+    }
     if (name_opt) {
         HM_TRY_OR_FINALIZE(err, hmStringDuplicate(allocator, name_opt, &platform_data->name));
     } else {
@@ -72,14 +101,15 @@ hmError hmCreateThread(
     hmAtomicStore(&platform_data->is_abort_requested, HM_FALSE);
     hmAtomicStore(&platform_data->is_detached, HM_FALSE);
     in_thread->platform_data = platform_data;
-    HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_create(&platform_data->posix_thread, 0, &hmAdaptPosixThreadToHammer, platform_data)));
+    HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_create(&platform_data->posix_thread, &attr, &hmAdaptPosixThreadToHammer, platform_data)));
 HM_ON_FINALIZE
-    if (err != HM_OK) {
+    if (err != HM_OK && platform_data) {
         if (is_string_duplicated) {
             err = hmMergeErrors(err, hmStringDispose(&platform_data->name));
         }
         hmFree(allocator, platform_data);
     }
+    (void)pthread_attr_destroy(&attr); /* Never fails on Linux; besides, the thread may be already running. */
     return err;
 }
 
@@ -142,6 +172,14 @@ hmError hmThreadGetName(hmThread* thread, hmString* in_string)
     return hmStringDuplicate(platform_data->allocator, &platform_data->name, (hmString*)in_string);
 }
 
+hmError hmThreadSetAffinity(hmThread* thread, const hm_nint* processor_indices, hm_nint processor_count)
+{
+    cpu_set_t cpu_set;
+    HM_TRY(hmThreadFillCpuSet(processor_indices, processor_count, &cpu_set));
+    hmThreadPlatformData* platform_data = hmThreadGetPlatformData(thread);
+    return hmUnixErrorToHammer(pthread_setaffinity_np(platform_data->posix_thread, sizeof(cpu_set), &cpu_set));
+}
+
 hm_millis hmThreadGetProcessorTime(hmThread* thread)
 {
     hmThreadPlatformData* platform_data = hmThreadGetPlatformData(thread);
@@ -189,6 +227,7 @@ static hmError hmThreadTryDisposePlatformData(hmThreadPlatformData* platform_dat
 static void* hmAdaptPosixThreadToHammer(void* arg)
 {
     hmThreadPlatformData* platform_data = (hmThreadPlatformData*)arg;
+    hmThreadSetOSName(platform_data);
     hmAtomicStore(&platform_data->state, HM_THREAD_STATE_RUNNING);
     hmAtomicStore(&platform_data->exit_err, platform_data->thread_func(platform_data->user_data));
     hmAtomicStore(&platform_data->state, HM_THREAD_STATE_STOPPED);
@@ -200,3 +239,34 @@ static void* hmAdaptPosixThreadToHammer(void* arg)
     }
     return 0;
 }
+
+/* Called on the thread itself, so that there's no race with the thread finishing (and its `posix_thread` becoming invalid). */
+static void hmThreadSetOSName(hmThreadPlatformData* platform_data)
+{
+    hm_nint length_in_bytes = hmStringGetLengthInBytes(&platform_data->name);
+    if (!length_in_bytes) {
+        return; /* Keeps the name inherited from the parent thread. */
+    }
+    if (length_in_bytes > HM_THREAD_OS_NAME_MAX_LENGTH) {
+        length_in_bytes = HM_THREAD_OS_NAME_MAX_LENGTH; /* Linux refuses longer names instead of truncating them. */
+    }
+    char os_name[HM_THREAD_OS_NAME_MAX_LENGTH + 1];
+    hmCopyMemory(os_name, hmStringGetChars(&platform_data->name), length_in_bytes);
+    os_name[length_in_bytes] = '\0'; /* null terminator */
+    (void)pthread_setname_np(pthread_self(), os_name); /* The name is purely for debugging, so errors are ignored. */
+}
+
+static hmError hmThreadFillCpuSet(const hm_nint* processor_indices, hm_nint processor_count, cpu_set_t* out_cpu_set)
+{
+    if (!processor_count) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    CPU_ZERO(out_cpu_set);
+    for (hm_nint i = 0; i < processor_count; i++) {
+        if (processor_indices[i] >= CPU_SETSIZE) {
+            return HM_ERROR_INVALID_ARGUMENT;
+        }
+        CPU_SET(processor_indices[i], out_cpu_set);
+    }
+    return HM_OK;
+}
@@ -27,6 +27,7 @@
 #include <core/allocator.h>
 #include <errno.h>
 #include <pthread.h>
+#include <time.h>    /* for CLOCK_MONOTONIC */
 
 typedef struct {
     pthread_mutex_t         mutex;
@@ -44,13 +45,27 @@ hmError hmCreateWaitableEvent(hmAllocator* allocator, hmWaitableEvent* in_waitab
         return HM_ERROR_OUT_OF_MEMORY;
     }
     hmError err = HM_OK;
-    HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_cond_init(&platform_data->cond_variable, HM_NULL)));
+    hm_bool is_cond_attr_initialized = HM_FALSE,
+            is_cond_variable_initialized = HM_FALSE;
+    pthread_condattr_t cond_attr;
+    HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_condattr_init(&cond_attr)));
+    is_cond_attr_initialized = HM_TRUE;
+    /* Timed waits are measured with the monotonic clock, so that changes of the wall clock can't make them stall or spin. */
+    HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC)));
+    HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_cond_init(&platform_data->cond_variable, &cond_attr)));
+    is_cond_variable_initialized = HM_TRUE;
     HM_TRY_OR_FINALIZE(err, hmUnixErrorToHammer(pthread_mutex_init(&platform_data->mutex, HM_NULL)));
     hmAtomicStore(&platform_data->signaled_state, HM_FALSE);
     in_waitable_event->allocator = allocator;
     in_waitable_event->platform_data = platform_data;
 HM_ON_FINALIZE
+    if (is_cond_attr_initialized) {
+        err = hmMergeErrors(err, hmUnixErrorToHammer(pthread_condattr_destroy(&cond_attr)));
+    }
     if (err != HM_OK) {
+        if (is_cond_variable_initialized) {
+            err = hmMergeErrors(err, hmUnixErrorToHammer(pthread_cond_destroy(&platform_data->cond_variable)));
+        }
         hmFree(allocator, platform_data);
     }
     return err;
@@ -68,7 +83,7 @@ hmError hmWaitableEventDispose(hmWaitableEvent* waitable_event)
 
 hmError hmWaitableEventWait(hmWaitableEvent* waitable_event, hm_millis timeout_ms)
 {
-    if (timeout_ms < HM_WAITABLE_EVENT_MIN_TIMEOUT_MS || timeout_ms > HM_WAITABLE_EVENT_MAX_TIMEOUT_MS) {
+    if ((timeout_ms < HM_WAITABLE_EVENT_MIN_TIMEOUT_MS || timeout_ms > HM_WAITABLE_EVENT_MAX_TIMEOUT_MS) && timeout_ms != HM_WAITABLE_EVENT_INFINITE_TIMEOUT) {
         return HM_ERROR_INVALID_ARGUMENT;
     }
     hmWaitableEventPlatformData* platform_data = hmWaitableEventGetPlatformData(waitable_event);
@@ -92,9 +107,14 @@ hmError hmWaitableEventSignal(hmWaitableEvent* waitable_event)
 static hmError hmWaitableEventWaitWithoutLock(hmWaitableEventPlatformData* platform_data, hm_millis timeout_ms)
 {
     int unix_err = HM_UNIX_OK;
-    if (!hmAtomicLoad(&platform_data->signaled_state)) {
+    if (!hmAtomicLoad(&platform_data->signaled_state) && timeout_ms == HM_WAITABLE_EVENT_INFINITE_TIMEOUT) {
+        /* No need to read the clock at all. */
+        do {
+            unix_err = pthread_cond_wait(&platform_data->cond_variable, &platform_data->mutex);
+        } while (unix_err == HM_UNIX_OK && !hmAtomicLoad(&platform_data->signaled_state)); /* a check to protect against spurious wakeups */
+    } else if (!hmAtomicLoad(&platform_data->signaled_state)) {
         struct timespec ts;
-        HM_TRY(hmGetFutureTimeSpec(HM_FALSE, timeout_ms, &ts));
+        HM_TRY(hmGetFutureTimeSpec(HM_TRUE, timeout_ms, &ts));
         do {
             unix_err = pthread_cond_timedwait(&platform_data->cond_variable, &platform_data->mutex, &ts);
         } while (unix_err == HM_UNIX_OK && !hmAtomicLoad(&platform_data->signaled_state)); /* a check to protect against spurious wakeups */
@@ -0,0 +1,109 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <io/writer.h>
+#include <core/allocator.h>
+#include <platform/unix/common.h>
+
+#include <errno.h>   /* for errno */
+#include <fcntl.h>   /* for open(..), O_WRONLY, O_CREAT & Co. */
+#include <sys/uio.h> /* for writev(..) */
+#include <unistd.h>  /* for write(..), close(..) */
+
+/* ***************** */
+/*    FileWriter.    */
+/* ***************** */
+
+typedef struct {
+    hmAllocator* allocator; /* The allocator which governs this structure's lifetime. */
+    int          file_desc; /* The file descriptor of the opened file. */
+} hmFileWriterData;
+
+static hmError hmFileWriter_write(hmWriter* writer, const char* buffer, hm_nint size, hm_nint* out_bytes_written)
+{
+    hmFileWriterData* data = (hmFileWriterData*)writer->data;
+    ssize_t bytes_written = 0;
+    do {
+        bytes_written = write(data->file_desc, buffer, size);
+    } while (bytes_written == -1 && errno == EINTR);
+    if (bytes_written == -1) {
+        *out_bytes_written = 0;
+        return hmUnixErrorToHammer(errno);
+    }
+    *out_bytes_written = (hm_nint)bytes_written;
+    return HM_OK;
+}
+
+static hmError hmFileWriter_write_vector(hmWriter* writer, const hmWriterBuffer* buffers, hm_nint buffer_count, hm_nint* out_bytes_written)
+{
+    hmFileWriterData* data = (hmFileWriterData*)writer->data;
+    struct iovec iovecs[HM_WRITER_MAX_BUFFER_COUNT];
+    for (hm_nint i = 0; i < buffer_count; i++) {
+        iovecs[i].iov_base = (void*)buffers[i].chars;
+        iovecs[i].iov_len = buffers[i].size;
+    }
+    ssize_t bytes_written = 0;
+    do {
+        bytes_written = writev(data->file_desc, iovecs, (int)buffer_count);
+    } while (bytes_written == -1 && errno == EINTR);
+    if (bytes_written == -1) {
+        *out_bytes_written = 0;
+        return hmUnixErrorToHammer(errno);
+    }
+    *out_bytes_written = (hm_nint)bytes_written;
+    return HM_OK;
+}
+
+static hmError hmFileWriter_get_native_handle(hmWriter* writer, hm_nint* out_handle)
+{
+    hmFileWriterData* data = (hmFileWriterData*)writer->data;
+    *out_handle = (hm_nint)data->file_desc;
+    return HM_OK;
+}
+
+static hmError hmFileWriter_close(hmWriter* writer)
+{
+    hmFileWriterData* data = (hmFileWriterData*)writer->data;
+    hmError err = HM_OK;
+    if (close(data->file_desc) == -1) {
+        err = hmUnixErrorToHammer(errno);
+    }
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmCreateFileWriter(hmAllocator* allocator, hmString* path, hm_bool should_append, hmWriter* in_writer)
+{
+    hmFileWriterData* data = (hmFileWriterData*)hmAlloc(allocator, sizeof(hmFileWriterData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (should_append ? O_APPEND : O_TRUNC);
+    int file_desc = -1;
+    do {
+        file_desc = open(hmStringGetCString(path), flags, 0666); /* the final permissions are subject to umask */
+    } while (file_desc == -1 && errno == EINTR);
+    if (file_desc == -1) {
+        hmError err = hmUnixErrorToHammer(errno);
+        hmFree(allocator, data);
+        return err;
+    }
+    data->allocator = allocator;
+    data->file_desc = file_desc;
+    in_writer->write = &hmFileWriter_write;
+    in_writer->close = &hmFileWriter_close;
+    in_writer->write_vector_opt = &hmFileWriter_write_vector;
+    in_writer->get_native_handle_opt = &hmFileWriter_get_native_handle;
+    in_writer->data = data;
+    return HM_OK;
+}
@@ -0,0 +1,592 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/aot.h>
+#include <core/math.h>
+#include <core/stringbuilder.h>
+#include <core/utils.h>
+#include <collections/array.h>
+#include <collections/hashmap.h>
+#include <runtime/signature.h>
+#include <runtime/verifier.h>
+#include <threading/process.h>
+
+#define HM_AOT_SYMBOL_PREFIX "hm_aot_"
+#define HM_AOT_FUNCTION_PREFIX "hm_aot_method_"
+
+/* Everything generated code needs; it doesn't depend on any headers of the runtime. */
+#define HM_AOT_PRELUDE \
+    "/* Generated by the ahead-of-time compiler (see runtime/aot.h). Do not edit. */\n" \
+    "#include <stdint.h>\n" \
+    "\n" \
+    "#define HM_AOT_CALL(call) do { unsigned char err = (call); if (err) return err; } while (0)\n" \
+    "\n"
+
+typedef struct {
+    hmString       symbol_name; /* The name of the exported entry point. */
+    hmSignature*   signature;   /* Interned, see `signatures` in hmAotTranslator */
+    hm_metadata_id method_id;
+} hmAotMethod;
+
+typedef struct {
+    hmAllocator*      allocator;
+    hmAllocator       arena;         /* Owns the names of the methods. */
+    hmSignatureTable  signatures;
+    hmMetadataLoader* metadata_loader;
+    hmWriter*         writer;
+    hmStringBuilder   code;          /* Generated code which is yet to be written. */
+    hmArray           methods;       /* hmArray<hmAotMethod> In the order of metadata. */
+    hmHashMap         method_indices; /* hmHashMap<hm_metadata_id, hm_nint> Indices in `methods`, to resolve calls. */
+    hmString          module_name;   /* The current module and class, see hmMetadataLoaderEnumJoinedMetadata(..) */
+    hmString          class_name;
+    hmAotMethod*      current_method_opt; /* The method whose body is being translated. */
+} hmAotTranslator;
+
+typedef struct {
+    hmAotImage*     image;
+    hmStringBuilder symbol_name;
+    hmModule*       module;
+    hmClass*        hm_class;
+    hm_nint         bound_count;
+} hmAotBindContext;
+
+static hmError hmAot_enumModulesFunc(hmModuleMetadata* metadata, void* user_data);
+static hmError hmAot_enumClassesFunc(hmClassMetadata* metadata, void* user_data);
+static hmError hmAot_enumMethodsFunc(hmMethodMetadata* metadata, void* user_data);
+static hmError hmAot_loadMethodBodyFunc(hmMethodBodyMetadata* body, void* user_data);
+static hmError hmAot_resolveCallTargetFunc(
+    hm_metadata_id method_id,
+    void*          user_data,
+    hmMethod**     out_method,
+    hmSignature**  out_signature
+);
+static hmError hmAot_bindModuleFunc(void* key, void* value, void* user_data);
+static hmError hmAot_bindClassFunc(void* key, void* value, void* user_data);
+static hmError hmAot_bindMethodFunc(void* key, void* value, void* user_data);
+static hmError hmCreateAotTranslator(
+    hmAllocator*      allocator,
+    hmMetadataLoader* metadata_loader,
+    hmWriter*         writer,
+    hmAotTranslator*  in_translator
+);
+static hmError hmAotTranslatorDispose(hmAotTranslator* translator);
+static hmError hmAotTranslateMethods(hmAotTranslator* translator);
+static hmError hmAotFlush(hmAotTranslator* translator);
+static hmError hmAotEmitPrototype(hmStringBuilder* code, hmAotMethod* method);
+static hmError hmAotEmitMethod(hmStringBuilder* code, hmAotMethod* method, hmVerifiedMethodBody* verified_body);
+static hmError hmAotEmitInstruction(hmStringBuilder* code, hmVerifiedInstruction* instruction);
+static hmError hmAotEmitCall(hmStringBuilder* code, hmVerifiedInstruction* instruction);
+static hmError hmAotEmitEntryPoint(hmStringBuilder* code, hmAotMethod* method);
+static hmError hmAotEmitVariables(hmStringBuilder* code, const char* prefix, hm_nint count);
+static hmError hmAotEmitAssignment(hmStringBuilder* code, const char* dest, hm_nint dest_index, const char* source, hm_nint source_index);
+static hmError hmAotEmitConstant(hmStringBuilder* code, hm_nint dest_index, hm_uint64 value);
+static hmError hmAotAppendSymbolName(hmStringBuilder* code, hmString* module_name, hmString* class_name, hmString* method_name);
+static hmError hmAotAppendName(hmStringBuilder* code, hmString* name);
+static hmError hmAotStartCompiler(
+    hmAllocator* allocator,
+    hmString*    compiler_path,
+    hmString*    c_file_path,
+    hmString*    shared_object_path
+);
+
+hmError hmAotTranslateImage(hmAllocator* allocator, hmMetadataLoader* metadata_loader, hmWriter* writer)
+{
+    hmAotTranslator translator;
+    HM_TRY(hmCreateAotTranslator(allocator, metadata_loader, writer, &translator));
+    /* Declarations are collected first, so that calls can be resolved regardless of the order of methods. */
+    hmError err = hmMetadataLoaderEnumJoinedMetadata(
+        metadata_loader,
+        &hmAot_enumModulesFunc,
+        &hmAot_enumClassesFunc,
+        &hmAot_enumMethodsFunc,
+        &translator
+    );
+    if (err == HM_OK) {
+        err = hmAotTranslateMethods(&translator);
+    }
+    return hmMergeErrors(err, hmAotTranslatorDispose(&translator));
+}
+
+hmError hmAotCompileImage(
+    hmAllocator*      allocator,
+    hmMetadataLoader* metadata_loader,
+    hmString*         compiler_path,
+    hmString*         c_file_path,
+    hmString*         shared_object_path
+)
+{
+    hmWriter file_writer;
+    HM_TRY(hmCreateFileWriter(allocator, c_file_path, HM_FALSE, &file_writer));
+    hmWriter writer;
+    hmError err = hmCreateBufferedWriter(
+        allocator,
+        file_writer,
+        HM_TRUE, /* close_inner_writer */
+        HM_WRITER_DEFAULT_BUFFER_SIZE,
+        0,       /* low_watermark */
+        &writer
+    );
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmWriterClose(&file_writer));
+    }
+    err = hmAotTranslateImage(allocator, metadata_loader, &writer);
+    err = hmMergeErrors(err, hmWriterClose(&writer)); /* Flushes the rest of the code. */
+    HM_TRY(err);
+    return hmAotStartCompiler(allocator, compiler_path, c_file_path, shared_object_path);
+}
+
+hmError hmLoadAotImage(hmAllocator* allocator, hmString* path, hmAotImage* in_image)
+{
+    HM_TRY(hmLoadNativeLibrary(path, &in_image->library));
+    in_image->allocator = allocator;
+    return HM_OK;
+}
+
+hmError hmAotImageDispose(hmAotImage* image)
+{
+    return hmNativeLibraryDispose(&image->library);
+}
+
+hmError hmAotImageBindModules(hmAotImage* image, hmModuleRegistry* registry, hm_nint* out_bound_count_opt)
+{
+    hmAotBindContext context;
+    context.image = image;
+    context.module = HM_NULL;
+    context.hm_class = HM_NULL;
+    context.bound_count = 0;
+    HM_TRY(hmCreateStringBuilder(image->allocator, &context.symbol_name));
+    hmError err = hmHashMapEnumerate(&registry->modules, &hmAot_bindModuleFunc, &context);
+    if (out_bound_count_opt) {
+        *out_bound_count_opt = context.bound_count;
+    }
+    return hmMergeErrors(err, hmStringBuilderDispose(&context.symbol_name));
+}
+
+static hmError hmAot_enumModulesFunc(hmModuleMetadata* metadata, void* user_data)
+{
+    hmAotTranslator* translator = (hmAotTranslator*)user_data;
+    return hmStringDuplicate(&translator->arena, &metadata->name, &translator->module_name);
+}
+
+static hmError hmAot_enumClassesFunc(hmClassMetadata* metadata, void* user_data)
+{
+    hmAotTranslator* translator = (hmAotTranslator*)user_data;
+    return hmStringDuplicate(&translator->arena, &metadata->name, &translator->class_name);
+}
+
+/* Names of modules and classes come from the loader as is, so they're validated here, just like the name of the method. */
+static hmError hmAot_enumMethodsFunc(hmMethodMetadata* metadata, void* user_data)
+{
+    hmAotTranslator* translator = (hmAotTranslator*)user_data;
+    HM_TRY(hmValidateMetadataName(&translator->module_name));
+    HM_TRY(hmValidateMetadataName(&translator->class_name));
+    HM_TRY(hmValidateMetadataName(&metadata->name));
+    if (hmHashMapContains(&translator->method_indices, &metadata->method_id)) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hmAotMethod method;
+    method.method_id = metadata->method_id;
+    HM_TRY(hmSignatureTableIntern(&translator->signatures, &metadata->signature, &method.signature));
+    hmStringBuilder symbol_name;
+    HM_TRY(hmCreateStringBuilder(&translator->arena, &symbol_name));
+    /* The arena frees everything at once, so the string builder isn't disposed of. */
+    HM_TRY(hmAotAppendSymbolName(&symbol_name, &translator->module_name, &translator->class_name, &metadata->name));
+    HM_TRY(hmStringBuilderToString(&symbol_name, HM_NULL, &method.symbol_name));
+    hm_nint index = hmArrayGetCount(&translator->methods);
+    HM_TRY(hmArrayAdd(&translator->methods, &method));
+    return hmHashMapPut(&translator->method_indices, &method.method_id, &index);
+}
+
+static hmError hmAot_loadMethodBodyFunc(hmMethodBodyMetadata* body, void* user_data)
+{
+    hmAotTranslator* translator = (hmAotTranslator*)user_data;
+    hmAotMethod* method = translator->current_method_opt;
+    hmMethodBody hl_body;
+    hl_body.opcodes = (hm_uint8*)body->opcodes; /* The verifier only reads them. */
+    hl_body.size = body->size;
+    hmVerifiedMethodBody verified_body;
+    HM_TRY(hmVerifyMethodBody(
+        translator->allocator,
+        &hl_body,
+        method->signature,
+        &hmAot_resolveCallTargetFunc,
+        translator,
+        &verified_body
+    ));
+    hmError err = hmAotEmitMethod(&translator->code, method, &verified_body);
+    return hmMergeErrors(err, hmVerifiedMethodBodyDispose(&verified_body));
+}
+
+/* Calls are translated by method ID (see hmAotEmitCall(..)), so there are no hmMethod objects to resolve to. */
+static hmError hmAot_resolveCallTargetFunc(
+    hm_metadata_id method_id,
+    void*          user_data,
+    hmMethod**     out_method,
+    hmSignature**  out_signature
+)
+{
+    hmAotTranslator* translator = (hmAotTranslator*)user_data;
+    hm_nint index;
+    HM_TRY(hmHashMapGet(&translator->method_indices, &method_id, &index));
+    hmAotMethod* methods = hmArrayGetRaw(&translator->methods, hmAotMethod);
+    *out_method = HM_NULL;
+    *out_signature = methods[index].signature;
+    return HM_OK;
+}
+
+static hmError hmAot_bindModuleFunc(void* key, void* value, void* user_data)
+{
+    hmAotBindContext* context = (hmAotBindContext*)user_data;
+    hmCopyMemory(&context->module, value, sizeof(hmModule*)); /* Hashmap values aren't necessarily aligned. */
+    return hmHashMapEnumerate(&context->module->classes, &hmAot_bindClassFunc, context);
+}
+
+static hmError hmAot_bindClassFunc(void* key, void* value, void* user_data)
+{
+    hmAotBindContext* context = (hmAotBindContext*)user_data;
+    hmCopyMemory(&context->hm_class, value, sizeof(hmClass*));
+    return hmHashMapEnumerate(&context->hm_class->methods, &hmAot_bindMethodFunc, context);
+}
+
+static hmError hmAot_bindMethodFunc(void* key, void* value, void* user_data)
+{
+    hmAotBindContext* context = (hmAotBindContext*)user_data;
+    hmMethod* method;
+    hmCopyMemory(&method, value, sizeof(hmMethod*));
+    if (hmAtomicLoad(&method->jit_code_opt)) {
+        return HM_OK;
+    }
+    HM_TRY(hmStringBuilderClear(&context->symbol_name));
+    HM_TRY(hmAotAppendSymbolName(
+        &context->symbol_name,
+        hmModuleGetName(context->module),
+        &hmClassGetName(context->hm_class),
+        &hmMethodGetName(method)
+    ));
+    HM_TRY(hmStringBuilderAppendCStringWithLength(&context->symbol_name, "", 1)); /* The null terminator. */
+    void* code = HM_NULL;
+    hmError err = hmNativeLibraryGetSymbol(&context->image->library, hmStringBuilderGetChars(&context->symbol_name), &code);
+    if (err == HM_ERROR_NOT_FOUND) {
+        return HM_OK;
+    }
+    HM_TRY(err);
+    hmAtomicStoreRelease(&method->jit_code_opt, code);
+    context->bound_count++;
+    return HM_OK;
+}
+
+static hmError hmCreateAotTranslator(
+    hmAllocator*      allocator,
+    hmMetadataLoader* metadata_loader,
+    hmWriter*         writer,
+    hmAotTranslator*  in_translator
+)
+{
+    HM_TRY(hmCreateEmptyStringView(&in_translator->module_name));
+    HM_TRY(hmCreateEmptyStringView(&in_translator->class_name));
+    HM_TRY(hmCreateBumpPointerAllocator(allocator, HM_NINT_MAX, &in_translator->arena));
+    hm_bool are_signatures_created = HM_FALSE, is_code_created = HM_FALSE, are_methods_created = HM_FALSE;
+    hmError err = HM_OK;
+    HM_TRY_OR_FINALIZE(err, hmCreateSignatureTable(allocator, &in_translator->signatures));
+    are_signatures_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateStringBuilder(allocator, &in_translator->code));
+    is_code_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(allocator, sizeof(hmAotMethod), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &in_translator->methods));
+    are_methods_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateHashMap(
+        allocator,
+        &hmMetadataIDHashFunc,
+        &hmMetadataIDEqualsFunc,
+        HM_NULL, /* key_dispose_func */
+        HM_NULL, /* value_dispose_func */
+        sizeof(hm_metadata_id),
+        sizeof(hm_nint),
+        HM_HASHMAP_DEFAULT_CAPACITY,
+        HM_HASHMAP_DEFAULT_LOAD_FACTOR,
+        0,
+        &in_translator->method_indices
+    ));
+    in_translator->allocator = allocator;
+    in_translator->metadata_loader = metadata_loader;
+    in_translator->writer = writer;
+    in_translator->current_method_opt = HM_NULL;
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        if (are_methods_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&in_translator->methods));
+        }
+        if (is_code_created) {
+            err = hmMergeErrors(err, hmStringBuilderDispose(&in_translator->code));
+        }
+        if (are_signatures_created) {
+            err = hmMergeErrors(err, hmSignatureTableDispose(&in_translator->signatures));
+        }
+        err = hmMergeErrors(err, hmAllocatorDispose(&in_translator->arena));
+    }
+    return err;
+}
+
+static hmError hmAotTranslatorDispose(hmAotTranslator* translator)
+{
+    hmError err = hmHashMapDispose(&translator->method_indices);
+    err = hmMergeErrors(err, hmArrayDispose(&translator->methods));
+    err = hmMergeErrors(err, hmStringBuilderDispose(&translator->code));
+    err = hmMergeErrors(err, hmSignatureTableDispose(&translator->signatures));
+    return hmMergeErrors(err, hmAllocatorDispose(&translator->arena));
+}
+
+/* Bodies are loaded (and written out) one by one, so that only one of them is in memory at a time. */
+static hmError hmAotTranslateMethods(hmAotTranslator* translator)
+{
+    hmAotMethod* methods = hmArrayGetRaw(&translator->methods, hmAotMethod);
+    hm_nint method_count = hmArrayGetCount(&translator->methods);
+    HM_TRY(hmStringBuilderAppendCString(&translator->code, HM_AOT_PRELUDE));
+    for (hm_nint i = 0; i < method_count; i++) {
+        HM_TRY(hmAotEmitPrototype(&translator->code, &methods[i]));
+        HM_TRY(hmStringBuilderAppendCString(&translator->code, ";\n"));
+    }
+    HM_TRY(hmAotFlush(translator));
+    for (hm_nint i = 0; i < method_count; i++) {
+        translator->current_method_opt = &methods[i];
+        HM_TRY(hmMetadataLoaderLoadMethodBody(
+            translator->metadata_loader,
+            methods[i].method_id,
+            &hmAot_loadMethodBodyFunc,
+            translator
+        ));
+        HM_TRY(hmAotFlush(translator));
+    }
+    for (hm_nint i = 0; i < method_count; i++) {
+        HM_TRY(hmAotEmitEntryPoint(&translator->code, &methods[i]));
+    }
+    return hmAotFlush(translator);
+}
+
+static hmError hmAotFlush(hmAotTranslator* translator)
+{
+    HM_TRY(hmWriterWriteAll(
+        translator->writer,
+        hmStringBuilderGetChars(&translator->code),
+        hmStringBuilderGetLengthInBytes(&translator->code)
+    ));
+    return hmStringBuilderClear(&translator->code);
+}
+
+/* Arguments are passed by value, and the return value (if any) is stored to `result`. All values are 64-bit: 32-bit
+   values are sign-extended, just like in the registers of the interpreter. */
+static hmError hmAotEmitPrototype(hmStringBuilder* code, hmAotMethod* method)
+{
+    HM_TRY(hmStringBuilderAppendCString(code, "static unsigned char " HM_AOT_FUNCTION_PREFIX));
+    HM_TRY(hmStringBuilderAppendUint64(code, method->method_id));
+    HM_TRY(hmStringBuilderAppendCString(code, "(uint64_t* result, uint32_t stack_left"));
+    for (hm_nint i = 0; i < method->signature->param_count; i++) {
+        HM_TRY(hmStringBuilderAppendCString(code, ", uint64_t a"));
+        HM_TRY(hmStringBuilderAppendUint64(code, i));
+    }
+    return hmStringBuilderAppendCString(code, ")");
+}
+
+/* Values on the evaluation stack become variables named after their stack depth ("s0", "s1", etc.), just like they're
+   assigned to registers by hmLowerMethodBody(..); arguments and locals are named "a0", "l0", etc. It's up to the C
+   compiler to allocate registers. */
+static hmError hmAotEmitMethod(hmStringBuilder* code, hmAotMethod* method, hmVerifiedMethodBody* verified_body)
+{
+    HM_TRY(hmAotEmitPrototype(code, method));
+    HM_TRY(hmStringBuilderAppendCString(code, "\n{\n"));
+    HM_TRY(hmAotEmitVariables(code, "l", hmVerifiedMethodBodyGetLocalCount(verified_body)));
+    HM_TRY(hmAotEmitVariables(code, "s", verified_body->max_stack_depth));
+    /* See HM_AOT_MAX_STACK_SIZE */
+    hm_nint variable_count, frame_size;
+    HM_TRY(hmAddNint3(
+        method->signature->param_count,
+        hmVerifiedMethodBodyGetLocalCount(verified_body),
+        verified_body->max_stack_depth,
+        &variable_count
+    ));
+    HM_TRY(hmMulNint(variable_count, sizeof(hm_uint64), &frame_size));
+    HM_TRY(hmAddNint(frame_size, HM_AOT_FRAME_OVERHEAD, &frame_size));
+    HM_TRY(hmStringBuilderAppendCString(code, "    if (stack_left < "));
+    HM_TRY(hmStringBuilderAppendUint64(code, frame_size));
+    HM_TRY(hmStringBuilderAppendCString(code, "u) {\n        return "));
+    HM_TRY(hmStringBuilderAppendUint64(code, HM_ERROR_LIMIT_EXCEEDED));
+    HM_TRY(hmStringBuilderAppendCString(code, ";\n    }\n    stack_left -= "));
+    HM_TRY(hmStringBuilderAppendUint64(code, frame_size));
+    HM_TRY(hmStringBuilderAppendCString(code, "u;\n"));
+    hmVerifiedInstruction* instructions = hmArrayGetRaw(&verified_body->instructions, hmVerifiedInstruction);
+    for (hm_nint i = 0; i < hmArrayGetCount(&verified_body->instructions); i++) {
+        HM_TRY(hmAotEmitInstruction(code, &instructions[i]));
+    }
+    /* Falling off the end returns from the method, with the return value (if any) left in the first stack slot. */
+    if (method->signature->return_type != HM_VALUE_TYPE_VOID) {
+        HM_TRY(hmStringBuilderAppendCString(code, "    *result = s0;\n"));
+    } else {
+        HM_TRY(hmStringBuilderAppendCString(code, "    (void)result;\n"));
+    }
+    return hmStringBuilderAppendCString(code, "    return 0;\n}\n\n");
+}
+
+static hmError hmAotEmitInstruction(hmStringBuilder* code, hmVerifiedInstruction* instruction)
+{
+    hm_nint depth = instruction->stack_depth;
+    hm_nint operand = (hm_nint)instruction->operand;
+    switch (instruction->opcode) {
+        case HM_HLOPCODE_STLOC:
+            return hmAotEmitAssignment(code, "l", operand, "s", depth - 1);
+        case HM_HLOPCODE_LDARG:
+            return hmAotEmitAssignment(code, "s", depth, "a", operand);
+        case HM_HLOPCODE_LDLOC:
+            return hmAotEmitAssignment(code, "s", depth, "l", operand);
+        case HM_HLOPCODE_STARG:
+            return hmAotEmitAssignment(code, "a", operand, "s", depth - 1);
+        case HM_HLOPCODE_LDC32:
+            {
+                hm_uint32 bits = (hm_uint32)instruction->operand;
+                hm_int32 value;
+                hmCopyMemory(&value, &bits, sizeof(value));
+                return hmAotEmitConstant(code, depth, (hm_uint64)(hm_int64)value);
+            }
+        case HM_HLOPCODE_LDC64:
+            return hmAotEmitConstant(code, depth, instruction->operand);
+        case HM_HLOPCODE_DUP:
+            return hmAotEmitAssignment(code, "s", depth, "s", depth - 1);
+        case HM_HLOPCODE_CALL:
+            return hmAotEmitCall(code, instruction);
+        default: /* nop, pop */
+            return HM_OK;
+    }
+}
+
+/* Arguments are the topmost values on the stack, and the return value replaces the first of them. */
+static hmError hmAotEmitCall(hmStringBuilder* code, hmVerifiedInstruction* instruction)
+{
+    hm_nint first_arg_depth = instruction->stack_depth - instruction->popped_count;
+    HM_TRY(hmStringBuilderAppendCString(code, "    HM_AOT_CALL(" HM_AOT_FUNCTION_PREFIX));
+    HM_TRY(hmStringBuilderAppendUint64(code, instruction->operand));
+    if (instruction->pushed_type != HM_VALUE_TYPE_VOID) {
+        HM_TRY(hmStringBuilderAppendCString(code, "(&s"));
+        HM_TRY(hmStringBuilderAppendUint64(code, first_arg_depth));
+    } else {
+        HM_TRY(hmStringBuilderAppendCString(code, "(0"));
+    }
+    HM_TRY(hmStringBuilderAppendCString(code, ", stack_left"));
+    for (hm_nint i = first_arg_depth; i < instruction->stack_depth; i++) {
+        HM_TRY(hmStringBuilderAppendCString(code, ", s"));
+        HM_TRY(hmStringBuilderAppendUint64(code, i));
+    }
+    return hmStringBuilderAppendCString(code, "));\n");
+}
+
+/* The entry point follows the calling convention of hmJitCode: arguments are read from the registers, and the return
+   value is stored to the first one. */
+static hmError hmAotEmitEntryPoint(hmStringBuilder* code, hmAotMethod* method)
+{
+    HM_TRY(hmStringBuilderAppendCString(code, "unsigned char "));
+    HM_TRY(hmStringBuilderAppendCStringWithLength(
+        code,
+        hmStringGetCString(&method->symbol_name),
+        hmStringGetLengthInBytes(&method->symbol_name)
+    ));
+    HM_TRY(hmStringBuilderAppendCString(code, "(uint64_t* registers, void* interpreter)\n{\n"));
+    HM_TRY(hmStringBuilderAppendCString(code, "    (void)interpreter;\n    return " HM_AOT_FUNCTION_PREFIX));
+    HM_TRY(hmStringBuilderAppendUint64(code, method->method_id));
+    HM_TRY(hmStringBuilderAppendCString(code, "(registers, "));
+    HM_TRY(hmStringBuilderAppendUint64(code, HM_AOT_MAX_STACK_SIZE));
+    for (hm_nint i = 0; i < method->signature->param_count; i++) {
+        HM_TRY(hmStringBuilderAppendCString(code, ", registers["));
+        HM_TRY(hmStringBuilderAppendUint64(code, i));
+        HM_TRY(hmStringBuilderAppendCString(code, "]"));
+    }
+    return hmStringBuilderAppendCString(code, ");\n}\n\n");
+}
+
+static hmError hmAotEmitVariables(hmStringBuilder* code, const char* prefix, hm_nint count)
+{
+    if (!count) {
+        return HM_OK;
+    }
+    HM_TRY(hmStringBuilderAppendCString(code, "    uint64_t "));
+    for (hm_nint i = 0; i < count; i++) {
+        HM_TRY(hmStringBuilderAppendCStrings(code, i ? ", " : "", prefix, HM_NULL));
+        HM_TRY(hmStringBuilderAppendUint64(code, i));
+    }
+    return hmStringBuilderAppendCString(code, ";\n");
+}
+
+static hmError hmAotEmitAssignment(hmStringBuilder* code, const char* dest, hm_nint dest_index, const char* source, hm_nint source_index)
+{
+    HM_TRY(hmStringBuilderAppendCStrings(code, "    ", dest, HM_NULL));
+    HM_TRY(hmStringBuilderAppendUint64(code, dest_index));
+    HM_TRY(hmStringBuilderAppendCStrings(code, " = ", source, HM_NULL));
+    HM_TRY(hmStringBuilderAppendUint64(code, source_index));
+    return hmStringBuilderAppendCString(code, ";\n");
+}
+
+static hmError hmAotEmitConstant(hmStringBuilder* code, hm_nint dest_index, hm_uint64 value)
+{
+    HM_TRY(hmStringBuilderAppendCString(code, "    s"));
+    HM_TRY(hmStringBuilderAppendUint64(code, dest_index));
+    HM_TRY(hmStringBuilderAppendCString(code, " = UINT64_C(0x"));
+    HM_TRY(hmStringBuilderAppendHex(code, value));
+    return hmStringBuilderAppendCString(code, ");\n");
+}
+
+/* Names are prefixed with their lengths: otherwise, for example, "a_b.c" and "a.b_c" would clash. */
+static hmError hmAotAppendSymbolName(hmStringBuilder* code, hmString* module_name, hmString* class_name, hmString* method_name)
+{
+    HM_TRY(hmStringBuilderAppendCString(code, HM_AOT_SYMBOL_PREFIX));
+    HM_TRY(hmAotAppendName(code, module_name));
+    HM_TRY(hmAotAppendName(code, class_name));
+    return hmAotAppendName(code, method_name);
+}
+
+static hmError hmAotAppendName(hmStringBuilder* code, hmString* name)
+{
+    hm_nint length = hmStringGetLengthInBytes(name);
+    HM_TRY(hmStringBuilderAppendUint64(code, length));
+    return hmStringBuilderAppendCStringWithLength(code, hmStringGetCString(name), length);
+}
+
+/* Equivalent to: cc -O2 -shared -fPIC -o <shared_object_path> -x c <c_file_path> (the source file is compiled as C
+   regardless of its extension). */
+static hmError hmAotStartCompiler(
+    hmAllocator* allocator,
+    hmString*    compiler_path,
+    hmString*    c_file_path,
+    hmString*    shared_object_path
+)
+{
+    const char* options[] = { "-O2", "-shared", "-fPIC", "-o", HM_NULL, "-x", "c", HM_NULL };
+    hmString* paths[] = { shared_object_path, c_file_path }; /* In place of HM_NULL in `options`. */
+    hm_nint option_count = sizeof(options) / sizeof(options[0]);
+    hmArray args;
+    HM_TRY(hmCreateArray(allocator, sizeof(hmString), option_count, HM_NULL, &args));
+    hmError err = HM_OK;
+    hm_nint path_index = 0;
+    for (hm_nint i = 0; i < option_count; i++) {
+        hmString option;
+        if (options[i]) {
+            HM_TRY_OR_FINALIZE(err, hmCreateStringViewFromCString(options[i], &option));
+        } else {
+            option = *paths[path_index++]; /* Copied as a view: the array doesn't own its strings. */
+        }
+        HM_TRY_OR_FINALIZE(err, hmArrayAdd(&args, &option));
+    }
+    hmProcess process;
+    HM_TRY_OR_FINALIZE(err, hmStartProcess(allocator, compiler_path, &args, HM_NULL, &process));
+    if (!hmProcessHasExited(&process) || hmProcessGetExitCode(&process) != 0) {
+        err = HM_ERROR_PLATFORM_DEPENDENT;
+    }
+    err = hmMergeErrors(err, hmProcessDispose(&process));
+HM_ON_FINALIZE
+    return hmMergeErrors(err, hmArrayDispose(&args));
+}
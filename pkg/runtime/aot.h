@@ -0,0 +1,76 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_AOT_H
+#define HM_AOT_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <core/nativelibrary.h>
+#include <core/string.h>
+#include <io/writer.h>
+#include <runtime/metadata.h>
+#include <runtime/moduleregistry.h>
+
+/* How much of the native stack of the thread ahead-of-time compiled code can use, in bytes, before HM_ERROR_LIMIT_EXCEEDED
+   is returned. Frames differ in size (a method can have thousands of locals), so it's their total size which is
+   limited rather than the depth of calls: every method accounts for its arguments, locals and evaluation stack, plus
+   HM_AOT_FRAME_OVERHEAD. The budget is passed from caller to callee, starting from the entry point (see below); compiled
+   code never calls back into the runtime, so only one chain of such calls can be on the stack of a thread at a time.
+   The limit is well below HM_COROUTINE_DEFAULT_STACK_SIZE, so that compiled code can run in coroutines too. */
+#define HM_AOT_MAX_STACK_SIZE (64*1024)
+/* An estimate of what a C function needs on the stack besides its variables: the return address, saved registers, etc. */
+#define HM_AOT_FRAME_OVERHEAD 64
+
+/* Ahead-of-time compilation: every method of an image is verified (see hmVerifyMethodBody(..)) and translated into
+   a C function, and the result is built with the system C compiler into a shared object. Loaded back into the runtime
+   (see hmLoadAotImage(..)), the shared object provides native code for the methods of the image right away, so that
+   deployments don't have to wait for the JIT to warm up. Compiled methods call each other directly, as plain C functions.
+   Every method gets an exported entry point with the same calling convention as JIT-compiled code (see hmJitCode), whose
+   name is derived from the names of the module, the class and the method: since metadata names are valid C identifiers
+   (see hmValidateMetadataName(..)), they're embedded as is, each prefixed with its length to keep names unambiguous
+   (for example, "hm_aot_4Main7Program4main"). */
+
+/* Translates all the methods of the image into C source code, written to `writer`. Returns HM_ERROR_INVALID_DATA if
+   a signature is malformed or a method fails verification. */
+hmError hmAotTranslateImage(hmAllocator* allocator, hmMetadataLoader* metadata_loader, hmWriter* writer);
+/* Translates the image into C (see hmAotTranslateImage(..)), saves the source code to `c_file_path`, and builds it
+   with the C compiler at `compiler_path` (an absolute path, for example, "/usr/bin/cc"; the compiler must accept
+   GCC-style options) into a shared object at `shared_object_path`. Returns HM_ERROR_NOT_FOUND if there's no compiler
+   at the given path, and HM_ERROR_PLATFORM_DEPENDENT if the compiler fails. */
+hmError hmAotCompileImage(
+    hmAllocator*      allocator,
+    hmMetadataLoader* metadata_loader,
+    hmString*         compiler_path,
+    hmString*         c_file_path,
+    hmString*         shared_object_path
+);
+
+/* A shared object built with hmAotCompileImage(..), loaded into the current process. */
+typedef struct {
+    hmAllocator*    allocator;
+    hmNativeLibrary library;
+} hmAotImage;
+
+/* Returns HM_ERROR_NOT_FOUND if there's no such file. See hmLoadNativeLibrary(..) */
+hmError hmLoadAotImage(hmAllocator* allocator, hmString* path, hmAotImage* in_image);
+/* Native code of the methods bound to the image becomes invalid, so it must be disposed of after the module registry. */
+hmError hmAotImageDispose(hmAotImage* image);
+/* Binds ahead-of-time compiled code to every method in the registry which has an entry point in the image: the
+   interpreter then calls native code instead of interpreting such methods (the methods must still have low-level
+   bodies which describe their frames, see hmMethodSetLLBody(..)). Methods which are already compiled by the JIT, or are
+   missing from the image, are left as they are. The image must be built from the same metadata the registry is loaded
+   with. `out_bound_count_opt` receives the number of bound methods. Not thread-safe. */
+hmError hmAotImageBindModules(hmAotImage* image, hmModuleRegistry* registry, hm_nint* out_bound_count_opt);
+
+#endif /* HM_AOT_H */
@@ -12,3 +12,66 @@
 * ******************************************************************************/
 
 #include <runtime/class.h>
+#include <core/utils.h>
+#include <runtime/metadata.h>
+
+static hmError hmClass_disposeMethodFunc(void* object);
+
+hmError hmCreateClass(hmAllocator* allocator, hm_metadata_id class_id, hmString* name, hmClass* in_class)
+{
+    HM_TRY(hmValidateMetadataName(name));
+    HM_TRY(hmStringDuplicate(allocator, name, &in_class->name));
+    hmError err = hmCreateHashMap(
+        allocator,
+        &hmMetadataIDHashFunc,
+        &hmMetadataIDEqualsFunc,
+        HM_NULL,                    /* key_dispose_func */
+        &hmClass_disposeMethodFunc, /* value_dispose_func */
+        sizeof(hm_metadata_id),
+        sizeof(hmMethod*),
+        HM_HASHMAP_DEFAULT_CAPACITY,
+        HM_HASHMAP_DEFAULT_LOAD_FACTOR,
+        0,
+        &in_class->methods
+    );
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmStringDispose(&in_class->name));
+    }
+    in_class->allocator = allocator;
+    in_class->class_id = class_id;
+    return HM_OK;
+}
+
+hmError hmClassDispose(hmClass* hm_class)
+{
+    hmError err = hmStringDispose(&hm_class->name);
+    return hmMergeErrors(err, hmHashMapDispose(&hm_class->methods));
+}
+
+hmError hmClassDisposeFunc(void* object)
+{
+    return hmClassDispose((hmClass*)object);
+}
+
+hmError hmClassAddMethod(hmClass* hm_class, hmMethod* method)
+{
+    if (hmHashMapContains(&hm_class->methods, &method->method_id)) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    return hmHashMapPut(&hm_class->methods, &method->method_id, &method);
+}
+
+hmError hmClassGetMethod(hmClass* hm_class, hm_metadata_id method_id, hmMethod** out_method)
+{
+    return hmHashMapGet(&hm_class->methods, &method_id, out_method);
+}
+
+static hmError hmClass_disposeMethodFunc(void* object)
+{
+    hmMethod* method;
+    hmCopyMemory(&method, object, sizeof(hmMethod*)); /* Hashmap values aren't necessarily aligned. */
+    hmAllocator* allocator = method->allocator;
+    hmError err = hmMethodDispose(method);
+    hmFree(allocator, method);
+    return err;
+}
@@ -14,17 +14,29 @@
 #ifndef HM_CLASS_H
 #define HM_CLASS_H
 
+#include <core/allocator.h>
 #include <core/string.h>
 #include <collections/hashmap.h>
 #include <runtime/common.h>
+#include <runtime/method.h>
 
 typedef struct hmClass_ {
+    hmAllocator*   allocator;
     hmString       name;    /* The name of the class (NOT fully qualified, for example: "StringBuilder"). The name
                                should be unique in a given module. */
     hmHashMap      methods; /* hmHashMap<hm_metadata_id, hmMethod*> */
     hm_metadata_id class_id;
 } hmClass;
 
+hmError hmCreateClass(hmAllocator* allocator, hm_metadata_id class_id, hmString* name, hmClass* in_class);
+hmError hmClassDispose(hmClass* hm_class);
+hmError hmClassDisposeFunc(void* object);
+/* Adds a method created with hmCreateMethod(..) to the class. On success, the class takes ownership of the method
+   (which must be allocated with the allocator of the method). Returns HM_ERROR_INVALID_DATA if the class already has
+   a method with the same ID. */
+hmError hmClassAddMethod(hmClass* hm_class, hmMethod* method);
+/* Returns HM_ERROR_NOT_FOUND if there's no such method. The returned reference is valid as long as the class is. */
+hmError hmClassGetMethod(hmClass* hm_class, hm_metadata_id method_id, hmMethod** out_method);
 #define hmClassGetName(hm_class) (hm_class)->name
 #define hmClassGetID(hm_class) (hm_class)->class_id
 
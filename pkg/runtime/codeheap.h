@@ -0,0 +1,44 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_CODE_HEAP_H
+#define HM_CODE_HEAP_H
+
+#include <core/common.h>
+
+/* A region of executable memory for generated machine code. The whole region is reserved upfront (without committing
+   any memory), and code is appended to it with a bump pointer, so small pieces of code share pages. The region is
+   mapped twice: code is written through a view which is writable but not executable, and executed from a view which
+   is executable but not writable, so no address is ever writable and executable at the same time (W^X), and adding
+   code needs no system calls. Since code is only ever appended, code which is already executing, possibly on another
+   thread, is never affected. */
+typedef struct {
+    hm_uint8* base;          /* The executable view. */
+    hm_uint8* writable_base; /* The writable view of the same memory. */
+    hm_nint   capacity;      /* How much code fits, in bytes. */
+    hm_nint   mapping_size;  /* The size of each view: `capacity` rounded up to the page size. */
+    hm_nint   size;          /* How much of the region is used, in bytes. */
+} hmCodeHeap;
+
+/* Every piece of code is aligned to that many bytes, as recommended for function entry points on x86-64. */
+#define HM_CODE_HEAP_ALIGNMENT 16
+
+/* `capacity` is the maximum total size of the code, in bytes (including padding for alignment). */
+hmError hmCreateCodeHeap(hm_nint capacity, hmCodeHeap* in_code_heap);
+hmError hmCodeHeapDispose(hmCodeHeap* code_heap);
+/* Copies `code` to the heap and makes it executable. `out_code` receives the address of the copy, which stays valid
+   until the heap is disposed of. Returns HM_ERROR_LIMIT_EXCEEDED if the heap is full. Not thread-safe, but code can be
+   executed by other threads while it's being added. */
+hmError hmCodeHeapAddCode(hmCodeHeap* code_heap, const hm_uint8* code, hm_nint size, void** out_code);
+
+#endif /* HM_CODE_HEAP_H */
@@ -0,0 +1,151 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/executioncontext.h>
+
+/* The pool itself is small: contexts are big, and there are usually as many of them as there are worker threads. */
+#define HM_EXECUTION_CONTEXT_POOL_INITIAL_CAPACITY 16
+
+static hmError hmExecutionContextPoolCreateContext(hmExecutionContextPool* pool, hmExecutionContext** out_context);
+static hmError hmDisposeExecutionContext(hmAllocator* allocator, hmExecutionContext* context);
+
+hmError hmCreateExecutionContext(
+    hmAllocator*        allocator,
+    hm_nint             register_count,
+    hm_nint             frame_count,
+    hmExecutionContext* in_context
+)
+{
+    HM_TRY(hmCreateInterpreter(allocator, register_count, frame_count, HM_NULL, HM_NULL, HM_NULL, &in_context->interpreter));
+    hmError err = hmCreateBumpPointerAllocator(allocator, HM_NINT_MAX, &in_context->arena);
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmInterpreterDispose(&in_context->interpreter));
+    }
+    err = hmCreateStringPool(allocator, HM_STRING_POOL_DEFAULT_CAPACITY, 0, &in_context->string_pool);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmAllocatorDispose(&in_context->arena));
+        return hmMergeErrors(err, hmInterpreterDispose(&in_context->interpreter));
+    }
+    in_context->allocator = allocator;
+    return HM_OK;
+}
+
+hmError hmExecutionContextDispose(hmExecutionContext* context)
+{
+    hmError err = hmStringPoolDispose(&context->string_pool);
+    err = hmMergeErrors(err, hmAllocatorDispose(&context->arena));
+    return hmMergeErrors(err, hmInterpreterDispose(&context->interpreter));
+}
+
+hmError hmExecutionContextReset(hmExecutionContext* context)
+{
+    hmBumpPointerAllocatorReset(&context->arena);
+    return hmStringPoolReset(&context->string_pool);
+}
+
+hmError hmCreateExecutionContextPool(
+    hmAllocator*            allocator,
+    hm_nint                 register_count,
+    hm_nint                 frame_count,
+    hmExecutionContextPool* in_pool
+)
+{
+    if (!register_count || !frame_count) {
+        return HM_ERROR_INVALID_ARGUMENT; /* Validated early, instead of on first use. */
+    }
+    HM_TRY(hmCreateMutex(allocator, &in_pool->mutex));
+    hmError err = hmCreateArray(
+        allocator,
+        sizeof(hmExecutionContext*),
+        HM_EXECUTION_CONTEXT_POOL_INITIAL_CAPACITY,
+        HM_NULL,
+        &in_pool->free_contexts
+    );
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmMutexDispose(&in_pool->mutex));
+    }
+    in_pool->allocator = allocator;
+    in_pool->register_count = register_count;
+    in_pool->frame_count = frame_count;
+    in_pool->acquired_count = 0;
+    in_pool->created_count = 0;
+    return HM_OK;
+}
+
+hmError hmExecutionContextPoolDispose(hmExecutionContextPool* pool)
+{
+    if (pool->acquired_count) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    hmError err = HM_OK;
+    hmExecutionContext** contexts = hmArrayGetRaw(&pool->free_contexts, hmExecutionContext*);
+    for (hm_nint i = 0; i < hmArrayGetCount(&pool->free_contexts); i++) {
+        err = hmMergeErrors(err, hmDisposeExecutionContext(pool->allocator, contexts[i]));
+    }
+    err = hmMergeErrors(err, hmArrayDispose(&pool->free_contexts));
+    return hmMergeErrors(err, hmMutexDispose(&pool->mutex));
+}
+
+hmError hmExecutionContextPoolAcquire(hmExecutionContextPool* pool, hmExecutionContext** out_context)
+{
+    HM_TRY(hmMutexLock(&pool->mutex));
+    hmError err = hmArrayRemoveLast(&pool->free_contexts, out_context);
+    if (err == HM_ERROR_INVALID_STATE) {
+        /* Creation is relatively slow, but it only happens until there are enough contexts for all the threads. */
+        err = hmExecutionContextPoolCreateContext(pool, out_context);
+    }
+    if (err == HM_OK) {
+        pool->acquired_count++;
+    }
+    return hmMergeErrors(err, hmMutexUnlock(&pool->mutex));
+}
+
+hmError hmExecutionContextPoolRelease(hmExecutionContextPool* pool, hmExecutionContext* context)
+{
+    hmError err = hmExecutionContextReset(context); /* Outside of the lock. */
+    HM_TRY(hmMutexLock(&pool->mutex));
+    /* Adding can only fail if the array has to grow, which is unlikely, as it's never shrunk. In either case, the
+       context is disposed of: it will be recreated if needed. */
+    if (err == HM_OK) {
+        err = hmArrayAdd(&pool->free_contexts, &context);
+    }
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmDisposeExecutionContext(pool->allocator, context));
+        pool->created_count--;
+    }
+    pool->acquired_count--;
+    return hmMergeErrors(err, hmMutexUnlock(&pool->mutex));
+}
+
+static hmError hmExecutionContextPoolCreateContext(hmExecutionContextPool* pool, hmExecutionContext** out_context)
+{
+    hmExecutionContext* context = (hmExecutionContext*)hmAlloc(pool->allocator, sizeof(hmExecutionContext));
+    if (!context) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmCreateExecutionContext(pool->allocator, pool->register_count, pool->frame_count, context);
+    if (err != HM_OK) {
+        hmFree(pool->allocator, context);
+        return err;
+    }
+    pool->created_count++;
+    *out_context = context;
+    return HM_OK;
+}
+
+static hmError hmDisposeExecutionContext(hmAllocator* allocator, hmExecutionContext* context)
+{
+    hmError err = hmExecutionContextDispose(context);
+    hmFree(allocator, context);
+    return err;
+}
@@ -0,0 +1,88 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_EXECUTION_CONTEXT_H
+#define HM_EXECUTION_CONTEXT_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <core/stringpool.h>
+#include <collections/array.h>
+#include <threading/mutex.h>
+#include <runtime/interpreter.h>
+
+/* Everything a thread needs to execute code: the interpreter with its register and frame stacks, a scratch arena for
+   temporary objects of the current request, and a string pool for strings interned during the request. Setting all of this up is relatively expensive (the
+   stacks alone measure in hundreds of kilobytes), so contexts are meant to be reused, see hmExecutionContextPool.
+   A context is not thread-safe: it's used by one thread at a time. */
+typedef struct {
+    hmAllocator*  allocator;
+    hmInterpreter interpreter;
+    hmAllocator   arena;       /* A bump pointer allocator: freed at once with hmExecutionContextReset(..) */
+    hmStringPool  string_pool; /* Reset together with the arena, so it doesn't grow with every request the context serves. */
+} hmExecutionContext;
+
+/* `register_count` and `frame_count` are passed to hmCreateInterpreter(..) (see). The interpreter is created without a
+   JIT: a context can move from thread to thread, while a JIT is bound to one. */
+hmError hmCreateExecutionContext(
+    hmAllocator*        allocator,
+    hm_nint             register_count,
+    hm_nint             frame_count,
+    hmExecutionContext* in_context
+);
+hmError hmExecutionContextDispose(hmExecutionContext* context);
+/* Frees everything allocated in the arena of the context and empties the string pool, keeping some memory for future
+   allocations (see hmBumpPointerAllocatorReset(..), hmStringPoolReset(..)) Should be called between requests, when no
+   code is running in the context. */
+hmError hmExecutionContextReset(hmExecutionContext* context);
+#define hmExecutionContextGetInterpreter(context) (&(context)->interpreter)
+#define hmExecutionContextGetArena(context) (&(context)->arena)
+#define hmExecutionContextGetStringPool(context) (&(context)->string_pool)
+
+typedef struct {
+    hmAllocator* allocator;
+    hmMutex      mutex;
+    hmArray      free_contexts;  /* hmArray<hmExecutionContext*> Released contexts; the last one is the most recently
+                                    used, so its memory is the most likely to be still in the cache. */
+    hm_nint      register_count;
+    hm_nint      frame_count;
+    hm_nint      acquired_count;
+    hm_nint      created_count;
+} hmExecutionContextPool;
+
+/* A pool of execution contexts shared by worker threads (see threading/worker.h, threading/workerpool.h). A worker
+   function acquires a context at the start of a work item and releases it at the end, so a work item runs on memory
+   which is already set up and warm. The pool creates at most as many contexts as there are work items in progress at
+   the same time, no matter how many items are processed overall: with N thread-based workers, that's at most N contexts.
+   Coroutine-based workers (see `coroutine_stack_size` in hmCreateWorker(..)) can have many items in progress, each
+   parked in its own coroutine (on a socket, for example) while holding its context, so the number of contexts is only
+   bounded by the number of parked coroutines; the pool doesn't cap it. Contexts are created on demand, with the given
+   `register_count` and `frame_count` (see hmCreateExecutionContext(..)) The allocator must be thread-safe. */
+hmError hmCreateExecutionContextPool(
+    hmAllocator*            allocator,
+    hm_nint                 register_count,
+    hm_nint                 frame_count,
+    hmExecutionContextPool* in_pool
+);
+/* Returns HM_ERROR_INVALID_STATE if some of the contexts haven't been released yet (nothing is disposed of in that case). */
+hmError hmExecutionContextPoolDispose(hmExecutionContextPool* pool);
+/* Returns a released context if there's any, otherwise creates a new one. The context is used exclusively by the
+   caller (a thread, or a coroutine) until it's released. Thread-safe. */
+hmError hmExecutionContextPoolAcquire(hmExecutionContextPool* pool, hmExecutionContext** out_context);
+/* Resets the context (see hmExecutionContextReset(..)) and returns it to the pool. If the context can't be reset, it's
+   disposed of instead (it will be recreated if needed) and the error is returned. Thread-safe. */
+hmError hmExecutionContextPoolRelease(hmExecutionContextPool* pool, hmExecutionContext* context);
+/* How many contexts the pool has created so far, for diagnostics and tests. Not synchronized. */
+#define hmExecutionContextPoolGetCreatedCount(pool) ((pool)->created_count)
+
+#endif /* HM_EXECUTION_CONTEXT_H */
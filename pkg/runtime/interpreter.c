@@ -0,0 +1,325 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/interpreter.h>
+#include <core/math.h>
+#include <core/utils.h>
+
+/* Labels as values (computed gotos) are a GNU extension, supported by GCC and Clang. */
+#if defined(__GNUC__)
+    #define HM_INTERPRETER_THREADED_DISPATCH
+#endif
+
+/* Operands are unaligned; copying them out compiles down to plain loads. */
+static hm_uint16 hmInterpreterReadRegisterIndex(const hm_uint8* ip);
+static hm_uint64 hmInterpreterReadConstant32(const hm_uint8* ip);
+static hm_uint64 hmInterpreterReadConstant64(const hm_uint8* ip);
+static hmMethod* hmInterpreterReadMethod(const hm_uint8* ip);
+static hmError hmInterpreterExecute(hmInterpreter* interpreter, hmLLMethodBody* body, hm_uint64* registers);
+static hmError hmInterpreterCompileMethod(hmInterpreter* interpreter, hmMethod* method, hmLLMethodBody** out_body);
+
+hmError hmCreateInterpreter(
+    hmAllocator*            allocator,
+    hm_nint                 register_count,
+    hm_nint                 frame_count,
+    hmJit*                  jit_opt,
+    hmResolveCallTargetFunc resolve_call_target_func_opt,
+    void*                   user_data,
+    hmInterpreter*          in_interpreter
+)
+{
+    if (!register_count || !frame_count) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hm_nint registers_size, frames_size;
+    HM_TRY(hmMulNint(register_count, sizeof(hm_uint64), &registers_size));
+    HM_TRY(hmMulNint(frame_count, sizeof(hmInterpreterFrame), &frames_size));
+    hm_uint64* registers = (hm_uint64*)hmAlloc(allocator, registers_size);
+    if (!registers) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmInterpreterFrame* frames = (hmInterpreterFrame*)hmAlloc(allocator, frames_size);
+    if (!frames) {
+        hmFree(allocator, registers);
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    in_interpreter->allocator = allocator;
+    in_interpreter->registers = registers;
+    in_interpreter->register_count = register_count;
+    in_interpreter->registers_end = registers + register_count;
+    in_interpreter->frames = frames;
+    in_interpreter->frame_count = frame_count;
+    in_interpreter->frames_end = frames + frame_count;
+    in_interpreter->next_frame = frames;
+    in_interpreter->is_running = HM_FALSE;
+    in_interpreter->jit_opt = jit_opt;
+    in_interpreter->resolve_call_target_func_opt = resolve_call_target_func_opt;
+    in_interpreter->user_data = user_data;
+    return HM_OK;
+}
+
+hmError hmInterpreterDispose(hmInterpreter* interpreter)
+{
+    hmFree(interpreter->allocator, interpreter->registers);
+    hmFree(interpreter->allocator, interpreter->frames);
+    return HM_OK;
+}
+
+#ifdef HM_INTERPRETER_THREADED_DISPATCH
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpedantic"
+    /* Every handler jumps straight to the handler of the next opcode. */
+    #define HM_OPCODE(name) hm_opcode_ ## name:
+    #define HM_DISPATCH() goto *dispatch_table[*ip]
+#else
+    #define HM_OPCODE(name) case HM_LLOPCODE_ ## name:
+    #define HM_DISPATCH() goto hm_dispatch
+#endif
+
+hmError hmInterpreterRun(hmInterpreter* interpreter, hmMethod* method, hm_uint64* args, hm_uint64* out_result_opt)
+{
+    if (interpreter->is_running) {
+        return HM_ERROR_INVALID_STATE; /* The registers and frames of the running method would be overwritten. */
+    }
+    hmLLMethodBody* body = hmMethodGetLLBody(method);
+    if (!body) {
+        HM_TRY(hmInterpreterCompileMethod(interpreter, method, &body));
+    }
+    if (body->register_count > interpreter->register_count) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hm_uint64* registers = interpreter->registers;
+    if (body->arg_count) {
+        hmCopyMemory(registers, args, body->arg_count * sizeof(hm_uint64));
+    }
+    interpreter->next_frame = interpreter->frames;
+    interpreter->is_running = HM_TRUE;
+    hmError err = hmInterpreterCall(registers, interpreter, method);
+    interpreter->is_running = HM_FALSE;
+    HM_TRY(err);
+    if (out_result_opt) {
+        *out_result_opt = body->return_type != HM_VALUE_TYPE_VOID ? registers[0] : 0;
+    }
+    return HM_OK;
+}
+
+hmError hmInterpreterCall(hm_uint64* registers, hmInterpreter* interpreter, hmMethod* method)
+{
+    hmLLMethodBody* body = hmMethodGetLLBody(method);
+    if (!body) {
+        HM_TRY(hmInterpreterCompileMethod(interpreter, method, &body));
+    }
+    hmInterpreterFrame* frame = interpreter->next_frame;
+    hm_nint frame_end = (hm_nint)(registers - interpreter->registers) + body->register_count;
+    if (frame == interpreter->frames + interpreter->frame_count || frame_end > interpreter->register_count) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hmJitCode code = HM_NULL;
+    if (interpreter->jit_opt) {
+        HM_TRY(hmJitGetCode(interpreter->jit_opt, method, &code));
+    } else {
+        hmMethodGetJitCode(method, &code); /* Ahead-of-time compiled code, see runtime/aot.h */
+    }
+    if (!code) {
+        return hmInterpreterExecute(interpreter, body, registers);
+    }
+    interpreter->next_frame = frame + 1; /* Native calls nest too, and are limited by the same number of frames. */
+    hmError err = code(registers, interpreter);
+    interpreter->next_frame = frame;
+    return err;
+}
+
+/* Interprets the body until it returns. Calls of other interpreted methods don't leave the loop. */
+static hmError hmInterpreterExecute(hmInterpreter* interpreter, hmLLMethodBody* body, hm_uint64* registers)
+{
+    hmInterpreterFrame* first_frame = interpreter->next_frame;
+    hmInterpreterFrame* frame = first_frame; /* The next free frame. */
+    hmInterpreterFrame* frames_end = interpreter->frames + interpreter->frame_count;
+    const hm_uint8* ip = body->opcodes;
+    hm_uint16 base_register = 0;
+    hmMethod* callee = HM_NULL;
+    hmJitCode code = HM_NULL;
+    hm_nint frame_end = 0;
+    hmError err = HM_OK;
+#ifdef HM_INTERPRETER_THREADED_DISPATCH
+    /* In the order of opcode values. */
+    static void* const dispatch_table[HM_LLOPCODE_COUNT] = {
+        &&hm_opcode_MOV,
+        &&hm_opcode_LDC32,
+        &&hm_opcode_LDC64,
+        &&hm_opcode_CALL,
+        &&hm_opcode_RET,
+        &&hm_opcode_RETVOID,
+        &&hm_opcode_MOV2,
+        &&hm_opcode_LDC32_CALL
+    };
+    HM_DISPATCH();
+#else
+hm_dispatch:
+    switch (*ip) {
+#endif
+        HM_OPCODE(MOV)
+            registers[hmInterpreterReadRegisterIndex(ip + 1)] = registers[hmInterpreterReadRegisterIndex(ip + 3)];
+            ip += HM_LLOPCODE_MOV_SIZE;
+            HM_DISPATCH();
+        HM_OPCODE(LDC32)
+            registers[hmInterpreterReadRegisterIndex(ip + 1)] = hmInterpreterReadConstant32(ip + 3);
+            ip += HM_LLOPCODE_LDC32_SIZE;
+            HM_DISPATCH();
+        HM_OPCODE(LDC64)
+            registers[hmInterpreterReadRegisterIndex(ip + 1)] = hmInterpreterReadConstant64(ip + 3);
+            ip += HM_LLOPCODE_LDC64_SIZE;
+            HM_DISPATCH();
+        HM_OPCODE(CALL)
+            base_register = hmInterpreterReadRegisterIndex(ip + 1);
+            callee = hmInterpreterReadMethod(ip + 3);
+            ip += HM_LLOPCODE_CALL_SIZE;
+            goto hm_call;
+        HM_OPCODE(RET)
+            registers[0] = registers[hmInterpreterReadRegisterIndex(ip + 1)];
+            goto hm_return;
+        HM_OPCODE(RETVOID)
+            goto hm_return;
+        HM_OPCODE(MOV2)
+            registers[hmInterpreterReadRegisterIndex(ip + 1)] = registers[hmInterpreterReadRegisterIndex(ip + 3)];
+            registers[hmInterpreterReadRegisterIndex(ip + 5)] = registers[hmInterpreterReadRegisterIndex(ip + 7)];
+            ip += HM_LLOPCODE_MOV2_SIZE;
+            HM_DISPATCH();
+        HM_OPCODE(LDC32_CALL)
+            registers[hmInterpreterReadRegisterIndex(ip + 1)] = hmInterpreterReadConstant32(ip + 3);
+            base_register = hmInterpreterReadRegisterIndex(ip + HM_LLOPCODE_LDC32_SIZE);
+            callee = hmInterpreterReadMethod(ip + HM_LLOPCODE_LDC32_SIZE + sizeof(hm_uint16));
+            ip += HM_LLOPCODE_LDC32_CALL_SIZE;
+            goto hm_call;
+#ifndef HM_INTERPRETER_THREADED_DISPATCH
+        default:
+            err = HM_ERROR_INVALID_DATA; /* Can't happen with lowered bytecode. */
+            goto hm_exit;
+    }
+#endif
+hm_call:
+    body = hmMethodGetLLBody(callee);
+    if (!body) {
+        err = hmInterpreterCompileMethod(interpreter, callee, &body);
+        if (err != HM_OK) {
+            goto hm_exit;
+        }
+    }
+    /* The frame of the callee overlaps the frame of the caller, starting from the first argument. */
+    frame_end = (hm_nint)(registers - interpreter->registers) + base_register + body->register_count;
+    if (frame == frames_end || frame_end > interpreter->register_count) {
+        err = HM_ERROR_LIMIT_EXCEEDED;
+        goto hm_exit;
+    }
+    if (interpreter->jit_opt) {
+        err = hmJitGetCode(interpreter->jit_opt, callee, &code);
+        if (err != HM_OK) {
+            goto hm_exit;
+        }
+    } else {
+        hmMethodGetJitCode(callee, &code);
+    }
+    if (code) {
+        interpreter->next_frame = frame + 1;
+        err = code(registers + base_register, interpreter);
+        if (err != HM_OK) {
+            goto hm_exit;
+        }
+        HM_DISPATCH(); /* `ip` already points to the next instruction. */
+    }
+    frame->return_ip = ip;
+    frame->registers = registers;
+    frame++;
+    registers += base_register;
+    ip = body->opcodes;
+    HM_DISPATCH();
+hm_return:
+    if (frame == first_frame) {
+        goto hm_exit;
+    }
+    frame--;
+    ip = frame->return_ip;
+    registers = frame->registers;
+    HM_DISPATCH();
+hm_exit:
+    interpreter->next_frame = first_frame;
+    return err;
+}
+
+#undef HM_OPCODE
+#undef HM_DISPATCH
+#ifdef HM_INTERPRETER_THREADED_DISPATCH
+    #pragma GCC diagnostic pop
+#endif
+
+/* See hmCreateInterpreter(..) */
+static hmError hmInterpreterCompileMethod(hmInterpreter* interpreter, hmMethod* method, hmLLMethodBody** out_body)
+{
+    if (!interpreter->resolve_call_target_func_opt) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    hmSignature* signature = method->parsed_signature_opt;
+    if (!signature) {
+        hmMethod* resolved_method = HM_NULL;
+        HM_TRY(interpreter->resolve_call_target_func_opt(method->method_id, interpreter->user_data, &resolved_method, &signature));
+    }
+    hmMethodBody* hl_body = HM_NULL;
+    HM_TRY(hmMethodGetHLBody(method, &hl_body));
+    hmLLMethodBody ll_body;
+    HM_TRY(hmCompileMethodBody(
+        method->body_allocator, /* the method owns the body, see hmMethodSetLLBody(..) */
+        hl_body,
+        signature,
+        interpreter->resolve_call_target_func_opt,
+        interpreter->user_data,
+        &ll_body
+    ));
+    hmError err = hmMethodSetLLBody(method, &ll_body);
+    if (err == HM_ERROR_INVALID_STATE) {
+        /* Another thread compiled the method in the meantime: its body is used, and ours is discarded. */
+        err = hmLLMethodBodyDispose(&ll_body);
+    } else if (err != HM_OK) {
+        return hmMergeErrors(err, hmLLMethodBodyDispose(&ll_body));
+    }
+    *out_body = hmMethodGetLLBody(method);
+    return err;
+}
+
+static hm_uint16 hmInterpreterReadRegisterIndex(const hm_uint8* ip)
+{
+    hm_uint16 register_index;
+    hmCopyMemory(&register_index, ip, sizeof(register_index));
+    return register_index;
+}
+
+/* 32-bit values are kept sign-extended. */
+static hm_uint64 hmInterpreterReadConstant32(const hm_uint8* ip)
+{
+    hm_int32 value;
+    hmCopyMemory(&value, ip, sizeof(value));
+    return (hm_uint64)(hm_int64)value;
+}
+
+static hm_uint64 hmInterpreterReadConstant64(const hm_uint8* ip)
+{
+    hm_uint64 value;
+    hmCopyMemory(&value, ip, sizeof(value));
+    return value;
+}
+
+static hmMethod* hmInterpreterReadMethod(const hm_uint8* ip)
+{
+    hmMethod* method;
+    hmCopyMemory(&method, ip, sizeof(method));
+    return method;
+}
@@ -0,0 +1,90 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_INTERPRETER_H
+#define HM_INTERPRETER_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <runtime/method.h>
+#include <runtime/lowering.h>
+#include <runtime/jit.h>
+
+/* Defaults which allow for deep enough call chains, at the cost of ~0.5 MB of registers per thread. */
+#define HM_INTERPRETER_DEFAULT_REGISTER_COUNT 65536
+#define HM_INTERPRETER_DEFAULT_FRAME_COUNT    4096
+
+/* Where to return to when a method returns. */
+typedef struct {
+    const hm_uint8* return_ip;
+    hm_uint64*      registers; /* The registers of the caller. */
+} hmInterpreterFrame;
+
+/* Executes low-level bytecode (see hmLLOpcode). The registers of nested calls are laid out contiguously in one
+   preallocated arena: the frame of a callee starts at the callee's first argument in the frame of the caller, so
+   arguments are passed without copying, and the return value ends up right where the caller expects it.
+   If the compiler supports it, opcodes are dispatched with computed gotos ("direct threading"), so that every
+   handler jumps straight to the next one; otherwise, a switch is used.
+   With a JIT, hot methods are compiled to machine code which runs on the same frames (see runtime/jit.h); without it,
+   methods can still run native code bound ahead of time (see runtime/aot.h).
+   An interpreter is not thread-safe: every thread which executes code should have its own. */
+typedef struct hmInterpreter_ {
+    hmAllocator*            allocator;
+    hm_uint64*              registers;
+    hm_nint                 register_count;
+    hm_uint64*              registers_end; /* Same as `registers + register_count`, for limit checks in compiled code. */
+    hmInterpreterFrame*     frames;
+    hm_nint                 frame_count;
+    hmInterpreterFrame*     frames_end;    /* Same as `frames + frame_count`. */
+    hmInterpreterFrame*     next_frame;    /* The first free frame when the interpreter calls out to compiled code. */
+    hm_bool                 is_running;    /* See hmInterpreterRun(..) */
+    hmJit*                  jit_opt;
+    hmResolveCallTargetFunc resolve_call_target_func_opt; /* Compiles methods on first call, see hmCreateInterpreter(..) */
+    void*                   user_data;     /* Passed to `resolve_call_target_func_opt` as is. */
+} hmInterpreter;
+
+/* `register_count` and `frame_count` limit the total number of registers and the depth of nesting of calls
+   (the values can be set to HM_INTERPRETER_DEFAULT_REGISTER_COUNT and HM_INTERPRETER_DEFAULT_FRAME_COUNT).
+   `jit_opt` is an optional JIT which compiles hot methods (can be shared by interpreters on the same thread).
+   If `resolve_call_target_func_opt` is provided, a method which isn't compiled yet is compiled on its first call: its
+   high-level body is loaded (see hmMethodGetHLBody(..)), verified and lowered with hmCompileMethodBody(..), which
+   resolves the targets of calls with `resolve_call_target_func_opt` and `user_data`, and the result is set as the
+   method's low-level body (see hmMethodSetLLBody(..)). The signature is taken from the method if it was loaded by
+   a module registry, otherwise it's resolved by the method's ID. Compiling is thread-safe, so methods can be shared by
+   interpreters of several threads: if they compile the same method at the same time, one body is kept and the others
+   are discarded (see hmMethodSetLLBody(..))
+   Returns HM_ERROR_INVALID_ARGUMENT if `register_count` or `frame_count` is zero. */
+hmError hmCreateInterpreter(
+    hmAllocator*            allocator,
+    hm_nint                 register_count,
+    hm_nint                 frame_count,
+    hmJit*                  jit_opt,
+    hmResolveCallTargetFunc resolve_call_target_func_opt,
+    void*                   user_data,
+    hmInterpreter*          in_interpreter
+);
+hmError hmInterpreterDispose(hmInterpreter* interpreter);
+/* Calls a compiled method (see hmMethodSetLLBody(..)). `args` must contain as many values as the method has parameters.
+   `out_result_opt` receives the return value (0 if the method returns nothing).
+   Returns HM_ERROR_INVALID_STATE if the method or any of the methods it calls isn't compiled and can't be compiled
+   on first call (the interpreter was created without `resolve_call_target_func_opt`), and
+   HM_ERROR_LIMIT_EXCEEDED if it runs out of registers or frames (stack overflow).
+   The method runs from the bottom of the register and frame stacks, so the function isn't re-entrant: it returns
+   HM_ERROR_INVALID_STATE if it's called while the interpreter is already running (for example, from native code called
+   by the interpreter); nested calls should use hmInterpreterCall(..) instead. */
+hmError hmInterpreterRun(hmInterpreter* interpreter, hmMethod* method, hm_uint64* args, hm_uint64* out_result_opt);
+/* Calls the method with the frame of registers starting at `registers` (which must be inside the interpreter's
+   register arena), running compiled code if there's any. This is how compiled code calls other methods. */
+hmError hmInterpreterCall(hm_uint64* registers, hmInterpreter* interpreter, hmMethod* method);
+
+#endif /* HM_INTERPRETER_H */
@@ -0,0 +1,367 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/jit.h>
+#include <runtime/interpreter.h>
+#include <runtime/lowering.h>
+#include <core/utils.h>
+
+#include <stddef.h> /* for offsetof(..) */
+
+#ifdef HM_JIT_SUPPORTED
+
+/* Machine code templates (x86-64, System V ABI). Compiled code keeps the pointer to its registers in rbx,
+   the interpreter in r12 and the address of the call stub (see hmJitCallStubTemplate) in r13 (all callee-saved).
+   Every register is accessed as [rbx + disp32]. Zeros are placeholders for operands which are patched in at the given
+   offsets. */
+
+/* push rbx; push r12; push r13 (which also aligns the stack to 16 bytes for calls); mov rbx, rdi; mov r12, rsi;
+   mov r13, imm64 */
+static const hm_uint8 hmJitPrologueTemplate[] = {
+    0x53, 0x41, 0x54, 0x41, 0x55,
+    0x48, 0x89, 0xFB,
+    0x49, 0x89, 0xF4,
+    0x49, 0xBD, 0, 0, 0, 0, 0, 0, 0, 0
+};
+#define HM_JIT_PROLOGUE_CALL_STUB_OFFSET 13
+/* pop r13; pop r12; pop rbx; ret */
+static const hm_uint8 hmJitEpilogueTemplate[] = { 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3 };
+
+/* mov rax, [rbx + S]; mov [rbx + D], rax */
+static const hm_uint8 hmJitMovTemplate[] = { 0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0 };
+#define HM_JIT_MOV_SOURCE_OFFSET 3
+#define HM_JIT_MOV_DEST_OFFSET   10
+
+/* mov qword [rbx + D], imm32 (sign-extended, just like 32-bit values in registers) */
+static const hm_uint8 hmJitLdc32Template[] = { 0x48, 0xC7, 0x83, 0, 0, 0, 0, 0, 0, 0, 0 };
+#define HM_JIT_LDC32_DEST_OFFSET     3
+#define HM_JIT_LDC32_CONSTANT_OFFSET 7
+
+/* mov rax, imm64; mov [rbx + D], rax */
+static const hm_uint8 hmJitLdc64Template[] = { 0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0 };
+#define HM_JIT_LDC64_CONSTANT_OFFSET 2
+#define HM_JIT_LDC64_DEST_OFFSET     13
+
+/* lea rdi, [rbx + B]; mov rdx, imm64 (method); call r13; test al, al; jnz rel32 (to the shared epilogue at the end
+   of the method, which returns the error as is) */
+static const hm_uint8 hmJitCallTemplate[] = {
+    0x48, 0x8D, 0xBB, 0, 0, 0, 0,
+    0x48, 0xBA, 0, 0, 0, 0, 0, 0, 0, 0,
+    0x41, 0xFF, 0xD5,
+    0x84, 0xC0,
+    0x0F, 0x85, 0, 0, 0, 0
+};
+#define HM_JIT_CALL_BASE_OFFSET       3
+#define HM_JIT_CALL_METHOD_OFFSET     9
+#define HM_JIT_CALL_ERROR_EXIT_OFFSET 24
+
+/* Every call site of compiled code calls this stub with rdi = the registers of the callee and rdx = the callee.
+   If the callee is compiled too and fits into the remaining registers and frames, it's called directly, with the frame
+   accounted for just like in hmInterpreterCall(..); otherwise, the stub tail-calls hmInterpreterCall(..), which reports
+   the error, or counts the invocation and interprets the callee. The call target is thus resolved at the call site with
+   one load (the callee is already embedded there by lowering), and compiled methods call each other without going
+   through C code. On x86-64, plain loads have acquire semantics, so they're enough to read the atomic `jit_code_opt` and
+   `ll_body_opt` published by other threads (see hmMethodSetLLBody(..)).
+
+       mov rax, [rdx + jit_code_opt]; test rax, rax; jz slow
+       mov rcx, [rdx + ll_body_opt]; test rcx, rcx; jz slow
+       movzx ecx, word [rcx + register_count]; lea rcx, [rdi + rcx * 8]; cmp rcx, [r12 + registers_end]; ja slow
+       mov rcx, [r12 + next_frame]; cmp rcx, [r12 + frames_end]; jae slow
+       add rcx, sizeof(hmInterpreterFrame); mov [r12 + next_frame], rcx
+       sub rsp, 8 (aligns the stack); mov rsi, r12; call rax; add rsp, 8
+       sub qword [r12 + next_frame], sizeof(hmInterpreterFrame); ret
+   slow:
+       mov rsi, r12; mov rax, imm64 (hmInterpreterCall); jmp rax */
+static const hm_uint8 hmJitCallStubTemplate[] = {
+    0x48, 0x8B, 0x82, 0, 0, 0, 0, 0x48, 0x85, 0xC0, 0x74, 0x56,
+    0x48, 0x8B, 0x8A, 0, 0, 0, 0, 0x48, 0x85, 0xC9, 0x74, 0x4A,
+    0x0F, 0xB7, 0x89, 0, 0, 0, 0, 0x48, 0x8D, 0x0C, 0xCF, 0x49, 0x3B, 0x8C, 0x24, 0, 0, 0, 0, 0x77, 0x35,
+    0x49, 0x8B, 0x8C, 0x24, 0, 0, 0, 0, 0x49, 0x3B, 0x8C, 0x24, 0, 0, 0, 0, 0x73, 0x23,
+    0x48, 0x83, 0xC1, 0, 0x49, 0x89, 0x8C, 0x24, 0, 0, 0, 0,
+    0x48, 0x83, 0xEC, 0x08, 0x4C, 0x89, 0xE6, 0xFF, 0xD0, 0x48, 0x83, 0xC4, 0x08,
+    0x49, 0x83, 0xAC, 0x24, 0, 0, 0, 0, 0, 0xC3,
+    0x4C, 0x89, 0xE6, 0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xE0
+};
+#define HM_JIT_CALL_STUB_JIT_CODE_OFFSET          3
+#define HM_JIT_CALL_STUB_LL_BODY_OFFSET           15
+#define HM_JIT_CALL_STUB_REGISTER_COUNT_OFFSET    27
+#define HM_JIT_CALL_STUB_REGISTERS_END_OFFSET     39
+#define HM_JIT_CALL_STUB_NEXT_FRAME_OFFSET        49
+#define HM_JIT_CALL_STUB_FRAMES_END_OFFSET        57
+#define HM_JIT_CALL_STUB_FRAME_SIZE_OFFSET        66
+#define HM_JIT_CALL_STUB_NEXT_FRAME_OFFSET2       71
+#define HM_JIT_CALL_STUB_NEXT_FRAME_OFFSET3       92
+#define HM_JIT_CALL_STUB_FRAME_SIZE_OFFSET2       96
+#define HM_JIT_CALL_STUB_HELPER_OFFSET            103
+
+/* mov rax, [rbx + S]; mov [rbx], rax */
+static const hm_uint8 hmJitRetTemplate[] = { 0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x89, 0x03 };
+#define HM_JIT_RET_SOURCE_OFFSET 3
+
+/* xor eax, eax (HM_OK) */
+static const hm_uint8 hmJitReturnOKTemplate[] = { 0x31, 0xC0 };
+
+typedef struct {
+    hm_uint8* code_opt;          /* HM_NULL if only the size is computed. */
+    hm_nint   size;
+    hm_nint   error_exit_offset; /* Where the shared epilogue for errors starts (known after the first pass). */
+} hmJitEmitter;
+
+static hm_uint8* hmJitEmitTemplate(hmJitEmitter* emitter, const hm_uint8* code_template, hm_nint size);
+static void hmJitPatchRegister(hm_uint8* code_opt, hm_nint offset, const hm_uint8* ip);
+static void hmJitPatchBytes(hm_uint8* code_opt, hm_nint offset, const void* bytes, hm_nint size);
+static void hmJitEmitMov(hmJitEmitter* emitter, const hm_uint8* ip);
+static void hmJitEmitLdc32(hmJitEmitter* emitter, const hm_uint8* ip);
+static void hmJitEmitCall(hmJitEmitter* emitter, const hm_uint8* ip);
+static void hmJitEmitMethodBody(hmJitEmitter* emitter, hmLLMethodBody* ll_body, void* call_stub);
+static hmError hmJitAddCallStub(hmJit* jit);
+static void hmJitPatchDisplacement(hm_uint8* code, hm_nint offset, hm_nint displacement);
+
+#endif /* HM_JIT_SUPPORTED */
+
+hmError hmCreateJit(hmAllocator* allocator, hm_nint code_heap_capacity, hm_uint32 threshold, hmJit* in_jit)
+{
+    if (threshold == HM_UINT32_MAX) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    HM_TRY(hmCreateCodeHeap(code_heap_capacity, &in_jit->code_heap));
+    in_jit->allocator = allocator;
+    in_jit->threshold = threshold;
+    in_jit->call_stub = HM_NULL;
+#ifdef HM_JIT_SUPPORTED
+    /* The stub has a heap of its own, so that it doesn't count against `code_heap_capacity`. */
+    hmError err = hmCreateCodeHeap(sizeof(hmJitCallStubTemplate), &in_jit->stub_heap);
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmCodeHeapDispose(&in_jit->code_heap));
+    }
+    err = hmJitAddCallStub(in_jit);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmCodeHeapDispose(&in_jit->stub_heap));
+        return hmMergeErrors(err, hmCodeHeapDispose(&in_jit->code_heap));
+    }
+#endif
+    return HM_OK;
+}
+
+hmError hmJitDispose(hmJit* jit)
+{
+    hmError err = hmCodeHeapDispose(&jit->code_heap);
+#ifdef HM_JIT_SUPPORTED
+    err = hmMergeErrors(err, hmCodeHeapDispose(&jit->stub_heap));
+#endif
+    return err;
+}
+
+hmError hmJitCompile(hmJit* jit, hmMethod* method)
+{
+    hmLLMethodBody* ll_body = hmMethodGetLLBody(method);
+    if (!ll_body || hmMethodIsJitCompiled(method)) {
+        return HM_ERROR_INVALID_STATE;
+    }
+#ifdef HM_JIT_SUPPORTED
+    /* Same as with lowering, the first pass only computes the size. */
+    hmJitEmitter emitter;
+    emitter.code_opt = HM_NULL;
+    emitter.size = 0;
+    emitter.error_exit_offset = 0;
+    hmJitEmitMethodBody(&emitter, ll_body, jit->call_stub);
+    hm_uint8* code = (hm_uint8*)hmAlloc(jit->allocator, emitter.size);
+    if (!code) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    emitter.code_opt = code;
+    emitter.size = 0;
+    hmJitEmitMethodBody(&emitter, ll_body, jit->call_stub);
+    void* jit_code = HM_NULL;
+    hmError err = hmCodeHeapAddCode(&jit->code_heap, code, emitter.size, &jit_code);
+    hmFree(jit->allocator, code);
+    HM_TRY(err);
+    void* expected = HM_NULL;
+    if (!hmAtomicCompareExchange(&method->jit_code_opt, &expected, jit_code)) {
+        return HM_ERROR_INVALID_STATE; /* compiled by another thread in the meantime; our copy stays unused in the heap */
+    }
+    return HM_OK;
+#else
+    return HM_ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+hmError hmJitGetCode(hmJit* jit, hmMethod* method, hmJitCode* out_code)
+{
+    /* Once the count passes the threshold, it's no longer incremented. Incrementing is atomic, so exactly one thread
+       sees the count which crosses the threshold, and the method is compiled at most once. */
+    if (!hmMethodIsJitCompiled(method) && hmAtomicLoad(&method->invocation_count) <= jit->threshold) {
+        hm_uint32 invocation_count = hmAtomicIncrement(&method->invocation_count);
+        if (invocation_count <= jit->threshold) {
+            *out_code = HM_NULL;
+            return HM_OK;
+        }
+        if (invocation_count == jit->threshold + 1) { /* Compilation is attempted only once. */
+            hmError err = hmJitCompile(jit, method);
+            /* The method stays interpreted if it can't be compiled (HM_ERROR_INVALID_STATE: compiled by another thread). */
+            if (err != HM_ERROR_INVALID_STATE && err != HM_ERROR_NOT_IMPLEMENTED && err != HM_ERROR_LIMIT_EXCEEDED) {
+                HM_TRY(err);
+            }
+        }
+    }
+    hmMethodGetJitCode(method, out_code);
+    return HM_OK;
+}
+
+void hmMethodGetJitCode(hmMethod* method, hmJitCode* out_code)
+{
+    void* jit_code = hmAtomicLoadAcquire(&method->jit_code_opt);
+    /* ISO C doesn't allow casting between object and function pointers, but it's fine to copy them bit by bit
+       on platforms which have a JIT. */
+    hmCopyMemory(out_code, &jit_code, sizeof(*out_code));
+}
+
+#ifdef HM_JIT_SUPPORTED
+
+/* Returns the copy of the template in the code, or HM_NULL if only the size is computed. */
+static hm_uint8* hmJitEmitTemplate(hmJitEmitter* emitter, const hm_uint8* code_template, hm_nint size)
+{
+    hm_uint8* code_opt = HM_NULL;
+    if (emitter->code_opt) {
+        code_opt = emitter->code_opt + emitter->size;
+        hmCopyMemory(code_opt, code_template, size);
+    }
+    emitter->size += size;
+    return code_opt;
+}
+
+/* Patches a uint16 register index at `ip` as a 32-bit displacement off rbx. */
+static void hmJitPatchRegister(hm_uint8* code_opt, hm_nint offset, const hm_uint8* ip)
+{
+    hm_uint16 register_index;
+    hmCopyMemory(&register_index, ip, sizeof(register_index));
+    hm_int32 displacement = (hm_int32)register_index * (hm_int32)sizeof(hm_uint64);
+    hmJitPatchBytes(code_opt, offset, &displacement, sizeof(displacement));
+}
+
+static void hmJitPatchBytes(hm_uint8* code_opt, hm_nint offset, const void* bytes, hm_nint size)
+{
+    if (code_opt) {
+        hmCopyMemory(code_opt + offset, bytes, size);
+    }
+}
+
+static void hmJitEmitMov(hmJitEmitter* emitter, const hm_uint8* ip)
+{
+    hm_uint8* code_opt = hmJitEmitTemplate(emitter, hmJitMovTemplate, sizeof(hmJitMovTemplate));
+    hmJitPatchRegister(code_opt, HM_JIT_MOV_DEST_OFFSET, ip);
+    hmJitPatchRegister(code_opt, HM_JIT_MOV_SOURCE_OFFSET, ip + sizeof(hm_uint16));
+}
+
+static void hmJitEmitLdc32(hmJitEmitter* emitter, const hm_uint8* ip)
+{
+    hm_uint8* code_opt = hmJitEmitTemplate(emitter, hmJitLdc32Template, sizeof(hmJitLdc32Template));
+    hmJitPatchRegister(code_opt, HM_JIT_LDC32_DEST_OFFSET, ip);
+    hmJitPatchBytes(code_opt, HM_JIT_LDC32_CONSTANT_OFFSET, ip + sizeof(hm_uint16), sizeof(hm_uint32));
+}
+
+static void hmJitEmitCall(hmJitEmitter* emitter, const hm_uint8* ip)
+{
+    hm_uint8* code_opt = hmJitEmitTemplate(emitter, hmJitCallTemplate, sizeof(hmJitCallTemplate));
+    hmJitPatchRegister(code_opt, HM_JIT_CALL_BASE_OFFSET, ip);
+    hmJitPatchBytes(code_opt, HM_JIT_CALL_METHOD_OFFSET, ip + sizeof(hm_uint16), sizeof(void*));
+    /* Relative to the end of the call template. */
+    hm_int32 error_exit_displacement = (hm_int32)emitter->error_exit_offset - (hm_int32)emitter->size;
+    hmJitPatchBytes(code_opt, HM_JIT_CALL_ERROR_EXIT_OFFSET, &error_exit_displacement, sizeof(error_exit_displacement));
+}
+
+static void hmJitEmitMethodBody(hmJitEmitter* emitter, hmLLMethodBody* ll_body, void* call_stub)
+{
+    hm_uint8* prologue_opt = hmJitEmitTemplate(emitter, hmJitPrologueTemplate, sizeof(hmJitPrologueTemplate));
+    hmJitPatchBytes(prologue_opt, HM_JIT_PROLOGUE_CALL_STUB_OFFSET, &call_stub, sizeof(call_stub));
+    const hm_uint8* ip = ll_body->opcodes;
+    const hm_uint8* end = ll_body->opcodes + ll_body->size;
+    while (ip < end) {
+        hm_uint8* code_opt = HM_NULL;
+        switch (*ip) {
+            case HM_LLOPCODE_MOV:
+                hmJitEmitMov(emitter, ip + 1);
+                ip += HM_LLOPCODE_MOV_SIZE;
+                break;
+            case HM_LLOPCODE_LDC32:
+                hmJitEmitLdc32(emitter, ip + 1);
+                ip += HM_LLOPCODE_LDC32_SIZE;
+                break;
+            case HM_LLOPCODE_LDC64:
+                code_opt = hmJitEmitTemplate(emitter, hmJitLdc64Template, sizeof(hmJitLdc64Template));
+                hmJitPatchRegister(code_opt, HM_JIT_LDC64_DEST_OFFSET, ip + 1);
+                hmJitPatchBytes(code_opt, HM_JIT_LDC64_CONSTANT_OFFSET, ip + 1 + sizeof(hm_uint16), sizeof(hm_uint64));
+                ip += HM_LLOPCODE_LDC64_SIZE;
+                break;
+            case HM_LLOPCODE_CALL:
+                hmJitEmitCall(emitter, ip + 1);
+                ip += HM_LLOPCODE_CALL_SIZE;
+                break;
+            case HM_LLOPCODE_RET:
+                code_opt = hmJitEmitTemplate(emitter, hmJitRetTemplate, sizeof(hmJitRetTemplate));
+                hmJitPatchRegister(code_opt, HM_JIT_RET_SOURCE_OFFSET, ip + 1);
+                hmJitEmitTemplate(emitter, hmJitReturnOKTemplate, sizeof(hmJitReturnOKTemplate));
+                hmJitEmitTemplate(emitter, hmJitEpilogueTemplate, sizeof(hmJitEpilogueTemplate));
+                ip += HM_LLOPCODE_RET_SIZE;
+                break;
+            case HM_LLOPCODE_RETVOID:
+                hmJitEmitTemplate(emitter, hmJitReturnOKTemplate, sizeof(hmJitReturnOKTemplate));
+                hmJitEmitTemplate(emitter, hmJitEpilogueTemplate, sizeof(hmJitEpilogueTemplate));
+                ip += HM_LLOPCODE_RETVOID_SIZE;
+                break;
+            case HM_LLOPCODE_MOV2:
+                hmJitEmitMov(emitter, ip + 1);
+                hmJitEmitMov(emitter, ip + 1 + sizeof(hm_uint16) * 2);
+                ip += HM_LLOPCODE_MOV2_SIZE;
+                break;
+            case HM_LLOPCODE_LDC32_CALL:
+                hmJitEmitLdc32(emitter, ip + 1);
+                hmJitEmitCall(emitter, ip + HM_LLOPCODE_LDC32_SIZE);
+                ip += HM_LLOPCODE_LDC32_CALL_SIZE;
+                break;
+            default: /* Can't happen with lowered bytecode. */
+                ip = end;
+                break;
+        }
+    }
+    emitter->error_exit_offset = emitter->size;
+    hmJitEmitTemplate(emitter, hmJitEpilogueTemplate, sizeof(hmJitEpilogueTemplate));
+}
+
+/* The stub depends on the layout of runtime structures, so the offsets of their fields are patched in. */
+static hmError hmJitAddCallStub(hmJit* jit)
+{
+    hm_uint8 code[sizeof(hmJitCallStubTemplate)];
+    hmCopyMemory(code, hmJitCallStubTemplate, sizeof(code));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_JIT_CODE_OFFSET, offsetof(hmMethod, jit_code_opt));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_LL_BODY_OFFSET, offsetof(hmMethod, ll_body_opt));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_REGISTER_COUNT_OFFSET, offsetof(hmLLMethodBody, register_count));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_REGISTERS_END_OFFSET, offsetof(hmInterpreter, registers_end));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_NEXT_FRAME_OFFSET, offsetof(hmInterpreter, next_frame));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_FRAMES_END_OFFSET, offsetof(hmInterpreter, frames_end));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_NEXT_FRAME_OFFSET2, offsetof(hmInterpreter, next_frame));
+    hmJitPatchDisplacement(code, HM_JIT_CALL_STUB_NEXT_FRAME_OFFSET3, offsetof(hmInterpreter, next_frame));
+    code[HM_JIT_CALL_STUB_FRAME_SIZE_OFFSET] = (hm_uint8)sizeof(hmInterpreterFrame);
+    code[HM_JIT_CALL_STUB_FRAME_SIZE_OFFSET2] = (hm_uint8)sizeof(hmInterpreterFrame);
+    hmError (*helper)(hm_uint64*, hmInterpreter*, hmMethod*) = &hmInterpreterCall;
+    hmJitPatchBytes(code, HM_JIT_CALL_STUB_HELPER_OFFSET, &helper, sizeof(helper));
+    return hmCodeHeapAddCode(&jit->stub_heap, code, sizeof(code), &jit->call_stub);
+}
+
+static void hmJitPatchDisplacement(hm_uint8* code, hm_nint offset, hm_nint displacement)
+{
+    hm_int32 displacement32 = (hm_int32)displacement;
+    hmJitPatchBytes(code, offset, &displacement32, sizeof(displacement32));
+}
+
+#endif /* HM_JIT_SUPPORTED */
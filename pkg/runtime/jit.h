@@ -0,0 +1,72 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_JIT_H
+#define HM_JIT_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <runtime/codeheap.h>
+#include <runtime/method.h>
+
+/* Machine code is generated only for x86-64 (System V ABI); elsewhere, everything is interpreted. */
+#if defined(__x86_64__) && defined(HM_UNIX)
+    #define HM_JIT_SUPPORTED
+#endif
+
+#define HM_JIT_DEFAULT_CODE_HEAP_CAPACITY (64 * 1024 * 1024)
+#define HM_JIT_DEFAULT_THRESHOLD          1000
+
+struct hmInterpreter_;
+
+/* Compiled code of a method. Operates on the same frame of registers as the interpreter (see runtime/interpreter.h):
+   `registers` points to the first argument, and the return value (if any) is stored to the first register. */
+typedef hmError (*hmJitCode)(hm_uint64* registers, struct hmInterpreter_* interpreter);
+
+/* A baseline template JIT: every low-level opcode is translated by copying a pre-assembled snippet of machine code
+   and patching in its operands (register offsets, constants, call targets), which removes dispatch overhead without
+   the complexity of an optimizing compiler. Methods are compiled once they're called `threshold` times (see
+   hmJitGetCode(..)). Calls from compiled code go through a shared stub: compiled callees are called directly,
+   everything else goes through the interpreter (see hmInterpreterCall(..)), which counts invocations and interprets.
+   A JIT is not thread-safe (neither is its code heap), so every thread should have its own. Methods, however, can be
+   shared by the JITs of several threads: invocations are counted atomically, so a hot method is compiled by only one
+   of them, and its code is published atomically, just like low-level bodies (see hmMethodSetLLBody(..)) Compiled code
+   is called by other threads, so the JIT must outlive all the threads which run the methods it compiled. */
+typedef struct {
+    hmAllocator* allocator;
+    hmCodeHeap   code_heap;
+    hmCodeHeap   stub_heap; /* Code shared by all compiled methods (where supported). */
+    void*        call_stub;
+    hm_uint32    threshold;
+} hmJit;
+
+/* `code_heap_capacity` limits the total size of compiled code (it can be set to HM_JIT_DEFAULT_CODE_HEAP_CAPACITY);
+   `threshold` is how many times a method is interpreted before it's compiled (for example, HM_JIT_DEFAULT_THRESHOLD).
+   Returns HM_ERROR_INVALID_ARGUMENT if `threshold` is HM_UINT32_MAX. */
+hmError hmCreateJit(hmAllocator* allocator, hm_nint code_heap_capacity, hm_uint32 threshold, hmJit* in_jit);
+hmError hmJitDispose(hmJit* jit);
+/* Compiles the method (which must have a low-level body, see hmMethodSetLLBody(..)) right away.
+   Returns HM_ERROR_INVALID_STATE if the method has no low-level body or is already compiled (possibly by another thread
+   at the same time), HM_ERROR_NOT_IMPLEMENTED
+   if the platform isn't supported, and HM_ERROR_LIMIT_EXCEEDED if the code heap is full. */
+hmError hmJitCompile(hmJit* jit, hmMethod* method);
+/* Counts an invocation of the method and compiles it if it becomes hot. `out_code` receives the compiled code, or
+   HM_NULL if the method should be interpreted: it isn't hot yet, or it can't be compiled (such methods are never
+   retried). */
+hmError hmJitGetCode(hmJit* jit, hmMethod* method, hmJitCode* out_code);
+/* Returns the machine code of the method (compiled by a JIT or bound ahead of time) in `out_code`, or HM_NULL if there's
+   none. */
+void hmMethodGetJitCode(hmMethod* method, hmJitCode* out_code);
+#define hmMethodIsJitCompiled(method) (hmAtomicLoadAcquire(&(method)->jit_code_opt) != HM_NULL)
+
+#endif /* HM_JIT_H */
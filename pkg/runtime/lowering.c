@@ -0,0 +1,226 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/lowering.h>
+#include <core/math.h>
+#include <core/utils.h>
+
+typedef struct {
+    hm_uint8* opcodes_opt; /* HM_NULL if only the size is computed. */
+    hm_nint   size;
+    hm_nint   local_base;  /* The register of the first local. */
+    hm_nint   stack_base;  /* The register of the first slot of the evaluation stack. */
+} hmLLEmitter;
+
+static void hmLLEmitBytes(hmLLEmitter* emitter, const void* bytes, hm_nint size);
+static void hmLLEmitRegister(hmLLEmitter* emitter, hm_nint register_index);
+static void hmLLEmitOpcode(hmLLEmitter* emitter, hmLLOpcode opcode);
+static hm_bool hmLLGetMov(hmLLEmitter* emitter, hmVerifiedInstruction* instruction, hm_nint* out_dest_register, hm_nint* out_source_register);
+static void hmLLEmitLdc32Operands(hmLLEmitter* emitter, hmVerifiedInstruction* instruction);
+static void hmLLEmitCallOperands(hmLLEmitter* emitter, hmVerifiedInstruction* instruction);
+static void hmLLEmitInstruction(hmLLEmitter* emitter, hmVerifiedInstruction* instruction);
+static hm_nint hmLLEmitSuperinstruction(hmLLEmitter* emitter, hmVerifiedInstruction* instruction, hmVerifiedInstruction* next_instruction);
+static void hmLLEmitMethodBody(hmLLEmitter* emitter, hmVerifiedMethodBody* verified_body);
+
+hmError hmLowerMethodBody(hmAllocator* allocator, hmVerifiedMethodBody* verified_body, hmLLMethodBody* in_ll_body)
+{
+    hm_nint arg_count = verified_body->signature->param_count;
+    hm_nint local_count = hmVerifiedMethodBodyGetLocalCount(verified_body);
+    hm_nint register_count;
+    HM_TRY(hmAddNint3(arg_count, local_count, verified_body->max_stack_depth, &register_count));
+    if (register_count > HM_UINT16_MAX) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hmLLEmitter emitter;
+    emitter.opcodes_opt = HM_NULL;
+    emitter.size = 0;
+    emitter.local_base = arg_count;
+    emitter.stack_base = arg_count + local_count;
+    hmLLEmitMethodBody(&emitter, verified_body); /* The first pass only computes the size. */
+    hm_uint8* opcodes = (hm_uint8*)hmAlloc(allocator, emitter.size);
+    if (!opcodes) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    emitter.opcodes_opt = opcodes;
+    emitter.size = 0;
+    hmLLEmitMethodBody(&emitter, verified_body);
+    in_ll_body->allocator = allocator;
+    in_ll_body->opcodes = opcodes;
+    in_ll_body->size = emitter.size;
+    in_ll_body->register_count = (hm_uint16)register_count;
+    in_ll_body->arg_count = (hm_uint16)arg_count;
+    in_ll_body->return_type = verified_body->signature->return_type;
+    return HM_OK;
+}
+
+hmError hmCompileMethodBody(
+    hmAllocator*            allocator,
+    hmMethodBody*           hl_body,
+    hmSignature*            signature,
+    hmResolveCallTargetFunc resolve_call_target_func,
+    void*                   user_data,
+    hmLLMethodBody*         in_ll_body
+)
+{
+    hmVerifiedMethodBody verified_body;
+    HM_TRY(hmVerifyMethodBody(allocator, hl_body, signature, resolve_call_target_func, user_data, &verified_body));
+    hmError err = hmLowerMethodBody(allocator, &verified_body, in_ll_body);
+    return hmMergeErrors(err, hmVerifiedMethodBodyDispose(&verified_body));
+}
+
+hmError hmLLMethodBodyDispose(hmLLMethodBody* ll_body)
+{
+    hmFree(ll_body->allocator, ll_body->opcodes);
+    ll_body->opcodes = HM_NULL;
+    return HM_OK;
+}
+
+static void hmLLEmitBytes(hmLLEmitter* emitter, const void* bytes, hm_nint size)
+{
+    if (emitter->opcodes_opt) {
+        hmCopyMemory(emitter->opcodes_opt + emitter->size, bytes, size);
+    }
+    emitter->size += size;
+}
+
+static void hmLLEmitRegister(hmLLEmitter* emitter, hm_nint register_index)
+{
+    hm_uint16 encoded_index = (hm_uint16)register_index;
+    hmLLEmitBytes(emitter, &encoded_index, sizeof(encoded_index));
+}
+
+static void hmLLEmitOpcode(hmLLEmitter* emitter, hmLLOpcode opcode)
+{
+    hmLLEmitBytes(emitter, &opcode, sizeof(opcode));
+}
+
+/* Returns HM_TRUE if the instruction lowers to a single `mov` (loads and stores of arguments and locals, `dup`). */
+static hm_bool hmLLGetMov(hmLLEmitter* emitter, hmVerifiedInstruction* instruction, hm_nint* out_dest_register, hm_nint* out_source_register)
+{
+    hm_nint top_register = emitter->stack_base + instruction->stack_depth; /* The first free slot before the instruction. */
+    hm_nint operand = (hm_nint)instruction->operand;
+    switch (instruction->opcode) {
+        case HM_HLOPCODE_STLOC:
+            *out_dest_register = emitter->local_base + operand;
+            *out_source_register = top_register - 1;
+            return HM_TRUE;
+        case HM_HLOPCODE_LDARG:
+            *out_dest_register = top_register;
+            *out_source_register = operand;
+            return HM_TRUE;
+        case HM_HLOPCODE_LDLOC:
+            *out_dest_register = top_register;
+            *out_source_register = emitter->local_base + operand;
+            return HM_TRUE;
+        case HM_HLOPCODE_STARG:
+            *out_dest_register = operand;
+            *out_source_register = top_register - 1;
+            return HM_TRUE;
+        case HM_HLOPCODE_DUP:
+            *out_dest_register = top_register;
+            *out_source_register = top_register - 1;
+            return HM_TRUE;
+        default:
+            return HM_FALSE;
+    }
+}
+
+static void hmLLEmitLdc32Operands(hmLLEmitter* emitter, hmVerifiedInstruction* instruction)
+{
+    hm_uint32 value = (hm_uint32)instruction->operand;
+    hmLLEmitRegister(emitter, emitter->stack_base + instruction->stack_depth);
+    hmLLEmitBytes(emitter, &value, sizeof(value));
+}
+
+static void hmLLEmitCallOperands(hmLLEmitter* emitter, hmVerifiedInstruction* instruction)
+{
+    hmLLEmitRegister(emitter, emitter->stack_base + instruction->stack_depth - instruction->popped_count);
+    hmLLEmitBytes(emitter, &instruction->call_target_opt, sizeof(instruction->call_target_opt));
+}
+
+static void hmLLEmitInstruction(hmLLEmitter* emitter, hmVerifiedInstruction* instruction)
+{
+    hm_nint dest_register, source_register;
+    if (hmLLGetMov(emitter, instruction, &dest_register, &source_register)) {
+        hmLLEmitOpcode(emitter, HM_LLOPCODE_MOV);
+        hmLLEmitRegister(emitter, dest_register);
+        hmLLEmitRegister(emitter, source_register);
+        return;
+    }
+    switch (instruction->opcode) {
+        case HM_HLOPCODE_LDC32:
+            hmLLEmitOpcode(emitter, HM_LLOPCODE_LDC32);
+            hmLLEmitLdc32Operands(emitter, instruction);
+            break;
+        case HM_HLOPCODE_LDC64:
+            hmLLEmitOpcode(emitter, HM_LLOPCODE_LDC64);
+            hmLLEmitRegister(emitter, emitter->stack_base + instruction->stack_depth);
+            hmLLEmitBytes(emitter, &instruction->operand, sizeof(instruction->operand));
+            break;
+        case HM_HLOPCODE_CALL:
+            hmLLEmitOpcode(emitter, HM_LLOPCODE_CALL);
+            hmLLEmitCallOperands(emitter, instruction);
+            break;
+        default: /* nop, pop: the evaluation stack is gone, so there's nothing to do. */
+            break;
+    }
+}
+
+/* Fuses the instruction with the next one, if they form a superinstruction. Returns how many instructions were consumed
+   (0 if there's no matching superinstruction). */
+static hm_nint hmLLEmitSuperinstruction(hmLLEmitter* emitter, hmVerifiedInstruction* instruction, hmVerifiedInstruction* next_instruction)
+{
+    hm_nint dest_register1, source_register1, dest_register2, source_register2;
+    hm_bool are_movs = hmLLGetMov(emitter, instruction, &dest_register1, &source_register1) &&
+                       hmLLGetMov(emitter, next_instruction, &dest_register2, &source_register2);
+    if (are_movs) {
+        hmLLEmitOpcode(emitter, HM_LLOPCODE_MOV2);
+        hmLLEmitRegister(emitter, dest_register1);
+        hmLLEmitRegister(emitter, source_register1);
+        hmLLEmitRegister(emitter, dest_register2);
+        hmLLEmitRegister(emitter, source_register2);
+        return 2;
+    }
+    if (instruction->opcode == HM_HLOPCODE_LDC32 && next_instruction->opcode == HM_HLOPCODE_CALL) {
+        hmLLEmitOpcode(emitter, HM_LLOPCODE_LDC32_CALL);
+        hmLLEmitLdc32Operands(emitter, instruction);
+        hmLLEmitCallOperands(emitter, next_instruction);
+        return 2;
+    }
+    return 0;
+}
+
+static void hmLLEmitMethodBody(hmLLEmitter* emitter, hmVerifiedMethodBody* verified_body)
+{
+    hmVerifiedInstruction* instructions = hmArrayGetRaw(&verified_body->instructions, hmVerifiedInstruction);
+    hm_nint instruction_count = hmArrayGetCount(&verified_body->instructions);
+    hm_nint i = 0;
+    while (i < instruction_count) {
+        hm_nint fused_count = 0;
+        if (i + 1 < instruction_count) {
+            fused_count = hmLLEmitSuperinstruction(emitter, &instructions[i], &instructions[i + 1]);
+        }
+        if (fused_count) {
+            i += fused_count;
+        } else {
+            hmLLEmitInstruction(emitter, &instructions[i]);
+            i++;
+        }
+    }
+    if (verified_body->signature->return_type == HM_VALUE_TYPE_VOID) {
+        hmLLEmitOpcode(emitter, HM_LLOPCODE_RETVOID);
+    } else {
+        hmLLEmitOpcode(emitter, HM_LLOPCODE_RET);
+        hmLLEmitRegister(emitter, emitter->stack_base); /* The return value is the only value left on the stack. */
+    }
+}
@@ -0,0 +1,50 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_LOWERING_H
+#define HM_LOWERING_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <runtime/method.h>
+#include <runtime/opcode.h>
+#include <runtime/verifier.h>
+
+/* Low-level bytecode of a method (see hmLLOpcode) along with the size of the register frame it requires. */
+typedef struct hmLLMethodBody_ {
+    hmAllocator* allocator;
+    hm_uint8*    opcodes;
+    hm_nint      size;
+    hm_uint16    register_count; /* Arguments, then locals, then the slots of the high-level evaluation stack. */
+    hm_uint16    arg_count;
+    hmValueType  return_type;
+} hmLLMethodBody;
+
+/* Lowers verified high-level bytecode (see hmVerifyMethodBody(..)) to register-based low-level bytecode.
+   Values on the high-level evaluation stack are assigned to fixed registers by their stack depth, so loads and stores
+   become register moves, and `pop`/`nop` disappear. Common pairs of instructions are fused into superinstructions
+   (see HM_LLOPCODE_MOV2, HM_LLOPCODE_LDC32_CALL). Returns HM_ERROR_LIMIT_EXCEEDED if the method requires
+   more registers than a uint16 index can address. */
+hmError hmLowerMethodBody(hmAllocator* allocator, hmVerifiedMethodBody* verified_body, hmLLMethodBody* in_ll_body);
+/* Verifies and lowers high-level bytecode in one step (see hmVerifyMethodBody(..) and hmLowerMethodBody(..)). */
+hmError hmCompileMethodBody(
+    hmAllocator*            allocator,
+    hmMethodBody*           hl_body,
+    hmSignature*            signature,
+    hmResolveCallTargetFunc resolve_call_target_func,
+    void*                   user_data,
+    hmLLMethodBody*         in_ll_body
+);
+hmError hmLLMethodBodyDispose(hmLLMethodBody* ll_body);
+
+#endif /* HM_LOWERING_H */
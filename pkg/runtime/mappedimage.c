@@ -0,0 +1,890 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/mappedimage.h>
+#include <collections/array.h>
+#include <collections/hashmap.h>
+#include <core/math.h>
+#include <core/utils.h>
+#include <io/reader.h>
+#include <io/writer.h>
+
+#define HM_MAPPED_IMAGE_MAGIC_SIZE         4
+#define HM_MAPPED_IMAGE_HEADER_SIZE        48
+#define HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE  8
+#define HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE   12
+#define HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE  28
+#define HM_MAPPED_IMAGE_ALIGNMENT          8
+
+static hm_uint32 hmMappedImageReadUint32(const hm_uint8* bytes);
+static void hmMappedImageWriteUint32(hm_uint8* bytes, hm_uint32 value);
+static hm_uint64 hmMappedImageAlign(hm_uint64 offset);
+static hmComparisonResult hmMappedImageCompareIds(hm_metadata_id id1, hm_metadata_id id2);
+
+/* ******************************** */
+/*    MappedImageMetadataLoader.    */
+/* ******************************** */
+
+typedef struct {
+    hmAllocator*    allocator;
+    hmReader        file_reader;       /* Keeps the image mapped. */
+    const hm_uint8* module_table;
+    const hm_uint8* class_table;
+    const hm_uint8* method_table;
+    const hm_uint8* string_table;
+    const hm_uint8* opcode_area;
+    hm_nint         module_count;
+    hm_nint         class_count;
+    hm_nint         method_count;
+    hm_nint         string_table_size;
+    hm_nint         opcode_area_size;
+} hmMappedImageLoaderData;
+
+static hmError hmMappedImageLoaderReadHeader(hmMappedImageLoaderData* data, const hm_uint8* image, hm_nint image_size);
+static hmError hmMappedImageGetSection(
+    const hm_uint8*  image,
+    hm_nint          image_size,
+    const hm_uint8*  header_field,
+    hm_nint          count,
+    hm_nint          entry_size,
+    const hm_uint8** out_section
+);
+static hmError hmMappedImageLoaderGetString(hmMappedImageLoaderData* data, hm_uint32 offset, hmString* in_string_view);
+static hmError hmMappedImageLoaderEnumModules(hmMappedImageLoaderData* data, hmEnumModuleMetadataFunc func, void* user_data);
+static hmError hmMappedImageLoaderEnumClasses(hmMappedImageLoaderData* data, hmEnumClassMetadataFunc func, void* user_data);
+static hmError hmMappedImageLoaderEnumMethods(
+    hmMappedImageLoaderData* data,
+    hm_nint                  start_index,
+    hm_nint                  end_index,
+    hmEnumMethodMetadataFunc func,
+    void*                    user_data
+);
+static hmError hmMappedImageLoaderReadClass(hmMappedImageLoaderData* data, const hm_uint8* entry, hmClassMetadata* in_metadata);
+static hmError hmMappedImageLoaderReadMethod(hmMappedImageLoaderData* data, const hm_uint8* entry, hmMethodMetadata* in_metadata);
+static hmError hmMappedImageLoaderCreateJoinOrder(
+    hmMappedImageLoaderData* data,
+    const hm_uint8*          table,
+    hm_nint                  count,
+    hm_nint                  entry_size,
+    hmCompareFunc            compare_func,
+    hmArray*                 in_order
+);
+static hmComparisonResult hmMappedImageCompareClassJoinOrder(void* value1, void* value2, void* user_data);
+static hmComparisonResult hmMappedImageCompareMethodJoinOrder(void* value1, void* value2, void* user_data);
+static hm_nint hmMappedImageLoaderFindMethodIndex(hmMappedImageLoaderData* data, hm_metadata_id method_id);
+static hmError hmMappedImageLoaderGetMethodBody(hmMappedImageLoaderData* data, const hm_uint8* entry, hmMethodBodyMetadata* out_body);
+static hmError hmMappedImageMetadataLoader_enumMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func_opt,
+    hmEnumClassMetadataFunc  enum_classes_func_opt,
+    hmEnumMethodMetadataFunc enum_methods_func_opt,
+    void* user_data
+);
+static hmError hmMappedImageMetadataLoader_enumJoinedMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func,
+    hmEnumClassMetadataFunc  enum_classes_func,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+);
+static hmError hmMappedImageMetadataLoader_enumMethodsInRange(
+    hmMetadataLoader*        metadata_loader,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+);
+static hmError hmMappedImageMetadataLoader_getMethodIDRange(
+    hmMetadataLoader* metadata_loader,
+    hm_metadata_id*   out_min_id,
+    hm_metadata_id*   out_max_id
+);
+static hmError hmMappedImageMetadataLoader_loadMethodBody(
+    hmMetadataLoader*    metadata_loader,
+    hm_metadata_id       method_id,
+    hmLoadMethodBodyFunc load_body_func,
+    void*                user_data
+);
+static hmError hmMappedImageMetadataLoader_dispose(hmMetadataLoader* metadata_loader);
+
+hmError hmCreateMappedImageMetadataLoader(hmAllocator* allocator, hmString* image_path, hmMetadataLoader* in_metadata_loader)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)hmAlloc(allocator, sizeof(hmMappedImageLoaderData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = HM_OK;
+    hm_bool is_file_reader_created = HM_FALSE;
+    HM_TRY_OR_FINALIZE(err, hmCreateMappedFileReader(allocator, image_path, &data->file_reader));
+    is_file_reader_created = HM_TRUE;
+    /* The whole file is borrowed at once: only the header is read here, the rest of the pages are touched on demand. */
+    const char* image = HM_NULL;
+    hm_nint image_size = 0;
+    HM_TRY_OR_FINALIZE(err, hmReaderBorrow(&data->file_reader, HM_NINT_MAX, &image, &image_size));
+    HM_TRY_OR_FINALIZE(err, hmMappedImageLoaderReadHeader(data, (const hm_uint8*)image, image_size));
+    data->allocator = allocator;
+    in_metadata_loader->enumMetadata = &hmMappedImageMetadataLoader_enumMetadata;
+    in_metadata_loader->enumJoinedMetadata = &hmMappedImageMetadataLoader_enumJoinedMetadata;
+    in_metadata_loader->enumMethodsInRange = &hmMappedImageMetadataLoader_enumMethodsInRange;
+    in_metadata_loader->getMethodIDRange = &hmMappedImageMetadataLoader_getMethodIDRange;
+    in_metadata_loader->loadMethodBody = &hmMappedImageMetadataLoader_loadMethodBody;
+    in_metadata_loader->dispose = &hmMappedImageMetadataLoader_dispose;
+    in_metadata_loader->data = data;
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        if (is_file_reader_created) {
+            err = hmMergeErrors(err, hmReaderClose(&data->file_reader));
+        }
+        hmFree(allocator, data);
+    }
+    return err;
+}
+
+static hmError hmMappedImageMetadataLoader_dispose(hmMetadataLoader* metadata_loader)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)metadata_loader->data;
+    hmError err = hmReaderClose(&data->file_reader);
+    hmFree(data->allocator, data);
+    return err;
+}
+
+static hmError hmMappedImageMetadataLoader_enumMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func_opt,
+    hmEnumClassMetadataFunc  enum_classes_func_opt,
+    hmEnumMethodMetadataFunc enum_methods_func_opt,
+    void* user_data
+)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)metadata_loader->data;
+    if (enum_modules_func_opt) {
+        HM_TRY(hmMappedImageLoaderEnumModules(data, enum_modules_func_opt, user_data));
+    }
+    if (enum_classes_func_opt) {
+        HM_TRY(hmMappedImageLoaderEnumClasses(data, enum_classes_func_opt, user_data));
+    }
+    if (enum_methods_func_opt) {
+        HM_TRY(hmMappedImageLoaderEnumMethods(data, 0, data->method_count, enum_methods_func_opt, user_data));
+    }
+    return HM_OK;
+}
+
+/* The tables are sorted by ID only, so classes and methods are merge-joined with modules through temporary index arrays
+   sorted by their parent IDs (the image itself is left untouched). */
+static hmError hmMappedImageMetadataLoader_enumJoinedMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func,
+    hmEnumClassMetadataFunc  enum_classes_func,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)metadata_loader->data;
+    hmArray class_order, method_order; /* hmArray<hm_nint> Indices of the entries ordered by (module_id, class_id[, method_id]) */
+    HM_TRY(hmMappedImageLoaderCreateJoinOrder(
+        data,
+        data->class_table,
+        data->class_count,
+        HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE,
+        &hmMappedImageCompareClassJoinOrder,
+        &class_order
+    ));
+    hmError err = hmMappedImageLoaderCreateJoinOrder(
+        data,
+        data->method_table,
+        data->method_count,
+        HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE,
+        &hmMappedImageCompareMethodJoinOrder,
+        &method_order
+    );
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmArrayDispose(&class_order));
+    }
+    hm_nint* class_indices = hmArrayGetRaw(&class_order, hm_nint);
+    hm_nint* method_indices = hmArrayGetRaw(&method_order, hm_nint);
+    hm_nint class_index = 0, method_index = 0;
+    for (hm_nint i = 0; i < data->module_count; i++) {
+        const hm_uint8* module_entry = data->module_table + i * HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE;
+        hmModuleMetadata module_metadata;
+        module_metadata.module_id = hmMappedImageReadUint32(module_entry);
+        if (i > 0 && module_metadata.module_id <= hmMappedImageReadUint32(module_entry - HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE)) {
+            err = HM_ERROR_INVALID_DATA;
+            HM_FINALIZE;
+        }
+        HM_TRY_OR_FINALIZE(err, hmMappedImageLoaderGetString(data, hmMappedImageReadUint32(module_entry + 4), &module_metadata.name));
+        HM_TRY_OR_FINALIZE(err, enum_modules_func(&module_metadata, user_data));
+        for (; class_index < data->class_count; class_index++) {
+            hmClassMetadata class_metadata;
+            const hm_uint8* class_entry = data->class_table + class_indices[class_index] * HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE;
+            HM_TRY_OR_FINALIZE(err, hmMappedImageLoaderReadClass(data, class_entry, &class_metadata));
+            if (class_metadata.module_id < module_metadata.module_id) { /* Modules are ascending, so it's missing. */
+                err = HM_ERROR_INVALID_DATA;
+                HM_FINALIZE;
+            }
+            if (class_metadata.module_id > module_metadata.module_id) {
+                break;
+            }
+            HM_TRY_OR_FINALIZE(err, enum_classes_func(&class_metadata, user_data));
+            for (; method_index < data->method_count; method_index++) {
+                hmMethodMetadata method_metadata;
+                const hm_uint8* method_entry = data->method_table + method_indices[method_index] * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE;
+                HM_TRY_OR_FINALIZE(err, hmMappedImageLoaderReadMethod(data, method_entry, &method_metadata));
+                hmComparisonResult result = hmMappedImageCompareIds(method_metadata.module_id, class_metadata.module_id);
+                if (result == HM_COMPARISON_RESULT_EQUAL) {
+                    result = hmMappedImageCompareIds(method_metadata.class_id, class_metadata.class_id);
+                }
+                if (result == HM_COMPARISON_RESULT_LESS) { /* Same as above: the class must be missing. */
+                    err = HM_ERROR_INVALID_DATA;
+                    HM_FINALIZE;
+                }
+                if (result == HM_COMPARISON_RESULT_GREATER) {
+                    break;
+                }
+                HM_TRY_OR_FINALIZE(err, enum_methods_func(&method_metadata, user_data));
+            }
+        }
+    }
+    if (class_index < data->class_count || method_index < data->method_count) { /* Refer to modules/classes past the last ones. */
+        err = HM_ERROR_INVALID_DATA;
+    }
+HM_ON_FINALIZE
+    err = hmMergeErrors(err, hmArrayDispose(&class_order));
+    return hmMergeErrors(err, hmArrayDispose(&method_order));
+}
+
+/* The mapping is read-only, so concurrent calls are safe. */
+static hmError hmMappedImageMetadataLoader_enumMethodsInRange(
+    hmMetadataLoader*        metadata_loader,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)metadata_loader->data;
+    if (min_method_id > max_method_id) {
+        return HM_OK;
+    }
+    hm_nint start_index = hmMappedImageLoaderFindMethodIndex(data, min_method_id);
+    hm_nint end_index = max_method_id == HM_MAX_METADATA_ID
+                      ? data->method_count
+                      : hmMappedImageLoaderFindMethodIndex(data, max_method_id + 1);
+    return hmMappedImageLoaderEnumMethods(data, start_index, end_index, enum_methods_func, user_data);
+}
+
+static hmError hmMappedImageMetadataLoader_getMethodIDRange(
+    hmMetadataLoader* metadata_loader,
+    hm_metadata_id*   out_min_id,
+    hm_metadata_id*   out_max_id
+)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)metadata_loader->data;
+    if (!data->method_count) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    *out_min_id = hmMappedImageReadUint32(data->method_table);
+    *out_max_id = hmMappedImageReadUint32(data->method_table + (data->method_count - 1) * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE);
+    return HM_OK;
+}
+
+static hmError hmMappedImageMetadataLoader_loadMethodBody(
+    hmMetadataLoader*    metadata_loader,
+    hm_metadata_id       method_id,
+    hmLoadMethodBodyFunc load_body_func,
+    void*                user_data
+)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)metadata_loader->data;
+    hm_nint index = hmMappedImageLoaderFindMethodIndex(data, method_id);
+    const hm_uint8* entry = data->method_table + index * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE;
+    if (index == data->method_count || hmMappedImageReadUint32(entry) != method_id) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    hmMethodBodyMetadata body;
+    HM_TRY(hmMappedImageLoaderGetMethodBody(data, entry, &body));
+    return load_body_func(&body, user_data);
+}
+
+static hmError hmMappedImageLoaderReadHeader(hmMappedImageLoaderData* data, const hm_uint8* image, hm_nint image_size)
+{
+    if (image_size < HM_MAPPED_IMAGE_HEADER_SIZE) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    if (hmCompareMemory(image, HM_MAPPED_IMAGE_MAGIC, HM_MAPPED_IMAGE_MAGIC_SIZE) != 0) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    if (hmMappedImageReadUint32(image + 4) != HM_MAPPED_IMAGE_VERSION) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    data->module_count = hmMappedImageReadUint32(image + 8);
+    data->class_count = hmMappedImageReadUint32(image + 12);
+    data->method_count = hmMappedImageReadUint32(image + 16);
+    data->string_table_size = hmMappedImageReadUint32(image + 36);
+    data->opcode_area_size = hmMappedImageReadUint32(image + 44);
+    HM_TRY(hmMappedImageGetSection(
+        image, image_size, image + 20, data->module_count, HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE, &data->module_table
+    ));
+    HM_TRY(hmMappedImageGetSection(
+        image, image_size, image + 24, data->class_count, HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE, &data->class_table
+    ));
+    HM_TRY(hmMappedImageGetSection(
+        image, image_size, image + 28, data->method_count, HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE, &data->method_table
+    ));
+    HM_TRY(hmMappedImageGetSection(image, image_size, image + 32, data->string_table_size, 1, &data->string_table));
+    HM_TRY(hmMappedImageGetSection(image, image_size, image + 40, data->opcode_area_size, 1, &data->opcode_area));
+    /* Makes sure every string in the table is null-terminated, so that strings can be used in place. */
+    if (!data->string_table_size || data->string_table[data->string_table_size - 1] != '\0') {
+        return HM_ERROR_INVALID_DATA;
+    }
+    return HM_OK;
+}
+
+/* Validates that a section of `count` entries whose offset is stored in `header_field` is aligned and lies within
+   the image. */
+static hmError hmMappedImageGetSection(
+    const hm_uint8*  image,
+    hm_nint          image_size,
+    const hm_uint8*  header_field,
+    hm_nint          count,
+    hm_nint          entry_size,
+    const hm_uint8** out_section
+)
+{
+    hm_nint offset = hmMappedImageReadUint32(header_field);
+    hm_nint end = 0;
+    if (hmAddMulNint(offset, count, entry_size, &end) != HM_OK || end > image_size) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    if (offset % HM_MAPPED_IMAGE_ALIGNMENT) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    *out_section = image + offset;
+    return HM_OK;
+}
+
+static hmError hmMappedImageLoaderGetString(hmMappedImageLoaderData* data, hm_uint32 offset, hmString* in_string_view)
+{
+    if (offset >= data->string_table_size) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    return hmCreateStringViewFromCString((const char*)data->string_table + offset, in_string_view);
+}
+
+/* No safe math when computing entry addresses below because the sizes of the tables were validated when the image was
+   loaded. IDs must be strictly ascending: it guarantees they're unique, and allows binary searches. */
+
+static hmError hmMappedImageLoaderEnumModules(hmMappedImageLoaderData* data, hmEnumModuleMetadataFunc func, void* user_data)
+{
+    for (hm_nint i = 0; i < data->module_count; i++) {
+        const hm_uint8* entry = data->module_table + i * HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE;
+        hmModuleMetadata metadata;
+        metadata.module_id = hmMappedImageReadUint32(entry);
+        if (i > 0 && metadata.module_id <= hmMappedImageReadUint32(entry - HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE)) {
+            return HM_ERROR_INVALID_DATA;
+        }
+        HM_TRY(hmMappedImageLoaderGetString(data, hmMappedImageReadUint32(entry + 4), &metadata.name));
+        HM_TRY(func(&metadata, user_data));
+    }
+    return HM_OK;
+}
+
+static hmError hmMappedImageLoaderEnumClasses(hmMappedImageLoaderData* data, hmEnumClassMetadataFunc func, void* user_data)
+{
+    for (hm_nint i = 0; i < data->class_count; i++) {
+        const hm_uint8* entry = data->class_table + i * HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE;
+        hmClassMetadata metadata;
+        HM_TRY(hmMappedImageLoaderReadClass(data, entry, &metadata));
+        if (i > 0 && metadata.class_id <= hmMappedImageReadUint32(entry - HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE)) {
+            return HM_ERROR_INVALID_DATA;
+        }
+        HM_TRY(func(&metadata, user_data));
+    }
+    return HM_OK;
+}
+
+static hmError hmMappedImageLoaderEnumMethods(
+    hmMappedImageLoaderData* data,
+    hm_nint                  start_index,
+    hm_nint                  end_index,
+    hmEnumMethodMetadataFunc func,
+    void*                    user_data
+)
+{
+    for (hm_nint i = start_index; i < end_index; i++) {
+        const hm_uint8* entry = data->method_table + i * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE;
+        hmMethodMetadata metadata;
+        HM_TRY(hmMappedImageLoaderReadMethod(data, entry, &metadata));
+        if (i > 0 && metadata.method_id <= hmMappedImageReadUint32(entry - HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE)) {
+            return HM_ERROR_INVALID_DATA;
+        }
+        HM_TRY(func(&metadata, user_data));
+    }
+    return HM_OK;
+}
+
+static hmError hmMappedImageLoaderReadClass(hmMappedImageLoaderData* data, const hm_uint8* entry, hmClassMetadata* in_metadata)
+{
+    in_metadata->class_id = hmMappedImageReadUint32(entry);
+    in_metadata->module_id = hmMappedImageReadUint32(entry + 4);
+    return hmMappedImageLoaderGetString(data, hmMappedImageReadUint32(entry + 8), &in_metadata->name);
+}
+
+static hmError hmMappedImageLoaderReadMethod(hmMappedImageLoaderData* data, const hm_uint8* entry, hmMethodMetadata* in_metadata)
+{
+    in_metadata->method_id = hmMappedImageReadUint32(entry);
+    in_metadata->class_id = hmMappedImageReadUint32(entry + 4);
+    in_metadata->module_id = hmMappedImageReadUint32(entry + 8);
+    HM_TRY(hmMappedImageLoaderGetString(data, hmMappedImageReadUint32(entry + 12), &in_metadata->name));
+    return hmMappedImageLoaderGetString(data, hmMappedImageReadUint32(entry + 16), &in_metadata->signature);
+}
+
+/* Validates that IDs are strictly ascending (as when enumerating the table), then sorts the indices of the entries with
+   `compare_func`, which is passed `data` as user data. */
+static hmError hmMappedImageLoaderCreateJoinOrder(
+    hmMappedImageLoaderData* data,
+    const hm_uint8*          table,
+    hm_nint                  count,
+    hm_nint                  entry_size,
+    hmCompareFunc            compare_func,
+    hmArray*                 in_order
+)
+{
+    HM_TRY(hmCreateArray(data->allocator, sizeof(hm_nint), count ? count : HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, in_order));
+    hmError err = HM_OK;
+    for (hm_nint i = 0; i < count; i++) {
+        const hm_uint8* entry = table + i * entry_size;
+        if (i > 0 && hmMappedImageReadUint32(entry) <= hmMappedImageReadUint32(entry - entry_size)) {
+            err = HM_ERROR_INVALID_DATA;
+            HM_FINALIZE;
+        }
+        HM_TRY_OR_FINALIZE(err, hmArrayAdd(in_order, &i));
+    }
+    HM_TRY_OR_FINALIZE(err, hmArraySort(in_order, compare_func, data));
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmArrayDispose(in_order));
+    }
+    return err;
+}
+
+static hmComparisonResult hmMappedImageCompareClassJoinOrder(void* value1, void* value2, void* user_data)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)user_data;
+    const hm_uint8* entry1 = data->class_table + *(hm_nint*)value1 * HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE;
+    const hm_uint8* entry2 = data->class_table + *(hm_nint*)value2 * HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE;
+    hmComparisonResult result = hmMappedImageCompareIds(hmMappedImageReadUint32(entry1 + 4), hmMappedImageReadUint32(entry2 + 4));
+    return result != HM_COMPARISON_RESULT_EQUAL
+         ? result
+         : hmMappedImageCompareIds(hmMappedImageReadUint32(entry1), hmMappedImageReadUint32(entry2));
+}
+
+static hmComparisonResult hmMappedImageCompareMethodJoinOrder(void* value1, void* value2, void* user_data)
+{
+    hmMappedImageLoaderData* data = (hmMappedImageLoaderData*)user_data;
+    const hm_uint8* entry1 = data->method_table + *(hm_nint*)value1 * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE;
+    const hm_uint8* entry2 = data->method_table + *(hm_nint*)value2 * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE;
+    hmComparisonResult result = hmMappedImageCompareIds(hmMappedImageReadUint32(entry1 + 8), hmMappedImageReadUint32(entry2 + 8));
+    if (result == HM_COMPARISON_RESULT_EQUAL) {
+        result = hmMappedImageCompareIds(hmMappedImageReadUint32(entry1 + 4), hmMappedImageReadUint32(entry2 + 4));
+    }
+    return result != HM_COMPARISON_RESULT_EQUAL
+         ? result
+         : hmMappedImageCompareIds(hmMappedImageReadUint32(entry1), hmMappedImageReadUint32(entry2));
+}
+
+/* Returns the index of the first method whose ID is not less than `method_id` (the method table is sorted by ID, so it's
+   a binary search, which doesn't touch other parts of the image). If the table isn't actually sorted (which is only
+   detected during enumeration), the search may just miss some methods: every entry is validated before use. */
+static hm_nint hmMappedImageLoaderFindMethodIndex(hmMappedImageLoaderData* data, hm_metadata_id method_id)
+{
+    hm_nint low = 0, high = data->method_count;
+    while (low < high) {
+        hm_nint middle = low + (high - low) / 2;
+        if (hmMappedImageReadUint32(data->method_table + middle * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE) < method_id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static hmError hmMappedImageLoaderGetMethodBody(hmMappedImageLoaderData* data, const hm_uint8* entry, hmMethodBodyMetadata* out_body)
+{
+    hm_nint opcodes_offset = hmMappedImageReadUint32(entry + 20);
+    hm_nint opcodes_size = hmMappedImageReadUint32(entry + 24);
+    if (opcodes_size < HM_MIN_METHOD_SIZE || opcodes_size > HM_MAX_METHOD_SIZE) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    if (opcodes_offset % HM_MAPPED_IMAGE_ALIGNMENT) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    if (opcodes_offset > data->opcode_area_size || opcodes_size > data->opcode_area_size - opcodes_offset) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    out_body->opcodes = data->opcode_area + opcodes_offset;
+    out_body->size = (hm_method_size)opcodes_size;
+    return HM_OK;
+}
+
+/* ******************************* */
+/*    ImageFile => MappedImage.    */
+/* ******************************* */
+
+typedef struct {
+    hm_metadata_id module_id;
+    hm_uint32      name; /* The offset in the string table. */
+} hmMappedImageModuleEntry;
+
+typedef struct {
+    hm_metadata_id class_id;
+    hm_metadata_id module_id;
+    hm_uint32      name;
+} hmMappedImageClassEntry;
+
+typedef struct {
+    hm_metadata_id method_id;
+    hm_metadata_id class_id;
+    hm_metadata_id module_id;
+    hm_uint32      name;
+    hm_uint32      signature;
+    hm_uint32      opcodes_offset; /* The offset in the opcode area. */
+    hm_uint32      opcodes_size;
+} hmMappedImageMethodEntry;
+
+typedef struct {
+    hmAllocator*      allocator;
+    hmMetadataLoader* metadata_loader; /* Method bodies are looked up in the source image as methods are enumerated. */
+    hmArray           modules;         /* hmArray<hmMappedImageModuleEntry> */
+    hmArray           classes;         /* hmArray<hmMappedImageClassEntry> */
+    hmArray           methods;         /* hmArray<hmMappedImageMethodEntry> */
+    hmArray           string_table;    /* hmArray<char> */
+    hmArray           opcode_area;     /* hmArray<char> */
+    hmHashMap         string_offsets;  /* hmHashMap<hmString, hm_uint32> Deduplicates strings in the string table. */
+} hmMappedImageBuilder;
+
+static hmError hmCreateMappedImageBuilder(hmAllocator* allocator, hmMappedImageBuilder* builder);
+static hmError hmMappedImageBuilderDispose(hmMappedImageBuilder* builder);
+static hmError hmMappedImageBuilderInternString(hmMappedImageBuilder* builder, hmString* string, hm_uint32* out_offset);
+static hmError hmMappedImageBuilderWrite(hmMappedImageBuilder* builder, hmWriter* writer);
+static hmError hmMappedImageBuilder_enumModulesFunc(hmModuleMetadata* metadata, void* user_data);
+static hmError hmMappedImageBuilder_enumClassesFunc(hmClassMetadata* metadata, void* user_data);
+static hmError hmMappedImageBuilder_enumMethodsFunc(hmMethodMetadata* metadata, void* user_data);
+static hmError hmMappedImageBuilder_loadMethodBodyFunc(hmMethodBodyMetadata* body, void* user_data);
+static hmComparisonResult hmMappedImageCompareModuleEntries(void* value1, void* value2, void* user_data);
+static hmComparisonResult hmMappedImageCompareClassEntries(void* value1, void* value2, void* user_data);
+static hmComparisonResult hmMappedImageCompareMethodEntries(void* value1, void* value2, void* user_data);
+
+hmError hmConvertImageFileToMappedImage(hmAllocator* allocator, hmString* image_path, hmString* mapped_image_path)
+{
+    hmMetadataLoader metadata_loader;
+    HM_TRY(hmCreateImageFileMetadataLoader(allocator, image_path, &metadata_loader));
+    hmMappedImageBuilder builder;
+    hmError err = hmCreateMappedImageBuilder(allocator, &builder);
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmMetadataLoaderDispose(&metadata_loader));
+    }
+    builder.metadata_loader = &metadata_loader;
+    HM_TRY_OR_FINALIZE(err, hmMetadataLoaderEnumMetadata(
+        &metadata_loader,
+        &hmMappedImageBuilder_enumModulesFunc,
+        &hmMappedImageBuilder_enumClassesFunc,
+        &hmMappedImageBuilder_enumMethodsFunc,
+        &builder
+    ));
+    hmWriter writer;
+    HM_TRY_OR_FINALIZE(err, hmCreateFileWriter(allocator, mapped_image_path, HM_FALSE, &writer));
+    err = hmMappedImageBuilderWrite(&builder, &writer);
+    err = hmMergeErrors(err, hmWriterClose(&writer));
+HM_ON_FINALIZE
+    err = hmMergeErrors(err, hmMappedImageBuilderDispose(&builder));
+    return hmMergeErrors(err, hmMetadataLoaderDispose(&metadata_loader));
+}
+
+static hmError hmCreateMappedImageBuilder(hmAllocator* allocator, hmMappedImageBuilder* builder)
+{
+    builder->allocator = allocator;
+    hmError err = HM_OK;
+    hm_bool is_modules_created = HM_FALSE, is_classes_created = HM_FALSE, is_methods_created = HM_FALSE;
+    hm_bool is_string_table_created = HM_FALSE, is_opcode_area_created = HM_FALSE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(allocator, sizeof(hmMappedImageModuleEntry), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &builder->modules));
+    is_modules_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(allocator, sizeof(hmMappedImageClassEntry), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &builder->classes));
+    is_classes_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(allocator, sizeof(hmMappedImageMethodEntry), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &builder->methods));
+    is_methods_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(allocator, sizeof(char), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &builder->string_table));
+    is_string_table_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(allocator, sizeof(char), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &builder->opcode_area));
+    is_opcode_area_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateHashMapWithStringKeys(
+        allocator,
+        HM_NULL, /* value_dispose_func_opt */
+        sizeof(hm_uint32),
+        HM_HASHMAP_DEFAULT_CAPACITY,
+        HM_HASHMAP_DEFAULT_LOAD_FACTOR,
+        0,       /* hash_salt: strings come from a trusted image */
+        &builder->string_offsets
+    ));
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        if (is_modules_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&builder->modules));
+        }
+        if (is_classes_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&builder->classes));
+        }
+        if (is_methods_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&builder->methods));
+        }
+        if (is_string_table_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&builder->string_table));
+        }
+        if (is_opcode_area_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&builder->opcode_area));
+        }
+    }
+    return err;
+}
+
+static hmError hmMappedImageBuilderDispose(hmMappedImageBuilder* builder)
+{
+    hmError err = hmArrayDispose(&builder->modules);
+    err = hmMergeErrors(err, hmArrayDispose(&builder->classes));
+    err = hmMergeErrors(err, hmArrayDispose(&builder->methods));
+    err = hmMergeErrors(err, hmArrayDispose(&builder->string_table));
+    err = hmMergeErrors(err, hmArrayDispose(&builder->opcode_area));
+    return hmMergeErrors(err, hmHashMapDispose(&builder->string_offsets));
+}
+
+static hmError hmMappedImageBuilderInternString(hmMappedImageBuilder* builder, hmString* string, hm_uint32* out_offset)
+{
+    hmError err = hmHashMapGet(&builder->string_offsets, string, out_offset);
+    if (err != HM_ERROR_NOT_FOUND) {
+        return err;
+    }
+    hm_nint offset = hmArrayGetCount(&builder->string_table);
+    if (offset > HM_UINT32_MAX) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hm_nint size = 0;
+    HM_TRY(hmAddNint(hmStringGetLengthInBytes(string), 1, &size)); /* +1 for the null terminator */
+    HM_TRY(hmArrayAddRange(&builder->string_table, hmStringGetChars(string), size));
+    hmString key;
+    HM_TRY(hmStringDuplicate(builder->allocator, string, &key));
+    hm_uint32 value = (hm_uint32)offset;
+    err = hmHashMapPut(&builder->string_offsets, &key, &value);
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmStringDispose(&key));
+    }
+    *out_offset = value;
+    return HM_OK;
+}
+
+static hmError hmMappedImageBuilder_enumModulesFunc(hmModuleMetadata* metadata, void* user_data)
+{
+    hmMappedImageBuilder* builder = (hmMappedImageBuilder*)user_data;
+    hmMappedImageModuleEntry entry;
+    entry.module_id = metadata->module_id;
+    HM_TRY(hmMappedImageBuilderInternString(builder, &metadata->name, &entry.name));
+    return hmArrayAdd(&builder->modules, &entry);
+}
+
+static hmError hmMappedImageBuilder_enumClassesFunc(hmClassMetadata* metadata, void* user_data)
+{
+    hmMappedImageBuilder* builder = (hmMappedImageBuilder*)user_data;
+    hmMappedImageClassEntry entry;
+    entry.class_id = metadata->class_id;
+    entry.module_id = metadata->module_id;
+    HM_TRY(hmMappedImageBuilderInternString(builder, &metadata->name, &entry.name));
+    return hmArrayAdd(&builder->classes, &entry);
+}
+
+static hmError hmMappedImageBuilder_enumMethodsFunc(hmMethodMetadata* metadata, void* user_data)
+{
+    hmMappedImageBuilder* builder = (hmMappedImageBuilder*)user_data;
+    hmMappedImageMethodEntry entry;
+    entry.method_id = metadata->method_id;
+    entry.class_id = metadata->class_id;
+    entry.module_id = metadata->module_id;
+    HM_TRY(hmMappedImageBuilderInternString(builder, &metadata->name, &entry.name));
+    HM_TRY(hmMappedImageBuilderInternString(builder, &metadata->signature, &entry.signature));
+    /* Each method body starts at an aligned offset, so that opcodes can be read with aligned loads. */
+    hm_nint opcode_area_size = hmArrayGetCount(&builder->opcode_area);
+    HM_TRY(hmArrayExpand(&builder->opcode_area, hmMappedImageAlign(opcode_area_size) - opcode_area_size, HM_NULL, HM_NULL));
+    hm_nint opcodes_offset = hmArrayGetCount(&builder->opcode_area);
+    if (opcodes_offset > HM_UINT32_MAX) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    entry.opcodes_offset = (hm_uint32)opcodes_offset;
+    HM_TRY(hmMetadataLoaderLoadMethodBody(builder->metadata_loader, metadata->method_id, &hmMappedImageBuilder_loadMethodBodyFunc, builder));
+    entry.opcodes_size = (hm_uint32)(hmArrayGetCount(&builder->opcode_area) - opcodes_offset);
+    return hmArrayAdd(&builder->methods, &entry);
+}
+
+static hmError hmMappedImageBuilder_loadMethodBodyFunc(hmMethodBodyMetadata* body, void* user_data)
+{
+    hmMappedImageBuilder* builder = (hmMappedImageBuilder*)user_data;
+    return hmArrayAddRange(&builder->opcode_area, (void*)body->opcodes, body->size);
+}
+
+/* Serializes the image into a single memory block, then writes it out. The converter is an offline tool, so
+   the simplicity is preferred over memory usage. */
+static hmError hmMappedImageBuilderWrite(hmMappedImageBuilder* builder, hmWriter* writer)
+{
+    HM_TRY(hmArraySort(&builder->modules, &hmMappedImageCompareModuleEntries, HM_NULL));
+    HM_TRY(hmArraySort(&builder->classes, &hmMappedImageCompareClassEntries, HM_NULL));
+    HM_TRY(hmArraySort(&builder->methods, &hmMappedImageCompareMethodEntries, HM_NULL));
+    hmMappedImageModuleEntry* modules = hmArrayGetRaw(&builder->modules, hmMappedImageModuleEntry);
+    hmMappedImageClassEntry* classes = hmArrayGetRaw(&builder->classes, hmMappedImageClassEntry);
+    hmMappedImageMethodEntry* methods = hmArrayGetRaw(&builder->methods, hmMappedImageMethodEntry);
+    hm_nint module_count = hmArrayGetCount(&builder->modules);
+    hm_nint class_count = hmArrayGetCount(&builder->classes);
+    hm_nint method_count = hmArrayGetCount(&builder->methods);
+    hm_nint string_table_size = hmArrayGetCount(&builder->string_table);
+    hm_nint opcode_area_size = hmArrayGetCount(&builder->opcode_area);
+    /* Duplicate IDs would make lookups ambiguous. */
+    for (hm_nint i = 1; i < module_count; i++) {
+        if (modules[i].module_id == modules[i - 1].module_id) {
+            return HM_ERROR_INVALID_DATA;
+        }
+    }
+    for (hm_nint i = 1; i < class_count; i++) {
+        if (classes[i].class_id == classes[i - 1].class_id) {
+            return HM_ERROR_INVALID_DATA;
+        }
+    }
+    for (hm_nint i = 1; i < method_count; i++) {
+        if (methods[i].method_id == methods[i - 1].method_id) {
+            return HM_ERROR_INVALID_DATA;
+        }
+    }
+    if (!string_table_size) { /* the loader expects at least one null terminator */
+        char terminator = '\0';
+        HM_TRY(hmArrayAdd(&builder->string_table, &terminator));
+        string_table_size = 1;
+    }
+    /* The layout: 64-bit math is enough because every count is a 32-bit number (or the image is rejected below). */
+    hm_uint64 module_table_offset = HM_MAPPED_IMAGE_HEADER_SIZE;
+    hm_uint64 module_table_size = (hm_uint64)module_count * HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE;
+    hm_uint64 class_table_size = (hm_uint64)class_count * HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE;
+    hm_uint64 method_table_size = (hm_uint64)method_count * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE;
+    hm_uint64 class_table_offset = hmMappedImageAlign(module_table_offset + module_table_size);
+    hm_uint64 method_table_offset = hmMappedImageAlign(class_table_offset + class_table_size);
+    hm_uint64 string_table_offset = hmMappedImageAlign(method_table_offset + method_table_size);
+    hm_uint64 opcode_area_offset = hmMappedImageAlign(string_table_offset + string_table_size);
+    hm_uint64 image_size = opcode_area_offset + opcode_area_size;
+    if (module_count > HM_UINT32_MAX || class_count > HM_UINT32_MAX || method_count > HM_UINT32_MAX) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    if (image_size > HM_UINT32_MAX) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hm_uint8* image = (hm_uint8*)hmAlloc(builder->allocator, (hm_nint)image_size);
+    if (!image) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmZeroMemory(image, (hm_nint)image_size); /* for padding */
+    hmCopyMemory(image, HM_MAPPED_IMAGE_MAGIC, HM_MAPPED_IMAGE_MAGIC_SIZE);
+    const hm_uint32 header[] = {
+        HM_MAPPED_IMAGE_VERSION,
+        (hm_uint32)module_count,
+        (hm_uint32)class_count,
+        (hm_uint32)method_count,
+        (hm_uint32)module_table_offset,
+        (hm_uint32)class_table_offset,
+        (hm_uint32)method_table_offset,
+        (hm_uint32)string_table_offset,
+        (hm_uint32)string_table_size,
+        (hm_uint32)opcode_area_offset,
+        (hm_uint32)opcode_area_size
+    };
+    for (hm_nint i = 0; i < sizeof(header) / sizeof(header[0]); i++) {
+        hmMappedImageWriteUint32(image + HM_MAPPED_IMAGE_MAGIC_SIZE + i * sizeof(hm_uint32), header[i]);
+    }
+    for (hm_nint i = 0; i < module_count; i++) {
+        hm_uint8* entry = image + module_table_offset + i * HM_MAPPED_IMAGE_MODULE_ENTRY_SIZE;
+        hmMappedImageWriteUint32(entry, modules[i].module_id);
+        hmMappedImageWriteUint32(entry + 4, modules[i].name);
+    }
+    for (hm_nint i = 0; i < class_count; i++) {
+        hm_uint8* entry = image + class_table_offset + i * HM_MAPPED_IMAGE_CLASS_ENTRY_SIZE;
+        hmMappedImageWriteUint32(entry, classes[i].class_id);
+        hmMappedImageWriteUint32(entry + 4, classes[i].module_id);
+        hmMappedImageWriteUint32(entry + 8, classes[i].name);
+    }
+    for (hm_nint i = 0; i < method_count; i++) {
+        hm_uint8* entry = image + method_table_offset + i * HM_MAPPED_IMAGE_METHOD_ENTRY_SIZE;
+        hmMappedImageWriteUint32(entry, methods[i].method_id);
+        hmMappedImageWriteUint32(entry + 4, methods[i].class_id);
+        hmMappedImageWriteUint32(entry + 8, methods[i].module_id);
+        hmMappedImageWriteUint32(entry + 12, methods[i].name);
+        hmMappedImageWriteUint32(entry + 16, methods[i].signature);
+        hmMappedImageWriteUint32(entry + 20, methods[i].opcodes_offset);
+        hmMappedImageWriteUint32(entry + 24, methods[i].opcodes_size);
+    }
+    hmCopyMemory(image + string_table_offset, builder->string_table.items, string_table_size);
+    if (opcode_area_size > 0) {
+        hmCopyMemory(image + opcode_area_offset, builder->opcode_area.items, opcode_area_size);
+    }
+    hmError err = hmWriterWriteAll(writer, (const char*)image, (hm_nint)image_size);
+    hmFree(builder->allocator, image);
+    return err;
+}
+
+static hmComparisonResult hmMappedImageCompareIds(hm_metadata_id id1, hm_metadata_id id2)
+{
+    if (id1 < id2) {
+        return HM_COMPARISON_RESULT_LESS;
+    }
+    return id1 > id2 ? HM_COMPARISON_RESULT_GREATER : HM_COMPARISON_RESULT_EQUAL;
+}
+
+static hmComparisonResult hmMappedImageCompareModuleEntries(void* value1, void* value2, void* user_data)
+{
+    hmMappedImageModuleEntry* entry1 = (hmMappedImageModuleEntry*)value1;
+    hmMappedImageModuleEntry* entry2 = (hmMappedImageModuleEntry*)value2;
+    return hmMappedImageCompareIds(entry1->module_id, entry2->module_id);
+}
+
+static hmComparisonResult hmMappedImageCompareClassEntries(void* value1, void* value2, void* user_data)
+{
+    hmMappedImageClassEntry* entry1 = (hmMappedImageClassEntry*)value1;
+    hmMappedImageClassEntry* entry2 = (hmMappedImageClassEntry*)value2;
+    return hmMappedImageCompareIds(entry1->class_id, entry2->class_id);
+}
+
+static hmComparisonResult hmMappedImageCompareMethodEntries(void* value1, void* value2, void* user_data)
+{
+    hmMappedImageMethodEntry* entry1 = (hmMappedImageMethodEntry*)value1;
+    hmMappedImageMethodEntry* entry2 = (hmMappedImageMethodEntry*)value2;
+    return hmMappedImageCompareIds(entry1->method_id, entry2->method_id);
+}
+
+static hm_uint32 hmMappedImageReadUint32(const hm_uint8* bytes)
+{
+    return (hm_uint32)bytes[0] | ((hm_uint32)bytes[1] << 8) | ((hm_uint32)bytes[2] << 16) | ((hm_uint32)bytes[3] << 24);
+}
+
+static void hmMappedImageWriteUint32(hm_uint8* bytes, hm_uint32 value)
+{
+    bytes[0] = (hm_uint8)value;
+    bytes[1] = (hm_uint8)(value >> 8);
+    bytes[2] = (hm_uint8)(value >> 16);
+    bytes[3] = (hm_uint8)(value >> 24);
+}
+
+static hm_uint64 hmMappedImageAlign(hm_uint64 offset)
+{
+    return (offset + HM_MAPPED_IMAGE_ALIGNMENT - 1) / HM_MAPPED_IMAGE_ALIGNMENT * HM_MAPPED_IMAGE_ALIGNMENT;
+}
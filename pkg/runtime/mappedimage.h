@@ -0,0 +1,52 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_MAPPED_IMAGE_H
+#define HM_MAPPED_IMAGE_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <core/string.h>
+#include <runtime/metadata.h>
+
+/* A mapped image is a compact binary alternative to SQLite image files, designed to be mapped into memory and used
+   in place: loading it costs as much as the pages actually touched, not the rows scanned. All integers are 32-bit
+   little-endian, all offsets are relative to the beginning of the file, all sections start at 8-byte boundaries.
+
+   Header:
+     magic ("HMIM"), version (HM_MAPPED_IMAGE_VERSION),
+     module count, class count, method count,
+     module table offset, class table offset, method table offset,
+     string table offset, string table size,
+     opcode area offset, opcode area size
+   Module table entry: module_id, name
+   Class table entry:  class_id, module_id, name
+   Method table entry: method_id, class_id, module_id, name, signature, opcodes offset, opcodes size
+
+   Each table is sorted by ID (IDs are unique), so an object can be found with a binary search. Names and signatures
+   are offsets into the string table, which holds deduplicated null-terminated strings. Opcode offsets are relative
+   to the opcode area, each method body starts at an 8-byte boundary. */
+#define HM_MAPPED_IMAGE_MAGIC   "HMIM"
+#define HM_MAPPED_IMAGE_VERSION 1
+
+/* Creates a metadata loader which loads metadata from a mapped image file specified by `image_path` (see above).
+   The image is mapped once, when the loader is created; names, signatures and opcodes passed to the callbacks point
+   directly into the mapping, and stay valid until the loader is disposed of. Returns HM_ERROR_INVALID_DATA if the image
+   is malformed (the image is validated as it's enumerated, so it's safe to load untrusted images). */
+hmError hmCreateMappedImageMetadataLoader(hmAllocator* allocator, hmString* image_path, hmMetadataLoader* in_metadata_loader);
+/* Converts an SQLite image file at `image_path` (see hmCreateImageFileMetadataLoader(..)) to a mapped image file
+   at `mapped_image_path` (overwritten if it exists). Returns HM_ERROR_INVALID_DATA if the image file has duplicate IDs,
+   and HM_ERROR_LIMIT_EXCEEDED if the resulting image would be larger than 4GB. */
+hmError hmConvertImageFileToMappedImage(hmAllocator* allocator, hmString* image_path, hmString* mapped_image_path);
+
+#endif /* HM_MAPPED_IMAGE_H */
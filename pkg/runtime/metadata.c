@@ -12,11 +12,12 @@
 * ******************************************************************************/
 
 #include <runtime/metadata.h>
+#include <threading/mutex.h>
 #include <vendor/sqlite3/sqlite3.h>
 
 static hm_bool hmIsValidMetadataName(hmString* name);
 
-hm_bool hmValidateMetadataName(hmString* name)
+hmError hmValidateMetadataName(hmString* name)
 {
     hm_bool is_valid = hmIsValidMetadataName(name);
     if (!is_valid) {
@@ -30,6 +31,43 @@ hmError hmMetadataLoaderDispose(hmMetadataLoader* metadata_loader)
     return metadata_loader->dispose(metadata_loader);
 }
 
+hmError hmMetadataLoaderEnumJoinedMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func,
+    hmEnumClassMetadataFunc  enum_classes_func,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+)
+{
+    return metadata_loader->enumJoinedMetadata(metadata_loader, enum_modules_func, enum_classes_func, enum_methods_func, user_data);
+}
+
+hmError hmMetadataLoaderEnumMethodsInRange(
+    hmMetadataLoader*        metadata_loader,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+)
+{
+    return metadata_loader->enumMethodsInRange(metadata_loader, min_method_id, max_method_id, enum_methods_func, user_data);
+}
+
+hmError hmMetadataLoaderGetMethodIDRange(hmMetadataLoader* metadata_loader, hm_metadata_id* out_min_id, hm_metadata_id* out_max_id)
+{
+    return metadata_loader->getMethodIDRange(metadata_loader, out_min_id, out_max_id);
+}
+
+hmError hmMetadataLoaderLoadMethodBody(
+    hmMetadataLoader*    metadata_loader,
+    hm_metadata_id       method_id,
+    hmLoadMethodBodyFunc load_body_func,
+    void*                user_data
+)
+{
+    return metadata_loader->loadMethodBody(metadata_loader, method_id, load_body_func, user_data);
+}
+
 hmError hmMetadataLoaderEnumMetadata(
     hmMetadataLoader*        metadata_loader,
     hmEnumModuleMetadataFunc enum_modules_func_opt,
@@ -75,18 +113,75 @@ static hm_bool hmIsValidMetadataName(hmString* name)
 /*      ImageFileMetadataLoader.    */
 /* ******************************** */
 
+/* Image files are read-only, so mapping them (up to this size) saves copying every page through the page cache. */
+#define HM_IMAGE_FILE_MMAP_SIZE "268435456" /* 256 MB */
+/* In KiB (hence negative, see SQLite's PRAGMA cache_size): enough to keep the tables and indices of a large image. */
+#define HM_IMAGE_FILE_CACHE_SIZE "-8192"
+
+/* Statements which are prepared once (on first use) and cached for the lifetime of the loader. */
+typedef enum {
+    HM_IMAGE_FILE_QUERY_MODULES,
+    HM_IMAGE_FILE_QUERY_CLASSES,
+    HM_IMAGE_FILE_QUERY_METHODS,
+    HM_IMAGE_FILE_QUERY_JOINED_METADATA,
+    HM_IMAGE_FILE_QUERY_METHOD_ID_RANGE,
+    HM_IMAGE_FILE_QUERY_METHOD_BODY,
+    HM_IMAGE_FILE_QUERY_COUNT
+} hmImageFileQuery;
+
+static const char* hmImageFileQueries[HM_IMAGE_FILE_QUERY_COUNT] = {
+    "SELECT module_id, name FROM module",
+    "SELECT class_id, module_id, name FROM class",
+    "SELECT method_id, class_id, module_id, name, signature FROM method",
+    /* Full joins make orphaned classes and methods show up as rows without a module (rather than be skipped silently);
+       sorting by rowids as well separates rows of duplicate modules/classes, so that duplicates are reported as such. */
+    "SELECT module.rowid, module.module_id, module.name, class.rowid, class.class_id, class.name, "
+    "method.method_id, method.name, method.signature "
+    "FROM module "
+    "FULL JOIN class ON class.module_id = module.module_id "
+    "FULL JOIN method ON method.class_id = class.class_id AND method.module_id = class.module_id "
+    "ORDER BY module.module_id, module.rowid, class.class_id, class.rowid, method.method_id",
+    "SELECT min(method_id), max(method_id) FROM method",
+    "SELECT code, length(code) FROM method WHERE method_id = ?"
+};
+
 typedef struct {
-    hmAllocator* allocator;
-    hmString     image_path;
+    hmAllocator*  allocator;
+    hmString      image_path;
+    sqlite3*      db_opt;                               /* Opened on first use and kept open. */
+    sqlite3_stmt* stmts[HM_IMAGE_FILE_QUERY_COUNT];     /* Prepared on first use (HM_NULL until then). */
+    hmMutex       body_mutex;                           /* Serializes hmMetadataLoaderLoadMethodBody(..), which uses
+                                                           `db_opt` and `stmts` and can be called by several workers. */
 } hmImageFileMetadataLoaderData;
 
-static hmError hmImageFileMetadataLoaderEnumModules(sqlite3* db, hmEnumModuleMetadataFunc enum_modules_func, void* user_data);
-static hmError hmImageFileMetadataLoaderEnumClasses(sqlite3* db, hmEnumClassMetadataFunc enum_classes_func, void* user_data);
-static hmError hmImageFileMetadataLoaderEnumMethods(sqlite3* db, hmEnumMethodMetadataFunc enum_methods_func, void* user_data);
+static hmError hmImageFileMetadataLoaderEnumModules(hmImageFileMetadataLoaderData* data, hmEnumModuleMetadataFunc func, void* user_data);
+static hmError hmImageFileMetadataLoaderEnumClasses(hmImageFileMetadataLoaderData* data, hmEnumClassMetadataFunc func, void* user_data);
+static hmError hmImageFileMetadataLoaderEnumMethods(hmImageFileMetadataLoaderData* data, hmEnumMethodMetadataFunc func, void* user_data);
 static hmError hmSqlite3GetMetadataIdFromStatement(sqlite3* db, sqlite3_stmt* stmt, int column_index, hm_metadata_id* out_id);
 static hmError hmSqlite3GetMethodSizeFromStatement(sqlite3* db, sqlite3_stmt* stmt, int column_index, hm_method_size* out_size);
 static hmError hmSqlite3GetStringViewFromStatement(sqlite3* db, sqlite3_stmt* stmt, int column_index, hmString* in_string_view);
 static hmError hmSqlite3GetBlobFromStatement(sqlite3* db, sqlite3_stmt* stmt, int column_index, const hm_uint8** out_blob);
+static hmError hmImageFileMetadataLoaderEnumMethodsInRange(
+    sqlite3*                 db,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+);
+static hmError hmImageFileMetadataLoaderReadMethod(sqlite3* db, sqlite3_stmt* stmt, hmMethodMetadata* in_metadata);
+static hmError hmImageFileMetadataLoaderLoadMethodBody(
+    hmImageFileMetadataLoaderData* data,
+    hm_metadata_id                 method_id,
+    hmLoadMethodBodyFunc           load_body_func,
+    void*                          user_data
+);
+static hmError hmImageFileMetadataLoaderOpenDatabase(
+    hmImageFileMetadataLoaderData* data,
+    hm_bool                        is_shared,
+    sqlite3**                      out_db
+);
+static hmError hmImageFileMetadataLoaderCloseDatabase(sqlite3* db);
+static hmError hmImageFileMetadataLoaderGetStatement(hmImageFileMetadataLoaderData* data, hmImageFileQuery query, sqlite3_stmt** out_stmt);
 static hmError hmImageFileMetadataLoader_enumMetadata(
     hmMetadataLoader*        metadata_loader,
     hmEnumModuleMetadataFunc enum_modules_func_opt,
@@ -94,6 +189,31 @@ static hmError hmImageFileMetadataLoader_enumMetadata(
     hmEnumMethodMetadataFunc enum_methods_func_opt,
     void* user_data
 );
+static hmError hmImageFileMetadataLoader_enumJoinedMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func,
+    hmEnumClassMetadataFunc  enum_classes_func,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+);
+static hmError hmImageFileMetadataLoader_enumMethodsInRange(
+    hmMetadataLoader*        metadata_loader,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+);
+static hmError hmImageFileMetadataLoader_getMethodIDRange(
+    hmMetadataLoader* metadata_loader,
+    hm_metadata_id*   out_min_id,
+    hm_metadata_id*   out_max_id
+);
+static hmError hmImageFileMetadataLoader_loadMethodBody(
+    hmMetadataLoader*    metadata_loader,
+    hm_metadata_id       method_id,
+    hmLoadMethodBodyFunc load_body_func,
+    void*                user_data
+);
 static hmError hmImageFileMetadataLoader_dispose(hmMetadataLoader* metadata_loader);
 
 hmError hmCreateImageFileMetadataLoader(hmAllocator* allocator, hmString* image_path, hmMetadataLoader* in_metadata_loader)
@@ -103,13 +223,27 @@ hmError hmCreateImageFileMetadataLoader(hmAllocator* allocator, hmString* image_
         return HM_ERROR_OUT_OF_MEMORY;
     }
     hmError err = HM_OK;
+    hm_bool is_image_path_initialized = HM_FALSE;
     HM_TRY_OR_FINALIZE(err, hmStringDuplicate(allocator, image_path, &data->image_path));
+    is_image_path_initialized = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateMutex(allocator, &data->body_mutex));
     data->allocator = allocator;
+    data->db_opt = HM_NULL;
+    for (hm_nint i = 0; i < HM_IMAGE_FILE_QUERY_COUNT; i++) {
+        data->stmts[i] = HM_NULL;
+    }
     in_metadata_loader->enumMetadata = &hmImageFileMetadataLoader_enumMetadata;
+    in_metadata_loader->enumJoinedMetadata = &hmImageFileMetadataLoader_enumJoinedMetadata;
+    in_metadata_loader->enumMethodsInRange = &hmImageFileMetadataLoader_enumMethodsInRange;
+    in_metadata_loader->getMethodIDRange = &hmImageFileMetadataLoader_getMethodIDRange;
+    in_metadata_loader->loadMethodBody = &hmImageFileMetadataLoader_loadMethodBody;
     in_metadata_loader->dispose = &hmImageFileMetadataLoader_dispose;
     in_metadata_loader->data = data;
 HM_ON_FINALIZE
     if (err != HM_OK) {
+        if (is_image_path_initialized) {
+            err = hmMergeErrors(err, hmStringDispose(&data->image_path));
+        }
         hmFree(allocator, data);
     }
     return err;
@@ -119,10 +253,65 @@ static hmError hmImageFileMetadataLoader_dispose(hmMetadataLoader* metadata_load
 {
     hmImageFileMetadataLoaderData* data = (hmImageFileMetadataLoaderData*)metadata_loader->data;
     hmError err = hmStringDispose(&data->image_path);
+    err = hmMergeErrors(err, hmMutexDispose(&data->body_mutex));
+    for (hm_nint i = 0; i < HM_IMAGE_FILE_QUERY_COUNT; i++) {
+        if (data->stmts[i] && sqlite3_finalize(data->stmts[i]) != SQLITE_OK) {
+            err = hmMergeErrors(err, HM_ERROR_PLATFORM_DEPENDENT);
+        }
+    }
+    if (data->db_opt) {
+        err = hmMergeErrors(err, hmImageFileMetadataLoaderCloseDatabase(data->db_opt));
+    }
     hmFree(data->allocator, data);
     return err;
 }
 
+static hmError hmImageFileMetadataLoader_loadMethodBody(
+    hmMetadataLoader*    metadata_loader,
+    hm_metadata_id       method_id,
+    hmLoadMethodBodyFunc load_body_func,
+    void*                user_data
+)
+{
+    hmImageFileMetadataLoaderData* data = (hmImageFileMetadataLoaderData*)metadata_loader->data;
+    HM_TRY(hmMutexLock(&data->body_mutex));
+    hmError err = hmImageFileMetadataLoaderLoadMethodBody(data, method_id, load_body_func, user_data);
+    return hmMergeErrors(err, hmMutexUnlock(&data->body_mutex));
+}
+
+/* See hmImageFileMetadataLoader_loadMethodBody(..) Must be called under `body_mutex`. */
+static hmError hmImageFileMetadataLoaderLoadMethodBody(
+    hmImageFileMetadataLoaderData* data,
+    hm_metadata_id                 method_id,
+    hmLoadMethodBodyFunc           load_body_func,
+    void*                          user_data
+)
+{
+    sqlite3_stmt* stmt = HM_NULL;
+    HM_TRY(hmImageFileMetadataLoaderGetStatement(data, HM_IMAGE_FILE_QUERY_METHOD_BODY, &stmt));
+    hmError err = HM_OK;
+    if (sqlite3_bind_int64(stmt, 1, method_id) != SQLITE_OK) {
+        err = HM_ERROR_PLATFORM_DEPENDENT;
+        HM_FINALIZE;
+    }
+    int sqlite_err = sqlite3_step(stmt);
+    if (sqlite_err == SQLITE_DONE) {
+        err = HM_ERROR_NOT_FOUND;
+        HM_FINALIZE;
+    }
+    if (sqlite_err != SQLITE_ROW) {
+        err = HM_ERROR_INVALID_DATA;
+        HM_FINALIZE;
+    }
+    hmMethodBodyMetadata body;
+    HM_TRY_OR_FINALIZE(err, hmSqlite3GetBlobFromStatement(data->db_opt, stmt, 0, &body.opcodes));
+    HM_TRY_OR_FINALIZE(err, hmSqlite3GetMethodSizeFromStatement(data->db_opt, stmt, 1, &body.size));
+    HM_TRY_OR_FINALIZE(err, load_body_func(&body, user_data));
+HM_ON_FINALIZE
+    sqlite3_reset(stmt); /* Makes the statement reusable; its result only repeats the error of sqlite3_step(..) */
+    return err;
+}
+
 static hmError hmImageFileMetadataLoader_enumMetadata(
     hmMetadataLoader*        metadata_loader,
     hmEnumModuleMetadataFunc enum_modules_func_opt,
@@ -132,99 +321,216 @@ static hmError hmImageFileMetadataLoader_enumMetadata(
 )
 {
     hmImageFileMetadataLoaderData* data = (hmImageFileMetadataLoaderData*)metadata_loader->data;
-    hmError err = HM_OK;
-    sqlite3* db = HM_NULL;
-    int sqlite_err = sqlite3_open_v2(hmStringGetCString(&data->image_path), &db, SQLITE_OPEN_READONLY, HM_NULL);
-    if (sqlite_err != SQLITE_OK) {
-        return HM_ERROR_NOT_FOUND;
-    }
     if (enum_modules_func_opt) {
-        err = hmImageFileMetadataLoaderEnumModules(db, enum_modules_func_opt, user_data);
+        HM_TRY(hmImageFileMetadataLoaderEnumModules(data, enum_modules_func_opt, user_data));
     }
     if (enum_classes_func_opt) {
-        err = hmMergeErrors(err, hmImageFileMetadataLoaderEnumClasses(db, enum_classes_func_opt, user_data));
+        HM_TRY(hmImageFileMetadataLoaderEnumClasses(data, enum_classes_func_opt, user_data));
     }
     if (enum_methods_func_opt) {
-        err = hmMergeErrors(err, hmImageFileMetadataLoaderEnumMethods(db, enum_methods_func_opt, user_data));
+        HM_TRY(hmImageFileMetadataLoaderEnumMethods(data, enum_methods_func_opt, user_data));
     }
-    sqlite_err = sqlite3_close(db);
-    if (sqlite_err != SQLITE_OK) {
-        err = hmMergeErrors(err, HM_ERROR_PLATFORM_DEPENDENT);
+    return HM_OK;
+}
+
+/* Every call uses its own connection, so that partitions of the method table can be loaded in parallel. */
+static hmError hmImageFileMetadataLoader_enumMethodsInRange(
+    hmMetadataLoader*        metadata_loader,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+)
+{
+    hmImageFileMetadataLoaderData* data = (hmImageFileMetadataLoaderData*)metadata_loader->data;
+    sqlite3* db = HM_NULL;
+    HM_TRY(hmImageFileMetadataLoaderOpenDatabase(data, HM_FALSE, &db));
+    hmError err = hmImageFileMetadataLoaderEnumMethodsInRange(db, min_method_id, max_method_id, enum_methods_func, user_data);
+    return hmMergeErrors(err, hmImageFileMetadataLoaderCloseDatabase(db));
+}
+
+static hmError hmImageFileMetadataLoader_getMethodIDRange(
+    hmMetadataLoader* metadata_loader,
+    hm_metadata_id*   out_min_id,
+    hm_metadata_id*   out_max_id
+)
+{
+    hmImageFileMetadataLoaderData* data = (hmImageFileMetadataLoaderData*)metadata_loader->data;
+    sqlite3_stmt* stmt = HM_NULL;
+    HM_TRY(hmImageFileMetadataLoaderGetStatement(data, HM_IMAGE_FILE_QUERY_METHOD_ID_RANGE, &stmt));
+    hmError err = HM_OK;
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        err = HM_ERROR_INVALID_DATA;
+        HM_FINALIZE;
+    }
+    if (sqlite3_column_type(stmt, 0) == SQLITE_NULL) { /* min(..) and max(..) of an empty table */
+        err = HM_ERROR_NOT_FOUND;
+        HM_FINALIZE;
     }
+    HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(data->db_opt, stmt, 0, out_min_id));
+    HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(data->db_opt, stmt, 1, out_max_id));
+HM_ON_FINALIZE
+    sqlite3_reset(stmt);
     return err;
 }
 
-#define HM_BEGIN_SQLITE3_QUERY(query) \
-    hmError err = HM_OK; \
-    sqlite3_stmt* stmt; \
-    int sqlite_err = sqlite3_prepare_v2( \
-        db, \
-        query, \
-        -1, \
-        &stmt, \
-        HM_NULL \
-    ); \
-    if (sqlite_err != SQLITE_OK) { \
-        err = HM_ERROR_INVALID_DATA; \
-        HM_FINALIZE; \
-    } \
+/* Steps through the rows of `stmt`: the code between HM_BEGIN_SQLITE3_ROWS(..) and HM_END_SQLITE3_ROWS() is run for every
+   row. Jumps to HM_ON_FINALIZE when there are no more rows, or on error (`err` must be declared beforehand). */
+#define HM_BEGIN_SQLITE3_ROWS(stmt) \
     for (;;) { \
-        sqlite_err = sqlite3_step(stmt); \
-        switch (sqlite_err) { \
-            case SQLITE_ROW: \
-                {
-
-#define HM_END_SQLITE3_QUERY() \
-                } \
-                break; \
-            case SQLITE_DONE: \
-                HM_FINALIZE; \
-            case SQLITE_ERROR: \
-                err = HM_ERROR_INVALID_DATA; \
-                HM_FINALIZE; \
+        int sqlite_err = sqlite3_step(stmt); \
+        if (sqlite_err == SQLITE_DONE) { \
+            HM_FINALIZE; \
         } \
-    } \
-HM_ON_FINALIZE \
-    sqlite_err = sqlite3_finalize(stmt); \
-    if (sqlite_err != SQLITE_OK) { \
-        err = hmMergeErrors(err, HM_ERROR_PLATFORM_DEPENDENT); \
-    } \
-    return err;
+        if (sqlite_err != SQLITE_ROW) { \
+            err = HM_ERROR_INVALID_DATA; \
+            HM_FINALIZE; \
+        } \
+        {
 
-static hmError hmImageFileMetadataLoaderEnumModules(sqlite3* db, hmEnumModuleMetadataFunc enum_modules_func_opt, void* user_data)
+#define HM_END_SQLITE3_ROWS() \
+        } \
+    }
+
+static hmError hmImageFileMetadataLoaderEnumModules(hmImageFileMetadataLoaderData* data, hmEnumModuleMetadataFunc func, void* user_data)
 {
-    HM_BEGIN_SQLITE3_QUERY("SELECT module_id, name FROM module")
+    sqlite3_stmt* stmt = HM_NULL;
+    HM_TRY(hmImageFileMetadataLoaderGetStatement(data, HM_IMAGE_FILE_QUERY_MODULES, &stmt));
+    hmError err = HM_OK;
+    HM_BEGIN_SQLITE3_ROWS(stmt)
         hmModuleMetadata metadata;
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 0, &metadata.module_id));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 1, &metadata.name));
-        HM_TRY_OR_FINALIZE(err, enum_modules_func_opt(&metadata, user_data));
-    HM_END_SQLITE3_QUERY()
+        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(data->db_opt, stmt, 0, &metadata.module_id));
+        HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(data->db_opt, stmt, 1, &metadata.name));
+        HM_TRY_OR_FINALIZE(err, func(&metadata, user_data));
+    HM_END_SQLITE3_ROWS()
+HM_ON_FINALIZE
+    sqlite3_reset(stmt);
+    return err;
 }
 
-static hmError hmImageFileMetadataLoaderEnumClasses(sqlite3* db, hmEnumClassMetadataFunc enum_classes_func_opt, void* user_data)
+static hmError hmImageFileMetadataLoaderEnumClasses(hmImageFileMetadataLoaderData* data, hmEnumClassMetadataFunc func, void* user_data)
 {
-    HM_BEGIN_SQLITE3_QUERY("SELECT class_id, module_id, name FROM class")
+    sqlite3_stmt* stmt = HM_NULL;
+    HM_TRY(hmImageFileMetadataLoaderGetStatement(data, HM_IMAGE_FILE_QUERY_CLASSES, &stmt));
+    hmError err = HM_OK;
+    HM_BEGIN_SQLITE3_ROWS(stmt)
         hmClassMetadata metadata;
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 0, &metadata.class_id));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 1, &metadata.module_id));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 2, &metadata.name));
-        HM_TRY_OR_FINALIZE(err, enum_classes_func_opt(&metadata, user_data));
-    HM_END_SQLITE3_QUERY()
+        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(data->db_opt, stmt, 0, &metadata.class_id));
+        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(data->db_opt, stmt, 1, &metadata.module_id));
+        HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(data->db_opt, stmt, 2, &metadata.name));
+        HM_TRY_OR_FINALIZE(err, func(&metadata, user_data));
+    HM_END_SQLITE3_ROWS()
+HM_ON_FINALIZE
+    sqlite3_reset(stmt);
+    return err;
 }
 
-static hmError hmImageFileMetadataLoaderEnumMethods(sqlite3* db, hmEnumMethodMetadataFunc enum_methods_func_opt, void* user_data)
+static hmError hmImageFileMetadataLoaderEnumMethods(hmImageFileMetadataLoaderData* data, hmEnumMethodMetadataFunc func, void* user_data)
 {
-    HM_BEGIN_SQLITE3_QUERY("SELECT method_id, class_id, module_id, name, signature, code, length(code) AS code_length FROM method")
+    sqlite3_stmt* stmt = HM_NULL;
+    HM_TRY(hmImageFileMetadataLoaderGetStatement(data, HM_IMAGE_FILE_QUERY_METHODS, &stmt));
+    hmError err = HM_OK;
+    HM_BEGIN_SQLITE3_ROWS(stmt)
         hmMethodMetadata metadata;
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 0, &metadata.method_id));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 1, &metadata.class_id));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 2, &metadata.module_id));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 3, &metadata.name));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 4, &metadata.signature));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetBlobFromStatement(db, stmt, 5, &metadata.body.opcodes));
-        HM_TRY_OR_FINALIZE(err, hmSqlite3GetMethodSizeFromStatement(db, stmt, 6, &metadata.body.size));
-        HM_TRY_OR_FINALIZE(err, enum_methods_func_opt(&metadata, user_data));
-    HM_END_SQLITE3_QUERY()
+        HM_TRY_OR_FINALIZE(err, hmImageFileMetadataLoaderReadMethod(data->db_opt, stmt, &metadata));
+        HM_TRY_OR_FINALIZE(err, func(&metadata, user_data));
+    HM_END_SQLITE3_ROWS()
+HM_ON_FINALIZE
+    sqlite3_reset(stmt);
+    return err;
+}
+
+/* A module is reported when its rowid changes, a class -- when its rowid changes or a new module starts (see the query). */
+static hmError hmImageFileMetadataLoader_enumJoinedMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func,
+    hmEnumClassMetadataFunc  enum_classes_func,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+)
+{
+    hmImageFileMetadataLoaderData* data = (hmImageFileMetadataLoaderData*)metadata_loader->data;
+    sqlite3_stmt* stmt = HM_NULL;
+    HM_TRY(hmImageFileMetadataLoaderGetStatement(data, HM_IMAGE_FILE_QUERY_JOINED_METADATA, &stmt));
+    sqlite3* db = data->db_opt;
+    hmError err = HM_OK;
+    hm_bool has_module = HM_FALSE, has_class = HM_FALSE;
+    sqlite3_int64 module_rowid = 0, class_rowid = 0;
+    hmModuleMetadata module_metadata;
+    hmClassMetadata class_metadata;
+    HM_BEGIN_SQLITE3_ROWS(stmt)
+        if (sqlite3_column_type(stmt, 0) == SQLITE_NULL) { /* A class or a method which refers to a missing module/class. */
+            err = HM_ERROR_INVALID_DATA;
+            HM_FINALIZE;
+        }
+        if (!has_module || sqlite3_column_int64(stmt, 0) != module_rowid) {
+            module_rowid = sqlite3_column_int64(stmt, 0);
+            has_module = HM_TRUE;
+            has_class = HM_FALSE;
+            HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 1, &module_metadata.module_id));
+            HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 2, &module_metadata.name));
+            HM_TRY_OR_FINALIZE(err, enum_modules_func(&module_metadata, user_data));
+        }
+        if (sqlite3_column_type(stmt, 3) != SQLITE_NULL && (!has_class || sqlite3_column_int64(stmt, 3) != class_rowid)) {
+            class_rowid = sqlite3_column_int64(stmt, 3);
+            has_class = HM_TRUE;
+            class_metadata.module_id = module_metadata.module_id;
+            HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 4, &class_metadata.class_id));
+            HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 5, &class_metadata.name));
+            HM_TRY_OR_FINALIZE(err, enum_classes_func(&class_metadata, user_data));
+        }
+        if (sqlite3_column_type(stmt, 6) != SQLITE_NULL) { /* Classes without methods have a single row with NULL methods. */
+            hmMethodMetadata method_metadata;
+            method_metadata.class_id = class_metadata.class_id;
+            method_metadata.module_id = module_metadata.module_id;
+            HM_TRY_OR_FINALIZE(err, hmSqlite3GetMetadataIdFromStatement(db, stmt, 6, &method_metadata.method_id));
+            HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 7, &method_metadata.name));
+            HM_TRY_OR_FINALIZE(err, hmSqlite3GetStringViewFromStatement(db, stmt, 8, &method_metadata.signature));
+            HM_TRY_OR_FINALIZE(err, enum_methods_func(&method_metadata, user_data));
+        }
+    HM_END_SQLITE3_ROWS()
+HM_ON_FINALIZE
+    sqlite3_reset(stmt);
+    return err;
+}
+
+static hmError hmImageFileMetadataLoaderEnumMethodsInRange(
+    sqlite3*                 db,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+)
+{
+    sqlite3_stmt* stmt = HM_NULL;
+    const char* query = "SELECT method_id, class_id, module_id, name, signature FROM method WHERE method_id BETWEEN ?1 AND ?2";
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, HM_NULL) != SQLITE_OK) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hmError err = HM_OK;
+    if (sqlite3_bind_int64(stmt, 1, min_method_id) != SQLITE_OK || sqlite3_bind_int64(stmt, 2, max_method_id) != SQLITE_OK) {
+        err = HM_ERROR_PLATFORM_DEPENDENT;
+        HM_FINALIZE;
+    }
+    HM_BEGIN_SQLITE3_ROWS(stmt)
+        hmMethodMetadata metadata;
+        HM_TRY_OR_FINALIZE(err, hmImageFileMetadataLoaderReadMethod(db, stmt, &metadata));
+        HM_TRY_OR_FINALIZE(err, enum_methods_func(&metadata, user_data));
+    HM_END_SQLITE3_ROWS()
+HM_ON_FINALIZE
+    if (sqlite3_finalize(stmt) != SQLITE_OK) {
+        err = hmMergeErrors(err, HM_ERROR_PLATFORM_DEPENDENT);
+    }
+    return err;
+}
+
+static hmError hmImageFileMetadataLoaderReadMethod(sqlite3* db, sqlite3_stmt* stmt, hmMethodMetadata* in_metadata)
+{
+    HM_TRY(hmSqlite3GetMetadataIdFromStatement(db, stmt, 0, &in_metadata->method_id));
+    HM_TRY(hmSqlite3GetMetadataIdFromStatement(db, stmt, 1, &in_metadata->class_id));
+    HM_TRY(hmSqlite3GetMetadataIdFromStatement(db, stmt, 2, &in_metadata->module_id));
+    HM_TRY(hmSqlite3GetStringViewFromStatement(db, stmt, 3, &in_metadata->name));
+    return hmSqlite3GetStringViewFromStatement(db, stmt, 4, &in_metadata->signature);
 }
 
 static hm_bool hmHasSqlite3ErrorOccurred(sqlite3* db) {
@@ -276,3 +582,69 @@ static hmError hmSqlite3GetBlobFromStatement(sqlite3* db, sqlite3_stmt* stmt, in
     *out_blob = blob;
     return HM_OK;
 }
+
+/* The persistent connection (`is_shared` is true) is kept for the lifetime of the loader, and method bodies are loaded
+   through it by whichever worker calls a method first, so it's opened in SQLite's serialized mode (in addition to
+   `body_mutex`, which protects the cached statements). The temporary connections of hmMetadataLoaderEnumMethodsInRange(..)
+   belong to a single call on a single thread, so SQLite's own locking is disabled for them. */
+static hmError hmImageFileMetadataLoaderOpenDatabase(
+    hmImageFileMetadataLoaderData* data,
+    hm_bool                        is_shared,
+    sqlite3**                      out_db
+)
+{
+    sqlite3* db = HM_NULL;
+    int sqlite_err = sqlite3_open_v2(
+        hmStringGetCString(&data->image_path),
+        &db,
+        SQLITE_OPEN_READONLY | (is_shared ? SQLITE_OPEN_FULLMUTEX : SQLITE_OPEN_NOMUTEX),
+        HM_NULL
+    );
+    if (sqlite_err != SQLITE_OK) {
+        sqlite3_close(db); /* A handle is allocated even if opening fails. */
+        return HM_ERROR_NOT_FOUND;
+    }
+    sqlite_err = sqlite3_exec(
+        db,
+        "PRAGMA mmap_size = " HM_IMAGE_FILE_MMAP_SIZE ";"
+        "PRAGMA cache_size = " HM_IMAGE_FILE_CACHE_SIZE ";",
+        HM_NULL,
+        HM_NULL,
+        HM_NULL
+    );
+    if (sqlite_err != SQLITE_OK) {
+        sqlite3_close(db);
+        return HM_ERROR_PLATFORM_DEPENDENT;
+    }
+    *out_db = db;
+    return HM_OK;
+}
+
+static hmError hmImageFileMetadataLoaderCloseDatabase(sqlite3* db)
+{
+    return sqlite3_close(db) == SQLITE_OK ? HM_OK : HM_ERROR_PLATFORM_DEPENDENT;
+}
+
+/* The returned statement must be reset with sqlite3_reset(..) after use. */
+static hmError hmImageFileMetadataLoaderGetStatement(hmImageFileMetadataLoaderData* data, hmImageFileQuery query, sqlite3_stmt** out_stmt)
+{
+    if (!data->db_opt) {
+        HM_TRY(hmImageFileMetadataLoaderOpenDatabase(data, HM_TRUE, &data->db_opt));
+    }
+    if (!data->stmts[query]) {
+        /* SQLITE_PREPARE_PERSISTENT: the statements live as long as the loader, so SQLite shouldn't use lookaside memory. */
+        int sqlite_err = sqlite3_prepare_v3(
+            data->db_opt,
+            hmImageFileQueries[query],
+            -1,
+            SQLITE_PREPARE_PERSISTENT,
+            &data->stmts[query],
+            HM_NULL
+        );
+        if (sqlite_err != SQLITE_OK) {
+            return HM_ERROR_INVALID_DATA;
+        }
+    }
+    *out_stmt = data->stmts[query];
+    return HM_OK;
+}
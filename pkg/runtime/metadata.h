@@ -35,25 +35,44 @@ typedef struct {
     hm_method_size  size;
 } hmMethodBodyMetadata;
 
+/* Method bodies are not part of method metadata: most methods in a large image are never called, so bodies are
+   loaded separately, on demand, see hmMetadataLoaderLoadMethodBody(..) */
 typedef struct {
-    hmString             name;
-    hmString             signature; /* Signature is encoded similar to Java -- as a string. */
-    hmMethodBodyMetadata body;
-    hm_metadata_id       method_id;
-    hm_metadata_id       class_id;
-    hm_metadata_id       module_id;
+    hmString       name;
+    hmString       signature; /* Signature is encoded similar to Java -- as a string. */
+    hm_metadata_id method_id;
+    hm_metadata_id class_id;
+    hm_metadata_id module_id;
 } hmMethodMetadata;
 
 typedef hmError (*hmEnumModuleMetadataFunc)(hmModuleMetadata* metadata, void* user_data);
 typedef hmError (*hmEnumClassMetadataFunc)(hmClassMetadata* metadata, void* user_data);
 typedef hmError (*hmEnumMethodMetadataFunc)(hmMethodMetadata* metadata, void* user_data);
+typedef hmError (*hmLoadMethodBodyFunc)(hmMethodBodyMetadata* body, void* user_data);
 
+/* Metadata loaders are not thread-safe, except for hmMetadataLoaderEnumMethodsInRange(..) and
+   hmMetadataLoaderLoadMethodBody(..), see below. */
 typedef struct hmMetadataLoader_ {
     hmError (*enumMetadata)(struct hmMetadataLoader_* loader,
                             hmEnumModuleMetadataFunc  enum_modules_func_opt,
                             hmEnumClassMetadataFunc   enum_classes_func_opt,
                             hmEnumMethodMetadataFunc  enum_methods_func_opt,
                             void*                           user_data);
+    hmError (*enumJoinedMetadata)(struct hmMetadataLoader_* loader,
+                                  hmEnumModuleMetadataFunc  enum_modules_func,
+                                  hmEnumClassMetadataFunc   enum_classes_func,
+                                  hmEnumMethodMetadataFunc  enum_methods_func,
+                                  void*                     user_data);
+    hmError (*enumMethodsInRange)(struct hmMetadataLoader_* loader,
+                                  hm_metadata_id            min_method_id,
+                                  hm_metadata_id            max_method_id,
+                                  hmEnumMethodMetadataFunc  enum_methods_func,
+                                  void*                     user_data);
+    hmError (*getMethodIDRange)(struct hmMetadataLoader_* loader, hm_metadata_id* out_min_id, hm_metadata_id* out_max_id);
+    hmError (*loadMethodBody)(struct hmMetadataLoader_* loader,
+                              hm_metadata_id            method_id,
+                              hmLoadMethodBodyFunc      load_body_func,
+                              void*                     user_data);
     hmError (*dispose)(struct hmMetadataLoader_* loader);
     void* data; /* Loader-specific data. */
 } hmMetadataLoader;
@@ -62,8 +81,10 @@ typedef struct hmMetadataLoader_ {
    We have very strict naming rules to make sure metadata names don't conflict with anything (signatures, emitted C code, etc.)
    Only 'a-Z', 'A-Z', digits, and '_' are allowed; additionally, a name can't start with a digit.
    Made public for tests (at least). */
-hm_bool hmValidateMetadataName(hmString* name);
-/* Creates a metadata loader which can load metadata from an image file specified by `image_path`. */
+hmError hmValidateMetadataName(hmString* name);
+/* Creates a metadata loader which can load metadata from an image file specified by `image_path`.
+   The image is opened on first use and kept open (read-only, memory-mapped where possible) until the loader is disposed of,
+   together with the statements it has prepared, so repeated enumerations and lookups don't reparse the schema or the SQL. */
 hmError hmCreateImageFileMetadataLoader(hmAllocator* allocator, hmString* image_path, hmMetadataLoader* in_metadata_loader);
 hmError hmMetadataLoaderDispose(hmMetadataLoader* metadata_loader);
 /* Enumerates metadata and calls provided callbacks in the order of the arguments.
@@ -77,5 +98,45 @@ hmError hmMetadataLoaderEnumMetadata(
     hmEnumMethodMetadataFunc enum_methods_func_opt,
     void* user_data
 );
+/* Enumerates the same metadata as hmMetadataLoaderEnumMetadata(..), but in a single ordered pass: every module is
+   immediately followed by its classes, and every class by its methods (in the order of their IDs). The consumer can
+   therefore keep track of the current module and class instead of looking them up (or building temporary maps) for every
+   class and method. All callbacks are required. Returns HM_ERROR_INVALID_DATA if a class or a method refers to a module
+   or a class which doesn't exist (objects are never skipped silently). */
+hmError hmMetadataLoaderEnumJoinedMetadata(
+    hmMetadataLoader*        metadata_loader,
+    hmEnumModuleMetadataFunc enum_modules_func,
+    hmEnumClassMetadataFunc  enum_classes_func,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+);
+/* Same as enumerating methods with hmMetadataLoaderEnumMetadata(..), except only methods with IDs in the range from
+   `min_method_id` to `max_method_id` (inclusive) are enumerated. Designed for loading methods in parallel: unlike other
+   functions of a loader, it's thread-safe and can be called concurrently with itself and hmMetadataLoaderEnumMetadata(..)
+   The order of enumeration is not guaranteed. */
+hmError hmMetadataLoaderEnumMethodsInRange(
+    hmMetadataLoader*        metadata_loader,
+    hm_metadata_id           min_method_id,
+    hm_metadata_id           max_method_id,
+    hmEnumMethodMetadataFunc enum_methods_func,
+    void*                    user_data
+);
+/* Returns the smallest and the largest method IDs, to be able to partition methods by ID ranges for parallel loading
+   (see hmMetadataLoaderEnumMethodsInRange(..)). Returns HM_ERROR_NOT_FOUND if there are no methods. */
+hmError hmMetadataLoaderGetMethodIDRange(hmMetadataLoader* metadata_loader, hm_metadata_id* out_min_id, hm_metadata_id* out_max_id);
+/* Looks up the body of the method specified by `method_id` and passes it to `load_body_func`. The opcodes are only
+   valid for the duration of the callback, so the callback must copy them if it needs them afterwards.
+   Returns HM_ERROR_NOT_FOUND if there's no such method. Designed to be called once per method, on first use: loaders
+   keep whatever is needed for quick lookups (an open database with a prepared statement, a mapping, etc.) between
+   calls. Method bodies are loaded lazily by whichever worker calls a method first, so this function is thread-safe and
+   can be called concurrently with itself (the image file loader serializes access to its open database, mapped images
+   are read-only); it must not be called concurrently with the other functions of the loader, which are not
+   thread-safe. */
+hmError hmMetadataLoaderLoadMethodBody(
+    hmMetadataLoader*    metadata_loader,
+    hm_metadata_id       method_id,
+    hmLoadMethodBodyFunc load_body_func,
+    void*                user_data
+);
 
 #endif /* HM_METADATA_H */
@@ -12,3 +12,104 @@
 * ******************************************************************************/
 
 #include <runtime/method.h>
+#include <runtime/lowering.h>
+#include <core/math.h>
+#include <core/utils.h>
+
+static hmError hmMethod_loadBodyFunc(hmMethodBodyMetadata* body, void* user_data);
+
+hmError hmCreateMethod(
+    hmAllocator*       allocator,
+    hmAllocator*       body_allocator,
+    hmMetadataLoader*  metadata_loader,
+    hmMethodMetadata*  metadata,
+    hmMethod*          in_method
+)
+{
+    HM_TRY(hmValidateMetadataName(&metadata->name));
+    HM_TRY(hmStringDuplicate(allocator, &metadata->name, &in_method->name));
+    hmError err = hmStringDuplicate(allocator, &metadata->signature, &in_method->signature);
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmStringDispose(&in_method->name));
+    }
+    in_method->allocator = allocator;
+    in_method->body_allocator = body_allocator;
+    in_method->parsed_signature_opt = HM_NULL;
+    hmAtomicStore(&in_method->hl_body_opt, HM_NULL);
+    in_method->metadata_loader = metadata_loader;
+    hmAtomicStore(&in_method->ll_body_opt, HM_NULL);
+    hmAtomicStore(&in_method->jit_code_opt, HM_NULL);
+    hmAtomicStore(&in_method->invocation_count, 0);
+    in_method->method_id = metadata->method_id;
+    return HM_OK;
+}
+
+hmError hmMethodDispose(hmMethod* method)
+{
+    hmError err = hmStringDispose(&method->name);
+    err = hmMergeErrors(err, hmStringDispose(&method->signature));
+    hmMethodBody* hl_body = hmAtomicLoad(&method->hl_body_opt);
+    if (hl_body) {
+        hmFree(method->body_allocator, hl_body);
+    }
+    hmLLMethodBody* ll_body = hmAtomicLoad(&method->ll_body_opt);
+    if (ll_body) {
+        err = hmMergeErrors(err, hmLLMethodBodyDispose(ll_body));
+        hmFree(method->body_allocator, ll_body);
+    }
+    return err;
+}
+
+hmError hmMethodDisposeFunc(void* object)
+{
+    return hmMethodDispose((hmMethod*)object);
+}
+
+hmError hmMethodGetHLBody(hmMethod* method, hmMethodBody** out_body)
+{
+    hmMethodBody* hl_body = hmAtomicLoadAcquire(&method->hl_body_opt);
+    if (!hl_body) {
+        HM_TRY(hmMetadataLoaderLoadMethodBody(method->metadata_loader, method->method_id, &hmMethod_loadBodyFunc, method));
+        hl_body = hmAtomicLoadAcquire(&method->hl_body_opt);
+    }
+    *out_body = hl_body;
+    return HM_OK;
+}
+
+hmError hmMethodSetLLBody(hmMethod* method, hmLLMethodBody* ll_body)
+{
+    if (hmMethodIsCompiled(method)) {
+        return HM_ERROR_INVALID_STATE;
+    }
+    hmLLMethodBody* ll_body_copy = (hmLLMethodBody*)hmAlloc(method->body_allocator, sizeof(hmLLMethodBody));
+    if (!ll_body_copy) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    *ll_body_copy = *ll_body;
+    hmLLMethodBody* expected = HM_NULL;
+    if (!hmAtomicCompareExchange(&method->ll_body_opt, &expected, ll_body_copy)) {
+        hmFree(method->body_allocator, ll_body_copy); /* another thread compiled the method first */
+        return HM_ERROR_INVALID_STATE;
+    }
+    return HM_OK;
+}
+
+static hmError hmMethod_loadBodyFunc(hmMethodBodyMetadata* body, void* user_data)
+{
+    hmMethod* method = (hmMethod*)user_data;
+    /* The opcodes are stored right after the header, so that the body can be published with a single pointer. */
+    hm_nint hl_body_size;
+    HM_TRY(hmAddNint(sizeof(hmMethodBody), body->size, &hl_body_size));
+    hmMethodBody* hl_body = (hmMethodBody*)hmAlloc(method->body_allocator, hl_body_size);
+    if (!hl_body) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hl_body->opcodes = (hm_uint8*)(hl_body + 1);
+    hl_body->size = body->size;
+    hmCopyMemory(hl_body->opcodes, body->opcodes, body->size);
+    hmMethodBody* expected = HM_NULL;
+    if (!hmAtomicCompareExchange(&method->hl_body_opt, &expected, hl_body)) {
+        hmFree(method->body_allocator, hl_body); /* another thread loaded the body first */
+    }
+    return HM_OK;
+}
@@ -15,23 +15,73 @@
 #define HM_METHOD_H
 
 #include <core/common.h>
+#include <core/allocator.h>
 #include <core/string.h>
 #include <runtime/common.h>
+#include <runtime/metadata.h>
 #include <runtime/signature.h>
+#include <threading/atomic.h>
 
 typedef struct {
     hm_uint8*      opcodes;
     hm_method_size size;
 } hmMethodBody;
 
+typedef struct hmLLMethodBody_ hmLLMethodBody; /* See runtime/lowering.h */
+
+/* Bodies and machine code are created lazily, on whichever thread calls the method first, so they're published with
+   atomic pointers: a thread sees either nothing or a complete object (see hmMethodGetHLBody(..), hmMethodSetLLBody(..)) */
 typedef struct {
-    hmString       name;      /* The name of the method which should be unique in a given class. */
-    hmSignature    signature; /* Describes the parameters and the return type. */
-    hmMethodBody   hl_body;   /* High-level bytecode as stored in metadata. */
-    hm_metadata_id method_id;
+    hmAllocator*               allocator;            /* Owns the method's declaration (name, signature). */
+    hmAllocator*               body_allocator;       /* Owns the bodies, which are loaded/compiled lazily
+                                                        (see hmCreateMethod(..)) */
+    hmString                   name;                 /* The name of the method which should be unique in a given class. */
+    hmString                   signature;            /* Describes the parameters and the return type, encoded as in
+                                                        metadata. */
+    hmSignature*               parsed_signature_opt; /* The same signature, parsed and interned by the module registry
+                                                        which loaded the method (see hmSignatureTable); HM_NULL otherwise. */
+    HM_ATOMIC(hmMethodBody*)   hl_body_opt;          /* High-level bytecode as stored in metadata. Loaded lazily, on first
+                                                        use: HM_NULL until then (see hmMethodGetHLBody(..)) */
+    hmMetadataLoader*          metadata_loader;      /* The loader the method was loaded with; used to load the body on
+                                                        demand. */
+    HM_ATOMIC(hmLLMethodBody*) ll_body_opt;          /* Low-level bytecode (see runtime/lowering.h); HM_NULL until the
+                                                        method is compiled. */
+    HM_ATOMIC(void*)           jit_code_opt;         /* Machine code (see runtime/jit.h); HM_NULL until the method becomes
+                                                        hot, unless it's bound to ahead-of-time compiled code (see
+                                                        runtime/aot.h). */
+    HM_ATOMIC(hm_uint32)       invocation_count;     /* How many times the method was interpreted (see hmJitGetCode(..)) */
+    hm_metadata_id             method_id;
 } hmMethod;
 
+/* Creates a method from the given metadata. Only the declaration is recorded (allocated with `allocator`): the body is
+   loaded from `metadata_loader` on first use, so the loader must outlive the method. Bodies, high-level and low-level,
+   are allocated with `body_allocator`: methods are usually first called (and compiled) on a worker, so it must be
+   thread-safe if the method can be called from more than one worker, while `allocator` is only used on creation and
+   disposal, and can be, for example, a bump pointer allocator used for all the metadata of a module. */
+hmError hmCreateMethod(
+    hmAllocator*       allocator,
+    hmAllocator*       body_allocator,
+    hmMetadataLoader*  metadata_loader,
+    hmMethodMetadata*  metadata,
+    hmMethod*          in_method
+);
+hmError hmMethodDispose(hmMethod* method);
+hmError hmMethodDisposeFunc(void* object);
+/* Returns the high-level body of the method, loading it from the metadata loader if it's the first call.
+   Thread-safe: the body is published atomically, so other threads see either no body or the complete one. If several
+   threads load the body at the same time, one copy is kept and the rest are freed, so they all return the same body. */
+hmError hmMethodGetHLBody(hmMethod* method, hmMethodBody** out_body);
+/* Sets the low-level body of the method (usually produced with hmCompileMethodBody(..)), which is what's executed
+   when the method is called. On success, the method takes ownership of the body. Returns HM_ERROR_INVALID_STATE if
+   the method is already compiled, in which case the body is still owned by the caller. Thread-safe: the body is
+   published atomically, so other threads see either no body or the complete one; if several threads compile the
+   method at the same time, only one of them succeeds, and the rest get HM_ERROR_INVALID_STATE. */
+hmError hmMethodSetLLBody(hmMethod* method, hmLLMethodBody* ll_body);
 #define hmMethodGetName(method) (method)->name
 #define hmMethodGetID(method) (method)->method_id
+#define hmMethodIsHLBodyLoaded(method) (hmAtomicLoadAcquire(&(method)->hl_body_opt) != HM_NULL)
+#define hmMethodIsCompiled(method) (hmMethodGetLLBody(method) != HM_NULL)
+/* Returns the low-level body of the method, or HM_NULL if it isn't compiled yet (see hmMethodSetLLBody(..)) */
+#define hmMethodGetLLBody(method) hmAtomicLoadAcquire(&(method)->ll_body_opt)
 
 #endif /* HM_METHOD_H */
@@ -12,8 +12,9 @@
 * ******************************************************************************/
 
 #include <runtime/module.h>
-#include <runtime/class.h>
-#include <runtime/metadata.h>
+#include <core/utils.h>
+
+static hmError hmModule_disposeClassFunc(void* object);
 
 hmError hmCreateModule(hmAllocator* allocator, hm_metadata_id module_id, hmString* name, hmModule* in_module)
 {
@@ -23,8 +24,8 @@ hmError hmCreateModule(hmAllocator* allocator, hm_metadata_id module_id, hmStrin
         allocator,
         &hmMetadataIDHashFunc,
         &hmMetadataIDEqualsFunc,
-        HM_NULL,            /* key_dispose_func */
-        HM_NULL,            /* value_dispose_func */
+        HM_NULL,                    /* key_dispose_func */
+        &hmModule_disposeClassFunc, /* value_dispose_func */
         sizeof(hm_metadata_id),
         sizeof(hmClass*),
         HM_HASHMAP_DEFAULT_CAPACITY,
@@ -33,8 +34,9 @@ hmError hmCreateModule(hmAllocator* allocator, hm_metadata_id module_id, hmStrin
         &in_module->classes
     );
     if (err != HM_OK) {
-        err = hmMergeErrors(err, hmStringDispose(&in_module->name));
+        return hmMergeErrors(err, hmStringDispose(&in_module->name));
     }
+    in_module->allocator = allocator;
     in_module->module_id = module_id;
     return HM_OK;
 }
@@ -49,3 +51,44 @@ hmError hmModuleDisposeFunc(void* object)
 {
     return hmModuleDispose((hmModule*)object);
 }
+
+hmError hmModuleAddClass(hmModule* module, hmClassMetadata* metadata, hmClass** out_class_opt)
+{
+    if (hmHashMapContains(&module->classes, &metadata->class_id)) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hmClass* hm_class = (hmClass*)hmAlloc(module->allocator, sizeof(hmClass));
+    if (!hm_class) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmCreateClass(module->allocator, metadata->class_id, &metadata->name, hm_class);
+    if (err != HM_OK) {
+        hmFree(module->allocator, hm_class);
+        return err;
+    }
+    err = hmHashMapPut(&module->classes, &metadata->class_id, &hm_class);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmClassDispose(hm_class));
+        hmFree(module->allocator, hm_class);
+        return err;
+    }
+    if (out_class_opt) {
+        *out_class_opt = hm_class;
+    }
+    return HM_OK;
+}
+
+hmError hmModuleGetClass(hmModule* module, hm_metadata_id class_id, hmClass** out_class)
+{
+    return hmHashMapGet(&module->classes, &class_id, out_class);
+}
+
+static hmError hmModule_disposeClassFunc(void* object)
+{
+    hmClass* hm_class;
+    hmCopyMemory(&hm_class, object, sizeof(hmClass*)); /* Hashmap values aren't necessarily aligned. */
+    hmAllocator* allocator = hm_class->allocator;
+    hmError err = hmClassDispose(hm_class);
+    hmFree(allocator, hm_class);
+    return err;
+}
@@ -15,11 +15,15 @@
 #define HM_MODULE_H
 
 #include <core/common.h>
+#include <core/allocator.h>
 #include <core/string.h>
 #include <collections/hashmap.h>
 #include <runtime/common.h>
+#include <runtime/class.h>
+#include <runtime/metadata.h>
 
 typedef struct {
+    hmAllocator*   allocator;
     hmString       name;    /* The name of the module. Should be unique in a given module registry. */
     hmHashMap      classes; /* hmHashMap<hm_metadata_id, hmClass*> */
     hm_metadata_id module_id;
@@ -28,6 +32,12 @@ typedef struct {
 hmError hmCreateModule(hmAllocator* allocator, hm_metadata_id module_id, hmString* name, hmModule* in_module);
 hmError hmModuleDispose(hmModule* module);
 hmError hmModuleDisposeFunc(void* object);
+/* Adds a class described by `metadata` to the module. Returns HM_ERROR_INVALID_DATA if the module already has a class
+   with the same ID. The new class is returned in `out_class_opt` (if not HM_NULL), so that callers which add methods
+   right away don't have to look it up. */
+hmError hmModuleAddClass(hmModule* module, hmClassMetadata* metadata, hmClass** out_class_opt);
+/* Returns HM_ERROR_NOT_FOUND if there's no such class. The returned reference is valid as long as the module is. */
+hmError hmModuleGetClass(hmModule* module, hm_metadata_id class_id, hmClass** out_class);
 #define hmModuleGetName(module) &(module)->name
 #define hmModuleGetID(module) (module)->module_id
 
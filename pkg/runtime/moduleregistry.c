@@ -12,11 +12,69 @@
 * ******************************************************************************/
 
 #include <runtime/moduleregistry.h>
-#include <runtime/module.h>
+#include <core/math.h>
+#include <core/utils.h>
+#include <threading/mutex.h>
+#include <threading/thread.h>
+#include <threading/workerpool.h>
+
+/* Loading a large image shouldn't take that long, so it's about something being wrong with worker threads. */
+#define HM_MODULE_REGISTRY_LOAD_TIMEOUT_MS HM_THREAD_JOIN_MAX_TIMEOUT_MS
+
+typedef struct {
+    hmModuleRegistry* registry;
+    hmMetadataLoader* metadata_loader;
+    hmAllocator*      arena_opt;          /* Methods are allocated here; created with the first method. */
+    hmModule*         current_module_opt; /* The last loaded module/class: joined metadata is added to them without lookups. */
+    hmClass*          current_class_opt;
+} hmModuleRegistryLoadContext;
+
+typedef struct {
+    hmMethod*      method;
+    hm_metadata_id class_id;
+    hm_metadata_id module_id;
+} hmModuleRegistryLoadedMethod;
+
+/* A range of method IDs loaded by one worker. */
+typedef struct {
+    hmMetadataLoader* metadata_loader;
+    hmAllocator*      arena;          /* Methods of the partition are allocated here. Owned by the registry. */
+    hmAllocator*      body_allocator; /* The allocator of the registry: owns method bodies (see hmCreateMethod(..)) */
+    hmArray           loaded_methods; /* hmArray<hmModuleRegistryLoadedMethod> */
+    hm_nint           merged_count;   /* How many of `loaded_methods` were added to their classes. */
+    hm_metadata_id    min_method_id;
+    hm_metadata_id    max_method_id;
+    hmMutex*          completion_mutex; /* Publishes the results of the worker to the thread which merges them. */
+    hmError           err;            /* A worker stops processing items if its function fails, so errors are reported here. */
+} hmModuleRegistryPartition;
 
 static hmError hmModuleRegistry_enumModulesFunc(hmModuleMetadata* metadata, void* user_data);
 static hmError hmModuleRegistry_enumClassesFunc(hmClassMetadata* metadata, void* user_data);
-static hmError hmModuleRegistry_enumMethodsFunc(hmMethodMetadata* metadata, void* user_data);
+static hmError hmModuleRegistry_enumJoinedClassesFunc(hmClassMetadata* metadata, void* user_data);
+static hmError hmModuleRegistry_enumJoinedMethodsFunc(hmMethodMetadata* metadata, void* user_data);
+static hmError hmModuleRegistry_disposeModuleFunc(void* object);
+static hmError hmModuleRegistry_loadPartitionFunc(void* work_item, hmScheduler* scheduler_opt);
+static hmError hmModuleRegistry_enumPartitionMethodsFunc(hmMethodMetadata* metadata, void* user_data);
+static hmError hmModuleRegistryGetClass(hmModuleRegistry* registry, hm_metadata_id module_id, hm_metadata_id class_id, hmClass** out_class);
+static hmError hmModuleRegistryReserveMethodTable(hmModuleRegistry* registry, hm_metadata_id min_method_id, hm_metadata_id max_method_id);
+static hmError hmModuleRegistryAddMethod(hmModuleRegistry* registry, hmClass* hm_class, hmMethod* method);
+static hmError hmModuleRegistryCreateArena(hmModuleRegistry* registry, hmAllocator** out_arena);
+static hmError hmModuleRegistryLoadPartitions(
+    hmModuleRegistry*          registry,
+    hmMetadataLoader*          metadata_loader,
+    hmModuleRegistryPartition* partitions,
+    hm_nint                    partition_count
+);
+static hmError hmModuleRegistryMergePartition(hmModuleRegistry* registry, hmModuleRegistryPartition* partition);
+static hmError hmCreateModuleRegistryPartition(
+    hmModuleRegistry*          registry,
+    hmMetadataLoader*          metadata_loader,
+    hm_metadata_id             min_method_id,
+    hm_metadata_id             max_method_id,
+    hmModuleRegistryPartition* in_partition
+);
+static hmError hmModuleRegistryPartitionDispose(hmModuleRegistryPartition* partition);
+static hmError hmDisposeMethod(hmMethod* method);
 
 hmError hmCreateModuleRegistry(hmAllocator* allocator, hmModuleRegistry* in_registry)
 {
@@ -24,8 +82,8 @@ hmError hmCreateModuleRegistry(hmAllocator* allocator, hmModuleRegistry* in_regi
         allocator,
         &hmMetadataIDHashFunc,
         &hmMetadataIDEqualsFunc,
-        HM_NULL,            /* key_dispose_func */
-        HM_NULL,            /* value_dispose_func */
+        HM_NULL,                             /* key_dispose_func */
+        &hmModuleRegistry_disposeModuleFunc, /* value_dispose_func */
         sizeof(hm_metadata_id),
         sizeof(hmModule*),
         HM_HASHMAP_DEFAULT_CAPACITY,
@@ -33,38 +91,509 @@ hmError hmCreateModuleRegistry(hmAllocator* allocator, hmModuleRegistry* in_regi
         0,
         &in_registry->modules
     ));
+    hmError err = hmCreateArray(allocator, sizeof(hmAllocator*), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &in_registry->arenas);
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmHashMapDispose(&in_registry->modules));
+    }
+    err = hmCreateArray(allocator, sizeof(hmMethod*), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &in_registry->method_table);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmArrayDispose(&in_registry->arenas));
+        return hmMergeErrors(err, hmHashMapDispose(&in_registry->modules));
+    }
+    err = hmCreateArray(allocator, sizeof(hmSignature*), HM_ARRAY_DEFAULT_CAPACITY, HM_NULL, &in_registry->signature_table);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmArrayDispose(&in_registry->method_table));
+        err = hmMergeErrors(err, hmArrayDispose(&in_registry->arenas));
+        return hmMergeErrors(err, hmHashMapDispose(&in_registry->modules));
+    }
+    err = hmCreateSignatureTable(allocator, &in_registry->signatures);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmArrayDispose(&in_registry->signature_table));
+        err = hmMergeErrors(err, hmArrayDispose(&in_registry->method_table));
+        err = hmMergeErrors(err, hmArrayDispose(&in_registry->arenas));
+        return hmMergeErrors(err, hmHashMapDispose(&in_registry->modules));
+    }
     in_registry->allocator = allocator;
+    in_registry->min_method_id = 0;
     return HM_OK;
 }
 
 hmError hmModuleRegistryDispose(hmModuleRegistry* registry)
 {
-    return hmHashMapDispose(&registry->modules);
+    hmError err = hmHashMapDispose(&registry->modules); /* Before the arenas, as methods may be allocated there. */
+    err = hmMergeErrors(err, hmArrayDispose(&registry->method_table));
+    err = hmMergeErrors(err, hmArrayDispose(&registry->signature_table));
+    err = hmMergeErrors(err, hmSignatureTableDispose(&registry->signatures)); /* After the methods which refer to it. */
+    hmAllocator** arenas = hmArrayGetRaw(&registry->arenas, hmAllocator*);
+    for (hm_nint i = 0; i < hmArrayGetCount(&registry->arenas); i++) {
+        err = hmMergeErrors(err, hmAllocatorDispose(arenas[i]));
+        hmFree(registry->allocator, arenas[i]);
+    }
+    return hmMergeErrors(err, hmArrayDispose(&registry->arenas));
 }
 
+/* A single pass over joined metadata, with no lookups of parent modules and classes. */
 hmError hmModuleRegistryLoad(hmModuleRegistry* registry, hmMetadataLoader* metadata_loader)
 {
-    HM_TRY(hmMetadataLoaderEnumMetadata(
+    hm_metadata_id min_method_id = 0, max_method_id = 0;
+    hmError err = hmMetadataLoaderGetMethodIDRange(metadata_loader, &min_method_id, &max_method_id);
+    if (err == HM_OK) {
+        err = hmModuleRegistryReserveMethodTable(registry, min_method_id, max_method_id);
+    }
+    if (err != HM_OK && err != HM_ERROR_NOT_FOUND) { /* HM_ERROR_NOT_FOUND: there are no methods. */
+        return err;
+    }
+    hmModuleRegistryLoadContext context;
+    context.registry = registry;
+    context.metadata_loader = metadata_loader;
+    context.arena_opt = HM_NULL;
+    context.current_module_opt = HM_NULL;
+    context.current_class_opt = HM_NULL;
+    return hmMetadataLoaderEnumJoinedMetadata(
         metadata_loader,
         &hmModuleRegistry_enumModulesFunc,
-        &hmModuleRegistry_enumClassesFunc,
-        &hmModuleRegistry_enumMethodsFunc,
-        registry
-    ));
+        &hmModuleRegistry_enumJoinedClassesFunc,
+        &hmModuleRegistry_enumJoinedMethodsFunc,
+        &context
+    );
+}
+
+hmError hmModuleRegistryLoadInParallel(hmModuleRegistry* registry, hmMetadataLoader* metadata_loader, hm_nint worker_count)
+{
+    if (!worker_count) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hm_metadata_id min_method_id = 0, max_method_id = 0;
+    hmError err = hmMetadataLoaderGetMethodIDRange(metadata_loader, &min_method_id, &max_method_id);
+    if (err == HM_ERROR_NOT_FOUND) {
+        return hmModuleRegistryLoad(registry, metadata_loader); /* There are no methods, nothing to parallelize. */
+    }
+    HM_TRY(err);
+    HM_TRY(hmModuleRegistryReserveMethodTable(registry, min_method_id, max_method_id));
+    /* 64-bit math: the whole range of 32-bit IDs is 2^32 IDs. */
+    hm_uint64 id_count = (hm_uint64)max_method_id - min_method_id + 1;
+    hm_nint partition_count = id_count < worker_count ? (hm_nint)id_count : worker_count;
+    hm_uint64 partition_size = (id_count + partition_count - 1) / partition_count;
+    hm_nint partitions_size = 0;
+    HM_TRY(hmMulNint(partition_count, sizeof(hmModuleRegistryPartition), &partitions_size));
+    hmModuleRegistryPartition* partitions = (hmModuleRegistryPartition*)hmAlloc(registry->allocator, partitions_size);
+    if (!partitions) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hm_nint created_count = 0;
+    for (; created_count < partition_count; created_count++) {
+        hm_uint64 partition_min_id = min_method_id + created_count * partition_size;
+        hm_uint64 partition_max_id = partition_min_id + partition_size - 1;
+        HM_TRY_OR_FINALIZE(err, hmCreateModuleRegistryPartition(
+            registry,
+            metadata_loader,
+            (hm_metadata_id)partition_min_id,
+            (hm_metadata_id)(partition_max_id < max_method_id ? partition_max_id : max_method_id),
+            &partitions[created_count]
+        ));
+    }
+    HM_TRY_OR_FINALIZE(err, hmModuleRegistryLoadPartitions(registry, metadata_loader, partitions, partition_count));
+    for (hm_nint i = 0; i < partition_count; i++) {
+        HM_TRY_OR_FINALIZE(err, hmModuleRegistryMergePartition(registry, &partitions[i]));
+    }
+HM_ON_FINALIZE
+    for (hm_nint i = 0; i < created_count; i++) {
+        err = hmMergeErrors(err, hmModuleRegistryPartitionDispose(&partitions[i]));
+    }
+    hmFree(registry->allocator, partitions);
+    return err;
+}
+
+hmError hmModuleRegistryGetModule(hmModuleRegistry* registry, hm_metadata_id module_id, hmModule** out_module)
+{
+    return hmHashMapGet(&registry->modules, &module_id, out_module);
+}
+
+hmError hmModuleRegistryGetMethod(hmModuleRegistry* registry, hm_metadata_id method_id, hmMethod** out_method)
+{
+    if (method_id < registry->min_method_id || method_id - registry->min_method_id >= hmArrayGetCount(&registry->method_table)) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    hmMethod** method_table = hmArrayGetRaw(&registry->method_table, hmMethod*);
+    hmMethod* method = method_table[method_id - registry->min_method_id];
+    if (!method) {
+        return HM_ERROR_NOT_FOUND;
+    }
+    *out_method = method;
+    return HM_OK;
+}
+
+hmError hmModuleRegistryEnumMethods(hmModuleRegistry* registry, hmModuleRegistryEnumMethodsFunc enum_methods_func, void* user_data)
+{
+    hmMethod** method_table = hmArrayGetRaw(&registry->method_table, hmMethod*);
+    for (hm_nint i = 0; i < hmArrayGetCount(&registry->method_table); i++) {
+        if (method_table[i]) {
+            HM_TRY(enum_methods_func(method_table[i], user_data));
+        }
+    }
+    return HM_OK;
+}
+
+hmError hmModuleRegistryResolveCallTargetFunc(
+    hm_metadata_id method_id,
+    void*          user_data,
+    hmMethod**     out_method,
+    hmSignature**  out_signature
+)
+{
+    hmModuleRegistry* registry = (hmModuleRegistry*)user_data;
+    HM_TRY(hmModuleRegistryGetMethod(registry, method_id, out_method));
+    /* Read from the parallel table rather than from the method itself, see hmModuleRegistry::signature_table */
+    hmSignature** signature_table = hmArrayGetRaw(&registry->signature_table, hmSignature*);
+    *out_signature = signature_table[method_id - registry->min_method_id];
     return HM_OK;
 }
 
 static hmError hmModuleRegistry_enumModulesFunc(hmModuleMetadata* metadata, void* user_data)
 {
+    hmModuleRegistryLoadContext* context = (hmModuleRegistryLoadContext*)user_data;
+    hmModuleRegistry* registry = context->registry;
+    if (hmHashMapContains(&registry->modules, &metadata->module_id)) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hmModule* module = (hmModule*)hmAlloc(registry->allocator, sizeof(hmModule));
+    if (!module) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmCreateModule(registry->allocator, metadata->module_id, &metadata->name, module);
+    if (err != HM_OK) {
+        hmFree(registry->allocator, module);
+        return err;
+    }
+    err = hmHashMapPut(&registry->modules, &metadata->module_id, &module);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmModuleDispose(module));
+        hmFree(registry->allocator, module);
+        return err;
+    }
+    context->current_module_opt = module;
+    context->current_class_opt = HM_NULL;
     return HM_OK;
 }
 
 static hmError hmModuleRegistry_enumClassesFunc(hmClassMetadata* metadata, void* user_data)
 {
+    hmModuleRegistry* registry = ((hmModuleRegistryLoadContext*)user_data)->registry;
+    hmModule* module = HM_NULL;
+    hmError err = hmModuleRegistryGetModule(registry, metadata->module_id, &module);
+    if (err != HM_OK) {
+        return err == HM_ERROR_NOT_FOUND ? HM_ERROR_INVALID_DATA : err;
+    }
+    return hmModuleAddClass(module, metadata, HM_NULL);
+}
+
+/* Classes immediately follow their modules in joined metadata. A mismatch can only come from a broken loader. */
+static hmError hmModuleRegistry_enumJoinedClassesFunc(hmClassMetadata* metadata, void* user_data)
+{
+    hmModuleRegistryLoadContext* context = (hmModuleRegistryLoadContext*)user_data;
+    hmModule* module = context->current_module_opt;
+    if (!module || hmModuleGetID(module) != metadata->module_id) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    return hmModuleAddClass(module, metadata, &context->current_class_opt);
+}
+
+/* Only the declaration is recorded here, the body is loaded on first use. Methods immediately follow their classes in joined
+   metadata, see hmModuleRegistry_enumJoinedClassesFunc(..) */
+static hmError hmModuleRegistry_enumJoinedMethodsFunc(hmMethodMetadata* metadata, void* user_data)
+{
+    hmModuleRegistryLoadContext* context = (hmModuleRegistryLoadContext*)user_data;
+    hmModuleRegistry* registry = context->registry;
+    hmClass* hm_class = context->current_class_opt;
+    if (!hm_class || hmClassGetID(hm_class) != metadata->class_id || hmModuleGetID(context->current_module_opt) != metadata->module_id) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    if (!context->arena_opt) {
+        HM_TRY(hmModuleRegistryCreateArena(registry, &context->arena_opt));
+    }
+    hmMethod* method = (hmMethod*)hmAlloc(context->arena_opt, sizeof(hmMethod));
+    if (!method) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmCreateMethod(context->arena_opt, registry->allocator, context->metadata_loader, metadata, method);
+    if (err != HM_OK) {
+        hmFree(context->arena_opt, method);
+        return err;
+    }
+    err = hmModuleRegistryAddMethod(registry, hm_class, method);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmDisposeMethod(method));
+    }
+    return err;
+}
+
+static hmError hmModuleRegistry_disposeModuleFunc(void* object)
+{
+    hmModule* module;
+    hmCopyMemory(&module, object, sizeof(hmModule*)); /* Hashmap values aren't necessarily aligned. */
+    hmAllocator* allocator = module->allocator;
+    hmError err = hmModuleDispose(module);
+    hmFree(allocator, module);
+    return err;
+}
+
+/* Runs on a worker thread. */
+static hmError hmModuleRegistry_loadPartitionFunc(void* work_item, hmScheduler* scheduler_opt)
+{
+    hmModuleRegistryPartition* partition;
+    hmCopyMemory(&partition, work_item, sizeof(hmModuleRegistryPartition*));
+    hmError err = hmMetadataLoaderEnumMethodsInRange(
+        partition->metadata_loader,
+        partition->min_method_id,
+        partition->max_method_id,
+        &hmModuleRegistry_enumPartitionMethodsFunc,
+        partition
+    );
+    /* Joining a worker doesn't necessarily synchronize with it (the thread may be already observed as stopped), so
+       everything written to the partition is published by releasing the mutex. */
+    HM_TRY(hmMutexLock(partition->completion_mutex));
+    partition->err = err;
+    return hmMutexUnlock(partition->completion_mutex);
+}
+
+/* Runs on a worker thread: everything except the partition itself is read-only here, so no synchronization is needed. */
+static hmError hmModuleRegistry_enumPartitionMethodsFunc(hmMethodMetadata* metadata, void* user_data)
+{
+    hmModuleRegistryPartition* partition = (hmModuleRegistryPartition*)user_data;
+    hmModuleRegistryLoadedMethod loaded_method;
+    loaded_method.method = (hmMethod*)hmAlloc(partition->arena, sizeof(hmMethod));
+    if (!loaded_method.method) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmCreateMethod(
+        partition->arena,
+        partition->body_allocator,
+        partition->metadata_loader,
+        metadata,
+        loaded_method.method
+    );
+    if (err != HM_OK) {
+        hmFree(partition->arena, loaded_method.method);
+        return err;
+    }
+    loaded_method.class_id = metadata->class_id;
+    loaded_method.module_id = metadata->module_id;
+    err = hmArrayAdd(&partition->loaded_methods, &loaded_method);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmDisposeMethod(loaded_method.method));
+    }
+    return err;
+}
+
+/* Returns HM_ERROR_INVALID_DATA if there's no such class: used when loading to validate references. */
+static hmError hmModuleRegistryGetClass(hmModuleRegistry* registry, hm_metadata_id module_id, hm_metadata_id class_id, hmClass** out_class)
+{
+    hmModule* module = HM_NULL;
+    hmError err = hmModuleRegistryGetModule(registry, module_id, &module);
+    if (err == HM_OK) {
+        err = hmModuleGetClass(module, class_id, out_class);
+    }
+    return err == HM_ERROR_NOT_FOUND ? HM_ERROR_INVALID_DATA : err;
+}
+
+/* Grows the method table to cover the given range of IDs in addition to the IDs of the modules loaded before. */
+static hmError hmModuleRegistryReserveMethodTable(hmModuleRegistry* registry, hm_metadata_id min_method_id, hm_metadata_id max_method_id)
+{
+    hm_nint old_count = hmArrayGetCount(&registry->method_table);
+    if (old_count) {
+        hm_metadata_id old_max_method_id = registry->min_method_id + (hm_metadata_id)(old_count - 1);
+        min_method_id = registry->min_method_id < min_method_id ? registry->min_method_id : min_method_id;
+        max_method_id = old_max_method_id > max_method_id ? old_max_method_id : max_method_id;
+    }
+    /* 64-bit math: the whole range of 32-bit IDs is 2^32 IDs. */
+    hm_uint64 new_count = (hm_uint64)max_method_id - min_method_id + 1;
+    if (new_count > HM_MODULE_REGISTRY_MAX_METHOD_ID_RANGE) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    if (new_count == old_count) {
+        return HM_OK;
+    }
+    /* The signature table is grown first and by its own count: if growing the method table fails, the signature table
+       is merely longer than needed (lookups are bounded by the method table), and the next call catches up. */
+    hm_nint old_signature_count = hmArrayGetCount(&registry->signature_table);
+    if (new_count > old_signature_count) {
+        HM_TRY(hmArrayExpand(&registry->signature_table, (hm_nint)new_count - old_signature_count, HM_NULL, HM_NULL));
+    }
+    HM_TRY(hmArrayExpand(&registry->method_table, (hm_nint)new_count - old_count, HM_NULL, HM_NULL)); /* Zeroes new items. */
+    hm_nint shift = old_count ? registry->min_method_id - min_method_id : 0;
+    if (shift) {
+        hmMethod** method_table = hmArrayGetRaw(&registry->method_table, hmMethod*);
+        hmMoveMemory(method_table + shift, method_table, old_count * sizeof(hmMethod*));
+        hmZeroMemory(method_table, shift * sizeof(hmMethod*));
+        hmSignature** signature_table = hmArrayGetRaw(&registry->signature_table, hmSignature*);
+        hmMoveMemory(signature_table + shift, signature_table, old_count * sizeof(hmSignature*));
+        hmZeroMemory(signature_table, shift * sizeof(hmSignature*));
+    }
+    registry->min_method_id = min_method_id;
+    return HM_OK;
+}
+
+/* Adds the method both to its class and to the method table, and interns its signature. On error, the method is still
+   owned by the caller. */
+static hmError hmModuleRegistryAddMethod(hmModuleRegistry* registry, hmClass* hm_class, hmMethod* method)
+{
+    hm_metadata_id method_id = hmMethodGetID(method);
+    /* A broken loader: outside of the range of IDs it reported. */
+    if (method_id < registry->min_method_id || method_id - registry->min_method_id >= hmArrayGetCount(&registry->method_table)) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hmMethod** method_table = hmArrayGetRaw(&registry->method_table, hmMethod*);
+    hm_nint index = method_id - registry->min_method_id;
+    if (method_table[index]) { /* The ID is already used by another class. */
+        return HM_ERROR_INVALID_DATA;
+    }
+    HM_TRY(hmSignatureTableIntern(&registry->signatures, &method->signature, &method->parsed_signature_opt));
+    HM_TRY(hmClassAddMethod(hm_class, method));
+    method_table[index] = method;
+    hmSignature** signature_table = hmArrayGetRaw(&registry->signature_table, hmSignature*);
+    signature_table[index] = method->parsed_signature_opt;
+    return HM_OK;
+}
+
+/* The arena is registered right away: it must outlive all the methods allocated in it, whether loading succeeds or not. */
+static hmError hmModuleRegistryCreateArena(hmModuleRegistry* registry, hmAllocator** out_arena)
+{
+    hmAllocator* arena = (hmAllocator*)hmAlloc(registry->allocator, sizeof(hmAllocator));
+    if (!arena) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = hmCreateBumpPointerAllocator(registry->allocator, HM_NINT_MAX, arena);
+    if (err != HM_OK) {
+        hmFree(registry->allocator, arena);
+        return err;
+    }
+    err = hmArrayAdd(&registry->arenas, &arena);
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmAllocatorDispose(arena));
+        hmFree(registry->allocator, arena);
+        return err;
+    }
+    *out_arena = arena;
     return HM_OK;
 }
 
-static hmError hmModuleRegistry_enumMethodsFunc(hmMethodMetadata* metadata, void* user_data)
+/* Loads methods of the partitions on temporary workers while modules and classes are loaded on the current thread. */
+static hmError hmModuleRegistryLoadPartitions(
+    hmModuleRegistry*          registry,
+    hmMetadataLoader*          metadata_loader,
+    hmModuleRegistryPartition* partitions,
+    hm_nint                    partition_count
+)
 {
+    hmMutex completion_mutex;
+    HM_TRY(hmCreateMutex(registry->allocator, &completion_mutex));
+    hmWorkerPool pool;
+    hmError err = hmCreateWorkerPool(
+        registry->allocator,
+        HM_NULL,  /* name_opt */
+        partition_count,
+        &hmModuleRegistry_loadPartitionFunc,
+        sizeof(hmModuleRegistryPartition*),
+        HM_NULL,  /* item_dispose_func_opt */
+        HM_FALSE, /* is_queue_bounded */
+        partition_count,
+        HM_WORKER_NO_COROUTINES,
+        HM_WORKER_POOL_AFFINITY_NONE,
+        &pool
+    );
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmMutexDispose(&completion_mutex));
+    }
+    for (hm_nint i = 0; i < partition_count; i++) {
+        hmModuleRegistryPartition* partition = &partitions[i];
+        partition->completion_mutex = &completion_mutex;
+        HM_TRY_OR_FINALIZE(err, hmWorkerPoolEnqueueItem(&pool, &partition));
+    }
+    hmModuleRegistryLoadContext context;
+    context.registry = registry;
+    context.metadata_loader = metadata_loader;
+    context.arena_opt = HM_NULL; /* Methods are loaded by the workers. */
+    context.current_module_opt = HM_NULL;
+    context.current_class_opt = HM_NULL;
+    err = hmMetadataLoaderEnumMetadata(
+        metadata_loader,
+        &hmModuleRegistry_enumModulesFunc,
+        &hmModuleRegistry_enumClassesFunc,
+        HM_NULL,
+        &context
+    );
+HM_ON_FINALIZE
+    /* Even on error, the workers must finish before the partitions can be disposed of. */
+    err = hmMergeErrors(err, hmWorkerPoolStop(&pool, HM_TRUE));
+    err = hmMergeErrors(err, hmWorkerPoolWait(&pool, HM_MODULE_REGISTRY_LOAD_TIMEOUT_MS));
+    err = hmMergeErrors(err, hmWorkerPoolDispose(&pool));
+    /* Acquires everything the workers published (see hmModuleRegistry_loadPartitionFunc). */
+    err = hmMergeErrors(err, hmMutexLock(&completion_mutex));
+    err = hmMergeErrors(err, hmMutexUnlock(&completion_mutex));
+    err = hmMergeErrors(err, hmMutexDispose(&completion_mutex));
+    for (hm_nint i = 0; i < partition_count; i++) {
+        partitions[i].completion_mutex = HM_NULL;
+        err = hmMergeErrors(err, partitions[i].err);
+    }
+    return err;
+}
+
+/* Runs on the current thread after all the workers are done. */
+static hmError hmModuleRegistryMergePartition(hmModuleRegistry* registry, hmModuleRegistryPartition* partition)
+{
+    hmModuleRegistryLoadedMethod* loaded_methods = hmArrayGetRaw(&partition->loaded_methods, hmModuleRegistryLoadedMethod);
+    hm_nint loaded_count = hmArrayGetCount(&partition->loaded_methods);
+    for (; partition->merged_count < loaded_count; partition->merged_count++) {
+        hmModuleRegistryLoadedMethod* loaded_method = &loaded_methods[partition->merged_count];
+        hmClass* hm_class = HM_NULL;
+        HM_TRY(hmModuleRegistryGetClass(registry, loaded_method->module_id, loaded_method->class_id, &hm_class));
+        HM_TRY(hmModuleRegistryAddMethod(registry, hm_class, loaded_method->method));
+    }
     return HM_OK;
 }
+
+static hmError hmCreateModuleRegistryPartition(
+    hmModuleRegistry*          registry,
+    hmMetadataLoader*          metadata_loader,
+    hm_metadata_id             min_method_id,
+    hm_metadata_id             max_method_id,
+    hmModuleRegistryPartition* in_partition
+)
+{
+    HM_TRY(hmModuleRegistryCreateArena(registry, &in_partition->arena));
+    in_partition->body_allocator = registry->allocator;
+    HM_TRY(hmCreateArray(
+        registry->allocator,
+        sizeof(hmModuleRegistryLoadedMethod),
+        HM_ARRAY_DEFAULT_CAPACITY,
+        HM_NULL,
+        &in_partition->loaded_methods
+    ));
+    in_partition->metadata_loader = metadata_loader;
+    in_partition->merged_count = 0;
+    in_partition->min_method_id = min_method_id;
+    in_partition->max_method_id = max_method_id;
+    in_partition->completion_mutex = HM_NULL;
+    in_partition->err = HM_OK;
+    return HM_OK;
+}
+
+/* Methods which weren't merged are still owned by the partition. */
+static hmError hmModuleRegistryPartitionDispose(hmModuleRegistryPartition* partition)
+{
+    hmError err = HM_OK;
+    hmModuleRegistryLoadedMethod* loaded_methods = hmArrayGetRaw(&partition->loaded_methods, hmModuleRegistryLoadedMethod);
+    for (hm_nint i = partition->merged_count; i < hmArrayGetCount(&partition->loaded_methods); i++) {
+        err = hmMergeErrors(err, hmDisposeMethod(loaded_methods[i].method));
+    }
+    return hmMergeErrors(err, hmArrayDispose(&partition->loaded_methods));
+}
+
+/* Disposes of a method allocated with its own allocator. */
+static hmError hmDisposeMethod(hmMethod* method)
+{
+    hmAllocator* allocator = method->allocator;
+    hmError err = hmMethodDispose(method);
+    hmFree(allocator, method);
+    return err;
+}
@@ -15,20 +15,76 @@
 #define HM_MODULE_REGISTRY_H
 
 #include <core/allocator.h>
+#include <collections/array.h>
 #include <collections/hashmap.h>
 #include <runtime/metadata.h>
+#include <runtime/module.h>
+#include <runtime/signature.h>
+
+/* The largest range of method IDs (from the smallest to the largest one) a registry accepts, see hmModuleRegistryGetMethod(..) */
+#define HM_MODULE_REGISTRY_MAX_METHOD_ID_RANGE (16 * 1024 * 1024)
 
 typedef struct {
-    hmAllocator* allocator;
-    hmHashMap    modules; /* hmHashMap<hm_metadata_id, hmModule*> */
+    hmAllocator*     allocator;
+    hmHashMap        modules;         /* hmHashMap<hm_metadata_id, hmModule*> */
+    hmArray          arenas;          /* hmArray<hmAllocator*> Bump pointer allocators which own loaded methods. */
+    hmArray          method_table;    /* hmArray<hmMethod*> Indexed by method ID minus `min_method_id`; HM_NULL for IDs
+                                         which aren't used. */
+    hmArray          signature_table; /* hmArray<hmSignature*> Parallel to `method_table`: the parsed signature of each
+                                         method, so that resolving a call target (the hot path of verification and
+                                         lowering) reads two dense tables instead of dereferencing the method. */
+    hm_metadata_id   min_method_id;
+    hmSignatureTable signatures;      /* Parsed signatures of the loaded methods, see hmMethod::parsed_signature_opt */
 } hmModuleRegistry;
 
+typedef hmError (*hmModuleRegistryEnumMethodsFunc)(hmMethod* method, void* user_data);
+
 /* A module registry is where all modules and their classes are registered and stored. Typically, there should
    be only one module registry per runtime instance. */
 hmError hmCreateModuleRegistry(hmAllocator* allocator, hmModuleRegistry* in_registry);
 hmError hmModuleRegistryDispose(hmModuleRegistry* registry);
 /* Loads a module using the provided metadata loader. After registering, all classes in the module are immediately usable.
+   Metadata is read in a single ordered pass (see hmMetadataLoaderEnumJoinedMetadata(..)).
+   Only declarations are loaded: method bodies are fetched from the loader on first use (see hmMethodGetHLBody(..)),
+   so the loader must outlive the registry. Methods, which usually make up most of the metadata, are allocated together
+   with their names and signatures in a bump pointer arena of their own, so that they're laid out densely instead of
+   being scattered over many small heap blocks; the arena is kept until the registry is disposed of. The arena isn't
+   thread-safe, so it's only used during loading: method bodies, which are loaded and compiled lazily by whichever
+   worker calls a method first, are allocated with the allocator of the registry, which must be thread-safe if the
+   methods are called from more than one worker.
+   Returns HM_ERROR_INVALID_DATA if IDs are duplicated, if a class or a method refers to a module or a class which
+   doesn't exist, or if a signature is malformed. On error, the objects loaded so far stay registered.
    Note that this method is not thread-safe, so any active workers must be temporarily suspended before calling it. */
 hmError hmModuleRegistryLoad(hmModuleRegistry* registry, hmMetadataLoader* metadata_loader);
+/* Same as hmModuleRegistryLoad(..), except methods, which usually make up most of the metadata, are loaded in parallel
+   on `worker_count` temporary worker threads, while modules and classes are loaded on the current thread.
+   The method table is partitioned by ID ranges (see hmMetadataLoaderEnumMethodsInRange(..)), and each worker creates
+   the methods of its partition (duplicates strings, validates names, etc.) in its own bump pointer arena; the methods
+   are then added to their classes in a final single-threaded step. The arenas are kept until the registry is disposed of.
+   Partitions are of equal ID ranges, which balances the load well if IDs are dense (the usual case).
+   The allocator of the registry must be thread-safe. */
+hmError hmModuleRegistryLoadInParallel(hmModuleRegistry* registry, hmMetadataLoader* metadata_loader, hm_nint worker_count);
+/* Returns HM_ERROR_NOT_FOUND if there's no such module. The returned reference is valid as long as the registry is. */
+hmError hmModuleRegistryGetModule(hmModuleRegistry* registry, hm_metadata_id module_id, hmModule** out_module);
+/* Looks up a method by its ID alone, for example, to resolve the target of a call (see hmResolveCallTargetFunc).
+   Method IDs are unique across all modules, and image compilers number methods densely, so methods are kept in a flat
+   table indexed by ID, which is filled at load time: a lookup is a single indexed load instead of going through the
+   module and the class. For that reason, loading fails with HM_ERROR_LIMIT_EXCEEDED if method IDs span a range larger
+   than HM_MODULE_REGISTRY_MAX_METHOD_ID_RANGE, and with HM_ERROR_INVALID_DATA if an ID is already used by a method of
+   another class. Returns HM_ERROR_NOT_FOUND if there's no such method. The returned reference is valid as long as
+   the registry is. */
+hmError hmModuleRegistryGetMethod(hmModuleRegistry* registry, hm_metadata_id method_id, hmMethod** out_method);
+/* Enumerates all the loaded methods in the order of their IDs, which is a linear scan over the method table (see
+   hmModuleRegistryGetMethod(..)) rather than a walk over modules and classes. Stops and returns the error if
+   `enum_methods_func` fails. */
+hmError hmModuleRegistryEnumMethods(hmModuleRegistry* registry, hmModuleRegistryEnumMethodsFunc enum_methods_func, void* user_data);
+/* Resolves the targets of calls against the registry passed as `user_data`: can be used as hmResolveCallTargetFunc
+   (see runtime/verifier.h) when compiling methods loaded with the registry. */
+hmError hmModuleRegistryResolveCallTargetFunc(
+    hm_metadata_id method_id,
+    void*          user_data,
+    hmMethod**     out_method,
+    hmSignature**  out_signature
+);
 
 #endif /* HM_MODULE_REGISTRY_H */
@@ -17,20 +17,51 @@
 #include <core/common.h>
 
 /* A method's body consists of a sequence of high-level opcodes (bytecode).
-   Many opcodes are followed by additional encodings: what argument to load, what constant to push etc.
-   High-level bytecode is verified and compiled to low-level bytecode on the fly (see hmLLOpcode). */
+   Many opcodes are followed by additional encodings: what argument to load, what constant to push etc. All encodings are
+   little-endian. There are no branches yet, so control flow is linear: falling off the end of the body returns from
+   the method, with the return value (if any) as the only value left on the stack.
+   High-level bytecode is verified and compiled to low-level bytecode on the fly (see hmLLOpcode, runtime/lowering.h). */
 typedef hm_uint8 hmHLOpcode;
-#define HM_HLOPCODE_NOP    ((hmOpcode)0)  /* nop Do nothing (No operation). */
-#define HM_HLOPCODE_STLOC  ((hmOpcode)1)  /* stloc <uint16(N)> Pop a value from the stack into the variable space at index N. */
-#define HM_HLOPCODE_LDARG  ((hmOpcode)2)  /* ldarg <uint16(N)> Load an argument at index N in the argument space onto the stack. */
-#define HM_HLOPCODE_LDLOC  ((hmOpcode)3)  /* ldloc <uint16(N)> Load a value at index N in the variable space onto the stack. */
-#define HM_HLOPCODE_STARG  ((hmOpcode)4)  /* starg <uint16(N)> Store a value from the stack to the argument at index N in the argument space. */
-#define HM_HLOPCODE_LDC32  ((hmOpcode)5)  /* ldc.32 <any32(N)> Push a 32-bit constant onto the stack. */
-#define HM_HLOPCODE_LDC64  ((hmOpcode)6)  /* ldc.64 <any64(N)> Push a 64-bit constant onto the stack. */
-#define HM_HLOPCODE_DUP    ((hmOpcode)7)  /* dup Duplicate a value on the top of the stack. */
-#define HM_HLOPCODE_POP    ((hmOpcode)8)  /* pop Pop a value from the stack. */
-#define HM_HLOPCODE_CALL   ((hmOpcode)9)  /* call <uint32(N)> Call a method with ID = N. */
+#define HM_HLOPCODE_NOP    ((hmHLOpcode)0)  /* nop Do nothing (No operation). */
+#define HM_HLOPCODE_STLOC  ((hmHLOpcode)1)  /* stloc <uint16(N)> Pop a value from the stack into the variable space at index N. */
+#define HM_HLOPCODE_LDARG  ((hmHLOpcode)2)  /* ldarg <uint16(N)> Load an argument at index N in the argument space onto the stack. */
+#define HM_HLOPCODE_LDLOC  ((hmHLOpcode)3)  /* ldloc <uint16(N)> Load a value at index N in the variable space onto the stack. */
+#define HM_HLOPCODE_STARG  ((hmHLOpcode)4)  /* starg <uint16(N)> Store a value from the stack to the argument at index N in the argument space. */
+#define HM_HLOPCODE_LDC32  ((hmHLOpcode)5)  /* ldc.32 <any32(N)> Push a 32-bit constant onto the stack. */
+#define HM_HLOPCODE_LDC64  ((hmHLOpcode)6)  /* ldc.64 <any64(N)> Push a 64-bit constant onto the stack. */
+#define HM_HLOPCODE_DUP    ((hmHLOpcode)7)  /* dup Duplicate a value on the top of the stack. */
+#define HM_HLOPCODE_POP    ((hmHLOpcode)8)  /* pop Pop a value from the stack. */
+#define HM_HLOPCODE_CALL   ((hmHLOpcode)9)  /* call <uint32(N)> Call a method with ID = N. */
+#define HM_HLOPCODE_COUNT  10
 
+/* Low-level bytecode is what's actually executed. It's produced from verified high-level bytecode, so it's trusted:
+   nothing is validated at execution time. Instead of an evaluation stack, it operates on a frame of 64-bit registers:
+   arguments come first, then locals, then the slots of the high-level evaluation stack (stack depth D maps to
+   the register right after the locals plus D). Register indices are uint16, encodings are native-endian and never
+   persisted. 32-bit values are kept sign-extended in registers. See runtime/interpreter.h */
 typedef hm_uint8 hmLLOpcode;
+#define HM_LLOPCODE_MOV        ((hmLLOpcode)0) /* mov <uint16(D)> <uint16(S)> Copy register S to register D. */
+#define HM_LLOPCODE_LDC32      ((hmLLOpcode)1) /* ldc.32 <uint16(D)> <any32(N)> Load a 32-bit constant into register D. */
+#define HM_LLOPCODE_LDC64      ((hmLLOpcode)2) /* ldc.64 <uint16(D)> <any64(N)> Load a 64-bit constant into register D. */
+#define HM_LLOPCODE_CALL       ((hmLLOpcode)3) /* call <uint16(B)> <hmMethod*(M)> Call method M with arguments in registers B, B+1, ...;
+                                                  the return value (if any) is stored to register B. */
+#define HM_LLOPCODE_RET        ((hmLLOpcode)4) /* ret <uint16(S)> Return the value of register S. */
+#define HM_LLOPCODE_RETVOID    ((hmLLOpcode)5) /* ret.void Return from a method which returns nothing. */
+/* Superinstructions: common pairs of instructions fused into one to save a dispatch. */
+#define HM_LLOPCODE_MOV2       ((hmLLOpcode)6) /* mov2 <uint16(D1)> <uint16(S1)> <uint16(D2)> <uint16(S2)> Same as two movs in a row
+                                                  (for example, `ldloc` followed by `ldloc`). */
+#define HM_LLOPCODE_LDC32_CALL ((hmLLOpcode)7) /* ldc.32.call <uint16(D)> <any32(N)> <uint16(B)> <hmMethod*(M)> Same as ldc.32
+                                                  followed by call (a constant passed as the last argument). */
+#define HM_LLOPCODE_COUNT      8
+
+/* Sizes of low-level instructions, including the opcode. */
+#define HM_LLOPCODE_MOV_SIZE        (1 + sizeof(hm_uint16) * 2)
+#define HM_LLOPCODE_LDC32_SIZE      (1 + sizeof(hm_uint16) + sizeof(hm_uint32))
+#define HM_LLOPCODE_LDC64_SIZE      (1 + sizeof(hm_uint16) + sizeof(hm_uint64))
+#define HM_LLOPCODE_CALL_SIZE       (1 + sizeof(hm_uint16) + sizeof(void*))
+#define HM_LLOPCODE_RET_SIZE        (1 + sizeof(hm_uint16))
+#define HM_LLOPCODE_RETVOID_SIZE    1
+#define HM_LLOPCODE_MOV2_SIZE       (1 + sizeof(hm_uint16) * 4)
+#define HM_LLOPCODE_LDC32_CALL_SIZE (HM_LLOPCODE_LDC32_SIZE + sizeof(hm_uint16) + sizeof(void*))
 
 #endif /* HM_OPCODE_H */
@@ -0,0 +1,124 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/signature.h>
+
+#define HM_SIGNATURE_MIN_LENGTH 3 /* "()V" */
+
+static hm_bool hmParseValueType(char c, hmValueType* out_type);
+static hmError hmSignatureTableAdd(hmSignatureTable* table, hmString* encoded_signature, hmSignature** out_signature);
+
+hmError hmParseSignature(hmAllocator* allocator, hmString* encoded_signature, hmSignature* in_signature)
+{
+    const char* chars = hmStringGetCString(encoded_signature);
+    hm_nint length = hmStringGetLengthInBytes(encoded_signature);
+    if (length < HM_SIGNATURE_MIN_LENGTH || chars[0] != '(' || chars[length - 2] != ')') {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hm_nint param_count = length - HM_SIGNATURE_MIN_LENGTH;
+    if (param_count > HM_UINT16_MAX) {
+        return HM_ERROR_LIMIT_EXCEEDED;
+    }
+    hmValueType return_type;
+    if (!hmParseValueType(chars[length - 1], &return_type)) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hmValueType* param_types = HM_NULL;
+    if (param_count) {
+        param_types = (hmValueType*)hmAlloc(allocator, param_count * sizeof(hmValueType));
+        if (!param_types) {
+            return HM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    for (hm_nint i = 0; i < param_count; i++) {
+        /* Parameters can't be void. */
+        if (!hmParseValueType(chars[i + 1], &param_types[i]) || param_types[i] == HM_VALUE_TYPE_VOID) {
+            hmFree(allocator, param_types);
+            return HM_ERROR_INVALID_DATA;
+        }
+    }
+    in_signature->param_types = param_types;
+    in_signature->param_count = (hm_uint16)param_count;
+    in_signature->return_type = return_type;
+    return HM_OK;
+}
+
+hmError hmCreateSignatureTable(hmAllocator* allocator, hmSignatureTable* in_table)
+{
+    HM_TRY(hmCreateBumpPointerAllocator(allocator, HM_NINT_MAX, &in_table->arena));
+    hmError err = hmCreateHashMap(
+        allocator,
+        &hmStringHashFunc,
+        &hmStringEqualsFunc,
+        HM_NULL, /* key_dispose_func_opt: keys are allocated in the arena */
+        HM_NULL, /* value_dispose_func_opt: same */
+        sizeof(hmString),
+        sizeof(hmSignature*),
+        HM_HASHMAP_DEFAULT_CAPACITY,
+        HM_HASHMAP_DEFAULT_LOAD_FACTOR,
+        0,
+        &in_table->signatures
+    );
+    if (err != HM_OK) {
+        return hmMergeErrors(err, hmAllocatorDispose(&in_table->arena));
+    }
+    in_table->allocator = allocator;
+    return HM_OK;
+}
+
+hmError hmSignatureTableDispose(hmSignatureTable* table)
+{
+    hmError err = hmHashMapDispose(&table->signatures);
+    return hmMergeErrors(err, hmAllocatorDispose(&table->arena));
+}
+
+hmError hmSignatureTableIntern(hmSignatureTable* table, hmString* encoded_signature, hmSignature** out_signature)
+{
+    hmError err = hmHashMapGet(&table->signatures, encoded_signature, out_signature);
+    if (err == HM_ERROR_NOT_FOUND) {
+        err = hmSignatureTableAdd(table, encoded_signature, out_signature);
+    }
+    return err;
+}
+
+/* If something fails midway, what's already allocated in the arena stays there until the table is disposed of. */
+static hmError hmSignatureTableAdd(hmSignatureTable* table, hmString* encoded_signature, hmSignature** out_signature)
+{
+    hmSignature* signature = (hmSignature*)hmAlloc(&table->arena, sizeof(hmSignature));
+    if (!signature) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    HM_TRY(hmParseSignature(&table->arena, encoded_signature, signature));
+    hmString key;
+    HM_TRY(hmStringDuplicate(&table->arena, encoded_signature, &key));
+    HM_TRY(hmHashMapPut(&table->signatures, &key, &signature));
+    *out_signature = signature;
+    return HM_OK;
+}
+
+static hm_bool hmParseValueType(char c, hmValueType* out_type)
+{
+    switch (c) {
+        case 'V':
+            *out_type = HM_VALUE_TYPE_VOID;
+            return HM_TRUE;
+        case 'I':
+            *out_type = HM_VALUE_TYPE_INT32;
+            return HM_TRUE;
+        case 'J':
+            *out_type = HM_VALUE_TYPE_INT64;
+            return HM_TRUE;
+        default:
+            return HM_FALSE;
+    }
+}
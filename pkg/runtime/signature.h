@@ -14,11 +14,46 @@
 #ifndef HM_SIGNATURE_H
 #define HM_SIGNATURE_H
 
-#include <collections/array.h>
+#include <core/common.h>
+#include <core/allocator.h>
+#include <core/string.h>
+#include <collections/hashmap.h>
+
+/* The type of a value on the evaluation stack, in a local variable or in an argument. Encoded in signature strings
+   similar to Java: 'V' (void, only as a return type), 'I' (32-bit integer), 'J' (64-bit integer). */
+typedef hm_uint8 hmValueType;
+#define HM_VALUE_TYPE_VOID  ((hmValueType)0)
+#define HM_VALUE_TYPE_INT32 ((hmValueType)1)
+#define HM_VALUE_TYPE_INT64 ((hmValueType)2)
 
 typedef struct {
-    struct hmClass_* return_class;
-    hmArray          param_classes; /* hmArray<hmClass*> */
+    hmValueType* param_types; /* `param_count` types of the parameters, in the order of declaration. */
+    hm_uint16    param_count;
+    hmValueType  return_type;
 } hmSignature;
 
+/* Parses a signature encoded as in metadata: parameter types in parentheses followed by the return type, for example,
+   "(IJ)V". `param_types` of the result is allocated with `allocator` (unless there are no parameters, in which case
+   it's HM_NULL) and should be freed with hmFree(..) Returns HM_ERROR_INVALID_DATA if the signature is malformed, and
+   HM_ERROR_LIMIT_EXCEEDED if there are more parameters than `param_count` can hold. */
+hmError hmParseSignature(hmAllocator* allocator, hmString* encoded_signature, hmSignature* in_signature);
+
+/* Many methods share the same signatures, so signatures are interned: every distinct encoded signature is parsed only
+   once, and all methods with it share the same immutable hmSignature object. As a result, signatures can be compared
+   by pointer. */
+typedef struct {
+    hmAllocator* allocator;
+    hmAllocator  arena;      /* Owns interned signatures, their parameter types and encoded forms: they're never freed
+                                one by one. */
+    hmHashMap    signatures; /* hmHashMap<hmString, hmSignature*> Keys are encoded signatures. */
+} hmSignatureTable;
+
+hmError hmCreateSignatureTable(hmAllocator* allocator, hmSignatureTable* in_table);
+hmError hmSignatureTableDispose(hmSignatureTable* table);
+/* Returns the interned signature for the given encoded signature, parsing it if it's seen for the first time (see
+   hmParseSignature(..) for the errors). The returned signature must not be modified; it's valid as long as the table
+   is. Not thread-safe. */
+hmError hmSignatureTableIntern(hmSignatureTable* table, hmString* encoded_signature, hmSignature** out_signature);
+#define hmSignatureTableGetCount(table) hmHashMapGetCount(&(table)->signatures)
+
 #endif /* HM_SIGNATURE_H */
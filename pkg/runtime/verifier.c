@@ -0,0 +1,271 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <runtime/verifier.h>
+
+#define HM_VERIFIER_INVALID_OPERAND_SIZE HM_NINT_MAX
+
+typedef struct {
+    hmAllocator*            allocator;
+    hmMethodBody*           hl_body;
+    hmResolveCallTargetFunc resolve_call_target_func;
+    void*                   user_data;
+    hmVerifiedMethodBody*   verified_body;
+    hmValueType*            stack;       /* Types of the values on the evaluation stack. */
+    hm_uint16               stack_depth;
+} hmVerifierState;
+
+static hm_nint hmGetHLOperandSize(hmHLOpcode opcode);
+static hm_uint64 hmReadHLOperand(const hm_uint8* bytes, hm_nint size);
+static hmError hmVerifyInstruction(hmVerifierState* state, hmVerifiedInstruction* instruction);
+static hmError hmVerifierPush(hmVerifierState* state, hmValueType type, hmVerifiedInstruction* instruction);
+static hmError hmVerifierPop(hmVerifierState* state, hmValueType* out_type, hmVerifiedInstruction* instruction);
+static hmError hmVerifierStoreLocal(hmVerifierState* state, hm_nint local_index, hmValueType type);
+static hmError hmVerifierVerifyCall(hmVerifierState* state, hmVerifiedInstruction* instruction);
+
+hmError hmVerifyMethodBody(
+    hmAllocator*            allocator,
+    hmMethodBody*           hl_body,
+    hmSignature*            signature,
+    hmResolveCallTargetFunc resolve_call_target_func,
+    void*                   user_data,
+    hmVerifiedMethodBody*   in_verified_body
+)
+{
+    if (!hl_body->size) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    /* Every instruction pushes at most one value, so the stack can't be deeper than there are bytes in the body. */
+    hmValueType* stack = (hmValueType*)hmAlloc(allocator, hl_body->size * sizeof(hmValueType));
+    if (!stack) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hmError err = HM_OK;
+    hm_bool are_instructions_created = HM_FALSE, are_local_types_created = HM_FALSE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(
+        allocator,
+        sizeof(hmVerifiedInstruction),
+        HM_ARRAY_DEFAULT_CAPACITY,
+        HM_NULL,
+        &in_verified_body->instructions
+    ));
+    are_instructions_created = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateArray(
+        allocator,
+        sizeof(hmValueType),
+        HM_ARRAY_DEFAULT_CAPACITY,
+        HM_NULL,
+        &in_verified_body->local_types
+    ));
+    are_local_types_created = HM_TRUE;
+    in_verified_body->signature = signature;
+    in_verified_body->max_stack_depth = 0;
+    hmVerifierState state;
+    state.allocator = allocator;
+    state.hl_body = hl_body;
+    state.resolve_call_target_func = resolve_call_target_func;
+    state.user_data = user_data;
+    state.verified_body = in_verified_body;
+    state.stack = stack;
+    state.stack_depth = 0;
+    hm_nint offset = 0;
+    while (offset < hl_body->size) {
+        hmVerifiedInstruction instruction;
+        instruction.offset = (hm_method_size)offset;
+        instruction.stack_depth = state.stack_depth;
+        instruction.popped_count = 0;
+        instruction.pushed_type = HM_VALUE_TYPE_VOID;
+        instruction.opcode = hl_body->opcodes[offset];
+        instruction.call_target_opt = HM_NULL;
+        hm_nint operand_size = hmGetHLOperandSize(instruction.opcode);
+        if (operand_size == HM_VERIFIER_INVALID_OPERAND_SIZE || operand_size > hl_body->size - offset - 1) {
+            err = HM_ERROR_INVALID_DATA; /* An unknown opcode or a truncated operand. */
+            HM_FINALIZE;
+        }
+        instruction.operand = hmReadHLOperand(hl_body->opcodes + offset + 1, operand_size);
+        HM_TRY_OR_FINALIZE(err, hmVerifyInstruction(&state, &instruction));
+        HM_TRY_OR_FINALIZE(err, hmArrayAdd(&in_verified_body->instructions, &instruction));
+        offset += 1 + operand_size;
+    }
+    /* Falling off the end returns from the method. */
+    if (signature->return_type == HM_VALUE_TYPE_VOID) {
+        if (state.stack_depth != 0) {
+            err = HM_ERROR_INVALID_DATA;
+        }
+    } else if (state.stack_depth != 1 || state.stack[0] != signature->return_type) {
+        err = HM_ERROR_INVALID_DATA;
+    }
+HM_ON_FINALIZE
+    hmFree(allocator, stack);
+    if (err != HM_OK) {
+        if (are_instructions_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&in_verified_body->instructions));
+        }
+        if (are_local_types_created) {
+            err = hmMergeErrors(err, hmArrayDispose(&in_verified_body->local_types));
+        }
+    }
+    return err;
+}
+
+hmError hmVerifiedMethodBodyDispose(hmVerifiedMethodBody* verified_body)
+{
+    hmError err = hmArrayDispose(&verified_body->instructions);
+    return hmMergeErrors(err, hmArrayDispose(&verified_body->local_types));
+}
+
+static hm_nint hmGetHLOperandSize(hmHLOpcode opcode)
+{
+    switch (opcode) {
+        case HM_HLOPCODE_NOP:
+        case HM_HLOPCODE_DUP:
+        case HM_HLOPCODE_POP:
+            return 0;
+        case HM_HLOPCODE_STLOC:
+        case HM_HLOPCODE_LDARG:
+        case HM_HLOPCODE_LDLOC:
+        case HM_HLOPCODE_STARG:
+            return sizeof(hm_uint16);
+        case HM_HLOPCODE_LDC32:
+        case HM_HLOPCODE_CALL:
+            return sizeof(hm_uint32);
+        case HM_HLOPCODE_LDC64:
+            return sizeof(hm_uint64);
+        default:
+            return HM_VERIFIER_INVALID_OPERAND_SIZE;
+    }
+}
+
+static hm_uint64 hmReadHLOperand(const hm_uint8* bytes, hm_nint size)
+{
+    hm_uint64 value = 0;
+    for (hm_nint i = 0; i < size; i++) {
+        value |= (hm_uint64)bytes[i] << (i * 8);
+    }
+    return value;
+}
+
+static hmError hmVerifyInstruction(hmVerifierState* state, hmVerifiedInstruction* instruction)
+{
+    hmSignature* signature = state->verified_body->signature;
+    hmArray* local_types = &state->verified_body->local_types;
+    hmValueType type = HM_VALUE_TYPE_VOID;
+    switch (instruction->opcode) {
+        case HM_HLOPCODE_NOP:
+            return HM_OK;
+        case HM_HLOPCODE_STLOC:
+            HM_TRY(hmVerifierPop(state, &type, instruction));
+            return hmVerifierStoreLocal(state, (hm_nint)instruction->operand, type);
+        case HM_HLOPCODE_LDARG:
+            if (instruction->operand >= signature->param_count) {
+                return HM_ERROR_INVALID_DATA;
+            }
+            return hmVerifierPush(state, signature->param_types[instruction->operand], instruction);
+        case HM_HLOPCODE_LDLOC:
+            if (instruction->operand >= hmArrayGetCount(local_types)) {
+                return HM_ERROR_INVALID_DATA;
+            }
+            type = *(hmArrayGetRaw(local_types, hmValueType) + instruction->operand);
+            if (type == HM_VALUE_TYPE_VOID) { /* Not stored yet. */
+                return HM_ERROR_INVALID_DATA;
+            }
+            return hmVerifierPush(state, type, instruction);
+        case HM_HLOPCODE_STARG:
+            HM_TRY(hmVerifierPop(state, &type, instruction));
+            if (instruction->operand >= signature->param_count || signature->param_types[instruction->operand] != type) {
+                return HM_ERROR_INVALID_DATA;
+            }
+            return HM_OK;
+        case HM_HLOPCODE_LDC32:
+            return hmVerifierPush(state, HM_VALUE_TYPE_INT32, instruction);
+        case HM_HLOPCODE_LDC64:
+            return hmVerifierPush(state, HM_VALUE_TYPE_INT64, instruction);
+        case HM_HLOPCODE_DUP:
+            if (!state->stack_depth) {
+                return HM_ERROR_INVALID_DATA;
+            }
+            return hmVerifierPush(state, state->stack[state->stack_depth - 1], instruction);
+        case HM_HLOPCODE_POP:
+            return hmVerifierPop(state, &type, instruction);
+        case HM_HLOPCODE_CALL:
+            return hmVerifierVerifyCall(state, instruction);
+        default:
+            return HM_ERROR_INVALID_DATA;
+    }
+}
+
+static hmError hmVerifierPush(hmVerifierState* state, hmValueType type, hmVerifiedInstruction* instruction)
+{
+    state->stack[state->stack_depth++] = type;
+    instruction->pushed_type = type;
+    if (state->stack_depth > state->verified_body->max_stack_depth) {
+        state->verified_body->max_stack_depth = state->stack_depth;
+    }
+    return HM_OK;
+}
+
+static hmError hmVerifierPop(hmVerifierState* state, hmValueType* out_type, hmVerifiedInstruction* instruction)
+{
+    if (!state->stack_depth) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    *out_type = state->stack[--state->stack_depth];
+    instruction->popped_count++;
+    return HM_OK;
+}
+
+static hmError hmVerifierStoreLocal(hmVerifierState* state, hm_nint local_index, hmValueType type)
+{
+    hmArray* local_types = &state->verified_body->local_types;
+    hm_nint local_count = hmArrayGetCount(local_types);
+    if (local_index >= local_count) {
+        HM_TRY(hmArrayExpand(local_types, local_index - local_count + 1, HM_NULL, HM_NULL)); /* Zeroed: HM_VALUE_TYPE_VOID */
+    }
+    hmValueType* local_type = hmArrayGetRaw(local_types, hmValueType) + local_index;
+    if (*local_type != HM_VALUE_TYPE_VOID && *local_type != type) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    *local_type = type;
+    return HM_OK;
+}
+
+/* Arguments are popped in reverse order: the first argument is the deepest. */
+static hmError hmVerifierVerifyCall(hmVerifierState* state, hmVerifiedInstruction* instruction)
+{
+    hmSignature* callee_signature = HM_NULL;
+    hmError err = state->resolve_call_target_func(
+        (hm_metadata_id)instruction->operand,
+        state->user_data,
+        &instruction->call_target_opt,
+        &callee_signature
+    );
+    if (err == HM_ERROR_NOT_FOUND) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    HM_TRY(err);
+    if (callee_signature->param_count > state->stack_depth) {
+        return HM_ERROR_INVALID_DATA;
+    }
+    hm_uint16 first_arg_depth = (hm_uint16)(state->stack_depth - callee_signature->param_count);
+    for (hm_nint i = 0; i < callee_signature->param_count; i++) {
+        if (state->stack[first_arg_depth + i] != callee_signature->param_types[i]) {
+            return HM_ERROR_INVALID_DATA;
+        }
+    }
+    state->stack_depth = first_arg_depth;
+    instruction->popped_count = callee_signature->param_count;
+    if (callee_signature->return_type != HM_VALUE_TYPE_VOID) {
+        return hmVerifierPush(state, callee_signature->return_type, instruction);
+    }
+    return HM_OK;
+}
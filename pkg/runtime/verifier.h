@@ -0,0 +1,70 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_VERIFIER_H
+#define HM_VERIFIER_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <collections/array.h>
+#include <runtime/common.h>
+#include <runtime/method.h>
+#include <runtime/opcode.h>
+#include <runtime/signature.h>
+
+/* Resolves the target of a call instruction: returns the method with the given ID (which is embedded into low-level
+   bytecode as is) and its signature. Returns HM_ERROR_NOT_FOUND if there's no such method. */
+typedef hmError (*hmResolveCallTargetFunc)(
+    hm_metadata_id method_id,
+    void*          user_data,
+    hmMethod**     out_method,
+    hmSignature**  out_signature
+);
+
+/* What the verifier knows about an instruction. Control flow is linear, so together with the signature and the types of
+   locals, it determines the type of every value on the stack at every instruction. */
+typedef struct {
+    hm_method_size offset;           /* The offset of the instruction in high-level bytecode. */
+    hm_uint16      stack_depth;      /* The depth of the stack before the instruction. */
+    hm_uint16      popped_count;     /* How many values the instruction pops off the stack (including call arguments). */
+    hmValueType    pushed_type;      /* The type of the value pushed by the instruction, if any (HM_VALUE_TYPE_VOID otherwise). */
+    hmHLOpcode     opcode;
+    hm_uint64      operand;          /* The decoded operand, if any (0 otherwise). */
+    hmMethod*      call_target_opt;  /* Resolved targets of calls (HM_NULL for other instructions). */
+} hmVerifiedInstruction;
+
+typedef struct {
+    hmArray      instructions;    /* hmArray<hmVerifiedInstruction> In the order of bytecode. */
+    hmArray      local_types;     /* hmArray<hmValueType> Locals are typed by their first store; later stores must agree. */
+    hmSignature* signature;
+    hm_uint16    max_stack_depth;
+} hmVerifiedMethodBody;
+
+/* Verifies that high-level bytecode is well-formed and type-safe, simulating the evaluation stack instruction by
+   instruction: operands are in bounds, the stack never underflows, locals are stored before they're loaded, arguments and
+   locals are used with consistent types, calls match the signatures of their targets (resolved with
+   `resolve_call_target_func`), and the body leaves exactly the return value on the stack.
+   Returns HM_ERROR_INVALID_DATA if the bytecode fails verification. The result is what hmLowerMethodBody(..) uses
+   to produce low-level bytecode (see runtime/lowering.h). `signature` must outlive the result. */
+hmError hmVerifyMethodBody(
+    hmAllocator*            allocator,
+    hmMethodBody*           hl_body,
+    hmSignature*            signature,
+    hmResolveCallTargetFunc resolve_call_target_func,
+    void*                   user_data,
+    hmVerifiedMethodBody*   in_verified_body
+);
+hmError hmVerifiedMethodBodyDispose(hmVerifiedMethodBody* verified_body);
+#define hmVerifiedMethodBodyGetLocalCount(verified_body) hmArrayGetCount(&(verified_body)->local_types)
+
+#endif /* HM_VERIFIER_H */
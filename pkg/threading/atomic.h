@@ -20,11 +20,24 @@
 
 typedef atomic_size_t hm_atomic_nint;
 typedef atomic_bool hm_atomic_bool;
+/* Declares an atomic object of an arbitrary type, for example, a pointer which is published to other threads. */
+#define HM_ATOMIC(type) _Atomic(type)
 
 /* Atomically stores `value` at the given memory pointer `object`. */
 #define hmAtomicStore(object, value) atomic_store_explicit(object, value, memory_order_relaxed)
 /* Atomically loads (reads) at the given memory pointer `object` and returns it. */
 #define hmAtomicLoad(object) atomic_load_explicit(object, memory_order_relaxed)
+/* Same as hmAtomicStore(..), except that all writes made by the current thread before the store become visible to
+   the threads which read the stored value with hmAtomicLoadAcquire(..) Used to publish objects to other threads. */
+#define hmAtomicStoreRelease(object, value) atomic_store_explicit(object, value, memory_order_release)
+/* Same as hmAtomicLoad(..), except that the writes made before the loaded value was stored with hmAtomicStoreRelease(..)
+   (or hmAtomicCompareExchange(..)) are guaranteed to be visible to the current thread. */
+#define hmAtomicLoadAcquire(object) atomic_load_explicit(object, memory_order_acquire)
+/* Atomically replaces the value with `desired` if it equals to the value pointed to by `expected`, with the same
+   guarantees as hmAtomicStoreRelease(..)/hmAtomicLoadAcquire(..) Returns false if the values are different, in which case
+   the current value is loaded to `expected`. */
+#define hmAtomicCompareExchange(object, expected, desired) \
+    atomic_compare_exchange_strong_explicit(object, expected, desired, memory_order_acq_rel, memory_order_acquire)
 /* Atomically increments the value and returns the new value. */
 #define hmAtomicIncrement(object) (atomic_fetch_add_explicit(object, 1, memory_order_relaxed) + 1)
 /* Atomically decrements the value and returns the new value. */
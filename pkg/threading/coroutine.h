@@ -0,0 +1,70 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_COROUTINE_H
+#define HM_COROUTINE_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+
+#define HM_COROUTINE_MIN_STACK_SIZE     (16*1024)       /* see hmCreateCoroutine(..) */
+#define HM_COROUTINE_MAX_STACK_SIZE     (64*1024*1024)  /* see hmCreateCoroutine(..) */
+#define HM_COROUTINE_DEFAULT_STACK_SIZE (256*1024)      /* Enough for typical request handlers. */
+
+typedef hm_nint hmCoroutineState;
+#define HM_COROUTINE_STATE_SUSPENDED ((hmCoroutineState)0) /* Not started yet, or yielded. */
+#define HM_COROUTINE_STATE_RUNNING   ((hmCoroutineState)1)
+#define HM_COROUTINE_STATE_FINISHED  ((hmCoroutineState)2)
+
+typedef hmError (*hmCoroutineFunc)(void* user_data);
+
+typedef struct {
+    void* platform_data; /* Platform-specific data are hidden from header files. Also a pointer guards against moves/copies,
+                            because a suspended coroutine's stack can point back to it. */
+} hmCoroutine;
+
+/* A coroutine (a "green thread") is a function with its own stack which can suspend itself in the middle of execution
+   with hmCoroutineYield(..) and later continue from the same point when resumed with hmCoroutineResume(..), all on
+   the same OS thread. Switching between coroutines costs about as much as a function call, so a handful of threads can
+   run a very large number of coroutines (see also hmScheduler).
+   `stack_size` must be in the range between HM_COROUTINE_MIN_STACK_SIZE and HM_COROUTINE_MAX_STACK_SIZE (otherwise,
+    HM_ERROR_INVALID_ARGUMENT is returned); the value can be set to HM_COROUTINE_DEFAULT_STACK_SIZE. The stack is only
+    reserved: physical memory is committed page by page as the stack grows, so a coroutine which uses little stack costs
+    little memory regardless of `stack_size`. A stack overflow hits a guard page and crashes the process instead of
+    silently corrupting memory.
+   `coroutine_func` is the coroutine's entrypoint function which will be called on the first hmCoroutineResume(..)
+   Returns HM_ERROR_NOT_IMPLEMENTED on CPU architectures which don't support coroutines yet (only x86-64 is supported). */
+hmError hmCreateCoroutine(
+    hmAllocator*    allocator,
+    hm_nint         stack_size,
+    hmCoroutineFunc coroutine_func,
+    void*           user_data,
+    hmCoroutine*    in_coroutine
+);
+/* Returns HM_ERROR_INVALID_STATE if the coroutine is currently running. A coroutine can be disposed of while it's
+   suspended in the middle of execution, but then anything it allocated and hasn't freed yet is leaked. */
+hmError hmCoroutineDispose(hmCoroutine* coroutine);
+/* Switches the current thread to the coroutine: it runs until it calls hmCoroutineYield(..) or its function returns,
+   after which hmCoroutineResume(..) returns. Returns HM_ERROR_INVALID_STATE if the coroutine is already running or has
+   finished. Must not be called from inside a coroutine: coroutines are not nested, they always yield back to the thread
+   which resumed them. */
+hmError hmCoroutineResume(hmCoroutine* coroutine);
+/* Suspends the coroutine and returns control to the caller of hmCoroutineResume(..) Must be called from inside the
+   coroutine itself (there's no implicit "current coroutine", so the coroutine function usually receives the coroutine
+   via `user_data`). Returns HM_ERROR_INVALID_STATE if the coroutine isn't running. */
+hmError hmCoroutineYield(hmCoroutine* coroutine);
+hmCoroutineState hmCoroutineGetState(hmCoroutine* coroutine);
+/* Returns the error as returned by hmCoroutineFunc when the coroutine finishes. Returns HM_OK if the coroutine hasn't finished yet. */
+hmError hmCoroutineGetExitError(hmCoroutine* coroutine);
+
+#endif /* HM_COROUTINE_H */
@@ -0,0 +1,83 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_SCHEDULER_H
+#define HM_SCHEDULER_H
+
+#include <core/common.h>
+#include <core/allocator.h>
+#include <threading/coroutine.h>
+
+#define HM_SCHEDULER_MAX_TIMEOUT_MS    (60*60*1000)  /* 1 hour must be more than enough; see hmSchedulerRun(..) */
+#define HM_SCHEDULER_INFINITE_TIMEOUT  ((hm_millis)-1) /* see hmSchedulerRun(..) */
+
+typedef struct {
+    void* platform_data; /* Platform-specific data are hidden from header files. Also a pointer guards against moves/copies,
+                            because coroutines point back to it. */
+} hmScheduler;
+
+/* A scheduler multiplexes many coroutines (see hmCreateCoroutine(..)) onto the thread which calls hmSchedulerRun(..)
+   Coroutines which would otherwise block the thread on I/O are parked on the scheduler's event loop with
+   hmSchedulerWaitForHandle(..) and are resumed only once the handle becomes ready, so the thread keeps running other
+   coroutines in the meantime. Sockets do this automatically once they're bound to the scheduler (see
+   hmSocketSetScheduler(..)). Except for hmSchedulerWakeUp(..), a scheduler must only be used on one thread; coroutines
+   never migrate between threads. There's no implicit "current scheduler": coroutines which need it (to yield, to park,
+   etc.) receive it explicitly, usually via `user_data`.
+   `stack_size` is the stack size of every coroutine (see hmCreateCoroutine(..)) */
+hmError hmCreateScheduler(hmAllocator* allocator, hm_nint stack_size, hmScheduler* in_scheduler);
+/* Coroutines which haven't finished yet are disposed of together with the scheduler (see hmCoroutineDispose(..)), and
+   their user data is disposed of as well. Returns HM_ERROR_INVALID_STATE if called from inside a coroutine of the
+   scheduler. */
+hmError hmSchedulerDispose(hmScheduler* scheduler);
+/* Creates a new coroutine which will start running on the next call to hmSchedulerRun(..) Can be called from inside a
+   coroutine of the same scheduler.
+   `user_data_dispose_func_opt` specifies how `user_data` is disposed of when the coroutine finishes, or when the scheduler
+   is disposed of before the coroutine finishes. Can be HM_NULL. On error, `user_data` stays owned by the caller. */
+hmError hmSchedulerSpawn(
+    hmScheduler*    scheduler,
+    hmCoroutineFunc coroutine_func,
+    void*           user_data,
+    hmDisposeFunc   user_data_dispose_func_opt
+);
+/* Runs every coroutine which is ready to run until it yields, parks or finishes, then collects the coroutines whose
+   handles became ready (see hmSchedulerWaitForHandle(..)) so that they run on the next call. If no coroutine was ready
+   to run, blocks the current thread until a handle becomes ready, a coroutine's wait times out, hmSchedulerWakeUp(..) is
+   called, or `timeout_ms` elapses.
+   `timeout_ms` can be 0 (never blocks), up to HM_SCHEDULER_MAX_TIMEOUT_MS, or HM_SCHEDULER_INFINITE_TIMEOUT
+   (otherwise, HM_ERROR_INVALID_ARGUMENT is returned).
+   If a coroutine finishes with an error, the error is returned (the rest of the ready coroutines run on the next call).
+   Returns HM_ERROR_INVALID_STATE if called from inside a coroutine of the scheduler; must not be called from inside a
+   coroutine of another scheduler either (see hmCoroutineResume(..)) */
+hmError hmSchedulerRun(hmScheduler* scheduler, hm_millis timeout_ms);
+/* Makes a blocked hmSchedulerRun(..) return as soon as possible. If hmSchedulerRun(..) isn't blocked at the moment, the
+   next call returns immediately. Unlike other functions, it's thread-safe: useful to tell the scheduler's thread that
+   there's new work to spawn. */
+hmError hmSchedulerWakeUp(hmScheduler* scheduler);
+/* Returns the number of coroutines which haven't finished yet. */
+hm_nint hmSchedulerGetCoroutineCount(hmScheduler* scheduler);
+/* Suspends the coroutine which the scheduler is currently running, so that other coroutines could run; it will continue
+   on the next call to hmSchedulerRun(..) Must be called from inside that coroutine. Returns HM_ERROR_INVALID_STATE if
+   the scheduler isn't running a coroutine at the moment. */
+hmError hmSchedulerYield(hmScheduler* scheduler);
+/* Parks the coroutine which the scheduler is currently running until the operating system's handle (for example, a
+   socket, see hmSocketGetNativeHandle(..)) is ready for reading (`is_write` is HM_FALSE) or writing (`is_write` is
+   HM_TRUE), or is closed by the other side. Must be called from inside that coroutine. The same handle can't be waited
+   for by two coroutines at the same time. Returns HM_ERROR_INVALID_STATE if the scheduler isn't running a coroutine
+   at the moment.
+   `timeout_ms` can be up to HM_SCHEDULER_MAX_TIMEOUT_MS, or HM_SCHEDULER_INFINITE_TIMEOUT (otherwise,
+   HM_ERROR_INVALID_ARGUMENT is returned). If the handle doesn't become ready in time, the coroutine is resumed anyway and
+   HM_ERROR_TIMEOUT is returned. Deadlines are kept in a timer wheel with millisecond ticks, so a lot of parked
+   coroutines don't make hmSchedulerRun(..) slower. */
+hmError hmSchedulerWaitForHandle(hmScheduler* scheduler, hm_nint handle, hm_bool is_write, hm_millis timeout_ms);
+
+#endif /* HM_SCHEDULER_H */
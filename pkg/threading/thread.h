@@ -22,6 +22,7 @@
 #define HM_SLEEP_MAX_MS (60*60*1000)                  /* 1 hour must be more than enough; see hmSleep(..) */
 #define HM_THREAD_JOIN_MIN_TIMEOUT_MS HM_SLEEP_MIN_MS /* see hmThreadJoin(..) */
 #define HM_THREAD_JOIN_MAX_TIMEOUT_MS HM_SLEEP_MAX_MS /* see hmThreadJoin(..) */
+#define HM_THREAD_OS_NAME_MAX_LENGTH 15               /* see hmCreateThread(..) */
 
 typedef hm_atomic_nint hmThreadState;
 #define HM_THREAD_STATE_UNSTARTED       ((hmThreadState)0)
@@ -39,7 +40,8 @@ typedef struct {
 
 /* Creates and starts a new thread. The allocator must be thread-safe, as it will allocate/deallocate on different threads.
    `name` is the name of the thread, for debugging purposes. The string will be duplicated because we must ensure it's allocated
-   using a thread-safe allocator; can be HM_NULL.
+   using a thread-safe allocator; can be HM_NULL. The name is also reported to the OS so that it shows up in debuggers and
+   profilers, although the OS may truncate it (on Linux, to HM_THREAD_OS_NAME_MAX_LENGTH bytes).
    `thread_func` is the thread's entrypoint function which will be called once the thread starts. */
 hmError hmCreateThread(
     hmAllocator*      allocator,
@@ -48,6 +50,20 @@ hmError hmCreateThread(
     void*             user_data,
     hmThread*         in_thread
 );
+/* Same as hmCreateThread(..), except the thread is pinned to the given set of processors before it starts (see
+   hmThreadSetAffinity(..)), so it never runs anywhere else, and on NUMA systems, the memory it touches first (such as its
+   stack) is placed on the node of those processors by the OS. If `processor_indices_opt` is HM_NULL, the thread isn't
+   pinned. Returns HM_ERROR_INVALID_ARGUMENT if `processor_indices_opt` is given with a zero `processor_count`, or an index
+   is out of the range supported by the OS. */
+hmError hmCreateThreadWithAffinity(
+    hmAllocator*      allocator,
+    hmString*         name_opt,
+    const hm_nint*    processor_indices_opt,
+    hm_nint           processor_count,
+    hmThreadStartFunc thread_func,
+    void*             user_data,
+    hmThread*         in_thread
+);
 /* Disposes of a thread. If the thread is still running, the thread will be automatically disposed when it finishes. */
 hmError hmThreadDispose(hmThread* thread);
 /* Requests the thread to be aborted gracefully (cooperatively).
@@ -65,6 +81,12 @@ hmThreadState hmThreadGetState(hmThread* thread);
 /* Returns the name of the thread, for debugging purposes. The value should be disposed with hmStringDispose(..) --
    it's duplicated because a thread's lifetime is not predictable, it can get disposed while we access the name value. */
 hmError hmThreadGetName(hmThread* thread, hmString* in_string);
+/* Pins the thread to the given set of processors: from now on, the OS will only schedule the thread on them.
+   `processor_indices` are indices of processors as understood by the OS (see hmGetAvailableProcessors(..)); returns
+   HM_ERROR_INVALID_ARGUMENT if `processor_count` is 0 or an index is out of the range supported by the OS.
+   Note that the thread may have already run for a while on other processors by the time the function returns (see
+   hmCreateThreadWithAffinity(..) to avoid that). */
+hmError hmThreadSetAffinity(hmThread* thread, const hm_nint* processor_indices, hm_nint processor_count);
 /* Returns the total CPU time for this thread. Useful for debugging CPU load. */
 hm_millis hmThreadGetProcessorTime(hmThread* thread);
 /* Returns the error as returned by hmThreadStartFunc when the thread finishes. Returns HM_OK if the thread hasn't finished yet. */
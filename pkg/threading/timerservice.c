@@ -0,0 +1,195 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#include <threading/timerservice.h>
+#include <core/environment.h>
+#include <core/math.h>
+#include <threading/atomic.h>
+#include <threading/mutex.h>
+#include <threading/thread.h>
+#include <threading/waitableevent.h>
+
+typedef struct hmTimerServiceData_ {
+    hmAllocator*    allocator;
+    hmWorkerPool*   worker_pool;
+    hmTimerWheel    timer_wheel;    /* Ticks of the timer wheel are `resolution_ms` long and start at `start_time`. */
+    hm_uint64       wake_up_tick;   /* The tick the thread sleeps until; HM_UINT64_MAX if there are no timers. */
+    hm_atomic_nint  dropped_count;  /* Work items which couldn't be enqueued, see hmTimerServiceGetDroppedCount(..) */
+    hmMutex         mutex;          /* Guards `timer_wheel` and `wake_up_tick`. */
+    hmWaitableEvent waitable_event; /* Signaled when a timer is scheduled earlier than `wake_up_tick`, or when the service
+                                       is disposed of. */
+    hmThread        thread;
+    hm_millis       resolution_ms;
+    hm_millis       start_time;
+} hmTimerServiceData;
+
+static hmError hmTimerServiceThreadFunc(void* user_data);
+static hm_millis hmTimerServiceGetWaitTimeout(hmTimerServiceData* data, hm_uint64 current_tick, hm_uint64 wake_up_tick);
+
+hmError hmCreateTimerService(
+    hmAllocator*    allocator,
+    hmWorkerPool*   worker_pool,
+    hm_nint         item_size,
+    hmDisposeFunc   item_dispose_func_opt,
+    hm_millis       resolution_ms,
+    hmTimerService* in_timer_service
+)
+{
+    if (!resolution_ms || resolution_ms > HM_TIMER_SERVICE_MAX_RESOLUTION_MS) {
+        return HM_ERROR_INVALID_ARGUMENT;
+    }
+    hmTimerServiceData* data = (hmTimerServiceData*)hmAlloc(allocator, sizeof(hmTimerServiceData));
+    if (!data) {
+        return HM_ERROR_OUT_OF_MEMORY;
+    }
+    hm_bool timer_wheel_initialized    = HM_FALSE,
+            mutex_initialized          = HM_FALSE,
+            waitable_event_initialized = HM_FALSE;
+    hmError err = HM_OK;
+    HM_TRY_OR_FINALIZE(err, hmCreateTimerWheel(allocator, item_size, item_dispose_func_opt, &data->timer_wheel));
+    timer_wheel_initialized = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateMutex(allocator, &data->mutex));
+    mutex_initialized = HM_TRUE;
+    HM_TRY_OR_FINALIZE(err, hmCreateWaitableEvent(allocator, &data->waitable_event));
+    waitable_event_initialized = HM_TRUE;
+    data->allocator = allocator;
+    data->worker_pool = worker_pool;
+    data->resolution_ms = resolution_ms;
+    data->start_time = hmGetTickCount();
+    data->wake_up_tick = HM_UINT64_MAX;
+    hmAtomicStore(&data->dropped_count, 0);
+    HM_TRY_OR_FINALIZE(err, hmCreateThread(allocator, HM_NULL, &hmTimerServiceThreadFunc, data, &data->thread));
+    in_timer_service->data = data;
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        if (waitable_event_initialized) {
+            err = hmMergeErrors(err, hmWaitableEventDispose(&data->waitable_event));
+        }
+        if (mutex_initialized) {
+            err = hmMergeErrors(err, hmMutexDispose(&data->mutex));
+        }
+        if (timer_wheel_initialized) {
+            err = hmMergeErrors(err, hmTimerWheelDispose(&data->timer_wheel));
+        }
+        hmFree(allocator, data);
+    }
+    return err;
+}
+
+hmError hmTimerServiceDispose(hmTimerService* timer_service, hm_millis timeout_ms)
+{
+    hmTimerServiceData* data = timer_service->data;
+    HM_TRY(hmThreadAbort(&data->thread));
+    HM_TRY(hmWaitableEventSignal(&data->waitable_event)); /* Wakes up the thread to make it abort without waiting for the timeout. */
+    HM_TRY(hmThreadJoin(&data->thread, timeout_ms));
+    hmError err = hmThreadDispose(&data->thread);
+    err = hmMergeErrors(err, hmWaitableEventDispose(&data->waitable_event));
+    err = hmMergeErrors(err, hmMutexDispose(&data->mutex));
+    err = hmMergeErrors(err, hmTimerWheelDispose(&data->timer_wheel));
+    hmFree(data->allocator, data);
+    return err;
+}
+
+hmError hmScheduleAfter(hmTimerService* timer_service, hm_millis delay_ms, void* in_work_item, hmTimer* out_timer_opt)
+{
+    hm_millis tick_count;
+    HM_TRY(hmAddMillis(hmGetTickCount(), delay_ms, &tick_count));
+    return hmScheduleAt(timer_service, tick_count, in_work_item, out_timer_opt);
+}
+
+hmError hmScheduleAt(hmTimerService* timer_service, hm_millis tick_count, void* in_work_item, hmTimer* out_timer_opt)
+{
+    hmTimerServiceData* data = timer_service->data;
+    HM_TRY(hmThreadGetExitError(&data->thread)); /* The timer would never fire. */
+    /* Rounded up, so that timers never fire early. */
+    hm_uint64 expiry_tick = 0;
+    if (tick_count > data->start_time) {
+        expiry_tick = (tick_count - data->start_time) / data->resolution_ms;
+        expiry_tick += (tick_count - data->start_time) % data->resolution_ms ? 1 : 0;
+    }
+    HM_TRY(hmMutexLock(&data->mutex));
+    /* The thread sleeps until the earliest timer is due (or indefinitely while there are no timers), so it must be told
+       that there's an earlier one now. */
+    hm_bool should_wake_up = expiry_tick < data->wake_up_tick;
+    hmError err = hmTimerWheelAdd(&data->timer_wheel, expiry_tick, in_work_item, out_timer_opt);
+    HM_TRY(hmMergeErrors(err, hmMutexUnlock(&data->mutex)));
+    return should_wake_up ? hmWaitableEventSignal(&data->waitable_event) : HM_OK;
+}
+
+hmError hmTimerServiceCancel(hmTimerService* timer_service, hmTimer* timer)
+{
+    hmTimerServiceData* data = timer_service->data;
+    HM_TRY(hmMutexLock(&data->mutex));
+    hmError err = hmTimerWheelCancel(&data->timer_wheel, timer);
+    return hmMergeErrors(err, hmMutexUnlock(&data->mutex));
+}
+
+hmError hmTimerServiceGetExitError(hmTimerService* timer_service)
+{
+    return hmThreadGetExitError(&timer_service->data->thread);
+}
+
+hm_nint hmTimerServiceGetDroppedCount(hmTimerService* timer_service)
+{
+    return hmAtomicLoad(&timer_service->data->dropped_count);
+}
+
+static hmError hmTimerServiceExpireFunc(void* item, void* user_data)
+{
+    hmTimerServiceData* data = (hmTimerServiceData*)user_data;
+    hmError err = hmWorkerPoolEnqueueItem(data->worker_pool, item);
+    if (err != HM_OK) {
+        (void)hmAtomicIncrement(&data->dropped_count); /* The timer wheel disposes of the item. */
+    }
+    return err;
+}
+
+static hmError hmTimerServiceThreadFunc(void* user_data)
+{
+    hmTimerServiceData* data = (hmTimerServiceData*)user_data;
+    while (hmThreadGetState(&data->thread) != HM_THREAD_STATE_ABORT_REQUESTED) {
+        hm_uint64 current_tick = (hmGetTickCount() - data->start_time) / data->resolution_ms;
+        HM_TRY(hmMutexLock(&data->mutex));
+        /* Errors of expired timers concern their work items only (which are disposed of and counted as dropped, see
+           hmTimerServiceExpireFunc(..)): a full worker queue must not stop all the other timers from firing. */
+        hmTimerWheelAdvance(&data->timer_wheel, current_tick, &hmTimerServiceExpireFunc, data);
+        hm_uint64 wake_up_tick = HM_UINT64_MAX;
+        hmError err = hmTimerWheelGetNextExpiry(&data->timer_wheel, &wake_up_tick);
+        if (err == HM_ERROR_NOT_FOUND) {
+            err = HM_OK;
+        }
+        data->wake_up_tick = wake_up_tick;
+        HM_TRY(hmMergeErrors(err, hmMutexUnlock(&data->mutex)));
+        /* A timer which is cancelled in the meantime merely wakes the thread up for nothing. */
+        err = hmWaitableEventWait(&data->waitable_event, hmTimerServiceGetWaitTimeout(data, current_tick, wake_up_tick));
+        if (err != HM_ERROR_TIMEOUT) {
+            HM_TRY(err);
+        }
+    }
+    return HM_OK;
+}
+
+/* How long to wait until `wake_up_tick` (which is always after `current_tick`) starts. */
+static hm_millis hmTimerServiceGetWaitTimeout(hmTimerServiceData* data, hm_uint64 current_tick, hm_uint64 wake_up_tick)
+{
+    if (wake_up_tick == HM_UINT64_MAX) {
+        return HM_WAITABLE_EVENT_INFINITE_TIMEOUT;
+    }
+    /* Far timers are rechecked every once in a while. */
+    if (wake_up_tick - current_tick > HM_WAITABLE_EVENT_MAX_TIMEOUT_MS / data->resolution_ms) {
+        return HM_WAITABLE_EVENT_MAX_TIMEOUT_MS;
+    }
+    hm_millis wake_up_time = data->start_time + (hm_millis)wake_up_tick * data->resolution_ms;
+    hm_millis now = hmGetTickCount();
+    return wake_up_time > now ? wake_up_time - now : HM_WAITABLE_EVENT_MIN_TIMEOUT_MS;
+}
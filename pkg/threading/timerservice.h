@@ -0,0 +1,71 @@
+/* *****************************************************************************
+*
+*   Copyright (c) Konstantin Geist. All rights reserved.
+*
+*   The use and distribution terms for this software are contained in the file
+*   named License.txt, which can be found in the root of this distribution.
+*   By using this software in any fashion, you are agreeing to be bound by the
+*   terms of this license.
+*
+*   You must not remove this notice, or any other, from this software.
+*
+* ******************************************************************************/
+
+#ifndef HM_TIMER_SERVICE_H
+#define HM_TIMER_SERVICE_H
+
+#include <core/common.h>
+#include <collections/timerwheel.h>
+#include <threading/workerpool.h>
+
+#define HM_TIMER_SERVICE_DEFAULT_RESOLUTION_MS 10     /* see hmCreateTimerService(..) */
+#define HM_TIMER_SERVICE_MAX_RESOLUTION_MS     1000   /* see hmCreateTimerService(..) */
+
+typedef struct {
+    struct hmTimerServiceData_* data;
+} hmTimerService;
+
+/* A timer service runs a timer wheel (see hmCreateTimerWheel(..)) on a dedicated thread and posts the work items of
+   expired timers to a worker pool (see hmWorkerPoolEnqueueItem(..)), so timeouts, retries and delayed work of any
+   kind can share one mechanism which costs almost nothing per timer. The thread sleeps until the earliest timer is due
+   (see hmTimerWheelGetNextExpiry(..)), and while no timers are scheduled, it doesn't wake up at all.
+   The allocator should be thread-safe, as it will allocate/deallocate on different threads.
+   `worker_pool` must outlive the timer service. If a work item can't be enqueued (for example, a bounded queue is full),
+    it's disposed of and counted as dropped (see hmTimerServiceGetDroppedCount(..)); the timer service keeps running.
+   `item_size` is the size of the worker pool's work items; see also HM_TIMER_WHEEL_MAX_ITEM_SIZE.
+   `item_dispose_func_opt` specifies how work items of cancelled timers (or timers which haven't fired before the
+    timer service is disposed of) are disposed of. Should match the worker pool's. Can be HM_NULL.
+   `resolution_ms` specifies the granularity of timers: a timer fires within `resolution_ms` milliseconds after it's due
+    (never before). Can be set to HM_TIMER_SERVICE_DEFAULT_RESOLUTION_MS. Returns HM_ERROR_INVALID_ARGUMENT if it's zero or
+    bigger than HM_TIMER_SERVICE_MAX_RESOLUTION_MS. */
+hmError hmCreateTimerService(
+    hmAllocator*    allocator,
+    hmWorkerPool*   worker_pool,
+    hm_nint         item_size,
+    hmDisposeFunc   item_dispose_func_opt,
+    hm_millis       resolution_ms,
+    hmTimerService* in_timer_service
+);
+/* Stops the timer service's thread, waiting up to `timeout_ms` milliseconds (see hmThreadJoin(..)) for it, and disposes of
+   the work items of timers which haven't fired. Returns HM_ERROR_TIMEOUT if the thread didn't stop in time (the timer
+   service isn't disposed of in that case). */
+hmError hmTimerServiceDispose(hmTimerService* timer_service, hm_millis timeout_ms);
+/* Schedules `in_work_item` to be enqueued to the worker pool after `delay_ms` milliseconds. The item's value is moved
+   inside the timer service. `out_timer_opt` receives a handle which can be used to cancel the timer (see
+   hmTimerServiceCancel(..)); can be HM_NULL. Thread-safe. */
+hmError hmScheduleAfter(hmTimerService* timer_service, hm_millis delay_ms, void* in_work_item, hmTimer* out_timer_opt);
+/* Same as hmScheduleAfter(..), except the time is specified as a point in time in terms of hmGetTickCount(..)
+   If the point in time is in the past, the timer fires as soon as possible. If the timer service's thread has stopped
+   because of an error, returns that error (see hmTimerServiceGetExitError(..)): the timer would never fire. */
+hmError hmScheduleAt(hmTimerService* timer_service, hm_millis tick_count, void* in_work_item, hmTimer* out_timer_opt);
+/* Cancels a timer and disposes of its work item. Returns HM_ERROR_NOT_FOUND if the timer has already fired (its work item
+   is already in the worker pool) or has already been cancelled. Thread-safe. */
+hmError hmTimerServiceCancel(hmTimerService* timer_service, hmTimer* timer);
+/* Returns the error which stopped the timer service's thread, or HM_OK if it's running. The thread only stops on errors
+   of the timer service itself (for example, if its mutex fails), not of individual timers. */
+hmError hmTimerServiceGetExitError(hmTimerService* timer_service);
+/* Returns how many work items of expired timers couldn't be enqueued to the worker pool and were disposed of instead.
+   For diagnostics and tests. Thread-safe. */
+hm_nint hmTimerServiceGetDroppedCount(hmTimerService* timer_service);
+
+#endif /* HM_TIMER_SERVICE_H */
@@ -19,6 +19,7 @@
 
 #define HM_WAITABLE_EVENT_MIN_TIMEOUT_MS 1            /* see hmWaitableEventWait(..) */
 #define HM_WAITABLE_EVENT_MAX_TIMEOUT_MS (60*60*1000) /* 1 hour must be more than enough; see hmWaitableEventWait(..) */
+#define HM_WAITABLE_EVENT_INFINITE_TIMEOUT ((hm_millis)-1) /* see hmWaitableEventWait(..) */
 
 typedef struct {
     hmAllocator* allocator;
@@ -34,7 +35,9 @@ hmError hmWaitableEventDispose(hmWaitableEvent* waitable_event);
    (in milliseconds) elapses.
    Returns HM_OK if the current thread was woken up via Signal(); returns HM_ERROR_TIMEOUT if the timeout expired.
    `timeout_ms` is restricted to the range from HM_WAITABLE_EVENT_MIN_TIMEOUT_MS to HM_WAITABLE_EVENT_MAX_TIMEOUT_MS (otherwise,
-   HM_ERROR_INVALID_ARGUMENT is returned). This way, we don't have to deal with corner cases (zero or infinite timeouts).
+   HM_ERROR_INVALID_ARGUMENT is returned). This way, we don't have to deal with corner cases (zero timeouts or overflows).
+   The only exception is HM_WAITABLE_EVENT_INFINITE_TIMEOUT which waits until the event is signaled, without ever timing out.
+   Timeouts are measured with a monotonic clock, so they aren't affected by changes of the system time.
  */
 hmError hmWaitableEventWait(hmWaitableEvent* waitable_event, hm_millis timeout_ms);
 /* Allows one waiting thread to proceed. Only one thread at a time is guaranteed to proceed.
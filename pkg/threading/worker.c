@@ -17,38 +17,48 @@
 #include <core/utils.h>
 #include <collections/queue.h>
 #include <threading/mutex.h>
+#include <threading/scheduler.h>
 #include <threading/thread.h>
 #include <threading/waitableevent.h>
 
-/* A reasonable timeout just in case something is wrong with our WaitableEvent implementation and the whole thing hangs --
-   if we want to stop the worker, it will eventually reactivate and stop in any case. */
-#define HM_WORKER_THREAD_WAIT_TIMEOUT_MS 4000
-
 typedef struct hmWorkerData_ {
     hmAllocator*    allocator;
     hmThread        thread;
     hmQueue         queue;
-    hmWaitableEvent waitable_event;
+    hmWaitableEvent waitable_event; /* Only if the worker isn't coroutine-based. */
+    hmScheduler     scheduler;      /* Only if the worker is coroutine-based (replaces `waitable_event`). */
+    hm_bool         is_coroutine_based;
     hmMutex         queue_mutex;
     hmDisposeFunc   item_dispose_func_opt;
     hmWorkerFunc    worker_func;
     hm_nint         item_size;
+    hm_bool         is_parked;      /* Protected by `queue_mutex`: producers wake up the worker only if it's parked; see hmWorkerTryPark(..) */
 volatile
     hm_atomic_bool should_drain_queue;
     hm_bool        is_draining_queue;
 } hmWorkerData;
 
+/* A work item of a coroutine-based worker: the item is copied out of the queue so that it lives as long as its coroutine. */
+typedef struct {
+    hmWorkerData* data;
+    char          item[];
+} hmWorkerCoroutineItem;
+
 static hmError hmWorkerThreadFunc(void* user_data);
+static hmError hmWorkerWakeUp(hmWorkerData* data);
 
 hmError hmCreateWorker(
-    hmAllocator*  allocator,
-    hmString*     name_opt,
-    hmWorkerFunc  worker_func,
-    hm_nint       item_size,
-    hmDisposeFunc item_dispose_func_opt,
-    hm_bool       is_queue_bounded,
-    hm_nint       queue_capacity,
-    hmWorker*     in_worker
+    hmAllocator*   allocator,
+    hmString*      name_opt,
+    hmWorkerFunc   worker_func,
+    hm_nint        item_size,
+    hmDisposeFunc  item_dispose_func_opt,
+    hm_bool        is_queue_bounded,
+    hm_nint        queue_capacity,
+    hm_nint        coroutine_stack_size,
+    const hm_nint* processor_indices_opt,
+    hm_nint        processor_count,
+    hmWorker*      in_worker
 )
 {
     if (item_size > HM_WORKER_MAX_ITEM_SIZE) {
@@ -60,6 +70,7 @@ hmError hmCreateWorker(
     }
     hm_bool queue_initialized          = HM_FALSE,
             waitable_event_initialized = HM_FALSE,
+            scheduler_initialized      = HM_FALSE,
             mutex_initialized          = HM_FALSE;
     hmError err = HM_OK;
     HM_TRY_OR_FINALIZE(err, hmCreateQueue(
@@ -71,17 +82,33 @@ hmError hmCreateWorker(
         &data->queue
     ));
     queue_initialized = HM_TRUE;
-    HM_TRY_OR_FINALIZE(err, hmCreateWaitableEvent(allocator, &data->waitable_event));
-    waitable_event_initialized = HM_TRUE;
+    data->is_coroutine_based = coroutine_stack_size != HM_WORKER_NO_COROUTINES;
+    if (data->is_coroutine_based) {
+        HM_TRY_OR_FINALIZE(err, hmCreateScheduler(allocator, coroutine_stack_size, &data->scheduler));
+        scheduler_initialized = HM_TRUE;
+    } else {
+        HM_TRY_OR_FINALIZE(err, hmCreateWaitableEvent(allocator, &data->waitable_event));
+        waitable_event_initialized = HM_TRUE;
+    }
     HM_TRY_OR_FINALIZE(err, hmCreateMutex(allocator, &data->queue_mutex));
     mutex_initialized = HM_TRUE;
-    HM_TRY_OR_FINALIZE(err, hmCreateThread(allocator, name_opt, &hmWorkerThreadFunc, data, &data->thread));
+    /* The fields are initialized before the thread starts, because the thread starts using them right away. */
     data->allocator = allocator;
     data->item_dispose_func_opt = item_dispose_func_opt;
     data->worker_func = worker_func;
     data->item_size = item_size;
+    data->is_parked = HM_FALSE;
     hmAtomicStore(&data->should_drain_queue, HM_FALSE);
     data->is_draining_queue = HM_FALSE;
+    HM_TRY_OR_FINALIZE(err, hmCreateThreadWithAffinity(
+        allocator,
+        name_opt,
+        processor_indices_opt,
+        processor_count,
+        &hmWorkerThreadFunc,
+        data,
+        &data->thread
+    ));
     in_worker->data = data;
 HM_ON_FINALIZE
     if (err != HM_OK) {
@@ -91,6 +118,9 @@ HM_ON_FINALIZE
         if (waitable_event_initialized) {
             err = hmMergeErrors(err, hmWaitableEventDispose(&data->waitable_event));
         }
+        if (scheduler_initialized) {
+            err = hmMergeErrors(err, hmSchedulerDispose(&data->scheduler));
+        }
         if (queue_initialized) {
             err = hmMergeErrors(err, hmQueueDispose(&data->queue));
         }
@@ -107,7 +137,12 @@ hmError hmWorkerDispose(hmWorker* worker)
     }
     hmError err = hmThreadDispose(&data->thread);
     err = hmMergeErrors(err, hmMutexDispose(&data->queue_mutex));
-    err = hmMergeErrors(err, hmWaitableEventDispose(&data->waitable_event));
+    if (data->is_coroutine_based) {
+        /* Also disposes of the items which were abandoned in the middle of processing. */
+        err = hmMergeErrors(err, hmSchedulerDispose(&data->scheduler));
+    } else {
+        err = hmMergeErrors(err, hmWaitableEventDispose(&data->waitable_event));
+    }
     err = hmMergeErrors(err, hmQueueDispose(&data->queue));
     hmFree(data->allocator, data);
     return err;
@@ -123,7 +158,8 @@ hmError hmWorkerStop(hmWorker* worker, hm_bool should_drain_queue)
     hmWorkerData* data = worker->data;
     hmAtomicStore(&data->should_drain_queue, should_drain_queue);
     HM_TRY(hmThreadAbort(&data->thread));
-    return hmWaitableEventSignal(&data->waitable_event); /* Wakes up the worker to make it abort quicker (without waiting for the timeout). */
+    /* Unconditionally: the worker may be about to park. Waits have no timeout, so nothing else would wake the worker up. */
+    return hmWorkerWakeUp(data);
 }
 
 hmError hmWorkerWait(hmWorker* worker, hm_millis timeout_ms)
@@ -136,8 +172,14 @@ hmError hmWorkerEnqueueItem(hmWorker* worker, void* in_work_item)
     hmWorkerData* data = worker->data;
     HM_TRY(hmMutexLock(&data->queue_mutex));
     hmError err = hmQueueEnqueue(&data->queue, in_work_item);
+    /* A worker which isn't parked is going to see the new item before it parks again, so it doesn't need to be woken up.
+       Only the first producer after the worker parks pays for the wakeup. */
+    hm_bool should_wake_up = err == HM_OK && data->is_parked;
+    if (should_wake_up) {
+        data->is_parked = HM_FALSE;
+    }
     HM_TRY(hmMergeErrors(err, hmMutexUnlock(&data->queue_mutex)));
-    return hmWaitableEventSignal(&data->waitable_event);
+    return should_wake_up ? hmWorkerWakeUp(data) : HM_OK;
 }
 
 hmError hmWorkerGetName(hmWorker* worker, hmString* in_string)
@@ -172,10 +214,29 @@ static hm_bool hmWorkerShouldProcessQueue(hmWorkerData* data)
     return data->is_draining_queue || hmThreadGetState(&data->thread) != HM_THREAD_STATE_ABORT_REQUESTED;
 }
 
+static hmError hmWorkerWakeUp(hmWorkerData* data)
+{
+    return data->is_coroutine_based ? hmSchedulerWakeUp(&data->scheduler) : hmWaitableEventSignal(&data->waitable_event);
+}
+
+/* Parks the worker if its queue is empty, i.e. tells producers that the worker is about to block and must be woken up.
+   The check and the flag are updated under the same lock producers enqueue items under, so no item can slip in between.
+   A wakeup which arrives before the worker actually blocks isn't lost either, because both the waitable event and the
+   scheduler remember it. */
+static hmError hmWorkerTryPark(hmWorkerData* data, hm_bool* out_is_parked)
+{
+    HM_TRY(hmMutexLock(&data->queue_mutex));
+    data->is_parked = hmQueueIsEmpty(&data->queue);
+    *out_is_parked = data->is_parked;
+    return hmMutexUnlock(&data->queue_mutex);
+}
+
 static hmError hmWorkerWaitForNewItems(hmWorkerData* data)
 {
-    hmError err = hmWaitableEventWait(&data->waitable_event, HM_WORKER_THREAD_WAIT_TIMEOUT_MS);
-    return err == HM_ERROR_TIMEOUT ? HM_OK : err; /* It's OK if we time out here. */
+    hm_bool is_parked = HM_FALSE;
+    HM_TRY(hmWorkerTryPark(data, &is_parked));
+    /* No timeout: new items and hmWorkerStop(..) always wake up a parked worker, and an idle worker shouldn't wake up at all. */
+    return is_parked ? hmWaitableEventWait(&data->waitable_event, HM_WAITABLE_EVENT_INFINITE_TIMEOUT) : HM_OK;
 }
 
 static hmError hmWorkerProcessNewItems(hmWorkerData* data)
@@ -187,7 +248,7 @@ static hmError hmWorkerProcessNewItems(hmWorkerData* data)
        limited to HM_WORKER_MAX_ITEM_SIZE when using hmAllocOnStack(..) */
     void* work_item = hmAllocOnStack(hmAlignSize(data->item_size));
     while (hmWorkerShouldProcessQueue(data) && (err = hmWorkerDequeueWorkItem(data, work_item)) == HM_OK) {
-        err = data->worker_func(work_item);
+        err = data->worker_func(work_item, HM_NULL);
         if (data->item_dispose_func_opt) {
             err = hmMergeErrors(err, data->item_dispose_func_opt(work_item));
         }
@@ -203,9 +264,72 @@ static hmError hmWorkerDrainQueue(hmWorkerData* data)
     return hmWorkerProcessNewItems(data);
 }
 
+static hmError hmWorkerCoroutineFunc(void* user_data)
+{
+    hmWorkerCoroutineItem* coroutine_item = (hmWorkerCoroutineItem*)user_data;
+    return coroutine_item->data->worker_func(coroutine_item->item, &coroutine_item->data->scheduler);
+}
+
+static hmError hmWorkerDisposeCoroutineItem(void* obj)
+{
+    hmWorkerCoroutineItem* coroutine_item = (hmWorkerCoroutineItem*)obj;
+    hmWorkerData* data = coroutine_item->data;
+    hmError err = HM_OK;
+    if (data->item_dispose_func_opt) {
+        err = data->item_dispose_func_opt(coroutine_item->item);
+    }
+    hmFree(data->allocator, coroutine_item);
+    return err;
+}
+
+/* Unlike hmWorkerProcessNewItems(..), only starts processing the items: they run in coroutines on hmSchedulerRun(..) */
+static hmError hmWorkerSpawnNewItems(hmWorkerData* data)
+{
+    /* The worker's thread is the only consumer, so the queue can't become empty between the check and hmWorkerDequeueWorkItem(..) */
+    while (hmWorkerShouldProcessQueue(data) && !hmQueueIsEmpty(&data->queue)) {
+        hmWorkerCoroutineItem* coroutine_item = (hmWorkerCoroutineItem*)hmAlloc(data->allocator, sizeof(hmWorkerCoroutineItem) + data->item_size);
+        if (!coroutine_item) {
+            return HM_ERROR_OUT_OF_MEMORY;
+        }
+        coroutine_item->data = data;
+        hmError err = hmWorkerDequeueWorkItem(data, coroutine_item->item);
+        if (err != HM_OK) {
+            hmFree(data->allocator, coroutine_item);
+            return err;
+        }
+        err = hmSchedulerSpawn(&data->scheduler, &hmWorkerCoroutineFunc, coroutine_item, &hmWorkerDisposeCoroutineItem);
+        if (err != HM_OK) {
+            return hmMergeErrors(err, hmWorkerDisposeCoroutineItem(coroutine_item));
+        }
+    }
+    return HM_OK;
+}
+
+static hmError hmWorkerCoroutineThreadFunc(hmWorkerData* data)
+{
+    while (hmWorkerShouldRun(data)) {
+        HM_TRY(hmWorkerSpawnNewItems(data));
+        hm_bool is_parked = HM_FALSE;
+        HM_TRY(hmWorkerTryPark(data, &is_parked));
+        /* Blocks only if there's nothing to spawn; coroutines which wait for I/O are woken up by the scheduler itself. */
+        HM_TRY(hmSchedulerRun(&data->scheduler, is_parked ? HM_SCHEDULER_INFINITE_TIMEOUT : 0));
+    }
+    if (hmWorkerShouldDrainQueue(data)) {
+        data->is_draining_queue = HM_TRUE;
+        HM_TRY(hmWorkerSpawnNewItems(data));
+        while (hmSchedulerGetCoroutineCount(&data->scheduler) > 0) {
+            HM_TRY(hmSchedulerRun(&data->scheduler, HM_SCHEDULER_INFINITE_TIMEOUT));
+        }
+    }
+    return HM_OK;
+}
+
 static hmError hmWorkerThreadFunc(void* user_data)
 {
     hmWorkerData* data = (hmWorkerData*)user_data;
+    if (data->is_coroutine_based) {
+        return hmWorkerCoroutineThreadFunc(data);
+    }
     while (hmWorkerShouldRun(data)) {
         HM_TRY(hmWorkerWaitForNewItems(data));
         HM_TRY(hmWorkerProcessNewItems(data));
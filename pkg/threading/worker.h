@@ -16,11 +16,17 @@
 
 #include <core/common.h>
 #include <core/string.h>
+#include <threading/scheduler.h>
 
 /* An internal hardcoded limit for optimization. */
 #define HM_WORKER_MAX_ITEM_SIZE 1024
+/* See `coroutine_stack_size` in hmCreateWorker(..) */
+#define HM_WORKER_NO_COROUTINES 0
 
-typedef hmError (*hmWorkerFunc)(void* work_item);
+/* `scheduler_opt` is the scheduler which runs the item's coroutine if the worker is coroutine-based (see
+   `coroutine_stack_size` in hmCreateWorker(..)), to be used with hmSchedulerYield(..), hmSocketSetScheduler(..), etc.;
+   HM_NULL otherwise. */
+typedef hmError (*hmWorkerFunc)(void* work_item, hmScheduler* scheduler_opt);
 
 typedef struct {
     struct hmWorkerData_* data;
@@ -28,6 +34,8 @@ typedef struct {
 
 /* A worker allows to process work items on a separate thread.
    The allocator should be thread-safe, as it will allocate/deallocate on different threads.
+   A worker with an empty queue parks its thread without a timeout, so idle workers consume no CPU time; the thread is woken up
+   only by new work items and by hmWorkerStop(..)
    The work queue can be made bounded. If it's bounded, the queue will never grow (see also hmWorkerEnqueueItem(..)).
    `item_size` specifies the size of a work item; returns HM_ERROR_INVALID_ARGUMENT if it's bigger than HM_WORKER_MAX_ITEM_SIZE.
    `item_dispose_func_opt` specifies how items are disposed when they're removed from the queue after being processed. The
@@ -39,16 +47,27 @@ typedef struct {
    `is_queue_bounded` specifies whether the worker' queue is bounded or unbounded. Unbounded queues grow infinitely, while bounded
     queues return HM_ERROR_LIMIT_EXCEEDED if the capacity is exceeded. See also hmCreateQueue(..)
    `queue_capacity` specifies the internal queue size. Note that if the rate of enqueueing new items is very high and the queue
-    is unbounded, the worker may fail with an out-of-memory condition. */
+    is unbounded, the worker may fail with an out-of-memory condition.
+   `coroutine_stack_size`, if not HM_WORKER_NO_COROUTINES, makes the worker process every item in its own coroutine
+    with the given stack size (see hmCreateCoroutine(..)) multiplexed on the worker's thread by a scheduler (see hmScheduler).
+    Items which wait for I/O (for example, hmSocketRead(..) on a socket bound to the scheduler which is passed to
+    `worker_func`, see hmSocketSetScheduler(..)) then don't block the processing of other items, so a handful of
+    workers can serve a very large number of concurrent requests. In that case, the worker starts processing new items
+    without waiting for the previous ones to finish.
+   `processor_indices_opt` and `processor_count`, if specified, pin the worker's thread to the given processors from the
+    start (see hmCreateThreadWithAffinity(..)). Can be HM_NULL and 0. */
 hmError hmCreateWorker(
-    hmAllocator*  allocator,
-    hmString*     name_opt,
-    hmWorkerFunc  worker_func,
-    hm_nint       item_size,
-    hmDisposeFunc item_dispose_func_opt,
-    hm_bool       is_queue_bounded,
-    hm_nint       queue_capacity,
-    hmWorker*     in_worker
+    hmAllocator*   allocator,
+    hmString*      name_opt,
+    hmWorkerFunc   worker_func,
+    hm_nint        item_size,
+    hmDisposeFunc  item_dispose_func_opt,
+    hm_bool        is_queue_bounded,
+    hm_nint        queue_capacity,
+    hm_nint        coroutine_stack_size,
+    const hm_nint* processor_indices_opt,
+    hm_nint        processor_count,
+    hmWorker*      in_worker
 );
 /* Before disposing of the worker, it should be stopped and awaited with hmWorkerStop(..) and hmWorkerWait(..)
    Returns HM_ERROR_INVALID_STATE if the worker isn't fully stopped. */
@@ -56,7 +75,8 @@ hmError hmWorkerDispose(hmWorker* worker);
 hmError hmWorkerDisposeFunc(void* obj);
 /* Tells the worker to stop gracefully.
    If `should_drain_queue` is set to HM_TRUE, the worker makes sure all work items currently enqueued are processed, before stopping.
-   Otherwise, the worker will finish processing only the current item and stop immediately. */
+   Otherwise, the worker will finish processing only the current item and stop immediately (for coroutine-based workers,
+   items which have already started but haven't finished yet are abandoned and disposed of in hmWorkerDispose(..)) */
 hmError hmWorkerStop(hmWorker* worker, hm_bool should_drain_queue);
 /* Blocks the current thread until the worker completely shuts down (after being told to do so via hmWorkerStop(..)).
    It's the only safe way to gracefully terminate a worker. Usually useful when the whole runtime terminates.
@@ -13,44 +13,121 @@
 
 #include <threading/workerpool.h>
 
+#include <core/environment.h>
+#include <core/math.h>
+#include <core/stringbuilder.h>
+#include <threading/thread.h>
+
+/* Where the workers can be placed: the processors available to the process and the NUMA nodes they belong to. */
+typedef struct {
+    hmArray  processors;        /* hmProcessorInfo, see hmGetAvailableProcessors(..) */
+    hm_nint* nodes;             /* Distinct nodes of `processors`, in the order of their first appearance. */
+    hm_nint  node_count;
+    hm_nint* processor_indices; /* Scratch space for the processors of a single worker (see hmWorkerPoolTopologyPlaceWorker(..)) */
+} hmWorkerPoolTopology;
+
+static hmError hmCreateWorkerPoolTopology(hmAllocator* allocator, hmWorkerPoolTopology* in_topology);
+static hmError hmWorkerPoolTopologyDispose(hmAllocator* allocator, hmWorkerPoolTopology* topology);
+static void hmWorkerPoolTopologyPlaceWorker(
+    hmWorkerPoolTopology* topology,
+    hmWorkerPoolAffinity  affinity,
+    hm_nint               worker_index,
+    hm_nint*              out_processor_count
+);
+static hmError hmWorkerPoolCreateWorkerName(
+    hmAllocator*     allocator,
+    hmStringBuilder* string_builder,
+    hmString*        name,
+    hm_nint          worker_index,
+    hmString*        in_worker_name
+);
+
 hmError hmCreateWorkerPool(
-    hmAllocator*  allocator,
-    hm_nint       worker_count,
-    hmWorkerFunc  worker_func,
-    hm_nint       item_size,
-    hmDisposeFunc item_dispose_func_opt,
-    hm_bool       is_queue_bounded,
-    hm_nint       queue_capacity,
-    hmWorkerPool* in_worker_pool
+    hmAllocator*         allocator,
+    hmString*            name_opt,
+    hm_nint              worker_count,
+    hmWorkerFunc         worker_func,
+    hm_nint              item_size,
+    hmDisposeFunc        item_dispose_func_opt,
+    hm_bool              is_queue_bounded,
+    hm_nint              queue_capacity,
+    hm_nint              coroutine_stack_size,
+    hmWorkerPoolAffinity affinity,
+    hmWorkerPool*        in_worker_pool
 )
 {
-    if (worker_count == 0) {
+    if (worker_count == 0 || affinity > HM_WORKER_POOL_AFFINITY_NODE) {
         return HM_ERROR_INVALID_ARGUMENT;
     }
+    hmString default_name;
+    if (!name_opt) {
+        HM_TRY(hmCreateStringViewFromCString(HM_WORKER_POOL_DEFAULT_NAME, &default_name));
+        name_opt = &default_name;
+    }
     in_worker_pool->workers = hmAlloc(allocator, sizeof(hmWorker) * worker_count);
     if (!in_worker_pool->workers) {
         return HM_ERROR_OUT_OF_MEMORY;
     }
+    in_worker_pool->allocator = allocator;
     hmError err = HM_OK;
-    hm_nint worker_index = 0;
-    for (worker_index = 0; worker_index < worker_count; worker_index++) {
-        HM_TRY_OR_FINALIZE(err, hmCreateWorker(
+    hm_nint created_worker_count = 0;
+    hmWorkerPoolTopology topology;
+    hmStringBuilder string_builder;
+    hm_bool is_topology_initialized = HM_FALSE,
+            is_string_builder_initialized = HM_FALSE;
+    if (affinity != HM_WORKER_POOL_AFFINITY_NONE) {
+        HM_TRY_OR_FINALIZE(err, hmCreateWorkerPoolTopology(allocator, &topology));
+        is_topology_initialized = HM_TRUE;
+    }
+    HM_TRY_OR_FINALIZE(err, hmCreateStringBuilder(allocator, &string_builder));
+    is_string_builder_initialized = HM_TRUE;
+    for (hm_nint worker_index = 0; worker_index < worker_count; worker_index++) {
+        hm_nint processor_count = 0;
+        if (is_topology_initialized) {
+            hmWorkerPoolTopologyPlaceWorker(&topology, affinity, worker_index, &processor_count);
+        }
+        hmWorker* worker = &in_worker_pool->workers[worker_index];
+        hmString worker_name;
+        HM_TRY_OR_FINALIZE(err, hmWorkerPoolCreateWorkerName(allocator, &string_builder, name_opt, worker_index, &worker_name));
+        err = hmCreateWorker(
             allocator,
-            HM_NULL,
+            &worker_name,
             worker_func,
             item_size,
             item_dispose_func_opt,
             is_queue_bounded,
             queue_capacity,
-            &in_worker_pool->workers[worker_index]
-        ));
+            coroutine_stack_size,
+            processor_count ? topology.processor_indices : HM_NULL,
+            processor_count,
+            worker
+        );
+        if (err == HM_OK) {
+            created_worker_count++;
+        }
+        err = hmMergeErrors(err, hmStringDispose(&worker_name)); /* The worker has its own copy of the name. */
+        if (err != HM_OK) {
+            HM_FINALIZE;
+        }
     }
-    in_worker_pool->allocator = allocator;
     in_worker_pool->worker_count = worker_count;
     in_worker_pool->current_index = 0;
 HM_ON_FINALIZE
+    if (is_string_builder_initialized) {
+        err = hmMergeErrors(err, hmStringBuilderDispose(&string_builder));
+    }
+    if (is_topology_initialized) {
+        err = hmMergeErrors(err, hmWorkerPoolTopologyDispose(allocator, &topology));
+    }
     if (err != HM_OK) {
-        for (hm_nint j = 0; j < worker_index; j++) {
+        /* The workers are already running, so they have to be stopped before they can be disposed of. */
+        for (hm_nint j = 0; j < created_worker_count; j++) {
+            err = hmMergeErrors(err, hmWorkerStop(&in_worker_pool->workers[j], HM_FALSE));
+        }
+        for (hm_nint j = 0; j < created_worker_count; j++) {
+            err = hmMergeErrors(err, hmWorkerWait(&in_worker_pool->workers[j], HM_THREAD_JOIN_MAX_TIMEOUT_MS));
+        }
+        for (hm_nint j = 0; j < created_worker_count; j++) {
             err = hmMergeErrors(err, hmWorkerDispose(&in_worker_pool->workers[j]));
         }
         hmFree(allocator, in_worker_pool->workers);
@@ -96,3 +173,92 @@ hmError hmWorkerPoolEnqueueItem(hmWorkerPool* pool, void* in_work_item)
     hmWorker* worker = hmWorkerGetQueueSize(first_choice) < hmWorkerGetQueueSize(second_choice) ? first_choice : second_choice;
     return hmWorkerEnqueueItem(worker, in_work_item);
 }
+
+static hmError hmCreateWorkerPoolTopology(hmAllocator* allocator, hmWorkerPoolTopology* in_topology)
+{
+    HM_TRY(hmGetAvailableProcessors(allocator, &in_topology->processors));
+    hmError err = HM_OK;
+    hm_nint processor_count = hmArrayGetCount(&in_topology->processors);
+    hm_nint buffer_size = 0;
+    hm_nint* buffer = HM_NULL;
+    if (!processor_count) {
+        err = HM_ERROR_PLATFORM_DEPENDENT; /* Nowhere to pin the workers to. */
+        HM_FINALIZE;
+    }
+    HM_TRY_OR_FINALIZE(err, hmMulNint(processor_count, 2 * sizeof(hm_nint), &buffer_size));
+    buffer = (hm_nint*)hmAlloc(allocator, buffer_size);
+    if (!buffer) {
+        err = HM_ERROR_OUT_OF_MEMORY;
+        HM_FINALIZE;
+    }
+    in_topology->nodes = buffer;
+    in_topology->processor_indices = buffer + processor_count;
+    in_topology->node_count = 0;
+    hmProcessorInfo* processors = hmArrayGetRaw(&in_topology->processors, hmProcessorInfo);
+    for (hm_nint i = 0; i < processor_count; i++) {
+        hm_nint node = processors[i].node;
+        hm_bool is_new_node = HM_TRUE;
+        for (hm_nint j = 0; j < in_topology->node_count; j++) {
+            if (in_topology->nodes[j] == node) {
+                is_new_node = HM_FALSE;
+                break;
+            }
+        }
+        if (is_new_node) {
+            in_topology->nodes[in_topology->node_count++] = node;
+        }
+    }
+HM_ON_FINALIZE
+    if (err != HM_OK) {
+        err = hmMergeErrors(err, hmArrayDispose(&in_topology->processors));
+    }
+    return err;
+}
+
+static hmError hmWorkerPoolTopologyDispose(hmAllocator* allocator, hmWorkerPoolTopology* topology)
+{
+    hmFree(allocator, topology->nodes); /* Also frees `processor_indices`, which share the same buffer. */
+    return hmArrayDispose(&topology->processors);
+}
+
+/* Fills `processor_indices` with the processors the worker should be pinned to. */
+static void hmWorkerPoolTopologyPlaceWorker(
+    hmWorkerPoolTopology* topology,
+    hmWorkerPoolAffinity  affinity,
+    hm_nint               worker_index,
+    hm_nint*              out_processor_count
+)
+{
+    hmProcessorInfo* processors = hmArrayGetRaw(&topology->processors, hmProcessorInfo);
+    hm_nint processor_count = hmArrayGetCount(&topology->processors);
+    if (affinity == HM_WORKER_POOL_AFFINITY_PROCESSOR) {
+        hmProcessorInfo* processor = &processors[worker_index % processor_count];
+        topology->processor_indices[0] = processor->index;
+        *out_processor_count = 1;
+        return;
+    }
+    hm_nint node = topology->nodes[worker_index % topology->node_count];
+    hm_nint node_processor_count = 0;
+    for (hm_nint i = 0; i < processor_count; i++) {
+        if (processors[i].node == node) {
+            topology->processor_indices[node_processor_count++] = processors[i].index;
+        }
+    }
+    *out_processor_count = node_processor_count;
+}
+
+/* Produces "<name>-<index>" */
+static hmError hmWorkerPoolCreateWorkerName(
+    hmAllocator*     allocator,
+    hmStringBuilder* string_builder,
+    hmString*        name,
+    hm_nint          worker_index,
+    hmString*        in_worker_name
+)
+{
+    HM_TRY(hmStringBuilderClear(string_builder));
+    HM_TRY(hmStringBuilderAppendCStringWithLength(string_builder, hmStringGetChars(name), hmStringGetLengthInBytes(name)));
+    HM_TRY(hmStringBuilderAppendCString(string_builder, "-"));
+    HM_TRY(hmStringBuilderAppendUint64(string_builder, (hm_uint64)worker_index));
+    return hmStringBuilderToString(string_builder, allocator, in_worker_name);
+}
@@ -17,6 +17,14 @@
 #include <threading/atomic.h>
 #include <threading/worker.h>
 
+#define HM_WORKER_POOL_DEFAULT_NAME "worker" /* see hmCreateWorkerPool(..) */
+
+/* See `affinity` in hmCreateWorkerPool(..) */
+typedef hm_uint8 hmWorkerPoolAffinity;
+#define HM_WORKER_POOL_AFFINITY_NONE      ((hmWorkerPoolAffinity)0)
+#define HM_WORKER_POOL_AFFINITY_PROCESSOR ((hmWorkerPoolAffinity)1)
+#define HM_WORKER_POOL_AFFINITY_NODE      ((hmWorkerPoolAffinity)2)
+
 typedef struct {
     hmAllocator*   allocator;
     hmWorker*      workers;
@@ -25,6 +33,9 @@ typedef struct {
 } hmWorkerPool;
 
 /* A worker pool is a way to multiplex workers onto all available CPU's.
+   `name_opt` is the prefix of the workers' names: workers are named "<prefix>-<index>" (for example, "worker-0"), which
+    makes them easy to tell apart in debuggers and profilers. If it's HM_NULL, HM_WORKER_POOL_DEFAULT_NAME is used.
+    Better keep it short, because the OS may truncate thread names (see HM_THREAD_OS_NAME_MAX_LENGTH).
    `worker_count` specifies the number of workers. Usually, the value is set to be equal to the number of CPU's on the
     system (see hmGetProcessorCount())
    `worker_func` is called every time a new item needs to be processed.
@@ -33,16 +44,31 @@ typedef struct {
    `is_queue_bounded` specifies whether the workers' queues are bounded or unbounded. Unbounded queues grow infinitely,
     while bounded queues return HM_ERROR_LIMIT_EXCEEDED if the capacity is exceeded. See also hmCreateQueue(..)
    `queue_capacity` specifies the internal queue size. Note that if the rate of enqueueing new items is very high and
-    the queue is unbounded, the chosen worker may fail with an out-of-memory condition. */
+    the queue is unbounded, the chosen worker may fail with an out-of-memory condition.
+   `coroutine_stack_size` specifies whether the workers process items in coroutines (see hmCreateWorker(..)) Can be set
+    to HM_WORKER_NO_COROUTINES.
+   `affinity` specifies where the workers run:
+    - HM_WORKER_POOL_AFFINITY_NONE: the OS decides;
+    - HM_WORKER_POOL_AFFINITY_PROCESSOR: each worker is pinned to its own processor, in the order returned by
+      hmGetAvailableProcessors(..) (round robin, if there are more workers than processors);
+    - HM_WORKER_POOL_AFFINITY_NODE: the workers are spread across NUMA nodes round robin, and each worker is pinned to all
+      processors of its node, so that the OS can still balance the load inside the node.
+    Pinned workers are pinned before their threads start (see hmCreateThreadWithAffinity(..)), so on NUMA systems, memory
+    which a worker touches first is placed on the worker's node by the OS: its thread stack, the stacks of its coroutines
+    (see hmCreateCoroutine(..)), which are mapped lazily and first written by the worker, and whatever `worker_func`
+    allocates and initializes. Memory prepared by the creating thread, such as the workers' queues, isn't moved. */
 hmError hmCreateWorkerPool(
-    hmAllocator*  allocator,
-    hm_nint       worker_count,
-    hmWorkerFunc  worker_func,
-    hm_nint       item_size,
-    hmDisposeFunc item_dispose_func_opt,
-    hm_bool       is_queue_bounded,
-    hm_nint       queue_capacity,
-    hmWorkerPool* in_worker_pool
+    hmAllocator*         allocator,
+    hmString*            name_opt,
+    hm_nint              worker_count,
+    hmWorkerFunc         worker_func,
+    hm_nint              item_size,
+    hmDisposeFunc        item_dispose_func_opt,
+    hm_bool              is_queue_bounded,
+    hm_nint              queue_capacity,
+    hm_nint              coroutine_stack_size,
+    hmWorkerPoolAffinity affinity,
+    hmWorkerPool*        in_worker_pool
 );
 hmError hmWorkerPoolDispose(hmWorkerPool* pool);
 /* Tells the worker pool to stop gracefully by asking all workers in the pool to stop.